@@ -100,9 +100,11 @@ XCB_KBD_LIBS   := $(call ldflags_for_lib, xcb-keysyms,xcb-keysyms)
 XCB_WM_CFLAGS := $(call cflags_for_lib, xcb-icccm)
 XCB_WM_CFLAGS += $(call cflags_for_lib, xcb-xinerama)
 XCB_WM_CFLAGS += $(call cflags_for_lib, xcb-randr)
+XCB_WM_CFLAGS += $(call cflags_for_lib, xcb-sync)
 XCB_WM_LIBS   := $(call ldflags_for_lib, xcb-icccm,xcb-icccm)
 XCB_WM_LIBS   += $(call ldflags_for_lib, xcb-xinerama,xcb-xinerama)
 XCB_WM_LIBS   += $(call ldflags_for_lib, xcb-randr,xcb-randr)
+XCB_WM_LIBS   += $(call ldflags_for_lib, xcb-sync,xcb-sync)
 
 # Xlib
 X11_CFLAGS := $(call cflags_for_lib, x11)
@@ -130,6 +132,10 @@ I3_CPPFLAGS += -DPCRE_HAS_UCP=1
 endif
 PCRE_LIBS   := $(call ldflags_for_lib, libpcre,pcre)
 
+# zlib (for gzip-compressed layout files)
+ZLIB_CFLAGS := $(call cflags_for_lib, zlib)
+ZLIB_LIBS   := $(call ldflags_for_lib, zlib,z)
+
 # startup-notification
 LIBSN_CFLAGS := $(call cflags_for_lib, libstartup-notification-1.0)
 LIBSN_LIBS   := $(call ldflags_for_lib, libstartup-notification-1.0,startup-notification-1)
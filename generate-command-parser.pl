@@ -135,6 +135,8 @@ my $resultname = uc(substr($prefix, 0, 1)) . substr($prefix, 1) . 'Result';
 say $callfh "static void GENERATED_call(const int call_identifier, struct $resultname *result) {";
 say $callfh '    switch (call_identifier) {';
 my $call_id = 0;
+my @call_next_states;
+my @call_names;
 for my $state (@keys) {
     my $tokens = $states{$state};
     for my $token (@$tokens) {
@@ -161,6 +163,9 @@ for my $state (@keys) {
         $fmt =~ s/"([a-z0-9_]+)"/%s/g;
         $fmt =~ s/(?:-?|\b)[0-9]+\b/%d/g;
 
+        push @call_next_states, $next_state;
+        my ($call_name) = ($cmd =~ /^([a-z0-9_]+)\(/);
+        push @call_names, $call_name // '';
         say $callfh "         case $call_id:";
         say $callfh "             result->next_state = $next_state;";
         say $callfh '#ifndef TEST_PARSER';
@@ -194,12 +199,23 @@ say $callfh '            printf("BUG in the parser. state = %d\n", call_identifi
 say $callfh '            assert(false);';
 say $callfh '    }';
 say $callfh '}';
+# The state each call transitions to (unless the called function overrides
+# it), which allows parsing without calling any function.
+say $callfh "static const cmdp_state GENERATED_call_next_state[] __attribute__((unused)) = {";
+say $callfh "    $_," for @call_next_states;
+say $callfh '};';
+# The name of the function each call invokes, used for statistics.
+say $callfh "static const char *GENERATED_call_name[] __attribute__((unused)) = {";
+say $callfh qq|    "$_",| for @call_names;
+say $callfh '};';
 close($callfh);
 
 # Fourth step: Generate the token datastructures.
 
 open(my $tokfh, '>', "GENERATED_${prefix}_tokens.h");
 
+my %first_chars;
+
 for my $state (@keys) {
     my $tokens = $states{$state};
     say $tokfh 'static cmdp_token tokens_' . $state . '[' . scalar @$tokens . '] = {';
@@ -217,15 +233,48 @@ for my $state (@keys) {
             $next_state = '__CALL';
         }
         my $identifier = $token->{identifier};
-        say $tokfh qq|    { "$token_name", "$identifier", $next_state, { $call_identifier } }, |;
+        my $length = length($token_name);
+        $length-- if $token_name =~ /^'/;
+        say $tokfh qq|    { "$token_name", "$identifier", $next_state, { $call_identifier }, $length }, |;
     }
     say $tokfh '};';
+
+    # For every character a literal of this state starts with, the tokens
+    # which need to be tried if the input starts with that character: the
+    # literals starting with it and all other tokens (strings, numbers, end),
+    # in their original order so that the first matching token still wins.
+    # All other characters can only match the non-literal tokens.
+    my %candidates;
+    my @others;
+    for my $idx (0 .. $#$tokens) {
+        my $name = $tokens->[$idx]->{token};
+        if ($name =~ /^'(.)/) {
+            my $first = lc($1);
+            $candidates{$first} //= [ @others ];
+            push @{$candidates{$first}}, $idx;
+        } else {
+            push @others, $idx;
+            push @{$candidates{$_}}, $idx for keys %candidates;
+        }
+    }
+    my @first_chars = sort keys %candidates;
+    for my $idx (0 .. $#first_chars) {
+        say $tokfh "static const int candidates_${state}_$idx\[] = { " .
+                   join(', ', @{$candidates{$first_chars[$idx]}}, -1) . ' };';
+    }
+    say $tokfh "static const int *candidates_${state}\[] = { " .
+               join(', ', (map { "candidates_${state}_$_" } (0 .. $#first_chars)), 'NULL') . ' };';
+    say $tokfh "static const int others_${state}\[] = { " . join(', ', @others, -1) . ' };';
+    my $escaped = join('', @first_chars);
+    $escaped =~ s/(["\\])/\\$1/g;
+    $first_chars{$state} = $escaped;
 }
 
 say $tokfh 'static cmdp_token_ptr tokens[' . scalar @keys . '] = {';
 for my $state (@keys) {
     my $tokens = $states{$state};
-    say $tokfh '    { tokens_' . $state . ', ' . scalar @$tokens . ' },';
+    say $tokfh '    { tokens_' . $state . ', ' . scalar @$tokens . ', "' . $first_chars{$state} .
+               '", candidates_' . $state . ', others_' . $state . ' },';
 }
 say $tokfh '};';
 
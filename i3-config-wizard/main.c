@@ -45,7 +45,6 @@
 
 #include <X11/Xlib.h>
 #include <X11/keysym.h>
-#include <X11/XKBlib.h>
 
 /* We need SYSCONFDIR for the path to the keycode config template, so raise an
  * error if it’s not defined for whatever reason */
@@ -70,7 +69,6 @@ enum { MOD_Mod1, MOD_Mod4 } modifier = MOD_Mod4;
 static char *config_path;
 static uint32_t xcb_numlock_mask;
 xcb_connection_t *conn;
-static xcb_key_symbols_t *keysyms;
 xcb_screen_t *root_screen;
 static xcb_get_modifier_mapping_reply_t *modmap_reply;
 static i3Font font;
@@ -81,7 +79,16 @@ static xcb_pixmap_t pixmap;
 static xcb_gcontext_t pixmap_gc;
 static xcb_key_symbols_t *symbols;
 xcb_window_t root;
-Display *dpy;
+
+/* The keysyms on the first four layers (normal, shift, mode_switch,
+ * mode_switch + shift) of every keycode, indexed by
+ * (keycode - min_keycode) * KEYSYM_LEVELS + level. Built once (see
+ * build_keysym_table()) so that rewriting the bindcode lines does not need to
+ * look up every keycode again. */
+#define KEYSYM_LEVELS 4
+static xcb_keysym_t *keysym_table;
+static xcb_keycode_t min_keycode;
+static xcb_keycode_t max_keycode;
 
 static void finish();
 
@@ -95,11 +102,17 @@ typedef struct token {
     union {
         uint16_t call_identifier;
     } extra;
+    int length;
 } cmdp_token;
 
+/* The wizard only looks at a few keywords, so it does not use the per-state
+ * candidate lists (see src/config_parser.c). */
 typedef struct tokenptr {
     cmdp_token *array;
     int n;
+    const char *first_chars;
+    const int **candidates;
+    const int *others;
 } cmdp_token_ptr;
 
 
@@ -206,24 +219,47 @@ static void clear_stack(void) {
     }
 }
 
+/*
+ * Fills keysym_table from the key symbols. The keyboard mapping has already
+ * been fetched at this point, so this does not cause any round trips.
+ *
+ */
+static void build_keysym_table(void) {
+    min_keycode = xcb_get_setup(conn)->min_keycode;
+    max_keycode = xcb_get_setup(conn)->max_keycode;
+
+    const int count = max_keycode - min_keycode + 1;
+    keysym_table = smalloc(count * KEYSYM_LEVELS * sizeof(xcb_keysym_t));
+    for (int i = 0; i < count; i++)
+        for (int level = 0; level < KEYSYM_LEVELS; level++)
+            keysym_table[i * KEYSYM_LEVELS + level] =
+                xcb_key_symbols_get_keysym(symbols, min_keycode + i, level);
+}
+
+/*
+ * Returns the keysym on the given level of the given keycode, or NoSymbol if
+ * the keycode is out of range.
+ *
+ */
+static xcb_keysym_t keycode_to_keysym(int keycode, int level) {
+    if (keycode < min_keycode || keycode > max_keycode)
+        return XCB_NO_SYMBOL;
+    return keysym_table[(keycode - min_keycode) * KEYSYM_LEVELS + level];
+}
+
 /*
  * Returns true if sym is bound to any key except for 'except_keycode' on the
  * first four layers (normal, shift, mode_switch, mode_switch + shift).
  *
  */
-static bool keysym_used_on_other_key(KeySym sym, xcb_keycode_t except_keycode) {
-    xcb_keycode_t i,
-                  min_keycode = xcb_get_setup(conn)->min_keycode,
-                  max_keycode = xcb_get_setup(conn)->max_keycode;
-
-    for (i = min_keycode; i && i <= max_keycode; i++) {
-        if (i == except_keycode)
+static bool keysym_used_on_other_key(xcb_keysym_t sym, int except_keycode) {
+    const int count = max_keycode - min_keycode + 1;
+    for (int i = 0; i < count * KEYSYM_LEVELS; i++) {
+        if (keysym_table[i] != sym)
             continue;
-        for (int level = 0; level < 4; level++) {
-            if (xcb_key_symbols_get_keysym(keysyms, i, level) != sym)
-                continue;
-            return true;
-        }
+        if ((min_keycode + i / KEYSYM_LEVELS) == except_keycode)
+            continue;
+        return true;
     }
     return false;
 }
@@ -252,11 +288,11 @@ static char *next_state(const cmdp_token *token) {
              * This reduces a lot of confusion for users who switch keyboard
              * layouts from qwerty to qwertz or other slight variations of
              * qwerty (yes, that happens quite often). */
-            KeySym sym = XkbKeycodeToKeysym(dpy, keycode, 0, 0);
+            xcb_keysym_t sym = keycode_to_keysym(keycode, 0);
             if (!keysym_used_on_other_key(sym, keycode))
                 level = 0;
         }
-        KeySym sym = XkbKeycodeToKeysym(dpy, keycode, 0, level);
+        xcb_keysym_t sym = keycode_to_keysym(keycode, level);
         char *str = XKeysymToString(sym);
         const char *release = get_string("release");
         char *res;
@@ -644,9 +680,6 @@ static void handle_button_press(xcb_button_press_event_t* event) {
 static void finish() {
     printf("creating \"%s\"...\n", config_path);
 
-    if (!(dpy = XOpenDisplay(NULL)))
-        errx(1, "Could not connect to X11");
-
     FILE *kc_config = fopen(SYSCONFDIR "/i3/config.keycodes", "r");
     if (kc_config == NULL)
         err(1, "Could not open input file \"%s\"", SYSCONFDIR "/i3/config.keycodes");
@@ -800,17 +833,18 @@ int main(int argc, char *argv[]) {
         errx(1, "Cannot open display\n");
 
     if (socket_path == NULL)
-        socket_path = root_atom_contents("I3_SOCKET_PATH", conn, screen);
+        socket_path = get_socket_path(conn, screen);
 
     if (socket_path == NULL)
         socket_path = "/tmp/i3-ipc.sock";
 
-    keysyms = xcb_key_symbols_alloc(conn);
+    /* Place all the requests we need (the keyboard mapping is requested by
+     * xcb_key_symbols_alloc()) before waiting for any reply, so that they are
+     * answered while the fonts are loaded. */
+    symbols = xcb_key_symbols_alloc(conn);
     xcb_get_modifier_mapping_cookie_t modmap_cookie;
     modmap_cookie = xcb_get_modifier_mapping(conn);
-    symbols = xcb_key_symbols_alloc(conn);
 
-    /* Place requests for the atoms we need as soon as possible */
     #define xmacro(atom) \
         xcb_intern_atom_cookie_t atom ## _cookie = xcb_intern_atom(conn, 0, strlen(#atom), #atom);
     #include "atoms.xmacro"
@@ -819,13 +853,14 @@ int main(int argc, char *argv[]) {
     root_screen = xcb_aux_get_screen(conn, screen);
     root = root_screen->root;
 
+    font = load_font(pattern, true);
+    bold_font = load_font(patternbold, true);
+
     if (!(modmap_reply = xcb_get_modifier_mapping_reply(conn, modmap_cookie, NULL)))
         errx(EXIT_FAILURE, "Could not get modifier mapping\n");
 
     xcb_numlock_mask = get_mod_mask_for(XCB_NUM_LOCK, symbols, modmap_reply);
-
-    font = load_font(pattern, true);
-    bold_font = load_font(patternbold, true);
+    build_keysym_table();
 
     /* Open an input window */
     win = xcb_generate_id(conn);
@@ -4,7 +4,8 @@
  * i3 - an improved dynamic tiling window manager
  * © 2009-2012 Michael Stapelberg and contributors (see also: LICENSE)
  *
- * i3-dump-log/main.c: Dumps the i3 SHM log to stdout.
+ * i3-dump-log/main.c: Dumps the i3 SHM log to stdout, optionally filtered
+ *                     and compressed.
  *
  */
 #include <stdio.h>
@@ -23,17 +24,235 @@
 #include <fcntl.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
+#include <time.h>
+#include <ctype.h>
+#include <locale.h>
+#include <zlib.h>
 
 #include "libi3.h"
 #include "shmlog.h"
 #include <i3/ipc.h>
 
-static uint32_t offset_next_write,
-                wrap_count;
+static uint32_t wrap_count;
+/* The number of bytes (see i3_shmlog_header.bytes_written) which were
+ * written to the log when we last caught up with i3. */
+static uint64_t bytes_read;
 
 static i3_shmlog_header *header;
 static char *logbuffer,
             *walk;
+static size_t logbuffer_size;
+
+/* Only lines logged in this time range are printed (0 means unbounded). */
+static time_t since, until;
+/* Only lines containing this string are printed (unless NULL). */
+static const char *grep;
+/* Only debug messages from these comma-separated categories (see the
+ * debuglog filter command) are printed (unless NULL). */
+static const char *categories;
+/* Whether any of the filters above is set. */
+static bool filtering;
+
+/* The decision for the previous line, which is also used for the following
+ * lines without a time prefix (messages spanning multiple lines). */
+static bool last_line_printed = true;
+
+/* The time prefix of the previous line and the time it was parsed to. i3
+ * logs many lines per second, so most lines have the same prefix. */
+static char last_prefix[64];
+static size_t last_prefix_len;
+static time_t last_prefix_time;
+
+/* With --gzip, the output is written through this stream. */
+static gzFile gz_out;
+
+/*
+ * Writes the whole buffer to stdout. Pipes and sockets may accept less than
+ * we asked for, so this loops until everything was written.
+ *
+ */
+static void write_all(const char *buf, size_t len) {
+    if (gz_out != NULL) {
+        while (len > 0) {
+            /* gzwrite() takes the length as an unsigned int. */
+            unsigned int chunk = (len > (1U << 30) ? (1U << 30) : (unsigned int)len);
+            if (gzwrite(gz_out, buf, chunk) == 0) {
+                int errnum;
+                const char *msg = gzerror(gz_out, &errnum);
+                errx(EXIT_FAILURE, "gzwrite(): %s", (errnum == Z_ERRNO ? strerror(errno) : msg));
+            }
+            buf += chunk;
+            len -= chunk;
+        }
+        return;
+    }
+
+    while (len > 0) {
+        ssize_t n = write(STDOUT_FILENO, buf, len);
+        if (n == -1) {
+            if (errno == EINTR)
+                continue;
+            err(EXIT_FAILURE, "write()");
+        }
+        buf += n;
+        len -= n;
+    }
+}
+
+/*
+ * Parses the time prefix i3 puts in front of every line ("%x %X - ", see
+ * time_prefix() in src/log.c). Returns false if the line has no such prefix.
+ *
+ */
+static bool parse_line_time(const char *line, size_t len, time_t *result) {
+    const char *end = memmem(line, (len < sizeof(last_prefix) ? len : sizeof(last_prefix)), " - ", 3);
+    if (end == NULL)
+        return false;
+
+    size_t prefix_len = end - line;
+    if (prefix_len == last_prefix_len && memcmp(line, last_prefix, prefix_len) == 0) {
+        *result = last_prefix_time;
+        return true;
+    }
+
+    char prefix[sizeof(last_prefix)];
+    memcpy(prefix, line, prefix_len);
+    prefix[prefix_len] = '\0';
+
+    struct tm tm;
+    memset(&tm, 0, sizeof(struct tm));
+    const char *parsed = strptime(prefix, "%x %X", &tm);
+    if (parsed == NULL || *parsed != '\0')
+        return false;
+    tm.tm_isdst = -1;
+
+    memcpy(last_prefix, prefix, prefix_len);
+    last_prefix_len = prefix_len;
+    last_prefix_time = *result = mktime(&tm);
+    return true;
+}
+
+/*
+ * Returns whether the given debug message (the line without the time prefix)
+ * belongs to one of the categories. Debug messages start with the source
+ * file, function and line ("x.c:x_push_changes:1234 - "), the other messages
+ * have no category and are always printed.
+ *
+ */
+static bool category_matches(const char *msg, size_t len) {
+    size_t token_len = 0;
+    while (token_len < len && msg[token_len] != ':' && msg[token_len] != ' ')
+        token_len++;
+    if (token_len == len || msg[token_len] != ':' ||
+        token_len < 3 || strncmp(msg + token_len - 2, ".c", 2) != 0)
+        return true;
+    token_len -= 2;
+
+    const char *walk = categories;
+    while (*walk != '\0') {
+        size_t category_len = strcspn(walk, ",");
+        if (category_len == token_len && strncmp(walk, msg, token_len) == 0)
+            return true;
+        walk += category_len;
+        if (*walk == ',')
+            walk++;
+    }
+    return false;
+}
+
+/*
+ * Returns whether the given line (without the newline) passes the filters.
+ *
+ */
+static bool line_matches(const char *line, size_t len) {
+    time_t t;
+    if (!parse_line_time(line, len, &t))
+        return last_line_printed;
+
+    if ((since != 0 && t < since) || (until != 0 && t > until))
+        return false;
+
+    if (categories != NULL) {
+        /* The time prefix ends with " - " */
+        const char *msg = line + last_prefix_len + 3;
+        if (!category_matches(msg, len - (msg - line)))
+            return false;
+    }
+
+    return (grep == NULL || memmem(line, len, grep, strlen(grep)) != NULL);
+}
+
+/*
+ * Writes the given part of the log to stdout, leaving out the lines which do
+ * not pass the filters. Consecutive matching lines are written at once.
+ *
+ */
+static void print_log(const char *buf, size_t len) {
+    if (!filtering) {
+        write_all(buf, len);
+        return;
+    }
+
+    const char *end = buf + len;
+    const char *pending = buf;
+    const char *line = buf;
+    while (line < end) {
+        const char *newline = memchr(line, '\n', end - line);
+        const char *next = (newline == NULL ? end : newline + 1);
+
+        last_line_printed = line_matches(line, (newline == NULL ? end : newline) - line);
+        if (!last_line_printed) {
+            write_all(pending, line - pending);
+            pending = next;
+        }
+        line = next;
+    }
+    write_all(pending, end - pending);
+}
+
+/*
+ * Makes everything written so far available to the reader. With --gzip, this
+ * ends the current deflate block, so that the output can be decompressed up
+ * to here while i3-dump-log -f is still running.
+ *
+ */
+static void flush_output(void) {
+    if (gz_out != NULL && gzflush(gz_out, Z_SYNC_FLUSH) != Z_OK)
+        errx(EXIT_FAILURE, "gzflush() failed");
+}
+
+/*
+ * Parses a time given to --since or --until: either a duration ago ("30s",
+ * "5m", "2h", "1d"), a time of today ("14:30" or "14:30:15") or a date and
+ * time ("2013-10-14 14:30:15"). Exits on invalid input.
+ *
+ */
+static time_t parse_time_arg(const char *arg) {
+    char *end;
+    long amount = strtol(arg, &end, 10);
+    if (end != arg && amount >= 0 && end[0] != '\0' && end[1] == '\0') {
+        const char *units = "smhd";
+        const long factors[] = { 1, 60, 60 * 60, 24 * 60 * 60 };
+        const char *unit = strchr(units, *end);
+        if (unit != NULL)
+            return time(NULL) - amount * factors[unit - units];
+    }
+
+    const time_t now = time(NULL);
+    struct tm tm;
+    const char *formats[] = { "%Y-%m-%d %H:%M:%S", "%Y-%m-%d %H:%M", "%H:%M:%S", "%H:%M" };
+    for (size_t i = 0; i < sizeof(formats) / sizeof(formats[0]); i++) {
+        localtime_r(&now, &tm);
+        tm.tm_sec = 0;
+        const char *parsed = strptime(arg, formats[i], &tm);
+        if (parsed == NULL || *parsed != '\0')
+            continue;
+        tm.tm_isdst = -1;
+        return mktime(&tm);
+    }
+
+    errx(EXIT_FAILURE, "Invalid time \"%s\", expected e.g. \"5m\", \"14:30\" or \"2013-10-14 14:30:00\"", arg);
+}
 
 static int check_for_wrap(void) {
     if (wrap_count == header->wrap_count)
@@ -42,38 +261,157 @@ static int check_for_wrap(void) {
     /* The log wrapped. Print the remaining content and reset walk to the top
      * of the log. */
     wrap_count = header->wrap_count;
-    const int len = (logbuffer + header->offset_last_wrap) - walk;
-    if (write(STDOUT_FILENO, walk, len) != len)
-        err(EXIT_FAILURE, "write()");
+    print_log(walk, (logbuffer + header->offset_last_wrap) - walk);
     walk = logbuffer + sizeof(i3_shmlog_header);
     return 1;
 }
 
 static void print_till_end(void) {
     check_for_wrap();
-    const int len = (logbuffer + header->offset_next_write) - walk;
-    const int n = write(STDOUT_FILENO, walk, len);
-    if (len != n)
-        err(EXIT_FAILURE, "write()");
-    if (n > 0) {
-        walk += n;
+    char *end = logbuffer + header->offset_next_write;
+    print_log(walk, end - walk);
+    walk = end;
+    bytes_read = header->bytes_written;
+}
+
+/*
+ * Skips the (probably mangled) remainder of the line which starts before
+ * walk, as long as it ends before the given end.
+ *
+ */
+static void skip_partial_line(const char *end) {
+    char *newline = memchr(walk, '\n', end - walk);
+    if (newline != NULL)
+        walk = newline + 1;
+}
+
+/*
+ * Prints everything i3 logged since the last call. If i3 overwrote data which
+ * we did not print yet (it wrapped more than once, or wrapped and then wrote
+ * past our read position), we report how many bytes were dropped and
+ * continue with the oldest data which is still in the log.
+ *
+ */
+static void print_new_lines(void) {
+    const uint32_t wraps = header->wrap_count - wrap_count;
+    const uint32_t next_write = header->offset_next_write;
+    const uint32_t last_wrap = header->offset_last_wrap;
+    const uint64_t written = header->bytes_written;
+
+    if (wraps > 1 || (wraps == 1 && logbuffer + next_write > walk)) {
+        /* The data from the start to next_write is still in the log, and
+         * unless i3 already wrote past it, so is the data from next_write to
+         * last_wrap. The rest is lost. */
+        uint64_t retained = next_write - sizeof(i3_shmlog_header);
+        if (next_write < last_wrap)
+            retained += last_wrap - next_write;
+        const uint64_t dropped = written - bytes_read - retained;
+        fprintf(stderr, "i3-dump-log: i3 overwrote the log faster than it could be read, %llu bytes dropped\n",
+                (unsigned long long)dropped);
+
+        if (next_write < last_wrap) {
+            walk = logbuffer + next_write;
+            skip_partial_line(logbuffer + last_wrap);
+            /* Make print_till_end() print up to last_wrap first. */
+            wrap_count = header->wrap_count - 1;
+        } else {
+            walk = logbuffer + sizeof(i3_shmlog_header);
+            wrap_count = header->wrap_count;
+        }
     }
+
+    print_till_end();
+}
+
+/*
+ * Maps the log with the given name, which is either the name of a SHM segment
+ * or (for i3 --shmlog-persistent) the path of a file. Returns false if it does
+ * not exist.
+ *
+ */
+static bool open_log(const char *name) {
+    struct stat statbuf;
+
+    /* NB: While we must never write, we need O_RDWR for the pthread condvar. */
+    int fd = shm_open(name, O_RDWR, 0);
+    if (fd == -1 && (fd = open(name, O_RDWR)) == -1) {
+        if (errno == ENOENT)
+            return false;
+        err(EXIT_FAILURE, "Could not open the i3 log (%s)", name);
+    }
+
+    if (fstat(fd, &statbuf) != 0)
+        err(EXIT_FAILURE, "stat(%s)", name);
+    if ((size_t)statbuf.st_size < sizeof(i3_shmlog_header))
+        errx(EXIT_FAILURE, "%s is not an i3 log", name);
+
+    /* NB: While we must never write, we need PROT_WRITE for the pthread condvar. */
+    logbuffer_size = statbuf.st_size;
+    logbuffer = mmap(NULL, logbuffer_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (logbuffer == MAP_FAILED)
+        err(EXIT_FAILURE, "Could not mmap the i3 log");
+    close(fd);
+
+    header = (i3_shmlog_header*)logbuffer;
+    return true;
+}
+
+/*
+ * Switches to the log which i3 created in place of the current one (when its
+ * size was changed with the shmlog command). The new log starts with the
+ * most recent messages of the old log, which we already printed. Returns
+ * false if i3 disabled the log instead.
+ *
+ */
+static bool reopen_log(const char *name) {
+    munmap(logbuffer, logbuffer_size);
+
+    /* i3 creates the new log right after removing the old one. */
+    int tries = 100;
+    while (!open_log(name)) {
+        if (--tries == 0)
+            return false;
+        usleep(10 * 1000);
+    }
+
+    /* Continue after the last byte we printed, or, if i3 already logged more
+     * than the new log retained, at its start. */
+    char *start = logbuffer + sizeof(i3_shmlog_header);
+    const uint64_t unread = header->bytes_written - bytes_read;
+    wrap_count = 0;
+    walk = logbuffer + header->offset_next_write;
+    if (header->wrap_count != 0 || unread > (uint64_t)(walk - start))
+        walk = start;
+    else walk -= unread;
+    return true;
 }
 
 int main(int argc, char *argv[]) {
     int o, option_index = 0;
     bool verbose = false,
          follow = false;
+    char *shmname = NULL;
 
     static struct option long_options[] = {
         {"version", no_argument, 0, 'v'},
         {"verbose", no_argument, 0, 'V'},
         {"follow", no_argument, 0, 'f'},
+        {"file", required_argument, 0, 'F'},
+        {"since", required_argument, 0, 'S'},
+        {"until", required_argument, 0, 'U'},
+        {"grep", required_argument, 0, 'g'},
+        {"category", required_argument, 0, 'c'},
+        {"gzip", no_argument, 0, 'z'},
         {"help", no_argument, 0, 'h'},
         {0, 0, 0, 0}
     };
 
-    char *options_string = "s:vfVh";
+    char *options_string = "s:vfF:S:U:g:c:zVh";
+    bool gzip = false;
+
+    /* The time prefixes of the log lines are formatted according to the
+     * locale, just like i3 does. */
+    setlocale(LC_ALL, "");
 
     while ((o = getopt_long(argc, argv, options_string, long_options, &option_index)) != -1) {
         if (o == 'v') {
@@ -83,14 +421,36 @@ int main(int argc, char *argv[]) {
             verbose = true;
         } else if (o == 'f') {
             follow = true;
+        } else if (o == 'F') {
+            shmname = sstrdup(optarg);
+        } else if (o == 'S') {
+            since = parse_time_arg(optarg);
+        } else if (o == 'U') {
+            until = parse_time_arg(optarg);
+        } else if (o == 'g') {
+            grep = optarg;
+        } else if (o == 'c') {
+            categories = optarg;
+        } else if (o == 'z') {
+            gzip = true;
         } else if (o == 'h') {
             printf("i3-dump-log " I3_VERSION "\n");
-            printf("i3-dump-log [-f] [-s <socket>]\n");
+            printf("i3-dump-log [-f] [-s <socket>] [-F <file>] [--since <time>] [--until <time>]\n"
+                   "            [--grep <string>] [--category <categories>] [--gzip]\n");
             return 0;
         }
     }
+    filtering = (since != 0 || until != 0 || grep != NULL || categories != NULL);
+
+    if (gzip) {
+        if (isatty(STDOUT_FILENO))
+            errx(EXIT_FAILURE, "Not writing compressed output to a terminal, redirect it to a file.");
+        if ((gz_out = gzdopen(STDOUT_FILENO, "wb")) == NULL)
+            errx(EXIT_FAILURE, "gzdopen() failed");
+    }
 
-    char *shmname = root_atom_contents("I3_SHMLOG_PATH", NULL, 0);
+    if (shmname == NULL)
+        shmname = root_atom_contents("I3_SHMLOG_PATH", NULL, 0);
     if (shmname == NULL) {
         /* Something failed. Let’s invest a little effort to find out what it
          * is. This is hugely helpful for users who want to debug i3 but are
@@ -124,22 +484,8 @@ int main(int argc, char *argv[]) {
     if (*shmname == '\0')
         errx(EXIT_FAILURE, "Cannot dump log: SHM logging is disabled in i3.");
 
-    struct stat statbuf;
-
-    /* NB: While we must never write, we need O_RDWR for the pthread condvar. */
-    int logbuffer_shm = shm_open(shmname, O_RDWR, 0);
-    if (logbuffer_shm == -1)
-        err(EXIT_FAILURE, "Could not shm_open SHM segment for the i3 log (%s)", shmname);
-
-    if (fstat(logbuffer_shm, &statbuf) != 0)
-        err(EXIT_FAILURE, "stat(%s)", shmname);
-
-    /* NB: While we must never write, we need PROT_WRITE for the pthread condvar. */
-    logbuffer = mmap(NULL, statbuf.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, logbuffer_shm, 0);
-    if (logbuffer == MAP_FAILED)
-        err(EXIT_FAILURE, "Could not mmap SHM segment for the i3 log");
-
-    header = (i3_shmlog_header*)logbuffer;
+    if (!open_log(shmname))
+        errx(EXIT_FAILURE, "The i3 log (%s) does not exist", shmname);
 
     if (verbose)
         printf("next_write = %d, last_wrap = %d, logbuffer_size = %d, shmname = %s\n",
@@ -166,6 +512,7 @@ int main(int argc, char *argv[]) {
     /* Then start from the beginning and print the newer lines */
     walk = logbuffer + sizeof(i3_shmlog_header);
     print_till_end();
+    flush_output();
 
     if (follow) {
         /* Since pthread_cond_wait() expects a mutex, we need to provide one.
@@ -174,14 +521,19 @@ int main(int argc, char *argv[]) {
         pthread_mutex_t dummy_mutex = PTHREAD_MUTEX_INITIALIZER;
         pthread_mutex_lock(&dummy_mutex);
         while (1) {
+            if (header->replaced && !reopen_log(shmname))
+                break;
             pthread_cond_wait(&(header->condvar), &dummy_mutex);
             /* If this was not a spurious wakeup, print the new lines. */
-            if (header->offset_next_write != offset_next_write) {
-                offset_next_write = header->offset_next_write;
-                print_till_end();
+            if (header->bytes_written != bytes_read) {
+                print_new_lines();
+                flush_output();
             }
         }
     }
 
+    if (gz_out != NULL && gzclose(gz_out) != Z_OK)
+        errx(EXIT_FAILURE, "Could not write the compressed output");
+
     return 0;
 }
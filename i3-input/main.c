@@ -46,6 +46,10 @@ static xcb_pixmap_t pixmap;
 static xcb_gcontext_t pixmap_gc;
 static xcb_char2b_t glyphs_ucs[512];
 static char *glyphs_utf8[512];
+/* Rendered width of each glyph and of all of them, so that typing only needs
+ * to draw or clear the glyph at the end of the input. */
+static int glyph_widths[512];
+static int input_width;
 static int input_position;
 static i3Font font;
 static i3String *prompt;
@@ -120,6 +124,37 @@ static uint8_t *concat_strings(char **glyphs, int max) {
     return output;
 }
 
+/*
+ * Draws the glyph at the given position of the input, which starts x pixels
+ * after the prompt, into the pixmap.
+ *
+ */
+static void draw_glyph(int position, int x) {
+    x += prompt_offset + 4;
+    if (x >= 496)
+        return;
+
+    i3String *glyph = i3string_from_ucs2(&glyphs_ucs[position], 1);
+    draw_text(glyph, pixmap, pixmap_gc, x, 4, 496 - x);
+    i3string_free(glyph);
+}
+
+/*
+ * Copies the part of the input which starts x pixels after the prompt and is
+ * width pixels wide from the pixmap to the window.
+ *
+ */
+static void copy_input_area(int x, int width) {
+    x += prompt_offset + 4;
+    if (x >= 496)
+        return;
+    if (x + width > 496)
+        width = 496 - x;
+
+    xcb_copy_area(conn, pixmap, win, pixmap_gc, x, 2, x, 2, width, font.height + 8 - 4);
+    xcb_flush(conn);
+}
+
 /*
  * Handles expose events (redraws of the window) and rendering in general. Will
  * be called from the code with event == NULL or from X with event != NULL.
@@ -142,12 +177,12 @@ static int handle_expose(void *data, xcb_connection_t *conn, xcb_expose_event_t
     if (prompt != NULL) {
         draw_text(prompt, pixmap, pixmap_gc, 4, 4, 492);
     }
-    /* … and the text */
-    if (input_position > 0)
-    {
-        i3String *input = i3string_from_ucs2(glyphs_ucs, input_position);
-        draw_text(input, pixmap, pixmap_gc, prompt_offset + 4, 4, 492);
-        i3string_free(input);
+    /* … and the text, glyph by glyph, so that it looks exactly like the text
+     * drawn by handle_glyph_appended() */
+    int x = 0;
+    for (int c = 0; c < input_position; c++) {
+        draw_glyph(c, x);
+        x += glyph_widths[c];
     }
 
     /* Copy the contents of the pixmap to the real window */
@@ -157,6 +192,41 @@ static int handle_expose(void *data, xcb_connection_t *conn, xcb_expose_event_t
     return 1;
 }
 
+/*
+ * Draws the glyph which was just appended to the input. Only the area of this
+ * glyph is copied to the window.
+ *
+ */
+static void handle_glyph_appended(void) {
+    int position = input_position - 1;
+    i3String *glyph = i3string_from_ucs2(&glyphs_ucs[position], 1);
+    glyph_widths[position] = predict_text_width(glyph);
+    i3string_free(glyph);
+
+    set_font_colors(pixmap_gc, get_colorpixel("#FFFFFF"), get_colorpixel("#000000"));
+    draw_glyph(position, input_width);
+    copy_input_area(input_width, glyph_widths[position]);
+    input_width += glyph_widths[position];
+}
+
+/*
+ * Clears the area of the glyph which was just removed from the input.
+ *
+ */
+static void handle_glyph_removed(void) {
+    input_width -= glyph_widths[input_position];
+
+    int x = prompt_offset + 4 + input_width;
+    if (x < 496) {
+        xcb_rectangle_t area = {x, 2, glyph_widths[input_position], font.height + 8 - 4};
+        if (area.x + area.width > 496)
+            area.width = 496 - area.x;
+        xcb_change_gc(conn, pixmap_gc, XCB_GC_FOREGROUND, (uint32_t[]){ get_colorpixel("#000000") });
+        xcb_poly_fill_rectangle(conn, pixmap, pixmap_gc, 1, &area);
+    }
+    copy_input_area(input_width, glyph_widths[input_position]);
+}
+
 /*
  * Deactivates the Mode_switch bit upon release of the Mode_switch key.
  *
@@ -260,7 +330,7 @@ static int handle_key_press(void *ignored, xcb_connection_t *conn, xcb_key_press
         input_position--;
         free(glyphs_utf8[input_position]);
 
-        handle_expose(NULL, conn, NULL);
+        handle_glyph_removed();
         return 1;
     }
     if (sym == XK_Escape) {
@@ -305,7 +375,7 @@ static int handle_key_press(void *ignored, xcb_connection_t *conn, xcb_key_press
     if (input_position == limit)
         finish_input();
 
-    handle_expose(NULL, conn, NULL);
+    handle_glyph_appended();
     return 1;
 }
 
@@ -377,7 +447,7 @@ int main(int argc, char *argv[]) {
         die("Cannot open display\n");
 
     if (socket_path == NULL)
-        socket_path = root_atom_contents("I3_SOCKET_PATH", conn, screen);
+        socket_path = get_socket_path(conn, screen);
 
     if (socket_path == NULL)
         socket_path = "/tmp/i3-ipc.sock";
@@ -390,22 +460,22 @@ int main(int argc, char *argv[]) {
     root_screen = xcb_aux_get_screen(conn, screen);
     root = root_screen->root;
 
+    /* This only sends the GetKeyboardMapping request, the reply is read when
+     * the first key is pressed. */
     symbols = xcb_key_symbols_alloc(conn);
 
-    font = load_font(pattern, true);
-    set_font(&font);
-
-    if (prompt != NULL)
-        prompt_offset = predict_text_width(prompt);
-
-    /* Open an input window */
+    /* Open an input window. Its height depends on the font, but loading the
+     * font needs a round trip to the X server. Therefore, the window is
+     * created with a preliminary height and resized once the font is loaded,
+     * so that the keyboard grab (which needs a mapped window) can already be
+     * processed by the X server in the meantime. */
     win = xcb_generate_id(conn);
     xcb_create_window(
         conn,
         XCB_COPY_FROM_PARENT,
         win, /* the window id */
         root, /* parent == root */
-        50, 50, 500, font.height + 8, /* dimensions */
+        50, 50, 500, 1, /* dimensions (the height is set below) */
         0, /* X11 border = 0, we draw our own */
         XCB_WINDOW_CLASS_INPUT_OUTPUT,
         XCB_WINDOW_CLASS_COPY_FROM_PARENT, /* copy visual from parent */
@@ -419,30 +489,41 @@ int main(int argc, char *argv[]) {
     /* Map the window (make it visible) */
     xcb_map_window(conn, win);
 
-    /* Create pixmap */
-    pixmap = xcb_generate_id(conn);
-    pixmap_gc = xcb_generate_id(conn);
-    xcb_create_pixmap(conn, root_screen->root_depth, pixmap, win, 500, font.height + 8);
-    xcb_create_gc(conn, pixmap_gc, pixmap, 0, 0);
-
     /* Set input focus (we have override_redirect=1, so the wm will not do
      * this for us) */
     xcb_set_input_focus(conn, XCB_INPUT_FOCUS_POINTER_ROOT, win, XCB_CURRENT_TIME);
 
-    /* Grab the keyboard to get all input */
+    /* Grab the keyboard to get all input. The reply is only read after
+     * loading the font. */
+    xcb_grab_keyboard_cookie_t cookie;
+    cookie = xcb_grab_keyboard(conn, false, win, XCB_CURRENT_TIME, XCB_GRAB_MODE_ASYNC, XCB_GRAB_MODE_ASYNC);
     xcb_flush(conn);
 
+    font = load_font(pattern, true);
+    set_font(&font);
+
+    if (prompt != NULL)
+        prompt_offset = predict_text_width(prompt);
+
+    xcb_configure_window(conn, win, XCB_CONFIG_WINDOW_HEIGHT, (uint32_t[]){ font.height + 8 });
+
+    /* Create pixmap */
+    pixmap = xcb_generate_id(conn);
+    pixmap_gc = xcb_generate_id(conn);
+    xcb_create_pixmap(conn, root_screen->root_depth, pixmap, win, 500, font.height + 8);
+    xcb_create_gc(conn, pixmap_gc, pixmap, 0, 0);
+
     /* Try (repeatedly, if necessary) to grab the keyboard. We might not
      * get the keyboard at the first attempt because of the keybinding
      * still being active when started via a wm’s keybinding. */
-    xcb_grab_keyboard_cookie_t cookie;
-    xcb_grab_keyboard_reply_t *reply = NULL;
+    xcb_grab_keyboard_reply_t *reply = xcb_grab_keyboard_reply(conn, cookie, NULL);
 
     int count = 0;
     while ((reply == NULL || reply->status != XCB_GRAB_STATUS_SUCCESS) && (count++ < 500)) {
+        free(reply);
+        usleep(1000);
         cookie = xcb_grab_keyboard(conn, false, win, XCB_CURRENT_TIME, XCB_GRAB_MODE_ASYNC, XCB_GRAB_MODE_ASYNC);
         reply = xcb_grab_keyboard_reply(conn, cookie, NULL);
-        usleep(1000);
     }
 
     if (reply->status != XCB_GRAB_STATUS_SUCCESS) {
@@ -132,23 +132,168 @@ yajl_callbacks reply_callbacks = {
     NULL
 };
 
+/*
+ * Connects to the given socket. Returns the file descriptor or -1 on error
+ * (with errno set).
+ *
+ */
+static int connect_to_i3(const char *path) {
+    int sockfd = socket(AF_LOCAL, SOCK_STREAM, 0);
+    if (sockfd == -1)
+        err(EXIT_FAILURE, "Could not create socket");
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(struct sockaddr_un));
+    addr.sun_family = AF_LOCAL;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+    if (connect(sockfd, (const struct sockaddr*)&addr, sizeof(struct sockaddr_un)) < 0) {
+        int saved_errno = errno;
+        close(sockfd);
+        errno = saved_errno;
+        return -1;
+    }
+    return sockfd;
+}
+
+/*
+ * Receives the reply to a message of the given type and prints it (unless
+ * quiet is set). The replies of commands are checked for errors, which are
+ * reported on stderr.
+ *
+ */
+static void handle_reply(int sockfd, uint32_t message_type, bool quiet) {
+    uint32_t reply_length;
+    uint32_t reply_type;
+    uint8_t *reply;
+    int ret;
+    if ((ret = ipc_recv_message(sockfd, &reply_type, &reply_length, &reply)) != 0) {
+        if (ret == -1)
+            err(EXIT_FAILURE, "IPC: read()");
+        exit(1);
+    }
+    if (reply_type != message_type)
+        errx(EXIT_FAILURE, "IPC: Received reply of type %d but expected %d", reply_type, message_type);
+    /* For the reply of commands, have a look if that command was successful.
+     * If not, nicely format the error message. */
+    if (reply_type == I3_IPC_MESSAGE_TYPE_COMMAND) {
+        yajl_handle handle;
+        memset(&last_reply, 0, sizeof(reply_t));
+#if YAJL_MAJOR < 2
+        yajl_parser_config parse_conf = { 0, 0 };
+
+        handle = yajl_alloc(&reply_callbacks, &parse_conf, NULL, NULL);
+#else
+        handle = yajl_alloc(&reply_callbacks, NULL, NULL);
+#endif
+        yajl_status state = yajl_parse(handle, (const unsigned char*)reply, reply_length);
+        switch (state) {
+            case yajl_status_ok:
+                break;
+            case yajl_status_client_canceled:
+#if YAJL_MAJOR < 2
+            case yajl_status_insufficient_data:
+#endif
+            case yajl_status_error:
+                errx(EXIT_FAILURE, "IPC: Could not parse JSON reply.");
+        }
+        yajl_free(handle);
+        free(last_reply.error);
+        free(last_reply.input);
+        free(last_reply.errorposition);
+
+        /* NB: We still fall-through and print the reply, because even if one
+         * command failed, that doesn’t mean that all commands failed. */
+    }
+    if (!quiet)
+        printf("%.*s\n", reply_length, reply);
+    free(reply);
+}
+
+/*
+ * Sends every line read from stdin as one message over the same connection
+ * and prints the replies in order.
+ *
+ */
+static void run_batch(int sockfd, uint32_t message_type, bool quiet) {
+    char *line = NULL;
+    size_t size = 0;
+    ssize_t length;
+    while ((length = getline(&line, &size, stdin)) != -1) {
+        if (length > 0 && line[length - 1] == '\n')
+            line[--length] = '\0';
+        if (length == 0)
+            continue;
+
+        if (ipc_send_message(sockfd, length, message_type, (uint8_t*)line) == -1)
+            err(EXIT_FAILURE, "IPC: write()");
+
+        /* The replies are read even when quiet, otherwise i3 would block
+         * once the socket buffer is full. */
+        handle_reply(sockfd, message_type, quiet);
+        fflush(stdout);
+    }
+    free(line);
+}
+
+/*
+ * Subscribes to the events given as payload (a JSON array like
+ * ["window","workspace"]) and prints every event as one line of JSON until
+ * i3 closes the connection.
+ *
+ */
+static void run_monitor(int sockfd, const char *payload) {
+    if (ipc_send_message(sockfd, strlen(payload), I3_IPC_MESSAGE_TYPE_SUBSCRIBE, (const uint8_t*)payload) == -1)
+        err(EXIT_FAILURE, "IPC: write()");
+
+    /* Events are read by other programs as they arrive, so don’t wait for a
+     * full buffer before writing them out. */
+    setvbuf(stdout, NULL, _IOLBF, 0);
+
+    uint32_t reply_length;
+    uint32_t reply_type;
+    uint8_t *reply;
+    int ret;
+    bool subscribed = false;
+    while ((ret = ipc_recv_message(sockfd, &reply_type, &reply_length, &reply)) == 0) {
+        if (!subscribed) {
+            if (reply_type != I3_IPC_REPLY_TYPE_SUBSCRIBE)
+                errx(EXIT_FAILURE, "IPC: Received reply of type %d but expected %d", reply_type, I3_IPC_REPLY_TYPE_SUBSCRIBE);
+            if (memmem(reply, reply_length, "\"success\":true", strlen("\"success\":true")) == NULL)
+                errx(EXIT_FAILURE, "Could not subscribe to %s: %.*s", payload, reply_length, reply);
+            subscribed = true;
+        } else {
+            printf("%.*s\n", reply_length, reply);
+        }
+        free(reply);
+    }
+
+    if (ret == -1)
+        err(EXIT_FAILURE, "IPC: read()");
+    /* i3 exited or restarted, let the caller reconnect if it wants to. */
+    exit(1);
+}
+
 int main(int argc, char *argv[]) {
     socket_path = getenv("I3SOCK");
     int o, option_index = 0;
     int message_type = I3_IPC_MESSAGE_TYPE_COMMAND;
     char *payload = NULL;
     bool quiet = false;
+    bool batch = false;
+    bool monitor = false;
 
     static struct option long_options[] = {
         {"socket", required_argument, 0, 's'},
         {"type", required_argument, 0, 't'},
         {"version", no_argument, 0, 'v'},
         {"quiet", no_argument, 0, 'q'},
+        {"batch", no_argument, 0, 'b'},
+        {"monitor", no_argument, 0, 'm'},
         {"help", no_argument, 0, 'h'},
         {0, 0, 0, 0}
     };
 
-    char *options_string = "s:t:vhq";
+    char *options_string = "s:t:vhqbm";
 
     while ((o = getopt_long(argc, argv, options_string, long_options, &option_index)) != -1) {
         if (o == 's') {
@@ -160,6 +305,8 @@ int main(int argc, char *argv[]) {
                 message_type = I3_IPC_MESSAGE_TYPE_COMMAND;
             else if (strcasecmp(optarg, "get_workspaces") == 0)
                 message_type = I3_IPC_MESSAGE_TYPE_GET_WORKSPACES;
+            else if (strcasecmp(optarg, "subscribe") == 0)
+                message_type = I3_IPC_MESSAGE_TYPE_SUBSCRIBE;
             else if (strcasecmp(optarg, "get_outputs") == 0)
                 message_type = I3_IPC_MESSAGE_TYPE_GET_OUTPUTS;
             else if (strcasecmp(optarg, "get_tree") == 0)
@@ -170,30 +317,59 @@ int main(int argc, char *argv[]) {
                 message_type = I3_IPC_MESSAGE_TYPE_GET_BAR_CONFIG;
             else if (strcasecmp(optarg, "get_version") == 0)
                 message_type = I3_IPC_MESSAGE_TYPE_GET_VERSION;
+            else if (strcasecmp(optarg, "get_tree_delta") == 0)
+                message_type = I3_IPC_MESSAGE_TYPE_GET_TREE_DELTA;
+            else if (strcasecmp(optarg, "get_pool_stats") == 0)
+                message_type = I3_IPC_MESSAGE_TYPE_GET_POOL_STATS;
+            else if (strcasecmp(optarg, "get_stats") == 0)
+                message_type = I3_IPC_MESSAGE_TYPE_GET_STATS;
+            else if (strcasecmp(optarg, "get_memory") == 0)
+                message_type = I3_IPC_MESSAGE_TYPE_GET_MEMORY;
             else {
                 printf("Unknown message type\n");
-                printf("Known types: command, get_workspaces, get_outputs, get_tree, get_marks, get_bar_config, get_version\n");
+                printf("Known types: command, get_workspaces, subscribe, get_outputs, get_tree, get_marks, get_bar_config, get_version, get_tree_delta, get_pool_stats, get_stats, get_memory\n");
                 exit(EXIT_FAILURE);
             }
         } else if (o == 'q') {
             quiet = true;
+        } else if (o == 'b') {
+            batch = true;
+        } else if (o == 'm') {
+            monitor = true;
         } else if (o == 'v') {
             printf("i3-msg " I3_VERSION "\n");
             return 0;
         } else if (o == 'h') {
             printf("i3-msg " I3_VERSION "\n");
             printf("i3-msg [-s <socket>] [-t <type>] <message>\n");
+            printf("i3-msg [-s <socket>] [-t <type>] --batch < messages\n");
+            printf("i3-msg [-s <socket>] -t subscribe -m <events>\n");
             return 0;
         }
     }
 
+    if (monitor && message_type != I3_IPC_MESSAGE_TYPE_SUBSCRIBE)
+        errx(EXIT_FAILURE, "--monitor can only be used with -t subscribe");
+    if (monitor && batch)
+        errx(EXIT_FAILURE, "--monitor and --batch cannot be combined");
+
     if (socket_path == NULL)
-        socket_path = root_atom_contents("I3_SOCKET_PATH", NULL, 0);
+        socket_path = get_socket_path(NULL, 0);
 
     /* Fall back to the default socket path */
     if (socket_path == NULL)
         socket_path = sstrdup("/tmp/i3-ipc.sock");
 
+    int sockfd = connect_to_i3(socket_path);
+    if (sockfd == -1)
+        err(EXIT_FAILURE, "Could not connect to i3 on socket \"%s\"", socket_path);
+
+    if (batch) {
+        run_batch(sockfd, message_type, quiet);
+        close(sockfd);
+        return 0;
+    }
+
     /* Use all arguments, separated by whitespace, as payload.
      * This way, you don’t have to do i3-msg 'mark foo', you can use
      * i3-msg mark foo */
@@ -213,16 +389,8 @@ int main(int argc, char *argv[]) {
     if (!payload)
         payload = "";
 
-    int sockfd = socket(AF_LOCAL, SOCK_STREAM, 0);
-    if (sockfd == -1)
-        err(EXIT_FAILURE, "Could not create socket");
-
-    struct sockaddr_un addr;
-    memset(&addr, 0, sizeof(struct sockaddr_un));
-    addr.sun_family = AF_LOCAL;
-    strncpy(addr.sun_path, socket_path, sizeof(addr.sun_path) - 1);
-    if (connect(sockfd, (const struct sockaddr*)&addr, sizeof(struct sockaddr_un)) < 0)
-        err(EXIT_FAILURE, "Could not connect to i3 on socket \"%s\"", socket_path);
+    if (monitor)
+        run_monitor(sockfd, payload);
 
     if (ipc_send_message(sockfd, strlen(payload), message_type, (uint8_t*)payload) == -1)
         err(EXIT_FAILURE, "IPC: write()");
@@ -230,45 +398,7 @@ int main(int argc, char *argv[]) {
     if (quiet)
         return 0;
 
-    uint32_t reply_length;
-    uint32_t reply_type;
-    uint8_t *reply;
-    int ret;
-    if ((ret = ipc_recv_message(sockfd, &reply_type, &reply_length, &reply)) != 0) {
-        if (ret == -1)
-            err(EXIT_FAILURE, "IPC: read()");
-        exit(1);
-    }
-    if (reply_type != message_type)
-        errx(EXIT_FAILURE, "IPC: Received reply of type %d but expected %d", reply_type, message_type);
-    /* For the reply of commands, have a look if that command was successful.
-     * If not, nicely format the error message. */
-    if (reply_type == I3_IPC_MESSAGE_TYPE_COMMAND) {
-        yajl_handle handle;
-#if YAJL_MAJOR < 2
-        yajl_parser_config parse_conf = { 0, 0 };
-
-        handle = yajl_alloc(&reply_callbacks, &parse_conf, NULL, NULL);
-#else
-        handle = yajl_alloc(&reply_callbacks, NULL, NULL);
-#endif
-        yajl_status state = yajl_parse(handle, (const unsigned char*)reply, reply_length);
-        switch (state) {
-            case yajl_status_ok:
-                break;
-            case yajl_status_client_canceled:
-#if YAJL_MAJOR < 2
-            case yajl_status_insufficient_data:
-#endif
-            case yajl_status_error:
-                errx(EXIT_FAILURE, "IPC: Could not parse JSON reply.");
-        }
-
-        /* NB: We still fall-through and print the reply, because even if one
-         * command failed, that doesn’t mean that all commands failed. */
-    }
-    printf("%.*s\n", reply_length, reply);
-    free(reply);
+    handle_reply(sockfd, message_type, false);
 
     close(sockfd);
 
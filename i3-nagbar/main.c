@@ -48,6 +48,10 @@ static i3Font font;
 static i3String *prompt;
 static button_t *buttons;
 static int buttoncnt;
+static char *pattern;
+static enum { TYPE_ERROR = 0, TYPE_WARNING = 1 } bar_type = TYPE_ERROR;
+/* Set by --preload, see read_args(). */
+static bool preload = false;
 
 /* Result of get_colorpixel() for the various colors. */
 static uint32_t color_background;        /* background of the bar */
@@ -284,45 +288,8 @@ static int handle_expose(xcb_connection_t *conn, xcb_expose_event_t *event) {
     return 1;
 }
 
-int main(int argc, char *argv[]) {
-    /* The following lines are a terribly horrible kludge. Because terminal
-     * emulators have different ways of interpreting the -e command line
-     * argument (some need -e "less /etc/fstab", others need -e less
-     * /etc/fstab), we need to write commands to a script and then just run
-     * that script. However, since on some machines, $XDG_RUNTIME_DIR and
-     * $TMPDIR are mounted with noexec, we cannot directly execute the script
-     * either.
-     *
-     * Initially, we tried to pass the command via the environment variable
-     * _I3_NAGBAR_CMD. But turns out that some terminal emulators such as
-     * xfce4-terminal run all windows from a single master process and only
-     * pass on the command (not the environment) to that master process.
-     *
-     * Therefore, we symlink i3-nagbar (which MUST reside on an executable
-     * filesystem) with a special name and run that symlink. When i3-nagbar
-     * recognizes it’s started as a binary ending in .nagbar_cmd, it strips off
-     * the .nagbar_cmd suffix and runs /bin/sh on argv[0]. That way, we can run
-     * a shell script on a noexec filesystem.
-     *
-     * From a security point of view, i3-nagbar is just an alias to /bin/sh in
-     * certain circumstances. This should not open any new security issues, I
-     * hope. */
-    char *cmd = NULL;
-    const size_t argv0_len = strlen(argv[0]);
-    if (argv0_len > strlen(".nagbar_cmd") &&
-        strcmp(argv[0] + argv0_len - strlen(".nagbar_cmd"), ".nagbar_cmd") == 0) {
-        unlink(argv[0]);
-        cmd = strdup(argv[0]);
-        *(cmd + argv0_len - strlen(".nagbar_cmd")) = '\0';
-        execl("/bin/sh", "/bin/sh", cmd, NULL);
-        err(EXIT_FAILURE, "execv(/bin/sh, /bin/sh, %s)", cmd);
-    }
-
-    argv0 = argv[0];
-
-    char *pattern = sstrdup("-misc-fixed-medium-r-normal--13-120-75-75-C-70-iso10646-1");
+static void parse_args(int argc, char *argv[]) {
     int o, option_index = 0;
-    enum { TYPE_ERROR = 0, TYPE_WARNING = 1 } bar_type = TYPE_ERROR;
 
     static struct option long_options[] = {
         {"version", no_argument, 0, 'v'},
@@ -331,18 +298,17 @@ int main(int argc, char *argv[]) {
         {"help", no_argument, 0, 'h'},
         {"message", required_argument, 0, 'm'},
         {"type", required_argument, 0, 't'},
+        {"preload", no_argument, 0, 'p'},
         {0, 0, 0, 0}
     };
 
-    char *options_string = "b:f:m:t:vh";
-
-    prompt = i3string_from_utf8("Please do not run this program.");
+    char *options_string = "b:f:m:t:vhp";
 
     while ((o = getopt_long(argc, argv, options_string, long_options, &option_index)) != -1) {
         switch (o) {
             case 'v':
                 printf("i3-nagbar " I3_VERSION);
-                return 0;
+                exit(EXIT_SUCCESS);
             case 'f':
                 FREE(pattern);
                 pattern = sstrdup(optarg);
@@ -354,10 +320,13 @@ int main(int argc, char *argv[]) {
             case 't':
                 bar_type = (strcasecmp(optarg, "warning") == 0 ? TYPE_WARNING : TYPE_ERROR);
                 break;
+            case 'p':
+                preload = true;
+                break;
             case 'h':
                 printf("i3-nagbar " I3_VERSION "\n");
                 printf("i3-nagbar [-m <message>] [-b <button> <action>] [-t warning|error] [-f <font>] [-v]\n");
-                return 0;
+                exit(EXIT_SUCCESS);
             case 'b':
                 buttons = realloc(buttons, sizeof(button_t) * (buttoncnt + 1));
                 buttons[buttoncnt].label = i3string_from_utf8(optarg);
@@ -372,6 +341,91 @@ int main(int argc, char *argv[]) {
                 break;
         }
     }
+}
+
+/*
+ * With --preload, i3 starts i3-nagbar before it is needed, so that the bar
+ * appears immediately when i3 wants to display a message. i3-nagbar then
+ * connects to X, loads the font and creates its (unmapped) window, and then
+ * reads the remaining arguments (separated by NUL bytes) from stdin.
+ *
+ * Exits when stdin is closed without any arguments, i.e. when i3 no longer
+ * needs this instance.
+ *
+ */
+static void read_args(void) {
+    char *buffer = NULL;
+    size_t size = 0, used = 0;
+    ssize_t n;
+    do {
+        if (used == size) {
+            size = (size == 0 ? 1024 : size * 2);
+            buffer = srealloc(buffer, size + 1);
+        }
+        n = read(STDIN_FILENO, buffer + used, size - used);
+        if (n > 0)
+            used += n;
+    } while (n > 0 || (n == -1 && errno == EINTR));
+
+    if (used == 0)
+        exit(EXIT_SUCCESS);
+    buffer[used] = '\0';
+
+    /* argv[0] is not part of the input. The buffer is not freed because the
+     * button actions point into it. */
+    int argc = 1;
+    char **argv = smalloc(sizeof(char*) * 2);
+    argv[0] = argv0;
+    for (char *walk = buffer; walk < buffer + used; walk += strlen(walk) + 1) {
+        argv = srealloc(argv, sizeof(char*) * (argc + 2));
+        argv[argc++] = walk;
+    }
+    argv[argc] = NULL;
+
+    optind = 1;
+    parse_args(argc, argv);
+}
+
+int main(int argc, char *argv[]) {
+    /* The following lines are a terribly horrible kludge. Because terminal
+     * emulators have different ways of interpreting the -e command line
+     * argument (some need -e "less /etc/fstab", others need -e less
+     * /etc/fstab), we need to write commands to a script and then just run
+     * that script. However, since on some machines, $XDG_RUNTIME_DIR and
+     * $TMPDIR are mounted with noexec, we cannot directly execute the script
+     * either.
+     *
+     * Initially, we tried to pass the command via the environment variable
+     * _I3_NAGBAR_CMD. But turns out that some terminal emulators such as
+     * xfce4-terminal run all windows from a single master process and only
+     * pass on the command (not the environment) to that master process.
+     *
+     * Therefore, we symlink i3-nagbar (which MUST reside on an executable
+     * filesystem) with a special name and run that symlink. When i3-nagbar
+     * recognizes it’s started as a binary ending in .nagbar_cmd, it strips off
+     * the .nagbar_cmd suffix and runs /bin/sh on argv[0]. That way, we can run
+     * a shell script on a noexec filesystem.
+     *
+     * From a security point of view, i3-nagbar is just an alias to /bin/sh in
+     * certain circumstances. This should not open any new security issues, I
+     * hope. */
+    char *cmd = NULL;
+    const size_t argv0_len = strlen(argv[0]);
+    if (argv0_len > strlen(".nagbar_cmd") &&
+        strcmp(argv[0] + argv0_len - strlen(".nagbar_cmd"), ".nagbar_cmd") == 0) {
+        unlink(argv[0]);
+        cmd = strdup(argv[0]);
+        *(cmd + argv0_len - strlen(".nagbar_cmd")) = '\0';
+        execl("/bin/sh", "/bin/sh", cmd, NULL);
+        err(EXIT_FAILURE, "execv(/bin/sh, /bin/sh, %s)", cmd);
+    }
+
+    argv0 = argv[0];
+
+    pattern = sstrdup("-misc-fixed-medium-r-normal--13-120-75-75-C-70-iso10646-1");
+    prompt = i3string_from_utf8("Please do not run this program.");
+
+    parse_args(argc, argv);
 
     int screens;
     if ((conn = xcb_connect(NULL, &screens)) == NULL ||
@@ -387,22 +441,6 @@ int main(int argc, char *argv[]) {
     root_screen = xcb_aux_get_screen(conn, screens);
     root = root_screen->root;
 
-    if (bar_type == TYPE_ERROR) {
-        /* Red theme for error messages */
-        color_button_background = get_colorpixel("#680a0a");
-        color_background = get_colorpixel("#900000");
-        color_text = get_colorpixel("#ffffff");
-        color_border = get_colorpixel("#d92424");
-        color_border_bottom = get_colorpixel("#470909");
-    } else {
-        /* Yellowish theme for warnings */
-        color_button_background = get_colorpixel("#ffc100");
-        color_background = get_colorpixel("#ffa8000");
-        color_text = get_colorpixel("#000000");
-        color_border = get_colorpixel("#ab7100");
-        color_border_bottom = get_colorpixel("#ab7100");
-    }
-
     font = load_font(pattern, true);
     set_font(&font);
 
@@ -427,9 +465,6 @@ int main(int argc, char *argv[]) {
             XCB_EVENT_MASK_BUTTON_RELEASE
         });
 
-    /* Map the window (make it visible) */
-    xcb_map_window(conn, win);
-
     /* Setup NetWM atoms */
     #define xmacro(name) \
         do { \
@@ -488,7 +523,29 @@ int main(int argc, char *argv[]) {
     xcb_create_pixmap(conn, root_screen->root_depth, pixmap, win, 500, font.height + 8);
     xcb_create_gc(conn, pixmap_gc, pixmap, 0, 0);
 
-    /* Grab the keyboard to get all input */
+    if (preload) {
+        xcb_flush(conn);
+        read_args();
+    }
+
+    if (bar_type == TYPE_ERROR) {
+        /* Red theme for error messages */
+        color_button_background = get_colorpixel("#680a0a");
+        color_background = get_colorpixel("#900000");
+        color_text = get_colorpixel("#ffffff");
+        color_border = get_colorpixel("#d92424");
+        color_border_bottom = get_colorpixel("#470909");
+    } else {
+        /* Yellowish theme for warnings */
+        color_button_background = get_colorpixel("#ffc100");
+        color_background = get_colorpixel("#ffa8000");
+        color_text = get_colorpixel("#000000");
+        color_border = get_colorpixel("#ab7100");
+        color_border_bottom = get_colorpixel("#ab7100");
+    }
+
+    /* Map the window (make it visible) */
+    xcb_map_window(conn, win);
     xcb_flush(conn);
 
     xcb_generic_event_t *event;
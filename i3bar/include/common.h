@@ -39,6 +39,9 @@ struct status_block {
     i3String *full_text;
 
     char *color;
+    /* The pixel value of color (if set), so that drawing the block does not
+     * need to parse it again. */
+    uint32_t color_pixel;
     uint32_t min_width;
     blockalign_t align;
 
@@ -54,6 +57,18 @@ struct status_block {
     uint32_t x_offset;
     uint32_t x_append;
 
+    /* The predicted width of full_text, if text_width_valid. Carried over
+     * from the previous status line when the text did not change. */
+    uint32_t text_width;
+    bool text_width_valid;
+
+    /* Whether the block is already drawn on the statusline pixmap, starting
+     * at drawn_x and spanning drawn_width pixels. Carried over from the
+     * previous status line when the block did not change. */
+    bool drawn;
+    uint32_t drawn_x;
+    uint32_t drawn_width;
+
     /* Optional */
     char *name;
     char *instance;
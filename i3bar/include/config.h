@@ -22,10 +22,17 @@ typedef struct config_t {
     int          modifier;
     position_t   position;
     int          verbose;
+    int          status_refresh_rate;
+    bool         client_side_rendering;
+    bool         glyph_cache;
     struct xcb_color_strings_t colors;
     bool         disable_binding_mode_indicator;
     bool         disable_ws;
+    /* The bars served by this process (see shared_i3bar). The first one
+     * provides the configuration, the others only add their outputs. */
     char         *bar_id;
+    int          num_bar_ids;
+    char         **bar_ids;
     char         *command;
     char         *fontname;
     char         *tray_output;
@@ -47,6 +54,13 @@ config_t config;
  */
 void parse_config_json(char *json);
 
+/**
+ * Parses only the outputs of the received bar configuration and adds them to
+ * the outputs of this bar (for the additional bar ids of a shared process).
+ *
+ */
+void parse_config_outputs_json(char *json);
+
 /**
  * free()s the color strings as soon as they are not needed anymore.
  *
@@ -47,10 +47,27 @@ struct i3_output {
     xcb_window_t   bar;           /* The id of the bar of the output */
     xcb_pixmap_t   buffer;        /* An extra pixmap for double-buffering */
     xcb_gcontext_t bargc;         /* The graphical context of the bar */
+    rect           bar_rect;      /* The geometry the bar (and its buffer) was
+                                     last configured with */
+    bool           override_redirect;
 
     struct ws_head *workspaces;   /* The workspaces on this output */
     struct tc_head *trayclients;  /* The tray clients on this output */
 
+    /* Damage tracking for draw_bars(): Which parts of the buffer have to be
+     * drawn again, where the buttons and the statusline are currently drawn
+     * in the buffer and which range of the buffer has to be copied to the
+     * bar window. */
+    bool           buffer_invalid;     /* The buffer was (re)created */
+    bool           buttons_damaged;    /* Workspace buttons and binding mode */
+    bool           statusline_damaged;
+    int            buttons_width;
+    int            statusline_src_x;
+    int            statusline_x;
+    int            statusline_width;
+    int            damage_x1;
+    int            damage_x2;
+
     SLIST_ENTRY(i3_output) slist; /* Pointer for the SLIST-Macro */
 };
 
@@ -4,6 +4,8 @@
  * i3bar - an xcb-based status- and ws-bar for i3
  * © 2010-2011 Axel Wagner and contributors (see also: LICENSE)
  *
+ * trayclients.c: Looking up tray clients by their window
+ *
  */
 #ifndef TRAYCLIENT_H_
 #define TRAYCLIENT_H_
@@ -18,8 +20,29 @@ struct trayclient {
     xcb_window_t       win;         /* The window ID of the tray client */
     bool               mapped;      /* Whether this window is mapped */
     int                xe_version;  /* The XEMBED version supported by the client */
+    struct i3_output   *output;     /* The output whose tray contains the client */
+    int                x;           /* The configured x position, -1 if not yet configured */
 
     TAILQ_ENTRY(trayclient) tailq;  /* Pointer for the TAILQ-Macro */
+    SLIST_ENTRY(trayclient) by_win; /* Pointer for the window index */
 };
 
+/*
+ * Adds the tray client to the index of tray clients by window.
+ *
+ */
+void trayclient_index_add(trayclient *client);
+
+/*
+ * Removes the tray client from the index of tray clients by window.
+ *
+ */
+void trayclient_index_remove(trayclient *client);
+
+/*
+ * Returns the tray client with the given window, or NULL.
+ *
+ */
+trayclient *trayclient_by_window(xcb_window_t win);
+
 #endif
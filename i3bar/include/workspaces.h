@@ -24,6 +24,14 @@ TAILQ_HEAD(ws_head, i3_ws);
  */
 void parse_workspaces_json(char *json);
 
+/*
+ * Updates the workspaces according to the given workspace event, if
+ * possible. This is the case for focus changes between existing workspaces.
+ * Returns false if the workspaces have to be requested.
+ *
+ */
+bool apply_workspace_event(char *json);
+
 /*
  * free() all workspace data-structures
  *
@@ -128,6 +128,13 @@ void draw_bars(bool force_unhide);
  */
 void redraw_bars(void);
 
+/*
+ * Marks the workspace buttons of all bars as changed, so that draw_bars()
+ * draws them again.
+ *
+ */
+void damage_workspace_buttons(void);
+
 /*
  * Set the current binding mode
  *
@@ -45,22 +45,81 @@ typedef struct parser_ctx {
     /* True if one of the parsed blocks was urgent */
     bool has_urgent;
 
-    /* A copy of the last JSON map key. */
-    char *last_map_key;
+    /* A copy of the last JSON map key. Longer keys are not used by the
+     * protocol and are stored as the empty string. */
+    char last_map_key[32];
 
     /* The current block. Will be filled, then copied and put into the list of
      * blocks. */
     struct status_block block;
+
+    /* The block at the same position in the previous status line. Strings of
+     * the current block which are equal to the ones of this block are not
+     * copied, but point to the strings of this block (see the SHARED_*
+     * flags), so that unchanged blocks can be taken over without any
+     * allocations. */
+    struct status_block *previous;
+    int shared;
 } parser_ctx;
 
+#define SHARED_FULL_TEXT (1 << 0)
+#define SHARED_COLOR (1 << 1)
+#define SHARED_NAME (1 << 2)
+#define SHARED_INSTANCE (1 << 3)
+
 parser_ctx parser_context;
 
 /* The buffer statusline points to */
 struct statusline_head statusline_head = TAILQ_HEAD_INITIALIZER(statusline_head);
 char *statusline_buffer = NULL;
 
+/* The blocks of the previous status line while parsing a new one, and the
+ * block at the position of the next parsed block. Blocks which did not change
+ * are not measured and drawn again. */
+static struct statusline_head old_statusline_head = TAILQ_HEAD_INITIALIZER(old_statusline_head);
+static struct status_block *old_block;
+
 int child_stdin;
 
+/* The buffer stdin is read into, kept between reads. One more byte than
+ * stdin_buffer_size is allocated, so that read_flat_input() can terminate
+ * the line. */
+static unsigned char *stdin_buffer;
+static int stdin_buffer_size;
+
+/* Redraws for new status lines are deferred until the end of the current
+ * event loop iteration and limited to config.status_refresh_rate per second,
+ * so that a burst of status lines is drawn only once. */
+static ev_prepare redraw_prepare;
+static ev_timer redraw_timer;
+static bool redraw_unhide;
+static ev_tstamp last_redraw;
+
+/* Click events which could not be written to the child yet. The pipe is
+ * non-blocking, so a slow status command only makes this queue grow instead
+ * of blocking the bar; the rest is written whenever the pipe becomes
+ * writable. */
+static ev_io stdout_io;
+static char *output_buffer;
+static size_t output_start;
+static size_t output_end;
+static size_t output_capacity;
+
+/* The last queued click event, as long as no part of it has been written.
+ * Another scroll event for the same block and button is dropped instead of
+ * being queued behind it. */
+static struct {
+    bool valid;
+    size_t offset;
+    int button;
+    char *name;
+    char *instance;
+} queued_click;
+
+/* A child which does not read its input at all must not make the bar use up
+ * all memory. */
+#define OUTPUT_QUEUE_LIMIT (64 * 1024)
+
 /*
  * Clears all blocks from the statusline structure in memory and frees their
  * associated resources.
@@ -70,6 +129,9 @@ static void clear_status_blocks() {
     while (!TAILQ_EMPTY(&statusline_head)) {
         first = TAILQ_FIRST(&statusline_head);
         I3STRING_FREE(first->full_text);
+        FREE(first->color);
+        FREE(first->name);
+        FREE(first->instance);
         TAILQ_REMOVE(&statusline_head, first, blocks);
         free(first);
     }
@@ -96,14 +158,16 @@ static void set_statusline_error(const char *format, ...) {
 
     struct status_block *err_block = scalloc(sizeof(struct status_block));
     err_block->full_text = i3string_from_utf8("Error: ");
-    err_block->name = "error";
-    err_block->color = "red";
+    err_block->name = sstrdup("error");
+    err_block->color = sstrdup("red");
+    err_block->color_pixel = get_colorpixel(err_block->color);
     err_block->no_separator = true;
 
     struct status_block *message_block = scalloc(sizeof(struct status_block));
     message_block->full_text = i3string_from_utf8(message);
-    message_block->name = "error_message";
-    message_block->color = "red";
+    message_block->name = sstrdup("error_message");
+    message_block->color = sstrdup("red");
+    message_block->color_pixel = get_colorpixel(message_block->color);
     message_block->no_separator = true;
 
     TAILQ_INSERT_HEAD(&statusline_head, err_block, blocks);
@@ -113,6 +177,12 @@ static void set_statusline_error(const char *format, ...) {
     va_end(args);
 }
 
+static void forget_queued_click(void) {
+    queued_click.valid = false;
+    FREE(queued_click.name);
+    FREE(queued_click.instance);
+}
+
 /*
  * Stop and free() the stdin- and sigchild-watchers
  *
@@ -122,6 +192,8 @@ void cleanup(void) {
         ev_io_stop(main_loop, stdin_io);
         FREE(stdin_io);
         FREE(statusline_buffer);
+        FREE(stdin_buffer);
+        stdin_buffer_size = 0;
         /* statusline pointed to memory within statusline_buffer */
         statusline = NULL;
     }
@@ -131,6 +203,15 @@ void cleanup(void) {
         FREE(child_sig);
     }
 
+    ev_prepare_stop(main_loop, &redraw_prepare);
+    ev_timer_stop(main_loop, &redraw_timer);
+    redraw_unhide = false;
+
+    ev_io_stop(main_loop, &stdout_io);
+    FREE(output_buffer);
+    output_start = output_end = output_capacity = 0;
+    forget_queued_click();
+
     memset(&child, 0, sizeof(i3bar_child));
 }
 
@@ -139,17 +220,66 @@ void cleanup(void) {
  * previous entries.
  *
  */
-static int stdin_start_array(void *context) {
+static void free_status_blocks(struct statusline_head *head) {
     struct status_block *first;
-    while (!TAILQ_EMPTY(&statusline_head)) {
-        first = TAILQ_FIRST(&statusline_head);
+    while (!TAILQ_EMPTY(head)) {
+        first = TAILQ_FIRST(head);
         I3STRING_FREE(first->full_text);
         FREE(first->color);
         FREE(first->name);
         FREE(first->instance);
-        TAILQ_REMOVE(&statusline_head, first, blocks);
+        TAILQ_REMOVE(head, first, blocks);
         free(first);
     }
+}
+
+static bool same_string(const char *a, const char *b) {
+    if (a == NULL || b == NULL)
+        return (a == b);
+    return (strcmp(a, b) == 0);
+}
+
+/*
+ * Takes over the cached width and drawing state of the corresponding block
+ * of the previous status line, as far as they are still valid.
+ *
+ */
+static void reuse_status_block(struct status_block *block, struct status_block *old) {
+    if (!i3string_equals(block->full_text, old->full_text))
+        return;
+
+    block->text_width = old->text_width;
+    block->text_width_valid = old->text_width_valid;
+
+    if (!same_string(block->color, old->color) ||
+        block->min_width != old->min_width ||
+        block->align != old->align ||
+        block->no_separator != old->no_separator ||
+        block->sep_block_width != old->sep_block_width)
+        return;
+
+    /* refresh_statusline() still draws the block if it moved. */
+    block->drawn = old->drawn;
+    block->drawn_x = old->drawn_x;
+    block->drawn_width = old->drawn_width;
+}
+
+/*
+ * The start of a new array is the start of a new status line, so we clear all
+ * previous entries. They are kept until the end of the new status line to
+ * compare the new blocks with.
+ *
+ */
+static int stdin_start_array(void *context) {
+    free_status_blocks(&old_statusline_head);
+
+    struct status_block *first;
+    while (!TAILQ_EMPTY(&statusline_head)) {
+        first = TAILQ_FIRST(&statusline_head);
+        TAILQ_REMOVE(&statusline_head, first, blocks);
+        TAILQ_INSERT_TAIL(&old_statusline_head, first, blocks);
+    }
+    old_block = TAILQ_FIRST(&old_statusline_head);
     return 1;
 }
 
@@ -160,6 +290,8 @@ static int stdin_start_array(void *context) {
 static int stdin_start_map(void *context) {
     parser_ctx *ctx = context;
     memset(&(ctx->block), '\0', sizeof(struct status_block));
+    ctx->previous = old_block;
+    ctx->shared = 0;
 
     /* Default width of the separator block. */
     ctx->block.sep_block_width = 9;
@@ -173,11 +305,37 @@ static int stdin_map_key(void *context, const unsigned char *key, size_t len) {
 static int stdin_map_key(void *context, const unsigned char *key, unsigned int len) {
 #endif
     parser_ctx *ctx = context;
-    FREE(ctx->last_map_key);
-    sasprintf(&(ctx->last_map_key), "%.*s", len, key);
+    if (len >= sizeof(ctx->last_map_key))
+        len = 0;
+    memcpy(ctx->last_map_key, key, len);
+    ctx->last_map_key[len] = '\0';
     return 1;
 }
 
+static bool equals_string(const char *str, const unsigned char *val, size_t len) {
+    return (str != NULL && strlen(str) == len && memcmp(str, val, len) == 0);
+}
+
+/*
+ * Sets *field to a copy of the given string, or to the equal string of the
+ * previous block (marking it as shared with the given flag).
+ *
+ */
+static void parse_string(parser_ctx *ctx, char **field, const char *previous, int flag,
+                         const unsigned char *val, size_t len) {
+    if (!(ctx->shared & flag))
+        FREE(*field);
+    if (equals_string(previous, val, len)) {
+        *field = (char *)previous;
+        ctx->shared |= flag;
+    } else {
+        *field = smalloc(len + 1);
+        memcpy(*field, val, len);
+        (*field)[len] = '\0';
+        ctx->shared &= ~flag;
+    }
+}
+
 static int stdin_boolean(void *context, int val) {
     parser_ctx *ctx = context;
     if (strcasecmp(ctx->last_map_key, "urgent") == 0) {
@@ -195,11 +353,23 @@ static int stdin_string(void *context, const unsigned char *val, size_t len) {
 static int stdin_string(void *context, const unsigned char *val, unsigned int len) {
 #endif
     parser_ctx *ctx = context;
+    struct status_block *previous = ctx->previous;
     if (strcasecmp(ctx->last_map_key, "full_text") == 0) {
-        ctx->block.full_text = i3string_from_utf8_with_length((const char *)val, len);
+        if (!(ctx->shared & SHARED_FULL_TEXT))
+            I3STRING_FREE(ctx->block.full_text);
+        if (previous != NULL &&
+            i3string_get_num_bytes(previous->full_text) == len &&
+            memcmp(i3string_as_utf8(previous->full_text), val, len) == 0) {
+            ctx->block.full_text = previous->full_text;
+            ctx->shared |= SHARED_FULL_TEXT;
+        } else {
+            ctx->block.full_text = i3string_from_utf8_with_length((const char *)val, len);
+            ctx->shared &= ~SHARED_FULL_TEXT;
+        }
     }
     if (strcasecmp(ctx->last_map_key, "color") == 0) {
-        sasprintf(&(ctx->block.color), "%.*s", len, val);
+        parse_string(ctx, &(ctx->block.color), (previous ? previous->color : NULL),
+                     SHARED_COLOR, val, len);
     }
     if (strcasecmp(ctx->last_map_key, "align") == 0) {
         if (len == strlen("left") && !strncmp((const char*)val, "left", strlen("left"))) {
@@ -215,16 +385,12 @@ static int stdin_string(void *context, const unsigned char *val, unsigned int le
         i3string_free(text);
     }
     if (strcasecmp(ctx->last_map_key, "name") == 0) {
-        char *copy = (char*)malloc(len+1);
-        strncpy(copy, (const char *)val, len);
-        copy[len] = 0;
-        ctx->block.name = copy;
+        parse_string(ctx, &(ctx->block.name), (previous ? previous->name : NULL),
+                     SHARED_NAME, val, len);
     }
     if (strcasecmp(ctx->last_map_key, "instance") == 0) {
-        char *copy = (char*)malloc(len+1);
-        strncpy(copy, (const char *)val, len);
-        copy[len] = 0;
-        ctx->block.instance = copy;
+        parse_string(ctx, &(ctx->block.instance), (previous ? previous->instance : NULL),
+                     SHARED_INSTANCE, val, len);
     }
     return 1;
 }
@@ -244,21 +410,102 @@ static int stdin_integer(void *context, long val) {
     return 1;
 }
 
+/*
+ * Returns the block of the previous status line with the same name and
+ * instance as the given block, preferring the one at the same position.
+ * Blocks without name and instance are only matched by position.
+ *
+ */
+static struct status_block *find_old_block(struct status_block *block, struct status_block *previous) {
+    if (previous != NULL &&
+        same_string(block->name, previous->name) &&
+        same_string(block->instance, previous->instance))
+        return previous;
+
+    if (block->name == NULL && block->instance == NULL)
+        return NULL;
+
+    struct status_block *current;
+    TAILQ_FOREACH(current, &old_statusline_head, blocks) {
+        if (same_string(block->name, current->name) &&
+            same_string(block->instance, current->instance))
+            return current;
+    }
+    return NULL;
+}
+
+/*
+ * Returns true if the parsed block is equal to the previous block at its
+ * position (which implies that all of its strings are shared).
+ *
+ */
+static bool unchanged_block(parser_ctx *ctx) {
+    struct status_block *block = &(ctx->block);
+    struct status_block *previous = ctx->previous;
+    return (previous != NULL &&
+            (ctx->shared & SHARED_FULL_TEXT) &&
+            ((ctx->shared & SHARED_COLOR) || (block->color == NULL && previous->color == NULL)) &&
+            ((ctx->shared & SHARED_NAME) || (block->name == NULL && previous->name == NULL)) &&
+            ((ctx->shared & SHARED_INSTANCE) || (block->instance == NULL && previous->instance == NULL)) &&
+            block->min_width == previous->min_width &&
+            block->align == previous->align &&
+            block->urgent == previous->urgent &&
+            block->no_separator == previous->no_separator &&
+            block->sep_block_width == previous->sep_block_width);
+}
+
 static int stdin_end_map(void *context) {
     parser_ctx *ctx = context;
+    struct status_block *previous = ctx->previous;
+    if (previous != NULL)
+        old_block = TAILQ_NEXT(previous, blocks);
+
+    if (ctx->block.urgent)
+        ctx->has_urgent = true;
+
+    /* Take over the previous block as a whole if nothing changed, which is
+     * the common case for most blocks of a status line. */
+    if (unchanged_block(ctx)) {
+        TAILQ_REMOVE(&old_statusline_head, previous, blocks);
+        TAILQ_INSERT_TAIL(&statusline_head, previous, blocks);
+        return 1;
+    }
+
+    /* A color which did not change does not need to be parsed again. */
+    if (ctx->shared & SHARED_COLOR)
+        ctx->block.color_pixel = previous->color_pixel;
+    else if (ctx->block.color != NULL)
+        ctx->block.color_pixel = get_colorpixel(ctx->block.color);
+
+    /* The previous block will be freed at the end of the status line, so
+     * shared strings have to be copied (or referenced) now. */
+    if (ctx->shared & SHARED_FULL_TEXT)
+        ctx->block.full_text = i3string_ref(ctx->block.full_text);
+    if (ctx->shared & SHARED_COLOR)
+        ctx->block.color = sstrdup(ctx->block.color);
+    if (ctx->shared & SHARED_NAME)
+        ctx->block.name = sstrdup(ctx->block.name);
+    if (ctx->shared & SHARED_INSTANCE)
+        ctx->block.instance = sstrdup(ctx->block.instance);
+    ctx->shared = 0;
+
     struct status_block *new_block = smalloc(sizeof(struct status_block));
     memcpy(new_block, &(ctx->block), sizeof(struct status_block));
     /* Ensure we have a full_text set, so that when it is missing (or null),
      * i3bar doesn’t crash and the user gets an annoying message. */
     if (!new_block->full_text)
         new_block->full_text = i3string_from_utf8("SPEC VIOLATION (null)");
-    if (new_block->urgent)
-        ctx->has_urgent = true;
+    struct status_block *old = find_old_block(new_block, previous);
+    if (old != NULL)
+        reuse_status_block(new_block, old);
     TAILQ_INSERT_TAIL(&statusline_head, new_block, blocks);
     return 1;
 }
 
 static int stdin_end_array(void *context) {
+    free_status_blocks(&old_statusline_head);
+    old_block = NULL;
+
     DLOG("dumping statusline:\n");
     struct status_block *current;
     TAILQ_FOREACH(current, &statusline_head, blocks) {
@@ -270,18 +517,20 @@ static int stdin_end_array(void *context) {
 }
 
 /*
- * Helper function to read stdin
+ * Helper function to read stdin. Returns stdin_buffer (which must not be
+ * freed) or NULL if nothing could be read.
  *
  */
 static unsigned char *get_buffer(ev_io *watcher, int *ret_buffer_len) {
     int fd = watcher->fd;
     int n = 0;
     int rec = 0;
-    int buffer_len = STDIN_CHUNK_SIZE;
-    unsigned char *buffer = smalloc(buffer_len+1);
-    buffer[0] = '\0';
+    if (stdin_buffer == NULL) {
+        stdin_buffer_size = STDIN_CHUNK_SIZE;
+        stdin_buffer = smalloc(stdin_buffer_size + 1);
+    }
     while(1) {
-        n = read(fd, buffer + rec, buffer_len - rec);
+        n = read(fd, stdin_buffer + rec, stdin_buffer_size - rec);
         if (n == -1) {
             if (errno == EAGAIN) {
                 /* finish up */
@@ -301,17 +550,17 @@ static unsigned char *get_buffer(ev_io *watcher, int *ret_buffer_len) {
         }
         rec += n;
 
-        if (rec == buffer_len) {
-            buffer_len += STDIN_CHUNK_SIZE;
-            buffer = srealloc(buffer, buffer_len);
+        if (rec == stdin_buffer_size) {
+            stdin_buffer_size *= 2;
+            stdin_buffer = srealloc(stdin_buffer, stdin_buffer_size + 1);
         }
     }
-    if (*buffer == '\0') {
-        FREE(buffer);
-        rec = -1;
+    if (rec == 0) {
+        *ret_buffer_len = -1;
+        return NULL;
     }
     *ret_buffer_len = rec;
-    return buffer;
+    return stdin_buffer;
 }
 
 static void read_flat_input(char *buffer, int length) {
@@ -324,6 +573,8 @@ static void read_flat_input(char *buffer, int length) {
         buffer[length-1] = '\0';
     else buffer[length] = '\0';
     first->full_text = i3string_from_utf8(buffer);
+    first->text_width_valid = false;
+    first->drawn = false;
 }
 
 static bool read_json_input(unsigned char *input, int length) {
@@ -352,6 +603,51 @@ static bool read_json_input(unsigned char *input, int length) {
     return has_urgent;
 }
 
+/*
+ * Draws the bars with the status lines which were received since the last
+ * redraw.
+ *
+ */
+static void redraw_statusline(void) {
+    bool unhide = redraw_unhide;
+
+    ev_prepare_stop(main_loop, &redraw_prepare);
+    ev_timer_stop(main_loop, &redraw_timer);
+    redraw_unhide = false;
+    last_redraw = ev_now(main_loop);
+    draw_bars(unhide);
+}
+
+static void redraw_prepare_cb(struct ev_loop *loop, ev_prepare *watcher, int revents) {
+    redraw_statusline();
+}
+
+static void redraw_timer_cb(struct ev_loop *loop, ev_timer *watcher, int revents) {
+    redraw_statusline();
+}
+
+/*
+ * Schedules a redraw for a new status line. Multiple status lines received
+ * before the redraw are only drawn once.
+ *
+ */
+static void schedule_redraw(bool unhide) {
+    redraw_unhide |= unhide;
+    if (ev_is_active(&redraw_prepare) || ev_is_active(&redraw_timer))
+        return;
+
+    if (config.status_refresh_rate > 0) {
+        ev_tstamp delay = last_redraw + 1.0 / config.status_refresh_rate - ev_now(main_loop);
+        if (delay > 0) {
+            ev_timer_set(&redraw_timer, delay, 0.);
+            ev_timer_start(main_loop, &redraw_timer);
+            return;
+        }
+    }
+
+    ev_prepare_start(main_loop, &redraw_prepare);
+}
+
 /*
  * Callbalk for stdin. We read a line from stdin and store the result
  * in statusline
@@ -368,8 +664,7 @@ void stdin_io_cb(struct ev_loop *loop, ev_io *watcher, int revents) {
     } else {
         read_flat_input((char*)buffer, rec);
     }
-    free(buffer);
-    draw_bars(has_urgent);
+    schedule_redraw(has_urgent);
 }
 
 /*
@@ -402,7 +697,6 @@ void stdin_io_first_line_cb(struct ev_loop *loop, ev_io *watcher, int revents) {
         TAILQ_INSERT_TAIL(&statusline_head, new_block, blocks);
         read_flat_input((char*)buffer, rec);
     }
-    free(buffer);
     ev_io_stop(main_loop, stdin_io);
     ev_io_init(stdin_io, &stdin_io_cb, STDIN_FILENO, EV_READ);
     ev_io_start(main_loop, stdin_io);
@@ -434,6 +728,41 @@ void child_sig_cb(struct ev_loop *loop, ev_child *watcher, int revents) {
     draw_bars(false);
 }
 
+/*
+ * Writes as much of the queued output to the child as the pipe takes without
+ * blocking. Watches the pipe for writability while anything is left.
+ *
+ */
+static void flush_output(void) {
+    while (output_start < output_end) {
+        ssize_t n = write(child_stdin, output_buffer + output_start, output_end - output_start);
+        if (n == -1) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+            ELOG("Could not write click event to the child: %s\n", strerror(errno));
+            output_start = output_end;
+            break;
+        }
+        output_start += n;
+    }
+
+    if (queued_click.valid && output_start > queued_click.offset)
+        forget_queued_click();
+
+    if (output_start == output_end) {
+        output_start = output_end = 0;
+        ev_io_stop(main_loop, &stdout_io);
+    } else if (!ev_is_active(&stdout_io)) {
+        ev_io_start(main_loop, &stdout_io);
+    }
+}
+
+static void stdout_io_cb(struct ev_loop *loop, ev_io *watcher, int revents) {
+    flush_output();
+}
+
 void child_write_output(void) {
     if (child.click_events) {
         const unsigned char *output;
@@ -443,9 +772,25 @@ void child_write_output(void) {
         size_t size;
 #endif
         yajl_gen_get_buf(gen, &output, &size);
-        write(child_stdin, output, size);
-        write(child_stdin, "\n", 1);
+
+        if (output_start > 0) {
+            memmove(output_buffer, output_buffer + output_start, output_end - output_start);
+            output_end -= output_start;
+            if (queued_click.valid)
+                queued_click.offset -= output_start;
+            output_start = 0;
+        }
+        if (output_end + size + 1 > output_capacity) {
+            while (output_end + size + 1 > output_capacity)
+                output_capacity = (output_capacity == 0 ? 1024 : output_capacity * 2);
+            output_buffer = srealloc(output_buffer, output_capacity);
+        }
+        memcpy(output_buffer + output_end, output, size);
+        output_end += size;
+        output_buffer[output_end++] = '\n';
         yajl_gen_clear(gen);
+
+        flush_output();
     }
 }
 
@@ -512,6 +857,7 @@ void start_child(char *command) {
 
                 dup2(pipe_in[0], STDIN_FILENO);
                 child_stdin = pipe_out[1];
+                fcntl(child_stdin, F_SETFL, O_NONBLOCK);
 
                 break;
         }
@@ -520,6 +866,9 @@ void start_child(char *command) {
     /* We set O_NONBLOCK because blocking is evil in event-driven software */
     fcntl(STDIN_FILENO, F_SETFL, O_NONBLOCK);
 
+    ev_prepare_init(&redraw_prepare, &redraw_prepare_cb);
+    ev_timer_init(&redraw_timer, &redraw_timer_cb, 0., 0.);
+
     stdin_io = smalloc(sizeof(ev_io));
     ev_io_init(stdin_io, &stdin_io_first_line_cb, STDIN_FILENO, EV_READ);
     ev_io_start(main_loop, stdin_io);
@@ -529,6 +878,8 @@ void start_child(char *command) {
     ev_child_init(child_sig, &child_sig_cb, child.pid, 0);
     ev_child_start(main_loop, child_sig);
 
+    ev_io_init(&stdout_io, &stdout_io_cb, child_stdin, EV_WRITE);
+
     atexit(kill_child_at_exit);
 }
 
@@ -552,6 +903,25 @@ void send_block_clicked(int button, const char *name, const char *instance, int
     if (child.click_events) {
         child_click_events_initialize();
 
+        /* Scroll events arrive much faster than status commands usually
+         * handle them. While the previous one is still queued, the child
+         * would only get to see the same event again. */
+        bool scroll = (button >= 4 && button <= 7);
+        if (scroll && queued_click.valid &&
+            queued_click.button == button &&
+            same_string(queued_click.name, name) &&
+            same_string(queued_click.instance, instance)) {
+            DLOG("Dropping scroll event, the previous one is not written yet\n");
+            return;
+        }
+
+        if (output_end - output_start > OUTPUT_QUEUE_LIMIT) {
+            ELOG("The child does not read click events, dropping one\n");
+            return;
+        }
+
+        size_t offset = output_end - output_start;
+
         yajl_gen_map_open(gen);
 
         if (name) {
@@ -575,6 +945,15 @@ void send_block_clicked(int button, const char *name, const char *instance, int
 
         yajl_gen_map_close(gen);
         child_write_output();
+
+        forget_queued_click();
+        if (output_start <= offset && offset < output_end) {
+            queued_click.valid = true;
+            queued_click.offset = offset;
+            queued_click.button = button;
+            queued_click.name = (name ? sstrdup(name) : NULL);
+            queued_click.instance = (instance ? sstrdup(instance) : NULL);
+        }
     }
 }
 
@@ -21,6 +21,9 @@
 
 static char *cur_key;
 
+/* Whether only the outputs are parsed, see parse_config_outputs_json(). */
+static bool outputs_only;
+
 /*
  * Parse a key.
  *
@@ -71,6 +74,9 @@ static int config_string_cb(void *params_, const unsigned char *val, unsigned in
     if (!strcmp(cur_key, "id") || !strcmp(cur_key, "socket_path"))
         return 1;
 
+    if (outputs_only && strcmp(cur_key, "outputs") != 0)
+        return 1;
+
     if (!strcmp(cur_key, "mode")) {
         DLOG("mode = %.*s, len = %d\n", len, val, len);
         config.hide_on_modifier = (len == 4 && !strncmp((const char*)val, "dock", strlen("dock")) ? M_DOCK
@@ -193,6 +199,9 @@ static int config_string_cb(void *params_, const unsigned char *val, unsigned in
  *
  */
 static int config_boolean_cb(void *params_, int val) {
+    if (outputs_only)
+        return 1;
+
     if (!strcmp(cur_key, "binding_mode_indicator")) {
         DLOG("binding_mode_indicator = %d\n", val);
         config.disable_binding_mode_indicator = !val;
@@ -211,6 +220,39 @@ static int config_boolean_cb(void *params_, int val) {
         return 1;
     }
 
+    if (!strcmp(cur_key, "client_side_rendering")) {
+        DLOG("client_side_rendering = %d\n", val);
+        config.client_side_rendering = val;
+        return 1;
+    }
+
+    if (!strcmp(cur_key, "glyph_cache")) {
+        DLOG("glyph_cache = %d\n", val);
+        config.glyph_cache = val;
+        return 1;
+    }
+
+    return 0;
+}
+
+/*
+ * Parse an integer value
+ *
+ */
+#if YAJL_MAJOR >= 2
+static int config_integer_cb(void *params_, long long val) {
+#else
+static int config_integer_cb(void *params_, long val) {
+#endif
+    if (outputs_only)
+        return 1;
+
+    if (!strcmp(cur_key, "status_refresh_rate")) {
+        DLOG("status_refresh_rate = %d\n", (int)val);
+        config.status_refresh_rate = (int)val;
+        return 1;
+    }
+
     return 0;
 }
 
@@ -218,7 +260,7 @@ static int config_boolean_cb(void *params_, int val) {
 static yajl_callbacks outputs_callbacks = {
     &config_null_cb,
     &config_boolean_cb,
-    NULL,
+    &config_integer_cb,
     NULL,
     NULL,
     &config_string_cb,
@@ -263,6 +305,17 @@ void parse_config_json(char *json) {
     yajl_free(handle);
 }
 
+/*
+ * Parses only the outputs of the received bar configuration and adds them to
+ * the outputs of this bar (for the additional bar ids of a shared process).
+ *
+ */
+void parse_config_outputs_json(char *json) {
+    outputs_only = true;
+    parse_config_json(json);
+    outputs_only = false;
+}
+
 /*
  * free()s the color strings as soon as they are not needed anymore.
  *
@@ -13,6 +13,8 @@
 #include <stdint.h>
 #include <string.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
 #include <sys/socket.h>
 #include <sys/un.h>
 #include <i3/ipc.h>
@@ -26,6 +28,29 @@ const char *sock_path;
 
 typedef void(*handler_t)(char*);
 
+/* Incoming data from i3, kept between wakeups */
+static ipc_recv_buffer input;
+
+/* Copy of the current message, terminated by a NUL byte for the handlers */
+static char *message;
+static size_t message_capacity;
+
+/* Whether we requested the workspaces and did not get the reply yet. */
+static bool workspaces_requested;
+
+/*
+ * Requests the workspaces, unless a request is still pending: i3 sends events
+ * and replies in order, so a pending reply already reflects all workspace
+ * events received until then.
+ *
+ */
+static void request_workspaces(void) {
+    if (workspaces_requested)
+        return;
+    workspaces_requested = true;
+    i3_send_msg(I3_IPC_MESSAGE_TYPE_GET_WORKSPACES, NULL);
+}
+
 /*
  * Called, when we get a reply to a command from i3.
  * Since i3 does not give us much feedback on commands, we do not much
@@ -41,6 +66,7 @@ void got_command_reply(char *reply) {
  */
 void got_workspace_reply(char *reply) {
     DLOG("Got Workspace-Data!\n");
+    workspaces_requested = false;
     parse_workspaces_json(reply);
     draw_bars(false);
 }
@@ -63,7 +89,6 @@ void got_output_reply(char *reply) {
     DLOG("Parsing Outputs-JSON...\n");
     parse_outputs_json(reply);
     DLOG("Reconfiguring Windows...\n");
-    realloc_sl_buffer();
     reconfig_windows(false);
 
     i3_output *o_walk;
@@ -80,6 +105,15 @@ void got_output_reply(char *reply) {
  */
 void got_bar_config(char *reply) {
     DLOG("Received bar config \"%s\"\n", reply);
+    /* The replies arrive in the order of the bar ids. Everything but the
+     * outputs is taken from the first bar, the others were only passed to
+     * this process because their configuration is the same. */
+    static int configs_received = 0;
+    if (configs_received++ > 0) {
+        parse_config_outputs_json(reply);
+        return;
+    }
+
     /* We initiate the main-function by requesting infos about the outputs and
      * workspaces. Everything else (creating the bars, showing the right workspace-
      * buttons and more) is taken care of by the event-drivenness of the code */
@@ -92,7 +126,7 @@ void got_bar_config(char *reply) {
      * events and request the workspaces if necessary. */
     subscribe_events();
     if (!config.disable_ws)
-        i3_send_msg(I3_IPC_MESSAGE_TYPE_GET_WORKSPACES, NULL);
+        request_workspaces();
 
     /* Initialize the rest of XCB */
     init_xcb_late(config.fontname);
@@ -124,7 +158,14 @@ handler_t reply_handlers[] = {
  */
 void got_workspace_event(char *event) {
     DLOG("Got Workspace Event!\n");
-    i3_send_msg(I3_IPC_MESSAGE_TYPE_GET_WORKSPACES, NULL);
+    /* Focus changes can be applied directly (unless a pending reply will
+     * replace the workspaces anyway), all other changes need the new list of
+     * workspaces. */
+    if (!workspaces_requested && apply_workspace_event(event)) {
+        draw_bars(false);
+        return;
+    }
+    request_workspaces();
 }
 
 /*
@@ -135,7 +176,7 @@ void got_output_event(char *event) {
     DLOG("Got Output Event!\n");
     i3_send_msg(I3_IPC_MESSAGE_TYPE_GET_OUTPUTS, NULL);
     if (!config.disable_ws) {
-        i3_send_msg(I3_IPC_MESSAGE_TYPE_GET_WORKSPACES, NULL);
+        request_workspaces();
     }
 }
 
@@ -155,19 +196,27 @@ void got_mode_event(char *event) {
  */
 void got_bar_config_update(char *event) {
     /* check whether this affect this bar instance by checking the bar_id */
-    char *expected_id;
-    sasprintf(&expected_id, "\"id\":\"%s\"", config.bar_id);
-    char *found_id = strstr(event, expected_id);
-    FREE(expected_id);
+    char *found_id = NULL;
+    for (int i = 0; i < config.num_bar_ids && found_id == NULL; i++) {
+        char *expected_id;
+        sasprintf(&expected_id, "\"id\":\"%s\"", config.bar_ids[i]);
+        found_id = strstr(event, expected_id);
+        FREE(expected_id);
+    }
     if (found_id == NULL)
        return;
 
     /* update the configuration with the received settings */
     DLOG("Received bar config update \"%s\"\n", event);
     int old_mode = config.hide_on_modifier;
+    int old_hidden_state = config.hidden_state;
     parse_config_json(event);
     if (old_mode != config.hide_on_modifier) {
         reconfig_windows(true);
+    } else if (old_hidden_state == config.hidden_state) {
+        /* i3 sends an update for every bar whenever any bar changed. */
+        DLOG("Nothing changed for this bar\n");
+        return;
     }
 
     draw_bars(false);
@@ -183,81 +232,52 @@ handler_t event_handlers[] = {
 };
 
 /*
- * Called, when we get a message from i3
+ * Called, when we get a message from i3. Handles all complete messages which
+ * are available, so that bursts of events are handled in one pass.
  *
  */
 void got_data(struct ev_loop *loop, ev_io *watcher, int events) {
     DLOG("Got data!\n");
     int fd = watcher->fd;
 
-    /* First we only read the header, because we know its length */
-    uint32_t header_len = strlen(I3_IPC_MAGIC) + sizeof(uint32_t)*2;
-    char *header = smalloc(header_len);
-
-    /* We first parse the fixed-length IPC-header, to know, how much data
-     * we have to expect */
-    uint32_t rec = 0;
-    while (rec < header_len) {
-        int n = read(fd, header + rec, header_len - rec);
-        if (n == -1) {
-            ELOG("read() failed: %s\n", strerror(errno));
-            exit(EXIT_FAILURE);
-        }
-        if (n == 0) {
+    while (true) {
+        uint32_t type;
+        uint32_t size;
+        uint8_t *payload;
+        int ret = ipc_recv_message_buffered(fd, &input, &type, &size, &payload);
+        if (ret == 1)
+            return;
+        if (ret == -2) {
             /* EOF received. Since i3 will restart i3bar instances as appropriate,
              * we exit here. */
             DLOG("EOF received, exiting...\n");
             clean_xcb();
             exit(EXIT_SUCCESS);
         }
-        rec += n;
-    }
-
-    if (strncmp(header, I3_IPC_MAGIC, strlen(I3_IPC_MAGIC))) {
-        ELOG("Wrong magic code: %.*s\n Expected: %s\n",
-             (int) strlen(I3_IPC_MAGIC),
-             header,
-             I3_IPC_MAGIC);
-        exit(EXIT_FAILURE);
-    }
-
-    char *walk = header + strlen(I3_IPC_MAGIC);
-    uint32_t size;
-    memcpy(&size, (uint32_t*)walk, sizeof(uint32_t));
-    walk += sizeof(uint32_t);
-    uint32_t type;
-    memcpy(&type, (uint32_t*)walk, sizeof(uint32_t));
-
-    /* Now that we know, what to expect, we can start read()ing the rest
-     * of the message */
-    char *buffer = smalloc(size + 1);
-    rec = 0;
-
-    while (rec < size) {
-        int n = read(fd, buffer + rec, size - rec);
-        if (n == -1) {
-            ELOG("read() failed: %s\n", strerror(errno));
+        if (ret != 0) {
+            ELOG("Could not read message from i3 (%d): %s\n", ret, strerror(errno));
             exit(EXIT_FAILURE);
         }
-        if (n == 0) {
-            ELOG("Nothing to read!\n");
-            exit(EXIT_FAILURE);
-        }
-        rec += n;
-    }
-    buffer[size] = '\0';
 
-    /* And call the callback (indexed by the type) */
-    if (type & (1 << 31)) {
-        type ^= 1 << 31;
-        event_handlers[type](buffer);
-    } else {
-        if (reply_handlers[type])
-            reply_handlers[type](buffer);
+        /* The payload points into the input buffer and is not terminated,
+         * so we copy it for the handlers. */
+        if (size + 1 > message_capacity) {
+            message_capacity = size + 1;
+            message = srealloc(message, message_capacity);
+        }
+        memcpy(message, payload, size);
+        message[size] = '\0';
+
+        /* And call the callback (indexed by the type) */
+        if (type & (1 << 31)) {
+            type ^= 1 << 31;
+            if (type < sizeof(event_handlers) / sizeof(handler_t) && event_handlers[type])
+                event_handlers[type](message);
+        } else {
+            if (type < sizeof(reply_handlers) / sizeof(handler_t) && reply_handlers[type])
+                reply_handlers[type](message);
+        }
     }
-
-    FREE(header);
-    FREE(buffer);
 }
 
 /*
@@ -293,6 +313,13 @@ int i3_send_msg(uint32_t type, const char *payload) {
 
     while (to_write > 0) {
         int n = write(i3_connection->fd, buffer + written, to_write);
+        if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+            /* The socket is non-blocking for reading, so we wait until i3
+             * read enough of what we sent before. */
+            struct pollfd pfd = { .fd = i3_connection->fd, .events = POLLOUT };
+            poll(&pfd, 1, -1);
+            continue;
+        }
         if (n == -1) {
             ELOG("write() failed: %s\n", strerror(errno));
             exit(EXIT_FAILURE);
@@ -315,6 +342,8 @@ int i3_send_msg(uint32_t type, const char *payload) {
 int init_connection(const char *socket_path) {
     sock_path = socket_path;
     int sockfd = ipc_connect(socket_path);
+    /* Messages are read incrementally by got_data(). */
+    fcntl(sockfd, F_SETFL, O_NONBLOCK);
     i3_connection = smalloc(sizeof(ev_io));
     ev_io_init(i3_connection, &got_data, sockfd, EV_READ);
     ev_io_start(main_loop, i3_connection);
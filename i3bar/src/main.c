@@ -59,6 +59,8 @@ void print_usage(char *elf_name) {
     printf("Usage: %s -b bar_id [-s sock_path] [-h] [-v]\n", elf_name);
     printf("\n");
     printf("-b, --bar_id  <bar_id>\tBar ID for which to get the configuration\n");
+    printf("              \tCan be passed several times, the outputs of the\n");
+    printf("              \tfurther bars are added to the first one\n");
     printf("-s, --socket  <sock_path>\tConnect to i3 via <sock_path>\n");
     printf("-h, --help    Display this help-message and exit\n");
     printf("-v, --version Display version number and exit\n");
@@ -116,7 +118,12 @@ int main(int argc, char **argv) {
                 exit(EXIT_SUCCESS);
                 break;
             case 'b':
-                config.bar_id = sstrdup(optarg);
+                /* Passed several times when one process serves multiple
+                 * bars (see shared_i3bar). */
+                config.bar_ids = srealloc(config.bar_ids, (config.num_bar_ids + 1) * sizeof(char*));
+                config.bar_ids[config.num_bar_ids++] = sstrdup(optarg);
+                if (!config.bar_id)
+                    config.bar_id = config.bar_ids[0];
                 break;
             default:
                 print_usage(argv[0]);
@@ -147,8 +154,10 @@ int main(int argc, char **argv) {
 
     init_outputs();
     if (init_connection(socket_path)) {
-        /* Request the bar configuration. When it arrives, we fill the config array. */
-        i3_send_msg(I3_IPC_MESSAGE_TYPE_GET_BAR_CONFIG, config.bar_id);
+        /* Request the bar configurations. When they arrive, we fill the config
+         * array. */
+        for (int i = 0; i < config.num_bar_ids; i++)
+            i3_send_msg(I3_IPC_MESSAGE_TYPE_GET_BAR_CONFIG, config.bar_ids[i]);
     }
 
     /* We listen to SIGTERM/QUIT/INT and try to exit cleanly, by stopping the main-loop.
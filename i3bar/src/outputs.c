@@ -155,11 +155,12 @@ static int outputs_start_map_cb(void *params_) {
     i3_output *new_output = NULL;
 
     if (params->cur_key == NULL) {
-        new_output = smalloc(sizeof(i3_output));
+        new_output = scalloc(sizeof(i3_output));
         new_output->name = NULL;
         new_output->ws = 0,
         memset(&new_output->rect, 0, sizeof(rect));
         new_output->bar = XCB_NONE;
+        new_output->buffer_invalid = true;
 
         new_output->workspaces = smalloc(sizeof(struct ws_head));
         TAILQ_INIT(new_output->workspaces);
@@ -0,0 +1,55 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3bar - an xcb-based status- and ws-bar for i3
+ * © 2010-2012 Axel Wagner and contributors (see also: LICENSE)
+ *
+ * trayclients.c: Looking up tray clients by their window
+ *
+ * Events for tray clients (MapNotify, PropertyNotify, …) only carry the
+ * window, so the tray clients of all outputs are indexed by their window in a
+ * small hash table.
+ *
+ */
+#include <stdlib.h>
+
+#include "common.h"
+
+#define TRAYCLIENT_BUCKETS 64
+
+static SLIST_HEAD(tc_bucket, trayclient) buckets[TRAYCLIENT_BUCKETS];
+
+static struct tc_bucket *bucket_for(xcb_window_t win) {
+    /* X11 assigns the window IDs of a client sequentially, so the lower bits
+     * are good enough, mixed with the resource base of the client. */
+    return &buckets[(win ^ (win >> 21)) % TRAYCLIENT_BUCKETS];
+}
+
+/*
+ * Adds the tray client to the index of tray clients by window.
+ *
+ */
+void trayclient_index_add(trayclient *client) {
+    SLIST_INSERT_HEAD(bucket_for(client->win), client, by_win);
+}
+
+/*
+ * Removes the tray client from the index of tray clients by window.
+ *
+ */
+void trayclient_index_remove(trayclient *client) {
+    SLIST_REMOVE(bucket_for(client->win), client, trayclient, by_win);
+}
+
+/*
+ * Returns the tray client with the given window, or NULL.
+ *
+ */
+trayclient *trayclient_by_window(xcb_window_t win) {
+    trayclient *client;
+    SLIST_FOREACH(client, bucket_for(win), by_win) {
+        if (client->win == win)
+            return client;
+    }
+    return NULL;
+}
@@ -24,6 +24,33 @@ struct workspaces_json_params {
     char           *json;
 };
 
+/* The workspaces before the current GET_WORKSPACES reply. The names (and
+ * their rendered width) of workspaces which still exist are taken over, so
+ * that only new or renamed workspaces have to be measured. */
+static struct ws_head old_workspaces = TAILQ_HEAD_INITIALIZER(old_workspaces);
+
+/*
+ * Moves the i3String of the previous workspace with the given name (and its
+ * rendered width) to the given workspace. Returns false if there is no such
+ * workspace.
+ *
+ */
+static bool reuse_workspace_name(i3_ws *ws, const unsigned char *name, size_t len) {
+    i3_ws *old;
+    TAILQ_FOREACH(old, &old_workspaces, tailq) {
+        if (old->name == NULL ||
+            i3string_get_num_bytes(old->name) != len ||
+            memcmp(i3string_as_utf8(old->name), name, len) != 0)
+            continue;
+
+        ws->name = old->name;
+        ws->name_width = old->name_width;
+        old->name = NULL;
+        return true;
+    }
+    return false;
+}
+
 /*
  * Parse a boolean value (visible, focused, urgent)
  *
@@ -113,12 +140,14 @@ static int workspaces_string_cb(void *params_, const unsigned char *val, unsigne
         char *output_name;
 
         if (!strcmp(params->cur_key, "name")) {
-            /* Save the name */
-            params->workspaces_walk->name = i3string_from_utf8_with_length((const char *)val, len);
+            if (!reuse_workspace_name(params->workspaces_walk, val, len)) {
+                /* Save the name */
+                params->workspaces_walk->name = i3string_from_utf8_with_length((const char *)val, len);
 
-            /* Save its rendered width */
-            params->workspaces_walk->name_width =
-                predict_text_width(params->workspaces_walk->name);
+                /* Save its rendered width */
+                params->workspaces_walk->name_width =
+                    predict_text_width(params->workspaces_walk->name);
+            }
 
             DLOG("Got Workspace %s, name_width: %d, glyphs: %zu\n",
                  i3string_as_utf8(params->workspaces_walk->name),
@@ -221,7 +250,19 @@ void parse_workspaces_json(char *json) {
      * JSON in chunks */
     struct workspaces_json_params params;
 
-    free_workspaces();
+    /* Keep the current workspaces until the reply is parsed. */
+    i3_output *outputs_walk;
+    if (outputs != NULL) {
+        SLIST_FOREACH(outputs_walk, outputs, slist) {
+            if (outputs_walk->workspaces == NULL)
+                continue;
+            while (!TAILQ_EMPTY(outputs_walk->workspaces)) {
+                i3_ws *ws = TAILQ_FIRST(outputs_walk->workspaces);
+                TAILQ_REMOVE(outputs_walk->workspaces, ws, tailq);
+                TAILQ_INSERT_TAIL(&old_workspaces, ws, tailq);
+            }
+        }
+    }
 
     params.workspaces_walk = NULL;
     params.cur_key = NULL;
@@ -256,6 +297,138 @@ void parse_workspaces_json(char *json) {
     yajl_free(handle);
 
     FREE(params.cur_key);
+
+    while (!TAILQ_EMPTY(&old_workspaces)) {
+        i3_ws *ws = TAILQ_FIRST(&old_workspaces);
+        TAILQ_REMOVE(&old_workspaces, ws, tailq);
+        I3STRING_FREE(ws->name);
+        free(ws);
+    }
+
+    damage_workspace_buttons();
+}
+
+/* State for parsing a workspace event */
+struct workspace_event_params {
+    int depth;
+    /* Whether the map at depth 2 is the "current" workspace */
+    bool in_current;
+    char cur_key[16];
+    bool focus_change;
+    char *current_name;
+};
+
+static int workspace_event_start_map_cb(void *params_) {
+    struct workspace_event_params *params = params_;
+    if (params->depth == 1)
+        params->in_current = !strcmp(params->cur_key, "current");
+    params->depth++;
+    return 1;
+}
+
+static int workspace_event_end_map_cb(void *params_) {
+    struct workspace_event_params *params = params_;
+    params->depth--;
+    return 1;
+}
+
+#if YAJL_MAJOR >= 2
+static int workspace_event_map_key_cb(void *params_, const unsigned char *keyVal, size_t keyLen) {
+#else
+static int workspace_event_map_key_cb(void *params_, const unsigned char *keyVal, unsigned int keyLen) {
+#endif
+    struct workspace_event_params *params = params_;
+    if (keyLen >= sizeof(params->cur_key))
+        keyLen = 0;
+    memcpy(params->cur_key, keyVal, keyLen);
+    params->cur_key[keyLen] = '\0';
+    return 1;
+}
+
+#if YAJL_MAJOR >= 2
+static int workspace_event_string_cb(void *params_, const unsigned char *val, size_t len) {
+#else
+static int workspace_event_string_cb(void *params_, const unsigned char *val, unsigned int len) {
+#endif
+    struct workspace_event_params *params = params_;
+    if (params->depth == 1 && !strcmp(params->cur_key, "change"))
+        params->focus_change = (len == strlen("focus") && !strncmp((const char*)val, "focus", len));
+    else if (params->depth == 2 && params->in_current && !strcmp(params->cur_key, "name")) {
+        FREE(params->current_name);
+        sasprintf(&(params->current_name), "%.*s", (int)len, val);
+    }
+    return 1;
+}
+
+static yajl_callbacks workspace_event_callbacks = {
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    &workspace_event_string_cb,
+    &workspace_event_start_map_cb,
+    &workspace_event_map_key_cb,
+    &workspace_event_end_map_cb,
+    NULL,
+    NULL
+};
+
+/*
+ * Updates the workspaces according to the given workspace event, if
+ * possible. This is the case for focus changes between existing workspaces:
+ * The "current" workspace of the event is the focused one and the visible one
+ * on its output. Returns false if the workspaces have to be requested.
+ *
+ */
+bool apply_workspace_event(char *json) {
+    struct workspace_event_params params;
+    memset(&params, 0, sizeof(params));
+
+    yajl_handle handle;
+#if YAJL_MAJOR < 2
+    yajl_parser_config parse_conf = { 0, 0 };
+
+    handle = yajl_alloc(&workspace_event_callbacks, &parse_conf, NULL, (void*) &params);
+#else
+    handle = yajl_alloc(&workspace_event_callbacks, NULL, (void*) &params);
+#endif
+
+    yajl_status state = yajl_parse(handle, (const unsigned char*) json, strlen(json));
+    yajl_free(handle);
+
+    i3_ws *current = NULL;
+    i3_output *outputs_walk;
+    i3_ws *ws_walk;
+    if (state == yajl_status_ok && params.focus_change && params.current_name != NULL && outputs != NULL) {
+        SLIST_FOREACH(outputs_walk, outputs, slist) {
+            if (outputs_walk->workspaces == NULL)
+                continue;
+            TAILQ_FOREACH(ws_walk, outputs_walk->workspaces, tailq) {
+                if (ws_walk->name != NULL && !strcmp(i3string_as_utf8(ws_walk->name), params.current_name))
+                    current = ws_walk;
+            }
+        }
+    }
+    FREE(params.current_name);
+
+    if (current == NULL)
+        return false;
+
+    DLOG("Focus moved to workspace %s\n", i3string_as_utf8(current->name));
+    SLIST_FOREACH(outputs_walk, outputs, slist) {
+        if (outputs_walk->workspaces == NULL)
+            continue;
+        TAILQ_FOREACH(ws_walk, outputs_walk->workspaces, tailq) {
+            bool focused = (ws_walk == current);
+            bool visible = (outputs_walk == current->output ? focused : ws_walk->visible);
+            if (ws_walk->focused != focused || ws_walk->visible != visible)
+                outputs_walk->buttons_damaged = true;
+            ws_walk->focused = focused;
+            ws_walk->visible = visible;
+        }
+    }
+    return true;
 }
 
 /*
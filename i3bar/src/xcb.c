@@ -73,6 +73,28 @@ xcb_gcontext_t   statusline_ctx;
 xcb_gcontext_t   statusline_clear;
 xcb_pixmap_t     statusline_pm;
 uint32_t         statusline_width;
+/* Whether the statusline pixmap has to be cleared and all blocks drawn again */
+static bool      statusline_invalid = true;
+
+/* Whether the bars are unmapped because the modifier is not pressed (in hide
+ * mode). Hidden bars are drawn when they are shown again. */
+static bool      bars_hidden = false;
+
+static void draw_damaged_bars(void);
+static void free_ws_buttons(void);
+
+#if PANGO_SUPPORT
+/* With client-side rendering, the statusline is rendered into an image
+ * surface, and only the changed parts are uploaded to statusline_pm (instead
+ * of sending every drawing operation to the X server). */
+static bool             client_side_rendering = false;
+static cairo_surface_t *statusline_surface;
+static cairo_t         *statusline_cr;
+
+/* Buffer for uploading parts of statusline_surface */
+static uint8_t         *upload_buffer;
+static size_t           upload_buffer_size;
+#endif
 
 /* Event-Watchers, to interact with the user */
 ev_prepare *xcb_prep;
@@ -86,6 +108,34 @@ static mode binding;
 /* Indicates whether a new binding mode was recently activated */
 bool activated_mode = false;
 
+/* The colors a workspace button can be drawn with */
+typedef enum {
+    WS_INACTIVE = 0,
+    WS_ACTIVE,
+    WS_FOCUSED,
+    WS_URGENT
+} ws_state_t;
+
+/* A rendered workspace button. Buttons which look the same are drawn only
+ * once and copied to the buffers of all outputs, so that rearranging the
+ * workspaces (or switching between them) does not render their names
+ * again. */
+struct ws_button {
+    char *name;
+    ws_state_t state;
+    int width;
+    xcb_pixmap_t pixmap;
+
+    TAILQ_ENTRY(ws_button) buttons;
+};
+
+/* The cached buttons, most recently used first. Only the least recently used
+ * buttons are dropped when the cache is full, so that the buttons of all
+ * existing workspaces stay cached in practice. */
+static TAILQ_HEAD(ws_buttons_head, ws_button) ws_buttons = TAILQ_HEAD_INITIALIZER(ws_buttons);
+static int ws_buttons_num = 0;
+#define WS_BUTTONS_MAX 64
+
 /* The parsed colors */
 struct xcb_colors_t {
     uint32_t bar_fg;
@@ -117,6 +167,116 @@ int _xcb_request_failed(xcb_void_cookie_t cookie, char *err_msg, int line) {
     return 0;
 }
 
+#if PANGO_SUPPORT
+/*
+ * Returns true if the pixels of a CAIRO_FORMAT_RGB24 image surface can be
+ * uploaded to a pixmap of the root window’s depth as they are.
+ *
+ */
+static bool image_format_supported(void) {
+    const xcb_setup_t *setup = xcb_get_setup(xcb_connection);
+    if (root_screen->root_depth != 24)
+        return false;
+
+    bool bpp_supported = false;
+    xcb_format_iterator_t formats = xcb_setup_pixmap_formats_iterator(setup);
+    for (; formats.rem; xcb_format_next(&formats)) {
+        if (formats.data->depth == 24 && formats.data->bits_per_pixel == 32)
+            bpp_supported = true;
+    }
+
+    /* cairo stores the pixels in native byte order. */
+    const uint16_t one = 1;
+    uint8_t native_order = (*(const uint8_t *)&one == 1 ? XCB_IMAGE_ORDER_LSB_FIRST : XCB_IMAGE_ORDER_MSB_FIRST);
+
+    xcb_visualtype_t *visual = get_visualtype(root_screen);
+    return (bpp_supported &&
+            setup->image_byte_order == native_order &&
+            visual != NULL &&
+            visual->red_mask == 0xff0000 &&
+            visual->green_mask == 0x00ff00 &&
+            visual->blue_mask == 0x0000ff);
+}
+
+/*
+ * Enables client-side rendering of the statusline if configured and
+ * possible.
+ *
+ */
+static void init_client_side_rendering(void) {
+    if (!config.client_side_rendering)
+        return;
+
+    if (font.type != FONT_TYPE_PANGO) {
+        ELOG("Client-side rendering needs a Pango font, disabling it.\n");
+        return;
+    }
+    if (!image_format_supported()) {
+        ELOG("The X server’s image format is not supported for client-side rendering, disabling it.\n");
+        return;
+    }
+    DLOG("Rendering the statusline client-side\n");
+    client_side_rendering = true;
+}
+
+/*
+ * Frees the image surface of the statusline, it is created again with the
+ * new size by refresh_statusline().
+ *
+ */
+static void free_statusline_surface(void) {
+    if (statusline_cr != NULL)
+        cairo_destroy(statusline_cr);
+    if (statusline_surface != NULL)
+        cairo_surface_destroy(statusline_surface);
+    statusline_cr = NULL;
+    statusline_surface = NULL;
+}
+
+static void cairo_set_source_colorpixel(cairo_t *cr, uint32_t colorpixel) {
+    cairo_set_source_rgb(cr,
+                         ((colorpixel >> 16) & 0xff) / 255.0,
+                         ((colorpixel >> 8) & 0xff) / 255.0,
+                         (colorpixel & 0xff) / 255.0);
+}
+
+/*
+ * Uploads the columns x1 to x2 (exclusive) of the statusline image surface
+ * to the statusline pixmap.
+ *
+ */
+static void upload_statusline(int x1, int x2) {
+    int width = x2 - x1;
+    int height = cairo_image_surface_get_height(statusline_surface);
+    if (width <= 0)
+        return;
+
+    cairo_surface_flush(statusline_surface);
+    const uint8_t *data = cairo_image_surface_get_data(statusline_surface);
+    int stride = cairo_image_surface_get_stride(statusline_surface);
+
+    /* Requests must not exceed the maximum request length, so a big update
+     * is uploaded in bands of rows. */
+    size_t max_bytes = xcb_get_maximum_request_length(xcb_connection) * 4 - sizeof(xcb_put_image_request_t);
+    size_t row_bytes = width * 4;
+    int rows = MAX(1, MIN(height, (int)(max_bytes / row_bytes)));
+
+    if (upload_buffer_size < row_bytes * rows) {
+        upload_buffer_size = row_bytes * rows;
+        upload_buffer = srealloc(upload_buffer, upload_buffer_size);
+    }
+
+    for (int y = 0; y < height; y += rows) {
+        int num_rows = MIN(rows, height - y);
+        for (int row = 0; row < num_rows; row++)
+            memcpy(upload_buffer + row * row_bytes, data + (y + row) * stride + x1 * 4, row_bytes);
+        xcb_put_image(xcb_connection, XCB_IMAGE_FORMAT_Z_PIXMAP, statusline_pm, statusline_ctx,
+                      width, num_rows, x1, y, 0, root_screen->root_depth,
+                      row_bytes * num_rows, upload_buffer);
+    }
+}
+#endif
+
 /*
  * Redraws the statusline to the buffer
  *
@@ -126,13 +286,19 @@ void refresh_statusline(void) {
 
     uint32_t old_statusline_width = statusline_width;
     statusline_width = 0;
+    bool changed = false;
 
-    /* Predict the text width of all blocks (in pixels). */
+    /* Predict the text width of all blocks (in pixels). Blocks whose text did
+     * not change since the last status line keep their width. */
     TAILQ_FOREACH(block, &statusline_head, blocks) {
         if (i3string_get_num_bytes(block->full_text) == 0)
             continue;
 
-        block->width = predict_text_width(block->full_text);
+        if (!block->text_width_valid) {
+            block->text_width = predict_text_width(block->full_text);
+            block->text_width_valid = true;
+        }
+        block->width = block->text_width;
 
         /* Compute offset and append for text aligment in min_width. */
         if (block->min_width <= block->width) {
@@ -167,24 +333,85 @@ void refresh_statusline(void) {
         statusline_width > old_statusline_width)
         realloc_sl_buffer();
 
-    /* Clear the statusline pixmap. */
-    xcb_rectangle_t rect = { 0, 0, root_screen->width_in_pixels, font.height + 2 };
-    xcb_poly_fill_rectangle(xcb_connection, statusline_pm, statusline_clear, 1, &rect);
+#if PANGO_SUPPORT
+    /* The columns of the image surface which have to be uploaded */
+    int upload_x1 = INT_MAX, upload_x2 = 0;
+    if (client_side_rendering && statusline_surface == NULL) {
+        statusline_surface = cairo_image_surface_create(CAIRO_FORMAT_RGB24,
+                                                        MAX(root_screen->width_in_pixels, statusline_width),
+                                                        font.height + 2);
+        statusline_cr = cairo_create(statusline_surface);
+        statusline_invalid = true;
+    }
+#endif
+
+    /* Clear the statusline pixmap if its contents are not usable anymore
+     * (e.g. because it was just reallocated). */
+    if (statusline_invalid) {
+        xcb_rectangle_t rect = { 0, 0, MAX(root_screen->width_in_pixels, statusline_width), font.height + 2 };
+#if PANGO_SUPPORT
+        if (client_side_rendering) {
+            cairo_set_source_colorpixel(statusline_cr, colors.bar_bg);
+            cairo_paint(statusline_cr);
+            upload_x1 = 0;
+            upload_x2 = cairo_image_surface_get_width(statusline_surface);
+        } else
+#endif
+        xcb_poly_fill_rectangle(xcb_connection, statusline_pm, statusline_clear, 1, &rect);
+        TAILQ_FOREACH(block, &statusline_head, blocks)
+            block->drawn = false;
+        statusline_invalid = false;
+        changed = true;
+    }
 
-    /* Draw the text of each block. */
+    /* Draw the text of each block, unless it is already drawn at the same
+     * position. Blocks don’t overlap, so only the changed ones need to be
+     * cleared. */
     uint32_t x = 0;
     TAILQ_FOREACH(block, &statusline_head, blocks) {
         if (i3string_get_num_bytes(block->full_text) == 0)
             continue;
 
-        uint32_t colorpixel = (block->color ? get_colorpixel(block->color) : colors.bar_fg);
+        uint32_t block_width = block->width + block->x_offset + block->x_append;
+        if (block->drawn && block->drawn_x == x && block->drawn_width == block_width) {
+            x += block_width;
+            continue;
+        }
+        block->drawn = true;
+        block->drawn_x = x;
+        block->drawn_width = block_width;
+        changed = true;
+
+        uint32_t colorpixel = (block->color ? block->color_pixel : colors.bar_fg);
         set_font_colors(statusline_ctx, colorpixel, colors.bar_bg);
-        draw_text(block->full_text, statusline_pm, statusline_ctx, x + block->x_offset, 1, block->width);
-        x += block->width + block->x_offset + block->x_append;
+#if PANGO_SUPPORT
+        if (client_side_rendering) {
+            cairo_set_source_colorpixel(statusline_cr, colors.bar_bg);
+            cairo_rectangle(statusline_cr, x, 0, block_width, font.height + 2);
+            cairo_fill(statusline_cr);
+            draw_text_cairo(block->full_text, statusline_cr, x + block->x_offset, 1, block->width);
+            upload_x1 = MIN(upload_x1, (int)x);
+            upload_x2 = MAX(upload_x2, (int)(x + block_width));
+        } else
+#endif
+        {
+            xcb_rectangle_t rect = { x, 0, block_width, font.height + 2 };
+            xcb_poly_fill_rectangle(xcb_connection, statusline_pm, statusline_clear, 1, &rect);
+            draw_text(block->full_text, statusline_pm, statusline_ctx, x + block->x_offset, 1, block->width);
+        }
+        x += block_width;
 
         if (TAILQ_NEXT(block, blocks) != NULL && !block->no_separator && block->sep_block_width > 0) {
             /* This is not the last block, draw a separator. */
             uint32_t sep_offset = block->sep_block_width/2 + block->sep_block_width % 2;
+#if PANGO_SUPPORT
+            if (client_side_rendering) {
+                cairo_set_source_colorpixel(statusline_cr, colors.sep_fg);
+                cairo_rectangle(statusline_cr, x - sep_offset, 2, 1, font.height - 3);
+                cairo_fill(statusline_cr);
+                continue;
+            }
+#endif
             uint32_t mask = XCB_GC_FOREGROUND | XCB_GC_BACKGROUND;
             uint32_t values[] = { colors.sep_fg, colors.bar_bg };
             xcb_change_gc(xcb_connection, statusline_ctx, mask, values);
@@ -194,6 +421,22 @@ void refresh_statusline(void) {
                                            { x - sep_offset, font.height - 2 } });
         }
     }
+
+#if PANGO_SUPPORT
+    if (client_side_rendering)
+        upload_statusline(upload_x1, upload_x2);
+#endif
+
+    /* Blocks which were removed at the end of the statusline only change its
+     * width. */
+    if (statusline_width != old_statusline_width)
+        changed = true;
+
+    if (changed && outputs != NULL) {
+        i3_output *walk;
+        SLIST_FOREACH(walk, outputs, slist)
+            walk->statusline_damaged = true;
+    }
 }
 
 /*
@@ -212,6 +455,7 @@ void hide_bars(void) {
         }
         xcb_unmap_window(xcb_connection, walk->bar);
     }
+    bars_hidden = true;
     stop_child();
 }
 
@@ -231,6 +475,12 @@ void unhide_bars(void) {
 
     cont_child();
 
+    /* Bring the buffers up to date before the bars get exposed. */
+    if (bars_hidden) {
+        bars_hidden = false;
+        draw_damaged_bars();
+    }
+
     SLIST_FOREACH(walk, outputs, slist) {
         if (walk->bar == XCB_NONE) {
             continue;
@@ -286,6 +536,19 @@ void init_colors(const struct xcb_color_strings_t *new_colors) {
     PARSE_COLOR(focus_ws_border, "#4c7899");
 #undef PARSE_COLOR
 
+    /* The statusline buffer is cleared with the background color. The other
+     * colors are set whenever something is drawn, so nothing needs to be
+     * reallocated when the colors change. */
+    uint32_t values[] = { colors.bar_bg, colors.bar_bg };
+    xcb_change_gc(xcb_connection, statusline_clear, XCB_GC_FOREGROUND | XCB_GC_BACKGROUND, values);
+
+    free_ws_buttons();
+    statusline_invalid = true;
+    if (outputs != NULL) {
+        i3_output *walk;
+        SLIST_FOREACH(walk, outputs, slist)
+            walk->buffer_invalid = true;
+    }
     init_tray_colors();
     xcb_flush(xcb_connection);
 }
@@ -451,13 +714,17 @@ static void configure_trayclients(void) {
                 continue;
             clients++;
 
-            DLOG("Configuring tray window %08x to x=%d\n",
-                 trayclient->win, output->rect.w - (clients * (font.height + 2)));
+            /* Only clients whose position changed are moved. */
             uint32_t x = output->rect.w - (clients * (font.height + 2));
+            if (trayclient->x == (int)x)
+                continue;
+
+            DLOG("Configuring tray window %08x to x=%d\n", trayclient->win, x);
             xcb_configure_window(xcb_connection,
                                  trayclient->win,
                                  XCB_CONFIG_WINDOW_X,
                                  &x);
+            trayclient->x = x;
         }
     }
 }
@@ -607,7 +874,11 @@ static void handle_client_message(xcb_client_message_event_t* event) {
             tc->win = client;
             tc->xe_version = xe_version;
             tc->mapped = false;
+            tc->output = output;
+            /* The position it was reparented to, see above. */
+            tc->x = output->rect.w - font.height - 2;
             TAILQ_INSERT_TAIL(output->trayclients, tc, tailq);
+            trayclient_index_add(tc);
 
             if (map_it) {
                 DLOG("Mapping dock client\n");
@@ -635,25 +906,18 @@ static void handle_client_message(xcb_client_message_event_t* event) {
 static void handle_destroy_notify(xcb_destroy_notify_event_t* event) {
     DLOG("DestroyNotify for window = %08x, event = %08x\n", event->window, event->event);
 
-    i3_output *walk;
-    SLIST_FOREACH(walk, outputs, slist) {
-        if (!walk->active)
-            continue;
-        DLOG("checking output %s\n", walk->name);
-        trayclient *trayclient;
-        TAILQ_FOREACH(trayclient, walk->trayclients, tailq) {
-            if (trayclient->win != event->window)
-                continue;
+    trayclient *trayclient = trayclient_by_window(event->window);
+    if (trayclient == NULL || !trayclient->output->active)
+        return;
 
-            DLOG("Removing tray client with window ID %08x\n", event->window);
-            TAILQ_REMOVE(walk->trayclients, trayclient, tailq);
+    DLOG("Removing tray client with window ID %08x\n", event->window);
+    TAILQ_REMOVE(trayclient->output->trayclients, trayclient, tailq);
+    trayclient_index_remove(trayclient);
+    free(trayclient);
 
-            /* Trigger an update, we now have more space for the statusline */
-            configure_trayclients();
-            draw_bars(false);
-            return;
-        }
-    }
+    /* Trigger an update, we now have more space for the statusline */
+    configure_trayclients();
+    draw_bars(false);
 }
 
 /*
@@ -664,25 +928,16 @@ static void handle_destroy_notify(xcb_destroy_notify_event_t* event) {
 static void handle_map_notify(xcb_map_notify_event_t* event) {
     DLOG("MapNotify for window = %08x, event = %08x\n", event->window, event->event);
 
-    i3_output *walk;
-    SLIST_FOREACH(walk, outputs, slist) {
-        if (!walk->active)
-            continue;
-        DLOG("checking output %s\n", walk->name);
-        trayclient *trayclient;
-        TAILQ_FOREACH(trayclient, walk->trayclients, tailq) {
-            if (trayclient->win != event->window)
-                continue;
+    trayclient *trayclient = trayclient_by_window(event->window);
+    if (trayclient == NULL || !trayclient->output->active)
+        return;
 
-            DLOG("Tray client mapped (window ID %08x). Adjusting tray.\n", event->window);
-            trayclient->mapped = true;
+    DLOG("Tray client mapped (window ID %08x). Adjusting tray.\n", event->window);
+    trayclient->mapped = true;
 
-            /* Trigger an update, we now have more space for the statusline */
-            configure_trayclients();
-            draw_bars(false);
-            return;
-        }
-    }
+    /* Trigger an update, we now have more space for the statusline */
+    configure_trayclients();
+    draw_bars(false);
 }
 /*
  * Handles UnmapNotify events. These events happen when a tray client hides its
@@ -692,25 +947,16 @@ static void handle_map_notify(xcb_map_notify_event_t* event) {
 static void handle_unmap_notify(xcb_unmap_notify_event_t* event) {
     DLOG("UnmapNotify for window = %08x, event = %08x\n", event->window, event->event);
 
-    i3_output *walk;
-    SLIST_FOREACH(walk, outputs, slist) {
-        if (!walk->active)
-            continue;
-        DLOG("checking output %s\n", walk->name);
-        trayclient *trayclient;
-        TAILQ_FOREACH(trayclient, walk->trayclients, tailq) {
-            if (trayclient->win != event->window)
-                continue;
+    trayclient *trayclient = trayclient_by_window(event->window);
+    if (trayclient == NULL || !trayclient->output->active)
+        return;
 
-            DLOG("Tray client unmapped (window ID %08x). Adjusting tray.\n", event->window);
-            trayclient->mapped = false;
+    DLOG("Tray client unmapped (window ID %08x). Adjusting tray.\n", event->window);
+    trayclient->mapped = false;
 
-            /* Trigger an update, we now have more space for the statusline */
-            configure_trayclients();
-            draw_bars(false);
-            return;
-        }
-    }
+    /* Trigger an update, we now have more space for the statusline */
+    configure_trayclients();
+    draw_bars(false);
 }
 
 /*
@@ -723,22 +969,9 @@ static void handle_property_notify(xcb_property_notify_event_t *event) {
     if (event->atom == atoms[_XEMBED_INFO] &&
         event->state == XCB_PROPERTY_NEW_VALUE) {
         DLOG("xembed_info updated\n");
-        trayclient *trayclient = NULL, *walk;
-        i3_output *o_walk;
-        SLIST_FOREACH(o_walk, outputs, slist) {
-            if (!o_walk->active)
-                continue;
-
-            TAILQ_FOREACH(walk, o_walk->trayclients, tailq) {
-                if (walk->win != event->window)
-                    continue;
-                trayclient = walk;
-                break;
-            }
-
-            if (trayclient)
-                break;
-        }
+        trayclient *trayclient = trayclient_by_window(event->window);
+        if (trayclient != NULL && !trayclient->output->active)
+            trayclient = NULL;
         if (!trayclient) {
             ELOG("PropertyNotify received for unknown window %08x\n",
                  event->window);
@@ -786,34 +1019,22 @@ static void handle_property_notify(xcb_property_notify_event_t *event) {
 static void handle_configure_request(xcb_configure_request_event_t *event) {
     DLOG("ConfigureRequest for window = %08x\n", event->window);
 
-    trayclient *trayclient;
-    i3_output *output;
-    SLIST_FOREACH(output, outputs, slist) {
-        if (!output->active)
-            continue;
-
-        int clients = 0;
-        TAILQ_FOREACH_REVERSE(trayclient, output->trayclients, tc_head, tailq) {
-            if (!trayclient->mapped)
-                continue;
-            clients++;
-
-            if (trayclient->win != event->window)
-                continue;
-
-            xcb_rectangle_t rect;
-            rect.x = output->rect.w - (clients * (font.height + 2));
-            rect.y = 2;
-            rect.width = font.height;
-            rect.height = font.height;
-
-            DLOG("This is a tray window. x = %d\n", rect.x);
-            fake_configure_notify(xcb_connection, rect, event->window, 0);
-            return;
-        }
+    trayclient *trayclient = trayclient_by_window(event->window);
+    if (trayclient == NULL || !trayclient->mapped || !trayclient->output->active) {
+        DLOG("WARNING: Could not find corresponding tray window.\n");
+        return;
     }
 
-    DLOG("WARNING: Could not find corresponding tray window.\n");
+    /* configure_trayclients() keeps the position of mapped clients up to
+     * date. */
+    xcb_rectangle_t rect;
+    rect.x = trayclient->x;
+    rect.y = 2;
+    rect.width = font.height;
+    rect.height = font.height;
+
+    DLOG("This is a tray window. x = %d\n", rect.x);
+    fake_configure_notify(xcb_connection, rect, event->window, 0);
 }
 
 /*
@@ -1022,7 +1243,7 @@ char *init_xcb_early() {
     /* Now we get the atoms and save them in a nice data structure */
     get_atoms();
 
-    char *path = root_atom_contents("I3_SOCKET_PATH", xcb_connection, screen);
+    char *path = get_socket_path(xcb_connection, screen);
 
     if (xcb_request_failed(sl_pm_cookie, "Could not allocate statusline-buffer") ||
         xcb_request_failed(clear_ctx_cookie, "Could not allocate statusline-buffer-clearcontext") ||
@@ -1106,9 +1327,14 @@ void init_xcb_late(char *fontname) {
     /* Load the font */
     font = load_font(fontname, true);
     set_font(&font);
+    set_font_glyph_cache(config.glyph_cache);
     DLOG("Calculated Font-height: %d\n", font.height);
     bar_height = font.height + 6;
 
+#if PANGO_SUPPORT
+    init_client_side_rendering();
+#endif
+
     xcb_flush(xcb_connection);
 
     if (config.hide_on_modifier == M_HIDE)
@@ -1276,6 +1502,12 @@ void clean_xcb(void) {
     FREE_SLIST(outputs, i3_output);
     FREE(outputs);
 
+#if PANGO_SUPPORT
+    free_statusline_surface();
+    FREE(upload_buffer);
+#endif
+
+    free_ws_buttons();
     xcb_flush(xcb_connection);
     xcb_disconnect(xcb_connection);
 
@@ -1333,6 +1565,8 @@ void kick_tray_clients(i3_output *output) {
         /* We remove the trayclient right here. We might receive an UnmapNotify
          * event afterwards, but better safe than sorry. */
         TAILQ_REMOVE(output->trayclients, trayclient, tailq);
+        trayclient_index_remove(trayclient);
+        free(trayclient);
     }
 
     /* Fake a DestroyNotify so that Qt re-adds tray icons.
@@ -1376,6 +1610,10 @@ void realloc_sl_buffer(void) {
          statusline_width, root_screen->width_in_pixels);
     xcb_free_pixmap(xcb_connection, statusline_pm);
     statusline_pm = xcb_generate_id(xcb_connection);
+    statusline_invalid = true;
+#if PANGO_SUPPORT
+    free_statusline_surface();
+#endif
     xcb_void_cookie_t sl_pm_cookie = xcb_create_pixmap_checked(xcb_connection,
                                                                root_screen->root_depth,
                                                                statusline_pm,
@@ -1469,6 +1707,14 @@ void reconfig_windows(bool redraw_bars) {
                                                                     walk->bar,
                                                                     walk->rect.w,
                                                                     bar_height);
+            walk->buffer_invalid = true;
+            walk->bar_rect = (rect){
+                walk->rect.x,
+                walk->rect.y + walk->rect.h - bar_height,
+                walk->rect.w,
+                bar_height
+            };
+            walk->override_redirect = (config.hide_on_modifier != M_DOCK);
 
             /* Set the WM_CLASS and WM_NAME (we don't need UTF-8) atoms */
             xcb_void_cookie_t class_cookie;
@@ -1591,42 +1837,68 @@ void reconfig_windows(bool redraw_bars) {
                 tray_configured = true;
             }
         } else {
-            /* We already have a bar, so we just reconfigure it */
-            mask = XCB_CONFIG_WINDOW_X |
-                   XCB_CONFIG_WINDOW_Y |
-                   XCB_CONFIG_WINDOW_WIDTH |
-                   XCB_CONFIG_WINDOW_HEIGHT |
-                   XCB_CONFIG_WINDOW_STACK_MODE;
-            values[0] = walk->rect.x;
-            values[1] = walk->rect.y + walk->rect.h - bar_height;
-            values[2] = walk->rect.w;
-            values[3] = bar_height;
-            values[4] = XCB_STACK_MODE_ABOVE;
-
-            DLOG("Destroying buffer for output %s\n", walk->name);
-            xcb_free_pixmap(xcb_connection, walk->buffer);
-
-            DLOG("Reconfiguring Window for output %s to %d,%d\n", walk->name, values[0], values[1]);
-            xcb_void_cookie_t cfg_cookie = xcb_configure_window_checked(xcb_connection,
-                                                                        walk->bar,
-                                                                        mask,
-                                                                        values);
-
-            mask = XCB_CW_OVERRIDE_REDIRECT;
-            values[0] = (config.hide_on_modifier == M_DOCK ? 0 : 1);
-            DLOG("Changing Window attribute override_redirect for output %s to %d\n", walk->name, values[0]);
-            xcb_void_cookie_t chg_cookie = xcb_change_window_attributes(xcb_connection,
-                                                                        walk->bar,
-                                                                        mask,
-                                                                        values);
-
-            DLOG("Recreating buffer for output %s\n", walk->name);
-            xcb_void_cookie_t pm_cookie = xcb_create_pixmap_checked(xcb_connection,
-                                                                    root_screen->root_depth,
-                                                                    walk->buffer,
-                                                                    walk->bar,
-                                                                    walk->rect.w,
-                                                                    bar_height);
+            /* We already have a bar, so we just reconfigure it. Most output
+             * events do not concern this bar at all, so only what actually
+             * changed is sent to the X server. */
+            rect bar_rect = {
+                walk->rect.x,
+                walk->rect.y + walk->rect.h - bar_height,
+                walk->rect.w,
+                bar_height
+            };
+            bool moved = (bar_rect.x != walk->bar_rect.x || bar_rect.y != walk->bar_rect.y);
+            bool resized = (bar_rect.w != walk->bar_rect.w || bar_rect.h != walk->bar_rect.h);
+            bool override_redirect = (config.hide_on_modifier != M_DOCK);
+
+            xcb_void_cookie_t cfg_cookie, chg_cookie, pm_cookie;
+            if (moved || resized || redraw_bars) {
+                mask = XCB_CONFIG_WINDOW_X |
+                       XCB_CONFIG_WINDOW_Y |
+                       XCB_CONFIG_WINDOW_WIDTH |
+                       XCB_CONFIG_WINDOW_HEIGHT |
+                       XCB_CONFIG_WINDOW_STACK_MODE;
+                values[0] = bar_rect.x;
+                values[1] = bar_rect.y;
+                values[2] = bar_rect.w;
+                values[3] = bar_rect.h;
+                values[4] = XCB_STACK_MODE_ABOVE;
+
+                DLOG("Reconfiguring Window for output %s to %d,%d\n", walk->name, values[0], values[1]);
+                cfg_cookie = xcb_configure_window_checked(xcb_connection,
+                                                          walk->bar,
+                                                          mask,
+                                                          values);
+            }
+
+            if (override_redirect != walk->override_redirect) {
+                mask = XCB_CW_OVERRIDE_REDIRECT;
+                values[0] = override_redirect;
+                DLOG("Changing Window attribute override_redirect for output %s to %d\n", walk->name, values[0]);
+                chg_cookie = xcb_change_window_attributes_checked(xcb_connection,
+                                                                  walk->bar,
+                                                                  mask,
+                                                                  values);
+            }
+
+            if (resized) {
+                DLOG("Recreating buffer for output %s\n", walk->name);
+                xcb_free_pixmap(xcb_connection, walk->buffer);
+                pm_cookie = xcb_create_pixmap_checked(xcb_connection,
+                                                      root_screen->root_depth,
+                                                      walk->buffer,
+                                                      walk->bar,
+                                                      bar_rect.w,
+                                                      bar_rect.h);
+                walk->buffer_invalid = true;
+            }
+
+            if (((moved || resized || redraw_bars) && xcb_request_failed(cfg_cookie, "Could not reconfigure window")) ||
+                (override_redirect != walk->override_redirect && xcb_request_failed(chg_cookie, "Could not change window")) ||
+                (resized && xcb_request_failed(pm_cookie, "Could not create pixmap"))) {
+                exit(EXIT_FAILURE);
+            }
+            walk->bar_rect = bar_rect;
+            walk->override_redirect = override_redirect;
 
             xcb_void_cookie_t map_cookie, umap_cookie;
             if (redraw_bars) {
@@ -1648,11 +1920,8 @@ void reconfig_windows(bool redraw_bars) {
                 }
             }
 
-            if (xcb_request_failed(cfg_cookie, "Could not reconfigure window") ||
-                xcb_request_failed(chg_cookie, "Could not change window") ||
-                xcb_request_failed(pm_cookie,  "Could not create pixmap") ||
-                (redraw_bars && (xcb_request_failed(umap_cookie,  "Could not unmap window") ||
-                (config.hide_on_modifier == M_DOCK && xcb_request_failed(map_cookie, "Could not map window"))))) {
+            if (redraw_bars && (xcb_request_failed(umap_cookie,  "Could not unmap window") ||
+                (config.hide_on_modifier == M_DOCK && xcb_request_failed(map_cookie, "Could not map window")))) {
                 exit(EXIT_FAILURE);
             }
         }
@@ -1660,14 +1929,326 @@ void reconfig_windows(bool redraw_bars) {
 }
 
 /*
- * Render the bars, with buttons and statusline
+ * Frees all cached workspace buttons. Called when the colors change.
  *
  */
-void draw_bars(bool unhide) {
-    DLOG("Drawing Bars...\n");
+static void free_ws_buttons(void) {
+    struct ws_button *button;
+    while (!TAILQ_EMPTY(&ws_buttons)) {
+        button = TAILQ_FIRST(&ws_buttons);
+        TAILQ_REMOVE(&ws_buttons, button, buttons);
+        xcb_free_pixmap(xcb_connection, button->pixmap);
+        FREE(button->name);
+        FREE(button);
+    }
+    ws_buttons_num = 0;
+}
+
+/*
+ * Returns the state (and thereby the colors) of the button of the given
+ * workspace.
+ *
+ */
+static ws_state_t ws_state(i3_ws *ws) {
+    if (ws->urgent)
+        return WS_URGENT;
+    if (ws->visible)
+        return (ws->focused ? WS_FOCUSED : WS_ACTIVE);
+    return WS_INACTIVE;
+}
+
+/*
+ * Returns a pixmap containing the button of the given workspace, which is
+ * drawn (using the GC of the given output) unless it is cached.
+ *
+ */
+static xcb_pixmap_t get_ws_button(i3_output *output, i3_ws *ws) {
+    const char *name = i3string_as_utf8(ws->name);
+    ws_state_t state = ws_state(ws);
+    int width = ws->name_width + 10;
+    int height = font.height + 4;
+
+    struct ws_button *button;
+    TAILQ_FOREACH(button, &ws_buttons, buttons) {
+        if (button->state != state ||
+            button->width != width ||
+            strcmp(button->name, name) != 0)
+            continue;
+        if (button != TAILQ_FIRST(&ws_buttons)) {
+            TAILQ_REMOVE(&ws_buttons, button, buttons);
+            TAILQ_INSERT_HEAD(&ws_buttons, button, buttons);
+        }
+        return button->pixmap;
+    }
+
+    DLOG("Rendering button for WS %s (state %d)\n", name, state);
+    uint32_t fg_color, bg_color, border_color;
+    switch (state) {
+        case WS_ACTIVE:
+            fg_color = colors.active_ws_fg;
+            bg_color = colors.active_ws_bg;
+            border_color = colors.active_ws_border;
+            break;
+        case WS_FOCUSED:
+            fg_color = colors.focus_ws_fg;
+            bg_color = colors.focus_ws_bg;
+            border_color = colors.focus_ws_border;
+            break;
+        case WS_URGENT:
+            fg_color = colors.urgent_ws_fg;
+            bg_color = colors.urgent_ws_bg;
+            border_color = colors.urgent_ws_border;
+            break;
+        default:
+            fg_color = colors.inactive_ws_fg;
+            bg_color = colors.inactive_ws_bg;
+            border_color = colors.inactive_ws_border;
+            break;
+    }
+
+    if (ws_buttons_num == WS_BUTTONS_MAX) {
+        button = TAILQ_LAST(&ws_buttons, ws_buttons_head);
+        TAILQ_REMOVE(&ws_buttons, button, buttons);
+        xcb_free_pixmap(xcb_connection, button->pixmap);
+        FREE(button->name);
+        FREE(button);
+        ws_buttons_num--;
+    }
+
+    button = smalloc(sizeof(struct ws_button));
+    button->name = sstrdup(name);
+    button->state = state;
+    button->width = width;
+    button->pixmap = xcb_generate_id(xcb_connection);
+    xcb_create_pixmap(xcb_connection,
+                      root_screen->root_depth,
+                      button->pixmap,
+                      xcb_root,
+                      width, height);
+    TAILQ_INSERT_HEAD(&ws_buttons, button, buttons);
+    ws_buttons_num++;
+
+    uint32_t mask = XCB_GC_FOREGROUND | XCB_GC_BACKGROUND;
+    uint32_t vals_border[] = { border_color, border_color };
+    xcb_change_gc(xcb_connection,
+                  output->bargc,
+                  mask,
+                  vals_border);
+    xcb_rectangle_t rect_border = { 0, 0, width, height };
+    xcb_poly_fill_rectangle(xcb_connection,
+                            button->pixmap,
+                            output->bargc,
+                            1,
+                            &rect_border);
+    uint32_t vals[] = { bg_color, bg_color };
+    xcb_change_gc(xcb_connection,
+                  output->bargc,
+                  mask,
+                  vals);
+    xcb_rectangle_t rect = { 1, 1, width - 2, height - 2 };
+    xcb_poly_fill_rectangle(xcb_connection,
+                            button->pixmap,
+                            output->bargc,
+                            1,
+                            &rect);
+    set_font_colors(output->bargc, fg_color, bg_color);
+    draw_text(ws->name, button->pixmap, output->bargc, 5, 2, ws->name_width);
+
+    return button->pixmap;
+}
+
+/*
+ * Draws the workspace buttons and the binding mode indicator of the given
+ * output to its buffer.
+ *
+ */
+static void draw_buttons(i3_output *output) {
     int i = 0;
 
-    refresh_statusline();
+    if (!config.disable_ws) {
+        i3_ws *ws_walk;
+        TAILQ_FOREACH(ws_walk, output->workspaces, tailq) {
+            DLOG("Drawing Button for WS %s at x = %d, len = %d\n",
+                 i3string_as_utf8(ws_walk->name), i, ws_walk->name_width);
+            xcb_copy_area(xcb_connection,
+                          get_ws_button(output, ws_walk),
+                          output->buffer,
+                          output->bargc,
+                          0, 0,
+                          i, 1,
+                          ws_walk->name_width + 10, font.height + 4);
+            i += 10 + ws_walk->name_width + 1;
+        }
+    }
+
+    if (binding.name && !config.disable_binding_mode_indicator) {
+        uint32_t fg_color = colors.urgent_ws_fg;
+        uint32_t bg_color = colors.urgent_ws_bg;
+        uint32_t mask = XCB_GC_FOREGROUND | XCB_GC_BACKGROUND;
+
+        uint32_t vals_border[] = { colors.urgent_ws_border, colors.urgent_ws_border };
+        xcb_change_gc(xcb_connection,
+                      output->bargc,
+                      mask,
+                      vals_border);
+        xcb_rectangle_t rect_border = { i, 1, binding.width + 10, font.height + 4 };
+        xcb_poly_fill_rectangle(xcb_connection,
+                                output->buffer,
+                                output->bargc,
+                                1,
+                                &rect_border);
+
+        uint32_t vals[] = { bg_color, bg_color };
+        xcb_change_gc(xcb_connection,
+                      output->bargc,
+                      mask,
+                      vals);
+        xcb_rectangle_t rect = { i + 1, 2, binding.width + 8, font.height + 2 };
+        xcb_poly_fill_rectangle(xcb_connection,
+                                output->buffer,
+                                output->bargc,
+                                1,
+                                &rect);
+
+        set_font_colors(output->bargc, fg_color, bg_color);
+        draw_text(binding.name, output->buffer, output->bargc, i + 5, 3, binding.width);
+    }
+}
+
+/*
+ * Returns the width of the workspace buttons and the binding mode indicator
+ * of the given output, as drawn by draw_buttons().
+ *
+ */
+static int buttons_width(i3_output *output) {
+    int width = 0;
+
+    if (!config.disable_ws) {
+        i3_ws *ws_walk;
+        TAILQ_FOREACH(ws_walk, output->workspaces, tailq)
+            width += 10 + ws_walk->name_width + 1;
+    }
+    if (binding.name && !config.disable_binding_mode_indicator)
+        width += binding.width + 10;
+
+    return width;
+}
+
+/*
+ * Draws the damaged parts of the bar of the given output to its buffer and
+ * adds them to the range which redraw_damage() copies to the bar window.
+ *
+ */
+static void draw_bar(i3_output *output) {
+    int width = output->rect.w;
+
+    /* The part of the statusline pixmap which is shown on this output */
+    int sl_src_x = 0, sl_x = width, sl_width = 0;
+    if (!TAILQ_EMPTY(&statusline_head)) {
+        trayclient *trayclient;
+        int traypx = 0;
+        TAILQ_FOREACH(trayclient, output->trayclients, tailq) {
+            if (!trayclient->mapped)
+                continue;
+            /* We assume the tray icons are quadratic (we use the font
+             * *height* as *width* of the icons) because we configured them
+             * like this. */
+            traypx += font.height + 2;
+        }
+        /* Add 2px of padding if there are any tray icons */
+        if (traypx > 0)
+            traypx += 2;
+        sl_src_x = MAX(0, (int16_t)(statusline_width - width + 4));
+        sl_x = MAX(0, (int16_t)(width - statusline_width - traypx - 4));
+        sl_width = MAX(0, MIN(width - traypx - 4, (int)statusline_width));
+    }
+    int new_buttons_width = buttons_width(output);
+
+    if (output->buffer_invalid) {
+        output->buttons_damaged = true;
+        output->statusline_damaged = true;
+        output->buttons_width = width;
+        output->statusline_x = 0;
+    }
+    if (sl_src_x != output->statusline_src_x ||
+        sl_x != output->statusline_x ||
+        sl_width != output->statusline_width)
+        output->statusline_damaged = true;
+    if (new_buttons_width != output->buttons_width)
+        output->buttons_damaged = true;
+
+    if (!output->buttons_damaged && !output->statusline_damaged)
+        return;
+
+    /* The buttons are drawn on top of the statusline, so both have to be
+     * drawn again when they overlap. */
+    int buttons_end = MAX(new_buttons_width, output->buttons_width);
+    int statusline_start = MIN(sl_x, output->statusline_x);
+    if (buttons_end > statusline_start) {
+        output->buttons_damaged = true;
+        output->statusline_damaged = true;
+    }
+
+    int x1 = (output->buttons_damaged ? 0 : statusline_start);
+    int x2 = (output->statusline_damaged ? width : buttons_end);
+
+    /* First things first: clear the damaged part of the backbuffer */
+    uint32_t color = colors.bar_bg;
+    xcb_change_gc(xcb_connection,
+                  output->bargc,
+                  XCB_GC_FOREGROUND,
+                  &color);
+    xcb_rectangle_t rect = { x1, 0, x2 - x1, bar_height };
+    xcb_poly_fill_rectangle(xcb_connection,
+                            output->buffer,
+                            output->bargc,
+                            1,
+                            &rect);
+
+    if (output->statusline_damaged && sl_width > 0) {
+        DLOG("Printing statusline!\n");
+
+        /* Luckily we already prepared a seperate pixmap containing the rendered
+         * statusline, we just have to copy the relevant parts to the relevant
+         * position */
+        xcb_copy_area(xcb_connection,
+                      statusline_pm,
+                      output->buffer,
+                      output->bargc,
+                      sl_src_x, 0,
+                      sl_x, 3,
+                      sl_width, font.height + 2);
+    }
+
+    if (output->buttons_damaged)
+        draw_buttons(output);
+
+    output->buffer_invalid = false;
+    output->buttons_damaged = false;
+    output->statusline_damaged = false;
+    output->buttons_width = new_buttons_width;
+    output->statusline_src_x = sl_src_x;
+    output->statusline_x = sl_x;
+    output->statusline_width = sl_width;
+
+    if (output->damage_x2 > output->damage_x1) {
+        output->damage_x1 = MIN(output->damage_x1, x1);
+        output->damage_x2 = MAX(output->damage_x2, x2);
+    } else {
+        output->damage_x1 = x1;
+        output->damage_x2 = x2;
+    }
+}
+
+/*
+ * Draws the damaged parts of all bars to their buffers. Bars which are not
+ * shown are drawn when they get unhidden.
+ *
+ */
+static void draw_damaged_bars(void) {
+    if (config.hide_on_modifier == M_INVISIBLE ||
+        (config.hide_on_modifier == M_HIDE && bars_hidden))
+        return;
 
     i3_output *outputs_walk;
     SLIST_FOREACH(outputs_walk, outputs, slist) {
@@ -1679,141 +2260,72 @@ void draw_bars(bool unhide) {
             /* Oh shit, an active output without an own bar. Create it now! */
             reconfig_windows(false);
         }
-        /* First things first: clear the backbuffer */
-        uint32_t color = colors.bar_bg;
-        xcb_change_gc(xcb_connection,
+        draw_bar(outputs_walk);
+    }
+}
+
+/*
+ * Copies the damaged parts of the buffers to the bar windows.
+ *
+ */
+static void redraw_damage(void) {
+    i3_output *outputs_walk;
+    SLIST_FOREACH(outputs_walk, outputs, slist) {
+        if (!outputs_walk->active || outputs_walk->damage_x2 <= outputs_walk->damage_x1) {
+            continue;
+        }
+        xcb_copy_area(xcb_connection,
+                      outputs_walk->buffer,
+                      outputs_walk->bar,
                       outputs_walk->bargc,
-                      XCB_GC_FOREGROUND,
-                      &color);
-        xcb_rectangle_t rect = { 0, 0, outputs_walk->rect.w, bar_height };
-        xcb_poly_fill_rectangle(xcb_connection,
-                                outputs_walk->buffer,
-                                outputs_walk->bargc,
-                                1,
-                                &rect);
+                      outputs_walk->damage_x1, 0,
+                      outputs_walk->damage_x1, 0,
+                      outputs_walk->damage_x2 - outputs_walk->damage_x1,
+                      bar_height);
+        outputs_walk->damage_x1 = outputs_walk->damage_x2 = 0;
+    }
+    xcb_flush(xcb_connection);
+}
 
-        if (!TAILQ_EMPTY(&statusline_head)) {
-            DLOG("Printing statusline!\n");
+/*
+ * Marks the workspace buttons of all bars as changed, so that draw_bars()
+ * draws them again.
+ *
+ */
+void damage_workspace_buttons(void) {
+    i3_output *outputs_walk;
+    if (outputs == NULL)
+        return;
+    SLIST_FOREACH(outputs_walk, outputs, slist)
+        outputs_walk->buttons_damaged = true;
+}
 
-            /* Luckily we already prepared a seperate pixmap containing the rendered
-             * statusline, we just have to copy the relevant parts to the relevant
-             * position */
-            trayclient *trayclient;
-            int traypx = 0;
-            TAILQ_FOREACH(trayclient, outputs_walk->trayclients, tailq) {
-                if (!trayclient->mapped)
-                    continue;
-                /* We assume the tray icons are quadratic (we use the font
-                 * *height* as *width* of the icons) because we configured them
-                 * like this. */
-                traypx += font.height + 2;
-            }
-            /* Add 2px of padding if there are any tray icons */
-            if (traypx > 0)
-                traypx += 2;
-            xcb_copy_area(xcb_connection,
-                          statusline_pm,
-                          outputs_walk->buffer,
-                          outputs_walk->bargc,
-                          MAX(0, (int16_t)(statusline_width - outputs_walk->rect.w + 4)), 0,
-                          MAX(0, (int16_t)(outputs_walk->rect.w - statusline_width - traypx - 4)), 3,
-                          MIN(outputs_walk->rect.w - traypx - 4, statusline_width), font.height + 2);
-        }
+/*
+ * Render the bars, with buttons and statusline. Only the parts which changed
+ * since the last call are drawn and copied to the bar windows.
+ *
+ */
+void draw_bars(bool unhide) {
+    DLOG("Drawing Bars...\n");
 
-        if (!config.disable_ws) {
+    refresh_statusline();
+
+    /* Urgent workspaces and binding modes are shown even if the bar is
+     * hidden. */
+    i3_output *outputs_walk;
+    if (!config.disable_ws) {
+        SLIST_FOREACH(outputs_walk, outputs, slist) {
+            if (!outputs_walk->active)
+                continue;
             i3_ws *ws_walk;
             TAILQ_FOREACH(ws_walk, outputs_walk->workspaces, tailq) {
-                DLOG("Drawing Button for WS %s at x = %d, len = %d\n",
-                     i3string_as_utf8(ws_walk->name), i, ws_walk->name_width);
-                uint32_t fg_color = colors.inactive_ws_fg;
-                uint32_t bg_color = colors.inactive_ws_bg;
-                uint32_t border_color = colors.inactive_ws_border;
-                if (ws_walk->visible) {
-                    if (!ws_walk->focused) {
-                        fg_color = colors.active_ws_fg;
-                        bg_color = colors.active_ws_bg;
-                        border_color = colors.active_ws_border;
-                    } else {
-                        fg_color = colors.focus_ws_fg;
-                        bg_color = colors.focus_ws_bg;
-                        border_color = colors.focus_ws_border;
-                    }
-                }
-                if (ws_walk->urgent) {
-                    DLOG("WS %s is urgent!\n", i3string_as_utf8(ws_walk->name));
-                    fg_color = colors.urgent_ws_fg;
-                    bg_color = colors.urgent_ws_bg;
-                    border_color = colors.urgent_ws_border;
+                if (ws_walk->urgent)
                     unhide = true;
-                }
-                uint32_t mask = XCB_GC_FOREGROUND | XCB_GC_BACKGROUND;
-                uint32_t vals_border[] = { border_color, border_color };
-                xcb_change_gc(xcb_connection,
-                              outputs_walk->bargc,
-                              mask,
-                              vals_border);
-                xcb_rectangle_t rect_border = { i, 1, ws_walk->name_width + 10, font.height + 4 };
-                xcb_poly_fill_rectangle(xcb_connection,
-                                        outputs_walk->buffer,
-                                        outputs_walk->bargc,
-                                        1,
-                                        &rect_border);
-                uint32_t vals[] = { bg_color, bg_color };
-                xcb_change_gc(xcb_connection,
-                              outputs_walk->bargc,
-                              mask,
-                              vals);
-                xcb_rectangle_t rect = { i + 1, 2, ws_walk->name_width + 8, font.height + 2 };
-                xcb_poly_fill_rectangle(xcb_connection,
-                                        outputs_walk->buffer,
-                                        outputs_walk->bargc,
-                                        1,
-                                        &rect);
-                set_font_colors(outputs_walk->bargc, fg_color, bg_color);
-                draw_text(ws_walk->name, outputs_walk->buffer, outputs_walk->bargc,
-                          i + 5, 3, ws_walk->name_width);
-                i += 10 + ws_walk->name_width + 1;
-
             }
         }
-
-        if (binding.name && !config.disable_binding_mode_indicator) {
-            uint32_t fg_color = colors.urgent_ws_fg;
-            uint32_t bg_color = colors.urgent_ws_bg;
-            uint32_t mask = XCB_GC_FOREGROUND | XCB_GC_BACKGROUND;
-
-            uint32_t vals_border[] = { colors.urgent_ws_border, colors.urgent_ws_border };
-            xcb_change_gc(xcb_connection,
-                          outputs_walk->bargc,
-                          mask,
-                          vals_border);
-            xcb_rectangle_t rect_border = { i, 1, binding.width + 10, font.height + 4 };
-            xcb_poly_fill_rectangle(xcb_connection,
-                                    outputs_walk->buffer,
-                                    outputs_walk->bargc,
-                                    1,
-                                    &rect_border);
-
-            uint32_t vals[] = { bg_color, bg_color };
-            xcb_change_gc(xcb_connection,
-                          outputs_walk->bargc,
-                          mask,
-                          vals);
-            xcb_rectangle_t rect = { i + 1, 2, binding.width + 8, font.height + 2 };
-            xcb_poly_fill_rectangle(xcb_connection,
-                                    outputs_walk->buffer,
-                                    outputs_walk->bargc,
-                                    1,
-                                    &rect);
-
-            set_font_colors(outputs_walk->bargc, fg_color, bg_color);
-            draw_text(binding.name, outputs_walk->buffer, outputs_walk->bargc, i + 5, 3, binding.width);
-
-            unhide = true;
-        }
-
-        i = 0;
     }
+    if (binding.name && !config.disable_binding_mode_indicator)
+        unhide = true;
 
     /* Assure the bar is hidden/unhidden according to the specified hidden_state and mode */
     if (mod_pressed ||
@@ -1824,7 +2336,8 @@ void draw_bars(bool unhide) {
         hide_bars();
     }
 
-    redraw_bars();
+    draw_damaged_bars();
+    redraw_damage();
 }
 
 /*
@@ -1845,6 +2358,7 @@ void redraw_bars(void) {
                       0, 0,
                       outputs_walk->rect.w,
                       outputs_walk->rect.h);
+        outputs_walk->damage_x1 = outputs_walk->damage_x2 = 0;
         xcb_flush(xcb_connection);
     }
 }
@@ -1857,5 +2371,6 @@ void set_current_mode(struct mode *current) {
     I3STRING_FREE(binding.name);
     binding = *current;
     activated_mode = binding.name != NULL;
+    damage_workspace_buttons();
     return;
 }
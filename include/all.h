@@ -45,6 +45,8 @@
 
 #include "data.h"
 #include "util.h"
+#include "ipc_cbor.h"
+#include "ipc_io.h"
 #include "ipc.h"
 #include "tree.h"
 #include "log.h"
@@ -62,8 +64,16 @@
 #include "xinerama.h"
 #include "con.h"
 #include "load_layout.h"
+#include "restart_layout.h"
+#include "pool.h"
+#include "memory.h"
+#include "stats.h"
+#include "trace.h"
+#include "event_record.h"
+#include "tree_snapshot.h"
 #include "render.h"
 #include "window.h"
+#include "sync_request.h"
 #include "match.h"
 #include "cmdparse.h"
 #include "xcursor.h"
@@ -10,6 +10,13 @@
 #ifndef I3_ASSIGNMENTS_H
 #define I3_ASSIGNMENTS_H
 
+/**
+ * Rebuilds the index which is used to find the assignments which could match
+ * a window. Needs to be called whenever the list of assignments changed.
+ *
+ */
+void assignments_rebuild_index(void);
+
 /**
  * Checks the list of assignments for the given window and runs all matching
  * ones (unless they have already been run for this specific window).
@@ -79,6 +79,12 @@ void cmd_border(I3_CMD, char *border_style_str, char *border_width);
  */
 void cmd_nop(I3_CMD, char *comment);
 
+/**
+ * Implementation of 'batch begin|commit'.
+ *
+ */
+void cmd_batch(I3_CMD, char *action);
+
 /**
  * Implementation of 'append_layout <path>'.
  *
@@ -181,6 +187,12 @@ void cmd_focus_window_mode(I3_CMD, char *window_mode);
  */
 void cmd_focus_level(I3_CMD, char *level);
 
+/**
+ * Implementation of 'focus back_and_forth'.
+ *
+ */
+void cmd_focus_back_and_forth(I3_CMD);
+
 /**
  * Implementation of 'focus'.
  *
@@ -199,6 +211,12 @@ void cmd_fullscreen(I3_CMD, char *fullscreen_mode);
  */
 void cmd_move_direction(I3_CMD, char *direction, char *move_px);
 
+/**
+ * Implementation of 'move <direction> <steps> steps'.
+ *
+ */
+void cmd_move_direction_steps(I3_CMD, char *direction, char *steps_str);
+
 /**
  * Implementation of 'layout default|stacked|stacking|tabbed|splitv|splith'.
  *
@@ -289,4 +307,28 @@ void cmd_shmlog(I3_CMD, char *argument);
  */
 void cmd_debuglog(I3_CMD, char *argument);
 
+/**
+ * Implementation of 'debuglog filter <categories>'
+ *
+ */
+void cmd_debuglog_filter(I3_CMD, char *categories);
+
+/**
+ * Implementation of 'trace toggle|on|off'
+ *
+ */
+void cmd_trace(I3_CMD, char *argument);
+
+/**
+ * Implementation of 'trace dump <file>'
+ *
+ */
+void cmd_trace_dump(I3_CMD, char *filename);
+
+/**
+ * Implementation of 'tree_snapshot toggle|on|off'
+ *
+ */
+void cmd_tree_snapshot(I3_CMD, char *argument);
+
 #endif
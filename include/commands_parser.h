@@ -22,7 +22,8 @@
  *
  */
 struct CommandResult {
-    /* The JSON generator to append a reply to. */
+    /* The JSON generator to append a reply to, NULL if the caller does not
+     * need a JSON reply. */
     yajl_gen json_gen;
 
     /* The next state to transition to. Passed to the function so that we can
@@ -32,8 +33,49 @@ struct CommandResult {
 
     /* Whether the command requires calling tree_render. */
     bool needs_tree_render;
+
+    /* Whether (part of) the command could not be parsed. */
+    bool parse_error;
+
+    /* Whether any of the commands failed (including parse errors). */
+    bool failed;
+
+    /* Number of 'batch begin' minus number of 'batch commit' commands. */
+    int batch;
 };
 
-struct CommandResult *parse_command(const char *input);
+/* A command which was parsed once and can be executed repeatedly, see
+ * compile_command(). */
+struct CompiledCommand;
+
+/**
+ * Parses and executes the given command. If gen is not NULL, the reply (a
+ * JSON array with one result per command) is generated into it.
+ *
+ */
+struct CommandResult *parse_command(const char *input, yajl_gen gen);
+
+/**
+ * Parses the given command once, without executing it, and returns the
+ * sequence of calls it consists of, so that it can be executed repeatedly
+ * (see run_compiled_command()) without going through the parser again. Used
+ * for key bindings. Returns NULL if the command cannot be parsed.
+ *
+ */
+struct CompiledCommand *compile_command(const char *input);
+
+/**
+ * Executes a command which was compiled using compile_command(). The result
+ * is the same as if the command had been passed to parse_command() (with the
+ * same gen).
+ *
+ */
+struct CommandResult *run_compiled_command(struct CompiledCommand *compiled, yajl_gen gen);
+
+/**
+ * Frees a command compiled using compile_command().
+ *
+ */
+void free_compiled_command(struct CompiledCommand *compiled);
 
 #endif
@@ -12,6 +12,33 @@
 #ifndef I3_CON_H
 #define I3_CON_H
 
+/**
+ * Marks the given container and all its parents as dirty, meaning that the
+ * next tree_render() has to recompute their geometry. This needs to be called
+ * whenever something which render_con() depends on changes, except for the
+ * rect of the container itself (which is compared directly).
+ *
+ */
+void con_mark_dirty(Con *con);
+
+/**
+ * Records that the given container changed in the current tree generation,
+ * so that it is part of the next GET_TREE_DELTA reply. Called by
+ * con_mark_dirty() and render_con(), and also needs to be called for changes
+ * which do not affect the geometry (title, urgency, marks, …). The output of
+ * the container is rendered in the next tree_render() (see
+ * Con.output_changed).
+ *
+ */
+void con_mark_changed(Con *con);
+
+/**
+ * Marks every container as dirty, for example after reloading the
+ * configuration (which may change the font and thus the decoration height).
+ *
+ */
+void con_mark_all_dirty(void);
+
 /**
  * Create a new container (and attach it to the given parent, if not NULL).
  * This function only initializes the data structures.
@@ -83,6 +110,13 @@ Con *con_parent_with_orientation(Con *con, orientation_t orientation);
  */
 Con *con_get_fullscreen_con(Con *con, int fullscreen_mode);
 
+/**
+ * Sets the fullscreen_mode of the given container. The fullscreen_mode must
+ * not be changed directly, see con_get_fullscreen_con().
+ *
+ */
+void con_set_fullscreen_mode(Con *con, int fullscreen_mode);
+
 /**
  * Returns true if the container is internal, such as __i3_scratch
  *
@@ -108,6 +142,21 @@ Con *con_inside_floating(Con *con);
  */
 bool con_inside_focused(Con *con);
 
+/**
+ * Returns true if the given container (still) exists.
+ *
+ */
+bool con_exists(Con *con);
+
+/**
+ * Returns true if the given container still exists and is the one which had
+ * the given serial, i.e. it was not closed (and its memory reused for a new
+ * container) in the meantime. Use this instead of con_exists() for pointers
+ * kept across the event loop.
+ *
+ */
+bool con_still_exists(Con *con, uint64_t serial);
+
 /**
  * Returns the container with the given client window ID or NULL if no such
  * container exists.
@@ -122,6 +171,88 @@ Con *con_by_window_id(xcb_window_t window);
  */
 Con *con_by_frame_id(xcb_window_t frame);
 
+/**
+ * Sets the client window of the given container (NULL to unset it) and keeps
+ * the index used by con_by_window_id() up to date. Always use this instead of
+ * assigning con->window directly.
+ *
+ */
+void con_set_window(Con *con, i3Window *window);
+
+/**
+ * Returns the most recently focused container with a window, except for the
+ * currently focused one, or NULL if there is none. Focusing a window moves it
+ * to the front of a global list, so this does not need to search the tree.
+ *
+ */
+Con *con_focus_history_previous(void);
+
+/**
+ * Returns the container whose window most recently became urgent (see
+ * Window.urgent) or NULL if there is none.
+ *
+ */
+Con *con_latest_urgent(void);
+
+/**
+ * Returns the container whose window has been urgent the longest (see
+ * Window.urgent) or NULL if there is none.
+ *
+ */
+Con *con_oldest_urgent(void);
+
+/**
+ * Returns the container with the given mark or NULL if no such container
+ * exists.
+ *
+ */
+Con *con_by_mark(const char *mark);
+
+/**
+ * Sets the mark of the given container to a copy of 'mark' (NULL to unset it)
+ * and keeps the marked_cons list and the index used by con_by_mark() up to
+ * date. Always use this instead of assigning con->mark directly.
+ *
+ */
+void con_set_mark(Con *con, const char *mark);
+
+/**
+ * Adds the frame of the given container to the index used by
+ * con_by_frame_id(). Called by x_con_init() once the frame was created.
+ *
+ */
+void con_index_frame(Con *con);
+
+/**
+ * Removes the frame of the given container from the index used by
+ * con_by_frame_id(). Called by x_con_kill() before the frame is destroyed.
+ *
+ */
+void con_unindex_frame(Con *con);
+
+/**
+ * Adds the given swallow match (which has to be complete, i.e. all criteria
+ * are set) of the given container to the index used by con_for_window().
+ * Has to be called for every match which is added to a swallow_head.
+ *
+ */
+void con_index_swallow(Con *con, Match *match);
+
+/**
+ * Removes all swallow matches of the given container from the index used by
+ * con_for_window(). Called by tree_close() before the matches are freed.
+ *
+ */
+void con_unindex_swallows(Con *con);
+
+/**
+ * Returns true if a depth-first walk of the tree (a container before its
+ * children, tiling before floating children) visits 'a' before 'b'. Both have
+ * to be part of the same tree.
+ *
+ */
+bool con_precedes(Con *a, Con *b);
+
 /**
  * Returns the first container below 'con' which wants to swallow this window
  * TODO: priority
@@ -135,6 +266,31 @@ Con *con_for_window(Con *con, i3Window *window, Match **store_match);
  */
 int con_num_children(Con *con);
 
+/**
+ * Returns the tiling children of the given container (in the order of
+ * nodes_head) as an array and stores their number in *count. The array is
+ * cached until con_children_changed() is called, so it must neither be
+ * modified nor used after changing the tree.
+ *
+ */
+Con **con_children(Con *con, int *count);
+
+/**
+ * Invalidates the array returned by con_children(), the number of urgent
+ * children and the sizes cached by render_con(). Needs to be called whenever nodes_head of the given container was
+ * changed without using con_attach() or con_detach().
+ *
+ */
+void con_children_changed(Con *con);
+
+/**
+ * Returns a number which changes whenever containers are attached, detached
+ * or moved, so that callers can cache things computed from the tree
+ * structure.
+ *
+ */
+unsigned int con_tree_structure(void);
+
 /**
  * Attaches the given container to the given parent. This happens when moving
  * a container or when inserting a new container at a specific place in the
@@ -187,6 +343,15 @@ void con_toggle_fullscreen(Con *con, int fullscreen_mode);
  */
 void con_move_to_workspace(Con *con, Con *workspace, bool fix_coordinates, bool dont_warp);
 
+/**
+ * Moves all of the given containers to the given workspace, like calling
+ * con_move_to_workspace() for each of them. The startup sequences of all
+ * moved windows are looked up together afterwards, which saves one round
+ * trip to the X server per window.
+ *
+ */
+void con_move_many_to_workspace(Con **cons, int num, Con *workspace);
+
 /**
  * Returns the orientation of the given container (for stacked containers,
  * vertical orientation is used regardless of the actual orientation of the
@@ -317,7 +482,8 @@ Rect con_minimum_size(Con *con);
 bool con_fullscreen_permits_focusing(Con *con);
 
 /**
- * Checks if the given container has an urgent child.
+ * Checks if the given container has an urgent child. For workspaces, this
+ * includes floating windows.
  *
  */
 bool con_has_urgent_child(Con *con);
@@ -326,6 +492,9 @@ bool con_has_urgent_child(Con *con);
  * Make all parent containers urgent if con is urgent or clear the urgent flag
  * of all parent containers if there are no more urgent children left.
  *
+ * Every container counts its urgent children, so this only walks up as far as
+ * the urgency of the parents changes.
+ *
  */
 void con_update_parents_urgency(Con *con);
 
@@ -336,9 +505,17 @@ void con_update_parents_urgency(Con *con);
 void con_set_urgency(Con *con, bool urgent);
 
 /**
- * Create a string representing the subtree under con.
+ * Create a string representing the subtree under con. The string is cached
+ * in con and must not be freed or used after changing the tree.
+ *
+ */
+const char *con_get_tree_representation(Con *con);
+
+/**
+ * Invalidates the cached tree representations, e.g. because the
+ * WM_CLASS of a window changed.
  *
  */
-char *con_get_tree_representation(Con *con);
+void con_tree_representations_changed(void);
 
 #endif
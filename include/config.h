@@ -65,9 +65,12 @@ struct Colortriple {
 struct Variable {
     char *key;
     char *value;
-    char *next_match;
+    size_t key_length;
+    /** Order in which the variables were set, later ones take precedence */
+    int index;
 
     SLIST_ENTRY(Variable) variables;
+    SLIST_ENTRY(Variable) bucket;
 };
 
 /**
@@ -93,6 +96,24 @@ struct Config {
     i3Font font;
 
     char *ipc_socket_path;
+
+    /** Maximum amount of unread output (in bytes) an IPC client may have
+     * before i3 disconnects it, so that a stuck subscriber cannot make i3
+     * buffer events forever. 0 means unlimited. */
+    size_t ipc_buffer_limit;
+
+    /** Write the output of IPC clients in a separate thread (see
+     * ipc_io.c). Only takes effect when i3 is started. */
+    bool ipc_thread;
+
+    /** Draw printable ASCII window titles with cached glyphs instead of
+     * Pango (see set_font_glyph_cache()). */
+    bool glyph_cache;
+
+    /** Start one i3bar process for all bars which only differ in their id
+     * and outputs (see barconfig_can_share_process()). Only takes effect
+     * when i3 is started. */
+    bool shared_i3bar;
     const char *restart_state_path;
 
     layout_t default_layout;
@@ -157,6 +178,17 @@ struct Config {
      * flag can be delayed using an urgency timer. */
     float workspace_urgency_timer;
 
+    /** Whether the calls which parsing the config file resulted in are
+     * cached, so that the next start does not need to parse the file again
+     * if it did not change (see parse_file()). */
+    bool config_cache;
+
+    /** RandR screen change notifications (which arrive in bursts when
+     * plugging in a dock, for example) are handled once no further
+     * notification arrived for this many seconds. 0 handles every
+     * notification right away. */
+    float screen_change_delay;
+
     /** The default border style for new windows. */
     border_style_t default_border;
 
@@ -200,6 +232,26 @@ struct Config {
         PDF_IGNORE = 2,
     } popup_during_fullscreen;
 
+    /** What to show while resizing tiling containers with the mouse */
+    enum {
+        /* only move a line to the new border position, resize when the
+         * button is released */
+        TR_OUTLINE = 0,
+
+        /* resize the containers while dragging */
+        TR_LIVE = 1,
+    } tiling_resize;
+
+    /** What to show while moving floating windows with the mouse */
+    enum {
+        /* move the window itself */
+        FM_OPAQUE = 0,
+
+        /* only move an outline, move the window when the button is
+         * released */
+        FM_OUTLINE = 1,
+    } floating_move;
+
     /* The number of currently parsed barconfigs */
     int number_barconfigs;
 };
@@ -274,6 +326,17 @@ struct Barconfig {
     /** Enable verbose mode? Useful for debugging purposes. */
     bool verbose;
 
+    /** Maximum number of statusline redraws per second, 0 for no limit.
+     * Status lines which arrive faster are merged. */
+    int status_refresh_rate;
+
+    /** Render the statusline client-side and upload it as an image? Only
+     * works with Pango fonts. */
+    bool client_side_rendering;
+
+    /** Draw printable ASCII text with cached glyphs instead of Pango? */
+    bool glyph_cache;
+
     struct bar_colors {
         char *background;
         char *statusline;
@@ -308,6 +371,13 @@ struct Barconfig {
  */
 void load_configuration(xcb_connection_t *conn, const char *override_configfile, bool reload);
 
+/**
+ * Makes the next translate_keysyms() look at the keyboard mapping again.
+ * Needs to be called whenever the keyboard mapping changes.
+ *
+ */
+void invalidate_keysym_map(void);
+
 /**
  * Translates keysymbols to keycodes for all bindings which use keysyms.
  *
@@ -327,6 +397,17 @@ void ungrab_all_keys(xcb_connection_t *conn);
  */
 void grab_all_keys(xcb_connection_t *conn, bool bind_mode_switch);
 
+/**
+ * Changes the key grabs to what ungrab_all_keys() followed by
+ * grab_all_keys(conn, bind_mode_switch) would result in, but only ungrabs
+ * the keys which are no longer bound and only grabs the newly bound ones.
+ * This avoids a window in which no keys are grabbed and only sends a few
+ * requests if the bindings barely changed (e.g. on reload, when switching
+ * modes or when the keyboard mapping changes).
+ *
+ */
+void update_key_grabs(xcb_connection_t *conn, bool bind_mode_switch);
+
 /**
  * Switches the key bindings to the given mode, if the mode exists
  *
@@ -339,6 +420,14 @@ void switch_mode(const char *new_mode);
  *
  */void update_barconfig();
 
+/**
+ * Returns true if one i3bar process can serve both bars (see shared_i3bar):
+ * their configuration must be the same, except for the id and the outputs,
+ * which must be explicitly set and must not overlap.
+ *
+ */
+bool barconfig_can_share_process(Barconfig *a, Barconfig *b);
+
 /**
  * Returns a pointer to the Binding with the specified modifiers and keycode
  * or NULL if no such binding exists.
@@ -40,16 +40,24 @@ CFGFUN(floating_maximum_size, const long width, const long height);
 CFGFUN(default_orientation, const char *orientation);
 CFGFUN(workspace_layout, const char *layout);
 CFGFUN(workspace_back_and_forth, const char *value);
+CFGFUN(config_cache, const char *value);
 CFGFUN(focus_follows_mouse, const char *value);
 CFGFUN(force_focus_wrapping, const char *value);
 CFGFUN(force_xinerama, const char *value);
 CFGFUN(fake_outputs, const char *outputs);
 CFGFUN(force_display_urgency_hint, const long duration_ms);
+CFGFUN(screen_change_delay, const long delay_ms);
 CFGFUN(hide_edge_borders, const char *borders);
 CFGFUN(assign, const char *workspace);
 CFGFUN(ipc_socket, const char *path);
+CFGFUN(ipc_buffer_limit, const long size_kb);
+CFGFUN(ipc_thread, const char *value);
+CFGFUN(glyph_cache, const char *value);
+CFGFUN(shared_i3bar, const char *value);
 CFGFUN(restart_state, const char *path);
 CFGFUN(popup_during_fullscreen, const char *value);
+CFGFUN(tiling_resize, const char *value);
+CFGFUN(floating_move, const char *value);
 CFGFUN(color, const char *colorclass, const char *border, const char *background, const char *text, const char *indicator);
 CFGFUN(color_single, const char *colorclass, const char *color);
 CFGFUN(floating_modifier, const char *modifiers);
@@ -66,6 +74,9 @@ CFGFUN(bar_hidden_state, const char *hidden_state);
 CFGFUN(bar_id, const char *bar_id);
 CFGFUN(bar_output, const char *output);
 CFGFUN(bar_verbose, const char *verbose);
+CFGFUN(bar_status_refresh_rate, const long rate);
+CFGFUN(bar_client_side_rendering, const char *value);
+CFGFUN(bar_glyph_cache, const char *value);
 CFGFUN(bar_modifier, const char *modifier);
 CFGFUN(bar_position, const char *position);
 CFGFUN(bar_i3bar_command, const char *i3bar_command);
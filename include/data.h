@@ -14,6 +14,7 @@
 #include <libsn/sn-launcher.h>
 
 #include <xcb/randr.h>
+#include <xcb/sync.h>
 #include <stdbool.h>
 #include <pcre.h>
 #include <sys/time.h>
@@ -162,11 +163,11 @@ struct Workspace_Assignment {
 };
 
 struct Ignore_Event {
+    /* The range of ignored sequence numbers (both inclusive, usually equal) */
     int sequence;
+    int last_sequence;
     int response_type;
     time_t added;
-
-    SLIST_ENTRY(Ignore_Event) ignore_events;
 };
 
 /**
@@ -185,7 +186,10 @@ struct Startup_Sequence {
      * completed) */
     time_t delete_at;
 
-    TAILQ_ENTRY(Startup_Sequence) sequences;
+    /** Sequences are hashed by id */
+    LIST_ENTRY(Startup_Sequence) by_id;
+    /** Completed sequences, in the order in which they will be deleted */
+    TAILQ_ENTRY(Startup_Sequence) completed;
 };
 
 /**
@@ -201,6 +205,43 @@ struct regex {
     char *pattern;
     pcre *regex;
     pcre_extra *extra;
+    /* Unique (never reused) number of this regex, see struct regex_memo. */
+    uint32_t id;
+
+    /* Regexes are shared between all users of the same pattern, see
+     * regex_new(). When the last user calls regex_free(), the regex is kept
+     * on the list of unused regexes for a while, so that commands which are
+     * sent over and over do not compile their criteria every time. */
+    int refcount;
+    SLIST_ENTRY(regex) regexes;
+    TAILQ_ENTRY(regex) unused;
+};
+
+/**
+ * The window properties which are matched using regular expressions (see
+ * match_matches_window()).
+ *
+ */
+typedef enum {
+    WP_CLASS = 0,
+    WP_INSTANCE = 1,
+    WP_TITLE = 2,
+    WP_ROLE = 3
+} window_property_t;
+
+#define WINDOW_NUM_PROPERTIES 4
+#define WINDOW_REGEX_MEMO_SIZE 16
+
+/**
+ * A memoized result of matching a regular expression against a window
+ * property. It is only valid while the property’s generation is unchanged.
+ *
+ */
+struct regex_memo {
+    uint32_t regex_id;
+    uint32_t generation;
+    window_property_t property;
+    bool result;
 };
 
 /******************************************************************************
@@ -252,6 +293,10 @@ struct Binding {
     /** Command, like in command mode */
     char *command;
 
+    /** The command as returned by compile_command(), or NULL if it could not
+     * be parsed. */
+    struct CompiledCommand *compiled;
+
     TAILQ_ENTRY(Binding) bindings;
 };
 
@@ -302,7 +347,16 @@ struct xoutput {
     /** x, y, width, height */
     Rect rect;
 
+    /** Cached results of get_output_next() by direction and close_far. They
+     * are valid as long as next_generation matches the generation of the
+     * output index (see src/randr.c). */
+    struct xoutput *next[4][2];
+    bool next_valid[4][2];
+    unsigned int next_generation;
+
     TAILQ_ENTRY(xoutput) outputs;
+    /** Entry in the index of RandR outputs by id (see src/randr.c) */
+    LIST_ENTRY(xoutput) by_id;
 };
 
 /**
@@ -343,6 +397,20 @@ struct Window {
     /** Whether the application needs to receive WM_TAKE_FOCUS */
     bool needs_take_focus;
 
+    /** The XSync counter the client updates after it handled a
+     * _NET_WM_SYNC_REQUEST, XCB_NONE if it does not support the protocol
+     * (see sync_request.c). */
+    xcb_sync_counter_t sync_counter;
+    /** The alarm which triggers once the counter reaches sync_value */
+    xcb_sync_alarm_t sync_alarm;
+    /** The value sent with the last _NET_WM_SYNC_REQUEST */
+    uint64_t sync_value;
+    /** When the last _NET_WM_SYNC_REQUEST was sent (see stats_now()), 0 once
+     * the client acknowledged it */
+    uint64_t sync_sent;
+    /** Whether a new size was held back while waiting for the client */
+    bool sync_deferred;
+
     /** Whether this window accepts focus. We store this inverted so that the
      * default will be 'accepts focus'. */
     bool doesnt_accept_focus;
@@ -358,6 +426,14 @@ struct Window {
 
     /** Depth of the window */
     uint16_t depth;
+
+    /** Incremented whenever the corresponding window_property_t changes, which
+     * invalidates the memoized regex results for it. */
+    uint32_t property_generation[WINDOW_NUM_PROPERTIES];
+
+    /** Recent regex results for this window’s properties, see
+     * match_matches_window(). */
+    struct regex_memo regex_memo[WINDOW_REGEX_MEMO_SIZE];
 };
 
 /**
@@ -408,6 +484,12 @@ struct Match {
      * Leads to not setting focus when managing a new window, because the old
      * focus stack should be restored. */
     bool restart_mode;
+
+    /** For swallow matches: the container which swallows the matching
+     * windows, as long as the match is in the index used by con_for_window()
+     * (see con_index_swallow()). NULL otherwise. */
+    Con *swallow_con;
+    LIST_ENTRY(Match) swallow_bucket;
 };
 
 /**
@@ -457,10 +539,65 @@ struct Assignment {
 struct Con {
     bool mapped;
 
+    /** Set when this container or one of its descendants changed in a way
+     * which requires render_con() to recompute the geometry (children,
+     * layout, percentages, borders, fullscreen mode, …). Use con_mark_dirty()
+     * to set it, it is cleared at the end of tree_render(). */
+    bool dirty;
+
+    /** Set instead of clearing dirty when the container was not rendered
+     * (because it is on an invisible workspace). The next render_con() call
+     * recomputes the geometry of the whole subtree. */
+    bool layout_stale;
+
+    /** Whether this container (or one of its descendants) was rendered during
+     * the last render pass, i.e. is on a visible workspace (or on one of the
+     * recently shown workspaces, see workspace_render_recent()). Unlike
+     * mapped, this is not modified by x.c. */
+    bool rendered;
+
+    /** Only used for outputs: set by con_mark_changed() when anything on this
+     * output changed since the last render pass, and render_skip is set by
+     * tree_render() on the outputs it does not render and push because
+     * nothing on them changed (see tree_render()). */
+    bool output_changed;
+    bool render_skip;
+
+    /** The rect and fullscreen flag with which render_con() last computed
+     * the geometry inside this container. If the container is not dirty and
+     * both are unchanged, the geometry is still up to date. */
+    struct Rect render_rect;
+    bool render_fullscreen;
+
+    /** Set by render_con() if this container is inside a stacked or tabbed
+     * container, but is not (inside) its visible child. x_push_node() does
+     * not resize the client windows of hidden containers until they become
+     * visible, the frames clip them in the meantime. */
+    bool hidden;
+
+    /** The tree generation (see tree_generation) in which this container
+     * itself last changed, and in which anything in its subtree last changed.
+     * Used to answer GET_TREE_DELTA requests. */
+    uint64_t generation;
+    uint64_t subtree_generation;
+
+    /** Unique for every container ever created. Containers are allocated
+     * from a pool, so a new container can get the address of one which was
+     * closed before; the serial tells them apart (see con_still_exists()). */
+    uint64_t serial;
+
     /* Should this container be marked urgent? This gets set when the window
      * inside this container (if any) sets the urgency hint, for example. */
     bool urgent;
 
+    /** Number of children (tiling and floating) whose urgent flag is set, so
+     * that urgency can be propagated without looking at the siblings. Like
+     * the children array, it is recounted after con_children_changed(). */
+    int urgent_children;
+    bool urgent_children_valid;
+    /** Whether this container is included in its parent’s urgent_children */
+    bool urgent_counted;
+
     /** This counter contains the number of UnmapNotify events for this
      * container (or, more precisely, for its ->frame) which should be ignored.
      * UnmapNotify events need to be ignored when they are caused by i3 itself,
@@ -507,6 +644,19 @@ struct Con {
 
     double percent;
 
+    /* The size (in pixels, along the orientation of the parent) which
+     * render_con() assigned to this container, and the percent and position
+     * it was computed from. Valid while the parent’s size_cache_total and
+     * size_cache_children did not change either (see split_sizes()). */
+    int size_cache_pixels;
+    double size_cache_percent;
+    int size_cache_index;
+    /* The width or height and the number of children the sizes of the
+     * children were last computed for, 0 if they were never computed or the
+     * children changed since then (see con_children_changed()). */
+    int size_cache_total;
+    int size_cache_children;
+
     /* aspect ratio from WM_NORMAL_HINTS (MPlayer uses this for example) */
     double aspect_ratio;
     /* the wanted size of the window, used in combination with size
@@ -524,8 +674,17 @@ struct Con {
 
     struct Window *window;
 
-    /* timer used for disabling urgency */
-    struct ev_timer *urgency_timer;
+    /* Whether the urgency flag will be reset by the urgency timer (see
+     * workspace.c) and at which time (in ev_now() terms) */
+    bool urgency_timer_active;
+    double urgency_reset_at;
+    TAILQ_ENTRY(Con) urgency_timers;
+
+    /* Whether a ConfigureRequest moved or resized this floating container
+     * and the geometry it asked for (see floating_reposition_later()) */
+    bool reposition_pending;
+    Rect reposition_rect;
+    TAILQ_ENTRY(Con) pending_repositions;
 
     /** Cache for the decoration rendering */
     struct deco_render_params *deco_render_params;
@@ -534,11 +693,49 @@ struct Con {
     TAILQ_HEAD(floating_head, Con) floating_head;
 
     TAILQ_HEAD(nodes_head, Con) nodes_head;
+    /* Contiguous copy of nodes_head for read-mostly traversals like
+     * rendering, see con_children(). */
+    Con **children;
+    int num_children;
+    int children_size;
+    bool children_valid;
+
+    /** For CT_DOCKAREAs: the sum of the heights of all dock clients, cached
+     * by render_l_output(). Invalidated when dock clients are attached,
+     * detached or change their height. */
+    uint32_t dock_height;
+    bool dock_height_valid;
+
+    /** Cached results of con_get_workspace() and con_get_output(). They are
+     * valid as long as the parent is the same and the structure of the tree
+     * did not change since (see con_children_changed()). */
+    Con *cached_workspace;
+    Con *cached_workspace_parent;
+    unsigned int cached_workspace_structure;
+    Con *cached_output;
+    Con *cached_output_parent;
+    unsigned int cached_output_structure;
+
+    /** Index of this workspace for _NET_CURRENT_DESKTOP, valid as long as
+     * the tree structure did not change (see ewmh_update_current_desktop()) */
+    uint32_t ewmh_desktop_index;
+
+    /** Cached result of con_get_tree_representation(), see there */
+    char *tree_repr;
+    size_t tree_repr_length;
+    size_t tree_repr_size;
+    layout_t tree_repr_layout;
+    unsigned int tree_repr_structure;
+    unsigned int tree_repr_serial;
     TAILQ_HEAD(focus_head, Con) focus_head;
 
     TAILQ_HEAD(swallow_head, Match) swallow_head;
 
     enum { CF_NONE = 0, CF_OUTPUT = 1, CF_GLOBAL = 2 } fullscreen_mode;
+    /** Containers which are fullscreen are on a list, see
+     * con_set_fullscreen_mode() */
+    TAILQ_ENTRY(Con) fullscreen_cons;
+    bool fullscreen_indexed;
     /* layout is the layout of this container: one of split[v|h], stacked or
      * tabbed. Special containers in the tree (above workspaces) have special
      * layouts like dockarea or output.
@@ -571,6 +768,15 @@ struct Con {
     TAILQ_ENTRY(Con) nodes;
     TAILQ_ENTRY(Con) focused;
     TAILQ_ENTRY(Con) all_cons;
+    TAILQ_ENTRY(Con) marked_cons;
+    SLIST_ENTRY(Con) mark_bucket;
+    /** Workspaces are hashed by name for get_existing_workspace_by_name() */
+    LIST_ENTRY(Con) workspace_bucket;
+    bool workspace_indexed;
+    /** Containers with a sticky_group are hashed by it, see
+     * workspace_index_sticky() */
+    LIST_ENTRY(Con) sticky_bucket;
+    bool sticky_indexed;
     TAILQ_ENTRY(Con) floating_windows;
 
     /** callbacks */
@@ -587,6 +793,20 @@ struct Con {
         /* The user changed position/size of the scratchpad window. */
         SCRATCHPAD_CHANGED = 2
     } scratchpad_state;
+    /** Containers with a scratchpad_state are on a list, see
+     * scratchpad_index() */
+    TAILQ_ENTRY(Con) scratchpad_cons;
+    bool scratchpad_indexed;
+
+    /** Containers with a window are on the focus history (most recently
+     * focused first) once they were focused, see con_focus_history_previous()
+     * */
+    TAILQ_ENTRY(Con) focus_history;
+    bool in_focus_history;
+    /** Containers whose window has an urgency timestamp (Window.urgent) are
+     * on a list sorted by it, see con_latest_urgent() */
+    TAILQ_ENTRY(Con) urgent_cons;
+    bool in_urgent_cons;
 
     /* The ID of this container before restarting. Necessary to correctly
      * interpret back-references in the JSON (such as the focus stack). */
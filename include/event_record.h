@@ -0,0 +1,45 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009-2013 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * event_record.c: Records the X11 events and commands i3 handles into a
+ *                 binary file (see --record-events), which can be replayed by
+ *                 testcases/bench/400-replay-events.t.
+ *
+ */
+#ifndef I3_EVENT_RECORD_H
+#define I3_EVENT_RECORD_H
+
+/** Whether events are currently recorded (see --record-events) */
+extern bool event_recording;
+
+/**
+ * Starts appending the handled events to the given file. Needs the X11
+ * connection to resolve atom names. Returns false if the file could not be
+ * opened.
+ *
+ */
+bool event_record_start(const char *filename);
+
+/**
+ * Records the given X11 event. Does nothing unless recording is enabled.
+ *
+ */
+void event_record_event(const xcb_generic_event_t *event);
+
+/**
+ * Records a command which was run because of a key binding or an IPC
+ * message. Does nothing unless recording is enabled.
+ *
+ */
+void event_record_command(const char *command);
+
+/**
+ * Flushes and closes the recording. Called before exiting or restarting.
+ *
+ */
+void event_record_stop(void);
+
+#endif
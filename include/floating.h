@@ -177,6 +177,29 @@ drag_result_t drag_pointer(Con *con, const xcb_button_press_event_t *event,
  */
 void floating_reposition(Con *con, Rect newrect);
 
+/**
+ * Like floating_reposition(), but only remembers the new coordinates until
+ * floating_apply_repositions() is called. Used for ConfigureRequests, so that
+ * clients which move or resize their windows many times per second (think of
+ * animations) only get the latest geometry applied, once per loop iteration.
+ *
+ */
+void floating_reposition_later(Con *con, Rect newrect);
+
+/**
+ * Applies the coordinates remembered by floating_reposition_later() and
+ * renders the tree once.
+ *
+ */
+void floating_apply_repositions(void);
+
+/**
+ * Forgets the coordinates remembered by floating_reposition_later() for the
+ * given container. Called by tree_close() before the container is freed.
+ *
+ */
+void floating_cancel_reposition(Con *con);
+
 /**
  * Fixes the coordinates of the floating window whenever the window gets
  * reassigned to a different output (or when the output’s rect changes).
@@ -14,17 +14,34 @@
 #include <xcb/randr.h>
 
 extern int randr_base;
+extern int sync_base;
 
 /**
  * Adds the given sequence to the list of events which are ignored.
  * If this ignore should only affect a specific response_type, pass
  * response_type, otherwise, pass -1.
  *
- * Every ignored sequence number gets garbage collected after 5 seconds.
+ * The entry is dropped as soon as an event with a later sequence number is
+ * checked, or after 5 seconds.
  *
  */
 void add_ignore_event(const int sequence, const int response_type);
 
+/**
+ * Returns the number of sequences which are currently ignored (see
+ * add_ignore_event()). Stale entries are only removed when the next event
+ * arrives, so they are included.
+ *
+ */
+int ignore_events_num(void);
+
+/**
+ * Like add_ignore_event(), but ignores all sequence numbers from first to last
+ * (both inclusive), i.e. all events caused by the requests in between.
+ *
+ */
+void add_ignore_event_range(const int first, const int last, const int response_type);
+
 /**
  * Checks if the given sequence is ignored and returns true if so.
  *
@@ -38,6 +55,20 @@ bool event_is_ignored(const int sequence, const int response_type);
  */
 void handle_event(int type, xcb_generic_event_t *event);
 
+/**
+ * Calls the property handlers for all PropertyNotify events received so far,
+ * in the order in which the properties last changed.
+ *
+ */
+void handle_pending_properties(void);
+
+/**
+ * Copies the areas of all frames which were exposed since the last call from
+ * the pixmaps to the frames.
+ *
+ */
+void handle_pending_exposes(void);
+
 /**
  * Sets the appropriate atoms for the property handlers after the atoms were
  * received from X11
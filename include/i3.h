@@ -63,4 +63,12 @@ extern xcb_window_t root;
 extern struct ev_loop *main_loop;
 extern bool only_check_config;
 
+/**
+ * Enable or disable the main X11 event handling function. This is used by
+ * drag_pointer() which has its own, modal event handler, which takes
+ * precedence over the normal event handler.
+ *
+ */
+void main_set_x11_cb(bool enable);
+
 #endif
@@ -52,6 +52,28 @@ typedef struct i3_ipc_header {
 /** Request the i3 version */
 #define I3_IPC_MESSAGE_TYPE_GET_VERSION         7
 
+/** Request the containers which changed since a given tree generation */
+#define I3_IPC_MESSAGE_TYPE_GET_TREE_DELTA      8
+
+/** Request the occupancy of i3's object pools */
+#define I3_IPC_MESSAGE_TYPE_GET_POOL_STATS      9
+
+/** Request the latency statistics of event handlers, IPC messages and
+ * commands */
+#define I3_IPC_MESSAGE_TYPE_GET_STATS           10
+
+/** Select the encoding of replies and events (JSON or CBOR) */
+#define I3_IPC_MESSAGE_TYPE_SET_ENCODING        11
+
+/** Request the number of objects and bytes of each object type */
+#define I3_IPC_MESSAGE_TYPE_GET_MEMORY          12
+
+/** If this bit is set in the type of a message, the first 4 bytes of its
+ * payload are a request id (in native byte order) chosen by the client. The
+ * reply has the same bit set and starts with the same id, so that clients can
+ * have several requests in flight. */
+#define I3_IPC_REQUEST_ID_FLAG                  (1 << 30)
+
 /*
  * Messages from i3 to clients
  *
@@ -81,6 +103,21 @@ typedef struct i3_ipc_header {
 /** i3 version reply type */
 #define I3_IPC_REPLY_TYPE_VERSION               7
 
+/** Tree delta reply type */
+#define I3_IPC_REPLY_TYPE_TREE_DELTA            8
+
+/** Pool stats reply type */
+#define I3_IPC_REPLY_TYPE_POOL_STATS            9
+
+/** Latency stats reply type */
+#define I3_IPC_REPLY_TYPE_STATS                 10
+
+/** Encoding switch reply type */
+#define I3_IPC_REPLY_TYPE_SET_ENCODING          11
+
+/** Memory usage reply type */
+#define I3_IPC_REPLY_TYPE_MEMORY                12
+
 /*
  * Events from i3 to clients. Events have the first bit set high.
  *
@@ -102,4 +139,7 @@ typedef struct i3_ipc_header {
 /** Bar config update will be triggered to update the bar config */
 #define I3_IPC_EVENT_BARCONFIG_UPDATE           (I3_IPC_EVENT_MASK | 4)
 
+/** The shutdown event will be triggered when i3 exits or restarts */
+#define I3_IPC_EVENT_SHUTDOWN                   (I3_IPC_EVENT_MASK | 5)
+
 #endif
@@ -22,14 +22,89 @@
 
 extern char *current_socketpath;
 
+/* Number of event types (I3_IPC_EVENT_*). The lower bits of an event’s
+ * message type are used as index into the per-event subscriber lists. */
+#define IPC_NUM_EVENT_TYPES 6
+#define IPC_EVENT_INDEX(message_type) ((message_type) & ~I3_IPC_EVENT_MASK)
+
+/*
+ * Restricts which window events a client receives (see “Subscribing to
+ * events” in docs/ipc). Criteria which are not set match every window.
+ *
+ */
+typedef struct ipc_window_filter {
+    /* The change types (e.g. "new") to send, or none for all of them */
+    char **changes;
+    int num_changes;
+
+    struct regex *class;
+    struct regex *instance;
+    char *workspace;
+} ipc_window_filter;
+
+/** Encodings of replies and events, see SET_ENCODING in docs/ipc */
+typedef enum {
+    IPC_ENCODING_JSON = 0,
+    IPC_ENCODING_CBOR = 1
+} ipc_encoding_t;
+
 typedef struct ipc_client {
         int fd;
 
-        /* The events which this client wants to receive */
-        int num_events;
-        char **events;
+        /* The encoding of all replies and events for this client */
+        ipc_encoding_t encoding;
+        /* Translates the streamed reply which is currently being generated,
+         * see ipc_stream_begin(). */
+        ipc_cbor *stream_cbor;
+
+        /* Set while handling a message with a request id (see
+         * I3_IPC_REQUEST_ID_FLAG): the reply is tagged with request_id. */
+        bool tag_reply;
+        uint32_t request_id;
+
+        /* Bitmask of the events which this client wants to receive (bit n is
+         * set for the event with index n, see IPC_EVENT_INDEX) */
+        uint32_t events;
+
+        /* Only window events matching this filter are sent, if set. */
+        ipc_window_filter *window_filter;
+
+        /* If the IPC I/O thread is running, the output is written by it
+         * instead of write_callback (see ipc_push_pending()). */
+        ipc_io_conn *io;
+
+        /* Watchers for incoming messages and for the socket becoming
+         * writeable again while there is pending output. */
+        struct ev_io *read_callback;
+        struct ev_io *write_callback;
+
+        /* Output which could not be written to the socket without blocking
+         * (yet). It is flushed by write_callback. The pending output consists
+         * of buffer_size bytes starting at buffer + buffer_offset. The
+         * allocation is kept around for the next message unless it got
+         * large. */
+        uint8_t *buffer;
+        size_t buffer_capacity;
+        size_t buffer_offset;
+        size_t buffer_size;
+
+        /* Input which did not form a complete message yet, see
+         * ipc_recv_message_buffered(). */
+        ipc_recv_buffer input;
+
+        /* Number of batches (see 'batch begin') this client started and did
+         * not commit yet. They are ended when the client disconnects or when
+         * batch_timer expires (see IPC_BATCH_TIMEOUT). */
+        int batch_depth;
+        struct ev_timer *batch_timer;
+
+        /* Set once the client requested the configuration of a bar, i.e. it
+         * is an i3bar. Bars are not handed off on restart, since the new
+         * process starts its own (see ipc_handoff()). */
+        bool is_bar;
 
         TAILQ_ENTRY(ipc_client) clients;
+        TAILQ_ENTRY(ipc_client) subscribers[IPC_NUM_EVENT_TYPES];
 } ipc_client;
 
 /*
@@ -59,13 +134,42 @@ typedef void(*handler_t)(int, uint8_t*, int, uint32_t, uint32_t);
  */
 void ipc_new_client(EV_P_ struct ev_io *w, int revents);
 
+/**
+ * Starts the IPC I/O thread (see ipc_io.c) if it was enabled in the
+ * configuration. Needs to be called before the first client is accepted.
+ *
+ */
+void ipc_start_io_thread(void);
+
+/**
+ * Takes over the client connections which the previous process kept open
+ * across the inplace restart, see ipc_handoff(). The clients keep their
+ * subscriptions and encoding.
+ *
+ */
+void ipc_adopt_clients(void);
+
 /**
  * Creates the UNIX domain socket at the given path, sets it to non-blocking
- * mode, bind()s and listen()s on it.
+ * mode, bind()s and listen()s on it. After an inplace restart, the socket of
+ * the previous process is reused instead if it has the same path.
  *
  */
 int ipc_create_socket(const char *filename);
 
+/**
+ * Writes the path of the IPC socket to socket_path_file(), so that clients
+ * can find it without asking the X server for the I3_SOCKET_PATH atom.
+ *
+ */
+void ipc_publish_socket_path(void);
+
+/**
+ * Removes the file written by ipc_publish_socket_path(). Called when exiting.
+ *
+ */
+void ipc_unpublish_socket_path(void);
+
 /**
  * Sends the specified event to all IPC clients which are currently connected
  * and subscribed to this kind of event.
@@ -73,6 +177,59 @@ int ipc_create_socket(const char *filename);
  */
 void ipc_send_event(const char *event, uint32_t message_type, const char *payload);
 
+/*
+ * Callback type for ipc_send_event_lazy(): generates the event payload (a
+ * JSON map) into the given yajl_gen.
+ *
+ */
+typedef void(*ipc_serializer_t)(yajl_gen gen, void *data);
+
+/**
+ * Invalidates the cached GET_WORKSPACES and GET_OUTPUTS replies. Needs to be
+ * called whenever a workspace or an output changes (this is done implicitly
+ * by sending a workspace or output event).
+ *
+ */
+void ipc_invalidate_cached_replies(void);
+
+/**
+ * Returns true if at least one client is subscribed to the given event
+ * (I3_IPC_EVENT_*).
+ *
+ */
+bool ipc_has_subscribers(uint32_t message_type);
+
+/**
+ * Like ipc_send_event(), but the payload is only generated (by calling
+ * serialize with the given data) if any client is subscribed to the event.
+ * The payload is generated once and sent to all subscribers.
+ *
+ */
+void ipc_send_event_lazy(const char *event, uint32_t message_type,
+                         ipc_serializer_t serialize, void *data);
+
+/**
+ * Sends the window event with the given change (e.g. "new") for the given
+ * container to all subscribers whose filter it matches. The payload is only
+ * generated if it is sent to at least one client.
+ *
+ */
+void ipc_send_window_event(const char *change, Con *con);
+
+/**
+ * Prepares an inplace restart: sends the shutdown event and keeps the
+ * listening socket and the connections of idle clients open across exec(),
+ * so that the clients do not need to reconnect. They are passed on in the
+ * environment variables I3_IPC_LISTEN_FD and I3_IPC_CLIENTS (see
+ * ipc_create_socket() and ipc_adopt_clients()).
+ *
+ * Clients which are in the middle of a message (including the one which sent
+ * the restart command), still have pending output, use a window event
+ * filter or started a batch are disconnected like on exit.
+ *
+ */
+void ipc_handoff(void);
+
 /**
  * Calls shutdown() on each socket and closes it. This function to be called
  * when exiting or restarting only!
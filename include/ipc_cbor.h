@@ -0,0 +1,48 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009-2013 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * ipc_cbor.c: Encodes IPC replies and events as CBOR (RFC 7049) for clients
+ *             which requested it (see SET_ENCODING in docs/ipc).
+ *
+ */
+#ifndef I3_IPC_CBOR_H
+#define I3_IPC_CBOR_H
+
+/** Called with every chunk of CBOR output */
+typedef void (*ipc_cbor_write_t)(void *ctx, const void *data, size_t len);
+
+typedef struct ipc_cbor ipc_cbor;
+
+/**
+ * Creates an encoder which translates the JSON text passed to
+ * ipc_cbor_feed() into CBOR, which is passed to write as soon as it is
+ * available. The JSON text does not need to be complete.
+ *
+ */
+ipc_cbor *ipc_cbor_new(ipc_cbor_write_t write, void *ctx);
+
+/**
+ * Translates the next chunk of JSON text. Returns false if it is not valid
+ * JSON, in which case the output is incomplete.
+ *
+ */
+bool ipc_cbor_feed(ipc_cbor *cbor, const unsigned char *json, size_t len);
+
+/**
+ * Translates whatever is left (a number at the very end of the input) and
+ * frees the encoder. Returns false if the input was not valid JSON.
+ *
+ */
+bool ipc_cbor_finish(ipc_cbor *cbor);
+
+/**
+ * Translates the given JSON text into CBOR. Returns a buffer which has to be
+ * free()d by the caller and stores its length in *length.
+ *
+ */
+uint8_t *ipc_cbor_from_json(const unsigned char *json, size_t len, size_t *length);
+
+#endif
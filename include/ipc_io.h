@@ -0,0 +1,80 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009-2013 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * ipc_io.c: Optional thread which writes the output of IPC clients, so that
+ *           slow clients and big event fan-outs do not delay the handling of
+ *           X11 events.
+ *
+ */
+#ifndef I3_IPC_IO_H
+#define I3_IPC_IO_H
+
+/** The part of an IPC client which is owned by the I/O thread */
+typedef struct ipc_io_conn ipc_io_conn;
+
+/** Called in the main thread with the ID (see ipc_io_conn_id()) of a
+ * connection which could not be written to. The connection might have been
+ * closed in the meantime, otherwise it still needs to be closed with
+ * ipc_io_close(). */
+typedef void (*ipc_io_error_cb)(uint64_t id);
+
+/**
+ * Starts the I/O thread. Returns false if it could not be started, in which
+ * case the output has to be written by the main thread as usual.
+ *
+ */
+bool ipc_io_start(ipc_io_error_cb on_error);
+
+/**
+ * Returns true if the I/O thread is running.
+ *
+ */
+bool ipc_io_running(void);
+
+/**
+ * Creates the I/O thread’s state for the client connected on fd. From now
+ * on, the I/O thread closes fd (see ipc_io_close()).
+ *
+ */
+ipc_io_conn *ipc_io_conn_new(int fd);
+
+/**
+ * Returns the ID of the connection, which is unique for the lifetime of the
+ * process (unlike the address of conn).
+ *
+ */
+uint64_t ipc_io_conn_id(const ipc_io_conn *conn);
+
+/**
+ * Queues len bytes starting at data + offset to be written to the
+ * connection. Takes ownership of data, which has been allocated with
+ * malloc(). Never blocks unless the queue to the I/O thread is full.
+ *
+ */
+void ipc_io_submit(ipc_io_conn *conn, uint8_t *data, size_t offset, size_t len);
+
+/**
+ * Returns the number of bytes which were submitted but not yet written.
+ *
+ */
+size_t ipc_io_pending(ipc_io_conn *conn);
+
+/**
+ * Discards the pending output, closes the connection and frees conn. The
+ * connection must not be used afterwards.
+ *
+ */
+void ipc_io_close(ipc_io_conn *conn);
+
+/**
+ * Stops the I/O thread after writing as much of the pending output as
+ * possible without blocking (see ipc_io_pending() for what is left). The
+ * connections are not closed. Used before an inplace restart.
+ *
+ */
+void ipc_io_stop(void);
+
+#endif
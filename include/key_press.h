@@ -19,6 +19,23 @@ extern pid_t command_error_nagbar_pid;
  */
 void handle_key_press(xcb_key_press_event_t *event);
 
+/**
+ * Requests the new modifier mapping after the keyboard mapping changed. The
+ * reply is picked up by key_press_poll_modifier_mapping() once it arrived, so
+ * that neither the mapping change nor the next key press wait for it. Until
+ * then, the previous xcb_numlock_mask is used.
+ *
+ */
+void key_press_mapping_changed(void);
+
+/**
+ * Updates xcb_numlock_mask if the reply to the request sent by
+ * key_press_mapping_changed() arrived. Re-grabs the keys if the mask changed,
+ * since every binding is grabbed with and without Num_Lock. Never blocks.
+ *
+ */
+void key_press_poll_modifier_mapping(void);
+
 /**
  * Kills the commanderror i3-nagbar process, if any.
  *
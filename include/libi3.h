@@ -20,6 +20,7 @@
 
 #if PANGO_SUPPORT
 #include <pango/pango.h>
+#include <cairo/cairo.h>
 #endif
 
 /**
@@ -100,6 +101,29 @@ void debuglog(char *fmt, ...)
  */
 char *root_atom_contents(const char *atomname, xcb_connection_t *provided_conn, int screen);
 
+/**
+ * Returns the path of the file in which i3 publishes the path of its IPC
+ * socket for the current display ($XDG_RUNTIME_DIR/i3/socket-path.$DISPLAY),
+ * or NULL if XDG_RUNTIME_DIR or DISPLAY are not set.
+ *
+ * The memory has to be free()d by the caller.
+ *
+ */
+char *socket_path_file(void);
+
+/**
+ * Returns the IPC socket path of the i3 instance running on the current
+ * display, or NULL if it cannot be found.
+ *
+ * The path is read from socket_path_file() if possible, which does not need
+ * the X server at all. Otherwise, the I3_SOCKET_PATH atom is used (see
+ * root_atom_contents(), which also explains provided_conn and screen).
+ *
+ * The memory has to be free()d by the caller.
+ *
+ */
+char *get_socket_path(xcb_connection_t *provided_conn, int screen);
+
 /**
  * Safe-wrapper around malloc which exits if malloc returns NULL (meaning that
  * there is no more memory available)
@@ -158,7 +182,26 @@ i3String *i3string_from_utf8_with_length(const char *from_utf8, size_t num_bytes
 i3String *i3string_from_ucs2(const xcb_char2b_t *from_ucs2, size_t num_glyphs);
 
 /**
- * Free an i3String.
+ * Returns the i3String for the given UTF-8 encoded string from the table of
+ * interned strings, adding it if necessary. All users of the same text share
+ * one i3String (and its UCS-2 form), so interned strings can be compared
+ * with i3string_equals() by their pointers. The returned reference has to be
+ * released with i3string_free().
+ *
+ */
+i3String *i3string_intern(const char *from_utf8, size_t num_bytes);
+
+/**
+ * Returns another reference to the given i3String, which has to be released
+ * with i3string_free() as well. This replaces copying strings which are not
+ * modified afterwards.
+ *
+ */
+i3String *i3string_ref(i3String *str);
+
+/**
+ * Releases a reference to an i3String and frees it once the last reference
+ * is gone.
  *
  */
 void i3string_free(i3String *str);
@@ -200,6 +243,20 @@ size_t i3string_get_num_bytes(i3String *str);
  */
 size_t i3string_get_num_glyphs(i3String *str);
 
+/**
+ * Returns true if both i3Strings contain the same text. Two interned strings
+ * are only compared by their pointers.
+ *
+ */
+bool i3string_equals(i3String *a, i3String *b);
+
+/**
+ * Returns the number of i3Strings which exist and the bytes they use
+ * (including both encodings of the text, if converted).
+ *
+ */
+void i3string_memory_usage(size_t *count, size_t *bytes);
+
 /**
  * Connects to the i3 IPC socket and returns the file descriptor for the
  * socket. die()s if anything goes wrong.
@@ -232,6 +289,39 @@ int ipc_send_message(int sockfd, const uint32_t message_size,
 int ipc_recv_message(int sockfd, uint32_t *message_type,
                      uint32_t *reply_length, uint8_t **reply);
 
+/**
+ * Buffer in which ipc_recv_message_buffered() assembles the messages arriving
+ * on a non-blocking socket. Zero-initialize it before the first use and free()
+ * data when closing the socket.
+ *
+ */
+typedef struct ipc_recv_buffer {
+    uint8_t *data;
+    size_t capacity;
+    /** The unprocessed input consists of size bytes starting at data +
+     * offset. */
+    size_t offset;
+    size_t size;
+    /** Messages larger than this are treated as a protocol violation (0
+     * means no limit) */
+    uint32_t max_message_size;
+} ipc_recv_buffer;
+
+/**
+ * Reads as much as is available from the given non-blocking socket into the
+ * buffer and returns the next complete message from it, if any. message
+ * points into the buffer and stays valid until the next call.
+ *
+ * Returns 1 when no complete message is available yet (the socket would
+ * block). The partial message stays in the buffer.
+ * Returns 0 on success.
+ * Returns the same errors as ipc_recv_message() otherwise.
+ *
+ */
+int ipc_recv_message_buffered(int sockfd, ipc_recv_buffer *buffer,
+                              uint32_t *message_type, uint32_t *message_length,
+                              uint8_t **message);
+
 /**
  * Generates a configure_notify event and sends it to the given window
  * Applications need this to think they’ve configured themselves correctly.
@@ -302,6 +392,14 @@ i3Font load_font(const char *pattern, const bool fallback);
  */
 void set_font(i3Font *font);
 
+/**
+ * Enables or disables drawing printable ASCII text with cached glyphs,
+ * bypassing Pango’s layout and shaping (only affects Pango fonts). Such text
+ * is not kerned.
+ *
+ */
+void set_font_glyph_cache(bool enable);
+
 /**
  * Frees the resources taken by the current font.
  *
@@ -341,6 +439,18 @@ void set_font_colors(xcb_gcontext_t gc, uint32_t foreground, uint32_t background
 void draw_text(i3String *text, xcb_drawable_t drawable,
         xcb_gcontext_t gc, int x, int y, int max_width);
 
+#if PANGO_SUPPORT
+/**
+ * Draws text onto the given cairo context (e.g. one of an image surface,
+ * which is rendered client-side) like draw_text() does, using the colors set
+ * with set_font_colors().
+ *
+ * Only Pango fonts can be drawn this way. Returns false for other fonts.
+ *
+ */
+bool draw_text_cairo(i3String *text, cairo_t *cr, int x, int y, int max_width);
+#endif
+
 /**
  * ASCII version of draw_text to print static strings.
  *
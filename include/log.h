@@ -12,6 +12,7 @@
 
 #include <stdarg.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 /* We will include libi3.h which define its own version of LOG, ELOG.
  * We want *our* version, so we undef the libi3 one. */
@@ -28,11 +29,64 @@
    is, delete the preceding comma */
 #define LOG(fmt, ...) verboselog(fmt, ##__VA_ARGS__)
 #define ELOG(fmt, ...) errorlog("ERROR: " fmt, ##__VA_ARGS__)
+#if defined(I3_NO_DLOG)
+/* Compiles out all debug messages, but still type-checks their arguments. */
+#define DLOG(fmt, ...) do { \
+    if (0) \
+        debuglog("%s:%s:%d - " fmt, I3__FILE__, __FUNCTION__, __LINE__, ##__VA_ARGS__); \
+} while (0)
+#elif defined(TEST_PARSER)
 #define DLOG(fmt, ...) debuglog("%s:%s:%d - " fmt, I3__FILE__, __FUNCTION__, __LINE__, ##__VA_ARGS__)
+#else
+/* The arguments are only evaluated if the message will actually be logged.
+ * Each call site looks up the category of its source file once. */
+#define DLOG(fmt, ...) do { \
+    static int dlog_category = -1; \
+    if (debuglog_wanted(&dlog_category, I3__FILE__)) \
+        debuglog("%s:%s:%d - " fmt, I3__FILE__, __FUNCTION__, __LINE__, ##__VA_ARGS__); \
+} while (0)
+#endif
+
+/** Whether debug messages are logged at all, i.e. whether debug logging or
+ * the SHM log is enabled. */
+extern bool debuglog_active;
+/** Bitmask of the categories (see debuglog_category()) whose debug messages
+ * are logged. */
+extern uint64_t debuglog_categories;
+
+/**
+ * Returns the category for debug messages from the given source file. Every
+ * source file is its own category, named like the file without ".c".
+ *
+ */
+int debuglog_category(const char *file);
+
+/**
+ * Returns whether a debug message from the given source file would be
+ * logged. The category is only looked up on the first call and then stored
+ * in *category.
+ *
+ */
+static inline bool debuglog_wanted(int *category, const char *file) {
+    if (!debuglog_active)
+        return false;
+    if (*category == -1)
+        *category = debuglog_category(file);
+    return (debuglog_categories & ((uint64_t)1 << *category)) != 0;
+}
+
+/**
+ * Restricts debug messages to the given comma-separated list of categories
+ * (for example "x,render"). NULL, an empty string or "all" logs all
+ * categories again.
+ *
+ */
+void set_debuglog_filter(const char *filter);
 
 extern char *errorfilename;
 extern char *shmlogname;
 extern int shmlog_size;
+extern bool shmlog_persistent;
 
 /**
  * Initializes logging by creating an error logfile in /tmp (or
@@ -53,6 +107,21 @@ void open_logbuffer(void);
  */
 void close_logbuffer(void);
 
+/**
+ * Removes the SHM segment (or file, see shmlog_persistent) of the log. The
+ * log stays usable if it is still mapped.
+ *
+ */
+void unlink_logbuffer(void);
+
+/**
+ * Changes the size of the log to the current shmlog_size while keeping the
+ * most recent messages (as many as fit). The log is copied to a new segment
+ * with the same name, i3-dump-log -f switches over to it.
+ *
+ */
+void resize_logbuffer(void);
+
 /**
  * Checks if debug logging is active.
  *
@@ -103,4 +172,29 @@ void verboselog(char *fmt, ...)
  */
 void purge_zerobyte_logfile(void);
 
+/**
+ * Writes messages for stdout in a separate thread from now on, so that
+ * logging never blocks i3, even if stdout is slow. Messages which are logged
+ * while the thread does not keep up are dropped (but still end up in the SHM
+ * log).
+ *
+ */
+void start_async_logging(void);
+
+/**
+ * Writes the remaining messages and stops the logger thread. Called before
+ * exiting and before an inplace restart.
+ *
+ */
+void stop_async_logging(void);
+
+/**
+ * Wakes up all i3-dump-log processes which wait for new messages, if any
+ * messages were logged since the last call. Called from the event loop
+ * before blocking, so that there is one broadcast per batch of messages
+ * instead of one per message.
+ *
+ */
+void log_broadcast(void);
+
 #endif
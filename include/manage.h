@@ -30,13 +30,27 @@ void manage_existing_windows(xcb_window_t root);
 void restore_geometry(void);
 
 /**
- * Do some sanity checks and then reparent the window.
+ * Queues the window to be managed by the next manage_pending_windows(). The
+ * geometry is requested right away, so that the requests for a burst of new
+ * windows all go out before waiting for any reply.
  *
  */
 void manage_window(xcb_window_t window,
                    xcb_get_window_attributes_cookie_t cookie,
                    bool needs_to_be_mapped);
 
+/**
+ * Finishes managing all windows passed to manage_window() so far. The replies
+ * for all of them are processed in passes, so that all requests of one pass
+ * are sent before waiting for the first reply. Managing hundreds of windows
+ * (e.g. on restart) therefore takes only a handful of round trips.
+ *
+ * The tree is then rendered once, and the "new" window events are sent
+ * afterwards, so that they contain the geometry of the windows.
+ *
+ */
+void manage_pending_windows(void);
+
 #if 0
 /**
  * reparent_window() gets called when a new window was opened and becomes a
@@ -0,0 +1,58 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009-2013 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * memory.c: Counts the objects i3 allocated and the memory they use, see
+ *           GET_MEMORY.
+ *
+ */
+#ifndef I3_MEMORY_H
+#define I3_MEMORY_H
+
+/**
+ * The number of live objects of one type and the bytes they use, updated
+ * where the objects are allocated and freed.
+ *
+ */
+struct memory_stats {
+    /** Name of the object type, used in GET_MEMORY replies */
+    const char *name;
+    uint64_t count;
+    uint64_t bytes;
+
+    bool registered;
+    SLIST_ENTRY(memory_stats) all_memory_stats;
+};
+
+#define MEMORY_STATS_INITIALIZER(name) \
+    { (name), 0, 0, false, { NULL } }
+
+SLIST_HEAD(all_memory_stats_head, memory_stats);
+/** All object types which were allocated at least once, for GET_MEMORY */
+extern struct all_memory_stats_head all_memory_stats;
+
+/**
+ * Records that an object of the given type using the given number of bytes
+ * was allocated.
+ *
+ */
+void memory_stats_alloc(struct memory_stats *stats, size_t bytes);
+
+/**
+ * Records that an object of the given type using the given number of bytes
+ * was freed.
+ *
+ */
+void memory_stats_free(struct memory_stats *stats, size_t bytes);
+
+/**
+ * Generates the GET_MEMORY reply: the number of objects and bytes of every
+ * object type (including the pools and the i3Strings of libi3) and, if the C
+ * library supports it, the size of the heap.
+ *
+ */
+void memory_stats_dump(yajl_gen gen);
+
+#endif
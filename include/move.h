@@ -11,10 +11,19 @@
 #define I3_MOVE_H
 
 /**
- * Moves the current container in the given direction (TOK_LEFT, TOK_RIGHT,
- * TOK_UP, TOK_DOWN from cmdparse.l)
+ * Moves the current container in the given direction (D_LEFT, D_RIGHT,
+ * D_UP, D_DOWN).
  *
  */
 void tree_move(int direction);
 
+/**
+ * Moves the current container the given number of steps in the given
+ * direction, as if tree_move() was called that many times, but the caller
+ * only needs to render the tree once. Runs of swaps with sibling windows are
+ * done with a single detach/attach.
+ *
+ */
+void tree_move_steps(int direction, int steps);
+
 #endif
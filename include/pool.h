@@ -0,0 +1,66 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009-2013 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * pool.c: Fixed-size object pools for frequently allocated structures.
+ *
+ */
+#ifndef I3_POOL_H
+#define I3_POOL_H
+
+/**
+ * A pool hands out objects of one size. Objects are carved out of blocks
+ * which are never returned to the system; freed objects are kept on a free
+ * list and reused by the next pool_alloc().
+ *
+ */
+struct pool {
+    /** Name of the pool, used in GET_POOL_STATS replies */
+    const char *name;
+    /** Size of a single object (rounded up to keep objects aligned) */
+    size_t object_size;
+
+    /** Singly linked list of unused objects, linked through their first
+     * bytes */
+    void *free_list;
+
+    /** Number of blocks allocated so far */
+    uint32_t blocks;
+    /** Number of objects currently handed out */
+    uint32_t in_use;
+    /** Number of objects on the free list */
+    uint32_t available;
+
+    bool registered;
+    SLIST_ENTRY(pool) pools;
+};
+
+#define POOL_INITIALIZER(name, type) \
+    { (name), sizeof(type), NULL, 0, 0, 0, false, { NULL } }
+
+SLIST_HEAD(pools_head, pool);
+/** All pools which were used at least once, for GET_POOL_STATS */
+extern struct pools_head all_pools;
+
+/** Pools for structures which are shared between several source files */
+extern struct pool con_pool;
+extern struct pool window_pool;
+extern struct pool match_pool;
+
+/**
+ * Returns a zeroed object from the given pool (like scalloc() does). Exits
+ * i3 if no memory is available.
+ *
+ */
+void *pool_alloc(struct pool *pool);
+
+/**
+ * Returns the given object (which must have been allocated from this pool)
+ * to the pool. NULL is ignored.
+ *
+ */
+void pool_free(struct pool *pool, void *object);
+
+#endif
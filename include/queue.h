@@ -407,6 +407,29 @@ struct {								\
 	_Q_INVALIDATE((elm)->field.tqe_next);				\
 } while (0)
 
+/* Moves all elements of head2 to the end of head1, leaving head2 empty */
+#define TAILQ_CONCAT(head1, head2, field) do {				\
+	if (!TAILQ_EMPTY(head2)) {					\
+		*(head1)->tqh_last = (head2)->tqh_first;		\
+		(head2)->tqh_first->field.tqe_prev = (head1)->tqh_last;	\
+		(head1)->tqh_last = (head2)->tqh_last;			\
+		TAILQ_INIT(head2);					\
+	}								\
+} while (0)
+
+/* Moves all elements of head2 before listelm (which must not be on head2),
+ * leaving head2 empty */
+#define TAILQ_SPLICE_BEFORE(listelm, head2, field) do {			\
+	if (!TAILQ_EMPTY(head2)) {					\
+		*(listelm)->field.tqe_prev = (head2)->tqh_first;	\
+		(head2)->tqh_first->field.tqe_prev =			\
+		    (listelm)->field.tqe_prev;				\
+		*(head2)->tqh_last = (listelm);				\
+		(listelm)->field.tqe_prev = (head2)->tqh_last;		\
+		TAILQ_INIT(head2);					\
+	}								\
+} while (0)
+
 /* Swaps two consecutive elements. 'second' *MUST* follow 'first' */
 #define TAILQ_SWAP(first, second, head, field) do { 			\
 	*((first)->field.tqe_prev) = (second); 				\
@@ -80,6 +80,21 @@ Output *get_first_output(void);
  */
 Output *get_output_by_name(const char *name);
 
+/**
+ * Marks the index for get_output_containing() as stale. Needs to be called
+ * whenever an output is added, (de)activated or changes its position or
+ * size.
+ *
+ */
+void randr_invalidate_output_index(void);
+
+/**
+ * Returns the sum of the widths and the sum of the heights of all outputs (x
+ * and y are 0). The result is cached until randr_invalidate_output_index().
+ *
+ */
+Rect randr_total_output_dimensions(void);
+
 /**
  * Returns the active (!) output which contains the coordinates x, y or NULL
  * if there is no output which contains these coordinates.
@@ -12,9 +12,13 @@
 
 /**
  * Creates a new 'regex' struct containing the given pattern and a PCRE
- * compiled regular expression. Also, calls pcre_study because this regex will
- * most likely be used often (like for every new window and on every relevant
- * property change of existing windows).
+ * compiled regular expression. Also, calls pcre_study (using the JIT compiler
+ * if available) because this regex will most likely be used often (like for
+ * every new window and on every relevant property change of existing
+ * windows).
+ *
+ * Regexes are interned: if the same pattern was already compiled, the
+ * existing regex is returned (and has to be passed to regex_free() as well).
  *
  * Returns NULL if the pattern could not be compiled into a regular expression
  * (and ELOGs an appropriate error message).
@@ -23,7 +27,18 @@
 struct regex *regex_new(const char *pattern);
 
 /**
- * Frees the given regular expression. It must not be used afterwards!
+ * Returns another reference to the given regular expression, which has to be
+ * passed to regex_free() as well. Cheaper than regex_new() with the same
+ * pattern.
+ *
+ */
+struct regex *regex_ref(struct regex *regex);
+
+/**
+ * Releases the given regular expression, which must not be used afterwards.
+ * Once the last user of this pattern released it, it is kept around unused
+ * (so that using the same pattern again does not need to compile it) until
+ * too many unused regexes accumulated.
  *
  */
 void regex_free(struct regex *regex);
@@ -36,4 +51,12 @@ void regex_free(struct regex *regex);
  */
 bool regex_matches(struct regex *regex, const char *input);
 
+/**
+ * If the regular expression only matches one exact string (i.e. it has the
+ * form ^literal$ without any special characters), returns a copy of that
+ * string which has to be free()d. Otherwise returns NULL.
+ *
+ */
+char *regex_exact_literal(struct regex *regex);
+
 #endif
@@ -21,6 +21,13 @@
  */
 void render_con(Con *con, bool render_fullscreen);
 
+/**
+ * Renders the given workspace although it is not visible, so that its windows
+ * already have the right geometry when it is shown. Nothing is mapped.
+ *
+ */
+void render_hidden_workspace(Con *ws);
+
 /*
  * Returns the height for the decorations
  */
@@ -0,0 +1,33 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009-2013 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * restart_layout.c: Compact binary format for storing the layout during an
+ *                   inplace restart.
+ *
+ */
+#ifndef I3_RESTART_LAYOUT_H
+#define I3_RESTART_LAYOUT_H
+
+/**
+ * Serializes the given container and all of its children into the binary
+ * restart format. Returns a buffer which has to be free()d by the caller and
+ * stores its length in *length.
+ *
+ */
+char *restart_layout_serialize(Con *con, size_t *length);
+
+/**
+ * Restores a layout which was stored by restart_layout_serialize() and
+ * attaches it to the focused container, like tree_append_json() does.
+ *
+ * Returns false if the file is not in the binary restart format (e.g.
+ * because it was written by an older version of i3 as JSON), in which case
+ * nothing was changed.
+ *
+ */
+bool restart_layout_load(const char *filename);
+
+#endif
@@ -19,6 +19,21 @@
  */
 void scratchpad_move(Con *con);
 
+/**
+ * Adds the given container to (or removes it from) the list of scratchpad
+ * containers, depending on its scratchpad_state. Has to be called whenever
+ * the scratchpad_state is changed from or to SCRATCHPAD_NONE.
+ *
+ */
+void scratchpad_index(Con *con);
+
+/**
+ * Removes the given container from the list of scratchpad containers. Called
+ * by tree_close() before the container is freed.
+ *
+ */
+void scratchpad_unindex(Con *con);
+
 /**
  * Either shows the top-most scratchpad window (con == NULL) or shows the
  * specified con (if it is scratchpad window).
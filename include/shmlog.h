@@ -42,6 +42,15 @@ typedef struct i3_shmlog_header {
      * message in the log. i3-dump-log uses this to implement -f (follow, like
      * tail -f) in an efficient way. */
     pthread_cond_t condvar;
+
+    /* Total number of bytes which were written to the log so far. Allows
+     * clients to detect how much they missed when i3 wrapped more than once
+     * in between two reads. */
+    uint64_t bytes_written;
+
+    /* Set when i3 closes the log or replaces it with a log of a different
+     * size (using the same name). i3-dump-log -f then opens the log again. */
+    uint32_t replaced;
 } i3_shmlog_header;
 
 #endif
@@ -0,0 +1,89 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009-2013 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * The format of the tree snapshot which i3 keeps in shared memory while it is
+ * enabled (see the tree_snapshot command), so that local clients can read the
+ * layout without sending GET_TREE and parsing its reply.
+ *
+ */
+#ifndef I3_I3_SHMTREE_H
+#define I3_I3_SHMTREE_H
+
+#include <stdint.h>
+
+#define I3_SHMTREE_MAGIC 0x72743369 /* "i3tr" */
+#define I3_SHMTREE_VERSION 1
+
+/* Bits of i3_shmtree_node.flags */
+#define I3_SHMTREE_FOCUSED (1 << 0)
+#define I3_SHMTREE_URGENT (1 << 1)
+#define I3_SHMTREE_MAPPED (1 << 2)
+
+/*
+ * Header at the start of the SHM segment (see the I3_SHMTREE_PATH atom).
+ *
+ * The snapshot is protected by a sequence lock: i3 increments sequence
+ * before and after every update, so it is odd while an update is in
+ * progress. A reader copies what it needs, then checks that sequence was
+ * even before and did not change while copying, and retries otherwise.
+ *
+ */
+typedef struct i3_shmtree_header {
+    uint32_t magic;
+    uint32_t version;
+
+    uint32_t sequence;
+
+    /* The size of the SHM segment in bytes. The segment grows when the tree
+     * does not fit anymore, readers have to map it again in that case. */
+    uint32_t size;
+
+    /* The nodes (num_nodes of them, the root node first) start at
+     * nodes_offset, the strings at strings_offset (both relative to the start
+     * of the segment). */
+    uint32_t num_nodes;
+    uint32_t nodes_offset;
+    uint32_t strings_offset;
+
+    /* Index of the focused node */
+    uint32_t focused;
+} i3_shmtree_header;
+
+/*
+ * One container. The nodes are stored in pre-order: the subtree of a node
+ * consists of the subtree_size nodes starting at the node itself, tiling
+ * children first, then floating children.
+ *
+ */
+typedef struct i3_shmtree_node {
+    /* The same id as in the GET_TREE reply */
+    uint64_t id;
+    /* The X11 window of this container, 0 if it has none */
+    uint32_t window;
+    /* Index of the parent node, -1 for the root */
+    int32_t parent;
+    uint32_t subtree_size;
+    /* Offset of the (0-terminated, UTF-8) name, relative to strings_offset,
+     * or UINT32_MAX if the container has no name */
+    uint32_t name;
+
+    int32_t x;
+    int32_t y;
+    uint32_t width;
+    uint32_t height;
+
+    /* The workspace number (-1 for named workspaces and other containers) */
+    int32_t num;
+
+    /* The numeric values of type, layout and fullscreen_mode in include/data.h
+     * and I3_SHMTREE_* flags */
+    uint8_t type;
+    uint8_t layout;
+    uint8_t fullscreen_mode;
+    uint8_t flags;
+} i3_shmtree_node;
+
+#endif
@@ -6,12 +6,17 @@
  * © 2009-2010 Jan-Erik Rediger
  *
  * sighandler.c: Interactive crash dialog upon SIGSEGV/SIGABRT/SIGFPE (offers
- *               to restart inplace).
+ *               to restart inplace), or (with --crash-restart) an immediate
+ *               inplace restart after saving a backtrace.
  *
  */
 #ifndef I3_SIGHANDLER_H
 #define I3_SIGHANDLER_H
 
+/** Restart inplace right after saving a backtrace instead of opening the
+ * crash dialog when i3 crashes. */
+extern bool crash_restart;
+
 /**
  * Setup signal handlers to safely handle SIGSEGV and SIGFPE
  *
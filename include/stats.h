@@ -0,0 +1,89 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009-2013 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * stats.c: Latency histograms for event handlers, IPC messages, commands and
+ *          rendering.
+ *
+ */
+#ifndef I3_STATS_H
+#define I3_STATS_H
+
+/** Number of histogram buckets. Bucket 0 counts the durations below 2
+ * microseconds, bucket i the durations between 2^i and 2^(i+1) microseconds
+ * and the last bucket everything above. */
+#define STATS_BUCKETS 20
+
+/**
+ * Latency statistics of one kind of work (e.g. handling MapRequest events or
+ * running the “move” command).
+ *
+ */
+struct latency_stats {
+    /** The category (“event”, “ipc”, “command” or “render”) */
+    const char *category;
+    /** Name within the category */
+    const char *name;
+
+    uint64_t count;
+    /** Sum and maximum of all durations, in nanoseconds */
+    uint64_t total_ns;
+    uint64_t max_ns;
+    uint32_t buckets[STATS_BUCKETS];
+
+    bool registered;
+    TAILQ_ENTRY(latency_stats) all_stats;
+};
+
+TAILQ_HEAD(all_stats_head, latency_stats);
+/** All statistics which have been recorded at least once, for GET_STATS */
+extern struct all_stats_head all_stats;
+
+/**
+ * Returns the current value of the monotonic clock in nanoseconds. Pass the
+ * value to stats_record() once the work is done.
+ *
+ */
+uint64_t stats_now(void);
+
+/**
+ * Adds the time which passed since start (a stats_now() value) to the given
+ * statistics.
+ *
+ */
+void stats_record(struct latency_stats *stats, uint64_t start);
+
+/**
+ * Returns the statistics for the X11 event of the given type.
+ *
+ */
+struct latency_stats *stats_for_event(int type);
+
+/**
+ * Returns the statistics for the IPC message of the given type.
+ *
+ */
+struct latency_stats *stats_for_ipc(uint32_t type);
+
+/**
+ * Returns the statistics for the given command, identified by the name of
+ * the function implementing it.
+ *
+ */
+struct latency_stats *stats_for_command(const char *name);
+
+/** Statistics for tree_render() and its two phases, render_con() (computing
+ * the layout) and x_push_changes() */
+extern struct latency_stats stats_tree_render;
+extern struct latency_stats stats_render_con;
+extern struct latency_stats stats_x_push_changes;
+
+/**
+ * Clears all statistics.
+ *
+ */
+void stats_reset(void);
+
+#endif
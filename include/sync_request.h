@@ -0,0 +1,52 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009-2013 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * sync_request.c: Implements _NET_WM_SYNC_REQUEST, which lets i3 wait until a
+ *                 client has redrawn itself in the size it was given before
+ *                 sending it the next one.
+ *
+ */
+#ifndef I3_SYNC_REQUEST_H
+#define I3_SYNC_REQUEST_H
+
+/**
+ * Initializes the XSync extension. Sets event_base to the first event of the
+ * extension, or leaves it untouched if the X server does not support it (in
+ * which case windows are resized without synchronization).
+ *
+ */
+void sync_request_init(int *event_base);
+
+/**
+ * Returns true if the window was sent a _NET_WM_SYNC_REQUEST which it did not
+ * acknowledge yet. Its next size has to be held back until it does (or until
+ * it timed out). The window is rendered again once that happened.
+ *
+ */
+bool sync_request_pending(i3Window *win);
+
+/**
+ * Sends a _NET_WM_SYNC_REQUEST to the window if it supports the protocol. Has
+ * to be called right before resizing the window.
+ *
+ */
+void sync_request_send(i3Window *win);
+
+/**
+ * Handles the AlarmNotify which is generated once a client updated its sync
+ * counter, i.e. after it has redrawn itself in the new size.
+ *
+ */
+void sync_request_handle_alarm(xcb_sync_alarm_notify_event_t *event);
+
+/**
+ * Frees the resources used for synchronizing with the window. Called before
+ * the window is freed.
+ *
+ */
+void sync_request_free(i3Window *win);
+
+#endif
@@ -0,0 +1,52 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009-2013 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * trace.c: Records spans of the event loop into a ring buffer and writes
+ *          them in the Chrome trace event format.
+ *
+ */
+#ifndef I3_TRACE_H
+#define I3_TRACE_H
+
+/** Whether spans are currently recorded (see the 'trace' command) */
+extern bool tracing;
+
+/**
+ * Enables or disables recording spans. Enabling discards the previously
+ * recorded spans.
+ *
+ */
+void set_tracing(bool enabled);
+
+/**
+ * Records a span which started at start and ended at end (both stats_now()
+ * values). Does nothing unless tracing is enabled.
+ *
+ */
+void trace_add(const char *category, const char *name, uint64_t start, uint64_t end);
+
+/**
+ * Returns the start time for trace_end(), or 0 if tracing is disabled (so that
+ * the clock is not read needlessly).
+ *
+ */
+uint64_t trace_begin(void);
+
+/**
+ * Records the span which started at the given trace_begin() value.
+ *
+ */
+void trace_end(const char *category, const char *name, uint64_t start);
+
+/**
+ * Writes the recorded spans to the given file in the Chrome trace event
+ * format, which can be loaded into chrome://tracing or Perfetto. Returns false
+ * if the file could not be written.
+ *
+ */
+bool trace_dump(const char *filename);
+
+#endif
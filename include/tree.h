@@ -16,6 +16,13 @@ extern Con *croot;
 extern Con *focused;
 TAILQ_HEAD(all_cons_head, Con);
 extern struct all_cons_head all_cons;
+/* All containers which have a mark, so that [con_mark=…] criteria and the
+ * mark/unmark commands do not need to walk all_cons. */
+extern struct all_cons_head marked_cons;
+/* The current tree generation. Containers which change get this generation
+ * assigned; it is incremented whenever a client was told about it (see
+ * GET_TREE_DELTA). */
+extern uint64_t tree_generation;
 
 /**
  * Initializes the tree by creating the root node, adding all RandR outputs
@@ -57,6 +64,52 @@ bool level_down(void);
  */
 void tree_render(void);
 
+/**
+ * Requests that the tree is rendered before i3 waits for new events. Use this
+ * instead of tree_render() in event handlers so that a burst of events (e.g.
+ * many windows being mapped at once) is rendered only once.
+ *
+ */
+void tree_render_later(void);
+
+/**
+ * Like tree_render_later(), but for changes which only affect the focus and
+ * therefore the decorations and the X11 input focus, not the geometry (see
+ * handle_enter_notify()). Unless a full render is requested as well, only
+ * x_push_changes() is called, skipping render_con().
+ *
+ */
+void tree_render_focus_later(void);
+
+/**
+ * Renders the tree if rendering was requested using tree_render_later() (or
+ * deferred because of a batch) and not done yet.
+ *
+ */
+void tree_render_flush(void);
+
+/**
+ * Starts a batch: until the matching tree_batch_end(), tree_render() only
+ * remembers that rendering is necessary. Batches can be nested.
+ *
+ */
+void tree_batch_begin(void);
+
+/**
+ * Ends a batch started with tree_batch_begin(). When the outermost batch
+ * ends, the tree is rendered once if tree_render() was called in between.
+ *
+ */
+void tree_batch_end(void);
+
+/**
+ * Like tree_batch_end(), but the tree is not rendered right away, only
+ * before i3 waits for new events (see tree_render_later()). For callers which
+ * must not render, e.g. because they may be reached while sending events.
+ *
+ */
+void tree_batch_end_later(void);
+
 /**
  * Closes the current container using tree_close().
  *
@@ -103,6 +156,8 @@ bool tree_restore(const char *path, xcb_get_geometry_reply_t *geometry);
  * split container then and if you move containers this way multiple times,
  * redundant chains of split-containers can be the result.
  *
+ * The tree is traversed once, so whole chains are removed in a single call.
+ *
  */
 void tree_flatten(Con *child);
 
@@ -0,0 +1,31 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009-2013 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * tree_snapshot.c: Keeps a snapshot of the tree in shared memory (see
+ *                  shmtree.h for the format).
+ *
+ */
+#ifndef I3_TREE_SNAPSHOT_H
+#define I3_TREE_SNAPSHOT_H
+
+/** The name of the SHM segment, empty while the snapshot is disabled */
+extern char *shmtreename;
+
+/**
+ * Enables or disables the snapshot. Enabling creates the SHM segment and
+ * writes the current tree into it, disabling removes the segment.
+ *
+ */
+void tree_snapshot_set_enabled(bool enabled);
+
+/**
+ * Writes the current tree into the snapshot, if it is enabled. Called at the
+ * end of tree_render().
+ *
+ */
+void tree_snapshot_update(void);
+
+#endif
@@ -12,26 +12,27 @@
 
 /**
  * Updates the WM_CLASS (consisting of the class and instance) for the
- * given window.
+ * given window. Returns false if WM_CLASS did not change.
  *
  */
-void window_update_class(i3Window *win, xcb_get_property_reply_t *prop, bool before_mgmt);
+bool window_update_class(i3Window *win, xcb_get_property_reply_t *prop, bool before_mgmt);
 
 /**
  * Updates the name by using _NET_WM_NAME (encoded in UTF-8) for the given
  * window. Further updates using window_update_name_legacy will be ignored.
+ * Returns false if the name did not change.
  *
  */
-void window_update_name(i3Window *win, xcb_get_property_reply_t *prop, bool before_mgmt);
+bool window_update_name(i3Window *win, xcb_get_property_reply_t *prop, bool before_mgmt);
 
 /**
  * Updates the name by using WM_NAME (encoded in COMPOUND_TEXT). We do not
  * touch what the client sends us but pass it to xcb_image_text_8. To get
  * proper unicode rendering, the application has to use _NET_WM_NAME (see
- * window_update_name()).
+ * window_update_name()). Returns false if the name did not change.
  *
  */
-void window_update_name_legacy(i3Window *win, xcb_get_property_reply_t *prop, bool before_mgmt);
+bool window_update_name_legacy(i3Window *win, xcb_get_property_reply_t *prop, bool before_mgmt);
 
 /**
  * Updates the CLIENT_LEADER (logical parent window).
@@ -39,6 +40,13 @@ void window_update_name_legacy(i3Window *win, xcb_get_property_reply_t *prop, bo
  */
 void window_update_leader(i3Window *win, xcb_get_property_reply_t *prop);
 
+/**
+ * Updates the _NET_WM_SYNC_REQUEST_COUNTER (the XSync counter the client
+ * updates after it handled a _NET_WM_SYNC_REQUEST).
+ *
+ */
+void window_update_sync_counter(i3Window *win, xcb_get_property_reply_t *prop);
+
 /**
  * Updates the TRANSIENT_FOR (logical parent window).
  *
@@ -52,10 +60,10 @@ void window_update_transient_for(i3Window *win, xcb_get_property_reply_t *prop);
 void window_update_strut_partial(i3Window *win, xcb_get_property_reply_t *prop);
 
 /**
- * Updates the WM_WINDOW_ROLE
+ * Updates the WM_WINDOW_ROLE. Returns false if the role did not change.
  *
  */
-void window_update_role(i3Window *win, xcb_get_property_reply_t *prop, bool before_mgmt);
+bool window_update_role(i3Window *win, xcb_get_property_reply_t *prop, bool before_mgmt);
 
 /**
  * Updates the WM_HINTS (we only care about the input focus handling part).
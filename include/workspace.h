@@ -26,6 +26,37 @@
  */
 Con *workspace_get(const char *num, bool *created);
 
+/**
+ * Returns the workspace with the given name (compared case-insensitively) or
+ * NULL if no such workspace exists. Workspaces are looked up in a hash table,
+ * so this is cheap even with many workspaces.
+ *
+ */
+Con *get_existing_workspace_by_name(const char *name);
+
+/**
+ * Removes the given container from the index used by
+ * get_existing_workspace_by_name(). Called by tree_close() before the
+ * container is freed.
+ *
+ */
+void workspace_index_remove(Con *con);
+
+/**
+ * Adds the given container to the index of sticky containers (or moves it to
+ * the right bucket). Has to be called whenever the sticky_group of a container
+ * is set.
+ *
+ */
+void workspace_index_sticky(Con *con);
+
+/**
+ * Removes the given container from the index of sticky containers. Called by
+ * tree_close() before the container is freed.
+ *
+ */
+void workspace_unindex_sticky(Con *con);
+
 /*
  * Returns a pointer to a new workspace in the given output. The workspace
  * is created attached to the tree hierarchy through the given content
@@ -154,6 +185,22 @@ void workspace_map_clients(xcb_connection_t *conn, Workspace *ws);
  */
 void workspace_update_urgent_flag(Con *ws);
 
+/**
+ * Stops the urgency timer of the given container, if it is running. Called by
+ * tree_close() before the container is freed.
+ *
+ */
+void workspace_cancel_urgency_timer(Con *con);
+
+/**
+ * Renders the recently hidden workspaces (see render_hidden_workspace()),
+ * unless they are visible again or have a fullscreen container. Called by
+ * tree_render() before rendering the visible workspaces, so that the hidden
+ * windows stay at the bottom of the stack.
+ *
+ */
+void workspace_render_recent(void);
+
 /**
  * 'Forces' workspace orientation by moving all cons into a new split-con with
  * the same orientation as the workspace and then changing the workspace
@@ -45,6 +45,9 @@ void x_reinit(Con *con);
 /**
  * Kills the window decoration associated with the given container.
  *
+ * The frame itself is only destroyed at the end of the next x_push_changes(),
+ * after the remaining containers have been configured to take up its space.
+ *
  */
 void x_con_kill(Con *con);
 
@@ -66,6 +69,13 @@ void x_window_kill(xcb_window_t window, kill_window_t kill_window);
  */
 void x_draw_decoration(Con *con);
 
+/**
+ * Frees all cached decorations. Needs to be called when the font changes
+ * (configuration reload).
+ *
+ */
+void x_deco_cache_flush(void);
+
 /**
  * Recursively calls x_draw_decoration. This cannot be done in x_push_node
  * because x_push_node uses focus order to recurse (see the comment above)
@@ -110,6 +120,12 @@ void x_set_name(Con *con, const char *name);
  */
 void update_shmlog_atom(void);
 
+/**
+ * Set up the I3_SHMTREE_PATH atom.
+ *
+ */
+void update_shmtree_atom(void);
+
 /**
  * Sets up i3 specific atoms (I3_SOCKET_PATH and I3_CONFIG_PATH)
  *
@@ -126,7 +142,7 @@ void x_set_warp_to(Rect *rect);
 /**
  * Applies the given mask to the event mask of every i3 window decoration X11
  * window. This is useful to disable EnterNotify while resizing so that focus
- * is untouched.
+ * is untouched. The next x_push_changes() enables EnterNotify again.
  *
  */
 void x_mask_event_mask(uint32_t mask);
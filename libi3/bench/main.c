@@ -0,0 +1,325 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009-2013 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * libi3-bench: Measures the throughput of the libi3 helpers which are used in
+ *              hot paths (text width prediction and drawing, string
+ *              conversion, colors and the IPC message framing), so that
+ *              changes to them can be compared. Not installed, build and run
+ *              it with "make bench-libi3".
+ *
+ */
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <err.h>
+#include <getopt.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+
+#include <xcb/xcb.h>
+#include <xcb/xcb_aux.h>
+
+#include "libi3.h"
+
+/* Used by the font functions of libi3. */
+xcb_connection_t *conn;
+xcb_screen_t *root_screen;
+
+/* Every benchmark runs for (about) this many iterations, see -n. */
+static long iterations = 100000;
+
+/* Only benchmarks whose name contains this string are run (unless NULL). */
+static const char *filter;
+
+/* The texts which are measured and drawn: a short window title, a long one
+ * and one which needs more than one byte per glyph in UTF-8. */
+static const char *texts[] = {
+    "urxvt",
+    "i3 - improved tiling wm - Mozilla Firefox: Release Notes for the next version",
+    "Übersicht – Größenänderung ✓ ☃ «Fenster»",
+};
+#define NUM_TEXTS (sizeof(texts) / sizeof(texts[0]))
+
+void verboselog(char *fmt, ...) {
+    va_list args;
+
+    va_start(args, fmt);
+    vfprintf(stdout, fmt, args);
+    va_end(args);
+}
+
+void errorlog(char *fmt, ...) {
+    va_list args;
+
+    va_start(args, fmt);
+    vfprintf(stderr, fmt, args);
+    va_end(args);
+}
+
+void debuglog(char *fmt, ...) {
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* Keeps the compiler from optimizing away the results of the benchmarked
+ * functions. */
+static volatile uint64_t sink;
+
+/*
+ * Runs fn for the given number of iterations (its argument is the iteration)
+ * and prints the time per iteration. Does nothing if the benchmark is
+ * excluded using -b.
+ *
+ */
+static void run(const char *name, long count, void (*fn)(long)) {
+    if (filter != NULL && strstr(name, filter) == NULL)
+        return;
+
+    /* Warm up caches (and the caches of libi3) before measuring. */
+    for (long i = 0; i < count / 100 + 1; i++)
+        fn(i);
+
+    uint64_t start = now_ns();
+    for (long i = 0; i < count; i++)
+        fn(i);
+    uint64_t elapsed = now_ns() - start;
+
+    printf("%-32s %10ld × %10.1f ns\n", name, count, (double)elapsed / count);
+}
+
+/*
+ * Waits until the X server processed all requests, so that the time it took
+ * to draw is part of the measurement.
+ *
+ */
+static void x_sync(void) {
+    free(xcb_get_input_focus_reply(conn, xcb_get_input_focus(conn), NULL));
+}
+
+/*******************************************************************************
+ * Strings
+ ******************************************************************************/
+
+static void bench_i3string_from_utf8(long i) {
+    i3String *str = i3string_from_utf8(texts[i % NUM_TEXTS]);
+    sink += i3string_get_num_bytes(str);
+    i3string_free(str);
+}
+
+static void bench_i3string_as_ucs2(long i) {
+    /* A new string every time, otherwise only the first call converts. */
+    i3String *str = i3string_from_utf8(texts[i % NUM_TEXTS]);
+    sink += i3string_as_ucs2(str)[0].byte2;
+    i3string_free(str);
+}
+
+static xcb_char2b_t *ucs2_texts[NUM_TEXTS];
+static size_t ucs2_lengths[NUM_TEXTS];
+
+static void bench_convert_ucs2_to_utf8(long i) {
+    char *utf8 = convert_ucs2_to_utf8(ucs2_texts[i % NUM_TEXTS], ucs2_lengths[i % NUM_TEXTS]);
+    sink += utf8[0];
+    free(utf8);
+}
+
+static const char *colors[] = {
+    "#4c7899", "#285577", "#ffffff", "#333333", "#5f676a", "#222222", "#900000",
+};
+#define NUM_COLORS (sizeof(colors) / sizeof(colors[0]))
+
+static void bench_get_colorpixel(long i) {
+    sink += get_colorpixel(colors[i % NUM_COLORS]);
+}
+
+/*******************************************************************************
+ * Fonts
+ ******************************************************************************/
+
+static i3String *font_texts[NUM_TEXTS];
+static xcb_pixmap_t pixmap;
+static xcb_gcontext_t gc;
+
+static void bench_predict_text_width(long i) {
+    sink += predict_text_width(font_texts[i % NUM_TEXTS]);
+}
+
+static void bench_predict_text_width_uncached(long i) {
+    /* A new string every time, so that nothing which is cached per i3String
+     * helps. */
+    i3String *str = i3string_from_utf8(texts[i % NUM_TEXTS]);
+    sink += predict_text_width(str);
+    i3string_free(str);
+}
+
+static void bench_draw_text(long i) {
+    draw_text(font_texts[i % NUM_TEXTS], pixmap, gc, 2, 2, 500);
+    /* Do not let the X server fall behind too far. */
+    if ((i % 1000) == 999)
+        x_sync();
+}
+
+/*
+ * Loads the given font and runs the benchmarks which need it. Needs an X11
+ * connection.
+ *
+ */
+static void bench_font(const char *pattern) {
+    int screen;
+    conn = xcb_connect(NULL, &screen);
+    if (xcb_connection_has_error(conn)) {
+        fprintf(stderr, "Cannot connect to X11, skipping the font benchmarks\n");
+        return;
+    }
+    root_screen = xcb_aux_get_screen(conn, screen);
+
+    i3Font font = load_font(pattern, true);
+    set_font(&font);
+    printf("font: %s\n", pattern);
+
+    for (size_t i = 0; i < NUM_TEXTS; i++)
+        font_texts[i] = i3string_from_utf8(texts[i]);
+
+    pixmap = xcb_generate_id(conn);
+    gc = xcb_generate_id(conn);
+    xcb_create_pixmap(conn, root_screen->root_depth, pixmap, root_screen->root, 500, 20);
+    xcb_create_gc(conn, gc, pixmap, 0, 0);
+    set_font_colors(gc, get_colorpixel("#ffffff"), get_colorpixel("#285577"));
+
+    run("predict_text_width", iterations, bench_predict_text_width);
+    run("predict_text_width (new string)", iterations, bench_predict_text_width_uncached);
+
+    /* Drawing is a lot slower than everything else. */
+    x_sync();
+    run("draw_text", iterations / 10 + 1, bench_draw_text);
+    x_sync();
+
+    for (size_t i = 0; i < NUM_TEXTS; i++)
+        i3string_free(font_texts[i]);
+    xcb_free_gc(conn, gc);
+    xcb_free_pixmap(conn, pixmap);
+    free_font();
+    xcb_disconnect(conn);
+}
+
+/*******************************************************************************
+ * IPC
+ ******************************************************************************/
+
+static int ipc_sockets[2];
+static uint8_t *ipc_payload;
+static uint32_t ipc_payload_size;
+
+static void bench_ipc_roundtrip(long i) {
+    if (ipc_send_message(ipc_sockets[0], ipc_payload_size, 0, ipc_payload) == -1)
+        err(EXIT_FAILURE, "ipc_send_message");
+
+    uint32_t type, length;
+    uint8_t *reply;
+    if (ipc_recv_message(ipc_sockets[1], &type, &length, &reply) != 0)
+        errx(EXIT_FAILURE, "ipc_recv_message failed");
+    sink += length;
+    free(reply);
+}
+
+/*
+ * Sends messages of different sizes over a socketpair and reads them on the
+ * other end, in the same thread. The messages are small enough to fit into
+ * the socket buffer, so this measures the framing and copying (and the
+ * syscalls), not the scheduler.
+ *
+ */
+static void bench_ipc(void) {
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, ipc_sockets) == -1)
+        err(EXIT_FAILURE, "socketpair");
+
+    static const uint32_t sizes[] = { 16, 1024, 65536 };
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        ipc_payload_size = sizes[i];
+        ipc_payload = smalloc(ipc_payload_size);
+        memset(ipc_payload, 'x', ipc_payload_size);
+
+        char *name;
+        sasprintf(&name, "ipc send+recv (%u bytes)", ipc_payload_size);
+        /* Bigger messages take longer, keep the total amount of data in
+         * check. */
+        long count = iterations / (1 + ipc_payload_size / 4096);
+        run(name, (count > 0 ? count : 1), bench_ipc_roundtrip);
+        free(name);
+        free(ipc_payload);
+    }
+
+    close(ipc_sockets[0]);
+    close(ipc_sockets[1]);
+}
+
+int main(int argc, char *argv[]) {
+    char *pattern = "-misc-fixed-medium-r-normal--13-120-75-75-C-70-iso10646-1";
+    int o, option_index = 0;
+
+    static struct option long_options[] = {
+        {"iterations", required_argument, 0, 'n'},
+        {"font", required_argument, 0, 'f'},
+        {"bench", required_argument, 0, 'b'},
+        {"version", no_argument, 0, 'v'},
+        {"help", no_argument, 0, 'h'},
+        {0, 0, 0, 0}
+    };
+
+    char *options_string = "n:f:b:vh";
+
+    while ((o = getopt_long(argc, argv, options_string, long_options, &option_index)) != -1) {
+        switch (o) {
+            case 'n':
+                iterations = atol(optarg);
+                if (iterations <= 0)
+                    errx(EXIT_FAILURE, "The number of iterations has to be positive");
+                break;
+            case 'f':
+                pattern = optarg;
+                break;
+            case 'b':
+                filter = optarg;
+                break;
+            case 'v':
+                printf("libi3-bench " I3_VERSION "\n");
+                return 0;
+            default:
+                printf("libi3-bench " I3_VERSION "\n");
+                printf("libi3-bench [-n <iterations>] [-f <font>] [-b <benchmark>]\n");
+                printf("\n");
+                printf("-n <iterations>\tRun every benchmark that often (default: 100000)\n");
+                printf("-f <font>\tUse this font for the text benchmarks (use \"pango:…\" for Pango)\n");
+                printf("-b <benchmark>\tOnly run the benchmarks whose name contains this string\n");
+                return 0;
+        }
+    }
+
+    run("i3string_from_utf8", iterations, bench_i3string_from_utf8);
+    run("i3string_as_ucs2", iterations, bench_i3string_as_ucs2);
+
+    for (size_t i = 0; i < NUM_TEXTS; i++)
+        ucs2_texts[i] = convert_utf8_to_ucs2((char*)texts[i], &ucs2_lengths[i]);
+    run("convert_ucs2_to_utf8", iterations, bench_convert_ucs2_to_utf8);
+    for (size_t i = 0; i < NUM_TEXTS; i++)
+        free(ucs2_texts[i]);
+
+    run("get_colorpixel", iterations, bench_get_colorpixel);
+
+    bench_ipc();
+    bench_font(pattern);
+
+    return 0;
+}
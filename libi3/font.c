@@ -10,6 +10,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <math.h>
 #include <err.h>
 
 #if PANGO_SUPPORT
@@ -18,12 +19,110 @@
 #endif
 
 #include "libi3.h"
+#include "queue.h"
 
 extern xcb_connection_t *conn;
 extern xcb_screen_t *root_screen;
 
 static const i3Font *savedFont = NULL;
 
+#if PANGO_SUPPORT
+/*
+ * Measuring text with Pango requires a layout, yet the same window titles and
+ * workspace names are measured on every redraw. The most recently measured
+ * widths are therefore cached per font and text.
+ *
+ */
+struct width_cache_entry {
+    const i3Font *font;
+    uint32_t hash;
+    char *text;
+    size_t text_len;
+    int width;
+
+    TAILQ_ENTRY(width_cache_entry) entries;
+};
+
+/* Upper bound for the number of cached widths. */
+#define WIDTH_CACHE_SIZE 128
+
+/* Most recently used entries are at the head. */
+static TAILQ_HEAD(width_cache_head, width_cache_entry) width_cache =
+    TAILQ_HEAD_INITIALIZER(width_cache);
+static int width_cache_num;
+
+static uint32_t width_cache_hash(const char *text, size_t text_len) {
+    uint32_t hash = 5381;
+    for (size_t i = 0; i < text_len; i++)
+        hash = ((hash << 5) + hash) + (unsigned char)text[i];
+    return hash;
+}
+
+/*
+ * Looks up the width of the given text in the current font. Returns -1 if it
+ * is not cached.
+ *
+ */
+static int width_cache_lookup(const char *text, size_t text_len, uint32_t hash) {
+    struct width_cache_entry *entry;
+    TAILQ_FOREACH(entry, &width_cache, entries) {
+        if (entry->hash != hash ||
+            entry->font != savedFont ||
+            entry->text_len != text_len ||
+            memcmp(entry->text, text, text_len) != 0)
+            continue;
+
+        if (entry != TAILQ_FIRST(&width_cache)) {
+            TAILQ_REMOVE(&width_cache, entry, entries);
+            TAILQ_INSERT_HEAD(&width_cache, entry, entries);
+        }
+        return entry->width;
+    }
+    return -1;
+}
+
+static void width_cache_free_entry(struct width_cache_entry *entry) {
+    TAILQ_REMOVE(&width_cache, entry, entries);
+    free(entry->text);
+    free(entry);
+    width_cache_num--;
+}
+
+/*
+ * Stores the width of the given text in the current font, evicting the least
+ * recently used entry if the cache is full.
+ *
+ */
+static void width_cache_store(const char *text, size_t text_len, uint32_t hash, int width) {
+    if (width_cache_num == WIDTH_CACHE_SIZE)
+        width_cache_free_entry(TAILQ_LAST(&width_cache, width_cache_head));
+
+    struct width_cache_entry *entry = smalloc(sizeof(struct width_cache_entry));
+    entry->font = savedFont;
+    entry->hash = hash;
+    entry->text = smalloc(text_len + 1);
+    memcpy(entry->text, text, text_len);
+    entry->text_len = text_len;
+    entry->width = width;
+    TAILQ_INSERT_HEAD(&width_cache, entry, entries);
+    width_cache_num++;
+}
+
+/*
+ * Forgets all cached widths of the given font, for example because it is
+ * about to be freed (and another font might be loaded at the same address).
+ *
+ */
+static void width_cache_clear(const i3Font *font) {
+    struct width_cache_entry *entry, *next;
+    for (entry = TAILQ_FIRST(&width_cache); entry != TAILQ_END(&width_cache); entry = next) {
+        next = TAILQ_NEXT(entry, entries);
+        if (entry->font == font)
+            width_cache_free_entry(entry);
+    }
+}
+#endif
+
 #if PANGO_SUPPORT
 static xcb_visualtype_t *root_visual_type;
 static double pango_font_red;
@@ -54,6 +153,198 @@ static PangoLayout *create_layout_with_dpi(cairo_t *cr) {
     return layout;
 }
 
+/*
+ * Creating a Pango context and layout (and figuring out the DPI) for every
+ * piece of text is expensive compared to drawing it, so one layout for the
+ * current font is kept around. Every caller updates it for its cairo context
+ * (pango_cairo_update_layout()) and sets the text and width it needs.
+ *
+ * Measuring text does not need a drawable, so it uses a cairo context of a
+ * 1x1 surface on the root window, which is kept as well.
+ *
+ * Surfaces for the drawables which are drawn onto are still created per call:
+ * drawables come and go without libi3 noticing, and a cached surface would
+ * keep using the old drawable even when its XID got reused.
+ *
+ */
+static PangoLayout *cached_layout;
+static const i3Font *cached_layout_font;
+static cairo_surface_t *root_surface;
+static cairo_t *root_cr;
+
+/*
+ * Returns a cairo context on the root window, used for measuring text.
+ *
+ */
+static cairo_t *get_root_cairo(void) {
+    if (root_cr == NULL) {
+        /* root_visual_type is cached in load_pango_font */
+        root_surface = cairo_xcb_surface_create(conn, root_screen->root, root_visual_type, 1, 1);
+        root_cr = cairo_create(root_surface);
+    }
+    return root_cr;
+}
+
+/*
+ * Returns the layout for the current font, updated for the given cairo
+ * context. The caller needs to set the text, width and ellipsization.
+ *
+ */
+static PangoLayout *get_layout(cairo_t *cr) {
+    if (cached_layout == NULL || cached_layout_font != savedFont) {
+        if (cached_layout != NULL)
+            g_object_unref(cached_layout);
+        cached_layout = create_layout_with_dpi(get_root_cairo());
+        cached_layout_font = savedFont;
+        pango_layout_set_font_description(cached_layout, savedFont->specific.pango_desc);
+        pango_layout_set_wrap(cached_layout, PANGO_WRAP_CHAR);
+    }
+    pango_cairo_update_layout(cr, cached_layout);
+    return cached_layout;
+}
+
+/*
+ * Forgets the cached layout if it belongs to the given font, for example
+ * because the font is about to be freed.
+ *
+ */
+static void layout_cache_clear(const i3Font *font) {
+    if (cached_layout == NULL || cached_layout_font != font)
+        return;
+    g_object_unref(cached_layout);
+    cached_layout = NULL;
+    cached_layout_font = NULL;
+}
+
+/*
+ * Most window titles and bar texts are short printable ASCII strings, which
+ * do not need Pango's itemization, shaping and line breaking. With the glyph
+ * cache (see set_font_glyph_cache()), the glyph index and advance of every
+ * printable ASCII character are looked up once per font, and such strings are
+ * drawn directly with cairo_show_glyphs(). On an X drawable, cairo uploads
+ * the rasterized glyphs to a server-side XRender glyph set once and draws
+ * them with CompositeGlyphs.
+ *
+ * Text drawn this way is not kerned. Strings with other characters, with
+ * characters the font does not contain (Pango would use a fallback font) or
+ * which have to be ellipsized still go through Pango.
+ *
+ */
+#define GLYPH_CACHE_FIRST 0x20
+#define GLYPH_CACHE_LAST 0x7E
+#define GLYPH_CACHE_SIZE (GLYPH_CACHE_LAST - GLYPH_CACHE_FIRST + 1)
+
+/* Longer strings are passed to Pango. */
+#define GLYPH_CACHE_MAX_TEXT 256
+
+struct glyph_cache {
+    const i3Font *font;
+    /* NULL if the font cannot be used without Pango. */
+    cairo_scaled_font_t *scaled_font;
+    /* Offset of the baseline from the y coordinate passed to draw_text(),
+     * matching the position of text drawn via Pango. */
+    double baseline;
+
+    unsigned long index[GLYPH_CACHE_SIZE];
+    double advance[GLYPH_CACHE_SIZE];
+    /* false if the font has no glyph for the character */
+    bool valid[GLYPH_CACHE_SIZE];
+};
+
+static bool glyph_cache_enabled = false;
+static struct glyph_cache *glyph_cache;
+
+/*
+ * Forgets the glyph cache if it belongs to the given font.
+ *
+ */
+static void glyph_cache_clear(const i3Font *font) {
+    if (glyph_cache == NULL || glyph_cache->font != font)
+        return;
+    if (glyph_cache->scaled_font != NULL)
+        cairo_scaled_font_destroy(glyph_cache->scaled_font);
+    free(glyph_cache);
+    glyph_cache = NULL;
+}
+
+/*
+ * Looks up the glyphs of the printable ASCII characters in the current font.
+ *
+ */
+static void glyph_cache_build(void) {
+    if (glyph_cache != NULL)
+        glyph_cache_clear(glyph_cache->font);
+    glyph_cache = scalloc(sizeof(struct glyph_cache));
+    glyph_cache->font = savedFont;
+
+    PangoLayout *layout = get_layout(get_root_cairo());
+    PangoFont *pango_font = pango_context_load_font(pango_layout_get_context(layout),
+                                                    savedFont->specific.pango_desc);
+    if (pango_font == NULL)
+        return;
+    cairo_scaled_font_t *scaled_font = pango_cairo_font_get_scaled_font(PANGO_CAIRO_FONT(pango_font));
+    if (scaled_font == NULL || cairo_scaled_font_status(scaled_font) != CAIRO_STATUS_SUCCESS) {
+        g_object_unref(pango_font);
+        return;
+    }
+    glyph_cache->scaled_font = cairo_scaled_font_reference(scaled_font);
+    g_object_unref(pango_font);
+
+    for (int c = GLYPH_CACHE_FIRST; c <= GLYPH_CACHE_LAST; c++) {
+        const char utf8 = c;
+        cairo_glyph_t *glyphs = NULL;
+        int num_glyphs = 0;
+        if (cairo_scaled_font_text_to_glyphs(scaled_font, 0, 0, &utf8, 1, &glyphs, &num_glyphs,
+                                             NULL, NULL, NULL) != CAIRO_STATUS_SUCCESS)
+            continue;
+        /* Glyph 0 is the “missing glyph” box. */
+        if (num_glyphs == 1 && glyphs[0].index != 0) {
+            cairo_text_extents_t extents;
+            cairo_scaled_font_glyph_extents(scaled_font, glyphs, 1, &extents);
+            glyph_cache->index[c - GLYPH_CACHE_FIRST] = glyphs[0].index;
+            glyph_cache->advance[c - GLYPH_CACHE_FIRST] = extents.x_advance;
+            glyph_cache->valid[c - GLYPH_CACHE_FIRST] = true;
+        }
+        cairo_glyph_free(glyphs);
+    }
+
+    /* See draw_text_pango_cairo() for how Pango positions the text. */
+    gint height;
+    pango_layout_set_width(layout, -1);
+    pango_layout_set_text(layout, "A", 1);
+    pango_layout_get_pixel_size(layout, NULL, &height);
+    glyph_cache->baseline = (double)pango_layout_get_baseline(layout) / PANGO_SCALE -
+                            (height - savedFont->height);
+}
+
+/*
+ * Fills in the glyphs for the given text (positioned at the origin) and their
+ * total width. Returns false if the text has to be drawn via Pango.
+ *
+ */
+static bool glyph_cache_get_glyphs(const char *text, size_t text_len, cairo_glyph_t *glyphs, double *width) {
+    if (!glyph_cache_enabled || text_len > GLYPH_CACHE_MAX_TEXT)
+        return false;
+    if (glyph_cache == NULL || glyph_cache->font != savedFont)
+        glyph_cache_build();
+    if (glyph_cache->scaled_font == NULL)
+        return false;
+
+    double x = 0;
+    for (size_t i = 0; i < text_len; i++) {
+        const unsigned char c = text[i];
+        if (c < GLYPH_CACHE_FIRST || c > GLYPH_CACHE_LAST ||
+            !glyph_cache->valid[c - GLYPH_CACHE_FIRST])
+            return false;
+        glyphs[i].index = glyph_cache->index[c - GLYPH_CACHE_FIRST];
+        glyphs[i].x = x;
+        glyphs[i].y = 0;
+        x += glyph_cache->advance[c - GLYPH_CACHE_FIRST];
+    }
+    *width = x;
+    return true;
+}
+
 /*
  * Loads a Pango font description into an i3Font structure. Returns true
  * on success, false otherwise.
@@ -78,9 +369,7 @@ static bool load_pango_font(i3Font *font, const char *desc) {
     root_visual_type = get_visualtype(root_screen);
 
     /* Create a dummy Pango layout to compute the font height */
-    cairo_surface_t *surface = cairo_xcb_surface_create(conn, root_screen->root, root_visual_type, 1, 1);
-    cairo_t *cr = cairo_create(surface);
-    PangoLayout *layout = create_layout_with_dpi(cr);
+    PangoLayout *layout = create_layout_with_dpi(get_root_cairo());
     pango_layout_set_font_description(layout, font->specific.pango_desc);
 
     /* Get the font height */
@@ -90,8 +379,6 @@ static bool load_pango_font(i3Font *font, const char *desc) {
 
     /* Free resources */
     g_object_unref(layout);
-    cairo_destroy(cr);
-    cairo_surface_destroy(surface);
 
     /* Set the font type and return successfully */
     font->type = FONT_TYPE_PANGO;
@@ -99,35 +386,52 @@ static bool load_pango_font(i3Font *font, const char *desc) {
 }
 
 /*
- * Draws text using Pango rendering.
+ * Draws text using Pango rendering onto the given cairo context.
  *
  */
-static void draw_text_pango(const char *text, size_t text_len,
-        xcb_drawable_t drawable, int x, int y, int max_width) {
-    /* Create the Pango layout */
-    /* root_visual_type is cached in load_pango_font */
-    cairo_surface_t *surface = cairo_xcb_surface_create(conn, drawable,
-            root_visual_type, x + max_width, y + savedFont->height);
-    cairo_t *cr = cairo_create(surface);
-    PangoLayout *layout = create_layout_with_dpi(cr);
+static void draw_text_pango_cairo(const char *text, size_t text_len,
+        cairo_t *cr, int x, int y, int max_width) {
+    cairo_glyph_t glyphs[GLYPH_CACHE_MAX_TEXT];
+    double width;
+    if (glyph_cache_get_glyphs(text, text_len, glyphs, &width) && width <= max_width) {
+        for (size_t i = 0; i < text_len; i++) {
+            glyphs[i].x += x;
+            glyphs[i].y = y + glyph_cache->baseline;
+        }
+        cairo_set_source_rgb(cr, pango_font_red, pango_font_green, pango_font_blue);
+        cairo_set_scaled_font(cr, glyph_cache->scaled_font);
+        cairo_show_glyphs(cr, glyphs, text_len);
+        return;
+    }
+
+    PangoLayout *layout = get_layout(cr);
     gint height;
 
-    pango_layout_set_font_description(layout, savedFont->specific.pango_desc);
     pango_layout_set_width(layout, max_width * PANGO_SCALE);
-    pango_layout_set_wrap(layout, PANGO_WRAP_CHAR);
     pango_layout_set_ellipsize(layout, PANGO_ELLIPSIZE_END);
 
     pango_layout_set_text(layout, text, text_len);
 
     /* Do the drawing */
     cairo_set_source_rgb(cr, pango_font_red, pango_font_green, pango_font_blue);
-    pango_cairo_update_layout(cr, layout);
     pango_layout_get_pixel_size(layout, NULL, &height);
     cairo_move_to(cr, x, y - (height - savedFont->height));
     pango_cairo_show_layout(cr, layout);
+}
+
+/*
+ * Draws text using Pango rendering.
+ *
+ */
+static void draw_text_pango(const char *text, size_t text_len,
+        xcb_drawable_t drawable, int x, int y, int max_width) {
+    /* root_visual_type is cached in load_pango_font */
+    cairo_surface_t *surface = cairo_xcb_surface_create(conn, drawable,
+            root_visual_type, x + max_width, y + savedFont->height);
+    cairo_t *cr = cairo_create(surface);
+
+    draw_text_pango_cairo(text, text_len, cr, x, y, max_width);
 
-    /* Free resources */
-    g_object_unref(layout);
     cairo_destroy(cr);
     cairo_surface_destroy(surface);
 }
@@ -137,24 +441,20 @@ static void draw_text_pango(const char *text, size_t text_len,
  *
  */
 static int predict_text_width_pango(const char *text, size_t text_len) {
-    /* Create a dummy Pango layout */
-    /* root_visual_type is cached in load_pango_font */
-    cairo_surface_t *surface = cairo_xcb_surface_create(conn, root_screen->root, root_visual_type, 1, 1);
-    cairo_t *cr = cairo_create(surface);
-    PangoLayout *layout = create_layout_with_dpi(cr);
+    cairo_glyph_t glyphs[GLYPH_CACHE_MAX_TEXT];
+    double glyphs_width;
+    if (glyph_cache_get_glyphs(text, text_len, glyphs, &glyphs_width))
+        return (int)ceil(glyphs_width);
+
+    PangoLayout *layout = get_layout(get_root_cairo());
 
     /* Get the font width */
     gint width;
-    pango_layout_set_font_description(layout, savedFont->specific.pango_desc);
+    pango_layout_set_width(layout, -1);
+    pango_layout_set_ellipsize(layout, PANGO_ELLIPSIZE_NONE);
     pango_layout_set_text(layout, text, text_len);
-    pango_cairo_update_layout(cr, layout);
     pango_layout_get_pixel_size(layout, &width, NULL);
 
-    /* Free resources */
-    g_object_unref(layout);
-    cairo_destroy(cr);
-    cairo_surface_destroy(surface);
-
     return width;
 }
 #endif
@@ -250,6 +550,24 @@ void set_font(i3Font *font) {
     savedFont = font;
 }
 
+/*
+ * Enables or disables drawing printable ASCII text with cached glyphs,
+ * bypassing Pango’s layout and shaping (only affects Pango fonts). Such text
+ * is not kerned.
+ *
+ */
+void set_font_glyph_cache(bool enable) {
+#if PANGO_SUPPORT
+    if (glyph_cache_enabled == enable)
+        return;
+    glyph_cache_enabled = enable;
+
+    /* Texts might be slightly narrower or wider now. */
+    while (!TAILQ_EMPTY(&width_cache))
+        width_cache_free_entry(TAILQ_FIRST(&width_cache));
+#endif
+}
+
 /*
  * Frees the resources taken by the current font.
  *
@@ -271,6 +589,9 @@ void free_font(void) {
         case FONT_TYPE_PANGO:
             /* Free the font description */
             pango_font_description_free(savedFont->specific.pango_desc);
+            width_cache_clear(savedFont);
+            layout_cache_clear(savedFont);
+            glyph_cache_clear(savedFont);
             break;
 #endif
         default:
@@ -374,6 +695,27 @@ void draw_text(i3String *text, xcb_drawable_t drawable,
     }
 }
 
+#if PANGO_SUPPORT
+/*
+ * Draws text onto the given cairo context (e.g. one of an image surface,
+ * which is rendered client-side) like draw_text() does, using the colors set
+ * with set_font_colors().
+ *
+ * Only Pango fonts can be drawn this way. Returns false for other fonts.
+ *
+ */
+bool draw_text_cairo(i3String *text, cairo_t *cr, int x, int y, int max_width) {
+    assert(savedFont != NULL);
+
+    if (savedFont->type != FONT_TYPE_PANGO)
+        return false;
+
+    draw_text_pango_cairo(i3string_as_utf8(text), i3string_get_num_bytes(text),
+                          cr, x, y, max_width);
+    return true;
+}
+#endif
+
 /*
  * ASCII version of draw_text to print static strings.
  *
@@ -414,72 +756,64 @@ void draw_text_ascii(const char *text, xcb_drawable_t drawable,
     }
 }
 
-static int xcb_query_text_width(const xcb_char2b_t *text, size_t text_len) {
-    /* Make the user know we’re using the slow path, but only once. */
-    static bool first_invocation = true;
-    if (first_invocation) {
-        fprintf(stderr, "Using slow code path for text extents\n");
-        first_invocation = false;
-    }
-
-    /* Query the text width */
-    xcb_generic_error_t *error;
-    xcb_query_text_extents_cookie_t cookie = xcb_query_text_extents(conn,
-            savedFont->specific.xcb.id, text_len, (xcb_char2b_t*)text);
-    xcb_query_text_extents_reply_t *reply = xcb_query_text_extents_reply(conn,
-            cookie, &error);
-    if (reply == NULL) {
-        /* We return a safe estimate because a rendering error is better than
-         * a crash. Plus, the user will see the error in his log. */
-        fprintf(stderr, "Could not get text extents (X error code %d)\n",
-                error->error_code);
-        return savedFont->specific.xcb.info->max_bounds.character_width * text_len;
-    }
-
-    int width = reply->overall_width;
-    free(reply);
-    return width;
+/*
+ * Returns the metrics of the given glyph, or NULL if the font does not contain
+ * it. Fonts which have the same metrics for all their glyphs do not send a
+ * per-character table (see XQueryFont), in that case max_bounds applies to all
+ * glyphs in the range.
+ *
+ */
+static xcb_charinfo_t *xcb_glyph_info(int row, int col) {
+    xcb_query_font_reply_t *font_info = savedFont->specific.xcb.info;
+    xcb_charinfo_t *font_table = savedFont->specific.xcb.table;
+
+    if (row < font_info->min_byte1 ||
+        row > font_info->max_byte1 ||
+        col < font_info->min_char_or_byte2 ||
+        col > font_info->max_char_or_byte2)
+        return NULL;
+
+    if (font_table == NULL)
+        return &(font_info->max_bounds);
+
+    /* Don't you ask me, how this one works… (Merovius) */
+    xcb_charinfo_t *info = &font_table[((row - font_info->min_byte1) *
+            (font_info->max_char_or_byte2 - font_info->min_char_or_byte2 + 1)) +
+        (col - font_info->min_char_or_byte2)];
+
+    /* Glyphs without any metrics do not exist in this font */
+    if (info->character_width == 0 &&
+        (info->right_side_bearing |
+         info->left_side_bearing |
+         info->ascent |
+         info->descent) == 0)
+        return NULL;
+
+    return info;
 }
 
+/*
+ * Predicts the text width from the font’s metrics, so that we never need to
+ * ask the X server (QueryTextExtents) and wait for its reply. Like the X
+ * server, we draw glyphs which the font does not contain using the font’s
+ * default_char (if that does not exist either, nothing is drawn).
+ *
+ */
 static int predict_text_width_xcb(const xcb_char2b_t *input, size_t text_len) {
     if (text_len == 0)
         return 0;
 
-    int width;
-    if (savedFont->specific.xcb.table == NULL) {
-        /* If we don't have a font table, fall back to querying the server */
-        width = xcb_query_text_width(input, text_len);
-    } else {
-        /* Save some pointers for convenience */
-        xcb_query_font_reply_t *font_info = savedFont->specific.xcb.info;
-        xcb_charinfo_t *font_table = savedFont->specific.xcb.table;
-
-        /* Calculate the width using the font table */
-        width = 0;
-        for (size_t i = 0; i < text_len; i++) {
-            xcb_charinfo_t *info;
-            int row = input[i].byte1;
-            int col = input[i].byte2;
-
-            if (row < font_info->min_byte1 ||
-                row > font_info->max_byte1 ||
-                col < font_info->min_char_or_byte2 ||
-                col > font_info->max_char_or_byte2)
-                continue;
-
-            /* Don't you ask me, how this one works… (Merovius) */
-            info = &font_table[((row - font_info->min_byte1) *
-                    (font_info->max_char_or_byte2 - font_info->min_char_or_byte2 + 1)) +
-                (col - font_info->min_char_or_byte2)];
-
-            if (info->character_width != 0 ||
-                    (info->right_side_bearing |
-                     info->left_side_bearing |
-                     info->ascent |
-                     info->descent) != 0) {
-                width += info->character_width;
-            }
-        }
+    xcb_query_font_reply_t *font_info = savedFont->specific.xcb.info;
+    xcb_charinfo_t *default_info = xcb_glyph_info(font_info->default_char >> 8,
+                                                  font_info->default_char & 0xFF);
+
+    int width = 0;
+    for (size_t i = 0; i < text_len; i++) {
+        xcb_charinfo_t *info = xcb_glyph_info(input[i].byte1, input[i].byte2);
+        if (info == NULL)
+            info = default_info;
+        if (info != NULL)
+            width += info->character_width;
     }
 
     return width;
@@ -500,9 +834,18 @@ int predict_text_width(i3String *text) {
         case FONT_TYPE_XCB:
             return predict_text_width_xcb(i3string_as_ucs2(text), i3string_get_num_glyphs(text));
 #if PANGO_SUPPORT
-        case FONT_TYPE_PANGO:
+        case FONT_TYPE_PANGO: {
             /* Calculate extents using Pango */
-            return predict_text_width_pango(i3string_as_utf8(text), i3string_get_num_bytes(text));
+            const char *utf8 = i3string_as_utf8(text);
+            size_t num_bytes = i3string_get_num_bytes(text);
+            uint32_t hash = width_cache_hash(utf8, num_bytes);
+            int width = width_cache_lookup(utf8, num_bytes, hash);
+            if (width == -1) {
+                width = predict_text_width_pango(utf8, num_bytes);
+                width_cache_store(utf8, num_bytes, hash, width);
+            }
+            return width;
+        }
 #endif
         default:
             assert(false);
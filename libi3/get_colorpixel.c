@@ -10,6 +10,16 @@
 
 #include "libi3.h"
 
+static int hex_digit(char c) {
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+
 /*
  * Returns the colorpixel to use for the given hex color (think of HTML). Only
  * works for true-color (vast majority of cases) at the moment, avoiding a
@@ -25,12 +35,26 @@
  *
  */
 uint32_t get_colorpixel(const char *hex) {
-    char strgroups[3][3] = {{hex[1], hex[2], '\0'},
-                            {hex[3], hex[4], '\0'},
-                            {hex[5], hex[6], '\0'}};
-    uint8_t r = strtol(strgroups[0], NULL, 16);
-    uint8_t g = strtol(strgroups[1], NULL, 16);
-    uint8_t b = strtol(strgroups[2], NULL, 16);
+    /* Only look at the six digits after the #, and not beyond the end of
+     * the string. */
+    size_t len = 0;
+    if (hex[0] != '\0')
+        while (len < 6 && hex[1 + len] != '\0')
+            len++;
+
+    /* Like strtol() on every pair of digits: a component ends at the first
+     * character which is not a hex digit, missing components are 0. */
+    uint8_t components[3] = { 0, 0, 0 };
+    for (size_t i = 0; i < 3; i++) {
+        int high = (2 * i < len ? hex_digit(hex[1 + 2 * i]) : -1);
+        if (high < 0)
+            continue;
+        int low = (2 * i + 1 < len ? hex_digit(hex[2 + 2 * i]) : -1);
+        components[i] = (low < 0 ? high : (high << 4) | low);
+    }
+    uint8_t r = components[0];
+    uint8_t g = components[1];
+    uint8_t b = components[2];
 
     /* We set the first 8 bits high to have 100% opacity in case of a 32 bit
      * color depth visual. */
@@ -0,0 +1,75 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009-2013 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <xcb/xcb.h>
+
+#include "libi3.h"
+
+/*
+ * Returns the path of the file in which i3 publishes the path of its IPC
+ * socket for the current display ($XDG_RUNTIME_DIR/i3/socket-path.$DISPLAY),
+ * or NULL if XDG_RUNTIME_DIR or DISPLAY are not set.
+ *
+ * The memory has to be free()d by the caller.
+ *
+ */
+char *socket_path_file(void) {
+    const char *runtime_dir = getenv("XDG_RUNTIME_DIR");
+    const char *display = getenv("DISPLAY");
+    if (runtime_dir == NULL || display == NULL || *display == '\0')
+        return NULL;
+
+    char *filename;
+    sasprintf(&filename, "%s/i3/socket-path.%s", runtime_dir, display);
+    /* DISPLAY may contain slashes (e.g. on OS X), which must not end up as
+     * directories in the file name. */
+    for (char *walk = filename + strlen(runtime_dir) + strlen("/i3/"); *walk != '\0'; walk++) {
+        if (*walk == '/')
+            *walk = '_';
+    }
+    return filename;
+}
+
+/*
+ * Returns the IPC socket path of the i3 instance running on the current
+ * display, or NULL if it cannot be found.
+ *
+ * The path is read from socket_path_file() if possible, which does not need
+ * the X server at all. Otherwise, the I3_SOCKET_PATH atom is used (see
+ * root_atom_contents(), which also explains provided_conn and screen).
+ *
+ * The memory has to be free()d by the caller.
+ *
+ */
+char *get_socket_path(xcb_connection_t *provided_conn, int screen) {
+    char *filename = socket_path_file();
+    if (filename != NULL) {
+        FILE *f = fopen(filename, "r");
+        free(filename);
+        if (f != NULL) {
+            char buffer[PATH_MAX];
+            bool found = (fgets(buffer, sizeof(buffer), f) != NULL);
+            fclose(f);
+
+            /* Only trust the file if the socket it names still exists,
+             * otherwise i3 might have been killed without cleaning up. */
+            struct stat st;
+            if (found && stat(buffer, &st) == 0 && S_ISSOCK(st.st_mode))
+                return sstrdup(buffer);
+        }
+    }
+
+    return root_atom_contents("I3_SOCKET_PATH", provided_conn, screen);
+}
@@ -38,8 +38,11 @@ int ipc_recv_message(int sockfd, uint32_t *message_type,
     uint32_t read_bytes = 0;
     while (read_bytes < to_read) {
         int n = read(sockfd, msg + read_bytes, to_read - read_bytes);
-        if (n == -1)
+        if (n == -1) {
+            if (errno == EINTR)
+                continue;
             return -1;
+        }
         if (n == 0) {
             ELOG("IPC: received EOF instead of reply\n");
             return -2;
@@ -67,11 +70,113 @@ int ipc_recv_message(int sockfd, uint32_t *message_type,
         if ((n = read(sockfd, *reply + read_bytes, *reply_length - read_bytes)) == -1) {
             if (errno == EINTR || errno == EAGAIN)
                 continue;
+            free(*reply);
             return -1;
         }
+        if (n == 0) {
+            ELOG("IPC: received EOF in the middle of a reply\n");
+            free(*reply);
+            return -3;
+        }
 
         read_bytes += n;
     }
 
     return 0;
 }
+
+/* The buffer is allocated with at least this size, so that most messages fit
+ * into it right away. */
+#define IPC_RECV_BUFFER_SIZE 4096
+
+/* Buffers are kept allocated between messages as long as they do not exceed
+ * this size. */
+#define IPC_RECV_BUFFER_KEEP_SIZE (64 * 1024)
+
+/*
+ * Reads as much as is available from the given non-blocking socket into the
+ * buffer and returns the next complete message from it, if any. message
+ * points into the buffer and stays valid until the next call.
+ *
+ * Returns 1 when no complete message is available yet (the socket would
+ * block). The partial message stays in the buffer.
+ * Returns 0 on success.
+ * Returns the same errors as ipc_recv_message() otherwise.
+ *
+ */
+int ipc_recv_message_buffered(int sockfd, ipc_recv_buffer *buffer,
+                              uint32_t *message_type, uint32_t *message_length,
+                              uint8_t **message) {
+    const size_t magic_length = strlen(I3_IPC_MAGIC);
+    const size_t header_size = magic_length + sizeof(uint32_t) + sizeof(uint32_t);
+
+    while (true) {
+        /* The complete message might already be in the buffer, e.g. when a
+         * client sent several messages at once. */
+        size_t needed = header_size;
+        if (buffer->size >= header_size) {
+            const uint8_t *walk = buffer->data + buffer->offset;
+            if (memcmp(walk, I3_IPC_MAGIC, magic_length) != 0) {
+                ELOG("IPC: invalid magic in message\n");
+                return -3;
+            }
+
+            uint32_t length;
+            memcpy(&length, walk + magic_length, sizeof(uint32_t));
+            if (buffer->max_message_size > 0 && length > buffer->max_message_size) {
+                ELOG("IPC: message of %u bytes exceeds the limit of %u bytes\n",
+                     length, buffer->max_message_size);
+                return -3;
+            }
+            needed = header_size + length;
+
+            if (buffer->size >= needed) {
+                *message_length = length;
+                if (message_type != NULL)
+                    memcpy(message_type, walk + magic_length + sizeof(uint32_t), sizeof(uint32_t));
+                *message = buffer->data + buffer->offset + header_size;
+
+                buffer->offset += needed;
+                buffer->size -= needed;
+                return 0;
+            }
+        }
+
+        /* Move the partial message to the beginning, which also drops the
+         * messages returned before. Don’t hold on to the memory of a big
+         * message forever. */
+        if (buffer->size == 0 && buffer->capacity > IPC_RECV_BUFFER_KEEP_SIZE) {
+            free(buffer->data);
+            buffer->data = NULL;
+            buffer->capacity = 0;
+        } else if (buffer->offset > 0) {
+            memmove(buffer->data, buffer->data + buffer->offset, buffer->size);
+        }
+        buffer->offset = 0;
+
+        if (needed < IPC_RECV_BUFFER_SIZE)
+            needed = IPC_RECV_BUFFER_SIZE;
+        if (buffer->capacity < needed) {
+            buffer->data = srealloc(buffer->data, needed);
+            buffer->capacity = needed;
+        }
+
+        ssize_t n = read(sockfd, buffer->data + buffer->size, buffer->capacity - buffer->size);
+        if (n == -1) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                return 1;
+            return -1;
+        }
+        if (n == 0) {
+            if (buffer->size > 0) {
+                ELOG("IPC: received EOF in the middle of a message\n");
+                return -3;
+            }
+            return -2;
+        }
+
+        buffer->size += n;
+    }
+}
@@ -7,6 +7,13 @@ libi3_LIBS     =
 
 libi3_OBJECTS := $(libi3_SOURCES:.c=.o)
 
+# The benchmark is neither built by default nor installed, see bench-libi3.
+libi3_bench_SOURCES := $(wildcard libi3/bench/*.c)
+libi3_bench_CFLAGS   = $(XCB_CFLAGS) $(PANGO_CFLAGS)
+libi3_bench_LIBS     = $(XCB_LIBS) $(PANGO_LIBS)
+
+libi3_bench_OBJECTS := $(libi3_bench_SOURCES:.c=.o)
+
 
 libi3/%.o: libi3/%.c $(libi3_HEADERS)
 	echo "[libi3] CC $<"
@@ -16,6 +23,18 @@ libi3.a: $(libi3_OBJECTS)
 	echo "[libi3] AR libi3.a"
 	$(AR) rcs $@ $^ $(libi3_LIBS)
 
+libi3/bench/%.o: libi3/bench/%.c $(libi3_HEADERS)
+	echo "[libi3] CC $<"
+	$(CC) $(I3_CPPFLAGS) $(XCB_CPPFLAGS) $(CPPFLAGS) $(libi3_bench_CFLAGS) $(I3_CFLAGS) $(CFLAGS) -c -o $@ $<
+
+libi3/bench/libi3-bench: libi3.a $(libi3_bench_OBJECTS)
+	echo "[libi3] Link libi3-bench"
+	$(CC) $(I3_LDFLAGS) $(LDFLAGS) -o $@ $(filter-out libi3.a,$^) $(LIBS) $(libi3_bench_LIBS)
+
+bench-libi3: libi3/bench/libi3-bench
+	./libi3/bench/libi3-bench $(BENCH_ARGS)
+
 clean-libi3:
 	echo "[libi3] Clean"
 	rm -f $(libi3_OBJECTS) libi3/libi3.a libi3.a
+	rm -f $(libi3_bench_OBJECTS) libi3/bench/libi3-bench
@@ -20,8 +20,42 @@ struct _i3String {
     xcb_char2b_t *ucs2;
     size_t num_glyphs;
     size_t num_bytes;
+
+    /* Number of references, see i3string_ref() */
+    int refcount;
+    /* Interned strings are found in intern_buckets, see i3string_intern() */
+    bool interned;
+    uint32_t hash;
+    struct _i3String *next_interned;
 };
 
+#define INTERN_BUCKETS 256
+
+static struct _i3String *intern_buckets[INTERN_BUCKETS];
+
+/* The number of i3Strings and the bytes they use, see i3string_memory_usage() */
+static size_t strings_num;
+static size_t strings_bytes;
+
+static size_t string_bytes(const i3String *str) {
+    return sizeof(i3String) +
+           (str->utf8 != NULL ? str->num_bytes + 1 : 0) +
+           (str->ucs2 != NULL ? str->num_glyphs * sizeof(xcb_char2b_t) : 0);
+}
+
+static i3String *string_created(i3String *str) {
+    strings_num++;
+    strings_bytes += string_bytes(str);
+    return str;
+}
+
+static uint32_t intern_hash(const char *utf8, size_t num_bytes) {
+    uint32_t hash = 2166136261u;
+    for (size_t c = 0; c < num_bytes; c++)
+        hash = (hash ^ (unsigned char)utf8[c]) * 16777619u;
+    return hash;
+}
+
 /*
  * Build an i3String from an UTF-8 encoded string.
  * Returns the newly-allocated i3String.
@@ -35,8 +69,9 @@ i3String *i3string_from_utf8(const char *from_utf8) {
 
     /* Compute and store the length */
     str->num_bytes = strlen(str->utf8);
+    str->refcount = 1;
 
-    return str;
+    return string_created(str);
 }
 
 /*
@@ -55,7 +90,44 @@ i3String *i3string_from_utf8_with_length(const char *from_utf8, size_t num_bytes
 
     /* Store the length */
     str->num_bytes = num_bytes;
+    str->refcount = 1;
+
+    return string_created(str);
+}
+
+/*
+ * Returns the i3String for the given UTF-8 encoded string from the table of
+ * interned strings, adding it if necessary. All users of the same text share
+ * one i3String (and its UCS-2 form), so interned strings can be compared
+ * with i3string_equals() by their pointers. The returned reference has to be
+ * released with i3string_free().
+ *
+ */
+i3String *i3string_intern(const char *from_utf8, size_t num_bytes) {
+    uint32_t hash = intern_hash(from_utf8, num_bytes);
+    i3String **bucket = &intern_buckets[hash % INTERN_BUCKETS];
+    for (i3String *str = *bucket; str != NULL; str = str->next_interned) {
+        if (str->hash == hash && str->num_bytes == num_bytes &&
+            memcmp(str->utf8, from_utf8, num_bytes) == 0)
+            return i3string_ref(str);
+    }
 
+    i3String *str = i3string_from_utf8_with_length(from_utf8, num_bytes);
+    str->interned = true;
+    str->hash = hash;
+    str->next_interned = *bucket;
+    *bucket = str;
+    return str;
+}
+
+/*
+ * Returns another reference to the given i3String, which has to be released
+ * with i3string_free() as well. This replaces copying strings which are not
+ * modified afterwards.
+ *
+ */
+i3String *i3string_ref(i3String *str) {
+    str->refcount++;
     return str;
 }
 
@@ -77,17 +149,29 @@ i3String *i3string_from_ucs2(const xcb_char2b_t *from_ucs2, size_t num_glyphs) {
 
     str->utf8 = NULL;
     str->num_bytes = 0;
+    str->refcount = 1;
 
-    return str;
+    return string_created(str);
 }
 
 /*
- * Free an i3String.
+ * Releases a reference to an i3String and frees it once the last reference
+ * is gone.
  *
  */
 void i3string_free(i3String *str) {
-    if (str == NULL)
+    if (str == NULL || --(str->refcount) > 0)
         return;
+
+    if (str->interned) {
+        i3String **link = &intern_buckets[str->hash % INTERN_BUCKETS];
+        while (*link != str)
+            link = &((*link)->next_interned);
+        *link = str->next_interned;
+    }
+
+    strings_num--;
+    strings_bytes -= string_bytes(str);
     free(str->utf8);
     free(str->ucs2);
     free(str);
@@ -96,14 +180,18 @@ void i3string_free(i3String *str) {
 static void i3string_ensure_utf8(i3String *str) {
     if (str->utf8 != NULL)
         return;
-    if ((str->utf8 = convert_ucs2_to_utf8(str->ucs2, str->num_glyphs)) != NULL)
+    if ((str->utf8 = convert_ucs2_to_utf8(str->ucs2, str->num_glyphs)) != NULL) {
         str->num_bytes = strlen(str->utf8);
+        strings_bytes += str->num_bytes + 1;
+    }
 }
 
 static void i3string_ensure_ucs2(i3String *str) {
     if (str->ucs2 != NULL)
         return;
     str->ucs2 = convert_utf8_to_ucs2(str->utf8, &str->num_glyphs);
+    if (str->ucs2 != NULL)
+        strings_bytes += str->num_glyphs * sizeof(xcb_char2b_t);
 }
 
 /*
@@ -141,3 +229,30 @@ size_t i3string_get_num_glyphs(i3String *str) {
     i3string_ensure_ucs2(str);
     return str->num_glyphs;
 }
+
+/*
+ * Returns the number of i3Strings which exist and the bytes they use
+ * (including both encodings of the text, if converted).
+ *
+ */
+void i3string_memory_usage(size_t *count, size_t *bytes) {
+    *count = strings_num;
+    *bytes = strings_bytes;
+}
+
+/*
+ * Returns true if both i3Strings contain the same text. Two interned strings
+ * are only compared by their pointers.
+ *
+ */
+bool i3string_equals(i3String *a, i3String *b) {
+    if (a == b)
+        return true;
+    if (a == NULL || b == NULL || (a->interned && b->interned))
+        return false;
+
+    i3string_ensure_utf8(a);
+    i3string_ensure_utf8(b);
+    return (a->num_bytes == b->num_bytes &&
+            memcmp(a->utf8, b->utf8, a->num_bytes) == 0);
+}
@@ -16,12 +16,68 @@
 static iconv_t utf8_conversion_descriptor = (iconv_t)-1;
 static iconv_t ucs2_conversion_descriptor = (iconv_t)-1;
 
+/*
+ * Converts the given UCS-2 string to UTF-8 without iconv if all of its
+ * characters are below U+0800 (ASCII, Latin-1 and most other alphabets),
+ * which covers almost all window titles. Returns NULL otherwise.
+ *
+ */
+static char *convert_ucs2_to_utf8_fast(xcb_char2b_t *text, size_t num_glyphs) {
+    size_t num_bytes = 0;
+    for (size_t c = 0; c < num_glyphs; c++) {
+        if (text[c].byte1 >= 0x08)
+            return NULL;
+        num_bytes += (text[c].byte1 == 0 && text[c].byte2 < 0x80 ? 1 : 2);
+    }
+
+    char *buffer = smalloc(num_bytes + 1);
+    char *output = buffer;
+    for (size_t c = 0; c < num_glyphs; c++) {
+        uint16_t glyph = (text[c].byte1 << 8) | text[c].byte2;
+        if (glyph < 0x80)
+            *(output++) = glyph;
+        else {
+            *(output++) = 0xC0 | (glyph >> 6);
+            *(output++) = 0x80 | (glyph & 0x3F);
+        }
+    }
+    *output = '\0';
+
+    return buffer;
+}
+
+/*
+ * Counts the glyphs of the given UTF-8 string if it only contains
+ * characters below U+0800, which can be decoded without iconv. Returns false
+ * for other strings (and invalid UTF-8).
+ *
+ */
+static bool count_utf8_glyphs_fast(const unsigned char *input, size_t input_size, size_t *num_glyphs) {
+    *num_glyphs = 0;
+    for (size_t c = 0; c < input_size; c++) {
+        if (input[c] >= 0x80) {
+            /* Two byte sequences start with 110xxxxx, 0xC0 and 0xC1 would be
+             * overlong encodings. */
+            if (input[c] < 0xC2 || input[c] > 0xDF ||
+                c + 1 >= input_size || (input[c + 1] & 0xC0) != 0x80)
+                return false;
+            c++;
+        }
+        (*num_glyphs)++;
+    }
+    return true;
+}
+
 /*
  * Converts the given string to UTF-8 from UCS-2 big endian. The return value
  * must be freed after use.
  *
  */
 char *convert_ucs2_to_utf8(xcb_char2b_t *text, size_t num_glyphs) {
+    char *fast = convert_ucs2_to_utf8_fast(text, num_glyphs);
+    if (fast != NULL)
+        return fast;
+
     /* Allocate the output buffer (UTF-8 is at most 4 bytes per glyph) */
     size_t buffer_size = num_glyphs * 4 * sizeof(char) + 1;
     char *buffer = scalloc(buffer_size);
@@ -64,6 +120,23 @@ xcb_char2b_t *convert_utf8_to_ucs2(char *input, size_t *real_strlen) {
     /* Calculate the input buffer size (UTF-8 is strlen-safe) */
     size_t input_size = strlen(input);
 
+    size_t num_glyphs;
+    if (count_utf8_glyphs_fast((unsigned char*)input, input_size, &num_glyphs)) {
+        /* Allocate at least one glyph, smalloc(0) might return NULL. */
+        xcb_char2b_t *buffer = smalloc((num_glyphs > 0 ? num_glyphs : 1) * sizeof(xcb_char2b_t));
+        const unsigned char *in = (unsigned char*)input;
+        for (size_t c = 0; c < num_glyphs; c++) {
+            uint16_t glyph = *(in++);
+            if (glyph >= 0x80)
+                glyph = ((glyph & 0x1F) << 6) | (*(in++) & 0x3F);
+            buffer[c].byte1 = glyph >> 8;
+            buffer[c].byte2 = glyph & 0xFF;
+        }
+        if (real_strlen != NULL)
+            *real_strlen = num_glyphs;
+        return buffer;
+    }
+
     /* Calculate the output buffer size and allocate the buffer */
     size_t buffer_size = input_size * sizeof(xcb_char2b_t);
     xcb_char2b_t *buffer = smalloc(buffer_size);
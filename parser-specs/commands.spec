@@ -21,6 +21,8 @@ state INITIAL:
   'reload' -> call cmd_reload()
   'shmlog' -> SHMLOG
   'debuglog' -> DEBUGLOG
+  'trace' -> TRACE
+  'tree_snapshot' -> TREE_SNAPSHOT
   'border' -> BORDER
   'layout' -> LAYOUT
   'append_layout' -> APPEND_LAYOUT
@@ -39,6 +41,7 @@ state INITIAL:
   'scratchpad' -> SCRATCHPAD
   'mode' -> MODE
   'bar' -> BAR
+  'batch' -> BATCH
 
 state CRITERIA:
   ctype = 'class' -> CRITERION
@@ -72,9 +75,33 @@ state SHMLOG:
     -> call cmd_shmlog($argument)
 
 # debuglog toggle|on|off
+# debuglog filter <categories>
 state DEBUGLOG:
   argument = 'toggle', 'on', 'off'
     -> call cmd_debuglog($argument)
+  'filter'
+    -> DEBUGLOG_FILTER
+
+state DEBUGLOG_FILTER:
+  categories = string
+    -> call cmd_debuglog_filter($categories)
+
+# trace toggle|on|off
+# trace dump <file>
+state TRACE:
+  argument = 'toggle', 'on', 'off'
+    -> call cmd_trace($argument)
+  'dump'
+    -> TRACE_DUMP
+
+state TRACE_DUMP:
+  filename = string
+    -> call cmd_trace_dump($filename)
+
+# tree_snapshot toggle|on|off
+state TREE_SNAPSHOT:
+  argument = 'toggle', 'on', 'off'
+    -> call cmd_tree_snapshot($argument)
 
 # border normal|none|1pixel|toggle|1pixel
 state BORDER:
@@ -132,6 +159,7 @@ state WORKSPACE_NUMBER:
 # focus output <output>
 # focus tiling|floating|mode_toggle
 # focus parent|child
+# focus back_and_forth
 # focus
 state FOCUS:
   direction = 'left', 'right', 'up', 'down'
@@ -142,6 +170,8 @@ state FOCUS:
       -> call cmd_focus_window_mode($window_mode)
   level = 'parent', 'child'
       -> call cmd_focus_level($level)
+  'back_and_forth'
+      -> call cmd_focus_back_and_forth()
   end
       -> call cmd_focus()
 
@@ -245,6 +275,7 @@ state RENAME_WORKSPACE_NEW_NAME:
       -> call cmd_rename_workspace($old_name, $new_name)
 
 # move <direction> [<pixels> [px]]
+# move <direction> <steps> steps
 # move [window|container] [to] workspace [<str>|next|prev|next_on_output|prev_on_output|current]
 # move [window|container] [to] output <str>
 # move [window|container] [to] scratchpad
@@ -280,6 +311,8 @@ state MOVE_DIRECTION:
 state MOVE_DIRECTION_PX:
   'px'
       -> call cmd_move_direction($direction, $pixels)
+  'steps'
+      -> call cmd_move_direction_steps($direction, $pixels)
   end
       -> call cmd_move_direction($direction, $pixels)
 
@@ -338,6 +371,11 @@ state NOP:
   comment = string
       -> call cmd_nop($comment)
 
+# batch begin|commit
+state BATCH:
+  action = 'begin', 'commit'
+      -> call cmd_batch($action)
+
 state SCRATCHPAD:
   'show'
       -> call cmd_scratchpad_show()
@@ -21,6 +21,8 @@ state INITIAL:
   bindtype = 'bindsym', 'bindcode', 'bind' -> BINDING
   'bar'                                    -> BARBRACE
   'font'                                   -> FONT
+  'glyph_cache'                            -> GLYPH_CACHE
+  'shared_i3bar'                           -> SHARED_BAR_PROCESS
   'mode'                                   -> MODENAME
   'floating_minimum_size'                  -> FLOATING_MINIMUM_SIZE_WIDTH
   'floating_maximum_size'                  -> FLOATING_MAXIMUM_SIZE_WIDTH
@@ -37,10 +39,16 @@ state INITIAL:
   'workspace_auto_back_and_forth'          -> WORKSPACE_BACK_AND_FORTH
   'fake_outputs', 'fake-outputs'           -> FAKE_OUTPUTS
   'force_display_urgency_hint'             -> FORCE_DISPLAY_URGENCY_HINT
+  'screen_change_delay'                    -> SCREEN_CHANGE_DELAY
+  'config_cache'                           -> CONFIG_CACHE
   'workspace'                              -> WORKSPACE
   'ipc_socket', 'ipc-socket'               -> IPC_SOCKET
+  'ipc_buffer_limit'                       -> IPC_BUFFER_LIMIT
+  'ipc_thread'                             -> IPC_THREAD
   'restart_state'                          -> RESTART_STATE
   'popup_during_fullscreen'                -> POPUP_DURING_FULLSCREEN
+  'tiling_resize'                          -> TILING_RESIZE
+  'floating_move'                          -> FLOATING_MOVE
   exectype = 'exec_always', 'exec'         -> EXEC
   colorclass = 'client.background'
       -> COLOR_SINGLE
@@ -188,6 +196,11 @@ state WORKSPACE_BACK_AND_FORTH:
       -> call cfg_workspace_back_and_forth($value)
 
 
+# config_cache <yes|no>
+state CONFIG_CACHE:
+  value = word
+      -> call cfg_config_cache($value)
+
 # fake_outputs (for testcases)
 state FAKE_OUTPUTS:
   outputs = string
@@ -204,6 +217,17 @@ state FORCE_DISPLAY_URGENCY_HINT_MS:
   end
       -> call cfg_force_display_urgency_hint(&duration_ms)
 
+# screen_change_delay <delay> ms
+state SCREEN_CHANGE_DELAY:
+  delay_ms = number
+      -> SCREEN_CHANGE_DELAY_MS
+
+state SCREEN_CHANGE_DELAY_MS:
+  'ms'
+      ->
+  end
+      -> call cfg_screen_change_delay(&delay_ms)
+
 # workspace <workspace> output <output>
 state WORKSPACE:
   workspace = word
@@ -222,6 +246,22 @@ state IPC_SOCKET:
   path = string
       -> call cfg_ipc_socket($path)
 
+# ipc_buffer_limit <size> kb
+state IPC_BUFFER_LIMIT:
+  size_kb = number
+      -> IPC_BUFFER_LIMIT_KB
+
+state IPC_BUFFER_LIMIT_KB:
+  'kb'
+      ->
+  end
+      -> call cfg_ipc_buffer_limit(&size_kb)
+
+# ipc_thread <yes|no>
+state IPC_THREAD:
+  value = word
+      -> call cfg_ipc_thread($value)
+
 # restart_state <path> (for testcases)
 state RESTART_STATE:
   path = string
@@ -232,6 +272,16 @@ state POPUP_DURING_FULLSCREEN:
   value = 'ignore', 'leave_fullscreen', 'smart'
       -> call cfg_popup_during_fullscreen($value)
 
+# tiling_resize
+state TILING_RESIZE:
+  value = 'outline', 'live'
+      -> call cfg_tiling_resize($value)
+
+# floating_move
+state FLOATING_MOVE:
+  value = 'opaque', 'outline'
+      -> call cfg_floating_move($value)
+
 # client.background <hexcolor>
 state COLOR_SINGLE:
   color = word
@@ -268,6 +318,16 @@ state FONT:
   font = string
       -> call cfg_font($font)
 
+# glyph_cache <yes|no>
+state GLYPH_CACHE:
+  value = word
+      -> call cfg_glyph_cache($value)
+
+# shared_i3bar <yes|no>
+state SHARED_BAR_PROCESS:
+  value = word
+      -> call cfg_shared_i3bar($value)
+
 # bindsym/bindcode
 state BINDING:
   release = '--release'
@@ -359,6 +419,9 @@ state BAR:
   'binding_mode_indicator' -> BAR_BINDING_MODE_INDICATOR
   'workspace_buttons'      -> BAR_WORKSPACE_BUTTONS
   'verbose'                -> BAR_VERBOSE
+  'status_refresh_rate'    -> BAR_STATUS_REFRESH_RATE
+  'client_side_rendering'  -> BAR_CLIENT_SIDE_RENDERING
+  'glyph_cache'            -> BAR_GLYPH_CACHE
   'colors'                 -> BAR_COLORS_BRACE
   '}'
       -> call cfg_bar_finish(); INITIAL
@@ -424,6 +487,18 @@ state BAR_VERBOSE:
   value = word
       -> call cfg_bar_verbose($value); BAR
 
+state BAR_STATUS_REFRESH_RATE:
+  rate = number
+      -> call cfg_bar_status_refresh_rate(&rate); BAR
+
+state BAR_CLIENT_SIDE_RENDERING:
+  value = word
+      -> call cfg_bar_client_side_rendering($value); BAR
+
+state BAR_GLYPH_CACHE:
+  value = word
+      -> call cfg_bar_glyph_cache($value); BAR
+
 state BAR_COLORS_BRACE:
   end
       ->
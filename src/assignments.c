@@ -11,6 +11,124 @@
  */
 #include "all.h"
 
+/* To avoid running every assignment’s regular expressions for every new
+ * window, assignments whose class (or, if the class is not a literal,
+ * instance) criterion is an exact literal like ^Firefox$ are put into a hash
+ * table by that literal. Only the assignments in the window’s bucket and the
+ * ones which could not be indexed are checked using match_matches_window(). */
+#define ASSIGNMENT_BUCKETS 64
+
+struct indexed_assignment {
+    Assignment *assignment;
+    /* Position in the assignments list, to keep the configured order. */
+    int position;
+    /* The literal class/instance, NULL for unindexed assignments. */
+    char *literal;
+};
+
+struct assignment_list {
+    struct indexed_assignment *entries;
+    int num;
+};
+
+static struct assignment_list class_buckets[ASSIGNMENT_BUCKETS];
+static struct assignment_list instance_buckets[ASSIGNMENT_BUCKETS];
+static struct assignment_list unindexed;
+
+static unsigned int literal_hash(const char *str) {
+    unsigned int hash = 5381;
+    for (; *str != '\0'; str++)
+        hash = ((hash << 5) + hash) + (unsigned char)*str;
+    return hash % ASSIGNMENT_BUCKETS;
+}
+
+static void assignment_list_add(struct assignment_list *list, Assignment *assignment, int position, char *literal) {
+    list->entries = srealloc(list->entries, (list->num + 1) * sizeof(struct indexed_assignment));
+    list->entries[list->num].assignment = assignment;
+    list->entries[list->num].position = position;
+    list->entries[list->num].literal = literal;
+    list->num++;
+}
+
+static void assignment_list_clear(struct assignment_list *list) {
+    for (int i = 0; i < list->num; i++)
+        free(list->entries[i].literal);
+    FREE(list->entries);
+    list->num = 0;
+}
+
+/*
+ * Rebuilds the index which is used to find the assignments which could match
+ * a window. Needs to be called whenever the list of assignments changed.
+ *
+ */
+void assignments_rebuild_index(void) {
+    for (int i = 0; i < ASSIGNMENT_BUCKETS; i++) {
+        assignment_list_clear(&class_buckets[i]);
+        assignment_list_clear(&instance_buckets[i]);
+    }
+    assignment_list_clear(&unindexed);
+
+    int position = 0;
+    Assignment *current;
+    TAILQ_FOREACH(current, &assignments, assignments) {
+        char *literal;
+        if ((literal = regex_exact_literal(current->match.class)) != NULL)
+            assignment_list_add(&class_buckets[literal_hash(literal)], current, position, literal);
+        else if ((literal = regex_exact_literal(current->match.instance)) != NULL)
+            assignment_list_add(&instance_buckets[literal_hash(literal)], current, position, literal);
+        else assignment_list_add(&unindexed, current, position, NULL);
+        position++;
+    }
+    DLOG("Indexed %d assignments, %d of them need to be checked for every window\n",
+         position, unindexed.num);
+}
+
+static int indexed_assignment_cmp(const void *a, const void *b) {
+    return ((const struct indexed_assignment*)a)->position -
+           ((const struct indexed_assignment*)b)->position;
+}
+
+static void add_candidates(struct indexed_assignment *candidates, int *num,
+                           struct assignment_list *list, const char *literal) {
+    for (int i = 0; i < list->num; i++) {
+        if (list->entries[i].literal != NULL &&
+            (literal == NULL || strcmp(list->entries[i].literal, literal) != 0))
+            continue;
+        candidates[(*num)++] = list->entries[i];
+    }
+}
+
+/*
+ * Returns the assignments which could match the given window, in the order
+ * in which they were configured. The caller needs to free() the array and
+ * still has to check the assignments using match_matches_window().
+ *
+ */
+static struct indexed_assignment *assignment_candidates(i3Window *window, int *num) {
+    struct assignment_list *class_bucket = NULL, *instance_bucket = NULL;
+    int max = unindexed.num;
+    if (window->class_class != NULL) {
+        class_bucket = &class_buckets[literal_hash(window->class_class)];
+        max += class_bucket->num;
+    }
+    if (window->class_instance != NULL) {
+        instance_bucket = &instance_buckets[literal_hash(window->class_instance)];
+        max += instance_bucket->num;
+    }
+
+    struct indexed_assignment *candidates = smalloc((max + 1) * sizeof(struct indexed_assignment));
+    *num = 0;
+    if (class_bucket != NULL)
+        add_candidates(candidates, num, class_bucket, window->class_class);
+    if (instance_bucket != NULL)
+        add_candidates(candidates, num, instance_bucket, window->class_instance);
+    add_candidates(candidates, num, &unindexed, NULL);
+
+    qsort(candidates, *num, sizeof(struct indexed_assignment), indexed_assignment_cmp);
+    return candidates;
+}
+
 /*
  * Checks the list of assignments for the given window and runs all matching
  * ones (unless they have already been run for this specific window).
@@ -22,8 +140,10 @@ void run_assignments(i3Window *window) {
     bool needs_tree_render = false;
 
     /* Check if any assignments match */
-    Assignment *current;
-    TAILQ_FOREACH(current, &assignments, assignments) {
+    int num_candidates;
+    struct indexed_assignment *candidates = assignment_candidates(window, &num_candidates);
+    for (int i = 0; i < num_candidates; i++) {
+        Assignment *current = candidates[i].assignment;
         if (!match_matches_window(&(current->match), window))
             continue;
 
@@ -45,13 +165,11 @@ void run_assignments(i3Window *window) {
             DLOG("execute command %s\n", current->dest.command);
             char *full_command;
             sasprintf(&full_command, "[id=\"%d\"] %s", window->id, current->dest.command);
-            struct CommandResult *command_output = parse_command(full_command);
+            struct CommandResult *command_output = parse_command(full_command, NULL);
             free(full_command);
 
             if (command_output->needs_tree_render)
                 needs_tree_render = true;
-
-            yajl_gen_free(command_output->json_gen);
         }
 
         /* Store that we ran this assignment to not execute it again */
@@ -59,6 +177,7 @@ void run_assignments(i3Window *window) {
         window->ran_assignments = srealloc(window->ran_assignments, sizeof(Assignment*) * window->nr_assignments);
         window->ran_assignments[window->nr_assignments-1] = current;
     }
+    free(candidates);
 
     /* If any of the commands required re-rendering, we will do that now. */
     if (needs_tree_render)
@@ -70,15 +189,20 @@ void run_assignments(i3Window *window) {
  *
  */
 Assignment *assignment_for(i3Window *window, int type) {
-    Assignment *assignment;
+    Assignment *result = NULL;
 
-    TAILQ_FOREACH(assignment, &assignments, assignments) {
+    int num_candidates;
+    struct indexed_assignment *candidates = assignment_candidates(window, &num_candidates);
+    for (int i = 0; i < num_candidates; i++) {
+        Assignment *assignment = candidates[i].assignment;
         if ((type != A_ANY && (assignment->type & type) == 0) ||
             !match_matches_window(&(assignment->match), window))
             continue;
         DLOG("got a matching assignment (to %s)\n", assignment->dest.workspace);
-        return assignment;
+        result = assignment;
+        break;
     }
+    free(candidates);
 
-    return NULL;
+    return result;
 }
@@ -16,15 +16,19 @@
 #include "shmlog.h"
 
 // Macros to make the YAJL API a bit easier to use.
-#define y(x, ...) yajl_gen_ ## x (cmd_output->json_gen, ##__VA_ARGS__)
-#define ystr(str) yajl_gen_string(cmd_output->json_gen, (unsigned char*)str, strlen(str))
+/* json_gen is NULL for internal callers which don’t need a JSON reply. */
+#define y(x, ...) (cmd_output->json_gen != NULL ? yajl_gen_ ## x (cmd_output->json_gen, ##__VA_ARGS__) : 0)
+#define ystr(str) (cmd_output->json_gen != NULL ? yajl_gen_string(cmd_output->json_gen, (unsigned char*)str, strlen(str)) : 0)
 #define ysuccess(success) do { \
+    if (!(success)) \
+        cmd_output->failed = true; \
     y(map_open); \
     ystr("success"); \
     y(bool, success); \
     y(map_close); \
 } while (0)
 #define yerror(message) do { \
+    cmd_output->failed = true; \
     y(map_open); \
     ystr("success"); \
     y(bool, false); \
@@ -247,13 +251,25 @@ typedef TAILQ_HEAD(owindows_head, owindow) owindows_head;
 
 static owindows_head owindows;
 
+/*
+ * Adds the given container to the list of owindows.
+ *
+ */
+static void owindows_add(Con *con) {
+    owindow *ow = smalloc(sizeof(owindow));
+    ow->con = con;
+    TAILQ_INSERT_TAIL(&owindows, ow, owindows);
+}
+
 /*
  * Initializes the specified 'Match' data structure and the initial state of
  * commands.c for matching target windows of a command.
  *
+ * The list of owindows is only filled in cmd_criteria_match_windows(), since
+ * commands without criteria never look at it.
+ *
  */
 void cmd_criteria_init(I3_CMD) {
-    Con *con;
     owindow *ow;
 
     DLOG("Initializing criteria, current_match = %p\n", current_match);
@@ -264,53 +280,65 @@ void cmd_criteria_init(I3_CMD) {
         free(ow);
     }
     TAILQ_INIT(&owindows);
-    /* copy all_cons */
-    TAILQ_FOREACH(con, &all_cons, all_cons) {
-        ow = smalloc(sizeof(owindow));
-        ow->con = con;
-        TAILQ_INSERT_TAIL(&owindows, ow, owindows);
-    }
 }
 
 /*
  * A match specification just finished (the closing square bracket was found),
- * so we filter the list of owindows.
+ * so we fill the list of owindows with all matching containers.
+ *
+ * Criteria which identify containers directly (con_id, con_mark and id) are
+ * looked up using the marked_cons list and the window index instead of
+ * checking every container.
  *
  */
 void cmd_criteria_match_windows(I3_CMD) {
-    owindow *next, *current;
+    owindow *current;
+    Con *con;
 
     DLOG("match specification finished, matching...\n");
-    /* copy the old list head to iterate through it and start with a fresh
-     * list which will contain only matching windows */
-    struct owindows_head old = owindows;
-    TAILQ_INIT(&owindows);
-    for (next = TAILQ_FIRST(&old); next != TAILQ_END(&old);) {
-        /* make a copy of the next pointer and advance the pointer to the
-         * next element as we are going to invalidate the element’s
-         * next/prev pointers by calling TAILQ_INSERT_TAIL later */
-        current = next;
-        next = TAILQ_NEXT(next, owindows);
-
-        DLOG("checking if con %p / %s matches\n", current->con, current->con->name);
-        if (current_match->con_id != NULL) {
-            if (current_match->con_id == current->con) {
+    if (current_match->con_id != NULL) {
+        /* con_id is user input, so it is only used after verifying that it
+         * refers to an existing container. */
+        TAILQ_FOREACH(con, &all_cons, all_cons) {
+            if (con == current_match->con_id) {
                 DLOG("matches container!\n");
-                TAILQ_INSERT_TAIL(&owindows, current, owindows);
+                owindows_add(con);
+                break;
             }
-        } else if (current_match->mark != NULL && current->con->mark != NULL &&
-                   regex_matches(current_match->mark, current->con->mark)) {
-            DLOG("match by mark\n");
-            TAILQ_INSERT_TAIL(&owindows, current, owindows);
+        }
+    } else if (current_match->mark != NULL) {
+        /* match_matches_window() never matches when a mark was specified, so
+         * only marked containers are candidates. Marks are unique, so an
+         * exact mark like ^foo$ is a single lookup. */
+        char *literal = regex_exact_literal(current_match->mark);
+        if (literal != NULL) {
+            if ((con = con_by_mark(literal)) != NULL) {
+                DLOG("match by mark\n");
+                owindows_add(con);
+            }
+            free(literal);
         } else {
-            if (current->con->window == NULL)
+            TAILQ_FOREACH(con, &marked_cons, marked_cons) {
+                if (regex_matches(current_match->mark, con->mark)) {
+                    DLOG("match by mark\n");
+                    owindows_add(con);
+                }
+            }
+        }
+    } else if (current_match->id != XCB_NONE) {
+        con = con_by_window_id(current_match->id);
+        if (con != NULL && match_matches_window(current_match, con->window)) {
+            DLOG("matches window!\n");
+            owindows_add(con);
+        }
+    } else {
+        TAILQ_FOREACH(con, &all_cons, all_cons) {
+            if (con->window == NULL)
                 continue;
-            if (match_matches_window(current_match, current->con->window)) {
+            DLOG("checking if con %p / %s matches\n", con, con->name);
+            if (match_matches_window(current_match, con->window)) {
                 DLOG("matches window!\n");
-                TAILQ_INSERT_TAIL(&owindows, current, owindows);
-            } else {
-                DLOG("doesnt match\n");
-                free(current);
+                owindows_add(con);
             }
         }
     }
@@ -399,14 +427,33 @@ void cmd_criteria_add(I3_CMD, char *ctype, char *cvalue) {
     ELOG("Unknown criterion: %s\n", ctype);
 }
 
+/*
+ * Moves all matched containers to the given workspace at once.
+ *
+ */
+static void move_matches_to_workspace(Con *ws) {
+    owindow *current;
+    int num = 0;
+    TAILQ_FOREACH(current, &owindows, owindows)
+        num++;
+
+    Con **cons = smalloc(num * sizeof(Con*));
+    int i = 0;
+    TAILQ_FOREACH(current, &owindows, owindows) {
+        DLOG("matching: %p / %s\n", current->con, current->con->name);
+        cons[i++] = current->con;
+    }
+
+    con_move_many_to_workspace(cons, num, ws);
+    free(cons);
+}
+
 /*
  * Implementation of 'move [window|container] [to] workspace
  * next|prev|next_on_output|prev_on_output|current'.
  *
  */
 void cmd_move_con_to_workspace(I3_CMD, char *which) {
-    owindow *current;
-
     DLOG("which=%s\n", which);
 
     /* We have nothing to move:
@@ -439,10 +486,7 @@ void cmd_move_con_to_workspace(I3_CMD, char *which) {
         return;
     }
 
-    TAILQ_FOREACH(current, &owindows, owindows) {
-        DLOG("matching: %p / %s\n", current->con, current->con->name);
-        con_move_to_workspace(current->con, ws, true, false);
-    }
+    move_matches_to_workspace(ws);
 
     cmd_output->needs_tree_render = true;
     // XXX: default reply for now, make this a better reply
@@ -454,7 +498,6 @@ void cmd_move_con_to_workspace(I3_CMD, char *which) {
  *
  */
 void cmd_move_con_to_workspace_back_and_forth(I3_CMD) {
-    owindow *current;
     Con *ws;
 
     ws = workspace_back_and_forth_get();
@@ -466,10 +509,7 @@ void cmd_move_con_to_workspace_back_and_forth(I3_CMD) {
 
     HANDLE_EMPTY_MATCH;
 
-    TAILQ_FOREACH(current, &owindows, owindows) {
-        DLOG("matching: %p / %s\n", current->con, current->con->name);
-        con_move_to_workspace(current->con, ws, true, false);
-    }
+    move_matches_to_workspace(ws);
 
     cmd_output->needs_tree_render = true;
     // XXX: default reply for now, make this a better reply
@@ -487,8 +527,6 @@ void cmd_move_con_to_workspace_name(I3_CMD, char *name) {
         return;
     }
 
-    owindow *current;
-
     /* We have nothing to move:
      *  when criteria was specified but didn't match any window or
      *  when criteria wasn't specified and we don't have any window focused. */
@@ -511,10 +549,7 @@ void cmd_move_con_to_workspace_name(I3_CMD, char *name) {
 
     HANDLE_EMPTY_MATCH;
 
-    TAILQ_FOREACH(current, &owindows, owindows) {
-        DLOG("matching: %p / %s\n", current->con, current->con->name);
-        con_move_to_workspace(current->con, ws, true, false);
-    }
+    move_matches_to_workspace(ws);
 
     cmd_output->needs_tree_render = true;
     // XXX: default reply for now, make this a better reply
@@ -526,8 +561,6 @@ void cmd_move_con_to_workspace_name(I3_CMD, char *name) {
  *
  */
 void cmd_move_con_to_workspace_number(I3_CMD, char *which) {
-    owindow *current;
-
     /* We have nothing to move:
      *  when criteria was specified but didn't match any window or
      *  when criteria wasn't specified and we don't have any window focused. */
@@ -566,10 +599,7 @@ void cmd_move_con_to_workspace_number(I3_CMD, char *which) {
 
     HANDLE_EMPTY_MATCH;
 
-    TAILQ_FOREACH(current, &owindows, owindows) {
-        DLOG("matching: %p / %s\n", current->con, current->con->name);
-        con_move_to_workspace(current->con, workspace, true, false);
-    }
+    move_matches_to_workspace(workspace);
 
     cmd_output->needs_tree_render = true;
     // XXX: default reply for now, make this a better reply
@@ -669,6 +699,7 @@ static bool cmd_resize_tiling_direction(I3_CMD, Con *current, char *way, char *d
         definitelyGreaterThan(new_second_percent, 0.05, DBL_EPSILON)) {
         first->percent += ((double)ppt / 100.0);
         second->percent -= ((double)ppt / 100.0);
+        con_mark_dirty(first->parent);
         LOG("first->percent after = %f\n", first->percent);
         LOG("second->percent after = %f\n", second->percent);
     } else {
@@ -756,6 +787,7 @@ static bool cmd_resize_tiling_width_height(I3_CMD, Con *current, char *way, char
         child->percent -= subtract_percent;
         LOG("child->percent after (%p) = %f\n", child, child->percent);
     }
+    con_mark_dirty(current->parent);
 
     return true;
 }
@@ -862,6 +894,19 @@ void cmd_nop(I3_CMD, char *comment) {
     LOG("-------------------------------------------------\n");
 }
 
+/*
+ * Implementation of 'batch begin|commit'. Batches are tracked per IPC
+ * connection (see handle_command() in ipc.c), so this only records the
+ * request in the result.
+ *
+ */
+void cmd_batch(I3_CMD, char *action) {
+    DLOG("batch %s\n", action);
+    cmd_output->batch += (strcmp(action, "begin") == 0 ? 1 : -1);
+
+    ysuccess(true);
+}
+
 /*
  * Implementation of 'append_layout <path>'.
  *
@@ -986,9 +1031,9 @@ void cmd_mark(I3_CMD, char *mark) {
     DLOG("Clearing all windows which have that mark first\n");
 
     Con *con;
-    TAILQ_FOREACH(con, &all_cons, all_cons) {
-        if (con->mark && strcmp(con->mark, mark) == 0)
-            FREE(con->mark);
+    while ((con = con_by_mark(mark)) != NULL) {
+        con_set_mark(con, NULL);
+        con_mark_changed(con);
     }
 
     DLOG("marking window with str %s\n", mark);
@@ -998,7 +1043,8 @@ void cmd_mark(I3_CMD, char *mark) {
 
     TAILQ_FOREACH(current, &owindows, owindows) {
         DLOG("matching: %p / %s\n", current->con, current->con->name);
-        current->con->mark = sstrdup(mark);
+        con_set_mark(current->con, mark);
+        con_mark_changed(current->con);
     }
 
     cmd_output->needs_tree_render = true;
@@ -1011,20 +1057,20 @@ void cmd_mark(I3_CMD, char *mark) {
  *
  */
 void cmd_unmark(I3_CMD, char *mark) {
+   Con *con;
    if (mark == NULL) {
-       Con *con;
-       TAILQ_FOREACH(con, &all_cons, all_cons) {
-           FREE(con->mark);
+       while ((con = TAILQ_FIRST(&marked_cons)) != NULL) {
+           con_set_mark(con, NULL);
+           con_mark_changed(con);
        }
        DLOG("removed all window marks");
    } else {
-       Con *con;
-       TAILQ_FOREACH(con, &all_cons, all_cons) {
-           if (con->mark && strcmp(con->mark, mark) == 0)
-               FREE(con->mark);
+       while ((con = con_by_mark(mark)) != NULL) {
+           con_set_mark(con, NULL);
+           con_mark_changed(con);
        }
        DLOG("removed window mark %s\n", mark);
-    }
+   }
 
     cmd_output->needs_tree_render = true;
     // XXX: default reply for now, make this a better reply
@@ -1090,10 +1136,7 @@ void cmd_move_con_to_output(I3_CMD, char *name) {
         return;
     }
 
-    TAILQ_FOREACH(current, &owindows, owindows) {
-        DLOG("matching: %p / %s\n", current->con, current->con->name);
-        con_move_to_workspace(current->con, ws, true, false);
-    }
+    move_matches_to_workspace(ws);
 
     cmd_output->needs_tree_render = true;
     // XXX: default reply for now, make this a better reply
@@ -1176,11 +1219,7 @@ void cmd_move_workspace_to_output(I3_CMD, char *name) {
                     continue;
 
                 /* check if this workspace is already attached to the tree */
-                Con *workspace = NULL, *out;
-                TAILQ_FOREACH(out, &(croot->nodes_head), nodes)
-                    GREP_FIRST(workspace, output_get_content(out),
-                               !strcasecmp(child->name, assignment->name));
-                if (workspace != NULL)
+                if (get_existing_workspace_by_name(assignment->name) != NULL)
                     continue;
 
                 /* so create the workspace referenced to by this assignment */
@@ -1402,6 +1441,59 @@ void cmd_focus_level(I3_CMD, char *level) {
     ysuccess(success);
 }
 
+/*
+ * Focuses the given container and switches to its workspace ws.
+ *
+ */
+static void focus_on_workspace(Con *con, Con *ws) {
+    /* If the container is not on the current workspace,
+     * workspace_show() will switch to a different workspace and (if
+     * enabled) trigger a mouse pointer warp to the currently focused
+     * container (!) on the target workspace.
+     *
+     * Therefore, before calling workspace_show(), we make sure that
+     * 'con' will be focused on the workspace. However, we cannot
+     * just con_focus(con) because then the pointer will not be
+     * warped at all (the code thinks we are already there).
+     *
+     * So we focus 'con' to make it the currently focused window of
+     * the target workspace, then revert focus. */
+    Con *currently_focused = focused;
+    con_focus(con);
+    con_focus(currently_focused);
+
+    /* Now switch to the workspace, then focus */
+    workspace_show(ws);
+    LOG("focusing %p / %s\n", con, con->name);
+    con_focus(con);
+}
+
+/*
+ * Implementation of 'focus back_and_forth'.
+ *
+ */
+void cmd_focus_back_and_forth(I3_CMD) {
+    Con *con = con_focus_history_previous();
+    Con *ws = (con != NULL ? con_get_workspace(con) : NULL);
+    if (ws == NULL) {
+        yerror("No window was previously focused.");
+        return;
+    }
+
+    if (!con_fullscreen_permits_focusing(con)) {
+        LOG("Cannot change focus while in fullscreen mode (fullscreen rules).\n");
+        ysuccess(false);
+        return;
+    }
+
+    if (ws == workspace_get("__i3_scratch", NULL))
+        scratchpad_show(con);
+    else focus_on_workspace(con, ws);
+
+    cmd_output->needs_tree_render = true;
+    ysuccess(true);
+}
+
 /*
  * Implementation of 'focus'.
  *
@@ -1445,26 +1537,7 @@ void cmd_focus(I3_CMD) {
             break;
         }
 
-        /* If the container is not on the current workspace,
-         * workspace_show() will switch to a different workspace and (if
-         * enabled) trigger a mouse pointer warp to the currently focused
-         * container (!) on the target workspace.
-         *
-         * Therefore, before calling workspace_show(), we make sure that
-         * 'current' will be focused on the workspace. However, we cannot
-         * just con_focus(current) because then the pointer will not be
-         * warped at all (the code thinks we are already there).
-         *
-         * So we focus 'current' to make it the currently focused window of
-         * the target workspace, then revert focus. */
-        Con *currently_focused = focused;
-        con_focus(current->con);
-        con_focus(currently_focused);
-
-        /* Now switch to the workspace, then focus */
-        workspace_show(ws);
-        LOG("focusing %p / %s\n", current->con, current->con->name);
-        con_focus(current->con);
+        focus_on_workspace(current->con, ws);
         count++;
     }
 
@@ -1534,6 +1607,45 @@ void cmd_move_direction(I3_CMD, char *direction, char *move_px) {
     ysuccess(true);
 }
 
+/*
+ * Implementation of 'move <direction> <steps> steps'.
+ *
+ */
+void cmd_move_direction_steps(I3_CMD, char *direction, char *steps_str) {
+    char *end;
+    long steps = strtol(steps_str, &end, 10);
+    if (*end != '\0' || steps < 1 || steps > INT_MAX) {
+        ELOG("Invalid number of steps: \"%s\"\n", steps_str);
+        yerror("Invalid number of steps");
+        return;
+    }
+
+    /* Floating containers move by pixels, as far as the given number of
+     * 'move <direction>' commands would move them. */
+    if (con_is_floating(focused)) {
+        char *move_px;
+        sasprintf(&move_px, "%ld", (steps > INT_MAX / 10 ? INT_MAX / 10 : steps) * 10);
+        cmd_move_direction(current_match, cmd_output, direction, move_px);
+        free(move_px);
+        return;
+    }
+
+    /* tree_move_steps() does not move workspaces. */
+    if (focused->type == CT_WORKSPACE) {
+        yerror("Cannot move a workspace in a direction.");
+        return;
+    }
+
+    DLOG("moving %ld steps in direction %s\n", steps, direction);
+    tree_move_steps((strcmp(direction, "right") == 0 ? D_RIGHT :
+                     (strcmp(direction, "left") == 0 ? D_LEFT :
+                      (strcmp(direction, "up") == 0 ? D_UP :
+                       D_DOWN))), steps);
+    cmd_output->needs_tree_render = true;
+
+    ysuccess(true);
+}
+
 /*
  * Implementation of 'layout default|stacked|stacking|tabbed|splitv|splith'.
  *
@@ -1609,6 +1721,7 @@ void cmd_layout_toggle(I3_CMD, char *toggle_mode) {
  */
 void cmd_exit(I3_CMD) {
     LOG("Exiting due to user command.\n");
+    ipc_send_event("shutdown", I3_IPC_EVENT_SHUTDOWN, "{\"change\":\"exit\"}");
     xcb_disconnect(conn);
     exit(0);
 
@@ -1627,8 +1740,8 @@ void cmd_reload(I3_CMD) {
     x_set_i3_atoms();
     /* Send an IPC event just in case the ws names have changed */
     ipc_send_event("workspace", I3_IPC_EVENT_WORKSPACE, "{\"change\":\"reload\"}");
-    /* Send an update event for the barconfig just in case it has changed */
-    update_barconfig();
+    /* load_configuration() sent barconfig_update events for the bars which
+     * changed. */
 
     // XXX: default reply for now, make this a better reply
     ysuccess(true);
@@ -1654,6 +1767,7 @@ void cmd_open(I3_CMD) {
     LOG("opening new container\n");
     Con *con = tree_open_con(NULL, NULL);
     con->layout = L_SPLITH;
+    con_mark_dirty(con);
     con_focus(con);
 
     y(map_open);
@@ -1837,11 +1951,9 @@ void cmd_rename_workspace(I3_CMD, char *old_name, char *new_name) {
         LOG("Renaming current workspace to \"%s\"\n", new_name);
     }
 
-    Con *output, *workspace = NULL;
+    Con *workspace = NULL;
     if (old_name) {
-        TAILQ_FOREACH(output, &(croot->nodes_head), nodes)
-            GREP_FIRST(workspace, output_get_content(output),
-                !strcasecmp(child->name, old_name));
+        workspace = get_existing_workspace_by_name(old_name);
     } else {
         workspace = con_get_workspace(focused);
     }
@@ -1854,10 +1966,7 @@ void cmd_rename_workspace(I3_CMD, char *old_name, char *new_name) {
         return;
     }
 
-    Con *check_dest = NULL;
-    TAILQ_FOREACH(output, &(croot->nodes_head), nodes)
-        GREP_FIRST(check_dest, output_get_content(output),
-            !strcasecmp(child->name, new_name));
+    Con *check_dest = get_existing_workspace_by_name(new_name);
 
     if (check_dest != NULL) {
         // TODO: we should include the new workspace name here and use yajl for
@@ -1870,6 +1979,7 @@ void cmd_rename_workspace(I3_CMD, char *old_name, char *new_name) {
     /* Change the name and try to parse it as a number. */
     FREE(workspace->name);
     workspace->name = sstrdup(new_name);
+    con_mark_changed(workspace);
     char *endptr = NULL;
     long parsed_num = strtol(new_name, &endptr, 10);
     if (parsed_num == LONG_MIN ||
@@ -2017,12 +2127,8 @@ void cmd_shmlog(I3_CMD, char *argument) {
     else if (!strcmp(argument, "off"))
         shmlog_size = 0;
     else {
-        /* If shm logging now, restart logging with the new size. */
-        if (shmlog_size > 0) {
-            shmlog_size = 0;
-            LOG("Restarting shm logging...\n");
-            init_logging();
-        }
+        /* If shm logging is enabled, init_logging() resizes the log and keeps
+         * the messages which fit into the new size. */
         shmlog_size = atoi(argument);
         /* Make a weakly attempt at ensuring the argument is valid. */
         if (shmlog_size <= 0)
@@ -2054,3 +2160,67 @@ void cmd_debuglog(I3_CMD, char *argument) {
     // XXX: default reply for now, make this a better reply
     ysuccess(true);
 }
+
+/*
+ * Implementation of 'debuglog filter <categories>'
+ *
+ */
+void cmd_debuglog_filter(I3_CMD, char *categories) {
+    LOG("Restricting debug logging to \"%s\"\n", categories);
+    set_debuglog_filter(categories);
+    ysuccess(true);
+}
+
+/*
+ * Implementation of 'trace toggle|on|off'
+ *
+ */
+void cmd_trace(I3_CMD, char *argument) {
+    bool enable = tracing;
+    if (!strcmp(argument, "toggle"))
+        enable = !tracing;
+    else if (!strcmp(argument, "on"))
+        enable = true;
+    else if (!strcmp(argument, "off"))
+        enable = false;
+
+    if (enable != tracing) {
+        LOG("%s tracing\n", enable ? "Enabling" : "Disabling");
+        set_tracing(enable);
+    }
+    ysuccess(true);
+}
+
+/*
+ * Implementation of 'trace dump <file>'
+ *
+ */
+void cmd_trace_dump(I3_CMD, char *filename) {
+    char *path = resolve_tilde(filename);
+    if (trace_dump(path))
+        ysuccess(true);
+    else yerror("Could not write the trace file");
+    free(path);
+}
+
+/*
+ * Implementation of 'tree_snapshot toggle|on|off'
+ *
+ */
+void cmd_tree_snapshot(I3_CMD, char *argument) {
+    const bool enabled = (*shmtreename != '\0');
+    bool enable = enabled;
+    if (!strcmp(argument, "toggle"))
+        enable = !enabled;
+    else if (!strcmp(argument, "on"))
+        enable = true;
+    else if (!strcmp(argument, "off"))
+        enable = false;
+
+    if (enable != enabled) {
+        LOG("%s the tree snapshot\n", enable ? "Enabling" : "Disabling");
+        tree_snapshot_set_enabled(enable);
+        update_shmtree_atom();
+    }
+    ysuccess(enable == (*shmtreename != '\0'));
+}
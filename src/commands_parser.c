@@ -31,12 +31,14 @@
 #include <unistd.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <ctype.h>
 
 #include "all.h"
 
-// Macros to make the YAJL API a bit easier to use.
-#define y(x, ...) yajl_gen_ ## x (command_output.json_gen, ##__VA_ARGS__)
-#define ystr(str) yajl_gen_string(command_output.json_gen, (unsigned char*)str, strlen(str))
+// Macros to make the YAJL API a bit easier to use. Internal callers don’t
+// need a JSON reply, in which case json_gen is NULL.
+#define y(x, ...) (command_output.json_gen != NULL ? yajl_gen_ ## x (command_output.json_gen, ##__VA_ARGS__) : 0)
+#define ystr(str) (command_output.json_gen != NULL ? yajl_gen_string(command_output.json_gen, (unsigned char*)str, strlen(str)) : 0)
 
 /*******************************************************************************
  * The data structures used for parsing. Essentially the current state and a
@@ -56,15 +58,38 @@ typedef struct token {
     union {
         uint16_t call_identifier;
     } extra;
+    /* The length of a literal (without the leading quote) */
+    int length;
 } cmdp_token;
 
 typedef struct tokenptr {
     cmdp_token *array;
     int n;
+    /* The distinct (lowercase) first characters of the literals */
+    const char *first_chars;
+    /* For every character in first_chars, the indexes of the tokens which can
+     * match input starting with it, terminated by -1 */
+    const int **candidates;
+    /* The indexes of the tokens which are not literals (they can match any
+     * input), terminated by -1 */
+    const int *others;
 } cmdp_token_ptr;
 
 #include "GENERATED_command_tokens.h"
 
+/*
+ * Returns the indexes of the tokens of the given state which need to be tried
+ * for input starting with the given character, in the order in which they
+ * are specified. This saves comparing the input to every literal.
+ *
+ */
+static const int *candidate_tokens(const cmdp_token_ptr *ptr, char next) {
+    const char *pos = NULL;
+    if (next != '\0')
+        pos = strchr(ptr->first_chars, tolower((unsigned char)next));
+    return (pos == NULL ? ptr->others : ptr->candidates[pos - ptr->first_chars]);
+}
+
 /*******************************************************************************
  * The (small) stack where identified literals are stored during the parsing
  * of a single command (like $workspace).
@@ -74,24 +99,54 @@ struct stack_entry {
     /* Just a pointer, not dynamically allocated. */
     const char *identifier;
     char *str;
+    /* Whether str was allocated for this entry (only while compiling a
+     * command, see record_step()) instead of pointing into stack_buffers. */
+    bool owned;
 };
 
 /* 10 entries should be enough for everybody. */
 static struct stack_entry stack[10];
 
+/* The strings on the stack are copied into these buffers, which are only ever
+ * grown, so that parsing and running commands does not allocate memory once
+ * the buffers are big enough. */
+static struct {
+    char *buffer;
+    size_t capacity;
+} stack_buffers[10];
+
+/* While compile_command() runs the parser, the calls are recorded in here
+ * instead of being executed. */
+static struct CompiledCommand *recording;
+
 /*
- * Pushes a string (identified by 'identifier') on the stack. We simply use a
- * single array, since the number of entries we have to store is very small.
+ * Pushes a copy of the string str (of the given length, not necessarily
+ * NUL-terminated, identified by 'identifier') on the stack and returns the
+ * copy. We simply use a single array, since the number of entries we have to
+ * store is very small.
  *
  */
-static void push_string(const char *identifier, char *str) {
+static char *push_string(const char *identifier, const char *str, size_t length) {
     for (int c = 0; c < 10; c++) {
         if (stack[c].identifier != NULL)
             continue;
         /* Found a free slot, let’s store it here. */
         stack[c].identifier = identifier;
-        stack[c].str = str;
-        return;
+        if (recording != NULL) {
+            /* The compiled command takes over the string. */
+            stack[c].str = smalloc(length + 1);
+            stack[c].owned = true;
+        } else {
+            if (stack_buffers[c].capacity < length + 1) {
+                stack_buffers[c].capacity = length + 1;
+                stack_buffers[c].buffer = srealloc(stack_buffers[c].buffer, length + 1);
+            }
+            stack[c].str = stack_buffers[c].buffer;
+            stack[c].owned = false;
+        }
+        memcpy(stack[c].str, str, length);
+        stack[c].str[length] = '\0';
+        return stack[c].str;
     }
 
     /* When we arrive here, the stack is full. This should not happen and
@@ -117,10 +172,11 @@ static char *get_string(const char *identifier) {
 
 static void clear_stack(void) {
     for (int c = 0; c < 10; c++) {
-        if (stack[c].str != NULL)
+        if (stack[c].owned)
             free(stack[c].str);
         stack[c].identifier = NULL;
         stack[c].str = NULL;
+        stack[c].owned = false;
     }
 }
 
@@ -184,17 +240,95 @@ static struct CommandResult command_output;
 
 #include "GENERATED_command_call.h"
 
+/*
+ * A single step of a compiled command: either a call (with the identified
+ * literals it uses) or a re-initialization of the criteria.
+ *
+ */
+struct command_step {
+    /* -1 for re-initializing the criteria */
+    int call_identifier;
+    struct stack_entry args[10];
+};
+
+struct CompiledCommand {
+    int num_steps;
+    struct command_step *steps;
+
+    /* A command may free itself while it is running (reload frees all
+     * bindings), in which case freeing is deferred until it is done. */
+    bool running;
+    bool free_pending;
+};
+
+/*
+ * Appends a step to the command which is being recorded, taking over the
+ * strings on the stack.
+ *
+ */
+static void record_step(int call_identifier) {
+    recording->steps = srealloc(recording->steps, (recording->num_steps + 1) * sizeof(struct command_step));
+    struct command_step *step = &(recording->steps[recording->num_steps++]);
+    step->call_identifier = call_identifier;
+    for (int c = 0; c < 10; c++) {
+        step->args[c] = stack[c];
+        stack[c].identifier = NULL;
+        stack[c].str = NULL;
+        stack[c].owned = false;
+    }
+}
+
+/*
+ * Initializes the criteria (or records doing so while compiling).
+ *
+ */
+static void criteria_init(void) {
+    if (recording != NULL) {
+        record_step(-1);
+        return;
+    }
+    // TODO: make this testable
+#ifndef TEST_PARSER
+    cmd_criteria_init(&current_match, &subcommand_output);
+#endif
+}
+
+/*
+ * Calls the function for the given call identifier and merges its result into
+ * the result of the whole command.
+ *
+ */
+static void run_call(const int call_identifier) {
+    subcommand_output.json_gen = command_output.json_gen;
+    subcommand_output.needs_tree_render = false;
+    subcommand_output.failed = false;
+    subcommand_output.batch = 0;
+#ifndef TEST_PARSER
+    uint64_t start = stats_now();
+    GENERATED_call(call_identifier, &subcommand_output);
+    stats_record(stats_for_command(GENERATED_call_name[call_identifier]), start);
+#else
+    GENERATED_call(call_identifier, &subcommand_output);
+#endif
+    /* If any subcommand requires a tree_render(), we need to make the
+     * whole parser result request a tree_render(). */
+    if (subcommand_output.needs_tree_render)
+        command_output.needs_tree_render = true;
+    if (subcommand_output.failed)
+        command_output.failed = true;
+    command_output.batch += subcommand_output.batch;
+}
 
 static void next_state(const cmdp_token *token) {
+    if (token->next_state == __CALL && recording != NULL) {
+        record_step(token->extra.call_identifier);
+        state = GENERATED_call_next_state[token->extra.call_identifier];
+        return;
+    }
+
     if (token->next_state == __CALL) {
-        subcommand_output.json_gen = command_output.json_gen;
-        subcommand_output.needs_tree_render = false;
-        GENERATED_call(token->extra.call_identifier, &subcommand_output);
+        run_call(token->extra.call_identifier);
         state = subcommand_output.next_state;
-        /* If any subcommand requires a tree_render(), we need to make the
-         * whole parser result request a tree_render(). */
-        if (subcommand_output.needs_tree_render)
-            command_output.needs_tree_render = true;
         clear_stack();
         return;
     }
@@ -205,19 +339,31 @@ static void next_state(const cmdp_token *token) {
     }
 }
 
-struct CommandResult *parse_command(const char *input) {
+/*
+ * Resets the result and opens the reply array (which contains one result per
+ * command), if a JSON reply was requested.
+ *
+ */
+static void start_command_output(yajl_gen gen) {
+    command_output.json_gen = gen;
+    command_output.needs_tree_render = false;
+    command_output.parse_error = false;
+    command_output.failed = false;
+    command_output.batch = 0;
+
+    y(array_open);
+}
+
+/*
+ * Parses and executes the given command. If gen is not NULL, the reply (a
+ * JSON array with one result per command) is generated into it.
+ *
+ */
+struct CommandResult *parse_command(const char *input, yajl_gen gen) {
     DLOG("COMMAND: *%s*\n", input);
     state = INITIAL;
 
-/* A YAJL JSON generator used for formatting replies. */
-#if YAJL_MAJOR >= 2
-    command_output.json_gen = yajl_gen_alloc(NULL);
-#else
-    command_output.json_gen = yajl_gen_alloc(NULL, NULL);
-#endif
-
-    y(array_open);
-    command_output.needs_tree_render = false;
+    start_command_output(gen);
 
     const char *walk = input;
     const size_t len = strlen(input);
@@ -225,10 +371,7 @@ struct CommandResult *parse_command(const char *input) {
     const cmdp_token *token;
     bool token_handled;
 
-    // TODO: make this testable
-#ifndef TEST_PARSER
-    cmd_criteria_init(&current_match, &subcommand_output);
-#endif
+    criteria_init();
 
     /* The "<=" operator is intentional: We also handle the terminating 0-byte
      * explicitly by looking for an 'end' token. */
@@ -240,15 +383,15 @@ struct CommandResult *parse_command(const char *input) {
 
         cmdp_token_ptr *ptr = &(tokens[state]);
         token_handled = false;
-        for (c = 0; c < ptr->n; c++) {
-            token = &(ptr->array[c]);
+        for (const int *candidate = candidate_tokens(ptr, *walk); *candidate != -1; candidate++) {
+            token = &(ptr->array[*candidate]);
 
             /* A literal. */
             if (token->name[0] == '\'') {
-                if (strncasecmp(walk, token->name + 1, strlen(token->name) - 1) == 0) {
+                if (strncasecmp(walk, token->name + 1, token->length) == 0) {
                     if (token->identifier != NULL)
-                        push_string(token->identifier, sstrdup(token->name + 1));
-                    walk += strlen(token->name) - 1;
+                        push_string(token->identifier, token->name + 1, token->length);
+                    walk += token->length;
                     next_state(token);
                     token_handled = true;
                     break;
@@ -287,21 +430,21 @@ struct CommandResult *parse_command(const char *input) {
                     }
                 }
                 if (walk != beginning) {
-                    char *str = scalloc(walk-beginning + 1);
-                    /* We copy manually to handle escaping of characters. */
-                    int inpos, outpos;
-                    for (inpos = 0, outpos = 0;
-                         inpos < (walk-beginning);
-                         inpos++, outpos++) {
-                        /* We only handle escaped double quotes to not break
-                         * backwards compatibility with people using \w in
-                         * regular expressions etc. */
-                        if (beginning[inpos] == '\\' && beginning[inpos+1] == '"')
-                            inpos++;
-                        str[outpos] = beginning[inpos];
+                    if (token->identifier) {
+                        char *str = push_string(token->identifier, beginning, walk - beginning);
+                        /* We unescape in place. We only handle escaped
+                         * double quotes to not break backwards compatibility
+                         * with people using \w in regular expressions etc. */
+                        int inpos, outpos;
+                        for (inpos = 0, outpos = 0;
+                             str[inpos] != '\0';
+                             inpos++, outpos++) {
+                            if (str[inpos] == '\\' && str[inpos+1] == '"')
+                                inpos++;
+                            str[outpos] = str[inpos];
+                        }
+                        str[outpos] = '\0';
                     }
-                    if (token->identifier)
-                        push_string(token->identifier, str);
                     /* If we are at the end of a quoted string, skip the ending
                      * double quote. */
                     if (*walk == '"')
@@ -320,11 +463,8 @@ struct CommandResult *parse_command(const char *input) {
                      * datastructure for commands which do *not* specify any
                      * criteria, we re-initialize the criteria system after
                      * every command. */
-                    // TODO: make this testable
-#ifndef TEST_PARSER
                     if (*walk == '\0' || *walk == ';')
-                        cmd_criteria_init(&current_match, &subcommand_output);
-#endif
+                        criteria_init();
                     walk++;
                     break;
                }
@@ -402,6 +542,8 @@ struct CommandResult *parse_command(const char *input) {
             free(position);
             free(errormessage);
             clear_stack();
+            command_output.parse_error = true;
+            command_output.failed = true;
             break;
         }
     }
@@ -411,6 +553,94 @@ struct CommandResult *parse_command(const char *input) {
     return &command_output;
 }
 
+#ifndef TEST_PARSER
+/*
+ * Parses the given command once, without executing it, and returns the
+ * sequence of calls it consists of, so that it can be executed repeatedly
+ * (see run_compiled_command()) without going through the parser again. Used
+ * for key bindings. Returns NULL if the command cannot be parsed.
+ *
+ */
+struct CompiledCommand *compile_command(const char *input) {
+    /* This might be called while a command is running (reload), so we need
+     * to preserve the parser’s state. */
+    const cmdp_state saved_state = state;
+    const struct CommandResult saved_output = command_output;
+    struct stack_entry saved_stack[10];
+    memcpy(saved_stack, stack, sizeof(stack));
+    memset(stack, 0, sizeof(stack));
+
+    recording = scalloc(sizeof(struct CompiledCommand));
+    struct CommandResult *result = parse_command(input, NULL);
+    struct CompiledCommand *compiled = recording;
+    recording = NULL;
+
+    state = saved_state;
+    command_output = saved_output;
+    memcpy(stack, saved_stack, sizeof(stack));
+
+    if (result->parse_error) {
+        free_compiled_command(compiled);
+        return NULL;
+    }
+    return compiled;
+}
+
+/*
+ * Executes a command which was compiled using compile_command(). The result
+ * is the same as if the command had been passed to parse_command() (with the
+ * same gen).
+ *
+ */
+struct CommandResult *run_compiled_command(struct CompiledCommand *compiled, yajl_gen gen) {
+    DLOG("COMMAND: (compiled, %d steps)\n", compiled->num_steps);
+    start_command_output(gen);
+    compiled->running = true;
+
+    for (int i = 0; i < compiled->num_steps; i++) {
+        struct command_step *step = &(compiled->steps[i]);
+        if (step->call_identifier == -1) {
+            cmd_criteria_init(&current_match, &subcommand_output);
+            continue;
+        }
+
+        for (int c = 0; c < 10 && step->args[c].identifier != NULL; c++)
+            push_string(step->args[c].identifier, step->args[c].str, strlen(step->args[c].str));
+
+        run_call(step->call_identifier);
+        clear_stack();
+    }
+
+    y(array_close);
+
+    compiled->running = false;
+    if (compiled->free_pending)
+        free_compiled_command(compiled);
+
+    return &command_output;
+}
+
+/*
+ * Frees a command compiled using compile_command().
+ *
+ */
+void free_compiled_command(struct CompiledCommand *compiled) {
+    if (compiled == NULL)
+        return;
+
+    if (compiled->running) {
+        compiled->free_pending = true;
+        return;
+    }
+
+    for (int i = 0; i < compiled->num_steps; i++)
+        for (int c = 0; c < 10; c++)
+            free(compiled->steps[i].args[c].str);
+    free(compiled->steps);
+    free(compiled);
+}
+#endif
+
 /*******************************************************************************
  * Code for building the stand-alone binary test.commands_parser which is used
  * by t/187-commands-parser.t.
@@ -446,6 +676,6 @@ int main(int argc, char *argv[]) {
         fprintf(stderr, "Syntax: %s <command>\n", argv[0]);
         return 1;
     }
-    parse_command(argv[1]);
+    parse_command(argv[1], NULL);
 }
 #endif
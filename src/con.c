@@ -13,6 +13,8 @@
  */
 #include "all.h"
 
+#include <ctype.h>
+
 char *colors[] = {
     "#ff0000",
     "#00FF00",
@@ -28,6 +30,134 @@ char *colors[] = {
 
 static void con_on_remove_child(Con *con);
 
+/* Incremented whenever containers are attached, detached or moved, which
+ * invalidates the cached workspace and output of all containers. */
+static unsigned int tree_structure = 1;
+
+/*
+ * An open addressing hash table (with linear probing) which maps X11 window
+ * IDs to containers. We keep one for client windows and one for frames so
+ * that con_by_window_id() and con_by_frame_id(), which are called for almost
+ * every X11 event, do not need to walk all_cons. XCB_NONE marks an empty slot.
+ *
+ */
+struct con_index {
+    /* Number of slots, always a power of two (or 0 before the first insert). */
+    uint32_t size;
+    /* Number of occupied slots. */
+    uint32_t used;
+    struct con_index_slot {
+        xcb_window_t key;
+        Con *con;
+    } *slots;
+};
+
+static struct con_index window_index;
+static struct con_index frame_index;
+
+static uint32_t con_index_hash(xcb_window_t key) {
+    /* Knuth’s multiplicative hash. X11 IDs of one client are sequential, so
+     * the multiplication spreads them over the whole table. */
+    return (uint32_t)key * 2654435761u;
+}
+
+static void con_index_insert(struct con_index *index, xcb_window_t key, Con *con);
+
+/*
+ * Doubles the size of the given index (or allocates it initially) and
+ * re-inserts all entries.
+ *
+ */
+static void con_index_grow(struct con_index *index) {
+    struct con_index_slot *old_slots = index->slots;
+    uint32_t old_size = index->size;
+
+    index->size = (old_size == 0 ? 64 : old_size * 2);
+    index->used = 0;
+    index->slots = scalloc(index->size * sizeof(struct con_index_slot));
+
+    for (uint32_t i = 0; i < old_size; i++)
+        if (old_slots[i].key != XCB_NONE)
+            con_index_insert(index, old_slots[i].key, old_slots[i].con);
+
+    free(old_slots);
+}
+
+/*
+ * Maps the given key to the given container, replacing any previous mapping.
+ *
+ */
+static void con_index_insert(struct con_index *index, xcb_window_t key, Con *con) {
+    if (key == XCB_NONE)
+        return;
+
+    /* Keep the load factor below 3/4 */
+    if ((index->used + 1) * 4 > index->size * 3)
+        con_index_grow(index);
+
+    const uint32_t mask = index->size - 1;
+    uint32_t i = con_index_hash(key) & mask;
+    while (index->slots[i].key != XCB_NONE && index->slots[i].key != key)
+        i = (i + 1) & mask;
+
+    if (index->slots[i].key == XCB_NONE)
+        index->used++;
+    index->slots[i].key = key;
+    index->slots[i].con = con;
+}
+
+/*
+ * Returns the slot number for the given key or -1 if it is not in the index.
+ *
+ */
+static int64_t con_index_find(struct con_index *index, xcb_window_t key) {
+    if (index->size == 0 || key == XCB_NONE)
+        return -1;
+
+    const uint32_t mask = index->size - 1;
+    uint32_t i = con_index_hash(key) & mask;
+    while (index->slots[i].key != XCB_NONE) {
+        if (index->slots[i].key == key)
+            return i;
+        i = (i + 1) & mask;
+    }
+    return -1;
+}
+
+/*
+ * Removes the mapping for the given key, but only if it still points to the
+ * given container. Uses backward shift deletion, so we don’t need tombstones.
+ *
+ */
+static void con_index_remove(struct con_index *index, xcb_window_t key, Con *con) {
+    int64_t found = con_index_find(index, key);
+    if (found == -1 || index->slots[found].con != con)
+        return;
+
+    const uint32_t mask = index->size - 1;
+    uint32_t i = found, j = found;
+    index->slots[i].key = XCB_NONE;
+    index->used--;
+    while (true) {
+        j = (j + 1) & mask;
+        if (index->slots[j].key == XCB_NONE)
+            break;
+        uint32_t k = con_index_hash(index->slots[j].key) & mask;
+        /* The entry at j can stay if its home slot k lies cyclically in
+         * (i, j], otherwise it is moved into the hole at i. */
+        if (i <= j ? (i < k && k <= j) : (i < k || k <= j))
+            continue;
+        index->slots[i] = index->slots[j];
+        index->slots[j].key = XCB_NONE;
+        i = j;
+    }
+}
+
+static Con *con_index_lookup(struct con_index *index, xcb_window_t key) {
+    int64_t found = con_index_find(index, key);
+    return (found == -1 ? NULL : index->slots[found].con);
+}
+
 /*
  * force parent split containers to be redrawn
  *
@@ -42,18 +172,71 @@ static void con_force_split_parents_redraw(Con *con) {
     }
 }
 
+/*
+ * Marks the given container and all its parents as dirty, meaning that the
+ * next tree_render() has to recompute their geometry. This needs to be called
+ * whenever something which render_con() depends on changes, except for the
+ * rect of the container itself (which is compared directly).
+ *
+ */
+void con_mark_dirty(Con *con) {
+    if (con != NULL)
+        con_mark_changed(con);
+    for (; con != NULL; con = con->parent)
+        con->dirty = true;
+}
+
+/*
+ * Records that the given container changed in the current tree generation,
+ * so that it is part of the next GET_TREE_DELTA reply. Called by
+ * con_mark_dirty() and render_con(), and also needs to be called for changes
+ * which do not affect the geometry (title, urgency, marks, …). The output of
+ * the container is rendered in the next tree_render() (see
+ * Con.output_changed).
+ *
+ */
+void con_mark_changed(Con *con) {
+    for (Con *current = con; current != NULL; current = current->parent) {
+        if (current->type != CT_OUTPUT)
+            continue;
+        current->output_changed = true;
+        break;
+    }
+
+    con->generation = tree_generation;
+    for (; con != NULL && con->subtree_generation != tree_generation; con = con->parent)
+        con->subtree_generation = tree_generation;
+}
+
+/*
+ * Marks every container as dirty, for example after reloading the
+ * configuration (which may change the font and thus the decoration height).
+ *
+ */
+void con_mark_all_dirty(void) {
+    Con *con;
+    TAILQ_FOREACH(con, &all_cons, all_cons) {
+        con->dirty = true;
+        con->generation = con->subtree_generation = tree_generation;
+    }
+}
+
 /*
  * Create a new container (and attach it to the given parent, if not NULL).
  * This function only initializes the data structures.
  *
  */
 Con *con_new_skeleton(Con *parent, i3Window *window) {
-    Con *new = scalloc(sizeof(Con));
+    static uint64_t next_serial = 1;
+    Con *new = pool_alloc(&con_pool);
+    new->serial = next_serial++;
     new->on_remove_child = con_on_remove_child;
+    new->dirty = true;
+    con_mark_changed(new);
     TAILQ_INSERT_TAIL(&all_cons, new, all_cons);
     new->aspect_ratio = 0.0;
     new->type = CT_CON;
-    new->window = window;
+    con_set_window(new, window);
     new->border_style = config.default_border;
     new->current_border_width = -1;
     if (window)
@@ -91,6 +274,77 @@ Con *con_new(Con *parent, i3Window *window) {
     return new;
 }
 
+/*
+ * Counts the urgent children of the given container.
+ *
+ */
+static void con_count_urgent_children(Con *con) {
+    Con *child;
+    con->urgent_children = 0;
+    TAILQ_FOREACH(child, &(con->nodes_head), nodes) {
+        child->urgent_counted = child->urgent;
+        if (child->urgent)
+            con->urgent_children++;
+    }
+    TAILQ_FOREACH(child, &(con->floating_head), floating_windows) {
+        child->urgent_counted = child->urgent;
+        if (child->urgent)
+            con->urgent_children++;
+    }
+    con->urgent_children_valid = true;
+}
+
+/*
+ * Returns whether urgency is propagated from the children of con to con
+ * itself. Workspaces are updated by workspace_update_urgent_flag() instead,
+ * and nothing above them is ever urgent.
+ *
+ */
+static bool con_inherits_urgency(Con *con) {
+    return (con->type != CT_WORKSPACE && con->type != CT_DOCKAREA &&
+            con->type != CT_OUTPUT && con->type != CT_ROOT);
+}
+
+/*
+ * Updates the urgent flag of con (unless it is a leaf, whose flag is set
+ * directly) from the number of its urgent children.
+ *
+ */
+static void con_update_urgency_from_children(Con *con) {
+    if (!con_inherits_urgency(con) || con_is_leaf(con))
+        return;
+
+    if (!con->urgent_children_valid)
+        con_count_urgent_children(con);
+
+    bool urgent = (con->urgent_children > 0);
+    if (con->urgent != urgent) {
+        con->urgent = urgent;
+        con_mark_changed(con);
+    }
+}
+
+/*
+ * Accounts for a change of con->urgent in the counters of its parents,
+ * stopping at the first parent whose urgency does not change.
+ *
+ */
+static void con_propagate_urgency(Con *con) {
+    Con *parent;
+    while (con_inherits_urgency(con) && (parent = con->parent) != NULL) {
+        if (!parent->urgent_children_valid)
+            con_count_urgent_children(parent);
+        else if (con->urgent != con->urgent_counted) {
+            parent->urgent_children += (con->urgent ? 1 : -1);
+            con->urgent_counted = con->urgent;
+        } else
+            break;
+
+        con_update_urgency_from_children(parent);
+        con = parent;
+    }
+}
+
 /*
  * Attaches the given container to the given parent. This happens when moving
  * a container or when inserting a new container at a specific place in the
@@ -186,7 +440,12 @@ add_to_focus_head:
      * This way, we have the option to insert Cons without having
      * to focus them. */
     TAILQ_INSERT_TAIL(focus_head, con, focused);
+    con_children_changed(con->parent);
     con_force_split_parents_redraw(con);
+    con_mark_dirty(con);
+
+    if (con->urgent)
+        con_propagate_urgency(con);
 }
 
 /*
@@ -195,13 +454,99 @@ add_to_focus_head:
  */
 void con_detach(Con *con) {
     con_force_split_parents_redraw(con);
+    con_mark_dirty(con->parent);
     if (con->type == CT_FLOATING_CON) {
         TAILQ_REMOVE(&(con->parent->floating_head), con, floating_windows);
         TAILQ_REMOVE(&(con->parent->focus_head), con, focused);
+        con->parent->urgent_children_valid = false;
+        tree_structure++;
     } else {
         TAILQ_REMOVE(&(con->parent->nodes_head), con, nodes);
         TAILQ_REMOVE(&(con->parent->focus_head), con, focused);
+        con_children_changed(con->parent);
+    }
+
+    if (con->urgent) {
+        con_update_urgency_from_children(con->parent);
+        con_propagate_urgency(con->parent);
+    }
+}
+
+/* Containers with a window, most recently focused first. */
+static TAILQ_HEAD(focus_history_head, Con) focus_history =
+    TAILQ_HEAD_INITIALIZER(focus_history);
+
+/* Containers whose window has an urgency timestamp, oldest first. */
+static TAILQ_HEAD(urgent_cons_head, Con) urgent_cons =
+    TAILQ_HEAD_INITIALIZER(urgent_cons);
+
+static void focus_history_remove(Con *con) {
+    if (!con->in_focus_history)
+        return;
+    TAILQ_REMOVE(&focus_history, con, focus_history);
+    con->in_focus_history = false;
+}
+
+static void urgent_cons_remove(Con *con) {
+    if (!con->in_urgent_cons)
+        return;
+    TAILQ_REMOVE(&urgent_cons, con, urgent_cons);
+    con->in_urgent_cons = false;
+}
+
+/*
+ * Puts the container at the right place of the urgent_cons list after the
+ * urgency timestamp of its window changed.
+ *
+ */
+static void urgent_cons_update(Con *con) {
+    urgent_cons_remove(con);
+    if (con->window == NULL || con->window->urgent.tv_sec == 0)
+        return;
+
+    /* The timestamp is usually the newest one, so search from the end. */
+    Con *prev;
+    TAILQ_FOREACH_REVERSE(prev, &urgent_cons, urgent_cons_head, urgent_cons) {
+        if (!_i3_timercmp(prev->window->urgent, con->window->urgent, >))
+            break;
+    }
+    if (prev == NULL)
+        TAILQ_INSERT_HEAD(&urgent_cons, con, urgent_cons);
+    else TAILQ_INSERT_AFTER(&urgent_cons, prev, con, urgent_cons);
+    con->in_urgent_cons = true;
+}
+
+/*
+ * Returns the most recently focused container with a window, except for the
+ * currently focused one, or NULL if there is none. Focusing a window moves it
+ * to the front of a global list, so this does not need to search the tree.
+ *
+ */
+Con *con_focus_history_previous(void) {
+    Con *con;
+    TAILQ_FOREACH(con, &focus_history, focus_history) {
+        if (con != focused)
+            return con;
     }
+    return NULL;
+}
+
+/*
+ * Returns the container whose window most recently became urgent (see
+ * Window.urgent) or NULL if there is none.
+ *
+ */
+Con *con_latest_urgent(void) {
+    return TAILQ_LAST(&urgent_cons, urgent_cons_head);
+}
+
+/*
+ * Returns the container whose window has been urgent the longest (see
+ * Window.urgent) or NULL if there is none.
+ *
+ */
+Con *con_oldest_urgent(void) {
+    return TAILQ_FIRST(&urgent_cons);
 }
 
 /*
@@ -220,7 +565,24 @@ void con_focus(Con *con) {
     if (con->parent->parent != NULL)
         con_focus(con->parent);
 
+    /* The focus order determines which workspace is visible and which child
+     * of a stacked/tabbed container is on top. */
+    con_mark_dirty(con->parent);
+
+    /* The previously focused container loses its focused decoration, which
+     * might be on another output. */
+    if (focused != NULL && focused != con)
+        con_mark_changed(focused);
     focused = con;
+
+    /* Only the container which actually got focus goes to the front, not
+     * its parents (see the recursion above). */
+    if (con->window != NULL && TAILQ_FIRST(&focus_history) != con) {
+        focus_history_remove(con);
+        TAILQ_INSERT_HEAD(&focus_history, con, focus_history);
+        con->in_focus_history = true;
+    }
+
     /* We can't blindly reset non-leaf containers since they might have
      * other urgent children. Therefore we only reset leafs and propagate
      * the changes upwards via con_update_parents_urgency() which does proper
@@ -292,12 +654,22 @@ bool con_accepts_window(Con *con) {
  *
  */
 Con *con_get_output(Con *con) {
+    /* Comparing the parent catches code which sets a new parent before
+     * calling con_children_changed(). */
+    if (con->cached_output_structure == tree_structure &&
+        con->cached_output_parent == con->parent)
+        return con->cached_output;
+
     Con *result = con;
     while (result != NULL && result->type != CT_OUTPUT)
         result = result->parent;
     /* We must be able to get an output because focus can never be set higher
      * in the tree (root node cannot be focused). */
     assert(result != NULL);
+
+    con->cached_output = result;
+    con->cached_output_parent = con->parent;
+    con->cached_output_structure = tree_structure;
     return result;
 }
 
@@ -306,9 +678,17 @@ Con *con_get_output(Con *con) {
  *
  */
 Con *con_get_workspace(Con *con) {
+    if (con->cached_workspace_structure == tree_structure &&
+        con->cached_workspace_parent == con->parent)
+        return con->cached_workspace;
+
     Con *result = con;
     while (result != NULL && result->type != CT_WORKSPACE)
         result = result->parent;
+
+    con->cached_workspace = result;
+    con->cached_workspace_parent = con->parent;
+    con->cached_workspace_structure = tree_structure;
     return result;
 }
 
@@ -338,61 +718,62 @@ Con *con_parent_with_orientation(Con *con, orientation_t orientation) {
     return parent;
 }
 
+/* All containers whose fullscreen_mode is not CF_NONE, i.e. the visible
+ * workspaces and the fullscreen containers. con_get_fullscreen_con() is called
+ * several times per render (for CF_GLOBAL even on the whole tree), so it
+ * looks at these few containers instead of searching the tree. */
+static TAILQ_HEAD(fullscreen_cons_head, Con) fullscreen_cons =
+    TAILQ_HEAD_INITIALIZER(fullscreen_cons);
+
 /*
- * helper data structure for the breadth-first-search in
- * con_get_fullscreen_con()
+ * Sets the fullscreen_mode of the given container. The fullscreen_mode must
+ * not be changed directly, see con_get_fullscreen_con().
  *
  */
-struct bfs_entry {
-    Con *con;
+void con_set_fullscreen_mode(Con *con, int fullscreen_mode) {
+    con->fullscreen_mode = fullscreen_mode;
 
-    TAILQ_ENTRY(bfs_entry) entries;
-};
+    const bool fullscreen = (fullscreen_mode != CF_NONE);
+    if (fullscreen == con->fullscreen_indexed)
+        return;
+    if (fullscreen)
+        TAILQ_INSERT_TAIL(&fullscreen_cons, con, fullscreen_cons);
+    else TAILQ_REMOVE(&fullscreen_cons, con, fullscreen_cons);
+    con->fullscreen_indexed = fullscreen;
+}
 
 /*
  * Returns the first fullscreen node below this node.
  *
  */
 Con *con_get_fullscreen_con(Con *con, int fullscreen_mode) {
-    Con *current, *child;
-
-    /* TODO: is breadth-first-search really appropriate? (check as soon as
-     * fullscreen levels and fullscreen for containers is implemented) */
-    TAILQ_HEAD(bfs_head, bfs_entry) bfs_head = TAILQ_HEAD_INITIALIZER(bfs_head);
-    struct bfs_entry *entry = smalloc(sizeof(struct bfs_entry));
-    entry->con = con;
-    TAILQ_INSERT_TAIL(&bfs_head, entry, entries);
-
-    while (!TAILQ_EMPTY(&bfs_head)) {
-        entry = TAILQ_FIRST(&bfs_head);
-        current = entry->con;
-        if (current != con && current->fullscreen_mode == fullscreen_mode) {
-            /* empty the queue */
-            while (!TAILQ_EMPTY(&bfs_head)) {
-                entry = TAILQ_FIRST(&bfs_head);
-                TAILQ_REMOVE(&bfs_head, entry, entries);
-                free(entry);
-            }
-            return current;
-        }
-
-        TAILQ_REMOVE(&bfs_head, entry, entries);
-        free(entry);
-
-        TAILQ_FOREACH(child, &(current->nodes_head), nodes) {
-            entry = smalloc(sizeof(struct bfs_entry));
-            entry->con = child;
-            TAILQ_INSERT_TAIL(&bfs_head, entry, entries);
+    Con *current, *result = NULL;
+    int result_depth = 0;
+
+    /* Return the container which a breadth-first search would find first:
+     * the one closest to 'con' and, among those, the first in the tree. */
+    TAILQ_FOREACH(current, &fullscreen_cons, fullscreen_cons) {
+        if (current->fullscreen_mode != fullscreen_mode)
+            continue;
+
+        int depth = 1;
+        Con *parent = current->parent;
+        while (parent != NULL && parent != con) {
+            parent = parent->parent;
+            depth++;
         }
+        if (parent == NULL)
+            continue;
 
-        TAILQ_FOREACH(child, &(current->floating_head), floating_windows) {
-            entry = smalloc(sizeof(struct bfs_entry));
-            entry->con = child;
-            TAILQ_INSERT_TAIL(&bfs_head, entry, entries);
+        if (result == NULL ||
+            depth < result_depth ||
+            (depth == result_depth && con_precedes(current, result))) {
+            result = current;
+            result_depth = depth;
         }
     }
 
-    return NULL;
+    return result;
 }
 
 /**
@@ -444,17 +825,37 @@ bool con_inside_focused(Con *con) {
     return con_inside_focused(con->parent);
 }
 
+/*
+ * Returns true if the given container (still) exists.
+ *
+ */
+bool con_exists(Con *con) {
+    Con *current;
+    TAILQ_FOREACH(current, &all_cons, all_cons) {
+        if (current == con)
+            return true;
+    }
+    return false;
+}
+
+/*
+ * Returns true if the given container still exists and is the one which had
+ * the given serial, i.e. it was not closed (and its memory reused for a new
+ * container) in the meantime. Use this instead of con_exists() for pointers
+ * kept across the event loop.
+ *
+ */
+bool con_still_exists(Con *con, uint64_t serial) {
+    return con_exists(con) && con->serial == serial;
+}
+
 /*
  * Returns the container with the given client window ID or NULL if no such
  * container exists.
  *
  */
 Con *con_by_window_id(xcb_window_t window) {
-    Con *con;
-    TAILQ_FOREACH(con, &all_cons, all_cons)
-        if (con->window != NULL && con->window->id == window)
-            return con;
-    return NULL;
+    return con_index_lookup(&window_index, window);
 }
 
 /*
@@ -463,51 +864,313 @@ Con *con_by_window_id(xcb_window_t window) {
  *
  */
 Con *con_by_frame_id(xcb_window_t frame) {
+    return con_index_lookup(&frame_index, frame);
+}
+
+/*
+ * Sets the client window of the given container (NULL to unset it) and keeps
+ * the index used by con_by_window_id() up to date. Always use this instead of
+ * assigning con->window directly.
+ *
+ */
+void con_set_window(Con *con, i3Window *window) {
+    con_mark_dirty(con);
+    if (con->window != NULL)
+        con_index_remove(&window_index, con->window->id, con);
+    /* Both lists are about the window, not the container. */
+    focus_history_remove(con);
+    urgent_cons_remove(con);
+    con->window = window;
+    if (window != NULL)
+        con_index_insert(&window_index, window->id, con);
+}
+
+/* All marked containers, hashed by their mark. */
+#define MARK_BUCKETS 64
+static SLIST_HEAD(mark_head, Con) mark_buckets[MARK_BUCKETS];
+
+static struct mark_head *mark_bucket(const char *mark) {
+    unsigned int hash = 5381;
+    for (const char *c = mark; *c != '\0'; c++)
+        hash = ((hash << 5) + hash) + (unsigned char)*c;
+    return &mark_buckets[hash % MARK_BUCKETS];
+}
+
+/*
+ * Returns the container with the given mark or NULL if no such container
+ * exists.
+ *
+ */
+Con *con_by_mark(const char *mark) {
     Con *con;
-    TAILQ_FOREACH(con, &all_cons, all_cons)
-        if (con->frame == frame)
+    SLIST_FOREACH(con, mark_bucket(mark), mark_bucket) {
+        if (strcmp(con->mark, mark) == 0)
             return con;
+    }
     return NULL;
 }
 
 /*
- * Returns the first container below 'con' which wants to swallow this window
- * TODO: priority
+ * Sets the mark of the given container to a copy of 'mark' (NULL to unset it)
+ * and keeps the marked_cons list and the index used by con_by_mark() up to
+ * date. Always use this instead of assigning con->mark directly.
  *
  */
-Con *con_for_window(Con *con, i3Window *window, Match **store_match) {
-    Con *child;
-    Match *match;
-    //DLOG("searching con for window %p starting at con %p\n", window, con);
-    //DLOG("class == %s\n", window->class_class);
+void con_set_mark(Con *con, const char *mark) {
+    if (con->mark != NULL) {
+        SLIST_REMOVE(mark_bucket(con->mark), con, Con, mark_bucket);
+        TAILQ_REMOVE(&marked_cons, con, marked_cons);
+        FREE(con->mark);
+    }
+    if (mark != NULL) {
+        con->mark = sstrdup(mark);
+        TAILQ_INSERT_TAIL(&marked_cons, con, marked_cons);
+        SLIST_INSERT_HEAD(mark_bucket(con->mark), con, mark_bucket);
+    }
+}
 
-    TAILQ_FOREACH(child, &(con->nodes_head), nodes) {
-        TAILQ_FOREACH(match, &(child->swallow_head), matches) {
-            if (!match_matches_window(match, window))
-                continue;
-            if (store_match != NULL)
-                *store_match = match;
-            return child;
+/*
+ * Adds the frame of the given container to the index used by
+ * con_by_frame_id(). Called by x_con_init() once the frame was created.
+ *
+ */
+void con_index_frame(Con *con) {
+    con_index_insert(&frame_index, con->frame, con);
+}
+
+/*
+ * Removes the frame of the given container from the index used by
+ * con_by_frame_id(). Called by x_con_kill() before the frame is destroyed.
+ *
+ */
+void con_unindex_frame(Con *con) {
+    con_index_remove(&frame_index, con->frame, con);
+}
+
+/*
+ * The swallow matches of all containers, hashed by the window id, the literal
+ * class or the literal instance they require (in this order of preference).
+ * This way, con_for_window() only needs to test the matches which can
+ * possibly match a new window instead of every placeholder in the tree, which
+ * matters when restoring a layout with many placeholders. Matches which
+ * require none of these (e.g. the ones of the dock areas) are tested for every
+ * window.
+ *
+ */
+#define SWALLOW_BUCKETS 256
+LIST_HEAD(swallow_bucket_head, Match);
+static struct swallow_bucket_head swallow_buckets[SWALLOW_BUCKETS];
+static struct swallow_bucket_head swallow_other = LIST_HEAD_INITIALIZER(swallow_other);
+
+static struct swallow_bucket_head *swallow_bucket_for_id(xcb_window_t id) {
+    return &swallow_buckets[con_index_hash(id) % SWALLOW_BUCKETS];
+}
+
+static struct swallow_bucket_head *swallow_bucket_for_string(char kind, const char *str) {
+    unsigned int hash = 5381 + kind;
+    for (const char *c = str; *c != '\0'; c++)
+        hash = ((hash << 5) + hash) + (unsigned char)*c;
+    return &swallow_buckets[hash % SWALLOW_BUCKETS];
+}
+
+/*
+ * Returns the string which the given regular expression matches if it only
+ * matches a single string, like "^XTerm$" (which is what layout files
+ * contain), or NULL otherwise. The result has to be free()d.
+ *
+ */
+static char *regex_literal(struct regex *regex) {
+    if (regex == NULL)
+        return NULL;
+
+    const char *pattern = regex->pattern;
+    size_t len = strlen(pattern);
+    if (len < 2 || pattern[0] != '^' || pattern[len - 1] != '$')
+        return NULL;
+
+    char *literal = smalloc(len);
+    char *out = literal;
+    for (size_t i = 1; i < len - 1; i++) {
+        if (pattern[i] == '\\') {
+            /* Escaped punctuation stands for itself, but escaped letters and
+             * digits are character classes or back-references. */
+            if (i + 1 == len - 1 || isalnum((unsigned char)pattern[i + 1])) {
+                free(literal);
+                return NULL;
+            }
+            *out++ = pattern[++i];
+        } else if (strchr(".^$|?*+()[]{}", pattern[i]) != NULL) {
+            free(literal);
+            return NULL;
+        } else {
+            *out++ = pattern[i];
         }
-        Con *result = con_for_window(child, window, store_match);
-        if (result != NULL)
-            return result;
     }
+    *out = '\0';
+    return literal;
+}
 
-    TAILQ_FOREACH(child, &(con->floating_head), floating_windows) {
-        TAILQ_FOREACH(match, &(child->swallow_head), matches) {
-            if (!match_matches_window(match, window))
-                continue;
-            if (store_match != NULL)
-                *store_match = match;
-            return child;
+/*
+ * Adds the given swallow match (which has to be complete, i.e. all criteria
+ * are set) of the given container to the index used by con_for_window().
+ * Has to be called for every match which is added to a swallow_head.
+ *
+ */
+void con_index_swallow(Con *con, Match *match) {
+    struct swallow_bucket_head *head;
+    char *literal;
+
+    if (match->swallow_con != NULL)
+        LIST_REMOVE(match, swallow_bucket);
+
+    if (match->id != XCB_NONE)
+        head = swallow_bucket_for_id(match->id);
+    else if ((literal = regex_literal(match->class)) != NULL) {
+        head = swallow_bucket_for_string('c', literal);
+        free(literal);
+    } else if ((literal = regex_literal(match->instance)) != NULL) {
+        head = swallow_bucket_for_string('i', literal);
+        free(literal);
+    } else
+        head = &swallow_other;
+
+    LIST_INSERT_HEAD(head, match, swallow_bucket);
+    match->swallow_con = con;
+}
+
+static void con_unindex_swallow(Match *match) {
+    if (match->swallow_con == NULL)
+        return;
+    LIST_REMOVE(match, swallow_bucket);
+    match->swallow_con = NULL;
+}
+
+/*
+ * Removes all swallow matches of the given container from the index used by
+ * con_for_window(). Called by tree_close() before the matches are freed.
+ *
+ */
+void con_unindex_swallows(Con *con) {
+    Match *match;
+    TAILQ_FOREACH(match, &(con->swallow_head), matches)
+        con_unindex_swallow(match);
+}
+
+/*
+ * Returns true if 'con' is a (direct or indirect) child of 'ancestor'.
+ *
+ */
+static bool con_is_below(Con *con, Con *ancestor) {
+    for (con = con->parent; con != NULL; con = con->parent)
+        if (con == ancestor)
+            return true;
+    return false;
+}
+
+/*
+ * Returns true if a depth-first walk of the tree (a container before its
+ * children, tiling before floating children) visits 'a' before 'b'. Both have
+ * to be part of the same tree.
+ *
+ */
+bool con_precedes(Con *a, Con *b) {
+    int depth_a = 0, depth_b = 0;
+    for (Con *c = a; c->parent != NULL; c = c->parent)
+        depth_a++;
+    for (Con *c = b; c->parent != NULL; c = c->parent)
+        depth_b++;
+
+    for (; depth_a > depth_b; depth_a--) {
+        a = a->parent;
+        if (a == b)
+            return false;
+    }
+    for (; depth_b > depth_a; depth_b--) {
+        b = b->parent;
+        if (b == a)
+            return true;
+    }
+    while (a->parent != b->parent) {
+        a = a->parent;
+        b = b->parent;
+    }
+
+    Con *child;
+    TAILQ_FOREACH(child, &(a->parent->nodes_head), nodes) {
+        if (child == a)
+            return true;
+        if (child == b)
+            return false;
+    }
+    TAILQ_FOREACH(child, &(a->parent->floating_head), floating_windows) {
+        if (child == a)
+            return true;
+        if (child == b)
+            return false;
+    }
+    return false;
+}
+
+/*
+ * Returns true if 'match' comes before 'other' in the swallow_head of 'con'.
+ *
+ */
+static bool swallow_precedes(Con *con, Match *match, Match *other) {
+    Match *current;
+    TAILQ_FOREACH(current, &(con->swallow_head), matches) {
+        if (current == match)
+            return true;
+        if (current == other)
+            return false;
+    }
+    return false;
+}
+
+/*
+ * Returns the first container below 'con' which wants to swallow this window
+ * TODO: priority
+ *
+ */
+Con *con_for_window(Con *con, i3Window *window, Match **store_match) {
+    struct swallow_bucket_head *heads[4];
+    int num_heads = 0;
+    Con *result = NULL;
+    Match *result_match = NULL;
+
+    heads[num_heads++] = &swallow_other;
+    heads[num_heads++] = swallow_bucket_for_id(window->id);
+    if (window->class_class != NULL)
+        heads[num_heads++] = swallow_bucket_for_string('c', window->class_class);
+    if (window->class_instance != NULL)
+        heads[num_heads++] = swallow_bucket_for_string('i', window->class_instance);
+
+    /* Of all matching containers, the one which a depth-first walk of the
+     * tree finds first wins. */
+    for (int i = 0; i < num_heads; i++) {
+        Match *match = LIST_FIRST(heads[i]);
+        while (match != NULL) {
+            Match *next = LIST_NEXT(match, swallow_bucket);
+            Con *candidate = match->swallow_con;
+
+            if (match->insert_where == M_HERE && candidate->window != NULL) {
+                /* This placeholder already swallowed its window. */
+                con_unindex_swallow(match);
+            } else if (con_is_below(candidate, con) &&
+                       (result == NULL ||
+                        (candidate == result ? swallow_precedes(candidate, match, result_match)
+                                             : con_precedes(candidate, result))) &&
+                       match_matches_window(match, window)) {
+                result = candidate;
+                result_match = match;
+            }
+
+            match = next;
         }
-        Con *result = con_for_window(child, window, store_match);
-        if (result != NULL)
-            return result;
     }
 
-    return NULL;
+    if (result != NULL && store_match != NULL)
+        *store_match = result_match;
+    return result;
 }
 
 /*
@@ -515,13 +1178,64 @@ Con *con_for_window(Con *con, i3Window *window, Match **store_match) {
  *
  */
 int con_num_children(Con *con) {
-    Con *child;
-    int children = 0;
+    int children;
+    con_children(con, &children);
+    return children;
+}
+
+/*
+ * Returns the tiling children of the given container (in the order of
+ * nodes_head) as an array and stores their number in *count. The array is
+ * cached until con_children_changed() is called, so it must neither be
+ * modified nor used after changing the tree.
+ *
+ */
+Con **con_children(Con *con, int *count) {
+    if (!con->children_valid) {
+        Con *child;
+        int num = 0;
+        TAILQ_FOREACH(child, &(con->nodes_head), nodes)
+            num++;
+        if (num > con->children_size) {
+            con->children = srealloc(con->children, num * sizeof(Con *));
+            con->children_size = num;
+        }
+        num = 0;
+        TAILQ_FOREACH(child, &(con->nodes_head), nodes)
+            con->children[num++] = child;
+        con->num_children = num;
+        con->children_valid = true;
+    }
 
-    TAILQ_FOREACH(child, &(con->nodes_head), nodes)
-        children++;
+    *count = con->num_children;
+    return con->children;
+}
 
-    return children;
+/*
+ * Invalidates the array returned by con_children(), the number of urgent
+ * children and the sizes cached by render_con(). Needs to be called whenever nodes_head of the given container was
+ * changed without using con_attach() or con_detach().
+ *
+ */
+void con_children_changed(Con *con) {
+    con->children_valid = false;
+    con->urgent_children_valid = false;
+    con->dock_height_valid = false;
+    /* Replaced children (see tree_split()) start with zeroed cache fields,
+     * which could match the cache of the child they replace. */
+    con->size_cache_total = 0;
+    tree_structure++;
+    con_tree_representations_changed();
+}
+
+/*
+ * Returns a number which changes whenever containers are attached, detached
+ * or moved, so that callers can cache things computed from the tree
+ * structure.
+ *
+ */
+unsigned int con_tree_structure(void) {
+    return tree_structure;
 }
 
 /*
@@ -531,16 +1245,18 @@ int con_num_children(Con *con) {
  *
  */
 void con_fix_percent(Con *con) {
-    Con *child;
-    int children = con_num_children(con);
+    int children;
+    Con **nodes = con_children(con, &children);
+
+    con_mark_dirty(con);
 
     // calculate how much we have distributed and how many containers
     // with a percentage set we have
     double total = 0.0;
     int children_with_percent = 0;
-    TAILQ_FOREACH(child, &(con->nodes_head), nodes) {
-        if (child->percent > 0.0) {
-            total += child->percent;
+    for (int i = 0; i < children; i++) {
+        if (nodes[i]->percent > 0.0) {
+            total += nodes[i]->percent;
             ++children_with_percent;
         }
     }
@@ -548,11 +1264,11 @@ void con_fix_percent(Con *con) {
     // if there were children without a percentage set, set to a value that
     // will make those children proportional to all others
     if (children_with_percent != children) {
-        TAILQ_FOREACH(child, &(con->nodes_head), nodes) {
-            if (child->percent <= 0.0) {
+        for (int i = 0; i < children; i++) {
+            if (nodes[i]->percent <= 0.0) {
                 if (children_with_percent == 0)
-                    total += (child->percent = 1.0);
-                else total += (child->percent = total / children_with_percent);
+                    total += (nodes[i]->percent = 1.0);
+                else total += (nodes[i]->percent = total / children_with_percent);
             }
         }
     }
@@ -560,11 +1276,11 @@ void con_fix_percent(Con *con) {
     // if we got a zero, just distribute the space equally, otherwise
     // distribute according to the proportions we got
     if (total == 0.0) {
-        TAILQ_FOREACH(child, &(con->nodes_head), nodes)
-            child->percent = 1.0 / children;
+        for (int i = 0; i < children; i++)
+            nodes[i]->percent = 1.0 / children;
     } else if (total != 1.0) {
-        TAILQ_FOREACH(child, &(con->nodes_head), nodes)
-            child->percent /= total;
+        for (int i = 0; i < children; i++)
+            nodes[i]->percent /= total;
     }
 }
 
@@ -597,17 +1313,20 @@ void con_toggle_fullscreen(Con *con, int fullscreen_mode) {
              * to have in fullscreen mode. */
             LOG("Disabling fullscreen for (%p/%s) upon user request\n",
                 fullscreen, fullscreen->name);
-            fullscreen->fullscreen_mode = CF_NONE;
+            con_set_fullscreen_mode(fullscreen, CF_NONE);
         }
 
         /* 2: enable fullscreen */
-        con->fullscreen_mode = fullscreen_mode;
+        con_set_fullscreen_mode(con, fullscreen_mode);
     } else {
         /* 1: disable fullscreen */
-        con->fullscreen_mode = CF_NONE;
+        con_set_fullscreen_mode(con, CF_NONE);
     }
 
     DLOG("mode now: %d\n", con->fullscreen_mode);
+    if (fullscreen_mode == CF_GLOBAL)
+        con_mark_dirty(croot);
+    con_mark_dirty(con);
 
     /* update _NET_WM_STATE if this container has a window */
     /* TODO: when a window is assigned to a container which is already
@@ -625,6 +1344,51 @@ void con_toggle_fullscreen(Con *con, int fullscreen_mode) {
                         A__NET_WM_STATE, XCB_ATOM_ATOM, 32, num, values);
 }
 
+/* Windows which were moved to another workspace and whose startup sequences
+ * still have to be deleted. The _NET_STARTUP_ID requests are sent right away,
+ * the replies are only collected in startup_cleanups_flush(), so that moving
+ * many windows at once (see con_move_many_to_workspace()) does not wait for
+ * one round trip per window. */
+struct startup_cleanup {
+    xcb_window_t window;
+    xcb_get_property_cookie_t cookie;
+};
+static struct startup_cleanup *startup_cleanups;
+static int num_startup_cleanups;
+static int startup_cleanups_size;
+static bool moving_many;
+
+static void startup_cleanup_add(i3Window *window) {
+    if (num_startup_cleanups == startup_cleanups_size) {
+        startup_cleanups_size = (startup_cleanups_size == 0 ? 8 : startup_cleanups_size * 2);
+        startup_cleanups = srealloc(startup_cleanups, startup_cleanups_size * sizeof(struct startup_cleanup));
+    }
+
+    struct startup_cleanup *cleanup = &startup_cleanups[num_startup_cleanups++];
+    cleanup->window = window->id;
+    cleanup->cookie = xcb_get_property(conn, false, window->id,
+        A__NET_STARTUP_ID, XCB_GET_PROPERTY_TYPE_ANY, 0, 512);
+}
+
+static void startup_cleanups_flush(void) {
+    for (int i = 0; i < num_startup_cleanups; i++) {
+        xcb_get_property_reply_t *startup_id_reply =
+            xcb_get_property_reply(conn, startup_cleanups[i].cookie, NULL);
+
+        /* Look the window up again, it might have been closed meanwhile. */
+        Con *con = con_by_window_id(startup_cleanups[i].window);
+        if (con == NULL) {
+            FREE(startup_id_reply);
+            continue;
+        }
+
+        struct Startup_Sequence *sequence = startup_sequence_get(con->window, startup_id_reply, true);
+        if (sequence != NULL)
+            startup_sequence_delete(sequence);
+    }
+    num_startup_cleanups = 0;
+}
+
 /*
  * Moves the given container to the currently focused container on the given
  * workspace.
@@ -787,39 +1551,41 @@ void con_move_to_workspace(Con *con, Con *workspace, bool fix_coordinates, bool
 
     /* If anything within the container is associated with a startup sequence,
      * delete it so child windows won't be created on the old workspace. */
-    struct Startup_Sequence *sequence;
-    xcb_get_property_cookie_t cookie;
-    xcb_get_property_reply_t *startup_id_reply;
-
     if (!con_is_leaf(con)) {
         Con *child;
         TAILQ_FOREACH(child, &(con->nodes_head), nodes) {
-            if (!child->window)
-                continue;
-
-            cookie = xcb_get_property(conn, false, child->window->id,
-                A__NET_STARTUP_ID, XCB_GET_PROPERTY_TYPE_ANY, 0, 512);
-            startup_id_reply = xcb_get_property_reply(conn, cookie, NULL);
-
-            sequence = startup_sequence_get(child->window, startup_id_reply, true);
-            if (sequence != NULL)
-                startup_sequence_delete(sequence);
+            if (child->window)
+                startup_cleanup_add(child->window);
         }
     }
 
-    if (con->window) {
-        cookie = xcb_get_property(conn, false, con->window->id,
-            A__NET_STARTUP_ID, XCB_GET_PROPERTY_TYPE_ANY, 0, 512);
-        startup_id_reply = xcb_get_property_reply(conn, cookie, NULL);
+    if (con->window)
+        startup_cleanup_add(con->window);
 
-        sequence = startup_sequence_get(con->window, startup_id_reply, true);
-        if (sequence != NULL)
-            startup_sequence_delete(sequence);
-    }
+    if (!moving_many)
+        startup_cleanups_flush();
 
     CALL(parent, on_remove_child);
 }
 
+/*
+ * Moves all of the given containers to the given workspace, like calling
+ * con_move_to_workspace() for each of them. The startup sequences of all
+ * moved windows are looked up together afterwards, which saves one round
+ * trip to the X server per window.
+ *
+ */
+void con_move_many_to_workspace(Con **cons, int num, Con *workspace) {
+    moving_many = true;
+    for (int i = 0; i < num; i++) {
+        DLOG("moving %p / %s\n", cons[i], cons[i]->name);
+        con_move_to_workspace(cons[i], workspace, true, false);
+    }
+    moving_many = false;
+
+    startup_cleanups_flush();
+}
+
 /*
  * Returns the orientation of the given container (for stacked containers,
  * vertical orientation is used regardless of the actual orientation of the
@@ -1166,6 +1932,8 @@ int con_border_style(Con *con) {
  *
  */
 void con_set_border_style(Con *con, int border_style, int border_width) {
+    con_mark_dirty(con->parent);
+
     /* Handle the simple case: non-floating containerns */
     if (!con_is_floating(con)) {
         con->border_style = border_style;
@@ -1291,6 +2059,7 @@ void con_set_layout(Con *con, layout_t layout) {
         con->layout = layout;
     }
     con_force_split_parents_redraw(con);
+    con_mark_dirty(con);
 }
 
 /*
@@ -1372,7 +2141,7 @@ static void con_on_remove_child(Con *con) {
     }
 
     con_force_split_parents_redraw(con);
-    con->urgent = con_has_urgent_child(con);
+    con_update_urgency_from_children(con);
     con_update_parents_urgency(con);
 
     /* TODO: check if this container would swallow any other client and
@@ -1508,45 +2277,31 @@ bool con_fullscreen_permits_focusing(Con *con) {
 
 /*
  *
- * Checks if the given container has an urgent child.
+ * Checks if the given container has an urgent child. For workspaces, this
+ * includes floating windows.
  *
  */
 bool con_has_urgent_child(Con *con) {
-    Con *child;
-
-    if (con_is_leaf(con))
+    if (con->type != CT_WORKSPACE && con_is_leaf(con))
         return con->urgent;
 
-    /* We are not interested in floating windows since they can only be
-     * attached to a workspace → nodes_head instead of focus_head */
-    TAILQ_FOREACH(child, &(con->nodes_head), nodes) {
-        if (con_has_urgent_child(child))
-            return true;
-    }
+    if (!con->urgent_children_valid)
+        con_count_urgent_children(con);
 
-    return false;
+    return (con->urgent_children > 0);
 }
 
 /*
  * Make all parent containers urgent if con is urgent or clear the urgent flag
  * of all parent containers if there are no more urgent children left.
  *
+ * Every container counts its urgent children, so this only walks up as far as
+ * the urgency of the parents changes.
+ *
  */
 void con_update_parents_urgency(Con *con) {
-    Con *parent = con->parent;
-
-    bool new_urgency_value = con->urgent;
-    while (parent && parent->type != CT_WORKSPACE && parent->type != CT_DOCKAREA) {
-        if (new_urgency_value) {
-            parent->urgent = true;
-        } else {
-            /* We can only reset the urgency when the parent
-             * has no other urgent children */
-            if (!con_has_urgent_child(parent))
-                parent->urgent = false;
-        }
-        parent = parent->parent;
-    }
+    con_mark_changed(con);
+    con_propagate_urgency(con);
 }
 
 /*
@@ -1558,10 +2313,11 @@ void con_set_urgency(Con *con, bool urgent) {
         DLOG("Ignoring urgency flag for current client\n");
         con->window->urgent.tv_sec = 0;
         con->window->urgent.tv_usec = 0;
+        urgent_cons_update(con);
         return;
     }
 
-    if (con->urgency_timer == NULL) {
+    if (!con->urgency_timer_active) {
         con->urgent = urgent;
     } else
         DLOG("Discarding urgency WM_HINT because timer is running\n");
@@ -1574,6 +2330,7 @@ void con_set_urgency(Con *con, bool urgent) {
             con->window->urgent.tv_sec = 0;
             con->window->urgent.tv_usec = 0;
         }
+        urgent_cons_update(con);
     }
 
     con_update_parents_urgency(con);
@@ -1588,11 +2345,40 @@ void con_set_urgency(Con *con, bool urgent) {
         workspace_update_urgent_flag(ws);
 }
 
+/* Incremented whenever the structure of the tree (or a WM_CLASS) changes,
+ * which invalidates all cached tree representations. Layout changes are
+ * detected by comparing the layout instead, as there are too many places
+ * which set it. */
+static unsigned int tree_repr_structure = 1;
+/* Incremented whenever a tree representation is built, so that a parent can
+ * tell that one of its children was rebuilt after itself. */
+static unsigned int tree_repr_serial;
+
 /*
- * Create a string representing the subtree under con.
+ * Invalidates the cached tree representations, e.g. because the
+ * WM_CLASS of a window changed.
  *
  */
-char *con_get_tree_representation(Con *con) {
+void con_tree_representations_changed(void) {
+    tree_repr_structure++;
+}
+
+static void tree_repr_append(Con *con, const char *str, size_t length) {
+    if (con->tree_repr_length + length + 1 > con->tree_repr_size) {
+        con->tree_repr_size = max(2 * con->tree_repr_size, con->tree_repr_length + length + 1);
+        con->tree_repr = srealloc(con->tree_repr, con->tree_repr_size);
+    }
+    memcpy(con->tree_repr + con->tree_repr_length, str, length);
+    con->tree_repr_length += length;
+    con->tree_repr[con->tree_repr_length] = '\0';
+}
+
+/*
+ * Create a string representing the subtree under con. The string is cached
+ * in con and must not be freed or used after changing the tree.
+ *
+ */
+const char *con_get_tree_representation(Con *con) {
     /* this code works as follows:
      *  1) create a string with the layout type (D/V/H/T/S) and an opening bracket
      *  2) append the tree representation of the children to the string
@@ -1600,52 +2386,66 @@ char *con_get_tree_representation(Con *con) {
      *
      * The recursion ends when we hit a leaf, in which case we return the
      * class_instance of the contained window.
-     */
+     *
+     * The representation of every split container is cached, so that
+     * redrawing the decoration of a split container only has to check that
+     * nothing changed below it. */
 
     /* end of recursion */
     if (con_is_leaf(con)) {
         if (!con->window)
-            return sstrdup("nowin");
+            return "nowin";
 
         if (!con->window->class_instance)
-            return sstrdup("noinstance");
+            return "noinstance";
 
-        return sstrdup(con->window->class_instance);
+        return con->window->class_instance;
     }
 
-    char *buf;
+    bool valid = (con->tree_repr != NULL &&
+                  con->tree_repr_structure == tree_repr_structure &&
+                  con->tree_repr_layout == con->layout);
+    Con *child;
+    TAILQ_FOREACH(child, &(con->nodes_head), nodes) {
+        if (con_is_leaf(child))
+            continue;
+        con_get_tree_representation(child);
+        if (child->tree_repr_serial > con->tree_repr_serial)
+            valid = false;
+    }
+    if (valid)
+        return con->tree_repr;
+
     /* 1) add the Layout type to buf */
+    con->tree_repr_length = 0;
     if (con->layout == L_DEFAULT)
-        buf = sstrdup("D[");
+        tree_repr_append(con, "D[", 2);
     else if (con->layout == L_SPLITV)
-        buf = sstrdup("V[");
+        tree_repr_append(con, "V[", 2);
     else if (con->layout == L_SPLITH)
-        buf = sstrdup("H[");
+        tree_repr_append(con, "H[", 2);
     else if (con->layout == L_TABBED)
-        buf = sstrdup("T[");
+        tree_repr_append(con, "T[", 2);
     else if (con->layout == L_STACKED)
-        buf = sstrdup("S[");
+        tree_repr_append(con, "S[", 2);
     else {
         ELOG("BUG: Code not updated to account for new layout type\n");
         assert(false);
     }
 
     /* 2) append representation of children */
-    Con *child;
     TAILQ_FOREACH(child, &(con->nodes_head), nodes) {
-        char *child_txt = con_get_tree_representation(child);
-
-        char *tmp_buf;
-        sasprintf(&tmp_buf, "%s%s%s", buf,
-                (TAILQ_FIRST(&(con->nodes_head)) == child ? "" : " "), child_txt);
-        free(buf);
-        buf = tmp_buf;
+        if (TAILQ_FIRST(&(con->nodes_head)) != child)
+            tree_repr_append(con, " ", 1);
+        const char *child_txt = con_get_tree_representation(child);
+        tree_repr_append(con, child_txt, strlen(child_txt));
     }
 
     /* 3) close the brackets */
-    char *complete_buf;
-    sasprintf(&complete_buf, "%s]", buf);
-    free(buf);
+    tree_repr_append(con, "]", 1);
 
-    return complete_buf;
+    con->tree_repr_layout = con->layout;
+    con->tree_repr_structure = tree_repr_structure;
+    con->tree_repr_serial = ++tree_repr_serial;
+    return con->tree_repr;
 }
@@ -20,6 +20,39 @@ Config config;
 struct modes_head modes;
 struct barconfig_head barconfigs = TAILQ_HEAD_INITIALIZER(barconfigs);
 
+/*
+ * A key grab on the root window. All grabs are tracked in a sorted array, so
+ * that update_key_grabs() only needs to change the grabs which differ.
+ *
+ */
+struct key_grab {
+    uint16_t mods;
+    xcb_keycode_t keycode;
+};
+static struct key_grab *grabbed_keys;
+static int num_grabbed_keys;
+
+static int key_grab_cmp(const void *a, const void *b) {
+    const struct key_grab *first = a, *second = b;
+    if (first->keycode != second->keycode)
+        return first->keycode - second->keycode;
+    return first->mods - second->mods;
+}
+
+/*
+ * Sorts the given grabs and removes duplicates. Returns the new number of
+ * grabs.
+ *
+ */
+static int unique_key_grabs(struct key_grab *grabs, int num) {
+    qsort(grabs, num, sizeof(struct key_grab), key_grab_cmp);
+    int unique = 0;
+    for (int i = 0; i < num; i++)
+        if (unique == 0 || key_grab_cmp(&grabs[unique - 1], &grabs[i]) != 0)
+            grabs[unique++] = grabs[i];
+    return unique;
+}
+
 /**
  * Ungrabs all keys, to be called before re-grabbing the keys because of a
  * mapping_notify event or a configuration file reload
@@ -28,26 +61,116 @@ struct barconfig_head barconfigs = TAILQ_HEAD_INITIALIZER(barconfigs);
 void ungrab_all_keys(xcb_connection_t *conn) {
     DLOG("Ungrabbing all keys\n");
     xcb_ungrab_key(conn, XCB_GRAB_ANY, root, XCB_BUTTON_MASK_ANY);
+    num_grabbed_keys = 0;
 }
 
-static void grab_keycode_for_binding(xcb_connection_t *conn, Binding *bind, uint32_t keycode) {
-    DLOG("Grabbing %d with modifiers %d (with mod_mask_lock %d)\n", keycode, bind->mods, bind->mods | XCB_MOD_MASK_LOCK);
-    /* Grab the key in all combinations */
-    #define GRAB_KEY(modifier) \
-        do { \
-            xcb_grab_key(conn, 0, root, modifier, keycode, \
-                         XCB_GRAB_MODE_SYNC, XCB_GRAB_MODE_ASYNC); \
-        } while (0)
+/*
+ * Appends the grabs which are needed for the given binding (the key in
+ * combination with NumLock and CapsLock) to *grabs.
+ *
+ */
+static void add_grabs_for_binding(Binding *bind, struct key_grab **grabs, int *num) {
     int mods = bind->mods;
     if ((bind->mods & BIND_MODE_SWITCH) != 0) {
         mods &= ~BIND_MODE_SWITCH;
         if (mods == 0)
             mods = XCB_MOD_MASK_ANY;
     }
-    GRAB_KEY(mods);
-    GRAB_KEY(mods | xcb_numlock_mask);
-    GRAB_KEY(mods | XCB_MOD_MASK_LOCK);
-    GRAB_KEY(mods | xcb_numlock_mask | XCB_MOD_MASK_LOCK);
+    const uint16_t combinations[] = {
+        mods,
+        mods | xcb_numlock_mask,
+        mods | XCB_MOD_MASK_LOCK,
+        mods | xcb_numlock_mask | XCB_MOD_MASK_LOCK
+    };
+
+    const int num_keycodes = (bind->keycode > 0 ? 1 : bind->number_keycodes);
+    *grabs = srealloc(*grabs, sizeof(struct key_grab) * (*num + 4 * num_keycodes));
+    for (int i = 0; i < num_keycodes; i++) {
+        const xcb_keycode_t keycode = (bind->keycode > 0 ? bind->keycode : bind->translated_to[i]);
+        for (int c = 0; c < 4; c++)
+            (*grabs)[(*num)++] = (struct key_grab){ combinations[c], keycode };
+    }
+}
+
+/*
+ * Returns the grabs needed for the bindings of the current mode (sorted and
+ * without duplicates), see grab_all_keys().
+ *
+ */
+static struct key_grab *get_key_grabs(bool bind_mode_switch, int *num) {
+    struct key_grab *grabs = NULL;
+    *num = 0;
+    Binding *bind;
+    TAILQ_FOREACH(bind, bindings, bindings) {
+        if ((bind_mode_switch && (bind->mods & BIND_MODE_SWITCH) == 0) ||
+            (!bind_mode_switch && (bind->mods & BIND_MODE_SWITCH) != 0))
+            continue;
+
+        add_grabs_for_binding(bind, &grabs, num);
+    }
+    *num = unique_key_grabs(grabs, *num);
+    return grabs;
+}
+
+static void grab_key(xcb_connection_t *conn, const struct key_grab *grab) {
+    DLOG("Grabbing %d with modifiers %d\n", grab->keycode, grab->mods);
+    xcb_grab_key(conn, 0, root, grab->mods, grab->keycode,
+                 XCB_GRAB_MODE_SYNC, XCB_GRAB_MODE_ASYNC);
+}
+
+/*
+ * The bindings of the current mode, indexed by keycode (in the same order as
+ * in the bindings TAILQ), so that get_binding() only needs to look at the few
+ * bindings which can match the keycode of the event. Rebuilt by
+ * translate_keysyms(), which is called whenever the bindings or the keyboard
+ * mapping change.
+ *
+ */
+struct binding_list {
+    Binding **bindings;
+    int num;
+};
+static struct binding_list binding_table[256];
+
+/* The bindings which get_binding() put into state
+ * B_UPON_KEYRELEASE_IGNORE_MODS, to be reset on the next KeyPress. */
+static Binding **ignore_mods_bindings;
+static int num_ignore_mods_bindings;
+
+static void binding_list_add(struct binding_list *list, Binding *bind) {
+    list->bindings = srealloc(list->bindings, (list->num + 1) * sizeof(Binding*));
+    list->bindings[list->num++] = bind;
+}
+
+/*
+ * Rebuilds binding_table from the bindings of the current mode.
+ *
+ */
+static void rebuild_binding_table(void) {
+    for (int i = 0; i < 256; i++) {
+        FREE(binding_table[i].bindings);
+        binding_table[i].num = 0;
+    }
+
+    /* The bindings in ignore_mods_bindings may already have been freed (on
+     * reload), so we reset the state of the current bindings instead, just
+     * like the next KeyPress would. */
+    FREE(ignore_mods_bindings);
+    num_ignore_mods_bindings = 0;
+
+    Binding *bind;
+    TAILQ_FOREACH(bind, bindings, bindings) {
+        if (bind->release == B_UPON_KEYRELEASE_IGNORE_MODS)
+            bind->release = B_UPON_KEYRELEASE;
+
+        if (bind->keycode > 0) {
+            binding_list_add(&binding_table[bind->keycode], bind);
+            continue;
+        }
+
+        for (uint32_t i = 0; i < bind->number_keycodes; i++)
+            binding_list_add(&binding_table[bind->translated_to[i]], bind);
+    }
 }
 
 /*
@@ -56,18 +179,22 @@ static void grab_keycode_for_binding(xcb_connection_t *conn, Binding *bind, uint
  *
  */
 Binding *get_binding(uint16_t modifiers, bool key_release, xcb_keycode_t keycode) {
-    Binding *bind;
+    Binding *bind = NULL;
 
     if (!key_release) {
         /* On a KeyPress event, we first reset all
          * B_UPON_KEYRELEASE_IGNORE_MODS bindings back to B_UPON_KEYRELEASE */
-        TAILQ_FOREACH(bind, bindings, bindings) {
-            if (bind->release == B_UPON_KEYRELEASE_IGNORE_MODS)
-                bind->release = B_UPON_KEYRELEASE;
+        for (int i = 0; i < num_ignore_mods_bindings; i++) {
+            if (ignore_mods_bindings[i]->release == B_UPON_KEYRELEASE_IGNORE_MODS)
+                ignore_mods_bindings[i]->release = B_UPON_KEYRELEASE;
         }
+        num_ignore_mods_bindings = 0;
     }
 
-    TAILQ_FOREACH(bind, bindings, bindings) {
+    struct binding_list *list = &binding_table[keycode];
+    for (int i = 0; i < list->num; i++) {
+        bind = list->bindings[i];
+
         /* First compare the modifiers (unless this is a
          * B_UPON_KEYRELEASE_IGNORE_MODS binding and this is a KeyRelease
          * event) */
@@ -76,36 +203,84 @@ Binding *get_binding(uint16_t modifiers, bool key_release, xcb_keycode_t keycode
              !key_release))
             continue;
 
-        /* If a symbol was specified by the user, we need to look in
-         * the array of translated keycodes for the event’s keycode */
-        if (bind->symbol != NULL) {
-            if (memmem(bind->translated_to,
-                       bind->number_keycodes * sizeof(xcb_keycode_t),
-                       &keycode, sizeof(xcb_keycode_t)) == NULL)
-                continue;
-        } else {
-            /* This case is easier: The user specified a keycode */
-            if (bind->keycode != keycode)
-                continue;
-        }
-
         /* If this keybinding is a KeyRelease binding, it matches the key which
          * the user pressed. We therefore mark it as
          * B_UPON_KEYRELEASE_IGNORE_MODS for later, so that the user can
          * release the modifiers before the actual key and the KeyRelease will
          * still be matched. */
-        if (bind->release == B_UPON_KEYRELEASE && !key_release)
+        if (bind->release == B_UPON_KEYRELEASE && !key_release) {
             bind->release = B_UPON_KEYRELEASE_IGNORE_MODS;
+            ignore_mods_bindings = srealloc(ignore_mods_bindings,
+                                            (num_ignore_mods_bindings + 1) * sizeof(Binding*));
+            ignore_mods_bindings[num_ignore_mods_bindings++] = bind;
+        }
 
         /* Check if the binding is for a KeyPress or a KeyRelease event */
         if ((bind->release == B_UPON_KEYPRESS && key_release) ||
             (bind->release >= B_UPON_KEYRELEASE && !key_release))
             continue;
 
-        break;
+        return bind;
     }
 
-    return (bind == TAILQ_END(bindings) ? NULL : bind);
+    return NULL;
+}
+
+/*
+ * The keycodes of every keysym in the current keyboard mapping, so that
+ * translate_keysyms() does not need to look at every keycode for every
+ * binding. Sorted by keysym, then group, then keycode. The group is 0 for the
+ * first two columns of the mapping and 1 for the mode_switch columns (2 and
+ * 3). Rebuilt on the first translate_keysyms() after
+ * invalidate_keysym_map().
+ *
+ */
+struct keysym_map_entry {
+    xcb_keysym_t keysym;
+    uint8_t group;
+    xcb_keycode_t keycode;
+};
+static struct keysym_map_entry *keysym_map;
+static int keysym_map_num;
+static bool keysym_map_valid;
+
+static int keysym_map_entry_cmp(const void *a, const void *b) {
+    const struct keysym_map_entry *first = a, *second = b;
+    if (first->keysym != second->keysym)
+        return (first->keysym < second->keysym ? -1 : 1);
+    if (first->group != second->group)
+        return first->group - second->group;
+    return first->keycode - second->keycode;
+}
+
+static void build_keysym_map(void) {
+    const xcb_keycode_t min_keycode = xcb_get_setup(conn)->min_keycode,
+                        max_keycode = xcb_get_setup(conn)->max_keycode;
+
+    keysym_map = srealloc(keysym_map, sizeof(struct keysym_map_entry) * 4 * (max_keycode - min_keycode + 1));
+    keysym_map_num = 0;
+    for (xcb_keycode_t i = min_keycode; i && i <= max_keycode; i++) {
+        for (int col = 0; col < 4; col++) {
+            xcb_keysym_t keysym = xcb_key_symbols_get_keysym(keysyms, i, col);
+            if (keysym == XCB_NO_SYMBOL)
+                continue;
+            /* Both columns of a group often contain the same keysym. */
+            if ((col % 2) == 1 && keysym == xcb_key_symbols_get_keysym(keysyms, i, col - 1))
+                continue;
+            keysym_map[keysym_map_num++] = (struct keysym_map_entry){ keysym, col / 2, i };
+        }
+    }
+    qsort(keysym_map, keysym_map_num, sizeof(struct keysym_map_entry), keysym_map_entry_cmp);
+    keysym_map_valid = true;
+}
+
+/*
+ * Makes the next translate_keysyms() look at the keyboard mapping again.
+ * Needs to be called whenever the keyboard mapping changes.
+ *
+ */
+void invalidate_keysym_map(void) {
+    keysym_map_valid = false;
 }
 
 /*
@@ -115,10 +290,9 @@ Binding *get_binding(uint16_t modifiers, bool key_release, xcb_keycode_t keycode
 void translate_keysyms(void) {
     Binding *bind;
     xcb_keysym_t keysym;
-    int col;
-    xcb_keycode_t i,
-                  min_keycode = xcb_get_setup(conn)->min_keycode,
-                  max_keycode = xcb_get_setup(conn)->max_keycode;
+
+    if (!keysym_map_valid)
+        build_keysym_map();
 
     TAILQ_FOREACH(bind, bindings, bindings) {
         if (bind->keycode > 0)
@@ -132,29 +306,43 @@ void translate_keysyms(void) {
             continue;
         }
 
-        /* Base column we use for looking up key symbols. We always consider
-         * the base column and the corresponding shift column, so without
-         * mode_switch, we look in 0 and 1, with mode_switch we look in 2 and
-         * 3. */
-        col = (bind->mods & BIND_MODE_SWITCH ? 2 : 0);
+        /* We always consider the base column and the corresponding shift
+         * column, so without mode_switch, we look in 0 and 1 (group 0), with
+         * mode_switch we look in 2 and 3 (group 1). */
+        const struct keysym_map_entry key = {
+            keysym, (bind->mods & BIND_MODE_SWITCH ? 1 : 0), 0
+        };
 
         FREE(bind->translated_to);
         bind->number_keycodes = 0;
 
-        for (i = min_keycode; i && i <= max_keycode; i++) {
-            if ((xcb_key_symbols_get_keysym(keysyms, i, col) != keysym) &&
-                (xcb_key_symbols_get_keysym(keysyms, i, col+1) != keysym))
-                continue;
-            bind->number_keycodes++;
-            bind->translated_to = srealloc(bind->translated_to,
-                                           (sizeof(xcb_keycode_t) *
-                                            bind->number_keycodes));
-            bind->translated_to[bind->number_keycodes-1] = i;
+        /* Find the first entry for keysym and group (keycode 0 is never
+         * used, so it sorts before all of them). */
+        int lo = 0, hi = keysym_map_num;
+        while (lo < hi) {
+            int mid = lo + (hi - lo) / 2;
+            if (keysym_map_entry_cmp(&keysym_map[mid], &key) < 0)
+                lo = mid + 1;
+            else hi = mid;
+        }
+        int end = lo;
+        while (end < keysym_map_num &&
+               keysym_map[end].keysym == key.keysym &&
+               keysym_map[end].group == key.group)
+            end++;
+
+        if (end > lo) {
+            bind->number_keycodes = end - lo;
+            bind->translated_to = smalloc(sizeof(xcb_keycode_t) * bind->number_keycodes);
+            for (int c = lo; c < end; c++)
+                bind->translated_to[c - lo] = keysym_map[c].keycode;
         }
 
         DLOG("Translated symbol \"%s\" to %d keycode\n", bind->symbol,
              bind->number_keycodes);
     }
+
+    rebuild_binding_table();
 }
 
 /*
@@ -162,22 +350,54 @@ void translate_keysyms(void) {
  *
  */
 void grab_all_keys(xcb_connection_t *conn, bool bind_mode_switch) {
-    Binding *bind;
-    TAILQ_FOREACH(bind, bindings, bindings) {
-        if ((bind_mode_switch && (bind->mods & BIND_MODE_SWITCH) == 0) ||
-            (!bind_mode_switch && (bind->mods & BIND_MODE_SWITCH) != 0))
-            continue;
+    int num;
+    struct key_grab *grabs = get_key_grabs(bind_mode_switch, &num);
+    for (int i = 0; i < num; i++)
+        grab_key(conn, &grabs[i]);
+
+    grabbed_keys = srealloc(grabbed_keys, sizeof(struct key_grab) * (num_grabbed_keys + num));
+    memcpy(grabbed_keys + num_grabbed_keys, grabs, sizeof(struct key_grab) * num);
+    num_grabbed_keys = unique_key_grabs(grabbed_keys, num_grabbed_keys + num);
+    free(grabs);
+}
 
-        /* The easy case: the user specified a keycode directly. */
-        if (bind->keycode > 0) {
-            grab_keycode_for_binding(conn, bind, bind->keycode);
-            continue;
+/*
+ * Changes the key grabs to what ungrab_all_keys() followed by
+ * grab_all_keys(conn, bind_mode_switch) would result in, but only ungrabs
+ * the keys which are no longer bound and only grabs the newly bound ones.
+ * This avoids a window in which no keys are grabbed and only sends a few
+ * requests if the bindings barely changed (e.g. on reload, when switching
+ * modes or when the keyboard mapping changes).
+ *
+ */
+void update_key_grabs(xcb_connection_t *conn, bool bind_mode_switch) {
+    int num;
+    struct key_grab *grabs = get_key_grabs(bind_mode_switch, &num);
+
+    int old = 0, new = 0;
+    while (old < num_grabbed_keys || new < num) {
+        int cmp;
+        if (old == num_grabbed_keys)
+            cmp = 1;
+        else if (new == num)
+            cmp = -1;
+        else cmp = key_grab_cmp(&grabbed_keys[old], &grabs[new]);
+
+        if (cmp < 0) {
+            xcb_ungrab_key(conn, grabbed_keys[old].keycode, root, grabbed_keys[old].mods);
+            old++;
+        } else if (cmp > 0) {
+            grab_key(conn, &grabs[new]);
+            new++;
+        } else {
+            old++;
+            new++;
         }
-
-        xcb_keycode_t *walk = bind->translated_to;
-        for (int i = 0; i < bind->number_keycodes; i++)
-            grab_keycode_for_binding(conn, bind, *walk++);
     }
+
+    free(grabbed_keys);
+    grabbed_keys = grabs;
+    num_grabbed_keys = num;
 }
 
 /*
@@ -193,10 +413,9 @@ void switch_mode(const char *new_mode) {
         if (strcasecmp(mode->name, new_mode) != 0)
             continue;
 
-        ungrab_all_keys(conn);
         bindings = mode->bindings;
         translate_keysyms();
-        grab_all_keys(conn, false);
+        update_key_grabs(conn, false);
 
         char *event_msg;
         sasprintf(&event_msg, "{\"change\":\"%s\"}", mode->name);
@@ -210,6 +429,46 @@ void switch_mode(const char *new_mode) {
     ELOG("ERROR: Mode not found\n");
 }
 
+/*
+ * Sends the hidden_state and mode of the given bar as a barconfig_update
+ * event.
+ *
+ */
+static void send_barconfig_update(Barconfig *current) {
+    /* Build json message */
+    char *hidden_state;
+    switch (current->hidden_state) {
+        case S_SHOW:
+            hidden_state ="show";
+            break;
+        case S_HIDE:
+        default:
+            hidden_state = "hide";
+            break;
+    }
+
+    char *mode;
+    switch (current->mode) {
+        case M_HIDE:
+            mode ="hide";
+            break;
+        case M_INVISIBLE:
+            mode ="invisible";
+            break;
+        case M_DOCK:
+        default:
+            mode = "dock";
+            break;
+    }
+
+    /* Send an event to all barconfig listeners*/
+    char *event_msg;
+    sasprintf(&event_msg, "{ \"id\":\"%s\", \"hidden_state\":\"%s\", \"mode\":\"%s\" }", current->id, hidden_state, mode);
+
+    ipc_send_event("barconfig_update", I3_IPC_EVENT_BARCONFIG_UPDATE, event_msg);
+    FREE(event_msg);
+}
+
 /*
  * Sends the current bar configuration as an event to all barconfig_update listeners.
  * This update mechnism currently only includes the hidden_state and the mode in the config.
@@ -217,40 +476,57 @@ void switch_mode(const char *new_mode) {
  */
 void update_barconfig() {
     Barconfig *current;
-    TAILQ_FOREACH(current, &barconfigs, configs) {
-        /* Build json message */
-        char *hidden_state;
-        switch (current->hidden_state) {
-            case S_SHOW:
-                hidden_state ="show";
-                break;
-            case S_HIDE:
-            default:
-                hidden_state = "hide";
-                break;
-        }
-
-        char *mode;
-        switch (current->mode) {
-            case M_HIDE:
-                mode ="hide";
-                break;
-            case M_INVISIBLE:
-                mode ="invisible";
-                break;
-            case M_DOCK:
-            default:
-                mode = "dock";
-                break;
-        }
+    TAILQ_FOREACH(current, &barconfigs, configs)
+        send_barconfig_update(current);
+}
 
-        /* Send an event to all barconfig listeners*/
-        char *event_msg;
-        sasprintf(&event_msg, "{ \"id\":\"%s\", \"hidden_state\":\"%s\", \"mode\":\"%s\" }", current->id, hidden_state, mode);
+static bool str_equal(const char *a, const char *b) {
+    if (a == NULL || b == NULL)
+        return (a == b);
+    return (strcmp(a, b) == 0);
+}
 
-        ipc_send_event("barconfig_update", I3_IPC_EVENT_BARCONFIG_UPDATE, event_msg);
-        FREE(event_msg);
-    }
+/*
+ * Returns true if one i3bar process can serve both bars (see shared_i3bar):
+ * their configuration must be the same, except for the id and the outputs,
+ * which must be explicitly set and must not overlap.
+ *
+ */
+bool barconfig_can_share_process(Barconfig *a, Barconfig *b) {
+    /* A bar on all outputs would take over the outputs of the other one. */
+    if (a->num_outputs == 0 || b->num_outputs == 0)
+        return false;
+    for (int i = 0; i < a->num_outputs; i++)
+        for (int j = 0; j < b->num_outputs; j++)
+            if (strcasecmp(a->outputs[i], b->outputs[j]) == 0)
+                return false;
+
+    if (a->mode != b->mode ||
+        a->hidden_state != b->hidden_state ||
+        a->modifier != b->modifier ||
+        a->position != b->position ||
+        a->hide_workspace_buttons != b->hide_workspace_buttons ||
+        a->hide_binding_mode_indicator != b->hide_binding_mode_indicator ||
+        a->verbose != b->verbose ||
+        a->status_refresh_rate != b->status_refresh_rate ||
+        a->client_side_rendering != b->client_side_rendering ||
+        a->glyph_cache != b->glyph_cache)
+        return false;
+
+#define SAME(field) str_equal(a->field, b->field)
+    return SAME(tray_output) && SAME(socket_path) && SAME(i3bar_command) &&
+           SAME(status_command) && SAME(font) &&
+           SAME(colors.background) && SAME(colors.statusline) &&
+           SAME(colors.separator) &&
+           SAME(colors.focused_workspace_border) && SAME(colors.focused_workspace_bg) &&
+           SAME(colors.focused_workspace_text) &&
+           SAME(colors.active_workspace_border) && SAME(colors.active_workspace_bg) &&
+           SAME(colors.active_workspace_text) &&
+           SAME(colors.inactive_workspace_border) && SAME(colors.inactive_workspace_bg) &&
+           SAME(colors.inactive_workspace_text) &&
+           SAME(colors.urgent_workspace_border) && SAME(colors.urgent_workspace_bg) &&
+           SAME(colors.urgent_workspace_text);
+#undef SAME
 }
 
 /*
@@ -340,10 +616,18 @@ static void parse_configuration(const char *override_configpath) {
  *
  */
 void load_configuration(xcb_connection_t *conn, const char *override_configpath, bool reload) {
-    if (reload) {
-        /* First ungrab the keys */
-        ungrab_all_keys(conn);
+    /* The state of the bars before the reload, so that barconfig_update
+     * events are only sent for the bars whose state actually changes. */
+    struct bar_state {
+        char *id;
+        int mode;
+        int hidden_state;
+    } *old_bars = NULL;
+    int num_old_bars = 0;
 
+    if (reload) {
+        /* The keys stay grabbed, update_key_grabs() only changes the grabs
+         * of the bindings which differ once the new config is loaded. */
         struct Mode *mode;
         Binding *bind;
         while (!SLIST_EMPTY(&modes)) {
@@ -357,6 +641,7 @@ void load_configuration(xcb_connection_t *conn, const char *override_configpath,
                 TAILQ_REMOVE(bindings, bind, bindings);
                 FREE(bind->translated_to);
                 FREE(bind->command);
+                free_compiled_command(bind->compiled);
                 FREE(bind);
             }
             FREE(bindings);
@@ -381,7 +666,11 @@ void load_configuration(xcb_connection_t *conn, const char *override_configpath,
         Barconfig *barconfig;
         while (!TAILQ_EMPTY(&barconfigs)) {
             barconfig = TAILQ_FIRST(&barconfigs);
-            FREE(barconfig->id);
+            old_bars = srealloc(old_bars, sizeof(struct bar_state) * (num_old_bars + 1));
+            old_bars[num_old_bars++] = (struct bar_state){
+                barconfig->id, barconfig->mode, barconfig->hidden_state
+            };
+            barconfig->id = NULL;
             for (int c = 0; c < barconfig->num_outputs; c++)
                 free(barconfig->outputs[c]);
             FREE(barconfig->outputs);
@@ -419,6 +708,11 @@ void load_configuration(xcb_connection_t *conn, const char *override_configpath,
         Con *con;
         TAILQ_FOREACH(con, &all_cons, all_cons)
             FREE(con->deco_render_params);
+        x_deco_cache_flush();
+
+        /* The font (and thus the decoration height) and the default borders
+         * may have changed, so all geometry needs to be recomputed. */
+        con_mark_all_dirty();
 
         /* Get rid of the current font */
         free_font();
@@ -467,15 +761,38 @@ void load_configuration(xcb_connection_t *conn, const char *override_configpath,
     /* Set default_orientation to NO_ORIENTATION for auto orientation. */
     config.default_orientation = NO_ORIENTATION;
 
+    /* Disconnect IPC clients with more than 4 MiB of unread output */
+    config.ipc_buffer_limit = 4 * 1024 * 1024;
+
     /* Set default urgency reset delay to 500ms */
     if (config.workspace_urgency_timer == 0)
         config.workspace_urgency_timer = 0.5;
 
     parse_configuration(override_configpath);
+    assignments_rebuild_index();
+    set_font_glyph_cache(config.glyph_cache);
 
     if (reload) {
         translate_keysyms();
-        grab_all_keys(conn, false);
+        update_key_grabs(conn, false);
+
+        Barconfig *barconfig;
+        TAILQ_FOREACH(barconfig, &barconfigs, configs) {
+            bool changed = true;
+            for (int c = 0; c < num_old_bars; c++) {
+                if (strcmp(old_bars[c].id, barconfig->id) != 0)
+                    continue;
+                changed = (old_bars[c].mode != barconfig->mode ||
+                           old_bars[c].hidden_state != barconfig->hidden_state);
+                break;
+            }
+            if (changed)
+                send_barconfig_update(barconfig);
+        }
+
+        for (int c = 0; c < num_old_bars; c++)
+            free(old_bars[c].id);
+        FREE(old_bars);
     }
 
     if (config.font.type == FONT_TYPE_NONE) {
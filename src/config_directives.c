@@ -184,6 +184,7 @@ CFGFUN(binding, const char *bindtype, const char *modifiers, const char *key, co
     }
     new_binding->mods = modifiers_from_str(modifiers);
     new_binding->command = sstrdup(command);
+    new_binding->compiled = compile_command(command);
     TAILQ_INSERT_TAIL(bindings, new_binding, bindings);
 }
 
@@ -210,6 +211,7 @@ CFGFUN(mode_binding, const char *bindtype, const char *modifiers, const char *ke
     }
     new_binding->mods = modifiers_from_str(modifiers);
     new_binding->command = sstrdup(command);
+    new_binding->compiled = compile_command(command);
     TAILQ_INSERT_TAIL(current_bindings, new_binding, bindings);
 }
 
@@ -342,6 +344,10 @@ CFGFUN(workspace_back_and_forth, const char *value) {
     config.workspace_auto_back_and_forth = eval_boolstr(value);
 }
 
+CFGFUN(config_cache, const char *value) {
+    config.config_cache = eval_boolstr(value);
+}
+
 CFGFUN(fake_outputs, const char *outputs) {
     config.fake_outputs = sstrdup(outputs);
 }
@@ -350,6 +356,10 @@ CFGFUN(force_display_urgency_hint, const long duration_ms) {
     config.workspace_urgency_timer = duration_ms / 1000.0;
 }
 
+CFGFUN(screen_change_delay, const long delay_ms) {
+    config.screen_change_delay = (delay_ms > 0 ? delay_ms / 1000.0 : 0);
+}
+
 CFGFUN(workspace, const char *workspace, const char *output) {
     DLOG("Assigning workspace \"%s\" to output \"%s\"\n", workspace, output);
     /* Check for earlier assignments of the same workspace so that we
@@ -377,6 +387,22 @@ CFGFUN(ipc_socket, const char *path) {
     config.ipc_socket_path = sstrdup(path);
 }
 
+CFGFUN(ipc_buffer_limit, const long size_kb) {
+    config.ipc_buffer_limit = (size_kb > 0 ? size_kb * 1024 : 0);
+}
+
+CFGFUN(ipc_thread, const char *value) {
+    config.ipc_thread = eval_boolstr(value);
+}
+
+CFGFUN(glyph_cache, const char *value) {
+    config.glyph_cache = eval_boolstr(value);
+}
+
+CFGFUN(shared_i3bar, const char *value) {
+    config.shared_i3bar = eval_boolstr(value);
+}
+
 CFGFUN(restart_state, const char *path) {
     config.restart_state_path = sstrdup(path);
 }
@@ -391,6 +417,18 @@ CFGFUN(popup_during_fullscreen, const char *value) {
     }
 }
 
+CFGFUN(tiling_resize, const char *value) {
+    if (strcmp(value, "live") == 0)
+        config.tiling_resize = TR_LIVE;
+    else config.tiling_resize = TR_OUTLINE;
+}
+
+CFGFUN(floating_move, const char *value) {
+    if (strcmp(value, "outline") == 0)
+        config.floating_move = FM_OUTLINE;
+    else config.floating_move = FM_OPAQUE;
+}
+
 CFGFUN(color_single, const char *colorclass, const char *color) {
     /* used for client.background only currently */
     config.client.background = get_colorpixel(color);
@@ -464,6 +502,18 @@ CFGFUN(bar_verbose, const char *verbose) {
     current_bar.verbose = eval_boolstr(verbose);
 }
 
+CFGFUN(bar_status_refresh_rate, const long rate) {
+    current_bar.status_refresh_rate = rate;
+}
+
+CFGFUN(bar_client_side_rendering, const char *value) {
+    current_bar.client_side_rendering = eval_boolstr(value);
+}
+
+CFGFUN(bar_glyph_cache, const char *value) {
+    current_bar.glyph_cache = eval_boolstr(value);
+}
+
 CFGFUN(bar_modifier, const char *modifier) {
     if (strcmp(modifier, "Mod1") == 0)
         current_bar.modifier = M_MOD1;
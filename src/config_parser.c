@@ -35,6 +35,7 @@
 #include <sys/wait.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <ctype.h>
 
 #include "all.h"
 
@@ -65,15 +66,38 @@ typedef struct token {
     union {
         uint16_t call_identifier;
     } extra;
+    /* The length of a literal (without the leading quote) */
+    int length;
 } cmdp_token;
 
 typedef struct tokenptr {
     cmdp_token *array;
     int n;
+    /* The distinct (lowercase) first characters of the literals */
+    const char *first_chars;
+    /* For every character in first_chars, the indexes of the tokens which can
+     * match input starting with it, terminated by -1 */
+    const int **candidates;
+    /* The indexes of the tokens which are not literals (they can match any
+     * input), terminated by -1 */
+    const int *others;
 } cmdp_token_ptr;
 
 #include "GENERATED_config_tokens.h"
 
+/*
+ * Returns the indexes of the tokens of the given state which need to be tried
+ * for input starting with the given character, in the order in which they
+ * are specified. This saves comparing the input to every literal.
+ *
+ */
+static const int *candidate_tokens(const cmdp_token_ptr *ptr, char next) {
+    const char *pos = NULL;
+    if (next != '\0')
+        pos = strchr(ptr->first_chars, tolower((unsigned char)next));
+    return (pos == NULL ? ptr->others : ptr->candidates[pos - ptr->first_chars]);
+}
+
 /*******************************************************************************
  * The (small) stack where identified literals are stored during the parsing
  * of a single command (like $workspace).
@@ -246,6 +270,47 @@ static int statelist_idx = 1;
 
 #include "GENERATED_config_call.h"
 
+#ifndef TEST_PARSER
+/* While parse_file() parses a config file, every call is recorded in here
+ * (with the identified literals it uses), so that the config cache can
+ * replay them, see write_config_cache(). */
+struct config_recording {
+    char *data;
+    size_t length;
+    size_t capacity;
+};
+static struct config_recording *recording;
+
+static void record_bytes(const void *data, size_t length) {
+    if (recording->length + length > recording->capacity) {
+        recording->capacity = (recording->capacity + length) * 2;
+        recording->data = srealloc(recording->data, recording->capacity);
+    }
+    memcpy(recording->data + recording->length, data, length);
+    recording->length += length;
+}
+
+/*
+ * Appends the call with the given identifier and the current stack to the
+ * recording.
+ *
+ */
+static void record_call(uint16_t call_identifier) {
+    uint8_t num_args = 0;
+    while (num_args < 10 && stack[num_args].identifier != NULL)
+        num_args++;
+    record_bytes(&call_identifier, sizeof(call_identifier));
+    record_bytes(&num_args, sizeof(num_args));
+    for (int c = 0; c < num_args; c++) {
+        const uint8_t type = stack[c].type;
+        record_bytes(stack[c].identifier, strlen(stack[c].identifier) + 1);
+        record_bytes(&type, sizeof(type));
+        if (stack[c].type == STACK_STR)
+            record_bytes(stack[c].val.str, strlen(stack[c].val.str) + 1);
+        else record_bytes(&(stack[c].val.num), sizeof(long));
+    }
+}
+#endif
 
 static void next_state(const cmdp_token *token) {
     cmdp_state _next_state = token->next_state;
@@ -253,6 +318,10 @@ static void next_state(const cmdp_token *token) {
 	//printf("token = name %s identifier %s\n", token->name, token->identifier);
 	//printf("next_state = %d\n", token->next_state);
     if (token->next_state == __CALL) {
+#ifndef TEST_PARSER
+        if (recording != NULL)
+            record_call(token->extra.call_identifier);
+#endif
         subcommand_output.json_gen = command_output.json_gen;
         GENERATED_call(token->extra.call_identifier, &subcommand_output);
         _next_state = subcommand_output.next_state;
@@ -356,15 +425,15 @@ struct ConfigResult *parse_config(const char *input, struct context *context) {
 
         cmdp_token_ptr *ptr = &(tokens[state]);
         token_handled = false;
-        for (c = 0; c < ptr->n; c++) {
-            token = &(ptr->array[c]);
+        for (const int *candidate = candidate_tokens(ptr, *walk); *candidate != -1; candidate++) {
+            token = &(ptr->array[*candidate]);
 
             /* A literal. */
             if (token->name[0] == '\'') {
-                if (strncasecmp(walk, token->name + 1, strlen(token->name) - 1) == 0) {
+                if (strncasecmp(walk, token->name + 1, token->length) == 0) {
                     if (token->identifier != NULL)
                         push_string(token->identifier, token->name + 1);
-                    walk += strlen(token->name) - 1;
+                    walk += token->length;
                     next_state(token);
                     token_handled = true;
                     break;
@@ -892,17 +961,328 @@ static void check_for_duplicate_bindings(struct context *context) {
     }
 }
 
+/*******************************************************************************
+ * The config cache (see the config_cache directive): If enabled, the calls
+ * which parsing the config file resulted in are stored in
+ * $XDG_CACHE_HOME/i3/, so that the next time the same file is loaded, they
+ * can be replayed without substituting variables and running the parser.
+ ******************************************************************************/
+
+static const char config_cache_magic[] = "i3-config-cache";
+
+static uint64_t fnv1a(uint64_t hash, const void *data, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        hash ^= ((const unsigned char *)data)[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+/*
+ * Returns a hash of everything a cache file depends on apart from the config
+ * file itself: the i3 version and the calls of the parser (the call
+ * identifiers change whenever parser-specs/config.spec is changed).
+ *
+ */
+static uint64_t config_cache_abi(void) {
+    uint64_t hash = fnv1a(0xcbf29ce484222325ULL, I3_VERSION, strlen(I3_VERSION));
+    const size_t num_calls = sizeof(GENERATED_call_name) / sizeof(GENERATED_call_name[0]);
+    for (size_t i = 0; i < num_calls; i++)
+        hash = fnv1a(hash, GENERATED_call_name[i], strlen(GENERATED_call_name[i]) + 1);
+    return hash;
+}
+
+/*
+ * Returns the path of the cache file for the given config file. The caller
+ * has to free() the result.
+ *
+ */
+static char *get_config_cache_path(const char *config_path) {
+    char *dir;
+    const char *xdg_cache_home = getenv("XDG_CACHE_HOME");
+    if (xdg_cache_home != NULL)
+        dir = sstrdup(xdg_cache_home);
+    else dir = resolve_tilde("~/.cache");
+
+    char *path;
+    const uint64_t hash = fnv1a(0xcbf29ce484222325ULL, config_path, strlen(config_path));
+    sasprintf(&path, "%s/i3/config-%016llx", dir, (unsigned long long)hash);
+    free(dir);
+    return path;
+}
+
+/*
+ * Writes the recorded calls to the cache file, replacing it atomically.
+ *
+ */
+static void write_config_cache(const char *cache_path, uint64_t config_hash,
+                               const struct config_recording *calls) {
+    /* Create the directory (and its parent) if necessary. */
+    char *dir = sstrdup(cache_path);
+    char *slash = strrchr(dir, '/');
+    *slash = '\0';
+    slash = strrchr(dir, '/');
+    *slash = '\0';
+    mkdir(dir, 0700);
+    *slash = '/';
+    mkdir(dir, 0700);
+    free(dir);
+
+    char *tmp_path;
+    sasprintf(&tmp_path, "%s.%d", cache_path, getpid());
+    FILE *f = fopen(tmp_path, "w");
+    if (f == NULL) {
+        ELOG("Could not write the config cache %s: %s\n", tmp_path, strerror(errno));
+        free(tmp_path);
+        return;
+    }
+
+    const uint64_t abi = config_cache_abi();
+    bool ok = (fwrite(config_cache_magic, sizeof(config_cache_magic), 1, f) == 1 &&
+               fwrite(&abi, sizeof(abi), 1, f) == 1 &&
+               fwrite(&config_hash, sizeof(config_hash), 1, f) == 1 &&
+               (calls->length == 0 || fwrite(calls->data, calls->length, 1, f) == 1));
+    ok = (fclose(f) == 0 && ok);
+    if (ok && rename(tmp_path, cache_path) == 0)
+        DLOG("Wrote config cache %s (%zu bytes of calls)\n", cache_path, calls->length);
+    else {
+        ELOG("Could not write the config cache %s: %s\n", tmp_path, strerror(errno));
+        unlink(tmp_path);
+    }
+    free(tmp_path);
+}
+
+/*
+ * Replays the calls stored in the given cache file if it was written for a
+ * config file with the given hash (and by this version of i3). Returns false
+ * if the cache cannot be used, in which case nothing was changed.
+ *
+ */
+static bool load_config_cache(const char *cache_path, uint64_t config_hash) {
+    int fd = open(cache_path, O_RDONLY);
+    if (fd == -1)
+        return false;
+
+    struct stat stbuf;
+    const size_t header_size = sizeof(config_cache_magic) + 2 * sizeof(uint64_t);
+    if (fstat(fd, &stbuf) == -1 || (size_t)stbuf.st_size < header_size) {
+        close(fd);
+        return false;
+    }
+
+    char *data = smalloc(stbuf.st_size);
+    ssize_t read_bytes = 0, ret;
+    while (read_bytes < stbuf.st_size &&
+           (ret = read(fd, data + read_bytes, stbuf.st_size - read_bytes)) > 0)
+        read_bytes += ret;
+    close(fd);
+
+    uint64_t abi, hash;
+    memcpy(&abi, data + sizeof(config_cache_magic), sizeof(abi));
+    memcpy(&hash, data + sizeof(config_cache_magic) + sizeof(abi), sizeof(hash));
+    if (read_bytes != stbuf.st_size ||
+        memcmp(data, config_cache_magic, sizeof(config_cache_magic)) != 0 ||
+        abi != config_cache_abi() ||
+        hash != config_hash) {
+        DLOG("Config cache %s is outdated\n", cache_path);
+        free(data);
+        return false;
+    }
+
+    /* Check that the calls are complete before replaying any of them. */
+    const char *end = data + stbuf.st_size;
+    const char *walk = data + header_size;
+    while (walk < end) {
+        uint16_t call_identifier;
+        uint8_t num_args;
+        if ((size_t)(end - walk) < sizeof(call_identifier) + sizeof(num_args))
+            break;
+        memcpy(&call_identifier, walk, sizeof(call_identifier));
+        walk += sizeof(call_identifier);
+        num_args = *(const uint8_t *)walk++;
+        if (call_identifier >= sizeof(GENERATED_call_name) / sizeof(GENERATED_call_name[0]) ||
+            num_args > 10)
+            break;
+        for (int c = 0; c < num_args && walk < end; c++) {
+            const char *nul = memchr(walk, '\0', end - walk);
+            if (nul == NULL || nul + 1 == end) {
+                walk = end + 1;
+                break;
+            }
+            const uint8_t type = *(const uint8_t *)(nul + 1);
+            walk = nul + 2;
+            if (type == STACK_STR) {
+                nul = memchr(walk, '\0', end - walk);
+                walk = (nul == NULL ? end + 1 : nul + 1);
+            } else walk += sizeof(long);
+        }
+        if (walk > end)
+            break;
+    }
+    if (walk != end) {
+        ELOG("Config cache %s is corrupt, ignoring it\n", cache_path);
+        free(data);
+        return false;
+    }
+
+    LOG("Loading the configuration from the config cache %s\n", cache_path);
+#if YAJL_MAJOR >= 2
+    command_output.json_gen = yajl_gen_alloc(NULL);
+#else
+    command_output.json_gen = yajl_gen_alloc(NULL, NULL);
+#endif
+    cfg_criteria_init(&current_match, &subcommand_output, INITIAL);
+
+    walk = data + header_size;
+    while (walk < end) {
+        uint16_t call_identifier;
+        memcpy(&call_identifier, walk, sizeof(call_identifier));
+        walk += sizeof(call_identifier);
+        const uint8_t num_args = *(const uint8_t *)walk++;
+        for (int c = 0; c < num_args; c++) {
+            const char *identifier = walk;
+            walk += strlen(identifier) + 1;
+            const uint8_t type = *(const uint8_t *)walk++;
+            if (type == STACK_STR) {
+                push_string(identifier, walk);
+                walk += strlen(walk) + 1;
+            } else {
+                long num;
+                memcpy(&num, walk, sizeof(long));
+                push_long(identifier, num);
+                walk += sizeof(long);
+            }
+        }
+        subcommand_output.json_gen = command_output.json_gen;
+        GENERATED_call(call_identifier, &subcommand_output);
+        clear_stack();
+    }
+
+    yajl_gen_free(command_output.json_gen);
+    free(data);
+    return true;
+}
+
+/* The variables of the configuration file, hashed by their lowercased
+ * name. */
+#define VARIABLE_BUCKETS 256
+
+struct variable_table {
+    SLIST_HEAD(variables_head, Variable) variables;
+    SLIST_HEAD(variable_bucket, Variable) buckets[VARIABLE_BUCKETS];
+    int num_variables;
+    /* The distinct lengths of all variable names, in ascending order */
+    size_t *key_lengths;
+    int num_key_lengths;
+};
+
+static unsigned int variable_hash(unsigned int hash, char c) {
+    return ((hash << 5) + hash) + (unsigned char)tolower((unsigned char)c);
+}
+
+static void add_variable(struct variable_table *table, const char *key, const char *value) {
+    struct Variable *new = scalloc(sizeof(struct Variable));
+    new->key = sstrdup(key);
+    new->value = sstrdup(value);
+    new->key_length = strlen(key);
+    new->index = table->num_variables++;
+    SLIST_INSERT_HEAD(&(table->variables), new, variables);
+
+    unsigned int hash = 5381;
+    for (const char *c = key; *c != '\0'; c++)
+        hash = variable_hash(hash, *c);
+    SLIST_INSERT_HEAD(&(table->buckets[hash % VARIABLE_BUCKETS]), new, bucket);
+
+    int pos = 0;
+    while (pos < table->num_key_lengths && table->key_lengths[pos] < new->key_length)
+        pos++;
+    if (pos < table->num_key_lengths && table->key_lengths[pos] == new->key_length)
+        return;
+    table->key_lengths = srealloc(table->key_lengths, sizeof(size_t) * (table->num_key_lengths + 1));
+    memmove(table->key_lengths + pos + 1, table->key_lengths + pos,
+            sizeof(size_t) * (table->num_key_lengths - pos));
+    table->key_lengths[pos] = new->key_length;
+    table->num_key_lengths++;
+}
+
+/*
+ * Returns the variable whose name the text at walk (with remaining bytes
+ * left) starts with, or NULL. Names are compared case-insensitively. If
+ * several variables match (because one name is a prefix of another or a
+ * variable was set twice), the one which was set last wins.
+ *
+ */
+static struct Variable *match_variable(struct variable_table *table, const char *walk, size_t remaining) {
+    struct Variable *best = NULL;
+    unsigned int hash = 5381;
+    size_t hashed = 0;
+    for (int i = 0; i < table->num_key_lengths; i++) {
+        const size_t length = table->key_lengths[i];
+        if (length > remaining)
+            break;
+        while (hashed < length)
+            hash = variable_hash(hash, walk[hashed++]);
+
+        struct Variable *current;
+        SLIST_FOREACH(current, &(table->buckets[hash % VARIABLE_BUCKETS]), bucket) {
+            if (current->key_length != length ||
+                strncasecmp(current->key, walk, length) != 0)
+                continue;
+            if (best == NULL || current->index > best->index)
+                best = current;
+        }
+    }
+    return best;
+}
+
+/*
+ * Returns a copy of the given buffer in which all variables are replaced by
+ * their values. Variable names start with '$' (see parse_file()), so only
+ * those positions need to be looked up.
+ *
+ */
+static char *replace_variables(struct variable_table *table, const char *buf, size_t length) {
+    size_t capacity = length + 1, used = 0;
+    char *new = smalloc(capacity);
+    const char *walk = buf, *end = buf + length;
+    while (walk < end) {
+        const char *dollar = memchr(walk, '$', end - walk);
+        struct Variable *variable = NULL;
+        if (dollar != NULL)
+            variable = match_variable(table, dollar, end - dollar);
+        const char *copy_end = (dollar == NULL ? end : dollar + (variable == NULL));
+        size_t value_length = (variable == NULL ? 0 : strlen(variable->value));
+
+        size_t needed = used + (copy_end - walk) + value_length + 1;
+        if (needed > capacity) {
+            capacity = (needed > 2 * capacity ? needed : 2 * capacity);
+            new = srealloc(new, capacity);
+        }
+        memcpy(new + used, walk, copy_end - walk);
+        used += copy_end - walk;
+        walk = copy_end;
+        if (variable != NULL) {
+            memcpy(new + used, variable->value, value_length);
+            used += value_length;
+            walk += variable->key_length;
+        }
+    }
+    new[used] = '\0';
+    return new;
+}
+
 /*
  * Parses the given file by first replacing the variables, then calling
  * parse_config and possibly launching i3-nagbar.
  *
  */
 void parse_file(const char *f) {
-    SLIST_HEAD(variables_head, Variable) variables = SLIST_HEAD_INITIALIZER(&variables);
+    struct variable_table variables = {
+        .variables = SLIST_HEAD_INITIALIZER(&variables.variables)
+    };
     int fd, ret, read_bytes = 0;
     struct stat stbuf;
     char *buf;
-    FILE *fstr;
     char buffer[1026], key[512], value[512];
 
     if ((fd = open(f, O_RDONLY)) == -1)
@@ -917,19 +1297,29 @@ void parse_file(const char *f) {
             die("Could not read(): %s\n", strerror(errno));
         read_bytes += ret;
     }
+    close(fd);
 
-    if (lseek(fd, 0, SEEK_SET) == (off_t)-1)
-        die("Could not lseek: %s\n", strerror(errno));
-
-    if ((fstr = fdopen(fd, "r")) == NULL)
-        die("Could not fdopen: %s\n", strerror(errno));
+    const uint64_t config_hash = fnv1a(0xcbf29ce484222325ULL, buf, stbuf.st_size);
+    char *cache_path = get_config_cache_path(f);
+    if (load_config_cache(cache_path, config_hash)) {
+        free(cache_path);
+        free(buf);
+        return;
+    }
 
-    while (!feof(fstr)) {
-        if (fgets(buffer, 1024, fstr) == NULL) {
-            if (feof(fstr))
-                break;
-            die("Could not read configuration file\n");
-        }
+    /* Collect the variables from the buffer, line by line. */
+    const char *line = buf, *end = buf + stbuf.st_size;
+    while (line < end) {
+        const char *eol = memchr(line, '\n', end - line);
+        size_t length = (eol == NULL ? end : eol) - line;
+        const char *next_line = line + length + 1;
+        /* Longer lines cannot be variable assignments anyway, see key and
+         * value. */
+        if (length > 1023)
+            length = 1023;
+        memcpy(buffer, line, length);
+        buffer[length] = '\0';
+        line = next_line;
 
         /* sscanf implicitly strips whitespace. Also, we skip comments and empty lines. */
         if (sscanf(buffer, "%s %[^\n]", key, value) < 1 ||
@@ -956,70 +1346,15 @@ void parse_file(const char *f) {
             while (*v_value == '\t' || *v_value == ' ')
                 v_value++;
 
-            struct Variable *new = scalloc(sizeof(struct Variable));
-            new->key = sstrdup(v_key);
-            new->value = sstrdup(v_value);
-            SLIST_INSERT_HEAD(&variables, new, variables);
+            add_variable(&variables, v_key, v_value);
             DLOG("Got new variable %s = %s\n", v_key, v_value);
             continue;
         }
     }
-    fclose(fstr);
-
-    /* For every custom variable, see how often it occurs in the file and
-     * how much extra bytes it requires when replaced. */
-    struct Variable *current, *nearest;
-    int extra_bytes = 0;
-    /* We need to copy the buffer because we need to invalidate the
-     * variables (otherwise we will count them twice, which is bad when
-     * 'extra' is negative) */
-    char *bufcopy = sstrdup(buf);
-    SLIST_FOREACH(current, &variables, variables) {
-        int extra = (strlen(current->value) - strlen(current->key));
-        char *next;
-        for (next = bufcopy;
-             next < (bufcopy + stbuf.st_size) &&
-             (next = strcasestr(next, current->key)) != NULL;
-             next += strlen(current->key)) {
-            *next = '_';
-            extra_bytes += extra;
-        }
-    }
-    FREE(bufcopy);
-
-    /* Then, allocate a new buffer and copy the file over to the new one,
-     * but replace occurences of our variables */
-    char *walk = buf, *destwalk;
-    char *new = smalloc((stbuf.st_size + extra_bytes + 1) * sizeof(char));
-    destwalk = new;
-    while (walk < (buf + stbuf.st_size)) {
-        /* Find the next variable */
-        SLIST_FOREACH(current, &variables, variables)
-            current->next_match = strcasestr(walk, current->key);
-        nearest = NULL;
-        int distance = stbuf.st_size;
-        SLIST_FOREACH(current, &variables, variables) {
-            if (current->next_match == NULL)
-                continue;
-            if ((current->next_match - walk) < distance) {
-                distance = (current->next_match - walk);
-                nearest = current;
-            }
-        }
-        if (nearest == NULL) {
-            /* If there are no more variables, we just copy the rest */
-            strncpy(destwalk, walk, (buf + stbuf.st_size) - walk);
-            destwalk += (buf + stbuf.st_size) - walk;
-            *destwalk = '\0';
-            break;
-        } else {
-            /* Copy until the next variable, then copy its value */
-            strncpy(destwalk, walk, distance);
-            strncpy(destwalk + distance, nearest->value, strlen(nearest->value));
-            walk += distance + strlen(nearest->key);
-            destwalk += distance + strlen(nearest->value);
-        }
-    }
+
+    /* Then, copy the file over to a new buffer, replacing occurences of our
+     * variables in a single pass. */
+    char *new = replace_variables(&variables, buf, stbuf.st_size);
 
     /* analyze the string to find out whether this is an old config file (3.x)
      * or a new config file (4.x). If it’s old, we run the converter script. */
@@ -1053,11 +1388,24 @@ void parse_file(const char *f) {
     context = scalloc(sizeof(struct context));
     context->filename = f;
 
+    struct config_recording calls = { NULL, 0, 0 };
+    recording = &calls;
     struct ConfigResult *config_output = parse_config(new, context);
+    recording = NULL;
     yajl_gen_free(config_output->json_gen);
 
     check_for_duplicate_bindings(context);
 
+    /* Configs with errors or warnings are not cached, so that i3-nagbar
+     * shows up on every start until they are fixed. */
+    if (config.config_cache && version != 3 &&
+        !context->has_errors && !context->has_warnings)
+        write_config_cache(cache_path, config_hash, &calls);
+    else if (!config.config_cache && unlink(cache_path) == 0)
+        DLOG("Removed the config cache %s\n", cache_path);
+    free(calls.data);
+    free(cache_path);
+
     if (context->has_errors || context->has_warnings) {
         ELOG("FYI: You are using i3 version " I3_VERSION "\n");
         if (version == 3)
@@ -1096,13 +1444,14 @@ void parse_file(const char *f) {
     free(new);
     free(buf);
 
-    while (!SLIST_EMPTY(&variables)) {
-        current = SLIST_FIRST(&variables);
+    while (!SLIST_EMPTY(&(variables.variables))) {
+        struct Variable *current = SLIST_FIRST(&(variables.variables));
         FREE(current->key);
         FREE(current->value);
-        SLIST_REMOVE_HEAD(&variables, variables);
+        SLIST_REMOVE_HEAD(&(variables.variables), variables);
         FREE(current);
     }
+    FREE(variables.key_lengths);
 }
 
 #endif
@@ -0,0 +1,169 @@
+#undef I3__FILE__
+#define I3__FILE__ "event_record.c"
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009-2013 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * event_record.c: Records the X11 events and commands i3 handles into a
+ *                 binary file (see --record-events), which can be replayed by
+ *                 testcases/bench/400-replay-events.t.
+ *
+ * The file starts with a header (the magic "i3ev" and a 32 bit version),
+ * followed by records in native byte order. Each record starts with a byte
+ * identifying its kind:
+ *
+ *   'E': 64 bit timestamp (nanoseconds since the header), 32 byte event as
+ *        received from the X server
+ *   'A': 32 bit atom, 16 bit length, name of the atom. Written before the
+ *        first event which refers to the atom, because atom values are only
+ *        meaningful within one X server.
+ *   'C': 64 bit timestamp, 32 bit length, command
+ *
+ * The file is opened for appending, so an inplace restart adds a new header
+ * (which starts a new time base) instead of overwriting what was recorded.
+ *
+ * Replies to requests are not recorded: they depend on the state of the X
+ * server at the time, so a replay has to recreate the windows instead.
+ *
+ */
+#include "all.h"
+
+#define EVENT_RECORD_VERSION 1
+
+bool event_recording = false;
+
+static FILE *record_file;
+static uint64_t record_start;
+
+/* Sorted list of the atoms whose name was already written. */
+static xcb_atom_t *recorded_atoms;
+static size_t recorded_atoms_num;
+static size_t recorded_atoms_size;
+
+static void write_timestamp(void) {
+    uint64_t timestamp = stats_now() - record_start;
+    fwrite(&timestamp, sizeof(timestamp), 1, record_file);
+}
+
+/*
+ * Writes an 'A' record for the given atom unless one was already written.
+ *
+ */
+static void record_atom(xcb_atom_t atom) {
+    if (atom == XCB_NONE)
+        return;
+
+    size_t low = 0, high = recorded_atoms_num;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (recorded_atoms[mid] == atom)
+            return;
+        if (recorded_atoms[mid] < atom)
+            low = mid + 1;
+        else high = mid;
+    }
+
+    if (recorded_atoms_num == recorded_atoms_size) {
+        recorded_atoms_size = (recorded_atoms_size == 0 ? 64 : recorded_atoms_size * 2);
+        recorded_atoms = srealloc(recorded_atoms, recorded_atoms_size * sizeof(xcb_atom_t));
+    }
+    memmove(recorded_atoms + low + 1, recorded_atoms + low,
+            (recorded_atoms_num - low) * sizeof(xcb_atom_t));
+    recorded_atoms[low] = atom;
+    recorded_atoms_num++;
+
+    /* This is a round trip, but only the first time an atom is seen. */
+    xcb_get_atom_name_reply_t *reply = xcb_get_atom_name_reply(
+        conn, xcb_get_atom_name(conn, atom), NULL);
+    if (reply == NULL)
+        return;
+
+    uint16_t len = xcb_get_atom_name_name_length(reply);
+    fputc('A', record_file);
+    fwrite(&atom, sizeof(atom), 1, record_file);
+    fwrite(&len, sizeof(len), 1, record_file);
+    fwrite(xcb_get_atom_name_name(reply), 1, len, record_file);
+    free(reply);
+}
+
+/*
+ * Starts appending the handled events to the given file. Needs the X11
+ * connection to resolve atom names. Returns false if the file could not be
+ * opened.
+ *
+ */
+bool event_record_start(const char *filename) {
+    event_record_stop();
+
+    record_file = fopen(filename, "ab");
+    if (record_file == NULL) {
+        ELOG("Could not open \"%s\" for recording events: %s\n", filename, strerror(errno));
+        return false;
+    }
+
+    uint32_t version = EVENT_RECORD_VERSION;
+    fwrite("i3ev", 1, 4, record_file);
+    fwrite(&version, sizeof(version), 1, record_file);
+    record_start = stats_now();
+    event_recording = true;
+    LOG("Recording events to \"%s\"\n", filename);
+    return true;
+}
+
+/*
+ * Records the given X11 event. Does nothing unless recording is enabled.
+ *
+ */
+void event_record_event(const xcb_generic_event_t *event) {
+    if (!event_recording)
+        return;
+
+    switch (event->response_type & 0x7F) {
+        case XCB_PROPERTY_NOTIFY:
+            record_atom(((const xcb_property_notify_event_t*)event)->atom);
+            break;
+        case XCB_CLIENT_MESSAGE:
+            record_atom(((const xcb_client_message_event_t*)event)->type);
+            break;
+    }
+
+    fputc('E', record_file);
+    write_timestamp();
+    fwrite(event, sizeof(xcb_generic_event_t), 1, record_file);
+}
+
+/*
+ * Records a command which was run because of a key binding or an IPC
+ * message. Does nothing unless recording is enabled.
+ *
+ */
+void event_record_command(const char *command) {
+    if (!event_recording)
+        return;
+
+    uint32_t len = strlen(command);
+    fputc('C', record_file);
+    write_timestamp();
+    fwrite(&len, sizeof(len), 1, record_file);
+    fwrite(command, 1, len, record_file);
+}
+
+/*
+ * Flushes and closes the recording. Called before exiting or restarting.
+ *
+ */
+void event_record_stop(void) {
+    if (record_file == NULL)
+        return;
+
+    if (fclose(record_file) != 0)
+        ELOG("Could not write the event recording: %s\n", strerror(errno));
+    record_file = NULL;
+    event_recording = false;
+
+    free(recorded_atoms);
+    recorded_atoms = NULL;
+    recorded_atoms_num = recorded_atoms_size = 0;
+}
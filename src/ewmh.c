@@ -11,30 +11,58 @@
  */
 #include "all.h"
 
+/* The values we last wrote to the root window properties. Every write makes
+ * the X server send a PropertyNotify to all pagers and panels, even if the
+ * value did not change, so properties are only written when they change. */
+static bool current_desktop_set = false;
+static uint32_t current_desktop;
+static bool active_window_set = false;
+static xcb_window_t active_window;
+static bool workarea_deleted = false;
+
+/* The tree structure (see con_tree_structure()) for which ewmh_desktop_index
+ * of all workspaces was computed. */
+static unsigned int desktop_index_structure = 0;
+
 /*
- * Updates _NET_CURRENT_DESKTOP with the current desktop number.
- *
- * EWMH: The index of the current desktop. This is always an integer between 0
- * and _NET_NUMBER_OF_DESKTOPS - 1.
+ * Numbers all workspaces, since named workspaces don’t have the ->num
+ * property.
  *
  */
-void ewmh_update_current_desktop(void) {
-    Con *focused_ws = con_get_workspace(focused);
+static void update_desktop_indexes(void) {
     Con *output;
     uint32_t idx = 0;
-    /* We count to get the index of this workspace because named workspaces
-     * don’t have the ->num property */
     TAILQ_FOREACH(output, &(croot->nodes_head), nodes) {
         Con *ws;
         TAILQ_FOREACH(ws, &(output_get_content(output)->nodes_head), nodes) {
-            if (ws == focused_ws) {
-                xcb_change_property(conn, XCB_PROP_MODE_REPLACE, root,
-                        A__NET_CURRENT_DESKTOP, XCB_ATOM_CARDINAL, 32, 1, &idx);
-                return;
-            }
-            ++idx;
+            ws->ewmh_desktop_index = idx++;
         }
     }
+    desktop_index_structure = con_tree_structure();
+}
+
+/*
+ * Updates _NET_CURRENT_DESKTOP with the current desktop number.
+ *
+ * EWMH: The index of the current desktop. This is always an integer between 0
+ * and _NET_NUMBER_OF_DESKTOPS - 1.
+ *
+ */
+void ewmh_update_current_desktop(void) {
+    Con *focused_ws = con_get_workspace(focused);
+    if (focused_ws == NULL)
+        return;
+
+    if (desktop_index_structure != con_tree_structure())
+        update_desktop_indexes();
+
+    uint32_t idx = focused_ws->ewmh_desktop_index;
+    if (current_desktop_set && current_desktop == idx)
+        return;
+    current_desktop_set = true;
+    current_desktop = idx;
+    xcb_change_property(conn, XCB_PROP_MODE_REPLACE, root,
+            A__NET_CURRENT_DESKTOP, XCB_ATOM_CARDINAL, 32, 1, &idx);
 }
 
 /*
@@ -45,6 +73,10 @@ void ewmh_update_current_desktop(void) {
  *
  */
 void ewmh_update_active_window(xcb_window_t window) {
+    if (active_window_set && active_window == window)
+        return;
+    active_window_set = true;
+    active_window = window;
     xcb_change_property(conn, XCB_PROP_MODE_REPLACE, root,
             A__NET_ACTIVE_WINDOW, XCB_ATOM_WINDOW, 32, 1, &window);
 }
@@ -65,6 +97,10 @@ void ewmh_update_active_window(xcb_window_t window) {
  *
  */
 void ewmh_update_workarea(void) {
+    /* Nobody but display managers sets it, so deleting it once is enough. */
+    if (workarea_deleted)
+        return;
+    workarea_deleted = true;
     xcb_delete_property(conn, root, A__NET_WORKAREA);
 }
 
@@ -119,5 +155,5 @@ void ewmh_setup_hints(void) {
     /* I’m not entirely sure if we need to keep _NET_WM_NAME on root. */
     xcb_change_property(conn, XCB_PROP_MODE_REPLACE, root, A__NET_WM_NAME, A_UTF8_STRING, 8, strlen("i3"), "i3");
 
-    xcb_change_property(conn, XCB_PROP_MODE_REPLACE, root, A__NET_SUPPORTED, XCB_ATOM_ATOM, 32, 18, supported_atoms);
+    xcb_change_property(conn, XCB_PROP_MODE_REPLACE, root, A__NET_SUPPORTED, XCB_ATOM_ATOM, 32, 20, supported_atoms);
 }
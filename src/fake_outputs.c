@@ -65,6 +65,7 @@ void fake_outputs_init(const char *output_spec) {
             init_ws_for_output(new_output, output_get_content(new_output->con));
             num_screens++;
         }
+        randr_invalidate_output_index();
 
         /* Figure out how long the input was to skip it */
         walk += sprintf(useless_buffer, "%ux%u+%u+%u", width, height, x, y) + 1;
@@ -13,20 +13,10 @@
 
 extern xcb_connection_t *conn;
 
-/*
- * Calculates sum of heights and sum of widths of all currently active outputs
- *
- */
-static Rect total_outputs_dimensions(void) {
-    Output *output;
-    /* Use Rect to encapsulate dimensions, ignoring x/y */
-    Rect outputs_dimensions = {0, 0, 0, 0};
-    TAILQ_FOREACH(output, &outputs, outputs) {
-        outputs_dimensions.height += output->rect.height;
-        outputs_dimensions.width += output->rect.width;
-    }
-    return outputs_dimensions;
-}
+/* Dragging calls the callback (which usually renders the tree) at most this
+ * often, in nanoseconds. Mice with high polling rates send up to 1000 motion
+ * events per second, far more than any display shows. */
+#define DRAG_UPDATE_INTERVAL (1000000000 / 120)
 
 /**
  * Called when a floating window is created or resized.
@@ -87,7 +77,7 @@ void floating_check_size(Con *floating_con) {
 
     /* Unless user requests otherwise (-1), raise the width/height to
      * reasonable minimum dimensions */
-    floating_sane_max_dimensions = total_outputs_dimensions();
+    floating_sane_max_dimensions = randr_total_output_dimensions();
     if (config.floating_maximum_height != -1) {
         if (config.floating_maximum_height == 0)
             floating_con->rect.height = min(floating_con->rect.height, floating_sane_max_dimensions.height);
@@ -162,6 +152,7 @@ void floating_enable(Con *con, bool automatic) {
     /* TODO: refactor this with tree_close() */
     TAILQ_REMOVE(&(con->parent->nodes_head), con, nodes);
     TAILQ_REMOVE(&(con->parent->focus_head), con, focused);
+    con_children_changed(con->parent);
 
     con_fix_percent(con->parent);
 
@@ -287,6 +278,7 @@ void floating_enable(Con *con, bool automatic) {
 
     TAILQ_INSERT_TAIL(&(nc->nodes_head), con, nodes);
     TAILQ_INSERT_TAIL(&(nc->focus_head), con, focused);
+    con_children_changed(nc);
 
     /* render the cons to get initial window_rect correct */
     render_con(nc, false);
@@ -322,6 +314,7 @@ void floating_disable(Con *con, bool automatic) {
     /* 1: detach from parent container */
     TAILQ_REMOVE(&(con->parent->nodes_head), con, nodes);
     TAILQ_REMOVE(&(con->parent->focus_head), con, focused);
+    con_children_changed(con->parent);
 
     /* 2: kill parent container */
     TAILQ_REMOVE(&(con->parent->parent->floating_head), con->parent, floating_windows);
@@ -410,8 +403,55 @@ bool floating_maybe_reassign_ws(Con *con) {
     return true;
 }
 
+/*
+ * This is an ugly data structure which we need because there is no standard
+ * way of having nested functions (only available as a gcc extension at the
+ * moment, clang doesn’t support it) or blocks (only available as a clang
+ * extension and only on Mac OS X systems at the moment).
+ *
+ */
+struct drag_window_callback_params {
+    const xcb_button_press_event_t *event;
+    /* The four edges of the outline, XCB_NONE unless floating_move is set to
+     * outline. */
+    xcb_window_t outline[4];
+    /* Where the window will be moved to when the button is released */
+    Rect *outline_rect;
+};
+
+/*
+ * Moves the edges of the outline to the given rect.
+ *
+ */
+static void outline_move(const xcb_window_t outline[4], Rect r) {
+    const uint32_t mask = XCB_CONFIG_WINDOW_X | XCB_CONFIG_WINDOW_Y |
+                          XCB_CONFIG_WINDOW_WIDTH | XCB_CONFIG_WINDOW_HEIGHT;
+    const int width = max(r.width, 2);
+    const int height = max(r.height, 2);
+    const uint32_t edges[4][4] = {
+        {r.x, r.y, width, 2},
+        {r.x, r.y + height - 2, width, 2},
+        {r.x, r.y, 2, height},
+        {r.x + width - 2, r.y, 2, height},
+    };
+
+    for (int i = 0; i < 4; i++)
+        xcb_configure_window(conn, outline[i], mask, edges[i]);
+    xcb_flush(conn);
+}
+
 DRAGGING_CB(drag_window_callback) {
-    const struct xcb_button_press_event_t *event = extra;
+    const struct drag_window_callback_params *params = extra;
+    const struct xcb_button_press_event_t *event = params->event;
+
+    if (params->outline[0] != XCB_NONE) {
+        /* Only move the outline, the window is moved (and gets notified) once
+         * the button is released. */
+        params->outline_rect->x = old_rect->x + (new_x - event->root_x);
+        params->outline_rect->y = old_rect->y + (new_y - event->root_y);
+        outline_move(params->outline, *(params->outline_rect));
+        return;
+    }
 
     /* Reposition the client correctly while moving */
     con->rect.x = old_rect->x + (new_x - event->root_x);
@@ -443,13 +483,44 @@ void floating_drag_window(Con *con, const xcb_button_press_event_t *event) {
 
     /* Store the initial rect in case of user revert/cancel */
     Rect initial_rect = con->rect;
+    const uint64_t serial = con->serial;
+
+    Rect outline_rect = con->rect;
+    struct drag_window_callback_params params = { event, { XCB_NONE, XCB_NONE, XCB_NONE, XCB_NONE }, &outline_rect };
+    if (config.floating_move == FM_OUTLINE) {
+        uint32_t values[] = { config.client.focused.border, 1 };
+        for (int i = 0; i < 4; i++)
+            params.outline[i] = create_window(conn, (Rect){ 0, 0, 2, 2 }, XCB_COPY_FROM_PARENT, XCB_COPY_FROM_PARENT,
+                    XCB_WINDOW_CLASS_INPUT_OUTPUT, XCURSOR_CURSOR_MOVE, true,
+                    XCB_CW_BACK_PIXEL | XCB_CW_OVERRIDE_REDIRECT, values);
+        outline_move(params.outline, outline_rect);
+    }
 
     /* Drag the window */
-    drag_result_t drag_result = drag_pointer(con, event, XCB_NONE, BORDER_TOP /* irrelevant */, XCURSOR_CURSOR_MOVE, drag_window_callback, event);
+    drag_result_t drag_result = drag_pointer(con, event, XCB_NONE, BORDER_TOP /* irrelevant */, XCURSOR_CURSOR_MOVE, drag_window_callback, &params);
+
+    if (params.outline[0] != XCB_NONE) {
+        for (int i = 0; i < 4; i++)
+            xcb_destroy_window(conn, params.outline[i]);
+        xcb_flush(conn);
+    }
+
+    /* The container might be gone */
+    if (!con_still_exists(con, serial)) {
+        tree_render();
+        return;
+    }
 
     /* If the user cancelled, undo the changes. */
     if (drag_result == DRAG_REVERT)
         floating_reposition(con, initial_rect);
+    else if (params.outline[0] != XCB_NONE) {
+        /* floating_reposition() also moves the window to the workspace of
+         * the output it was dropped on, which happens while dragging in
+         * opaque mode. */
+        x_set_warp_to(NULL);
+        floating_reposition(con, outline_rect);
+    }
 
     /* If this is a scratchpad window, don't auto center it from now on. */
     if (con->scratchpad_state == SCRATCHPAD_FRESH)
@@ -555,9 +626,14 @@ void floating_resize_window(Con *con, const bool proportional,
 
     /* get the initial rect in case of revert/cancel */
     Rect initial_rect = con->rect;
+    const uint64_t serial = con->serial;
 
     drag_result_t drag_result = drag_pointer(con, event, XCB_NONE, BORDER_TOP /* irrelevant */, cursor, resize_window_callback, &params);
 
+    /* The container might be gone */
+    if (!con_still_exists(con, serial))
+        return;
+
     /* If the user cancels, undo the resize */
     if (drag_result == DRAG_REVERT)
         floating_reposition(con, initial_rect);
@@ -567,6 +643,141 @@ void floating_resize_window(Con *con, const bool proportional,
         con->scratchpad_state = SCRATCHPAD_CHANGED;
 }
 
+/* State of a drag_pointer() operation, shared by its watchers */
+struct drag_x11_cb {
+    ev_check check;
+    ev_timer timer;
+
+    drag_result_t result;
+
+    Con *con;
+    uint64_t con_serial;
+    Rect old_rect;
+    callback_t callback;
+    const void *extra;
+
+    /* The most recent motion which was not passed to the callback yet */
+    xcb_generic_event_t *last_motion_notify;
+    uint64_t last_update;
+};
+
+/*
+ * Passes the most recent motion to the callback.
+ *
+ */
+static void drag_apply_motion(struct drag_x11_cb *dragloop) {
+    if (dragloop->last_motion_notify == NULL)
+        return;
+
+    /* IPC commands are handled while dragging, too, and might have closed
+     * the container. */
+    if (dragloop->con != NULL && !con_still_exists(dragloop->con, dragloop->con_serial)) {
+        DLOG("The dragged container is gone, aborting\n");
+        dragloop->con = NULL;
+        dragloop->result = DRAG_ABORT;
+        FREE(dragloop->last_motion_notify);
+        return;
+    }
+
+    xcb_motion_notify_event_t *motion = (xcb_motion_notify_event_t*)dragloop->last_motion_notify;
+    dragloop->callback(dragloop->con, &(dragloop->old_rect), motion->root_x, motion->root_y, dragloop->extra);
+    dragloop->last_update = stats_now();
+    FREE(dragloop->last_motion_notify);
+}
+
+static void drag_timer_cb(EV_P_ ev_timer *w, int revents) {
+    struct drag_x11_cb *dragloop = (struct drag_x11_cb*)w->data;
+    if (dragloop->result == DRAGGING)
+        drag_apply_motion(dragloop);
+}
+
+/*
+ * Handles the X11 events while dragging. This takes the place of the main
+ * X11 callback (see main_set_x11_cb()) while drag_pointer() runs.
+ *
+ */
+static void drag_check_cb(EV_P_ ev_check *w, int revents) {
+    struct drag_x11_cb *dragloop = (struct drag_x11_cb*)w->data;
+    xcb_generic_event_t *event;
+
+    while (dragloop->result == DRAGGING && (event = xcb_poll_for_event(conn)) != NULL) {
+        /* skip x11 errors */
+        if (event->response_type == 0) {
+            free(event);
+            continue;
+        }
+        /* Strip off the highest bit (set if the event is generated) */
+        int type = (event->response_type & 0x7F);
+        Con *inside_con;
+
+        switch (type) {
+            case XCB_BUTTON_RELEASE:
+                dragloop->result = DRAG_SUCCESS;
+                break;
+
+            case XCB_MOTION_NOTIFY:
+                /* motion_notify events are saved for later */
+                FREE(dragloop->last_motion_notify);
+                dragloop->last_motion_notify = event;
+                break;
+
+            case XCB_UNMAP_NOTIFY:
+                inside_con = con_by_window_id(((xcb_unmap_notify_event_t*)event)->window);
+
+                if (inside_con != NULL) {
+                    DLOG("UnmapNotify for window 0x%08x (container %p)\n", ((xcb_unmap_notify_event_t*)event)->window, inside_con);
+
+                    if (con_get_workspace(inside_con) == con_get_workspace(focused)) {
+                        DLOG("UnmapNotify for a managed window on the current workspace, aborting\n");
+                        dragloop->result = DRAG_ABORT;
+                    }
+                }
+
+                handle_event(type, event);
+                break;
+
+            case XCB_KEY_PRESS:
+                /* Cancel the drag if a key was pressed */
+                DLOG("A key was pressed during drag, reverting changes.");
+                dragloop->result = DRAG_REVERT;
+
+                handle_event(type, event);
+                break;
+
+            default:
+                DLOG("Passing to original handler\n");
+                /* Use original handler */
+                handle_event(type, event);
+                break;
+        }
+        if (dragloop->last_motion_notify != event)
+            free(event);
+    }
+
+    /* The last motion before the button was released is applied, too,
+     * since it might have been held back below. */
+    if (dragloop->result == DRAG_SUCCESS) {
+        ev_timer_stop(EV_A_ &(dragloop->timer));
+        drag_apply_motion(dragloop);
+        return;
+    }
+
+    if (dragloop->result != DRAGGING || dragloop->last_motion_notify == NULL ||
+        ev_is_active(&(dragloop->timer)))
+        return;
+
+    /* Until the next update is due, wait for more motion (all but the last
+     * of which will be skipped) instead of rendering every single one. */
+    uint64_t elapsed = stats_now() - dragloop->last_update;
+    if (elapsed < DRAG_UPDATE_INTERVAL) {
+        ev_timer_set(&(dragloop->timer), (DRAG_UPDATE_INTERVAL - elapsed) / 1e9, 0.);
+        ev_timer_start(EV_A_ &(dragloop->timer));
+        return;
+    }
+
+    drag_apply_motion(dragloop);
+}
+
 /*
  * This function grabs your pointer and keyboard and lets you drag stuff around
  * (borders). Every time you move your mouse, an XCB_MOTION_NOTIFY event will
@@ -578,7 +789,6 @@ void floating_resize_window(Con *con, const bool proportional,
 drag_result_t drag_pointer(Con *con, const xcb_button_press_event_t *event, xcb_window_t
                 confine_to, border_t border, int cursor, callback_t callback, const void *extra)
 {
-    uint32_t new_x, new_y;
     Rect old_rect = { 0, 0, 0, 0 };
     if (con != NULL)
         memcpy(&old_rect, &(con->rect), sizeof(Rect));
@@ -625,85 +835,38 @@ drag_result_t drag_pointer(Con *con, const xcb_button_press_event_t *event, xcb_
 
     free(keyb_reply);
 
-    /* Go into our own event loop */
-    xcb_flush(conn);
-
-    xcb_generic_event_t *inside_event, *last_motion_notify = NULL;
-    Con *inside_con = NULL;
-
-    drag_result_t drag_result = DRAGGING;
-    /* I’ve always wanted to have my own eventhandler… */
-    while (drag_result == DRAGGING && (inside_event = xcb_wait_for_event(conn))) {
-        /* We now handle all events we can get using xcb_poll_for_event */
-        do {
-            /* skip x11 errors */
-            if (inside_event->response_type == 0) {
-                free(inside_event);
-                continue;
-            }
-            /* Strip off the highest bit (set if the event is generated) */
-            int type = (inside_event->response_type & 0x7F);
-
-            switch (type) {
-                case XCB_BUTTON_RELEASE:
-                    drag_result = DRAG_SUCCESS;
-                    break;
-
-                case XCB_MOTION_NOTIFY:
-                    /* motion_notify events are saved for later */
-                    FREE(last_motion_notify);
-                    last_motion_notify = inside_event;
-                    break;
-
-                case XCB_UNMAP_NOTIFY:
-                    inside_con = con_by_window_id(((xcb_unmap_notify_event_t*)inside_event)->window);
-
-                    if (inside_con != NULL) {
-                        DLOG("UnmapNotify for window 0x%08x (container %p)\n", ((xcb_unmap_notify_event_t*)inside_event)->window, inside_con);
-
-                        if (con_get_workspace(inside_con) == con_get_workspace(focused)) {
-                            DLOG("UnmapNotify for a managed window on the current workspace, aborting\n");
-                            drag_result = DRAG_ABORT;
-                        }
-                    }
-
-                    handle_event(type, inside_event);
-                    break;
-
-                case XCB_KEY_PRESS:
-                    /* Cancel the drag if a key was pressed */
-                    DLOG("A key was pressed during drag, reverting changes.");
-                    drag_result = DRAG_REVERT;
-
-                    handle_event(type, inside_event);
-                    break;
-
-                default:
-                    DLOG("Passing to original handler\n");
-                    /* Use original handler */
-                    handle_event(type, inside_event);
-                    break;
-            }
-            if (last_motion_notify != inside_event)
-                free(inside_event);
-        } while ((inside_event = xcb_poll_for_event(conn)) != NULL);
-
-        if (last_motion_notify == NULL || drag_result != DRAGGING)
-            continue;
-
-        new_x = ((xcb_motion_notify_event_t*)last_motion_notify)->root_x;
-        new_y = ((xcb_motion_notify_event_t*)last_motion_notify)->root_y;
-
-        callback(con, &old_rect, new_x, new_y, extra);
-        FREE(last_motion_notify);
-    }
+    /* The events are handled by drag_check_cb() from within the main event
+     * loop, so that IPC and timers keep working while dragging. */
+    struct drag_x11_cb loop = {
+        .result = DRAGGING,
+        .con = con,
+        .con_serial = (con != NULL ? con->serial : 0),
+        .old_rect = old_rect,
+        .callback = callback,
+        .extra = extra,
+    };
+    ev_check_init(&loop.check, drag_check_cb);
+    loop.check.data = &loop;
+    ev_timer_init(&loop.timer, drag_timer_cb, 0., 0.);
+    loop.timer.data = &loop;
+
+    main_set_x11_cb(false);
+    ev_check_start(main_loop, &loop.check);
+
+    while (loop.result == DRAGGING)
+        ev_run(main_loop, EVRUN_ONCE);
+
+    ev_check_stop(main_loop, &loop.check);
+    ev_timer_stop(main_loop, &loop.timer);
+    FREE(loop.last_motion_notify);
+    main_set_x11_cb(true);
 
     xcb_ungrab_keyboard(conn, XCB_CURRENT_TIME);
     xcb_ungrab_pointer(conn, XCB_CURRENT_TIME);
 
     xcb_flush(conn);
 
-    return drag_result;
+    return loop.result;
 }
 
 /*
@@ -732,6 +895,57 @@ void floating_reposition(Con *con, Rect newrect) {
     tree_render();
 }
 
+/* The floating containers with a pending reposition, in the order of their
+ * first ConfigureRequest. */
+static TAILQ_HEAD(pending_repositions_head, Con) pending_repositions =
+    TAILQ_HEAD_INITIALIZER(pending_repositions);
+
+/*
+ * Like floating_reposition(), but only remembers the new coordinates until
+ * floating_apply_repositions() is called. Used for ConfigureRequests, so that
+ * clients which move or resize their windows many times per second (think of
+ * animations) only get the latest geometry applied, once per loop iteration.
+ *
+ */
+void floating_reposition_later(Con *con, Rect newrect) {
+    if (!con->reposition_pending) {
+        TAILQ_INSERT_TAIL(&pending_repositions, con, pending_repositions);
+        con->reposition_pending = true;
+    } else DLOG("Dropping the pending reposition of %p in favor of the new one\n", con);
+    con->reposition_rect = newrect;
+}
+
+/*
+ * Applies the coordinates remembered by floating_reposition_later() and
+ * renders the tree once.
+ *
+ */
+void floating_apply_repositions(void) {
+    if (TAILQ_EMPTY(&pending_repositions))
+        return;
+
+    tree_batch_begin();
+    Con *con;
+    while ((con = TAILQ_FIRST(&pending_repositions)) != NULL) {
+        TAILQ_REMOVE(&pending_repositions, con, pending_repositions);
+        con->reposition_pending = false;
+        floating_reposition(con, con->reposition_rect);
+    }
+    tree_batch_end();
+}
+
+/*
+ * Forgets the coordinates remembered by floating_reposition_later() for the
+ * given container. Called by tree_close() before the container is freed.
+ *
+ */
+void floating_cancel_reposition(Con *con) {
+    if (!con->reposition_pending)
+        return;
+    TAILQ_REMOVE(&pending_repositions, con, pending_repositions);
+    con->reposition_pending = false;
+}
+
 /*
  * Fixes the coordinates of the floating window whenever the window gets
  * reassigned to a different output (or when the output’s rect changes).
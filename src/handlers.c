@@ -21,28 +21,73 @@
 #include <libsn/sn-monitor.h>
 
 int randr_base = -1;
+int sync_base = -1;
 
 /* After mapping/unmapping windows, a notify event is generated. However, we don’t want it,
    since it’d trigger an infinite loop of switching between the different windows when
-   changing workspaces */
-static SLIST_HEAD(ignore_head, Ignore_Event) ignore_events;
+   changing workspaces.
+
+   The ignored sequences are kept in a ring buffer in the order in which they
+   were added. When it is full, the oldest entry is overwritten. */
+#define IGNORE_EVENTS_SIZE 1024
+static struct Ignore_Event ignore_events[IGNORE_EVENTS_SIZE];
+/* Index of the oldest entry and number of entries. */
+static int ignore_events_tail = 0;
+static int ignore_events_count = 0;
+
+/*
+ * Returns the number of sequences which are currently ignored (see
+ * add_ignore_event()). Stale entries are only removed when the next event
+ * arrives, so they are included.
+ *
+ */
+int ignore_events_num(void) {
+    return ignore_events_count;
+}
+
+/*
+ * Returns true if no more events can arrive for the given ignore entry: X11
+ * delivers events and errors in the order of the requests, so once we got an
+ * event with a later sequence number, there won’t be any for the entry’s
+ * sequence anymore. Sequence numbers in events only have 16 bits, so this
+ * compares modulo 2^16. As a safety net against wrapped sequence numbers, the
+ * entry also becomes stale after 5 seconds.
+ *
+ */
+static bool ignore_event_is_stale(const struct Ignore_Event *event, const int sequence, const time_t now) {
+    return ((int16_t)(uint16_t)(sequence - event->last_sequence) > 0 ||
+            (now - event->added) > 5);
+}
 
 /*
  * Adds the given sequence to the list of events which are ignored.
  * If this ignore should only affect a specific response_type, pass
  * response_type, otherwise, pass -1.
  *
- * Every ignored sequence number gets garbage collected after 5 seconds.
+ * The entry is dropped as soon as an event with a later sequence number is
+ * checked, or after 5 seconds.
  *
  */
 void add_ignore_event(const int sequence, const int response_type) {
-    struct Ignore_Event *event = smalloc(sizeof(struct Ignore_Event));
+    add_ignore_event_range(sequence, sequence, response_type);
+}
 
-    event->sequence = sequence;
+/*
+ * Like add_ignore_event(), but ignores all sequence numbers from first to last
+ * (both inclusive), i.e. all events caused by the requests in between.
+ *
+ */
+void add_ignore_event_range(const int first, const int last, const int response_type) {
+    int idx = (ignore_events_tail + ignore_events_count) % IGNORE_EVENTS_SIZE;
+    if (ignore_events_count == IGNORE_EVENTS_SIZE)
+        ignore_events_tail = (ignore_events_tail + 1) % IGNORE_EVENTS_SIZE;
+    else ignore_events_count++;
+
+    struct Ignore_Event *event = &ignore_events[idx];
+    event->sequence = first;
+    event->last_sequence = last;
     event->response_type = response_type;
     event->added = time(NULL);
-
-    SLIST_INSERT_HEAD(&ignore_events, event, ignore_events);
 }
 
 /*
@@ -50,30 +95,29 @@ void add_ignore_event(const int sequence, const int response_type) {
  *
  */
 bool event_is_ignored(const int sequence, const int response_type) {
-    struct Ignore_Event *event;
     time_t now = time(NULL);
-    for (event = SLIST_FIRST(&ignore_events); event != SLIST_END(&ignore_events);) {
-        if ((now - event->added) > 5) {
-            struct Ignore_Event *save = event;
-            event = SLIST_NEXT(event, ignore_events);
-            SLIST_REMOVE(&ignore_events, save, Ignore_Event, ignore_events);
-            free(save);
-        } else event = SLIST_NEXT(event, ignore_events);
+
+    /* Expire the oldest entries. Entries are added roughly in sequence order,
+     * so this usually leaves only the requests which are still in flight. */
+    while (ignore_events_count > 0 &&
+           ignore_event_is_stale(&ignore_events[ignore_events_tail], sequence, now)) {
+        ignore_events_tail = (ignore_events_tail + 1) % IGNORE_EVENTS_SIZE;
+        ignore_events_count--;
     }
 
-    SLIST_FOREACH(event, &ignore_events, ignore_events) {
-        if (event->sequence != sequence)
+    for (int i = 0; i < ignore_events_count; i++) {
+        const struct Ignore_Event *event = &ignore_events[(ignore_events_tail + i) % IGNORE_EVENTS_SIZE];
+        if ((uint16_t)(sequence - event->sequence) >
+            (uint16_t)(event->last_sequence - event->sequence))
             continue;
 
         if (event->response_type != -1 &&
             event->response_type != response_type)
             continue;
 
-        /* instead of removing a sequence number we better wait until it gets
-         * garbage collected. it may generate multiple events (there are multiple
+        /* instead of removing a sequence number we better wait until it
+         * expires. it may generate multiple events (there are multiple
          * enter_notifies for one configure_request, for example). */
-        //SLIST_REMOVE(&ignore_events, event, Ignore_Event, ignore_events);
-        //free(event);
         return true;
     }
 
@@ -113,7 +157,31 @@ static void check_crossing_screen_boundary(uint32_t x, uint32_t y) {
 
     /* If the focus changed, we re-render to get updated decorations */
     if (old_focused != focused)
-        tree_render();
+        tree_render_later();
+}
+
+/*
+ * Returns true if focusing the given container (on the focused workspace)
+ * only changes which decorations are drawn as focused and the X11 input
+ * focus, but not which windows are visible or where: The focused child of
+ * all stacked/tabbed containers above it stays the same, there is no
+ * fullscreen container and no urgency hint is reset.
+ *
+ */
+static bool focus_change_only(Con *con) {
+    Con *ws = con_get_workspace(con);
+    if (ws != con_get_workspace(focused) ||
+        con_get_fullscreen_con(ws, CF_OUTPUT) != NULL ||
+        con->urgent)
+        return false;
+
+    for (Con *current = con; current != ws; current = current->parent) {
+        Con *parent = current->parent;
+        if ((parent->layout == L_STACKED || parent->layout == L_TABBED) &&
+            TAILQ_FIRST(&(parent->focus_head)) != current)
+            return false;
+    }
+    return true;
 }
 
 /*
@@ -186,13 +254,27 @@ static void handle_enter_notify(xcb_enter_notify_event_t *event) {
     /* Get the currently focused workspace to check if the focus change also
      * involves changing workspaces. If so, we need to call workspace_show() to
      * correctly update state and send the IPC event. */
+    con = con_descend_focused(con);
+
+    /* When the container already has the focus, there is nothing to update
+     * (x_push_changes() would not even set the X11 input focus again). */
+    if (con == focused) {
+        DLOG("Entered the focused container, not doing anything\n");
+        return;
+    }
+
+    /* Moving the pointer over a grid of windows should not render the whole
+     * tree for every single one of them. */
+    bool focus_only = focus_change_only(con);
+
     Con *ws = con_get_workspace(con);
     if (ws != con_get_workspace(focused))
         workspace_show(ws);
 
-    focused_id = XCB_NONE;
-    con_focus(con_descend_focused(con));
-    tree_render();
+    con_focus(con);
+    if (focus_only)
+        tree_render_focus_later();
+    else tree_render_later();
 
     return;
 }
@@ -236,7 +318,7 @@ static void handle_motion_notify(xcb_motion_notify_event_t *event) {
             return;
 
         con_focus(current);
-        x_push_changes(croot);
+        tree_render_focus_later();
         return;
     }
 
@@ -256,11 +338,11 @@ static void handle_mapping_notify(xcb_mapping_notify_event_t *event) {
     DLOG("Received mapping_notify for keyboard or modifier mapping, re-grabbing keys\n");
     xcb_refresh_keyboard_mapping(keysyms, event);
 
-    xcb_numlock_mask = aio_get_mod_mask_for(XCB_NUM_LOCK, keysyms);
+    key_press_mapping_changed();
 
-    ungrab_all_keys(conn);
+    invalidate_keysym_map();
     translate_keysyms();
-    grab_all_keys(conn, false);
+    update_key_grabs(conn, (xkb_current_group == XkbGroup2Index));
 
     return;
 }
@@ -277,8 +359,9 @@ static void handle_map_request(xcb_map_request_event_t *event) {
     DLOG("window = 0x%08x, serial is %d.\n", event->window, event->sequence);
     add_ignore_event(event->sequence, -1);
 
+    /* The window is managed by manage_pending_windows(), together with all
+     * other windows mapped in the same burst of events. */
     manage_window(event->window, cookie, false);
-    x_push_changes(croot);
     return;
 }
 
@@ -379,7 +462,7 @@ static void handle_configure_request(xcb_configure_request_event_t *event) {
         }
 
         DLOG("Container is a floating leaf node, will do that.\n");
-        floating_reposition(floatingcon, newrect);
+        floating_reposition_later(floatingcon, newrect);
         return;
     }
 
@@ -390,7 +473,9 @@ static void handle_configure_request(xcb_configure_request_event_t *event) {
             DLOG("Height given, changing\n");
 
             con->geometry.height = event->height;
-            tree_render();
+            con->parent->dock_height_valid = false;
+            con_mark_dirty(con->parent);
+            tree_render_later();
         }
     }
 
@@ -415,14 +500,15 @@ int handle_configure_event(void *prophs, xcb_connection_t *conn, xcb_configure_n
 }
 #endif
 
+/* Delays the handling of screen changes, see config.screen_change_delay. */
+static ev_timer screen_change_timer;
+
 /*
- * Gets triggered upon a RandR screen change event, that is when the user
- * changes the screen configuration in any way (mode, position, …)
+ * Queries the root window geometry and the outputs after the screen
+ * configuration changed.
  *
  */
-static void handle_screen_change(xcb_generic_event_t *e) {
-    DLOG("RandR screen change\n");
-
+static void update_screen(void) {
     /* The geometry of the root window is used for “fullscreen global” and
      * changes when new outputs are added. */
     xcb_get_geometry_cookie_t cookie = xcb_get_geometry(conn, root);
@@ -435,14 +521,38 @@ static void handle_screen_change(xcb_generic_event_t *e) {
 
     croot->rect.width = reply->width;
     croot->rect.height = reply->height;
+    free(reply);
 
     randr_query_outputs();
 
     scratchpad_fix_resolution();
 
     ipc_send_event("output", I3_IPC_EVENT_OUTPUT, "{\"change\":\"unspecified\"}");
+}
 
-    return;
+static void screen_change_timer_cb(EV_P_ ev_timer *w, int revents) {
+    DLOG("No more screen changes, updating outputs\n");
+    update_screen();
+}
+
+/*
+ * Gets triggered upon a RandR screen change event, that is when the user
+ * changes the screen configuration in any way (mode, position, …)
+ *
+ */
+static void handle_screen_change(xcb_generic_event_t *e) {
+    DLOG("RandR screen change\n");
+
+    if (config.screen_change_delay <= 0) {
+        update_screen();
+        return;
+    }
+
+    /* Wait until the burst of notifications is over, i.e. restart the timer
+     * for every notification. */
+    ev_timer_stop(main_loop, &screen_change_timer);
+    ev_timer_init(&screen_change_timer, screen_change_timer_cb, config.screen_change_delay, 0.);
+    ev_timer_start(main_loop, &screen_change_timer);
 }
 
 /*
@@ -480,9 +590,10 @@ static void handle_unmap_notify_event(xcb_unmap_notify_event_t *event) {
         goto ignore_end;
     }
 
+    /* The render is deferred until all queued events were handled, so that an
+     * application closing many windows at once causes only one render. */
     tree_close(con, DONT_KILL_WINDOW, false, false);
-    tree_render();
-    x_push_changes(croot);
+    tree_render_later();
 
 ignore_end:
     /* If the client (as opposed to i3) destroyed or unmapped a window, an
@@ -504,8 +615,11 @@ ignore_end:
      * sure that following events use a different sequence. When putting xterm
      * into fullscreen and moving the pointer to a different window, without
      * using GetInputFocus, subsequent (legitimate) EnterNotify events arrived
-     * with the same sequence and thus were ignored (see ticket #609). */
-    free(xcb_get_input_focus_reply(conn, cookie, NULL));
+     * with the same sequence and thus were ignored (see ticket #609).
+     *
+     * Sending the request is enough for that, so we don’t wait for the reply
+     * (which would be one round trip per closed window). */
+    xcb_discard_reply(conn, cookie.sequence);
 }
 
 /*
@@ -538,7 +652,9 @@ static bool handle_windowname_change(void *data, xcb_connection_t *conn, uint8_t
     if ((con = con_by_window_id(window)) == NULL || con->window == NULL)
         return false;
 
-    window_update_name(con->window, prop, false);
+    if (!window_update_name(con->window, prop, false))
+        return true;
+    con_mark_changed(con);
 
     x_push_changes(croot);
 
@@ -556,7 +672,9 @@ static bool handle_windowname_change_legacy(void *data, xcb_connection_t *conn,
     if ((con = con_by_window_id(window)) == NULL || con->window == NULL)
         return false;
 
-    window_update_name_legacy(con->window, prop, false);
+    if (!window_update_name_legacy(con->window, prop, false))
+        return true;
+    con_mark_changed(con);
 
     x_push_changes(croot);
 
@@ -595,30 +713,75 @@ static int handle_windowclass_change(void *data, xcb_connection_t *conn, uint8_t
 }
 #endif
 
+/* An exposed area of a frame, see handle_pending_exposes(). */
+struct expose_area {
+    xcb_window_t frame;
+    Rect rect;
+};
+
+static struct expose_area *expose_areas;
+static int num_expose_areas;
+static int expose_areas_size;
+
+static bool rect_inside(Rect inner, Rect outer) {
+    return (inner.x >= outer.x && inner.y >= outer.y &&
+            inner.x + inner.width <= outer.x + outer.width &&
+            inner.y + inner.height <= outer.y + outer.height);
+}
+
 /*
  * Expose event means we should redraw our windows (= title bar)
  *
  */
 static void handle_expose_event(xcb_expose_event_t *event) {
-    Con *parent;
-
     DLOG("window = %08x\n", event->window);
 
-    if ((parent = con_by_frame_id(event->window)) == NULL) {
-        LOG("expose event for unknown window, ignoring\n");
-        return;
+    /* The area is only copied by handle_pending_exposes(), so that the same
+     * area being exposed again (e.g. while a floating window is moved over
+     * a tabbed container) is only copied once. */
+    Rect rect = { event->x, event->y, event->width, event->height };
+    for (int c = 0; c < num_expose_areas; c++) {
+        struct expose_area *area = &expose_areas[c];
+        if (area->frame != event->window)
+            continue;
+        if (rect_inside(rect, area->rect))
+            return;
+        if (rect_inside(area->rect, rect)) {
+            area->rect = rect;
+            return;
+        }
     }
 
-    /* Since we render to our pixmap on every change anyways, expose events
-     * only tell us that the X server lost (parts of) the window contents. We
-     * can handle that by copying the appropriate part from our pixmap to the
-     * window. */
-    xcb_copy_area(conn, parent->pixmap, parent->frame, parent->pm_gc,
-                  event->x, event->y, event->x, event->y,
-                  event->width, event->height);
-    xcb_flush(conn);
+    if (num_expose_areas == expose_areas_size) {
+        expose_areas_size = (expose_areas_size == 0 ? 16 : expose_areas_size * 2);
+        expose_areas = srealloc(expose_areas, expose_areas_size * sizeof(struct expose_area));
+    }
+    expose_areas[num_expose_areas++] = (struct expose_area){ event->window, rect };
+}
 
-    return;
+/*
+ * Copies the areas of all frames which were exposed since the last call from
+ * the pixmaps to the frames.
+ *
+ */
+void handle_pending_exposes(void) {
+    for (int c = 0; c < num_expose_areas; c++) {
+        struct expose_area *area = &expose_areas[c];
+        Con *con;
+        if ((con = con_by_frame_id(area->frame)) == NULL) {
+            LOG("expose event for unknown window, ignoring\n");
+            continue;
+        }
+
+        /* Since we render to our pixmap on every change anyways, expose events
+         * only tell us that the X server lost (parts of) the window contents. We
+         * can handle that by copying the appropriate part from our pixmap to the
+         * window. */
+        xcb_copy_area(conn, con->pixmap, con->frame, con->pm_gc,
+                      area->rect.x, area->rect.y, area->rect.x, area->rect.y,
+                      area->rect.width, area->rect.height);
+    }
+    num_expose_areas = 0;
 }
 
 /*
@@ -667,7 +830,7 @@ static void handle_client_message(xcb_client_message_event_t *event) {
                 con_set_urgency(con, !con->urgent);
         }
 
-        tree_render();
+        tree_render_later();
     } else if (event->type == A__NET_ACTIVE_WINDOW) {
         DLOG("_NET_ACTIVE_WINDOW: Window 0x%08x should be activated\n", event->window);
         Con *con = con_by_window_id(event->window);
@@ -691,12 +854,15 @@ static void handle_client_message(xcb_client_message_event_t *event) {
             workspace_show(ws);
 
         con_focus(con);
-        tree_render();
+        tree_render_later();
     } else if (event->type == A_I3_SYNC) {
         xcb_window_t window = event->data.data32[0];
         uint32_t rnd = event->data.data32[1];
         DLOG("[i3 sync protocol] Sending random value %d back to X11 window 0x%08x\n", rnd, window);
 
+        /* Whoever syncs expects all previous requests to be visible. */
+        tree_render_flush();
+
         void *reply = scalloc(32);
         xcb_client_message_event_t *ev = reply;
 
@@ -857,12 +1023,13 @@ static bool handle_normal_hints(void *data, xcb_connection_t *conn, uint8_t stat
 
     if (fabs(con->aspect_ratio - aspect_ratio) > DBL_EPSILON) {
         con->aspect_ratio = aspect_ratio;
+        con_mark_dirty(con);
         changed = true;
     }
 
 render_and_return:
     if (changed)
-        tree_render();
+        tree_render_later();
     FREE(reply);
     return true;
 }
@@ -884,7 +1051,7 @@ static bool handle_hints(void *data, xcb_connection_t *conn, uint8_t state, xcb_
         reply = xcb_get_property_reply(conn, xcb_icccm_get_wm_hints(conn, window), NULL);
     window_update_hints(con->window, reply, &urgency_hint);
     con_set_urgency(con, urgency_hint);
-    tree_render();
+    tree_render_later();
 
     return true;
 }
@@ -1030,9 +1197,29 @@ void property_handlers_init(void) {
     property_handlers[6].atom = A_WM_WINDOW_ROLE;
 }
 
+/* A PropertyNotify whose property was requested but not handled yet. */
+struct property_request {
+    struct property_handler_t *handler;
+    uint8_t state;
+    xcb_window_t window;
+    /* Not sent when the property was deleted. */
+    bool requested;
+    xcb_get_property_cookie_t cookie;
+
+    TAILQ_ENTRY(property_request) requests;
+};
+
+static TAILQ_HEAD(property_request_head, property_request) pending_properties =
+    TAILQ_HEAD_INITIALIZER(pending_properties);
+
+/*
+ * Requests the changed property, but leaves handling the reply to
+ * handle_pending_properties(), so that a burst of PropertyNotify events does
+ * not wait for one round trip per event.
+ *
+ */
 static void property_notify(uint8_t state, xcb_window_t window, xcb_atom_t atom) {
     struct property_handler_t *handler = NULL;
-    xcb_get_property_reply_t *propr = NULL;
 
     for (int c = 0; c < sizeof(property_handlers) / sizeof(struct property_handler_t); c++) {
         if (property_handlers[c].atom != atom)
@@ -1047,14 +1234,52 @@ static void property_notify(uint8_t state, xcb_window_t window, xcb_atom_t atom)
         return;
     }
 
-    if (state != XCB_PROPERTY_DELETE) {
-        xcb_get_property_cookie_t cookie = xcb_get_property(conn, 0, window, atom, XCB_GET_PROPERTY_TYPE_ANY, 0, handler->long_len);
-        propr = xcb_get_property_reply(conn, cookie, 0);
+    /* When the same property changes again before it was handled (e.g. a
+     * client updating its title in a loop), only the latest value matters.
+     * The older request is discarded, the reply might be outdated. */
+    struct property_request *req;
+    TAILQ_FOREACH(req, &pending_properties, requests) {
+        if (req->window == window && req->handler == handler)
+            break;
+    }
+
+    if (req != NULL) {
+        TAILQ_REMOVE(&pending_properties, req, requests);
+        if (req->requested)
+            xcb_discard_reply(conn, req->cookie.sequence);
+    } else {
+        req = scalloc(sizeof(struct property_request));
+        req->handler = handler;
+        req->window = window;
     }
 
-    /* the handler will free() the reply unless it returns false */
-    if (!handler->cb(NULL, conn, state, window, atom, propr))
-        FREE(propr);
+    req->state = state;
+    req->requested = (state != XCB_PROPERTY_DELETE);
+    if (req->requested)
+        req->cookie = xcb_get_property(conn, 0, window, atom, XCB_GET_PROPERTY_TYPE_ANY, 0, handler->long_len);
+    TAILQ_INSERT_TAIL(&pending_properties, req, requests);
+}
+
+/*
+ * Calls the property handlers for all PropertyNotify events received so far,
+ * in the order in which the properties last changed.
+ *
+ */
+void handle_pending_properties(void) {
+    struct property_request *req;
+    while (!TAILQ_EMPTY(&pending_properties)) {
+        req = TAILQ_FIRST(&pending_properties);
+        TAILQ_REMOVE(&pending_properties, req, requests);
+
+        xcb_get_property_reply_t *propr = NULL;
+        if (req->requested)
+            propr = xcb_get_property_reply(conn, req->cookie, 0);
+
+        /* the handler will free() the reply unless it returns false */
+        if (!req->handler->cb(NULL, conn, req->state, req->window, req->handler->atom, propr))
+            FREE(propr);
+        free(req);
+    }
 }
 
 /*
@@ -1062,13 +1287,34 @@ static void property_notify(uint8_t state, xcb_window_t window, xcb_atom_t atom)
  * event type.
  *
  */
-void handle_event(int type, xcb_generic_event_t *event) {
+static void dispatch_event(int type, xcb_generic_event_t *event) {
+    /* Consecutive PropertyNotify events are handled together, too, but any
+     * other event depends on them being handled in order. */
+    if (type != XCB_PROPERTY_NOTIFY)
+        handle_pending_properties();
+
+    /* Consecutive MapRequests are managed together. Any other event might
+     * refer to these windows, so they need to be managed first. */
+    if (type != XCB_MAP_REQUEST)
+        manage_pending_windows();
+
+    /* Only the latest geometry which floating windows asked for is applied,
+     * but before any other event which might depend on it. */
+    if (type != XCB_CONFIGURE_REQUEST && type != XCB_EXPOSE && type != XCB_MOTION_NOTIFY)
+        floating_apply_repositions();
+
     if (randr_base > -1 &&
         type == randr_base + XCB_RANDR_SCREEN_CHANGE_NOTIFY) {
         handle_screen_change(event);
         return;
     }
 
+    if (sync_base > -1 &&
+        type == sync_base + XCB_SYNC_ALARM_NOTIFY) {
+        sync_request_handle_alarm((xcb_sync_alarm_notify_event_t*)event);
+        return;
+    }
+
     switch (type) {
         case XCB_KEY_PRESS:
         case XCB_KEY_RELEASE:
@@ -1137,3 +1383,16 @@ void handle_event(int type, xcb_generic_event_t *event) {
             break;
     }
 }
+
+/*
+ * Takes an xcb_generic_event_t and calls the appropriate handler, based on the
+ * event type. The time spent in the handler is recorded for GET_STATS and the
+ * event itself for --record-events.
+ *
+ */
+void handle_event(int type, xcb_generic_event_t *event) {
+    event_record_event(event);
+    uint64_t start = stats_now();
+    dispatch_event(type, event);
+    stats_record(stats_for_event(type), start);
+}
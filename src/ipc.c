@@ -12,6 +12,7 @@
 #include "all.h"
 #include "yajl_utils.h"
 
+#include <stddef.h>
 #include <sys/socket.h>
 #include <sys/un.h>
 #include <fcntl.h>
@@ -24,6 +25,36 @@ char *current_socketpath = NULL;
 
 TAILQ_HEAD(ipc_client_head, ipc_client) all_clients = TAILQ_HEAD_INITIALIZER(all_clients);
 
+/* For every event type, the clients which are subscribed to it, so that
+ * sending an event does not need to look at uninterested clients. */
+static struct ipc_client_head subscribers[IPC_NUM_EVENT_TYPES] = {
+    TAILQ_HEAD_INITIALIZER(subscribers[0]),
+    TAILQ_HEAD_INITIALIZER(subscribers[1]),
+    TAILQ_HEAD_INITIALIZER(subscribers[2]),
+    TAILQ_HEAD_INITIALIZER(subscribers[3]),
+    TAILQ_HEAD_INITIALIZER(subscribers[4]),
+    TAILQ_HEAD_INITIALIZER(subscribers[5]),
+};
+
+/* The names of the event types, as used in subscribe messages. The index
+ * corresponds to IPC_EVENT_INDEX() of the I3_IPC_EVENT_* message types. */
+static const char *event_names[IPC_NUM_EVENT_TYPES] = {
+    "workspace",
+    "output",
+    "mode",
+    "window",
+    "barconfig_update",
+    "shutdown",
+};
+
+/* The file descriptor of the socket created by ipc_create_socket(), which is
+ * passed on to the new process on restart (see ipc_handoff()). */
+static int listen_fd = -1;
+
+/* The client whose message is currently being handled. It does not get
+ * handed off on restart, since it would never get its reply. */
+static ipc_client *handling_client;
+
 /*
  * Puts the given socket file descriptor into non-blocking mode or dies if
  * setting O_NONBLOCK failed. Non-blocking sockets are a good idea for our
@@ -67,26 +98,555 @@ static bool mkdirp(const char *path) {
     return result;
 }
 
+static void window_filter_free(ipc_window_filter *filter) {
+    if (filter == NULL)
+        return;
+
+    for (int i = 0; i < filter->num_changes; i++)
+        free(filter->changes[i]);
+    free(filter->changes);
+    regex_free(filter->class);
+    regex_free(filter->instance);
+    free(filter->workspace);
+    free(filter);
+}
+
+/*
+ * Closes the connection to the given client and frees all associated data.
+ *
+ */
+static void free_ipc_client(ipc_client *client) {
+    if (client->io != NULL)
+        ipc_io_close(client->io);
+    else close(client->fd);
+
+    ev_io_stop(main_loop, client->read_callback);
+    FREE(client->read_callback);
+    ev_io_stop(main_loop, client->write_callback);
+    FREE(client->write_callback);
+    ev_timer_stop(main_loop, client->batch_timer);
+    FREE(client->batch_timer);
+
+    for (int i = 0; i < IPC_NUM_EVENT_TYPES; i++)
+        if (client->events & (1 << i))
+            TAILQ_REMOVE(&subscribers[i], client, subscribers[i]);
+    free(client->buffer);
+    free(client->input.data);
+    window_filter_free(client->window_filter);
+
+    TAILQ_REMOVE(&all_clients, client, clients);
+
+    /* Don’t leave rendering suspended because of a client which went away
+     * in the middle of a batch. This can be reached while sending an event
+     * (when writing to the client fails), so the tree is rendered from the
+     * event loop instead of right here. */
+    for (; client->batch_depth > 0; client->batch_depth--)
+        tree_batch_end_later();
+    free(client);
+}
+
+/* Clients keep their output buffer allocated between messages as long as it
+ * does not exceed this size. */
+#define IPC_BUFFER_KEEP_SIZE (64 * 1024)
+
+/* Seconds after which the batch of a client is committed even if the client
+ * did not send 'batch commit' yet, see ipc_batch_timeout(). */
+#define IPC_BATCH_TIMEOUT 1.0
+
+/*
+ * Appends the given data to the client’s pending output, growing the buffer
+ * if necessary.
+ *
+ */
+static void ipc_buffer_append(ipc_client *client, const void *data, size_t len) {
+    if (client->buffer_offset + client->buffer_size + len > client->buffer_capacity) {
+        /* Move the pending output to the front first, maybe the space at the
+         * start of the buffer is already enough. */
+        if (client->buffer_offset > 0) {
+            memmove(client->buffer, client->buffer + client->buffer_offset, client->buffer_size);
+            client->buffer_offset = 0;
+        }
+        if (client->buffer_size + len > client->buffer_capacity) {
+            size_t capacity = (client->buffer_capacity > 0 ? client->buffer_capacity : 4096);
+            while (capacity < client->buffer_size + len)
+                capacity *= 2;
+            client->buffer = srealloc(client->buffer, capacity);
+            client->buffer_capacity = capacity;
+        }
+    }
+
+    memcpy(client->buffer + client->buffer_offset + client->buffer_size, data, len);
+    client->buffer_size += len;
+}
+
+/*
+ * Writes as much of the client’s pending output as possible without blocking.
+ * Starts the write watcher in case there is still output left, stops it
+ * otherwise.
+ *
+ * Returns false if the client has been disconnected due to a write error.
+ *
+ */
+static bool ipc_push_pending(ipc_client *client) {
+    /* Hand the pending output over to the I/O thread. The next message gets
+     * a new buffer. */
+    if (client->io != NULL && ipc_io_running()) {
+        if (client->buffer_size > 0) {
+            ipc_io_submit(client->io, client->buffer, client->buffer_offset, client->buffer_size);
+            client->buffer = NULL;
+            client->buffer_capacity = 0;
+            client->buffer_offset = 0;
+            client->buffer_size = 0;
+        }
+        return true;
+    }
+
+    while (client->buffer_size > 0) {
+        const ssize_t n = write(client->fd, client->buffer + client->buffer_offset, client->buffer_size);
+        if (n == -1) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+
+            ELOG("IPC: write() to client on fd %d failed: %s, disconnecting\n",
+                 client->fd, strerror(errno));
+            free_ipc_client(client);
+            return false;
+        }
+
+        client->buffer_offset += n;
+        client->buffer_size -= n;
+    }
+
+    if (client->buffer_size == 0) {
+        client->buffer_offset = 0;
+        /* Keep small buffers for the next message, but don’t hold on to the
+         * memory of a big tree dump forever. */
+        if (client->buffer_capacity > IPC_BUFFER_KEEP_SIZE) {
+            FREE(client->buffer);
+            client->buffer_capacity = 0;
+        }
+        ev_io_stop(main_loop, client->write_callback);
+    } else {
+        ev_io_start(main_loop, client->write_callback);
+    }
+    return true;
+}
+
+/*
+ * Handler for the socket of a client with pending output becoming writeable.
+ *
+ */
+static void ipc_socket_writeable_cb(EV_P_ struct ev_io *w, int revents) {
+    ipc_push_pending((ipc_client*)w->data);
+}
+
+/*
+ * Queues the header of a message with the given payload size. Replies to a
+ * message with a request id (see I3_IPC_REQUEST_ID_FLAG) are tagged with the
+ * same id, events (which might be sent while handling the message) are not.
+ *
+ */
+static void ipc_append_header(ipc_client *client, const uint32_t message_size,
+                              const uint32_t message_type) {
+    const bool tagged = (client->tag_reply && !(message_type & I3_IPC_EVENT_MASK));
+    const i3_ipc_header_t header = {
+        /* We don’t use I3_IPC_MAGIC because it’s a 0-terminated C string. */
+        .magic = { 'i', '3', '-', 'i', 'p', 'c' },
+        .size = message_size + (tagged ? sizeof(uint32_t) : 0),
+        .type = message_type | (tagged ? I3_IPC_REQUEST_ID_FLAG : 0)
+    };
+
+    ipc_buffer_append(client, &header, sizeof(i3_ipc_header_t));
+    if (tagged)
+        ipc_buffer_append(client, &(client->request_id), sizeof(uint32_t));
+}
+
+/*
+ * Queues a message (header and payload) for the given client and tries to
+ * send it right away. Never blocks: whatever the socket does not accept
+ * stays in the client’s buffer until it becomes writeable again.
+ *
+ * Returns false if the client has been disconnected.
+ *
+ */
+static bool ipc_send_client_message(ipc_client *client, const uint32_t message_size,
+                                    const uint32_t message_type, const uint8_t *payload) {
+    ipc_append_header(client, message_size, message_type);
+    ipc_buffer_append(client, payload, message_size);
+
+    /* If there already was pending output, the socket is not writeable
+     * anyway, so we leave it to the write watcher. */
+    if (ev_is_active(client->write_callback))
+        return true;
+
+    return ipc_push_pending(client);
+}
+
+/* The CBOR translation of a JSON payload, shared by all clients which get
+ * the same message (see ipc_send_encoded()). */
+struct translated_payload {
+    uint8_t *cbor;
+    size_t length;
+};
+
+/*
+ * Like ipc_send_client_message(), but sends the given JSON payload in the
+ * encoding which the client requested. The payload is translated only once
+ * for all clients which share translated.
+ *
+ */
+static bool ipc_send_encoded(ipc_client *client, const uint32_t message_size,
+                             const uint32_t message_type, const uint8_t *payload,
+                             struct translated_payload *translated) {
+    if (client->encoding != IPC_ENCODING_CBOR)
+        return ipc_send_client_message(client, message_size, message_type, payload);
+
+    if (translated->cbor == NULL)
+        translated->cbor = ipc_cbor_from_json(payload, message_size, &(translated->length));
+    return ipc_send_client_message(client, translated->length, message_type, translated->cbor);
+}
+
+/*
+ * Returns the client connected on the given file descriptor, or NULL.
+ *
+ */
+static ipc_client *ipc_client_for_fd(int fd) {
+    ipc_client *current;
+    TAILQ_FOREACH(current, &all_clients, clients)
+        if (current->fd == fd)
+            return current;
+    return NULL;
+}
+
+/*
+ * Sends a reply to the client connected on the given file descriptor. All
+ * output to clients goes through their queue so that replies and events
+ * never get interleaved.
+ *
+ */
+static void ipc_send_reply(int fd, const uint32_t message_size,
+                           const uint32_t message_type, const uint8_t *payload) {
+    ipc_client *client = ipc_client_for_fd(fd);
+    if (client == NULL) {
+        DLOG("IPC: no client on fd %d (anymore), dropping reply\n", fd);
+        return;
+    }
+
+    struct translated_payload translated = { NULL, 0 };
+    ipc_send_encoded(client, message_size, message_type, payload, &translated);
+    free(translated.cbor);
+}
+
+/*
+ * yajl print callback for streamed replies: appends the generated JSON
+ * directly to the client’s output buffer.
+ *
+ */
+static void ipc_stream_print(void *ctx, const char *str, ylength len) {
+    ipc_buffer_append((ipc_client*)ctx, str, len);
+}
+
+static void ipc_stream_cbor_write(void *ctx, const void *data, size_t len) {
+    ipc_buffer_append((ipc_client*)ctx, data, len);
+}
+
+/*
+ * yajl print callback for streamed replies to clients which requested CBOR:
+ * translates the generated JSON right away.
+ *
+ */
+static void ipc_stream_translate(void *ctx, const char *str, ylength len) {
+    ipc_cbor_feed((ipc_cbor*)ctx, (const unsigned char*)str, len);
+}
+
+/*
+ * Starts a streamed reply of the given type to the given client: queues a
+ * header (the size is filled in by ipc_stream_end()) and returns a yajl_gen
+ * which writes the payload straight into the client’s output buffer, so that
+ * big replies (tree dumps) do not need to be built in a separate buffer and
+ * copied afterwards.
+ *
+ * The position of the header is stored in header_pos and has to be passed to
+ * ipc_stream_end().
+ *
+ */
+static yajl_gen ipc_stream_begin(ipc_client *client, uint32_t message_type, size_t *header_pos) {
+    /* Nothing is written to the socket until ipc_stream_end(), so the
+     * position relative to the pending output stays valid. */
+    *header_pos = client->buffer_size;
+    ipc_append_header(client, 0, message_type);
+
+    yajl_print_t print = ipc_stream_print;
+    void *ctx = client;
+    if (client->encoding == IPC_ENCODING_CBOR) {
+        client->stream_cbor = ipc_cbor_new(ipc_stream_cbor_write, client);
+        print = ipc_stream_translate;
+        ctx = client->stream_cbor;
+    }
+
+#if YAJL_MAJOR >= 2
+    yajl_gen gen = yajl_gen_alloc(NULL);
+    yajl_gen_config(gen, yajl_gen_print_callback, print, ctx);
+#else
+    yajl_gen gen = yajl_gen_alloc2(print, NULL, NULL, ctx);
+#endif
+    return gen;
+}
+
+/*
+ * Finishes a streamed reply started with ipc_stream_begin(): fills in the
+ * payload size and sends the reply.
+ *
+ */
+static void ipc_stream_end(ipc_client *client, yajl_gen gen, size_t header_pos) {
+    y(free);
+    if (client->stream_cbor != NULL) {
+        if (!ipc_cbor_finish(client->stream_cbor))
+            ELOG("IPC: could not translate the reply into CBOR\n");
+        client->stream_cbor = NULL;
+    }
+
+    const uint32_t size = client->buffer_size - header_pos - sizeof(i3_ipc_header_t);
+    memcpy(client->buffer + client->buffer_offset + header_pos + offsetof(i3_ipc_header_t, size),
+           &size, sizeof(uint32_t));
+
+    if (!ev_is_active(client->write_callback))
+        ipc_push_pending(client);
+}
+
+/*
+ * Returns the number of bytes of output which were not written to the
+ * client’s socket yet.
+ *
+ */
+static size_t ipc_pending_output(ipc_client *client) {
+    return client->buffer_size + (client->io != NULL ? ipc_io_pending(client->io) : 0);
+}
+
+/*
+ * Clients which do not read their events (for example because they hang)
+ * accumulate pending output. Once that exceeds the configured limit, the
+ * client gets disconnected instead of letting the buffer grow unbounded.
+ * Returns false in that case.
+ *
+ */
+static bool ipc_check_buffer_limit(ipc_client *client) {
+    const size_t pending = ipc_pending_output(client);
+    if (config.ipc_buffer_limit == 0 ||
+        pending <= config.ipc_buffer_limit)
+        return true;
+
+    ELOG("IPC: client on fd %d has %zu bytes of unread output, disconnecting\n",
+         client->fd, pending);
+    free_ipc_client(client);
+    return false;
+}
+
 /*
  * Sends the specified event to all IPC clients which are currently connected
  * and subscribed to this kind of event.
  *
  */
 void ipc_send_event(const char *event, uint32_t message_type, const char *payload) {
-    ipc_client *current;
-    TAILQ_FOREACH(current, &all_clients, clients) {
-        /* see if this client is interested in this event */
-        bool interested = false;
-        for (int i = 0; i < current->num_events; i++) {
-            if (strcasecmp(current->events[i], event) != 0)
-                continue;
-            interested = true;
-            break;
+    const uint32_t idx = IPC_EVENT_INDEX(message_type);
+    assert(idx < IPC_NUM_EVENT_TYPES);
+
+    if (message_type == I3_IPC_EVENT_WORKSPACE || message_type == I3_IPC_EVENT_OUTPUT)
+        ipc_invalidate_cached_replies();
+
+    struct translated_payload translated = { NULL, 0 };
+    ipc_client *current, *next;
+    for (current = TAILQ_FIRST(&subscribers[idx]); current != TAILQ_END(&subscribers[idx]); current = next) {
+        next = TAILQ_NEXT(current, subscribers[idx]);
+
+        if (!ipc_check_buffer_limit(current))
+            continue;
+
+        ipc_send_encoded(current, strlen(payload), message_type, (const uint8_t*)payload, &translated);
+    }
+    free(translated.cbor);
+}
+
+/*
+ * Returns true if at least one client is subscribed to the given event
+ * (I3_IPC_EVENT_*).
+ *
+ */
+bool ipc_has_subscribers(uint32_t message_type) {
+    const uint32_t idx = IPC_EVENT_INDEX(message_type);
+    assert(idx < IPC_NUM_EVENT_TYPES);
+    return !TAILQ_EMPTY(&subscribers[idx]);
+}
+
+/*
+ * Like ipc_send_event(), but the payload is only generated (by calling
+ * serialize with the given data) if any client is subscribed to the event.
+ * The payload is generated once and sent to all subscribers.
+ *
+ */
+void ipc_send_event_lazy(const char *event, uint32_t message_type,
+                         ipc_serializer_t serialize, void *data) {
+    if (!ipc_has_subscribers(message_type)) {
+        if (message_type == I3_IPC_EVENT_WORKSPACE || message_type == I3_IPC_EVENT_OUTPUT)
+            ipc_invalidate_cached_replies();
+        return;
+    }
+
+    setlocale(LC_NUMERIC, "C");
+    yajl_gen gen = ygenalloc();
+
+    serialize(gen, data);
+
+    const unsigned char *payload;
+    ylength length;
+    y(get_buf, &payload, &length);
+
+    ipc_send_event(event, message_type, (const char *)payload);
+    y(free);
+    setlocale(LC_NUMERIC, "");
+}
+
+static bool window_filter_matches(ipc_window_filter *filter, const char *change, Con *con) {
+    if (filter == NULL)
+        return true;
+
+    if (filter->num_changes > 0) {
+        int i;
+        for (i = 0; i < filter->num_changes; i++)
+            if (strcmp(filter->changes[i], change) == 0)
+                break;
+        if (i == filter->num_changes)
+            return false;
+    }
+
+    if (filter->class != NULL &&
+        (con->window == NULL || con->window->class_class == NULL ||
+         !regex_matches(filter->class, con->window->class_class)))
+        return false;
+
+    if (filter->instance != NULL &&
+        (con->window == NULL || con->window->class_instance == NULL ||
+         !regex_matches(filter->instance, con->window->class_instance)))
+        return false;
+
+    if (filter->workspace != NULL) {
+        Con *ws = con_get_workspace(con);
+        if (ws == NULL || strcmp(ws->name, filter->workspace) != 0)
+            return false;
+    }
+
+    return true;
+}
+
+/*
+ * Sends the window event with the given change (e.g. "new") for the given
+ * container to all subscribers whose filter it matches. The payload is only
+ * generated if it is sent to at least one client.
+ *
+ */
+void ipc_send_window_event(const char *change, Con *con) {
+    const uint32_t idx = IPC_EVENT_INDEX(I3_IPC_EVENT_WINDOW);
+    yajl_gen gen = NULL;
+    const unsigned char *payload;
+    ylength length;
+    struct translated_payload translated = { NULL, 0 };
+
+    ipc_client *current, *next;
+    for (current = TAILQ_FIRST(&subscribers[idx]); current != TAILQ_END(&subscribers[idx]); current = next) {
+        next = TAILQ_NEXT(current, subscribers[idx]);
+
+        if (!window_filter_matches(current->window_filter, change, con) ||
+            !ipc_check_buffer_limit(current))
+            continue;
+
+        if (gen == NULL) {
+            setlocale(LC_NUMERIC, "C");
+            gen = ygenalloc();
+
+            y(map_open);
+            ystr("change");
+            ystr(change);
+            ystr("container");
+            dump_node(gen, con, false);
+            y(map_close);
+
+            y(get_buf, &payload, &length);
         }
-        if (!interested)
+
+        ipc_send_encoded(current, length, I3_IPC_EVENT_WINDOW, payload, &translated);
+    }
+
+    free(translated.cbor);
+    if (gen != NULL) {
+        y(free);
+        setlocale(LC_NUMERIC, "");
+    }
+}
+
+/*
+ * Prepares an inplace restart: sends the shutdown event and keeps the
+ * listening socket and the connections of idle clients open across exec(),
+ * so that the clients do not need to reconnect. They are passed on in the
+ * environment variables I3_IPC_LISTEN_FD and I3_IPC_CLIENTS (see
+ * ipc_create_socket() and ipc_adopt_clients()).
+ *
+ * Clients which are in the middle of a message (including the one which sent
+ * the restart command), still have pending output, use a window event
+ * filter or started a batch are disconnected like on exit. So are i3bars:
+ * they exit when the connection is closed, and the new process starts a bar
+ * for every configured one again.
+ *
+ */
+void ipc_handoff(void) {
+    ipc_send_event("shutdown", I3_IPC_EVENT_SHUTDOWN, "{\"change\":\"restart\"}");
+
+    /* The output which the I/O thread could not write yet counts as pending
+     * below. */
+    ipc_io_stop();
+
+    char *clients = sstrdup("");
+    ipc_client *current, *next;
+    for (current = TAILQ_FIRST(&all_clients); current != TAILQ_END(&all_clients); current = next) {
+        next = TAILQ_NEXT(current, clients);
+
+        /* Give the client a last chance to read the shutdown event. */
+        if (current->buffer_size > 0 && !ipc_push_pending(current))
             continue;
 
-        ipc_send_message(current->fd, strlen(payload), message_type, (const uint8_t*)payload);
+        int flags;
+        if (current == handling_client ||
+            ipc_pending_output(current) > 0 || current->input.size > 0 ||
+            current->window_filter != NULL || current->batch_depth > 0 ||
+            current->is_bar ||
+            (flags = fcntl(current->fd, F_GETFD)) < 0 ||
+            fcntl(current->fd, F_SETFD, flags & ~FD_CLOEXEC) < 0) {
+            DLOG("IPC: not handing off client on fd %d\n", current->fd);
+            shutdown(current->fd, SHUT_RDWR);
+            free_ipc_client(current);
+            continue;
+        }
+
+        char *entry;
+        sasprintf(&entry, "%s%s%d:%d:%u", clients, (clients[0] == '\0' ? "" : ","),
+                  current->fd, current->encoding, current->events);
+        free(clients);
+        clients = entry;
+    }
+
+    if (clients[0] != '\0')
+        setenv("I3_IPC_CLIENTS", clients, 1);
+    free(clients);
+
+    int flags;
+    if (listen_fd != -1 &&
+        (flags = fcntl(listen_fd, F_GETFD)) >= 0 &&
+        fcntl(listen_fd, F_SETFD, flags & ~FD_CLOEXEC) >= 0) {
+        char *fd;
+        sasprintf(&fd, "%d", listen_fd);
+        setenv("I3_IPC_LISTEN_FD", fd, 1);
+        free(fd);
     }
 }
 
@@ -100,12 +660,17 @@ void ipc_shutdown(void) {
     while (!TAILQ_EMPTY(&all_clients)) {
         current = TAILQ_FIRST(&all_clients);
         shutdown(current->fd, SHUT_RDWR);
-        close(current->fd);
-        TAILQ_REMOVE(&all_clients, current, clients);
-        free(current);
+        free_ipc_client(current);
     }
 }
 
+#if YAJL_MAJOR > 2 || (YAJL_MAJOR == 2 && YAJL_MINOR >= 1)
+/* The generator for the replies to COMMAND messages is reused (resetting it
+ * needs yajl_gen_reset(), available since yajl 2.1). */
+static yajl_gen command_gen;
+static bool command_gen_busy;
+#endif
+
 /*
  * Executes the command and returns whether it could be successfully parsed
  * or not (at the moment, always returns true).
@@ -117,20 +682,74 @@ IPC_HANDLER(command) {
     char *command = scalloc(message_size + 1);
     strncpy(command, (const char*)message, message_size);
     LOG("IPC: received: *%s*\n", command);
-    struct CommandResult *command_output = parse_command((const char*)command);
+
+    /* Commands which render the tree themselves (e.g. when switching
+     * workspaces) should not push intermediate states to X11, so the whole
+     * message is rendered once at the end. */
+    tree_batch_begin();
+
+#if YAJL_MAJOR > 2 || (YAJL_MAJOR == 2 && YAJL_MINOR >= 1)
+    /* A command could run the event loop (and therefore this handler)
+     * again, in which case the nested call gets its own generator. */
+    const bool reuse_gen = !command_gen_busy;
+    yajl_gen gen;
+    if (reuse_gen) {
+        if (command_gen == NULL)
+            command_gen = ygenalloc();
+        gen = command_gen;
+        command_gen_busy = true;
+    } else gen = ygenalloc();
+#else
+    yajl_gen gen = ygenalloc();
+#endif
+    event_record_command((const char*)command);
+    struct CommandResult *command_output = parse_command((const char*)command, gen);
     free(command);
 
+    /* 'batch begin' / 'batch commit' extend this over multiple messages. The
+     * client might already be gone if it was disconnected while sending an
+     * event. */
+    ipc_client *client = ipc_client_for_fd(fd);
+    if (client != NULL) {
+        for (; command_output->batch > 0; command_output->batch--) {
+            tree_batch_begin();
+            client->batch_depth++;
+        }
+        for (; command_output->batch < 0 && client->batch_depth > 0; command_output->batch++) {
+            tree_batch_end();
+            client->batch_depth--;
+        }
+
+        /* The timeout starts with the outermost batch, more messages do not
+         * extend it. */
+        if (client->batch_depth == 0)
+            ev_timer_stop(main_loop, client->batch_timer);
+        else if (!ev_is_active(client->batch_timer)) {
+            ev_timer_set(client->batch_timer, IPC_BATCH_TIMEOUT, 0.);
+            ev_timer_start(main_loop, client->batch_timer);
+        }
+    }
+
     if (command_output->needs_tree_render)
         tree_render();
+    tree_batch_end();
 
     const unsigned char *reply;
     ylength length;
-    yajl_gen_get_buf(command_output->json_gen, &reply, &length);
+    y(get_buf, &reply, &length);
 
-    ipc_send_message(fd, length, I3_IPC_REPLY_TYPE_COMMAND,
+    ipc_send_reply(fd, length, I3_IPC_REPLY_TYPE_COMMAND,
                      (const uint8_t*)reply);
 
-    yajl_gen_free(command_output->json_gen);
+#if YAJL_MAJOR > 2 || (YAJL_MAJOR == 2 && YAJL_MINOR >= 1)
+    if (reuse_gen) {
+        y(clear);
+        y(reset, NULL);
+        command_gen_busy = false;
+        return;
+    }
+#endif
+    y(free);
 }
 
 static void dump_rect(yajl_gen gen, const char *name, Rect r) {
@@ -147,53 +766,7 @@ static void dump_rect(yajl_gen gen, const char *name, Rect r) {
     y(map_close);
 }
 
-void dump_node(yajl_gen gen, struct Con *con, bool inplace_restart) {
-    y(map_open);
-    ystr("id");
-    y(integer, (long int)con);
-
-    ystr("type");
-    y(integer, con->type);
-
-    /* provided for backwards compatibility only. */
-    ystr("orientation");
-    if (!con_is_split(con))
-        ystr("none");
-    else {
-        if (con_orientation(con) == HORIZ)
-            ystr("horizontal");
-        else ystr("vertical");
-    }
-
-    ystr("scratchpad_state");
-    switch (con->scratchpad_state) {
-        case SCRATCHPAD_NONE:
-            ystr("none");
-            break;
-        case SCRATCHPAD_FRESH:
-            ystr("fresh");
-            break;
-        case SCRATCHPAD_CHANGED:
-            ystr("changed");
-            break;
-    }
-
-    ystr("percent");
-    if (con->percent == 0.0)
-        y(null);
-    else y(double, con->percent);
-
-    ystr("urgent");
-    y(bool, con->urgent);
-
-    if (con->mark != NULL) {
-        ystr("mark");
-        ystr(con->mark);
-    }
-
-    ystr("focused");
-    y(bool, (con == focused));
-
+static void dump_layout(yajl_gen gen, Con *con) {
     ystr("layout");
     switch (con->layout) {
         case L_DEFAULT:
@@ -219,7 +792,9 @@ void dump_node(yajl_gen gen, struct Con *con, bool inplace_restart) {
             ystr("output");
             break;
     }
+}
 
+static void dump_workspace_layout(yajl_gen gen, Con *con) {
     ystr("workspace_layout");
     switch (con->workspace_layout) {
         case L_DEFAULT:
@@ -236,59 +811,226 @@ void dump_node(yajl_gen gen, struct Con *con, bool inplace_restart) {
             assert(false);
             break;
     }
+}
 
-    ystr("last_split_layout");
-    switch (con->layout) {
-        case L_SPLITV:
-            ystr("splitv");
-            break;
-        default:
-            ystr("splith");
-            break;
+static void dump_swallows(yajl_gen gen, Con *con, bool inplace_restart) {
+    ystr("swallows");
+    y(array_open);
+    Match *match;
+    TAILQ_FOREACH(match, &(con->swallow_head), matches) {
+        if (match->dock != -1) {
+            y(map_open);
+            ystr("dock");
+            y(integer, match->dock);
+            ystr("insert_where");
+            y(integer, match->insert_where);
+            y(map_close);
+        }
+
+        /* TODO: the other swallow keys */
     }
 
-    ystr("border");
-    switch (con->border_style) {
-        case BS_NORMAL:
-            ystr("normal");
-            break;
-        case BS_NONE:
+    if (inplace_restart) {
+        if (con->window != NULL) {
+            y(map_open);
+            ystr("id");
+            y(integer, con->window->id);
+            ystr("restart_mode");
+            y(bool, true);
+            y(map_close);
+        }
+    }
+    y(array_close);
+}
+
+/* The properties of a container in GET_TREE replies, which clients can
+ * select (see parse_tree_request()). "nodes" and "floating_nodes" are always
+ * included. */
+enum {
+    DF_ID = 0,
+    DF_TYPE,
+    DF_ORIENTATION,
+    DF_SCRATCHPAD_STATE,
+    DF_PERCENT,
+    DF_URGENT,
+    DF_MARK,
+    DF_FOCUSED,
+    DF_LAYOUT,
+    DF_WORKSPACE_LAYOUT,
+    DF_LAST_SPLIT_LAYOUT,
+    DF_BORDER,
+    DF_CURRENT_BORDER_WIDTH,
+    DF_RECT,
+    DF_WINDOW_RECT,
+    DF_GEOMETRY,
+    DF_NAME,
+    DF_NUM,
+    DF_WINDOW,
+    DF_FOCUS,
+    DF_FULLSCREEN_MODE,
+    DF_FLOATING,
+    DF_SWALLOWS,
+    DF_DEPTH,
+    DF_NUM_FIELDS
+};
+
+/* Indexed by the DF_* values above. */
+static const char *dump_field_names[DF_NUM_FIELDS] = {
+    "id", "type", "orientation", "scratchpad_state", "percent", "urgent",
+    "mark", "focused", "layout", "workspace_layout", "last_split_layout",
+    "border", "current_border_width", "rect", "window_rect", "geometry",
+    "name", "num", "window", "focus", "fullscreen_mode", "floating",
+    "swallows", "depth"
+};
+
+#define DUMP_ALL_FIELDS ((uint32_t)-1)
+#define WANT(field) (fields & (1 << DF_##field))
+
+/*
+ * Dumps the given container. If recursive is false, the "nodes" and
+ * "floating_nodes" arrays only contain the IDs of the children (like the
+ * "focus" array) instead of the children themselves.
+ *
+ * Only the properties whose bits (1 << DF_*) are set in fields are dumped.
+ *
+ */
+static void dump_con(yajl_gen gen, struct Con *con, bool inplace_restart, bool recursive, uint32_t fields) {
+    y(map_open);
+    if (WANT(ID)) {
+        ystr("id");
+        y(integer, (long int)con);
+    }
+
+    if (WANT(TYPE)) {
+        ystr("type");
+        y(integer, con->type);
+    }
+
+    /* provided for backwards compatibility only. */
+    if (WANT(ORIENTATION)) {
+        ystr("orientation");
+        if (!con_is_split(con))
             ystr("none");
-            break;
-        case BS_PIXEL:
-            ystr("pixel");
-            break;
+        else {
+            if (con_orientation(con) == HORIZ)
+                ystr("horizontal");
+            else ystr("vertical");
+        }
+    }
+
+    if (WANT(SCRATCHPAD_STATE)) {
+        ystr("scratchpad_state");
+        switch (con->scratchpad_state) {
+            case SCRATCHPAD_NONE:
+                ystr("none");
+                break;
+            case SCRATCHPAD_FRESH:
+                ystr("fresh");
+                break;
+            case SCRATCHPAD_CHANGED:
+                ystr("changed");
+                break;
+        }
+    }
+
+    if (WANT(PERCENT)) {
+        ystr("percent");
+        if (con->percent == 0.0)
+            y(null);
+        else y(double, con->percent);
+    }
+
+    if (WANT(URGENT)) {
+        ystr("urgent");
+        y(bool, con->urgent);
+    }
+
+    if (WANT(MARK) && con->mark != NULL) {
+        ystr("mark");
+        ystr(con->mark);
+    }
+
+    if (WANT(FOCUSED)) {
+        ystr("focused");
+        y(bool, (con == focused));
+    }
+
+    if (WANT(LAYOUT))
+        dump_layout(gen, con);
+
+    if (WANT(WORKSPACE_LAYOUT))
+        dump_workspace_layout(gen, con);
+
+    if (WANT(LAST_SPLIT_LAYOUT)) {
+        ystr("last_split_layout");
+        switch (con->layout) {
+            case L_SPLITV:
+                ystr("splitv");
+                break;
+            default:
+                ystr("splith");
+                break;
+        }
+    }
+
+    if (WANT(BORDER)) {
+        ystr("border");
+        switch (con->border_style) {
+            case BS_NORMAL:
+                ystr("normal");
+                break;
+            case BS_NONE:
+                ystr("none");
+                break;
+            case BS_PIXEL:
+                ystr("pixel");
+                break;
+        }
     }
 
-    ystr("current_border_width");
-    y(integer, con->current_border_width);
+    if (WANT(CURRENT_BORDER_WIDTH)) {
+        ystr("current_border_width");
+        y(integer, con->current_border_width);
+    }
 
-    dump_rect(gen, "rect", con->rect);
-    dump_rect(gen, "window_rect", con->window_rect);
-    dump_rect(gen, "geometry", con->geometry);
+    if (WANT(RECT))
+        dump_rect(gen, "rect", con->rect);
+    if (WANT(WINDOW_RECT))
+        dump_rect(gen, "window_rect", con->window_rect);
+    if (WANT(GEOMETRY))
+        dump_rect(gen, "geometry", con->geometry);
 
-    ystr("name");
-    if (con->window && con->window->name)
-        ystr(i3string_as_utf8(con->window->name));
-    else
-        ystr(con->name);
+    if (WANT(NAME)) {
+        ystr("name");
+        if (con->window && con->window->name)
+            ystr(i3string_as_utf8(con->window->name));
+        else
+            ystr(con->name);
+    }
 
-    if (con->type == CT_WORKSPACE) {
+    if (WANT(NUM) && con->type == CT_WORKSPACE) {
         ystr("num");
         y(integer, con->num);
     }
 
-    ystr("window");
-    if (con->window)
-        y(integer, con->window->id);
-    else y(null);
+    if (WANT(WINDOW)) {
+        ystr("window");
+        if (con->window)
+            y(integer, con->window->id);
+        else y(null);
+    }
 
     ystr("nodes");
     y(array_open);
     Con *node;
     if (con->type != CT_DOCKAREA || !inplace_restart) {
-        TAILQ_FOREACH(node, &(con->nodes_head), nodes) {
-            dump_node(gen, node, inplace_restart);
+        int children;
+        Con **nodes = con_children(con, &children);
+        for (int i = 0; i < children; i++) {
+            node = nodes[i];
+            if (recursive)
+                dump_con(gen, node, inplace_restart, true, fields);
+            else y(integer, (long int)node);
         }
     }
     y(array_close);
@@ -296,65 +1038,48 @@ void dump_node(yajl_gen gen, struct Con *con, bool inplace_restart) {
     ystr("floating_nodes");
     y(array_open);
     TAILQ_FOREACH(node, &(con->floating_head), floating_windows) {
-        dump_node(gen, node, inplace_restart);
+        if (recursive)
+            dump_con(gen, node, inplace_restart, true, fields);
+        else y(integer, (long int)node);
     }
     y(array_close);
 
-    ystr("focus");
-    y(array_open);
-    TAILQ_FOREACH(node, &(con->focus_head), focused) {
-        y(integer, (long int)node);
+    if (WANT(FOCUS)) {
+        ystr("focus");
+        y(array_open);
+        TAILQ_FOREACH(node, &(con->focus_head), focused) {
+            y(integer, (long int)node);
+        }
+        y(array_close);
     }
-    y(array_close);
-
-    ystr("fullscreen_mode");
-    y(integer, con->fullscreen_mode);
 
-    ystr("floating");
-    switch (con->floating) {
-        case FLOATING_AUTO_OFF:
-            ystr("auto_off");
-            break;
-        case FLOATING_AUTO_ON:
-            ystr("auto_on");
-            break;
-        case FLOATING_USER_OFF:
-            ystr("user_off");
-            break;
-        case FLOATING_USER_ON:
-            ystr("user_on");
-            break;
+    if (WANT(FULLSCREEN_MODE)) {
+        ystr("fullscreen_mode");
+        y(integer, con->fullscreen_mode);
     }
 
-    ystr("swallows");
-    y(array_open);
-    Match *match;
-    TAILQ_FOREACH(match, &(con->swallow_head), matches) {
-        if (match->dock != -1) {
-            y(map_open);
-            ystr("dock");
-            y(integer, match->dock);
-            ystr("insert_where");
-            y(integer, match->insert_where);
-            y(map_close);
+    if (WANT(FLOATING)) {
+        ystr("floating");
+        switch (con->floating) {
+            case FLOATING_AUTO_OFF:
+                ystr("auto_off");
+                break;
+            case FLOATING_AUTO_ON:
+                ystr("auto_on");
+                break;
+            case FLOATING_USER_OFF:
+                ystr("user_off");
+                break;
+            case FLOATING_USER_ON:
+                ystr("user_on");
+                break;
         }
-
-        /* TODO: the other swallow keys */
     }
 
-    if (inplace_restart) {
-        if (con->window != NULL) {
-            y(map_open);
-            ystr("id");
-            y(integer, con->window->id);
-            ystr("restart_mode");
-            y(bool, true);
-            y(map_close);
-        }
-    }
-    y(array_close);
+    if (WANT(SWALLOWS))
+        dump_swallows(gen, con, inplace_restart);
 
-    if (inplace_restart && con->window != NULL) {
+    if (WANT(DEPTH) && inplace_restart && con->window != NULL) {
         ystr("depth");
         y(integer, con->depth);
     }
@@ -362,28 +1087,319 @@ void dump_node(yajl_gen gen, struct Con *con, bool inplace_restart) {
     y(map_close);
 }
 
-IPC_HANDLER(tree) {
+#undef WANT
+
+void dump_node(yajl_gen gen, struct Con *con, bool inplace_restart) {
+    dump_con(gen, con, inplace_restart, true, DUMP_ALL_FIELDS);
+}
+
+/*
+ * Dumps (non-recursively) every container below and including con which
+ * changed after the given generation. Subtrees in which nothing changed are
+ * skipped entirely.
+ *
+ */
+static void dump_changed_nodes(yajl_gen gen, Con *con, uint64_t since) {
+    if (con->subtree_generation <= since)
+        return;
+
+    if (con->generation > since)
+        dump_con(gen, con, false, false, DUMP_ALL_FIELDS);
+
+    int children;
+    Con **nodes = con_children(con, &children);
+    for (int i = 0; i < children; i++)
+        dump_changed_nodes(gen, nodes[i], since);
+    Con *node;
+    TAILQ_FOREACH(node, &(con->floating_head), floating_windows)
+        dump_changed_nodes(gen, node, since);
+}
+
+/*
+ * Returns all containers which changed since the generation given as payload
+ * (as decimal number, an empty payload or 0 returns all containers), together
+ * with the current generation which is to be used for the next request.
+ *
+ */
+IPC_HANDLER(get_tree_delta) {
+    ipc_client *client = ipc_client_for_fd(fd);
+    if (client == NULL)
+        return;
+
+    /* To get a properly terminated buffer, we copy
+     * message_size bytes out of the buffer */
+    char *since_str = scalloc(message_size + 1);
+    strncpy(since_str, (const char*)message, message_size);
+    char *endptr;
+    uint64_t since = strtoull(since_str, &endptr, 10);
+    if (*endptr != '\0')
+        since = 0;
+    free(since_str);
+
+    /* Containers which change after this reply get a higher generation. */
+    const uint64_t generation = tree_generation++;
+
+    size_t header_pos;
     setlocale(LC_NUMERIC, "C");
-    yajl_gen gen = ygenalloc();
-    dump_node(gen, croot, false);
+    yajl_gen gen = ipc_stream_begin(client, I3_IPC_REPLY_TYPE_TREE_DELTA, &header_pos);
+
+    y(map_open);
+
+    ystr("generation");
+    y(integer, generation);
+
+    ystr("focused");
+    y(integer, (long int)focused);
+
+    ystr("nodes");
+    y(array_open);
+    dump_changed_nodes(gen, croot, since);
+    y(array_close);
+
+    y(map_close);
     setlocale(LC_NUMERIC, "");
+    ipc_stream_end(client, gen, header_pos);
+}
 
-    const unsigned char *payload;
-    ylength length;
-    y(get_buf, &payload, &length);
+/* State of parsing a GET_TREE payload, see parse_tree_request(). */
+struct tree_request {
+    Con *root;
+    uint32_t fields;
+    char *key;
+    int depth;
+    bool in_fields;
+    const char *error;
+};
 
-    ipc_send_message(fd, length, I3_IPC_REPLY_TYPE_TREE, payload);
-    y(free);
+static int tree_request_map_key(void *extra, const unsigned char *s, ylength len) {
+    struct tree_request *request = extra;
+    FREE(request->key);
+    request->key = smalloc(len + 1);
+    memcpy(request->key, s, len);
+    request->key[len] = '\0';
+    return 1;
+}
+
+static int tree_request_start_map(void *extra) {
+    struct tree_request *request = extra;
+    if (++request->depth != 1) {
+        request->error = "Unexpected map";
+        return 0;
+    }
+    return 1;
+}
+
+static int tree_request_end_map(void *extra) {
+    struct tree_request *request = extra;
+    request->depth--;
+    return 1;
+}
+
+static int tree_request_start_array(void *extra) {
+    struct tree_request *request = extra;
+    if (request->depth != 1 || request->in_fields || request->key == NULL ||
+        strcmp(request->key, "fields") != 0) {
+        request->error = "Unexpected array";
+        return 0;
+    }
+    request->in_fields = true;
+    request->fields = 0;
+    return 1;
+}
+
+static int tree_request_end_array(void *extra) {
+    struct tree_request *request = extra;
+    request->in_fields = false;
+    return 1;
+}
+
+#if YAJL_MAJOR >= 2
+static int tree_request_integer(void *extra, long long val) {
+#else
+static int tree_request_integer(void *extra, long val) {
+#endif
+    struct tree_request *request = extra;
+    if (request->in_fields || request->key == NULL || strcmp(request->key, "id") != 0) {
+        request->error = "Unexpected number";
+        return 0;
+    }
+    Con *con = (Con*)(uintptr_t)val;
+    if (!con_exists(con)) {
+        request->error = "No container with this id";
+        return 0;
+    }
+    request->root = con;
+    return 1;
+}
+
+static int tree_request_string(void *extra, const unsigned char *s, ylength len) {
+    struct tree_request *request = extra;
+    char *str = smalloc(len + 1);
+    memcpy(str, s, len);
+    str[len] = '\0';
+
+    if (request->in_fields) {
+        int i;
+        for (i = 0; i < DF_NUM_FIELDS; i++)
+            if (strcmp(dump_field_names[i], str) == 0)
+                break;
+        if (i < DF_NUM_FIELDS)
+            request->fields |= (1 << i);
+        else request->error = "Unknown field";
+    } else if (request->key != NULL && strcmp(request->key, "workspace") == 0) {
+        if ((request->root = get_existing_workspace_by_name(str)) == NULL)
+            request->error = "No workspace with this name";
+    } else if (request->key != NULL && strcmp(request->key, "output") == 0) {
+        Output *output = get_output_by_name(str);
+        if (output != NULL && output->con != NULL)
+            request->root = output->con;
+        else request->error = "No output with this name";
+    } else request->error = "Unexpected string";
+
+    free(str);
+    return (request->error == NULL);
+}
+
+/*
+ * Parses the payload of a GET_TREE message, a map which can select the root
+ * of the dumped subtree ("id", "workspace" or "output") and the properties
+ * which are dumped for each container ("fields"). An empty payload selects
+ * the whole tree with all properties.
+ *
+ * Returns an error message if the payload is invalid, NULL otherwise.
+ *
+ */
+static const char *parse_tree_request(const uint8_t *message, uint32_t message_size,
+                                      Con **root, uint32_t *fields) {
+    *root = croot;
+    *fields = DUMP_ALL_FIELDS;
+    if (message_size == 0)
+        return NULL;
+
+    yajl_callbacks callbacks;
+    memset(&callbacks, 0, sizeof(yajl_callbacks));
+    callbacks.yajl_map_key = tree_request_map_key;
+    callbacks.yajl_start_map = tree_request_start_map;
+    callbacks.yajl_end_map = tree_request_end_map;
+    callbacks.yajl_start_array = tree_request_start_array;
+    callbacks.yajl_end_array = tree_request_end_array;
+    callbacks.yajl_integer = tree_request_integer;
+    callbacks.yajl_string = tree_request_string;
+
+    struct tree_request request = { .root = croot, .fields = DUMP_ALL_FIELDS };
+    yajl_handle handle = yalloc(&callbacks, (void*)&request);
+    yajl_status status = yajl_parse(handle, message, message_size);
+#if YAJL_MAJOR >= 2
+    if (status == yajl_status_ok)
+        status = yajl_complete_parse(handle);
+#endif
+    yajl_free(handle);
+    free(request.key);
+
+    if (request.error != NULL)
+        return request.error;
+    if (status != yajl_status_ok)
+        return "Invalid JSON";
+
+    *root = request.root;
+    *fields = request.fields;
+    return NULL;
 }
 
+IPC_HANDLER(tree) {
+    ipc_client *client = ipc_client_for_fd(fd);
+    if (client == NULL)
+        return;
+
+    Con *root;
+    uint32_t fields;
+    const char *error = parse_tree_request(message, message_size, &root, &fields);
+    if (error != NULL) {
+        ELOG("IPC: invalid GET_TREE request: %s\n", error);
+        yajl_gen gen = ygenalloc();
+        y(map_open);
+        ystr("success");
+        y(bool, false);
+        ystr("error");
+        ystr(error);
+        y(map_close);
+
+        const unsigned char *payload;
+        ylength length;
+        y(get_buf, &payload, &length);
+        ipc_send_reply(fd, length, I3_IPC_REPLY_TYPE_TREE, payload);
+        y(free);
+        return;
+    }
+
+    /* The tree can get big, so we generate it directly into the client’s
+     * output buffer. */
+    size_t header_pos;
+    setlocale(LC_NUMERIC, "C");
+    yajl_gen gen = ipc_stream_begin(client, I3_IPC_REPLY_TYPE_TREE, &header_pos);
+    dump_con(gen, root, false, true, fields);
+    setlocale(LC_NUMERIC, "");
+    ipc_stream_end(client, gen, header_pos);
+}
+
+
+/* The GET_WORKSPACES and GET_OUTPUTS replies are requested by every i3bar
+ * instance on every workspace event, so they are cached until
+ * ipc_invalidate_cached_replies() is called. */
+struct cached_reply {
+    /* The reply is valid as long as this matches cached_replies_generation
+     * and the focused workspace did not change. */
+    uint64_t generation;
+    Con *focused_ws;
+    unsigned char *payload;
+    size_t length;
+};
+
+static uint64_t cached_replies_generation = 1;
+static struct cached_reply workspaces_reply;
+static struct cached_reply outputs_reply;
+
+/*
+ * Invalidates the cached GET_WORKSPACES and GET_OUTPUTS replies. Needs to be
+ * called whenever a workspace or an output changes (this is done implicitly
+ * by sending a workspace or output event).
+ *
+ */
+void ipc_invalidate_cached_replies(void) {
+    cached_replies_generation++;
+}
 
 /*
- * Formats the reply message for a GET_WORKSPACES request and sends it to the
- * client
+ * Sends the cached reply to the client, after generating it with dump if it
+ * is not valid anymore.
  *
  */
-IPC_HANDLER(get_workspaces) {
-    yajl_gen gen = ygenalloc();
+static void send_cached_reply(int fd, struct cached_reply *cache, uint32_t message_type,
+                              void (*dump)(yajl_gen gen)) {
+    Con *focused_ws = con_get_workspace(focused);
+    if (cache->payload == NULL ||
+        cache->generation != cached_replies_generation ||
+        cache->focused_ws != focused_ws) {
+        yajl_gen gen = ygenalloc();
+        dump(gen);
+
+        const unsigned char *payload;
+        ylength length;
+        y(get_buf, &payload, &length);
+
+        free(cache->payload);
+        cache->payload = smalloc(length);
+        memcpy(cache->payload, payload, length);
+        cache->length = length;
+        cache->generation = cached_replies_generation;
+        cache->focused_ws = focused_ws;
+        y(free);
+    }
+
+    ipc_send_reply(fd, cache->length, message_type, cache->payload);
+}
+
+static void dump_workspaces(yajl_gen gen) {
     y(array_open);
 
     Con *focused_ws = con_get_workspace(focused);
@@ -434,22 +1450,18 @@ IPC_HANDLER(get_workspaces) {
     }
 
     y(array_close);
-
-    const unsigned char *payload;
-    ylength length;
-    y(get_buf, &payload, &length);
-
-    ipc_send_message(fd, length, I3_IPC_REPLY_TYPE_WORKSPACES, payload);
-    y(free);
 }
 
 /*
- * Formats the reply message for a GET_OUTPUTS request and sends it to the
+ * Formats the reply message for a GET_WORKSPACES request and sends it to the
  * client
  *
  */
-IPC_HANDLER(get_outputs) {
-    yajl_gen gen = ygenalloc();
+IPC_HANDLER(get_workspaces) {
+    send_cached_reply(fd, &workspaces_reply, I3_IPC_REPLY_TYPE_WORKSPACES, dump_workspaces);
+}
+
+static void dump_outputs(yajl_gen gen) {
     y(array_open);
 
     Output *output;
@@ -487,13 +1499,15 @@ IPC_HANDLER(get_outputs) {
     }
 
     y(array_close);
+}
 
-    const unsigned char *payload;
-    ylength length;
-    y(get_buf, &payload, &length);
-
-    ipc_send_message(fd, length, I3_IPC_REPLY_TYPE_OUTPUTS, payload);
-    y(free);
+/*
+ * Formats the reply message for a GET_OUTPUTS request and sends it to the
+ * client
+ *
+ */
+IPC_HANDLER(get_outputs) {
+    send_cached_reply(fd, &outputs_reply, I3_IPC_REPLY_TYPE_OUTPUTS, dump_outputs);
 }
 
 /*
@@ -506,9 +1520,8 @@ IPC_HANDLER(get_marks) {
     y(array_open);
 
     Con *con;
-    TAILQ_FOREACH(con, &all_cons, all_cons)
-        if (con->mark != NULL)
-            ystr(con->mark);
+    TAILQ_FOREACH(con, &marked_cons, marked_cons)
+        ystr(con->mark);
 
     y(array_close);
 
@@ -516,7 +1529,7 @@ IPC_HANDLER(get_marks) {
     ylength length;
     y(get_buf, &payload, &length);
 
-    ipc_send_message(fd, length, I3_IPC_REPLY_TYPE_MARKS, payload);
+    ipc_send_reply(fd, length, I3_IPC_REPLY_TYPE_MARKS, payload);
     y(free);
 }
 
@@ -546,7 +1559,107 @@ IPC_HANDLER(get_version) {
     ylength length;
     y(get_buf, &payload, &length);
 
-    ipc_send_message(fd, length, I3_IPC_REPLY_TYPE_VERSION, payload);
+    ipc_send_reply(fd, length, I3_IPC_REPLY_TYPE_VERSION, payload);
+    y(free);
+}
+
+/*
+ * Returns the number of blocks and objects of each object pool (see pool.c).
+ *
+ */
+IPC_HANDLER(get_pool_stats) {
+    yajl_gen gen = ygenalloc();
+    y(array_open);
+
+    struct pool *pool;
+    SLIST_FOREACH(pool, &all_pools, pools) {
+        y(map_open);
+        ystr("name");
+        ystr(pool->name);
+        ystr("object_size");
+        y(integer, pool->object_size);
+        ystr("blocks");
+        y(integer, pool->blocks);
+        ystr("in_use");
+        y(integer, pool->in_use);
+        ystr("available");
+        y(integer, pool->available);
+        y(map_close);
+    }
+
+    y(array_close);
+
+    const unsigned char *payload;
+    ylength length;
+    y(get_buf, &payload, &length);
+
+    ipc_send_reply(fd, length, I3_IPC_REPLY_TYPE_POOL_STATS, payload);
+    y(free);
+}
+
+/*
+ * Returns the latency statistics (see stats.c). If the payload is “reset”,
+ * the statistics are cleared after the reply was generated.
+ *
+ */
+IPC_HANDLER(get_stats) {
+    yajl_gen gen = ygenalloc();
+    y(array_open);
+
+    struct latency_stats *stats;
+    TAILQ_FOREACH(stats, &all_stats, all_stats) {
+        /* Command statistics are created before recording the first
+         * duration, which might not have happened yet. */
+        if (stats->count == 0)
+            continue;
+
+        y(map_open);
+        ystr("category");
+        ystr(stats->category);
+        ystr("name");
+        ystr(stats->name);
+        ystr("count");
+        y(integer, stats->count);
+        ystr("total_us");
+        y(integer, stats->total_ns / 1000);
+        ystr("max_us");
+        y(integer, stats->max_ns / 1000);
+        ystr("histogram");
+        y(array_open);
+        for (int i = 0; i < STATS_BUCKETS; i++)
+            y(integer, stats->buckets[i]);
+        y(array_close);
+        y(map_close);
+    }
+
+    y(array_close);
+
+    const unsigned char *payload;
+    ylength length;
+    y(get_buf, &payload, &length);
+
+    ipc_send_reply(fd, length, I3_IPC_REPLY_TYPE_STATS, payload);
+    y(free);
+
+    if (message_size == strlen("reset") &&
+        strncmp((const char*)message, "reset", message_size) == 0)
+        stats_reset();
+}
+
+/*
+ * Returns the number of objects and bytes of each object type (see
+ * memory.c).
+ *
+ */
+IPC_HANDLER(get_memory) {
+    yajl_gen gen = ygenalloc();
+    memory_stats_dump(gen);
+
+    const unsigned char *payload;
+    ylength length;
+    y(get_buf, &payload, &length);
+
+    ipc_send_reply(fd, length, I3_IPC_REPLY_TYPE_MEMORY, payload);
     y(free);
 }
 
@@ -571,7 +1684,7 @@ IPC_HANDLER(get_bar_config) {
         ylength length;
         y(get_buf, &payload, &length);
 
-        ipc_send_message(fd, length, I3_IPC_REPLY_TYPE_BAR_CONFIG, payload);
+        ipc_send_reply(fd, length, I3_IPC_REPLY_TYPE_BAR_CONFIG, payload);
         y(free);
         return;
     }
@@ -581,6 +1694,9 @@ IPC_HANDLER(get_bar_config) {
     char *bar_id = scalloc(message_size + 1);
     strncpy(bar_id, (const char*)message, message_size);
     LOG("IPC: looking for config for bar ID \"%s\"\n", bar_id);
+    ipc_client *client = ipc_client_for_fd(fd);
+    if (client != NULL)
+        client->is_bar = true;
     Barconfig *current, *config = NULL;
     TAILQ_FOREACH(current, &barconfigs, configs) {
         if (strcmp(current->id, bar_id) != 0)
@@ -692,6 +1808,15 @@ IPC_HANDLER(get_bar_config) {
         ystr("verbose");
         y(bool, config->verbose);
 
+        ystr("status_refresh_rate");
+        y(integer, config->status_refresh_rate);
+
+        ystr("client_side_rendering");
+        y(bool, config->client_side_rendering);
+
+        ystr("glyph_cache");
+        y(bool, config->glyph_cache);
+
 #undef YSTR_IF_SET
 #define YSTR_IF_SET(name) \
         do { \
@@ -729,39 +1854,196 @@ IPC_HANDLER(get_bar_config) {
     ylength length;
     y(get_buf, &payload, &length);
 
-    ipc_send_message(fd, length, I3_IPC_REPLY_TYPE_BAR_CONFIG, payload);
+    ipc_send_reply(fd, length, I3_IPC_REPLY_TYPE_BAR_CONFIG, payload);
     y(free);
 }
 
+/* State of parsing a SUBSCRIBE payload. */
+struct subscribe_state {
+    ipc_client *client;
+    /* Nesting depth: 1 within the array of subscriptions, 2 within a filter
+     * map, 3 within its list of changes. */
+    int depth;
+    /* The filter map which is being parsed, if any */
+    ipc_window_filter *filter;
+    char *filter_event;
+    char *key;
+    bool failed;
+};
+
+static void subscribe(ipc_client *client, const unsigned char *s, ylength len) {
+    DLOG("should add subscription to extra %p, sub %.*s\n", client, (int)len, s);
+    for (int i = 0; i < IPC_NUM_EVENT_TYPES; i++) {
+        if (strlen(event_names[i]) != len ||
+            strncasecmp(event_names[i], (const char*)s, len) != 0)
+            continue;
+
+        if (!(client->events & (1 << i))) {
+            client->events |= (1 << i);
+            TAILQ_INSERT_TAIL(&subscribers[i], client, subscribers[i]);
+        }
+
+        DLOG("client is now subscribed to:\n");
+        for (int j = 0; j < IPC_NUM_EVENT_TYPES; j++)
+            if (client->events & (1 << j))
+                DLOG("event %s\n", event_names[j]);
+        DLOG("(done)\n");
+        return;
+    }
+
+    DLOG("Ignoring subscription to unknown event \"%.*s\"\n", (int)len, s);
+}
+
+static char *subscribe_strdup(const unsigned char *s, ylength len) {
+    char *str = smalloc(len + 1);
+    memcpy(str, s, len);
+    str[len] = '\0';
+    return str;
+}
+
+static int subscribe_start_array(void *extra) {
+    struct subscribe_state *state = extra;
+    state->depth++;
+    /* Arrays are only valid as payload and as list of changes. */
+    if (state->depth != 1 && state->depth != 3) {
+        state->failed = true;
+        return 0;
+    }
+    return 1;
+}
+
+static int subscribe_start_map(void *extra) {
+    struct subscribe_state *state = extra;
+    state->depth++;
+    /* Filter maps are only valid as elements of the payload array. */
+    if (state->depth != 2) {
+        state->failed = true;
+        return 0;
+    }
+    state->filter = scalloc(sizeof(ipc_window_filter));
+    return 1;
+}
+
+static int subscribe_end_array(void *extra) {
+    struct subscribe_state *state = extra;
+    state->depth--;
+    return 1;
+}
+
+static int subscribe_end_map(void *extra) {
+    struct subscribe_state *state = extra;
+    state->depth--;
+
+    if (state->filter_event == NULL) {
+        ELOG("Subscription filter without \"event\"\n");
+        state->failed = true;
+        return 0;
+    }
+
+    /* Only window events can be filtered so far. */
+    if (strcasecmp(state->filter_event, "window") != 0) {
+        ELOG("Events of type \"%s\" cannot be filtered\n", state->filter_event);
+        state->failed = true;
+        return 0;
+    }
+
+    subscribe(state->client, (const unsigned char*)state->filter_event, strlen(state->filter_event));
+    window_filter_free(state->client->window_filter);
+    state->client->window_filter = state->filter;
+    state->filter = NULL;
+    FREE(state->filter_event);
+    return 1;
+}
+
+static int subscribe_map_key(void *extra, const unsigned char *s, ylength len) {
+    struct subscribe_state *state = extra;
+    FREE(state->key);
+    state->key = subscribe_strdup(s, len);
+    return 1;
+}
+
 /*
- * Callback for the YAJL parser (will be called when a string is parsed).
+ * Callback for the YAJL parser (will be called when a string is parsed):
+ * either the name of an event to subscribe to, or a value of a filter.
  *
  */
-static int add_subscription(void *extra, const unsigned char *s,
-                            ylength len) {
-    ipc_client *client = extra;
+static int subscribe_string(void *extra, const unsigned char *s, ylength len) {
+    struct subscribe_state *state = extra;
+
+    /* Strings are only valid as elements of the payload array and as values
+     * inside of a filter map. */
+    if (state->depth != 1 &&
+        (state->depth < 2 || state->filter == NULL || state->key == NULL)) {
+        ELOG("Unexpected string in subscription\n");
+        state->failed = true;
+        return 0;
+    }
 
-    DLOG("should add subscription to extra %p, sub %.*s\n", client, (int)len, s);
-    int event = client->num_events;
+    if (state->depth == 1) {
+        /* A plain subscription also receives all window events again. */
+        if (strlen("window") == len && strncasecmp((const char*)s, "window", len) == 0) {
+            window_filter_free(state->client->window_filter);
+            state->client->window_filter = NULL;
+        }
+        subscribe(state->client, s, len);
+        return 1;
+    }
 
-    client->num_events++;
-    client->events = realloc(client->events, client->num_events * sizeof(char*));
-    /* We copy the string because it is not null-terminated and strndup()
-     * is missing on some BSD systems */
-    client->events[event] = scalloc(len+1);
-    memcpy(client->events[event], s, len);
+    ipc_window_filter *filter = state->filter;
+    char *value = subscribe_strdup(s, len);
+    if (strcasecmp(state->key, "change") == 0) {
+        filter->changes = srealloc(filter->changes, (filter->num_changes + 1) * sizeof(char*));
+        filter->changes[filter->num_changes++] = value;
+        return 1;
+    }
 
-    DLOG("client is now subscribed to:\n");
-    for (int i = 0; i < client->num_events; i++)
-        DLOG("event %s\n", client->events[i]);
-    DLOG("(done)\n");
+    struct regex **regex = NULL;
+    if (strcasecmp(state->key, "event") == 0) {
+        FREE(state->filter_event);
+        state->filter_event = value;
+        return 1;
+    } else if (strcasecmp(state->key, "workspace") == 0) {
+        FREE(filter->workspace);
+        filter->workspace = value;
+        return 1;
+    } else if (strcasecmp(state->key, "class") == 0) {
+        regex = &(filter->class);
+    } else if (strcasecmp(state->key, "instance") == 0) {
+        regex = &(filter->instance);
+    } else {
+        ELOG("Unknown subscription filter \"%s\"\n", state->key);
+        free(value);
+        state->failed = true;
+        return 0;
+    }
 
+    regex_free(*regex);
+    *regex = regex_new(value);
+    free(value);
+    if (*regex == NULL) {
+        state->failed = true;
+        return 0;
+    }
     return 1;
 }
 
+/*
+ * Callback for the YAJL parser (will be called when a number is parsed). No
+ * part of a subscription is a number.
+ *
+ */
+static int subscribe_number(void *extra, const char *s, ylength len) {
+    struct subscribe_state *state = extra;
+    ELOG("Unexpected number in subscription\n");
+    state->failed = true;
+    return 0;
+}
+
 /*
  * Subscribes this connection to the event types which were given as a JSON
- * serialized array in the payload field of the message.
+ * serialized array in the payload field of the message. Instead of the name of
+ * an event, the array can contain a map which restricts the events sent, see
+ * “Subscribing to events” in docs/ipc.
  *
  */
 IPC_HANDLER(subscribe) {
@@ -786,30 +2068,74 @@ IPC_HANDLER(subscribe) {
 
     /* Setup the JSON parser */
     memset(&callbacks, 0, sizeof(yajl_callbacks));
-    callbacks.yajl_string = add_subscription;
-
-    p = yalloc(&callbacks, (void*)client);
+    callbacks.yajl_number = subscribe_number;
+    callbacks.yajl_string = subscribe_string;
+    callbacks.yajl_start_array = subscribe_start_array;
+    callbacks.yajl_end_array = subscribe_end_array;
+    callbacks.yajl_start_map = subscribe_start_map;
+    callbacks.yajl_end_map = subscribe_end_map;
+    callbacks.yajl_map_key = subscribe_map_key;
+
+    struct subscribe_state state = { .client = client };
+    p = yalloc(&callbacks, (void*)&state);
     stat = yajl_parse(p, (const unsigned char*)message, message_size);
+    window_filter_free(state.filter);
+    free(state.filter_event);
+    free(state.key);
     if (stat != yajl_status_ok) {
-        unsigned char *err;
-        err = yajl_get_error(p, true, (const unsigned char*)message,
-                             message_size);
-        ELOG("YAJL parse error: %s\n", err);
-        yajl_free_error(p, err);
+        if (!state.failed) {
+            unsigned char *err;
+            err = yajl_get_error(p, true, (const unsigned char*)message,
+                                 message_size);
+            ELOG("YAJL parse error: %s\n", err);
+            yajl_free_error(p, err);
+        }
 
         const char *reply = "{\"success\":false}";
-        ipc_send_message(fd, strlen(reply), I3_IPC_REPLY_TYPE_SUBSCRIBE, (const uint8_t*)reply);
+        ipc_send_reply(fd, strlen(reply), I3_IPC_REPLY_TYPE_SUBSCRIBE, (const uint8_t*)reply);
         yajl_free(p);
         return;
     }
     yajl_free(p);
     const char *reply = "{\"success\":true}";
-    ipc_send_message(fd, strlen(reply), I3_IPC_REPLY_TYPE_SUBSCRIBE, (const uint8_t*)reply);
+    ipc_send_reply(fd, strlen(reply), I3_IPC_REPLY_TYPE_SUBSCRIBE, (const uint8_t*)reply);
+}
+
+/*
+ * Switches the encoding of all further replies and events for this client.
+ * The payload is either "json" (the default) or "cbor". The reply itself is
+ * still sent in the previous encoding.
+ *
+ */
+IPC_HANDLER(set_encoding) {
+    ipc_client *client = ipc_client_for_fd(fd);
+    if (client == NULL)
+        return;
+
+    ipc_encoding_t encoding;
+    bool success = true;
+    if (message_size == strlen("json") && strncmp((const char*)message, "json", message_size) == 0)
+        encoding = IPC_ENCODING_JSON;
+    else if (message_size == strlen("cbor") && strncmp((const char*)message, "cbor", message_size) == 0)
+        encoding = IPC_ENCODING_CBOR;
+    else {
+        ELOG("IPC: unknown encoding %.*s requested\n", (int)message_size, message);
+        success = false;
+    }
+
+    const char *reply = (success ? "{\"success\":true}" : "{\"success\":false}");
+    ipc_send_reply(fd, strlen(reply), I3_IPC_REPLY_TYPE_SET_ENCODING, (const uint8_t*)reply);
+
+    /* The reply might have disconnected the client. */
+    if (success && (client = ipc_client_for_fd(fd)) != NULL) {
+        DLOG("IPC: client on fd %d switched to encoding %d\n", fd, encoding);
+        client->encoding = encoding;
+    }
 }
 
 /* The index of each callback function corresponds to the numeric
  * value of the message type (see include/i3/ipc.h) */
-handler_t handlers[8] = {
+handler_t handlers[13] = {
     handle_command,
     handle_get_workspaces,
     handle_subscribe,
@@ -818,64 +2144,174 @@ handler_t handlers[8] = {
     handle_get_marks,
     handle_get_bar_config,
     handle_get_version,
+    handle_get_tree_delta,
+    handle_get_pool_stats,
+    handle_get_stats,
+    handle_set_encoding,
+    handle_get_memory,
 };
 
+/* Messages larger than this are rejected (and the client disconnected) instead
+ * of letting a broken client make i3 allocate arbitrary amounts of memory. */
+#define IPC_MAX_MESSAGE_SIZE (16 * 1024 * 1024)
+
+/* Number of messages of one client handled before returning to the event
+ * loop. */
+#define IPC_MAX_MESSAGES_PER_WAKEUP 32
+
 /*
- * Handler for activity on a client connection, receives a message from a
- * client.
+ * Handler for activity on a client connection, handles the complete messages
+ * which the client sent.
  *
- * For now, the maximum message size is 2048. I’m not sure for what the
- * IPC interface will be used in the future, thus I’m not implementing a
- * mechanism for arbitrarily long messages, as it seems like overkill
- * at the moment.
+ * Messages are assembled in the client’s input buffer, so a message which
+ * arrives in pieces never blocks the event loop: the rest is read once it is
+ * available.
  *
  */
 static void ipc_receive_message(EV_P_ struct ev_io *w, int revents) {
+    ipc_client *client = w->data;
+    const int fd = client->fd;
     uint32_t message_type;
     uint32_t message_length;
     uint8_t *message;
 
-    int ret = ipc_recv_message(w->fd, &message_type, &message_length, &message);
-    /* EOF or other error */
-    if (ret < 0) {
-        /* Was this a spurious read? See ev(3) */
-        if (ret == -1 && errno == EAGAIN)
+    for (int handled = 0;; handled++) {
+        /* Don’t let a client which keeps sending messages starve the X11
+         * connection and other clients. The remaining messages might already
+         * be in the input buffer, so the socket would not become readable
+         * again: invoke this callback again in the next loop iteration. */
+        if (handled == IPC_MAX_MESSAGES_PER_WAKEUP) {
+            ev_feed_event(EV_A_ w, EV_READ);
             return;
+        }
 
-        /* If not, there was some kind of error. We don’t bother
-         * and close the connection */
-        close(w->fd);
+        int ret = ipc_recv_message_buffered(fd, &client->input, &message_type,
+                                            &message_length, &message);
+        /* The rest of the message did not arrive yet. */
+        if (ret == 1)
+            return;
 
-        /* Delete the client from the list of clients */
-        ipc_client *current;
-        TAILQ_FOREACH(current, &all_clients, clients) {
-            if (current->fd != w->fd)
-                continue;
+        /* EOF or other error. We don’t bother and close the connection. */
+        if (ret < 0) {
+            /* free_ipc_client() also frees w */
+            free_ipc_client(client);
+            DLOG("IPC: client disconnected\n");
+            return;
+        }
 
-            for (int i = 0; i < current->num_events; i++)
-                free(current->events[i]);
-            /* We can call TAILQ_REMOVE because we break out of the
-             * TAILQ_FOREACH afterwards */
-            TAILQ_REMOVE(&all_clients, current, clients);
-            free(current);
-            break;
+        client->tag_reply = false;
+        if (message_type & I3_IPC_REQUEST_ID_FLAG) {
+            if (message_length < sizeof(uint32_t)) {
+                ELOG("IPC: message with request id is too short, disconnecting\n");
+                free_ipc_client(client);
+                return;
+            }
+            client->tag_reply = true;
+            memcpy(&(client->request_id), message, sizeof(uint32_t));
+            message += sizeof(uint32_t);
+            message_length -= sizeof(uint32_t);
+            message_type &= ~I3_IPC_REQUEST_ID_FLAG;
         }
 
-        ev_io_stop(EV_A_ w);
-        free(w);
+        if (message_type >= (sizeof(handlers) / sizeof(handler_t)))
+            DLOG("Unhandled message type: %d\n", message_type);
+        else {
+            /* Replies (e.g. to GET_TREE) have to reflect the rendered state of
+             * events which were handled before this message. */
+            tree_render_flush();
+
+            uint64_t start = stats_now();
+            ipc_client *previous = handling_client;
+            handling_client = client;
+            handler_t h = handlers[message_type];
+            h(fd, message, 0, message_length, message_type);
+            handling_client = previous;
+            stats_record(stats_for_ipc(message_type), start);
+        }
 
-        DLOG("IPC: client disconnected\n");
-        return;
+        /* The handler might have disconnected the client, e.g. because its
+         * reply could not be written. */
+        if ((client = ipc_client_for_fd(fd)) == NULL)
+            return;
+        client->tag_reply = false;
     }
+}
 
-    if (message_type >= (sizeof(handlers) / sizeof(handler_t)))
-        DLOG("Unhandled message type: %d\n", message_type);
-    else {
-        handler_t h = handlers[message_type];
-        h(w->fd, message, 0, message_length, message_type);
+/*
+ * Sets up a client for the given connection and adds it to the list of
+ * clients.
+ *
+ */
+/*
+ * Called when a client did not commit its batch within IPC_BATCH_TIMEOUT
+ * seconds. Since a batch suspends rendering for all of i3, it is committed
+ * anyway.
+ *
+ */
+static void ipc_batch_timeout(EV_P_ ev_timer *w, int revents) {
+    ipc_client *client = w->data;
+    ELOG("IPC: client on fd %d did not commit its batch within %.1f seconds, committing it\n",
+         client->fd, IPC_BATCH_TIMEOUT);
+    for (; client->batch_depth > 0; client->batch_depth--)
+        tree_batch_end_later();
+}
+
+static ipc_client *ipc_client_new(int fd) {
+    /* Close this file descriptor on exec() */
+    (void)fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+    set_nonblock(fd);
+
+    ipc_client *new = scalloc(sizeof(ipc_client));
+    new->fd = fd;
+    new->input.max_message_size = IPC_MAX_MESSAGE_SIZE;
+
+    struct ev_io *package = scalloc(sizeof(struct ev_io));
+    ev_io_init(package, ipc_receive_message, fd, EV_READ);
+    package->data = new;
+    ev_io_start(main_loop, package);
+    new->read_callback = package;
+
+    new->write_callback = scalloc(sizeof(struct ev_io));
+    new->write_callback->data = new;
+    ev_io_init(new->write_callback, ipc_socket_writeable_cb, fd, EV_WRITE);
+
+    new->batch_timer = scalloc(sizeof(struct ev_timer));
+    new->batch_timer->data = new;
+    ev_timer_init(new->batch_timer, ipc_batch_timeout, 0., 0.);
+
+    if (ipc_io_running())
+        new->io = ipc_io_conn_new(fd);
+
+    TAILQ_INSERT_TAIL(&all_clients, new, clients);
+    return new;
+}
+
+/*
+ * Called for clients whose output could not be written by the I/O thread.
+ *
+ */
+static void ipc_io_failed(uint64_t id) {
+    ipc_client *current;
+    TAILQ_FOREACH(current, &all_clients, clients) {
+        if (current->io == NULL || ipc_io_conn_id(current->io) != id)
+            continue;
+        ELOG("IPC: write to client on fd %d failed, disconnecting\n", current->fd);
+        free_ipc_client(current);
+        return;
     }
 }
 
+/*
+ * Starts the IPC I/O thread (see ipc_io.c) if it was enabled in the
+ * configuration. Needs to be called before the first client is accepted.
+ *
+ */
+void ipc_start_io_thread(void) {
+    if (config.ipc_thread && !ipc_io_start(ipc_io_failed))
+        ELOG("IPC: writing the output of clients in the main thread\n");
+}
+
 /*
  * Handler for activity on the listening socket, meaning that a new client
  * has just connected and we should accept() him. Sets up the event handler
@@ -894,26 +2330,54 @@ void ipc_new_client(EV_P_ struct ev_io *w, int revents) {
         return;
     }
 
-    /* Close this file descriptor on exec() */
-    (void)fcntl(client, F_SETFD, FD_CLOEXEC);
-
-    set_nonblock(client);
-
-    struct ev_io *package = scalloc(sizeof(struct ev_io));
-    ev_io_init(package, ipc_receive_message, client, EV_READ);
-    ev_io_start(EV_A_ package);
+    ipc_client_new(client);
 
     DLOG("IPC: new client connected on fd %d\n", w->fd);
+}
 
-    ipc_client *new = scalloc(sizeof(ipc_client));
-    new->fd = client;
+/*
+ * Takes over the client connections which the previous process kept open
+ * across the inplace restart, see ipc_handoff(). The clients keep their
+ * subscriptions and encoding.
+ *
+ */
+void ipc_adopt_clients(void) {
+    char *clients = getenv("I3_IPC_CLIENTS");
+    if (clients == NULL)
+        return;
 
-    TAILQ_INSERT_TAIL(&all_clients, new, clients);
+    clients = sstrdup(clients);
+    unsetenv("I3_IPC_CLIENTS");
+
+    char *saveptr = NULL;
+    for (char *entry = strtok_r(clients, ",", &saveptr);
+         entry != NULL;
+         entry = strtok_r(NULL, ",", &saveptr)) {
+        int fd, encoding;
+        unsigned int events;
+        if (sscanf(entry, "%d:%d:%u", &fd, &encoding, &events) != 3 ||
+            fcntl(fd, F_GETFD) < 0) {
+            ELOG("IPC: invalid client \"%s\" passed on restart\n", entry);
+            continue;
+        }
+
+        ipc_client *client = ipc_client_new(fd);
+        client->encoding = encoding;
+        for (int i = 0; i < IPC_NUM_EVENT_TYPES; i++) {
+            if (!(events & (1 << i)))
+                continue;
+            client->events |= (1 << i);
+            TAILQ_INSERT_TAIL(&subscribers[i], client, subscribers[i]);
+        }
+        DLOG("IPC: adopted client on fd %d (events 0x%x)\n", fd, client->events);
+    }
+    free(clients);
 }
 
 /*
  * Creates the UNIX domain socket at the given path, sets it to non-blocking
- * mode, bind()s and listen()s on it.
+ * mode, bind()s and listen()s on it. After an inplace restart, the socket of
+ * the previous process is reused instead if it has the same path.
  *
  */
 int ipc_create_socket(const char *filename) {
@@ -922,6 +2386,28 @@ int ipc_create_socket(const char *filename) {
     FREE(current_socketpath);
 
     char *resolved = resolve_tilde(filename);
+
+    /* After an inplace restart, keep using the socket of the previous
+     * process (see ipc_handoff()) unless the path was changed. */
+    char *inherited = getenv("I3_IPC_LISTEN_FD");
+    if (inherited != NULL) {
+        sockfd = atoi(inherited);
+        unsetenv("I3_IPC_LISTEN_FD");
+
+        struct sockaddr_un addr;
+        socklen_t len = sizeof(struct sockaddr_un);
+        memset(&addr, 0, sizeof(struct sockaddr_un));
+        if (getsockname(sockfd, (struct sockaddr*)&addr, &len) == 0 &&
+            addr.sun_family == AF_LOCAL &&
+            strncmp(addr.sun_path, resolved, sizeof(addr.sun_path)) == 0) {
+            DLOG("Reusing IPC-socket at %s (fd %d)\n", resolved, sockfd);
+            (void)fcntl(sockfd, F_SETFD, FD_CLOEXEC);
+            current_socketpath = resolved;
+            return (listen_fd = sockfd);
+        }
+        close(sockfd);
+    }
+
     DLOG("Creating IPC-socket at %s\n", resolved);
     char *copy = sstrdup(resolved);
     const char *dir = dirname(copy);
@@ -959,5 +2445,56 @@ int ipc_create_socket(const char *filename) {
     }
 
     current_socketpath = resolved;
-    return sockfd;
+    return (listen_fd = sockfd);
+}
+
+/*
+ * Writes the path of the IPC socket to socket_path_file(), so that clients
+ * can find it without asking the X server for the I3_SOCKET_PATH atom.
+ *
+ */
+void ipc_publish_socket_path(void) {
+    char *filename = socket_path_file();
+    if (filename == NULL || current_socketpath == NULL) {
+        FREE(filename);
+        return;
+    }
+
+    char *copy = sstrdup(filename);
+    const char *dir = dirname(copy);
+    if (!path_exists(dir))
+        mkdirp(dir);
+    free(copy);
+
+    /* Write to a temporary file first, clients must never read a partially
+     * written path. */
+    char *tmp;
+    sasprintf(&tmp, "%s.tmp", filename);
+    FILE *f = fopen(tmp, "w");
+    if (f == NULL) {
+        ELOG("Could not publish the IPC socket path in %s: %s\n", tmp, strerror(errno));
+    } else {
+        bool written = (fputs(current_socketpath, f) >= 0);
+        if (fclose(f) != 0 || !written || rename(tmp, filename) == -1) {
+            ELOG("Could not publish the IPC socket path in %s: %s\n", filename, strerror(errno));
+            unlink(tmp);
+        }
+    }
+    free(tmp);
+    free(filename);
+}
+
+/*
+ * Removes the file written by ipc_publish_socket_path(). Called when exiting.
+ *
+ */
+void ipc_unpublish_socket_path(void) {
+    char *filename = socket_path_file();
+    if (filename == NULL || current_socketpath == NULL) {
+        FREE(filename);
+        return;
+    }
+
+    unlink(filename);
+    free(filename);
 }
@@ -0,0 +1,232 @@
+#undef I3__FILE__
+#define I3__FILE__ "ipc_cbor.c"
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009-2013 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * ipc_cbor.c: Encodes IPC replies and events as CBOR (RFC 7049) for clients
+ *             which requested it (see SET_ENCODING in docs/ipc).
+ *
+ * All replies and events are generated as JSON with yajl. Instead of
+ * duplicating every serializer, the JSON is parsed again while it is
+ * generated and translated into CBOR token by token. Maps and arrays are
+ * encoded with indefinite length, so nothing needs to be buffered.
+ *
+ */
+#include "all.h"
+#include "yajl_utils.h"
+
+#include <yajl/yajl_parse.h>
+
+/* CBOR major types (the upper three bits of the initial byte) */
+#define CBOR_UNSIGNED (0 << 5)
+#define CBOR_NEGATIVE (1 << 5)
+#define CBOR_TEXT (3 << 5)
+
+#define CBOR_FALSE 0xf4
+#define CBOR_TRUE 0xf5
+#define CBOR_NULL 0xf6
+#define CBOR_DOUBLE 0xfb
+#define CBOR_ARRAY_BEGIN 0x9f
+#define CBOR_MAP_BEGIN 0xbf
+#define CBOR_BREAK 0xff
+
+struct ipc_cbor {
+    yajl_handle handle;
+    ipc_cbor_write_t write;
+    void *ctx;
+};
+
+static void write_byte(ipc_cbor *cbor, uint8_t byte) {
+    cbor->write(cbor->ctx, &byte, 1);
+}
+
+/*
+ * Writes the initial byte of a data item of the given major type together
+ * with its argument (the value of an integer, the length of a string), using
+ * the shortest possible encoding.
+ *
+ */
+static void write_head(ipc_cbor *cbor, uint8_t major, uint64_t value) {
+    uint8_t head[9];
+    size_t len;
+
+    if (value < 24) {
+        head[0] = major | value;
+        len = 1;
+    } else if (value <= UINT8_MAX) {
+        head[0] = major | 24;
+        len = 2;
+    } else if (value <= UINT16_MAX) {
+        head[0] = major | 25;
+        len = 3;
+    } else if (value <= UINT32_MAX) {
+        head[0] = major | 26;
+        len = 5;
+    } else {
+        head[0] = major | 27;
+        len = 9;
+    }
+
+    /* CBOR is big endian */
+    for (size_t i = len - 1; i > 0; i--) {
+        head[i] = value & 0xff;
+        value >>= 8;
+    }
+    cbor->write(cbor->ctx, head, len);
+}
+
+static int cbor_null(void *ctx) {
+    write_byte(ctx, CBOR_NULL);
+    return 1;
+}
+
+static int cbor_boolean(void *ctx, int val) {
+    write_byte(ctx, (val ? CBOR_TRUE : CBOR_FALSE));
+    return 1;
+}
+
+#if YAJL_MAJOR >= 2
+static int cbor_integer(void *ctx, long long val) {
+#else
+static int cbor_integer(void *ctx, long val) {
+#endif
+    if (val >= 0)
+        write_head(ctx, CBOR_UNSIGNED, val);
+    else write_head(ctx, CBOR_NEGATIVE, -1 - val);
+    return 1;
+}
+
+static int cbor_double(void *ctx, double val) {
+    ipc_cbor *cbor = ctx;
+    uint64_t bits;
+    memcpy(&bits, &val, sizeof(bits));
+
+    uint8_t item[9] = { CBOR_DOUBLE };
+    for (int i = 8; i > 0; i--) {
+        item[i] = bits & 0xff;
+        bits >>= 8;
+    }
+    cbor->write(cbor->ctx, item, sizeof(item));
+    return 1;
+}
+
+static int cbor_string(void *ctx, const unsigned char *val, ylength len) {
+    ipc_cbor *cbor = ctx;
+    write_head(cbor, CBOR_TEXT, len);
+    cbor->write(cbor->ctx, val, len);
+    return 1;
+}
+
+static int cbor_start_map(void *ctx) {
+    write_byte(ctx, CBOR_MAP_BEGIN);
+    return 1;
+}
+
+static int cbor_start_array(void *ctx) {
+    write_byte(ctx, CBOR_ARRAY_BEGIN);
+    return 1;
+}
+
+static int cbor_end(void *ctx) {
+    write_byte(ctx, CBOR_BREAK);
+    return 1;
+}
+
+static yajl_callbacks cbor_callbacks = {
+    .yajl_null = cbor_null,
+    .yajl_boolean = cbor_boolean,
+    .yajl_integer = cbor_integer,
+    .yajl_double = cbor_double,
+    .yajl_string = cbor_string,
+    .yajl_start_map = cbor_start_map,
+    .yajl_map_key = cbor_string,
+    .yajl_end_map = cbor_end,
+    .yajl_start_array = cbor_start_array,
+    .yajl_end_array = cbor_end,
+};
+
+/*
+ * Creates an encoder which translates the JSON text passed to
+ * ipc_cbor_feed() into CBOR, which is passed to write as soon as it is
+ * available. The JSON text does not need to be complete.
+ *
+ */
+ipc_cbor *ipc_cbor_new(ipc_cbor_write_t write, void *ctx) {
+    ipc_cbor *cbor = smalloc(sizeof(ipc_cbor));
+    cbor->write = write;
+    cbor->ctx = ctx;
+#if YAJL_MAJOR >= 2
+    cbor->handle = yajl_alloc(&cbor_callbacks, NULL, cbor);
+    /* yajl_gen does not validate strings either, so window titles with
+     * invalid UTF-8 must not make the translation fail. */
+    yajl_config(cbor->handle, yajl_dont_validate_strings, 1);
+#else
+    yajl_parser_config parse_conf = { 0, 0 };
+    cbor->handle = yajl_alloc(&cbor_callbacks, &parse_conf, NULL, cbor);
+#endif
+    return cbor;
+}
+
+/*
+ * Translates the next chunk of JSON text. Returns false if it is not valid
+ * JSON, in which case the output is incomplete.
+ *
+ */
+bool ipc_cbor_feed(ipc_cbor *cbor, const unsigned char *json, size_t len) {
+    return (yajl_parse(cbor->handle, json, len) == yajl_status_ok);
+}
+
+/*
+ * Translates whatever is left (a number at the very end of the input) and
+ * frees the encoder. Returns false if the input was not valid JSON.
+ *
+ */
+bool ipc_cbor_finish(ipc_cbor *cbor) {
+#if YAJL_MAJOR >= 2
+    const yajl_status status = yajl_complete_parse(cbor->handle);
+#else
+    const yajl_status status = yajl_parse_complete(cbor->handle);
+#endif
+    yajl_free(cbor->handle);
+    free(cbor);
+    return (status == yajl_status_ok);
+}
+
+struct cbor_buffer {
+    uint8_t *data;
+    size_t len;
+    size_t capacity;
+};
+
+static void buffer_write(void *ctx, const void *data, size_t len) {
+    struct cbor_buffer *buffer = ctx;
+    if (buffer->len + len > buffer->capacity) {
+        while (buffer->len + len > buffer->capacity)
+            buffer->capacity *= 2;
+        buffer->data = srealloc(buffer->data, buffer->capacity);
+    }
+    memcpy(buffer->data + buffer->len, data, len);
+    buffer->len += len;
+}
+
+/*
+ * Translates the given JSON text into CBOR. Returns a buffer which has to be
+ * free()d by the caller and stores its length in *length.
+ *
+ */
+uint8_t *ipc_cbor_from_json(const unsigned char *json, size_t len, size_t *length) {
+    /* CBOR is usually smaller than the JSON text, so this rarely grows. */
+    struct cbor_buffer buffer = { NULL, 0, len + 16 };
+    buffer.data = smalloc(buffer.capacity);
+
+    ipc_cbor *cbor = ipc_cbor_new(buffer_write, &buffer);
+    bool ok = ipc_cbor_feed(cbor, json, len);
+    if (!ipc_cbor_finish(cbor) || !ok)
+        ELOG("Could not translate IPC payload into CBOR: %.*s\n", (int)len, json);
+
+    *length = buffer.len;
+    return buffer.data;
+}
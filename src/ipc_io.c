@@ -0,0 +1,458 @@
+#undef I3__FILE__
+#define I3__FILE__ "ipc_io.c"
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009-2013 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * ipc_io.c: Optional thread which writes the output of IPC clients, so that
+ *           slow clients and big event fan-outs do not delay the handling of
+ *           X11 events.
+ *
+ * Everything else (reading and handling messages, generating replies and
+ * events) stays in the main thread, which hands the output of each client to
+ * the I/O thread once a message is complete (see ipc_push_pending() in
+ * ipc.c). The threads communicate through two single-producer single-consumer
+ * queues which do not need any locks: messages to the I/O thread wake it up
+ * via a pipe (only if it is waiting), write errors are reported back to the
+ * main thread via an ev_async watcher.
+ *
+ */
+#include "all.h"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <poll.h>
+#include <sched.h>
+#include <signal.h>
+
+/* A piece of output, see ipc_io_submit(). */
+struct ipc_io_chunk {
+    uint8_t *data;
+    size_t offset;
+    size_t len;
+
+    TAILQ_ENTRY(ipc_io_chunk) chunks;
+};
+
+struct ipc_io_conn {
+    int fd;
+    uint64_t id;
+
+    /* Bytes which were submitted but not written yet. Updated by both
+     * threads, therefore only accessed atomically. */
+    size_t pending;
+
+    /* The following fields are only used by the I/O thread. */
+
+    /* Whether the connection is in the list of active connections, which
+     * have pending output or a write error which was not reported yet. */
+    bool active;
+    bool writeable;
+    bool failed;
+    bool report_pending;
+    TAILQ_HEAD(chunks_head, ipc_io_chunk) chunks;
+    TAILQ_ENTRY(ipc_io_conn) active_conns;
+};
+
+typedef enum {
+    IO_DATA,
+    IO_CLOSE,
+    IO_STOP,
+    IO_ERROR
+} io_message_type_t;
+
+struct io_message {
+    io_message_type_t type;
+    ipc_io_conn *conn;
+    struct ipc_io_chunk *chunk;
+    uint64_t id;
+};
+
+/* Needs to be a power of two, so that the indexes can wrap around. */
+#define IO_QUEUE_SIZE 1024
+
+/* The producer only writes tail, the consumer only writes head. Both indexes
+ * grow monotonically, head == tail means that the queue is empty. */
+struct io_queue {
+    struct io_message entries[IO_QUEUE_SIZE];
+    size_t head;
+    size_t tail;
+};
+
+static struct io_queue to_thread;
+static struct io_queue from_thread;
+
+static pthread_t thread;
+static bool running;
+static int wakeup_pipe[2];
+/* Set by the I/O thread while it waits in poll(). */
+static int sleeping;
+static struct ev_async *error_watcher;
+static ipc_io_error_cb error_cb;
+static uint64_t next_id = 1;
+
+static bool queue_push(struct io_queue *queue, const struct io_message *message) {
+    const size_t tail = queue->tail;
+    if (tail - __atomic_load_n(&(queue->head), __ATOMIC_ACQUIRE) == IO_QUEUE_SIZE)
+        return false;
+    queue->entries[tail % IO_QUEUE_SIZE] = *message;
+    __atomic_store_n(&(queue->tail), tail + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+static bool queue_pop(struct io_queue *queue, struct io_message *message) {
+    const size_t head = queue->head;
+    if (head == __atomic_load_n(&(queue->tail), __ATOMIC_ACQUIRE))
+        return false;
+    *message = queue->entries[head % IO_QUEUE_SIZE];
+    __atomic_store_n(&(queue->head), head + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+static bool queue_empty(struct io_queue *queue) {
+    return (__atomic_load_n(&(queue->head), __ATOMIC_ACQUIRE) ==
+            __atomic_load_n(&(queue->tail), __ATOMIC_ACQUIRE));
+}
+
+static void wakeup_thread(void) {
+    /* Pairs with the fence in io_thread() before it checks the queue for the
+     * last time: either the thread sees the new message or we see that it
+     * is sleeping. */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (!__atomic_exchange_n(&sleeping, 0, __ATOMIC_SEQ_CST))
+        return;
+
+    const char c = 0;
+    /* If the pipe is full, the thread gets woken up anyway. */
+    if (write(wakeup_pipe[1], &c, 1) == -1 && errno != EAGAIN)
+        ELOG("IPC: could not wake up the I/O thread: %s\n", strerror(errno));
+}
+
+static void send_to_thread(const struct io_message *message) {
+    /* The I/O thread empties the queue whenever it wakes up, so it is only
+     * full for a very short time. */
+    while (!queue_push(&to_thread, message)) {
+        wakeup_thread();
+        sched_yield();
+    }
+    wakeup_thread();
+}
+
+static void free_chunks(ipc_io_conn *conn) {
+    struct ipc_io_chunk *chunk;
+    while (!TAILQ_EMPTY(&(conn->chunks))) {
+        chunk = TAILQ_FIRST(&(conn->chunks));
+        TAILQ_REMOVE(&(conn->chunks), chunk, chunks);
+        free(chunk->data);
+        free(chunk);
+    }
+    __atomic_store_n(&(conn->pending), 0, __ATOMIC_RELEASE);
+}
+
+/*
+ * Writes as much of the pending output of the connection as possible
+ * without blocking. Returns false on write errors.
+ *
+ */
+static bool write_pending(ipc_io_conn *conn) {
+    struct ipc_io_chunk *chunk;
+    while ((chunk = TAILQ_FIRST(&(conn->chunks))) != NULL) {
+        const ssize_t n = write(conn->fd, chunk->data + chunk->offset, chunk->len);
+        if (n == -1) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                conn->writeable = false;
+                return true;
+            }
+            return false;
+        }
+
+        __atomic_sub_fetch(&(conn->pending), n, __ATOMIC_RELEASE);
+        chunk->offset += n;
+        chunk->len -= n;
+        if (chunk->len == 0) {
+            TAILQ_REMOVE(&(conn->chunks), chunk, chunks);
+            free(chunk->data);
+            free(chunk);
+        }
+    }
+    return true;
+}
+
+static void *io_thread(void *unused) {
+    TAILQ_HEAD(active_conns_head, ipc_io_conn) active = TAILQ_HEAD_INITIALIZER(active);
+    struct pollfd *fds = NULL;
+    ipc_io_conn **polled = NULL;
+    size_t capacity = 0;
+    bool stop = false;
+
+    while (true) {
+        struct io_message message;
+        while (queue_pop(&to_thread, &message)) {
+            ipc_io_conn *conn = message.conn;
+            switch (message.type) {
+                case IO_DATA:
+                    if (conn->failed) {
+                        __atomic_sub_fetch(&(conn->pending), message.chunk->len, __ATOMIC_RELEASE);
+                        free(message.chunk->data);
+                        free(message.chunk);
+                        break;
+                    }
+                    TAILQ_INSERT_TAIL(&(conn->chunks), message.chunk, chunks);
+                    conn->writeable = true;
+                    if (!conn->active) {
+                        TAILQ_INSERT_TAIL(&active, conn, active_conns);
+                        conn->active = true;
+                    }
+                    break;
+                case IO_CLOSE:
+                    if (conn->active)
+                        TAILQ_REMOVE(&active, conn, active_conns);
+                    free_chunks(conn);
+                    close(conn->fd);
+                    free(conn);
+                    break;
+                case IO_STOP:
+                    stop = true;
+                    break;
+                case IO_ERROR:
+                    break;
+            }
+        }
+
+        /* Write to all connections which might accept output and collect the
+         * ones which have to wait for their socket to become writeable. */
+        size_t nfds = 1;
+        bool reports_pending = false;
+        bool reported = false;
+        ipc_io_conn *conn, *next;
+        for (conn = TAILQ_FIRST(&active); conn != TAILQ_END(&active); conn = next) {
+            next = TAILQ_NEXT(conn, active_conns);
+
+            if (!conn->failed && conn->writeable && !write_pending(conn)) {
+                conn->failed = true;
+                conn->report_pending = true;
+                free_chunks(conn);
+            }
+
+            if (conn->report_pending) {
+                const struct io_message error = { IO_ERROR, NULL, NULL, conn->id };
+                if (queue_push(&from_thread, &error)) {
+                    conn->report_pending = false;
+                    reported = true;
+                } else reports_pending = true;
+            }
+
+            if (TAILQ_EMPTY(&(conn->chunks)) && !conn->report_pending) {
+                TAILQ_REMOVE(&active, conn, active_conns);
+                conn->active = false;
+                continue;
+            }
+            if (conn->failed)
+                continue;
+
+            if (nfds == capacity || capacity == 0) {
+                capacity = (capacity == 0 ? 16 : capacity * 2);
+                fds = srealloc(fds, capacity * sizeof(struct pollfd));
+                polled = srealloc(polled, capacity * sizeof(ipc_io_conn*));
+            }
+            fds[nfds].fd = conn->fd;
+            fds[nfds].events = POLLOUT;
+            polled[nfds] = conn;
+            nfds++;
+        }
+
+        if (reported)
+            ev_async_send(main_loop, error_watcher);
+
+        if (stop)
+            break;
+
+        if (capacity == 0) {
+            capacity = 16;
+            fds = smalloc(capacity * sizeof(struct pollfd));
+            polled = smalloc(capacity * sizeof(ipc_io_conn*));
+        }
+        fds[0].fd = wakeup_pipe[0];
+        fds[0].events = POLLIN;
+
+        __atomic_store_n(&sleeping, 1, __ATOMIC_SEQ_CST);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if (!queue_empty(&to_thread)) {
+            __atomic_store_n(&sleeping, 0, __ATOMIC_SEQ_CST);
+            continue;
+        }
+
+        /* If the queue to the main thread is full, try again later. Errors
+         * are not logged, since the log functions are not thread-safe; the
+         * loop just starts over. */
+        if (poll(fds, nfds, (reports_pending ? 10 : -1)) == -1)
+            memset(fds, 0, nfds * sizeof(struct pollfd));
+        __atomic_store_n(&sleeping, 0, __ATOMIC_SEQ_CST);
+
+        if (fds[0].revents & POLLIN) {
+            char buffer[64];
+            while (read(wakeup_pipe[0], buffer, sizeof(buffer)) > 0) {
+                /* drain */
+            }
+        }
+        for (size_t i = 1; i < nfds; i++)
+            if (fds[i].revents != 0)
+                polled[i]->writeable = true;
+    }
+
+    free(fds);
+    free(polled);
+    return NULL;
+}
+
+/*
+ * Handler for errors reported by the I/O thread.
+ *
+ */
+static void error_watcher_cb(EV_P_ ev_async *w, int revents) {
+    struct io_message message;
+    while (queue_pop(&from_thread, &message))
+        error_cb(message.id);
+}
+
+/*
+ * Starts the I/O thread. Returns false if it could not be started, in which
+ * case the output has to be written by the main thread as usual.
+ *
+ */
+bool ipc_io_start(ipc_io_error_cb on_error) {
+    if (running)
+        return true;
+
+    if (pipe(wakeup_pipe) == -1) {
+        ELOG("IPC: could not create the wakeup pipe: %s\n", strerror(errno));
+        return false;
+    }
+    for (int i = 0; i < 2; i++) {
+        (void)fcntl(wakeup_pipe[i], F_SETFD, FD_CLOEXEC);
+        (void)fcntl(wakeup_pipe[i], F_SETFL, O_NONBLOCK);
+    }
+
+    error_cb = on_error;
+    error_watcher = scalloc(sizeof(struct ev_async));
+    ev_async_init(error_watcher, error_watcher_cb);
+    ev_async_start(main_loop, error_watcher);
+
+    /* Signals are handled by the main thread. */
+    sigset_t all, old;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+    const int error = pthread_create(&thread, NULL, io_thread, NULL);
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+    if (error != 0) {
+        ELOG("IPC: could not start the I/O thread: %s\n", strerror(error));
+        ev_async_stop(main_loop, error_watcher);
+        FREE(error_watcher);
+        close(wakeup_pipe[0]);
+        close(wakeup_pipe[1]);
+        return false;
+    }
+
+    DLOG("IPC: I/O thread started\n");
+    running = true;
+    return true;
+}
+
+/*
+ * Returns true if the I/O thread is running.
+ *
+ */
+bool ipc_io_running(void) {
+    return running;
+}
+
+/*
+ * Creates the I/O thread’s state for the client connected on fd. From now
+ * on, the I/O thread closes fd (see ipc_io_close()).
+ *
+ */
+ipc_io_conn *ipc_io_conn_new(int fd) {
+    ipc_io_conn *conn = scalloc(sizeof(ipc_io_conn));
+    conn->fd = fd;
+    conn->id = next_id++;
+    TAILQ_INIT(&(conn->chunks));
+    return conn;
+}
+
+/*
+ * Returns the ID of the connection, which is unique for the lifetime of the
+ * process (unlike the address of conn).
+ *
+ */
+uint64_t ipc_io_conn_id(const ipc_io_conn *conn) {
+    return conn->id;
+}
+
+/*
+ * Queues len bytes starting at data + offset to be written to the
+ * connection. Takes ownership of data, which has been allocated with
+ * malloc(). Never blocks unless the queue to the I/O thread is full.
+ *
+ */
+void ipc_io_submit(ipc_io_conn *conn, uint8_t *data, size_t offset, size_t len) {
+    struct ipc_io_chunk *chunk = smalloc(sizeof(struct ipc_io_chunk));
+    chunk->data = data;
+    chunk->offset = offset;
+    chunk->len = len;
+
+    __atomic_add_fetch(&(conn->pending), len, __ATOMIC_RELEASE);
+    const struct io_message message = { IO_DATA, conn, chunk, 0 };
+    send_to_thread(&message);
+}
+
+/*
+ * Returns the number of bytes which were submitted but not yet written.
+ *
+ */
+size_t ipc_io_pending(ipc_io_conn *conn) {
+    return __atomic_load_n(&(conn->pending), __ATOMIC_ACQUIRE);
+}
+
+/*
+ * Discards the pending output, closes the connection and frees conn. The
+ * connection must not be used afterwards.
+ *
+ */
+void ipc_io_close(ipc_io_conn *conn) {
+    if (!running) {
+        free_chunks(conn);
+        close(conn->fd);
+        free(conn);
+        return;
+    }
+
+    const struct io_message message = { IO_CLOSE, conn, NULL, 0 };
+    send_to_thread(&message);
+}
+
+/*
+ * Stops the I/O thread after writing as much of the pending output as
+ * possible without blocking (see ipc_io_pending() for what is left). The
+ * connections are not closed. Used before an inplace restart.
+ *
+ */
+void ipc_io_stop(void) {
+    if (!running)
+        return;
+
+    const struct io_message message = { IO_STOP, NULL, NULL, 0 };
+    send_to_thread(&message);
+    pthread_join(thread, NULL);
+    running = false;
+
+    ev_async_stop(main_loop, error_watcher);
+    FREE(error_watcher);
+    close(wakeup_pipe[0]);
+    close(wakeup_pipe[1]);
+    DLOG("IPC: I/O thread stopped\n");
+}
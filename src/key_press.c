@@ -15,55 +15,63 @@
 #include <fcntl.h>
 #include "all.h"
 
-static int current_nesting_level;
-static bool parse_error_key;
-static bool command_failed;
+#include <xcb/xcbext.h>
 
 pid_t command_error_nagbar_pid = -1;
 
-static int json_boolean(void *ctx, int boolval) {
-    DLOG("Got bool: %d, parse_error_key %d, nesting_level %d\n", boolval, parse_error_key, current_nesting_level);
+/* The GetModifierMapping request sent after the last mapping change, see
+ * key_press_mapping_changed(). */
+static bool modifier_mapping_pending = false;
+static xcb_get_modifier_mapping_cookie_t modifier_mapping_cookie;
 
-    if (parse_error_key && current_nesting_level == 1 && boolval)
-        command_failed = true;
+/*
+ * Requests the new modifier mapping after the keyboard mapping changed. The
+ * reply is picked up by key_press_poll_modifier_mapping() once it arrived, so
+ * that neither the mapping change nor the next key press wait for it. Until
+ * then, the previous xcb_numlock_mask is used.
+ *
+ */
+void key_press_mapping_changed(void) {
+    /* xmodmap changes the mapping in many steps, only the last one counts. */
+    if (modifier_mapping_pending)
+        xcb_discard_reply(conn, modifier_mapping_cookie.sequence);
 
-    return 1;
+    modifier_mapping_cookie = xcb_get_modifier_mapping(conn);
+    modifier_mapping_pending = true;
 }
 
-#if YAJL_MAJOR >= 2
-static int json_map_key(void *ctx, const unsigned char *stringval, size_t stringlen) {
-#else
-static int json_map_key(void *ctx, const unsigned char *stringval, unsigned int stringlen) {
-#endif
-    parse_error_key = (stringlen >= strlen("parse_error") &&
-                       strncmp((const char*)stringval, "parse_error", strlen("parse_error")) == 0);
-    return 1;
-}
+/*
+ * Updates xcb_numlock_mask if the reply to the request sent by
+ * key_press_mapping_changed() arrived. Re-grabs the keys if the mask changed,
+ * since every binding is grabbed with and without Num_Lock. Never blocks.
+ *
+ */
+void key_press_poll_modifier_mapping(void) {
+    if (!modifier_mapping_pending)
+        return;
+
+    void *reply = NULL;
+    xcb_generic_error_t *error = NULL;
+    if (xcb_poll_for_reply(conn, modifier_mapping_cookie.sequence, &reply, &error) == 0)
+        return;
+
+    modifier_mapping_pending = false;
+    if (reply == NULL) {
+        ELOG("Could not get the modifier mapping\n");
+        free(error);
+        return;
+    }
 
-static int json_start_map(void *ctx) {
-    current_nesting_level++;
-    return 1;
-}
+    unsigned int numlock_mask = get_mod_mask_for(XCB_NUM_LOCK, keysyms, reply);
+    free(reply);
+    if (numlock_mask == xcb_numlock_mask)
+        return;
 
-static int json_end_map(void *ctx) {
-    current_nesting_level--;
-    return 1;
+    DLOG("Num_Lock mask changed from 0x%x to 0x%x, re-grabbing keys\n", xcb_numlock_mask, numlock_mask);
+    xcb_numlock_mask = numlock_mask;
+    update_key_grabs(conn, (xkb_current_group == XkbGroup2Index));
 }
 
-static yajl_callbacks command_error_callbacks = {
-    NULL,
-    &json_boolean,
-    NULL,
-    NULL,
-    NULL,
-    NULL,
-    &json_start_map,
-    &json_map_key,
-    &json_end_map,
-    NULL,
-    NULL
-};
-
 /*
  * There was a KeyPress or KeyRelease (both events have the same fields). We
  * compare this key code with our bindings table and pass the bound action to
@@ -77,6 +85,10 @@ void handle_key_press(xcb_key_press_event_t *event) {
 
     DLOG("%s %d, state raw = %d\n", (key_release ? "KeyRelease" : "KeyPress"), event->detail, event->state);
 
+    /* The state is filtered with the cached masks and XKB group, which are
+     * only updated by the events which change them. */
+    key_press_poll_modifier_mapping();
+
     /* Remove the numlock bit, all other bits are modifiers we can bind to */
     uint16_t state_filtered = event->state & ~(xcb_numlock_mask | XCB_MOD_MASK_LOCK);
     DLOG("(removed numlock, state = %d)\n", state_filtered);
@@ -112,56 +124,40 @@ void handle_key_press(xcb_key_press_event_t *event) {
         }
     }
 
-    char *command_copy = sstrdup(bind->command);
-    struct CommandResult *command_output = parse_command(command_copy);
-    free(command_copy);
-
-    if (command_output->needs_tree_render)
-        tree_render();
+    /* Bindings are compiled when loading the configuration. Only commands
+     * which could not be parsed are run through the parser again (to report
+     * the error). */
+    event_record_command(bind->command);
 
-    /* We parse the JSON reply to figure out whether there was an error
-     * ("success" being false in on of the returned dictionaries). */
-    const unsigned char *reply;
-#if YAJL_MAJOR >= 2
-    size_t length;
-    yajl_handle handle = yajl_alloc(&command_error_callbacks, NULL, NULL);
-#else
-    unsigned int length;
-    yajl_parser_config parse_conf = { 0, 0 };
-
-    yajl_handle handle = yajl_alloc(&command_error_callbacks, &parse_conf, NULL, NULL);
-#endif
-    yajl_gen_get_buf(command_output->json_gen, &reply, &length);
-
-    current_nesting_level = 0;
-    parse_error_key = false;
-    command_failed = false;
-    yajl_status state = yajl_parse(handle, reply, length);
-    if (state != yajl_status_ok) {
-        ELOG("Could not parse my own reply. That's weird. reply is %.*s\n", (int)length, reply);
+    struct CommandResult *command_output;
+    if (bind->compiled != NULL) {
+        command_output = run_compiled_command(bind->compiled, NULL);
     } else {
-        if (command_failed) {
-            char *pageraction;
-            sasprintf(&pageraction, "i3-sensible-pager \"%s\"\n", errorfilename);
-            char *argv[] = {
-                NULL, /* will be replaced by the executable path */
-                "-f",
-                config.font.pattern,
-                "-t",
-                "error",
-                "-m",
-                "The configured command for this shortcut could not be run successfully.",
-                "-b",
-                "show errors",
-                pageraction,
-                NULL
-            };
-            start_nagbar(&command_error_nagbar_pid, argv);
-            free(pageraction);
-        }
+        char *command_copy = sstrdup(bind->command);
+        command_output = parse_command(command_copy, NULL);
+        free(command_copy);
     }
 
-    yajl_free(handle);
+    if (command_output->needs_tree_render)
+        tree_render();
 
-    yajl_gen_free(command_output->json_gen);
+    if (command_output->parse_error) {
+        char *pageraction;
+        sasprintf(&pageraction, "i3-sensible-pager \"%s\"\n", errorfilename);
+        char *argv[] = {
+            NULL, /* will be replaced by the executable path */
+            "-f",
+            config.font.pattern,
+            "-t",
+            "error",
+            "-m",
+            "The configured command for this shortcut could not be run successfully.",
+            "-b",
+            "show errors",
+            pageraction,
+            NULL
+        };
+        start_nagbar(&command_error_nagbar_pid, argv);
+        free(pageraction);
+    }
 }
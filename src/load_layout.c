@@ -17,9 +17,97 @@
 #include <yajl/yajl_parse.h>
 #include <yajl/yajl_version.h>
 
+#include <zlib.h>
+
+/* The number of bytes read from the layout file (after decompression) per
+ * yajl_parse() call. */
+#define LAYOUT_CHUNK_SIZE 65536
+
 /* TODO: refactor the whole parsing thing */
 
+/* The keys we handle. json_key() looks up each key once, so that the value
+ * callbacks only need to compare integers. */
+typedef enum {
+    KEY_UNKNOWN = 0,
+    KEY_BORDER,
+    KEY_CLASS,
+    KEY_CURRENT_BORDER_WIDTH,
+    KEY_DEPTH,
+    KEY_DOCK,
+    KEY_FLOATING,
+    KEY_FLOATING_NODES,
+    KEY_FOCUS,
+    KEY_FOCUSED,
+    KEY_FULLSCREEN_MODE,
+    KEY_GEOMETRY,
+    KEY_HEIGHT,
+    KEY_ID,
+    KEY_INSERT_WHERE,
+    KEY_LAST_SPLIT_LAYOUT,
+    KEY_LAYOUT,
+    KEY_MARK,
+    KEY_NAME,
+    KEY_NUM,
+    KEY_ORIENTATION,
+    KEY_PERCENT,
+    KEY_RECT,
+    KEY_RESTART_MODE,
+    KEY_SCRATCHPAD_STATE,
+    KEY_STICKY_GROUP,
+    KEY_SWALLOWS,
+    KEY_TYPE,
+    KEY_WIDTH,
+    KEY_WINDOW_RECT,
+    KEY_WORKSPACE_LAYOUT,
+    KEY_X,
+    KEY_Y,
+} layout_key_t;
+
+/* Sorted by strcasecmp() for bsearch(). */
+static const struct layout_key {
+    const char *name;
+    layout_key_t key;
+} layout_keys[] = {
+    { "border", KEY_BORDER },
+    { "class", KEY_CLASS },
+    { "current_border_width", KEY_CURRENT_BORDER_WIDTH },
+    { "depth", KEY_DEPTH },
+    { "dock", KEY_DOCK },
+    { "floating", KEY_FLOATING },
+    { "floating_nodes", KEY_FLOATING_NODES },
+    { "focus", KEY_FOCUS },
+    { "focused", KEY_FOCUSED },
+    { "fullscreen_mode", KEY_FULLSCREEN_MODE },
+    { "geometry", KEY_GEOMETRY },
+    { "height", KEY_HEIGHT },
+    { "id", KEY_ID },
+    { "insert_where", KEY_INSERT_WHERE },
+    { "last_split_layout", KEY_LAST_SPLIT_LAYOUT },
+    { "layout", KEY_LAYOUT },
+    { "mark", KEY_MARK },
+    { "name", KEY_NAME },
+    { "num", KEY_NUM },
+    { "orientation", KEY_ORIENTATION },
+    { "percent", KEY_PERCENT },
+    { "rect", KEY_RECT },
+    { "restart_mode", KEY_RESTART_MODE },
+    { "scratchpad_state", KEY_SCRATCHPAD_STATE },
+    { "sticky_group", KEY_STICKY_GROUP },
+    { "swallows", KEY_SWALLOWS },
+    { "type", KEY_TYPE },
+    { "width", KEY_WIDTH },
+    { "window_rect", KEY_WINDOW_RECT },
+    { "workspace_layout", KEY_WORKSPACE_LAYOUT },
+    { "x", KEY_X },
+    { "y", KEY_Y },
+};
+
+static int layout_key_cmp(const void *key, const void *element) {
+    return strcasecmp(key, ((const struct layout_key*)element)->name);
+}
+
 static char *last_key;
+static layout_key_t last_key_id;
 static Con *json_node;
 static Con *to_focus;
 static bool parsing_swallows;
@@ -29,6 +117,21 @@ static bool parsing_geometry;
 static bool parsing_focus;
 struct Match *current_swallow;
 
+/* The containers created so far, in the order in which they were completed
+ * (children before their parents). They are only attached to the existing
+ * tree and get their frames once the whole file is parsed, see
+ * append_new_cons(). */
+static struct new_con {
+    Con *con;
+    /* Whether con is the top of the subtree and still needs to be attached */
+    bool attach;
+} *new_cons;
+static int new_cons_num;
+static int new_cons_size;
+/* Number of container maps which are currently open. Containers completed at
+ * nesting 0 are the top of the appended subtree. */
+static int con_nesting;
+
 /* This list is used for reordering the focus stack after parsing the 'focus'
  * array. */
 struct focus_mapping {
@@ -40,15 +143,15 @@ static TAILQ_HEAD(focus_mappings_head, focus_mapping) focus_mappings =
   TAILQ_HEAD_INITIALIZER(focus_mappings);
 
 static int json_start_map(void *ctx) {
-    LOG("start of map, last_key = %s\n", last_key);
+    DLOG("start of map, last_key = %s\n", last_key);
     if (parsing_swallows) {
-        LOG("creating new swallow\n");
-        current_swallow = smalloc(sizeof(Match));
+        DLOG("creating new swallow\n");
+        current_swallow = pool_alloc(&match_pool);
         match_init(current_swallow);
         TAILQ_INSERT_TAIL(&(json_node->swallow_head), current_swallow, matches);
     } else {
         if (!parsing_rect && !parsing_window_rect && !parsing_geometry) {
-            if (last_key && strcasecmp(last_key, "floating_nodes") == 0) {
+            if (last_key_id == KEY_FLOATING_NODES) {
                 DLOG("New floating_node\n");
                 Con *ws = con_get_workspace(json_node);
                 json_node = con_new_skeleton(NULL, NULL);
@@ -59,18 +162,31 @@ static int json_start_map(void *ctx) {
                 json_node = con_new_skeleton(NULL, NULL);
                 json_node->parent = parent;
             }
+            con_nesting++;
         }
     }
     return 1;
 }
 
 static int json_end_map(void *ctx) {
-    LOG("end of map\n");
+    DLOG("end of map\n");
     if (!parsing_swallows && !parsing_rect && !parsing_window_rect && !parsing_geometry) {
-        LOG("attaching\n");
-        con_attach(json_node, json_node->parent, true);
-        LOG("Creating window\n");
-        x_con_init(json_node, json_node->depth);
+        /* The swallows are complete now. */
+        Match *match;
+        TAILQ_FOREACH(match, &(json_node->swallow_head), matches)
+            con_index_swallow(json_node, match);
+
+        /* Containers within the new subtree can be attached right away, the
+         * top of the subtree is attached by append_new_cons(). */
+        bool attach = (--con_nesting == 0);
+        if (!attach)
+            con_attach(json_node, json_node->parent, true);
+
+        if (new_cons_num == new_cons_size) {
+            new_cons_size = (new_cons_size == 0 ? 64 : new_cons_size * 2);
+            new_cons = srealloc(new_cons, new_cons_size * sizeof(struct new_con));
+        }
+        new_cons[new_cons_num++] = (struct new_con){ json_node, attach };
         json_node = json_node->parent;
     }
     if (parsing_rect)
@@ -83,18 +199,18 @@ static int json_end_map(void *ctx) {
 }
 
 static int json_end_array(void *ctx) {
-    LOG("end of array\n");
+    DLOG("end of array\n");
     parsing_swallows = false;
     if (parsing_focus) {
         /* Clear the list of focus mappings */
         struct focus_mapping *mapping;
         TAILQ_FOREACH_REVERSE(mapping, &focus_mappings, focus_mappings_head, focus_mappings) {
-            LOG("focus (reverse) %d\n", mapping->old_id);
+            DLOG("focus (reverse) %d\n", mapping->old_id);
             Con *con;
             TAILQ_FOREACH(con, &(json_node->focus_head), focused) {
                 if (con->old_id != mapping->old_id)
                     continue;
-                LOG("got it! %p\n", con);
+                DLOG("got it! %p\n", con);
                 /* Move this entry to the top of the focus list. */
                 TAILQ_REMOVE(&(json_node->focus_head), con, focused);
                 TAILQ_INSERT_HEAD(&(json_node->focus_head), con, focused);
@@ -116,23 +232,29 @@ static int json_key(void *ctx, const unsigned char *val, unsigned int len) {
 #else
 static int json_key(void *ctx, const unsigned char *val, size_t len) {
 #endif
-    LOG("key: %.*s\n", (int)len, val);
+    DLOG("key: %.*s\n", (int)len, val);
     FREE(last_key);
     last_key = scalloc((len+1) * sizeof(char));
     memcpy(last_key, val, len);
-    if (strcasecmp(last_key, "swallows") == 0)
+
+    const struct layout_key *key = bsearch(last_key, layout_keys,
+                                           sizeof(layout_keys) / sizeof(struct layout_key),
+                                           sizeof(struct layout_key), layout_key_cmp);
+    last_key_id = (key != NULL ? key->key : KEY_UNKNOWN);
+
+    if (last_key_id == KEY_SWALLOWS)
         parsing_swallows = true;
 
-    if (strcasecmp(last_key, "rect") == 0)
+    if (last_key_id == KEY_RECT)
         parsing_rect = true;
 
-    if (strcasecmp(last_key, "window_rect") == 0)
+    if (last_key_id == KEY_WINDOW_RECT)
         parsing_window_rect = true;
 
-    if (strcasecmp(last_key, "geometry") == 0)
+    if (last_key_id == KEY_GEOMETRY)
         parsing_geometry = true;
 
-    if (strcasecmp(last_key, "focus") == 0)
+    if (last_key_id == KEY_FOCUS)
         parsing_focus = true;
 
     return 1;
@@ -143,23 +265,26 @@ static int json_string(void *ctx, const unsigned char *val, size_t len) {
 #else
 static int json_string(void *ctx, const unsigned char *val, unsigned int len) {
 #endif
-    LOG("string: %.*s for key %s\n", (int)len, val, last_key);
+    DLOG("string: %.*s for key %s\n", (int)len, val, last_key);
     if (parsing_swallows) {
         /* TODO: the other swallowing keys */
-        if (strcasecmp(last_key, "class") == 0) {
-            current_swallow->class = scalloc((len+1) * sizeof(char));
-            memcpy(current_swallow->class, val, len);
+        if (last_key_id == KEY_CLASS) {
+            char *buf = NULL;
+            sasprintf(&buf, "%.*s", (int)len, val);
+            current_swallow->class = regex_new(buf);
+            free(buf);
         }
-        LOG("unhandled yet: swallow\n");
+        DLOG("unhandled yet: swallow\n");
     } else {
-        if (strcasecmp(last_key, "name") == 0) {
+        if (last_key_id == KEY_NAME) {
             json_node->name = scalloc((len+1) * sizeof(char));
             memcpy(json_node->name, val, len);
-        } else if (strcasecmp(last_key, "sticky_group") == 0) {
+        } else if (last_key_id == KEY_STICKY_GROUP) {
             json_node->sticky_group = scalloc((len+1) * sizeof(char));
             memcpy(json_node->sticky_group, val, len);
-            LOG("sticky_group of this container is %s\n", json_node->sticky_group);
-        } else if (strcasecmp(last_key, "orientation") == 0) {
+            workspace_index_sticky(json_node);
+            DLOG("sticky_group of this container is %s\n", json_node->sticky_group);
+        } else if (last_key_id == KEY_ORIENTATION) {
             /* Upgrade path from older versions of i3 (doing an inplace restart
              * to a newer version):
              * "orientation" is dumped before "layout". Therefore, we store
@@ -175,7 +300,7 @@ static int json_string(void *ctx, const unsigned char *val, unsigned int len) {
                 json_node->last_split_layout = L_SPLITV;
             else LOG("Unhandled orientation: %s\n", buf);
             free(buf);
-        } else if (strcasecmp(last_key, "border") == 0) {
+        } else if (last_key_id == KEY_BORDER) {
             char *buf = NULL;
             sasprintf(&buf, "%.*s", (int)len, val);
             if (strcasecmp(buf, "none") == 0)
@@ -189,7 +314,7 @@ static int json_string(void *ctx, const unsigned char *val, unsigned int len) {
                 json_node->border_style = BS_NORMAL;
             else LOG("Unhandled \"border\": %s\n", buf);
             free(buf);
-        } else if (strcasecmp(last_key, "layout") == 0) {
+        } else if (last_key_id == KEY_LAYOUT) {
             char *buf = NULL;
             sasprintf(&buf, "%.*s", (int)len, val);
             if (strcasecmp(buf, "default") == 0)
@@ -209,7 +334,7 @@ static int json_string(void *ctx, const unsigned char *val, unsigned int len) {
                 json_node->layout = L_SPLITV;
             else LOG("Unhandled \"layout\": %s\n", buf);
             free(buf);
-        } else if (strcasecmp(last_key, "workspace_layout") == 0) {
+        } else if (last_key_id == KEY_WORKSPACE_LAYOUT) {
             char *buf = NULL;
             sasprintf(&buf, "%.*s", (int)len, val);
             if (strcasecmp(buf, "default") == 0)
@@ -220,7 +345,7 @@ static int json_string(void *ctx, const unsigned char *val, unsigned int len) {
                 json_node->workspace_layout = L_TABBED;
             else LOG("Unhandled \"workspace_layout\": %s\n", buf);
             free(buf);
-        } else if (strcasecmp(last_key, "last_split_layout") == 0) {
+        } else if (last_key_id == KEY_LAST_SPLIT_LAYOUT) {
             char *buf = NULL;
             sasprintf(&buf, "%.*s", (int)len, val);
             if (strcasecmp(buf, "splith") == 0)
@@ -229,11 +354,12 @@ static int json_string(void *ctx, const unsigned char *val, unsigned int len) {
                 json_node->last_split_layout = L_SPLITV;
             else LOG("Unhandled \"last_splitlayout\": %s\n", buf);
             free(buf);
-        } else if (strcasecmp(last_key, "mark") == 0) {
+        } else if (last_key_id == KEY_MARK) {
             char *buf = NULL;
             sasprintf(&buf, "%.*s", (int)len, val);
-            json_node->mark = buf;
-        } else if (strcasecmp(last_key, "floating") == 0) {
+            con_set_mark(json_node, buf);
+            free(buf);
+        } else if (last_key_id == KEY_FLOATING) {
             char *buf = NULL;
             sasprintf(&buf, "%.*s", (int)len, val);
             if (strcasecmp(buf, "auto_off") == 0)
@@ -245,7 +371,7 @@ static int json_string(void *ctx, const unsigned char *val, unsigned int len) {
             else if (strcasecmp(buf, "user_on") == 0)
                 json_node->floating = FLOATING_USER_ON;
             free(buf);
-        } else if (strcasecmp(last_key, "scratchpad_state") == 0) {
+        } else if (last_key_id == KEY_SCRATCHPAD_STATE) {
             char *buf = NULL;
             sasprintf(&buf, "%.*s", (int)len, val);
             if (strcasecmp(buf, "none") == 0)
@@ -254,6 +380,7 @@ static int json_string(void *ctx, const unsigned char *val, unsigned int len) {
                 json_node->scratchpad_state = SCRATCHPAD_FRESH;
             else if (strcasecmp(buf, "changed") == 0)
                 json_node->scratchpad_state = SCRATCHPAD_CHANGED;
+            scratchpad_index(json_node);
             free(buf);
         }
     }
@@ -262,27 +389,27 @@ static int json_string(void *ctx, const unsigned char *val, unsigned int len) {
 
 #if YAJL_MAJOR >= 2
 static int json_int(void *ctx, long long val) {
-    LOG("int %lld for key %s\n", val, last_key);
+    DLOG("int %lld for key %s\n", val, last_key);
 #else
 static int json_int(void *ctx, long val) {
-    LOG("int %ld for key %s\n", val, last_key);
+    DLOG("int %ld for key %s\n", val, last_key);
 #endif
-    if (strcasecmp(last_key, "type") == 0)
+    if (last_key_id == KEY_TYPE)
         json_node->type = val;
 
-    if (strcasecmp(last_key, "fullscreen_mode") == 0)
-        json_node->fullscreen_mode = val;
+    if (last_key_id == KEY_FULLSCREEN_MODE)
+        con_set_fullscreen_mode(json_node, val);
 
-    if (strcasecmp(last_key, "num") == 0)
+    if (last_key_id == KEY_NUM)
         json_node->num = val;
 
-    if (strcasecmp(last_key, "current_border_width") == 0)
+    if (last_key_id == KEY_CURRENT_BORDER_WIDTH)
         json_node->current_border_width = val;
 
-    if (strcasecmp(last_key, "depth") == 0)
+    if (last_key_id == KEY_DEPTH)
         json_node->depth = val;
 
-    if (!parsing_swallows && strcasecmp(last_key, "id") == 0)
+    if (!parsing_swallows && last_key_id == KEY_ID)
         json_node->old_id = val;
 
     if (parsing_focus) {
@@ -298,26 +425,26 @@ static int json_int(void *ctx, long val) {
         else if (parsing_window_rect)
             r = &(json_node->window_rect);
         else r = &(json_node->geometry);
-        if (strcasecmp(last_key, "x") == 0)
+        if (last_key_id == KEY_X)
             r->x = val;
-        else if (strcasecmp(last_key, "y") == 0)
+        else if (last_key_id == KEY_Y)
             r->y = val;
-        else if (strcasecmp(last_key, "width") == 0)
+        else if (last_key_id == KEY_WIDTH)
             r->width = val;
-        else if (strcasecmp(last_key, "height") == 0)
+        else if (last_key_id == KEY_HEIGHT)
             r->height = val;
-        else printf("WARNING: unknown key %s in rect\n", last_key);
-        printf("rect now: (%d, %d, %d, %d)\n",
-                r->x, r->y, r->width, r->height);
+        else ELOG("unknown key %s in rect\n", last_key);
+        DLOG("rect now: (%d, %d, %d, %d)\n",
+             r->x, r->y, r->width, r->height);
     }
     if (parsing_swallows) {
-        if (strcasecmp(last_key, "id") == 0) {
+        if (last_key_id == KEY_ID) {
             current_swallow->id = val;
         }
-        if (strcasecmp(last_key, "dock") == 0) {
+        if (last_key_id == KEY_DOCK) {
             current_swallow->dock = val;
         }
-        if (strcasecmp(last_key, "insert_where") == 0) {
+        if (last_key_id == KEY_INSERT_WHERE) {
             current_swallow->insert_where = val;
         }
     }
@@ -326,13 +453,13 @@ static int json_int(void *ctx, long val) {
 }
 
 static int json_bool(void *ctx, int val) {
-    LOG("bool %d for key %s\n", val, last_key);
-    if (strcasecmp(last_key, "focused") == 0 && val) {
+    DLOG("bool %d for key %s\n", val, last_key);
+    if (last_key_id == KEY_FOCUSED && val) {
         to_focus = json_node;
     }
 
     if (parsing_swallows) {
-        if (strcasecmp(last_key, "restart_mode") == 0)
+        if (last_key_id == KEY_RESTART_MODE)
             current_swallow->restart_mode = val;
     }
 
@@ -340,34 +467,42 @@ static int json_bool(void *ctx, int val) {
 }
 
 static int json_double(void *ctx, double val) {
-    LOG("double %f for key %s\n", val, last_key);
-    if (strcasecmp(last_key, "percent") == 0) {
+    DLOG("double %f for key %s\n", val, last_key);
+    if (last_key_id == KEY_PERCENT) {
         json_node->percent = val;
     }
     return 1;
 }
 
+/*
+ * Attaches the top of the new subtree to the existing tree and creates the
+ * frames of all new containers. Doing this after parsing (instead of once per
+ * container) means that the X11 requests for the frames are sent in one go
+ * and that the rest of the tree is only changed once per top-level
+ * container, no matter how large the layout is.
+ *
+ */
+static void append_new_cons(void) {
+    for (int i = 0; i < new_cons_num; i++) {
+        Con *con = new_cons[i].con;
+        if (new_cons[i].attach)
+            con_attach(con, con->parent, true);
+        x_con_init(con, con->depth);
+    }
+
+    FREE(new_cons);
+    new_cons_num = new_cons_size = 0;
+}
+
 void tree_append_json(const char *filename) {
     /* TODO: percent of other windows are not correctly fixed at the moment */
-    FILE *f;
-    if ((f = fopen(filename, "r")) == NULL) {
+    /* gzread() reads uncompressed files as they are, so this also handles
+     * layouts which were compressed with gzip. */
+    gzFile f;
+    if ((f = gzopen(filename, "rb")) == NULL) {
         LOG("Cannot open file \"%s\"\n", filename);
         return;
     }
-    struct stat stbuf;
-    if (fstat(fileno(f), &stbuf) != 0) {
-        LOG("Cannot fstat() the file\n");
-        fclose(f);
-        return;
-    }
-    char *buf = smalloc(stbuf.st_size);
-    int n = fread(buf, 1, stbuf.st_size, f);
-    if (n != stbuf.st_size) {
-        LOG("File \"%s\" could not be read entirely, not loading.\n", filename);
-        fclose(f);
-        return;
-    }
-    LOG("read %d bytes\n", n);
     yajl_gen g;
     yajl_handle hand;
     yajl_callbacks callbacks;
@@ -387,29 +522,53 @@ void tree_append_json(const char *filename) {
     g = yajl_gen_alloc(NULL, NULL);
     hand = yajl_alloc(&callbacks, NULL, NULL, (void*)g);
 #endif
-    yajl_status stat;
     json_node = focused;
     to_focus = NULL;
+    last_key_id = KEY_UNKNOWN;
     parsing_rect = false;
     parsing_window_rect = false;
     parsing_geometry = false;
+    con_nesting = 0;
     setlocale(LC_NUMERIC, "C");
-    stat = yajl_parse(hand, (const unsigned char*)buf, n);
-    if (stat != yajl_status_ok)
-    {
-        unsigned char * str = yajl_get_error(hand, 1, (const unsigned char*)buf, n);
-        fprintf(stderr, "%s\n", (const char *) str);
-        yajl_free_error(hand, str);
-    }
 
-    setlocale(LC_NUMERIC, "");
+    /* The file is parsed in chunks, so that large layouts do not need to be
+     * held in memory entirely. */
+    unsigned char *buf = smalloc(LAYOUT_CHUNK_SIZE);
+    size_t total = 0;
+    int n;
+    while ((n = gzread(f, buf, LAYOUT_CHUNK_SIZE)) > 0) {
+        total += n;
+        if (yajl_parse(hand, buf, n) != yajl_status_ok) {
+            unsigned char *str = yajl_get_error(hand, 1, buf, n);
+            fprintf(stderr, "%s\n", (const char *) str);
+            yajl_free_error(hand, str);
+            break;
+        }
+    }
+    if (n < 0) {
+        int errnum;
+        ELOG("Could not read \"%s\": %s\n", filename, gzerror(f, &errnum));
+    } else if (n == 0) {
 #if YAJL_MAJOR >= 2
-    yajl_complete_parse(hand);
+        yajl_complete_parse(hand);
 #else
-    yajl_parse_complete(hand);
+        yajl_parse_complete(hand);
 #endif
+    }
+    setlocale(LC_NUMERIC, "");
+    LOG("read %zu bytes\n", total);
+
+    gzclose(f);
+    free(buf);
+    yajl_free(hand);
+    yajl_gen_free(g);
+
+    append_new_cons();
+
+    /* The type of a container might only be set after its children were
+     * attached, so their cached workspaces and outputs are outdated. */
+    con_children_changed(croot);
 
-    fclose(f);
     if (to_focus)
         con_focus(to_focus);
 }
@@ -21,6 +21,7 @@
 #include <sys/stat.h>
 #include <errno.h>
 #include <pthread.h>
+#include <signal.h>
 #if defined(__APPLE__)
 #include <sys/types.h>
 #include <sys/sysctl.h>
@@ -34,6 +35,17 @@
 
 static bool debug_logging = false;
 static bool verbose = false;
+
+bool debuglog_active = false;
+uint64_t debuglog_categories = UINT64_MAX;
+
+/* Categories for debug messages, see debuglog_category(). Source files
+ * beyond the 63rd share the last category. */
+#define MAX_CATEGORIES 64
+static char *categories[MAX_CATEGORIES];
+static int num_categories;
+/* The comma-separated categories which should be logged, NULL for all. */
+static char *category_filter;
 static FILE *errorfile;
 char *errorfilename;
 
@@ -45,6 +57,10 @@ char *shmlogname = "";
 /* Size limit for the SHM log, by default 25 MiB. Can be overwritten using the
  * flag --shmlog-size. */
 int shmlog_size = 0;
+/* If true, the log is stored in a file in XDG_RUNTIME_DIR (see
+ * get_process_filename()) instead of a SHM segment, so that it can still be
+ * read with i3-dump-log -F after i3 crashed. Set by --shmlog-persistent. */
+bool shmlog_persistent = false;
 /* If enabled, logbuffer will point to a memory mapping of the i3 SHM log. */
 static char *logbuffer;
 /* A pointer (within logbuffer) where data will be written to next. */
@@ -58,6 +74,31 @@ static char *loglastwrap;
 static int logbuffer_size;
 /* File descriptor for shm_open. */
 static int logbuffer_shm;
+/* Whether messages were logged since the last log_broadcast(). */
+static bool broadcast_pending;
+
+/* Size of the ringbuffer for asynchronous logging, see
+ * start_async_logging(). */
+#define ASYNC_LOG_SIZE (1024 * 1024)
+
+/* In asynchronous mode, messages for stdout are appended to this ringbuffer
+ * and written by a separate thread, so that a slow stdout (for example a pipe
+ * to journald) does not block i3. The main thread only writes tail, the
+ * logger thread only writes head; both grow monotonically. */
+static struct {
+    bool running;
+    char *data;
+    size_t head;
+    size_t tail;
+    /* Messages which did not fit into the ringbuffer since the last one
+     * which did. */
+    unsigned int dropped;
+    /* Set by the logger thread while it waits for new messages. */
+    int sleeping;
+    int stop;
+    int wakeup_pipe[2];
+    pthread_t thread;
+} async_log;
 
 /*
  * Writes the offsets for the next write and for the last wrap to the
@@ -71,6 +112,24 @@ static void store_log_markers(void) {
     header->size = logbuffer_size;
 }
 
+/*
+ * Returns the size of the log for the current shmlog_size: at most 1% of the
+ * RAM.
+ *
+ */
+static int logbuffer_size_limit(void) {
+    long long physical_mem_bytes;
+#if defined(__APPLE__)
+    int mib[2] = { CTL_HW, HW_MEMSIZE };
+    size_t length = sizeof(long long);
+    sysctl(mib, 2, &physical_mem_bytes, &length, NULL, 0);
+#else
+    physical_mem_bytes = (long long)sysconf(_SC_PHYS_PAGES) *
+                                    sysconf(_SC_PAGESIZE);
+#endif
+    return min(physical_mem_bytes * 0.01, shmlog_size);
+}
+
 /*
  * Initializes logging by creating an error logfile in /tmp (or
  * XDG_RUNTIME_DIR, see get_process_filename()).
@@ -94,6 +153,8 @@ void init_logging(void) {
      * not > 0, the user has turned it off, so let's close the logbuffer. */
      if (shmlog_size > 0 && logbuffer == NULL)
         open_logbuffer();
+     else if (shmlog_size > 0 && logbuffer_size_limit() != logbuffer_size)
+        resize_logbuffer();
      else if (shmlog_size <= 0 && logbuffer)
         close_logbuffer();
      atexit(purge_zerobyte_logfile);
@@ -108,22 +169,22 @@ void open_logbuffer(void) {
          * For 512 MiB of RAM this will lead to a 5 MiB log buffer.
          * At the moment (2011-12-10), no testcase leads to an i3 log
          * of more than ~ 600 KiB. */
-        long long physical_mem_bytes;
-#if defined(__APPLE__)
-        int mib[2] = { CTL_HW, HW_MEMSIZE };
-        size_t length = sizeof(long long);
-        sysctl(mib, 2, &physical_mem_bytes, &length, NULL, 0);
-#else
-        physical_mem_bytes = (long long)sysconf(_SC_PHYS_PAGES) *
-                                        sysconf(_SC_PAGESIZE);
-#endif
-        logbuffer_size = min(physical_mem_bytes * 0.01, shmlog_size);
+        logbuffer_size = logbuffer_size_limit();
+        if (shmlog_persistent) {
+            if ((shmlogname = get_process_filename("log")) == NULL) {
+                shmlogname = "";
+                fprintf(stderr, "Could not create a file for the i3 log\n");
+                return;
+            }
+            logbuffer_shm = open(shmlogname, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, S_IREAD | S_IWRITE);
+        } else {
 #if defined(__FreeBSD__)
-        sasprintf(&shmlogname, "/tmp/i3-log-%d", getpid());
+            sasprintf(&shmlogname, "/tmp/i3-log-%d", getpid());
 #else
-        sasprintf(&shmlogname, "/i3-log-%d", getpid());
+            sasprintf(&shmlogname, "/i3-log-%d", getpid());
 #endif
-        logbuffer_shm = shm_open(shmlogname, O_RDWR | O_CREAT, S_IREAD | S_IWRITE);
+            logbuffer_shm = shm_open(shmlogname, O_RDWR | O_CREAT, S_IREAD | S_IWRITE);
+        }
         if (logbuffer_shm == -1) {
             fprintf(stderr, "Could not shm_open SHM segment for the i3 log: %s\n", strerror(errno));
             return;
@@ -138,7 +199,7 @@ void open_logbuffer(void) {
             fprintf(stderr, "Could not ftruncate SHM segment for the i3 log: %s\n", strerror(ret));
 #endif
             close(logbuffer_shm);
-            shm_unlink(shmlogname);
+            unlink_logbuffer();
             return;
         }
 
@@ -163,6 +224,7 @@ void open_logbuffer(void) {
         logwalk = logbuffer + sizeof(i3_shmlog_header);
         loglastwrap = logbuffer + logbuffer_size;
         store_log_markers();
+        debuglog_active = true;
 }
 
 /*
@@ -170,10 +232,86 @@ void open_logbuffer(void) {
  *
  */
 void close_logbuffer(void) {
+    if (logbuffer != NULL && logbuffer != MAP_FAILED) {
+        /* Tell i3-dump-log -f that this log is gone (it might be replaced by
+         * a new one with the same name, see resize_logbuffer()). */
+        header->replaced = 1;
+        pthread_cond_broadcast(&(header->condvar));
+        munmap(logbuffer, logbuffer_size);
+    }
     close(logbuffer_shm);
-    shm_unlink(shmlogname);
+    unlink_logbuffer();
     logbuffer = NULL;
     shmlogname = "";
+    debuglog_active = debug_logging;
+}
+
+/*
+ * Removes the SHM segment (or file, see shmlog_persistent) of the log. The
+ * log stays usable if it is still mapped.
+ *
+ */
+void unlink_logbuffer(void) {
+    if (*shmlogname == '\0')
+        return;
+    if (shmlog_persistent)
+        unlink(shmlogname);
+    else shm_unlink(shmlogname);
+}
+
+/*
+ * Changes the size of the log to the current shmlog_size while keeping the
+ * most recent messages (as many as fit). The log is copied to a new segment
+ * with the same name, i3-dump-log -f switches over to it.
+ *
+ */
+void resize_logbuffer(void) {
+    if (logbuffer == NULL) {
+        open_logbuffer();
+        return;
+    }
+
+    /* Put the messages in order: the oldest ones are between logwalk and
+     * loglastwrap (if the log wrapped at least once; the first of them was
+     * partially overwritten), the newest ones at the start. */
+    char *start = logbuffer + sizeof(i3_shmlog_header);
+    char *old = logwalk;
+    if (header->wrap_count > 0 && old < loglastwrap) {
+        char *newline = memchr(old, '\n', loglastwrap - old);
+        old = (newline != NULL ? newline + 1 : loglastwrap);
+    }
+    const size_t old_len = (header->wrap_count > 0 ? (size_t)(loglastwrap - old) : 0);
+    const size_t new_len = logwalk - start;
+    const size_t total = old_len + new_len;
+    char *copy = smalloc(total);
+    memcpy(copy, old, old_len);
+    memcpy(copy + old_len, start, new_len);
+    const uint64_t bytes_written = header->bytes_written;
+
+    /* The name only depends on the PID, so the new log replaces the old one. */
+    close_logbuffer();
+    open_logbuffer();
+    if (logbuffer == NULL) {
+        free(copy);
+        return;
+    }
+
+    /* Keep the newest whole lines which fit, leaving room for one message so
+     * that vlog() does not need to wrap right away. */
+    size_t keep = total;
+    const size_t capacity = logbuffer_size - sizeof(i3_shmlog_header);
+    if (keep > capacity / 2) {
+        keep = capacity / 2;
+        char *newline = memchr(copy + total - keep, '\n', keep);
+        keep = (newline != NULL ? (size_t)(copy + total - (newline + 1)) : 0);
+    }
+    memcpy(logwalk, copy + total - keep, keep);
+    logwalk += keep;
+    header->bytes_written = bytes_written;
+    store_log_markers();
+    free(copy);
+
+    broadcast_pending = true;
 }
 
 /*
@@ -200,6 +338,262 @@ bool get_debug_logging(void) {
  */
 void set_debug_logging(const bool _debug_logging) {
     debug_logging = _debug_logging;
+    debuglog_active = (debug_logging || logbuffer != NULL);
+}
+
+/*
+ * Returns whether the given category is contained in category_filter.
+ *
+ */
+static bool category_enabled(const char *name) {
+    if (category_filter == NULL)
+        return true;
+
+    size_t len = strlen(name);
+    const char *walk = category_filter;
+    while (*walk != '\0') {
+        size_t token_len = strcspn(walk, ",");
+        if (token_len == len && strncmp(walk, name, len) == 0)
+            return true;
+        walk += token_len;
+        if (*walk == ',')
+            walk++;
+    }
+    return false;
+}
+
+/*
+ * Returns the category for debug messages from the given source file. Every
+ * source file is its own category, named like the file without ".c".
+ *
+ */
+int debuglog_category(const char *file) {
+    size_t len = strlen(file);
+    if (len > 2 && strcmp(file + len - 2, ".c") == 0)
+        len -= 2;
+
+    for (int i = 0; i < num_categories; i++)
+        if (strlen(categories[i]) == len && strncmp(categories[i], file, len) == 0)
+            return i;
+
+    if (num_categories == MAX_CATEGORIES)
+        return MAX_CATEGORIES - 1;
+
+    int category = num_categories++;
+    categories[category] = smalloc(len + 1);
+    memcpy(categories[category], file, len);
+    categories[category][len] = '\0';
+    if (!category_enabled(categories[category]))
+        debuglog_categories &= ~((uint64_t)1 << category);
+    return category;
+}
+
+/*
+ * Restricts debug messages to the given comma-separated list of categories
+ * (for example "x,render"). NULL, an empty string or "all" logs all
+ * categories again.
+ *
+ */
+void set_debuglog_filter(const char *filter) {
+    FREE(category_filter);
+    if (filter != NULL && *filter != '\0' && strcmp(filter, "all") != 0)
+        category_filter = sstrdup(filter);
+
+    debuglog_categories = UINT64_MAX;
+    for (int i = 0; i < num_categories; i++)
+        if (!category_enabled(categories[i]))
+            debuglog_categories &= ~((uint64_t)1 << i);
+}
+
+/*
+ * Returns the time prefix for log messages. It only has one second
+ * resolution, so localtime_r() and strftime() only need to run again once
+ * the second changed.
+ *
+ */
+static const char *time_prefix(size_t *len) {
+    static char prefix[64];
+    static size_t prefix_len;
+    static time_t prefix_time = -1;
+
+    time_t t = time(NULL);
+    if (t != prefix_time) {
+        struct tm result;
+        /* Convert time to local time (determined by the locale) */
+        prefix_len = strftime(prefix, sizeof(prefix), "%x %X - ", localtime_r(&t, &result));
+        prefix_time = t;
+    }
+
+    *len = prefix_len;
+    return prefix;
+}
+
+/*
+ * Wakes up all i3-dump-log processes which wait for new messages, if any
+ * messages were logged since the last call. Called from the event loop
+ * before blocking, so that there is one broadcast per batch of messages
+ * instead of one per message.
+ *
+ */
+void log_broadcast(void) {
+    if (!broadcast_pending)
+        return;
+
+    broadcast_pending = false;
+    if (logbuffer)
+        pthread_cond_broadcast(&(header->condvar));
+}
+
+static void *async_log_thread(void *unused) {
+    while (true) {
+        const size_t tail = __atomic_load_n(&(async_log.tail), __ATOMIC_ACQUIRE);
+        size_t head = async_log.head;
+        while (head != tail) {
+            /* Write up to the end of the ringbuffer, the rest in the next
+             * iteration. */
+            const size_t offset = head % ASYNC_LOG_SIZE;
+            size_t len = tail - head;
+            if (len > ASYNC_LOG_SIZE - offset)
+                len = ASYNC_LOG_SIZE - offset;
+            const ssize_t n = write(STDOUT_FILENO, async_log.data + offset, len);
+            if (n == -1 && errno == EINTR)
+                continue;
+            /* On errors (stdout closed), nothing can be done but dropping
+             * the messages. */
+            head += (n > 0 ? (size_t)n : len);
+            __atomic_store_n(&(async_log.head), head, __ATOMIC_RELEASE);
+        }
+
+        if (__atomic_load_n(&(async_log.stop), __ATOMIC_ACQUIRE) &&
+            head == __atomic_load_n(&(async_log.tail), __ATOMIC_ACQUIRE))
+            break;
+
+        /* Pairs with the fence in async_log_append(): either we see the new
+         * message or the main thread sees that we are sleeping. */
+        __atomic_store_n(&(async_log.sleeping), 1, __ATOMIC_SEQ_CST);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if (head != __atomic_load_n(&(async_log.tail), __ATOMIC_ACQUIRE) ||
+            __atomic_load_n(&(async_log.stop), __ATOMIC_ACQUIRE)) {
+            __atomic_store_n(&(async_log.sleeping), 0, __ATOMIC_SEQ_CST);
+            continue;
+        }
+
+        char buffer[64];
+        if (read(async_log.wakeup_pipe[0], buffer, sizeof(buffer)) == -1 && errno != EINTR)
+            break;
+        __atomic_store_n(&(async_log.sleeping), 0, __ATOMIC_SEQ_CST);
+    }
+    return NULL;
+}
+
+/*
+ * Appends the given message to the ringbuffer for the logger thread. Never
+ * blocks: if the logger thread did not keep up and there is no space left,
+ * the message is dropped (it still is in the SHM log, if enabled).
+ *
+ */
+static void async_log_push(const char *message, size_t len) {
+    const size_t tail = async_log.tail;
+    if (ASYNC_LOG_SIZE - (tail - __atomic_load_n(&(async_log.head), __ATOMIC_ACQUIRE)) < len) {
+        async_log.dropped++;
+        return;
+    }
+
+    const size_t offset = tail % ASYNC_LOG_SIZE;
+    const size_t first = min(len, ASYNC_LOG_SIZE - offset);
+    memcpy(async_log.data + offset, message, first);
+    memcpy(async_log.data, message + first, len - first);
+    __atomic_store_n(&(async_log.tail), tail + len, __ATOMIC_RELEASE);
+}
+
+static void async_log_append(const char *message, size_t len) {
+    if (async_log.dropped > 0) {
+        const unsigned int dropped = async_log.dropped;
+        char notice[64];
+        const int notice_len = snprintf(notice, sizeof(notice), "[%u log messages dropped]\n", dropped);
+        async_log.dropped = 0;
+        async_log_push(notice, notice_len);
+        /* If not even the notice fit, this message is dropped as well. */
+        if (async_log.dropped > 0) {
+            async_log.dropped = dropped + 1;
+            return;
+        }
+    }
+    async_log_push(message, len);
+
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_exchange_n(&(async_log.sleeping), 0, __ATOMIC_SEQ_CST)) {
+        const char c = 0;
+        /* If the pipe is full, the thread gets woken up anyway. */
+        if (write(async_log.wakeup_pipe[1], &c, 1) == -1) {
+            /* nothing to do */
+        }
+    }
+}
+
+/*
+ * Writes messages for stdout in a separate thread from now on, so that
+ * logging never blocks i3, even if stdout is slow. Messages which are logged
+ * while the thread does not keep up are dropped (but still end up in the SHM
+ * log).
+ *
+ */
+void start_async_logging(void) {
+    if (async_log.running)
+        return;
+
+    if (pipe(async_log.wakeup_pipe) == -1) {
+        fprintf(stderr, "Could not create a pipe for asynchronous logging: %s\n", strerror(errno));
+        return;
+    }
+    (void)fcntl(async_log.wakeup_pipe[0], F_SETFD, FD_CLOEXEC);
+    (void)fcntl(async_log.wakeup_pipe[1], F_SETFD, FD_CLOEXEC);
+    (void)fcntl(async_log.wakeup_pipe[1], F_SETFL, O_NONBLOCK);
+
+    async_log.data = smalloc(ASYNC_LOG_SIZE);
+    async_log.head = async_log.tail = 0;
+    async_log.stop = 0;
+
+    /* Signals are handled by the main thread. */
+    sigset_t all, old;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+    const int error = pthread_create(&(async_log.thread), NULL, async_log_thread, NULL);
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+    if (error != 0) {
+        fprintf(stderr, "Could not start the logger thread: %s\n", strerror(error));
+        close(async_log.wakeup_pipe[0]);
+        close(async_log.wakeup_pipe[1]);
+        FREE(async_log.data);
+        return;
+    }
+
+    fflush(stdout);
+    async_log.running = true;
+    atexit(stop_async_logging);
+}
+
+/*
+ * Writes the remaining messages and stops the logger thread. Called before
+ * exiting and before an inplace restart.
+ *
+ */
+void stop_async_logging(void) {
+    if (!async_log.running)
+        return;
+
+    async_log.running = false;
+    __atomic_store_n(&(async_log.stop), 1, __ATOMIC_RELEASE);
+    const char c = 0;
+    if (write(async_log.wakeup_pipe[1], &c, 1) == -1) {
+        /* The thread is woken up anyway if the pipe is full. */
+    }
+    pthread_join(async_log.thread, NULL);
+
+    close(async_log.wakeup_pipe[0]);
+    close(async_log.wakeup_pipe[1]);
+    FREE(async_log.data);
 }
 
 /*
@@ -213,17 +607,8 @@ static void vlog(const bool print, const char *fmt, va_list args) {
     /* Precisely one page to not consume too much memory but to hold enough
      * data to be useful. */
     static char message[4096];
-    static struct tm result;
-    static time_t t;
-    static struct tm *tmp;
-    static size_t len;
-
-    /* Get current time */
-    t = time(NULL);
-    /* Convert time to local time (determined by the locale) */
-    tmp = localtime_r(&t, &result);
-    /* Generate time prefix */
-    len = strftime(message, sizeof(message), "%x %X - ", tmp);
+    size_t len;
+    const char *prefix = time_prefix(&len);
 
     /*
      * logbuffer  print
@@ -233,43 +618,68 @@ static void vlog(const bool print, const char *fmt, va_list args) {
      *  false     true   print message only
      *  false     false  INVALID, never called
      */
+    if (!logbuffer && async_log.running) {
+        memcpy(message, prefix, len);
+        len += vsnprintf(message + len, sizeof(message) - len, fmt, args);
+        if (len >= sizeof(message))
+            len = sizeof(message) - 1;
+        async_log_append(message, len);
+        return;
+    }
+
     if (!logbuffer) {
 #ifdef DEBUG_TIMING
         struct timeval tv;
         gettimeofday(&tv, NULL);
-        printf("%s%d.%d - ", message, tv.tv_sec, tv.tv_usec);
+        printf("%s%d.%d - ", prefix, tv.tv_sec, tv.tv_usec);
 #else
-        printf("%s", message);
+        printf("%s", prefix);
 #endif
         vprintf(fmt, args);
-    } else {
-        len += vsnprintf(message + len, sizeof(message) - len, fmt, args);
-        if (len >= sizeof(message)) {
-            fprintf(stderr, "BUG: single log message > 4k\n");
-        }
+        return;
+    }
 
+    /* As long as the longest possible message fits into the ringbuffer, we
+     * format it in place. Only close to the end of the ringbuffer, where we
+     * might need to wrap, it is formatted into a separate buffer first. */
+    bool in_place = ((size_t)(logbuffer_size - (logwalk - logbuffer)) > sizeof(message));
+    char *dest = (in_place ? logwalk : message);
+
+    memcpy(dest, prefix, len);
+    len += vsnprintf(dest + len, sizeof(message) - len, fmt, args);
+    if (len >= sizeof(message)) {
+        fprintf(stderr, "BUG: single log message > 4k\n");
+        len = sizeof(message) - 1;
+    }
+
+    if (!in_place) {
         /* If there is no space for the current message in the ringbuffer, we
          * need to wrap and write to the beginning again. */
-        if (len >= (logbuffer_size - (logwalk - logbuffer))) {
+        if (len >= (size_t)(logbuffer_size - (logwalk - logbuffer))) {
             loglastwrap = logwalk;
             logwalk = logbuffer + sizeof(i3_shmlog_header);
             store_log_markers();
             header->wrap_count++;
         }
 
-        /* Copy the buffer, move the write pointer to the byte after our
-         * current message. */
-        strncpy(logwalk, message, len);
-        logwalk += len;
+        /* Copy the buffer */
+        memcpy(logwalk, message, len);
+    }
 
-        store_log_markers();
+    if (print) {
+        if (async_log.running)
+            async_log_append(logwalk, len);
+        else fwrite(logwalk, len, 1, stdout);
+    }
 
-        /* Wake up all (i3-dump-log) processes waiting for condvar. */
-        pthread_cond_broadcast(&(header->condvar));
+    /* Move the write pointer to the byte after our current message. */
+    logwalk += len;
+    header->bytes_written += len;
 
-        if (print)
-            fwrite(message, len, 1, stdout);
-    }
+    store_log_markers();
+
+    /* i3-dump-log processes are woken up by log_broadcast(). */
+    broadcast_pending = true;
 }
 
 /*
@@ -106,11 +106,153 @@ static void xcb_got_event(EV_P_ struct ev_io *w, int revents) {
 }
 
 /*
- * Flush before blocking (and waiting for new events)
+ * Render (if any handler requested it using tree_render_later()) and flush
+ * before blocking (and waiting for new events)
  *
  */
 static void xcb_prepare_cb(EV_P_ ev_prepare *w, int revents) {
+    uint64_t start = trace_begin();
+    tree_render_flush();
+    handle_pending_exposes();
+
+    uint64_t flush_start = trace_begin();
     xcb_flush(conn);
+    trace_end("loop", "xcb_flush", flush_start);
+
+    log_broadcast();
+    trace_end("loop", "xcb_prepare_cb", start);
+}
+
+/* The callback handling X11 events, see main_set_x11_cb() */
+static struct ev_check *xcb_check;
+
+/* A run of consecutive events which can be coalesced, see xcb_check_cb() */
+static xcb_generic_event_t **batched_events;
+static int batched_events_size;
+
+/*
+ * Handles the given event (or error) and frees it.
+ *
+ */
+static void handle_x11_event(xcb_generic_event_t *event) {
+    if (event->response_type == 0) {
+        if (event_is_ignored(event->sequence, 0))
+            DLOG("Expected X11 Error received for sequence %x\n", event->sequence);
+        else {
+            xcb_generic_error_t *error = (xcb_generic_error_t*)event;
+            DLOG("X11 Error received (probably harmless)! sequence 0x%x, error_code = %d\n",
+                 error->sequence, error->error_code);
+        }
+        free(event);
+        return;
+    }
+
+    /* Strip off the highest bit (set if the event is generated) */
+    int type = (event->response_type & 0x7F);
+
+    handle_event(type, event);
+
+    free(event);
+}
+
+/*
+ * Returns true for the events which can be merged into a later event of the
+ * same kind, see coalesce_event().
+ *
+ */
+static bool is_coalescable(xcb_generic_event_t *event) {
+    switch (event->response_type & 0x7F) {
+        case XCB_PROPERTY_NOTIFY:
+        case XCB_MOTION_NOTIFY:
+        case XCB_EXPOSE:
+        case XCB_CONFIGURE_REQUEST:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/*
+ * Merges event into the later event next if both concern the same window
+ * (and property), so that handling next has the same effect as handling
+ * both. Returns false if the events are unrelated.
+ *
+ */
+static bool coalesce_event(xcb_generic_event_t *event, xcb_generic_event_t *next) {
+    if (event->response_type != next->response_type)
+        return false;
+
+    switch (event->response_type & 0x7F) {
+        case XCB_PROPERTY_NOTIFY: {
+            /* Only the latest value of the property matters. */
+            xcb_property_notify_event_t *e = (xcb_property_notify_event_t*)event,
+                                        *n = (xcb_property_notify_event_t*)next;
+            return (e->window == n->window && e->atom == n->atom);
+        }
+
+        case XCB_MOTION_NOTIFY: {
+            /* Only the latest pointer position matters. */
+            xcb_motion_notify_event_t *e = (xcb_motion_notify_event_t*)event,
+                                      *n = (xcb_motion_notify_event_t*)next;
+            return (e->event == n->event && e->child == n->child);
+        }
+
+        case XCB_EXPOSE: {
+            /* Exposed areas are collected by the handler, which only copies
+             * the same area once. */
+            xcb_expose_event_t *e = (xcb_expose_event_t*)event,
+                               *n = (xcb_expose_event_t*)next;
+            return (e->window == n->window && e->x == n->x && e->y == n->y &&
+                    e->width == n->width && e->height == n->height);
+        }
+
+        case XCB_CONFIGURE_REQUEST: {
+            /* The later request wins, but values which only the earlier one
+             * contains are still applied. */
+            xcb_configure_request_event_t *e = (xcb_configure_request_event_t*)event,
+                                          *n = (xcb_configure_request_event_t*)next;
+            if (e->window != n->window)
+                return false;
+            uint16_t missing = e->value_mask & ~n->value_mask;
+#define MERGE_MEMBER(mask_member, event_member) do { \
+        if (missing & mask_member) \
+            n->event_member = e->event_member; \
+} while (0)
+            MERGE_MEMBER(XCB_CONFIG_WINDOW_X, x);
+            MERGE_MEMBER(XCB_CONFIG_WINDOW_Y, y);
+            MERGE_MEMBER(XCB_CONFIG_WINDOW_WIDTH, width);
+            MERGE_MEMBER(XCB_CONFIG_WINDOW_HEIGHT, height);
+            MERGE_MEMBER(XCB_CONFIG_WINDOW_BORDER_WIDTH, border_width);
+            MERGE_MEMBER(XCB_CONFIG_WINDOW_SIBLING, sibling);
+            MERGE_MEMBER(XCB_CONFIG_WINDOW_STACK_MODE, stack_mode);
+#undef MERGE_MEMBER
+            n->value_mask |= missing;
+            return true;
+        }
+
+        default:
+            return false;
+    }
+}
+
+/*
+ * Handles a run of consecutive coalescable events. Every event which can be
+ * merged into a later one of the run is dropped, so that e.g. a client
+ * showing its progress in the title or the backlog of events after resuming
+ * from suspend are handled in one go.
+ *
+ */
+static void handle_batched_events(int num) {
+    for (int i = 0; i < num; i++) {
+        xcb_generic_event_t *event = batched_events[i];
+        bool merged = false;
+        for (int j = i + 1; j < num && !merged; j++)
+            merged = coalesce_event(event, batched_events[j]);
+
+        if (merged)
+            free(event);
+        else handle_x11_event(event);
+    }
 }
 
 /*
@@ -120,26 +262,56 @@ static void xcb_prepare_cb(EV_P_ ev_prepare *w, int revents) {
  */
 static void xcb_check_cb(EV_P_ ev_check *w, int revents) {
     xcb_generic_event_t *event;
+    uint64_t start = trace_begin();
 
     while ((event = xcb_poll_for_event(conn)) != NULL) {
-        if (event->response_type == 0) {
-            if (event_is_ignored(event->sequence, 0))
-                DLOG("Expected X11 Error received for sequence %x\n", event->sequence);
-            else {
-                xcb_generic_error_t *error = (xcb_generic_error_t*)event;
-                DLOG("X11 Error received (probably harmless)! sequence 0x%x, error_code = %d\n",
-                     error->sequence, error->error_code);
-            }
-            free(event);
+        if (!is_coalescable(event)) {
+            handle_x11_event(event);
             continue;
         }
 
-        /* Strip off the highest bit (set if the event is generated) */
-        int type = (event->response_type & 0x7F);
+        /* Read all coalescable events following this one, but no other
+         * events: handlers like drag_pointer() (started by a ButtonPress)
+         * read the following events themselves. */
+        int num = 0;
+        do {
+            if (num == batched_events_size) {
+                batched_events_size = (batched_events_size == 0 ? 16 : batched_events_size * 2);
+                batched_events = srealloc(batched_events, batched_events_size * sizeof(xcb_generic_event_t*));
+            }
+            batched_events[num++] = event;
+        } while ((event = xcb_poll_for_event(conn)) != NULL && is_coalescable(event));
 
-        handle_event(type, event);
+        handle_batched_events(num);
+        if (event != NULL)
+            handle_x11_event(event);
+    }
 
-        free(event);
+    /* Finish managing the windows of the MapRequests, handling the
+     * PropertyNotify events and applying the ConfigureRequests of floating
+     * windows received above. */
+    handle_pending_properties();
+    manage_pending_windows();
+    floating_apply_repositions();
+    key_press_poll_modifier_mapping();
+    trace_end("loop", "xcb_check_cb", start);
+}
+
+/*
+ * Enable or disable the main X11 event handling function. This is used by
+ * drag_pointer() which has its own, modal event handler, which takes
+ * precedence over the normal event handler.
+ *
+ */
+void main_set_x11_cb(bool enable) {
+    DLOG("Setting main X11 callback to enabled=%d\n", enable);
+    if (enable) {
+        ev_check_start(main_loop, xcb_check);
+        /* Trigger the watcher explicitly to handle all remaining X11 events.
+         * drag_pointer()’s event handler exits in the middle of the loop. */
+        ev_feed_event(main_loop, xcb_check, 0);
+    } else {
+        ev_check_stop(main_loop, xcb_check);
     }
 }
 
@@ -190,8 +362,7 @@ static void xkb_got_event(EV_P_ struct ev_io *w, int revents) {
 
         if (ev.state.group == XkbGroup1Index) {
             DLOG("Mode_switch disabled\n");
-            ungrab_all_keys(conn);
-            grab_all_keys(conn, false);
+            update_key_grabs(conn, false);
         }
     }
 
@@ -202,12 +373,12 @@ static void xkb_got_event(EV_P_ struct ev_io *w, int revents) {
     xcb_key_symbols_free(keysyms);
     keysyms = xcb_key_symbols_alloc(conn);
 
-    xcb_numlock_mask = aio_get_mod_mask_for(XCB_NUM_LOCK, keysyms);
+    key_press_mapping_changed();
 
-    ungrab_all_keys(conn);
     DLOG("Re-grabbing...\n");
+    invalidate_keysym_map();
     translate_keysyms();
-    grab_all_keys(conn, (xkb_current_group == XkbGroup2Index));
+    update_key_grabs(conn, (xkb_current_group == XkbGroup2Index));
     DLOG("Done\n");
 }
 
@@ -223,23 +394,31 @@ static void i3_exit(void) {
     ev_loop_destroy(main_loop);
 #endif
 
+    ipc_unpublish_socket_path();
+    event_record_stop();
+
     if (*shmlogname != '\0') {
         fprintf(stderr, "Closing SHM log \"%s\"\n", shmlogname);
         fflush(stderr);
-        shm_unlink(shmlogname);
+        unlink_logbuffer();
     }
+    if (*shmtreename != '\0')
+        shm_unlink(shmtreename);
 }
 
 /*
  * (One-shot) Handler for all signals with default action "Term", see signal(7)
  *
- * Unlinks the SHM log and re-raises the signal.
+ * Unlinks the SHM log (unless it is persistent, so that it can be inspected
+ * after the crash) and re-raises the signal.
  *
  */
 static void handle_signal(int sig, siginfo_t *info, void *data) {
-    if (*shmlogname != '\0') {
+    if (*shmlogname != '\0' && !shmlog_persistent) {
         shm_unlink(shmlogname);
     }
+    if (*shmtreename != '\0')
+        shm_unlink(shmtreename);
     raise(sig);
 }
 
@@ -254,6 +433,7 @@ int main(int argc, char *argv[]) {
     bool force_xinerama = false;
     char *fake_outputs = NULL;
     bool disable_signalhandler = false;
+    char *record_events_path = NULL;
     static struct option long_options[] = {
         {"no-autostart", no_argument, 0, 'a'},
         {"config", required_argument, 0, 'c'},
@@ -267,8 +447,12 @@ int main(int argc, char *argv[]) {
         {"force-xinerama", no_argument, 0, 0},
         {"force_xinerama", no_argument, 0, 0},
         {"disable-signalhandler", no_argument, 0, 0},
+        {"crash-restart", no_argument, 0, 0},
+        {"async-log", no_argument, 0, 0},
         {"shmlog-size", required_argument, 0, 0},
         {"shmlog_size", required_argument, 0, 0},
+        {"shmlog-persistent", no_argument, 0, 0},
+        {"record-events", required_argument, 0, 0},
         {"get-socketpath", no_argument, 0, 0},
         {"get_socketpath", no_argument, 0, 0},
         {"fake_outputs", required_argument, 0, 0},
@@ -350,9 +534,15 @@ int main(int argc, char *argv[]) {
                 } else if (strcmp(long_options[option_index].name, "disable-signalhandler") == 0) {
                     disable_signalhandler = true;
                     break;
+                } else if (strcmp(long_options[option_index].name, "crash-restart") == 0) {
+                    crash_restart = true;
+                    break;
+                } else if (strcmp(long_options[option_index].name, "async-log") == 0) {
+                    start_async_logging();
+                    break;
                 } else if (strcmp(long_options[option_index].name, "get-socketpath") == 0 ||
                            strcmp(long_options[option_index].name, "get_socketpath") == 0) {
-                    char *socket_path = root_atom_contents("I3_SOCKET_PATH", NULL, 0);
+                    char *socket_path = get_socket_path(NULL, 0);
                     if (socket_path) {
                         printf("%s\n", socket_path);
                         exit(EXIT_SUCCESS);
@@ -367,6 +557,19 @@ int main(int argc, char *argv[]) {
                     init_logging();
                     LOG("Limiting SHM log size to %d bytes\n", shmlog_size);
                     break;
+                } else if (strcmp(long_options[option_index].name, "record-events") == 0) {
+                    /* Recording starts once the X11 connection is set up. */
+                    FREE(record_events_path);
+                    record_events_path = sstrdup(optarg);
+                    break;
+                } else if (strcmp(long_options[option_index].name, "shmlog-persistent") == 0) {
+                    /* The log might already be open if --shmlog-size was
+                     * passed first. */
+                    if (*shmlogname != '\0')
+                        close_logbuffer();
+                    shmlog_persistent = true;
+                    init_logging();
+                    break;
                 } else if (strcmp(long_options[option_index].name, "restart") == 0) {
                     FREE(layout_path);
                     layout_path = sstrdup(optarg);
@@ -402,11 +605,28 @@ int main(int argc, char *argv[]) {
                 fprintf(stderr, "\t--get-socketpath\n"
                                 "\tRetrieve the i3 IPC socket path from X11, print it, then exit.\n");
                 fprintf(stderr, "\n");
+                fprintf(stderr, "\t--crash-restart\n"
+                                "\tWhen i3 crashes, save a backtrace to /tmp/i3-backtrace.<pid>.<n>.txt\n"
+                                "\tand restart inplace immediately instead of showing the crash dialog.\n");
+                fprintf(stderr, "\n");
+                fprintf(stderr, "\t--async-log\n"
+                                "\tWrite log messages to stdout in a separate thread, so that a\n"
+                                "\tslow stdout does not slow down i3. Messages are dropped if\n"
+                                "\tstdout does not keep up.\n");
+                fprintf(stderr, "\n");
                 fprintf(stderr, "\t--shmlog-size <limit>\n"
                                 "\tLimits the size of the i3 SHM log to <limit> bytes. Setting this\n"
                                 "\tto 0 disables SHM logging entirely.\n"
                                 "\tThe default is %d bytes.\n", shmlog_size);
                 fprintf(stderr, "\n");
+                fprintf(stderr, "\t--shmlog-persistent\n"
+                                "\tStore the SHM log in a file in $XDG_RUNTIME_DIR which is kept\n"
+                                "\twhen i3 crashes, so that it can be read with i3-dump-log -F.\n");
+                fprintf(stderr, "\n");
+                fprintf(stderr, "\t--record-events <file>\n"
+                                "\tAppend the X11 events and the commands i3 handles to <file>, so\n"
+                                "\tthat they can be replayed by testcases/bench/400-replay-events.t.\n");
+                fprintf(stderr, "\n");
                 fprintf(stderr, "If you pass plain text arguments, i3 will interpret them as a command\n"
                                 "to send to a currently running i3 (like i3-msg). This allows you to\n"
                                 "use nice and logical commands, such as:\n"
@@ -442,7 +662,7 @@ int main(int argc, char *argv[]) {
             optind++;
         }
         DLOG("Command is: %s (%zd bytes)\n", payload, strlen(payload));
-        char *socket_path = root_atom_contents("I3_SOCKET_PATH", NULL, 0);
+        char *socket_path = get_socket_path(NULL, 0);
         if (!socket_path) {
             ELOG("Could not get i3 IPC socket path\n");
             return 1;
@@ -527,6 +747,9 @@ int main(int argc, char *argv[]) {
     root_screen = xcb_aux_get_screen(conn, conn_screen);
     root = root_screen->root;
 
+    if (record_events_path != NULL)
+        event_record_start(record_events_path);
+
     /* By default, we use the same depth and visual as the root window, which
      * usually is TrueColor (24 bit depth) and the corresponding visual.
      * However, we also check if a 32 bit depth and visual are available (for
@@ -634,6 +857,8 @@ int main(int argc, char *argv[]) {
 
     property_handlers_init();
 
+    sync_request_init(&sync_base);
+
     ewmh_setup_hints();
 
     keysyms = xcb_key_symbols_alloc(conn);
@@ -694,6 +919,8 @@ int main(int argc, char *argv[]) {
 
     tree_render();
 
+    ipc_start_io_thread();
+
     /* Create the UNIX domain socket for IPC */
     int ipc_socket = ipc_create_socket(config.ipc_socket_path);
     if (ipc_socket == -1) {
@@ -734,13 +961,18 @@ int main(int argc, char *argv[]) {
         }
     }
 
+    /* Take over the clients which stayed connected during an inplace
+     * restart. */
+    ipc_adopt_clients();
+
     /* Set up i3 specific atoms like I3_SOCKET_PATH and I3_CONFIG_PATH */
     x_set_i3_atoms();
+    ipc_publish_socket_path();
     ewmh_update_workarea();
 
     struct ev_io *xcb_watcher = scalloc(sizeof(struct ev_io));
     struct ev_io *xkb = scalloc(sizeof(struct ev_io));
-    struct ev_check *xcb_check = scalloc(sizeof(struct ev_check));
+    xcb_check = scalloc(sizeof(struct ev_check));
     struct ev_prepare *xcb_prepare = scalloc(sizeof(struct ev_prepare));
 
     ev_io_init(xcb_watcher, xcb_got_event, xcb_get_file_descriptor(conn), EV_READ);
@@ -868,17 +1100,55 @@ int main(int argc, char *argv[]) {
         start_application(exec_always->command, exec_always->no_startup_id);
     }
 
-    /* Start i3bar processes for all configured bars */
+    /* Start i3bar processes for all configured bars. With shared_i3bar, the
+     * bars which only differ in their outputs are served by one process,
+     * which gets all of their ids. */
+    int num_bars = 0;
     Barconfig *barconfig;
-    TAILQ_FOREACH(barconfig, &barconfigs, configs) {
-        char *command = NULL;
-        sasprintf(&command, "%s --bar_id=%s --socket=\"%s\"",
-                barconfig->i3bar_command ? barconfig->i3bar_command : "i3bar",
-                barconfig->id, current_socketpath);
-        LOG("Starting bar process: %s\n", command);
-        start_application(command, true);
+    TAILQ_FOREACH(barconfig, &barconfigs, configs)
+        num_bars++;
+    Barconfig **bars = smalloc((num_bars + 1) * sizeof(Barconfig*));
+    int *group = smalloc((num_bars + 1) * sizeof(int));
+    bool *started = scalloc((num_bars + 1) * sizeof(bool));
+    num_bars = 0;
+    TAILQ_FOREACH(barconfig, &barconfigs, configs)
+        bars[num_bars++] = barconfig;
+
+    for (int i = 0; i < num_bars; i++) {
+        if (started[i])
+            continue;
+
+        int group_size = 0;
+        group[group_size++] = i;
+        started[i] = true;
+        /* A bar joins if it is compatible with all bars of the group. */
+        for (int j = i + 1; config.shared_i3bar && j < num_bars; j++) {
+            bool compatible = !started[j];
+            for (int k = 0; k < group_size && compatible; k++)
+                compatible = barconfig_can_share_process(bars[group[k]], bars[j]);
+            if (!compatible)
+                continue;
+            group[group_size++] = j;
+            started[j] = true;
+        }
+
+        char *command = sstrdup(bars[i]->i3bar_command ? bars[i]->i3bar_command : "i3bar");
+        for (int k = 0; k < group_size; k++) {
+            char *extended = NULL;
+            sasprintf(&extended, "%s --bar_id=%s", command, bars[group[k]]->id);
+            free(command);
+            command = extended;
+        }
+        char *full_command = NULL;
+        sasprintf(&full_command, "%s --socket=\"%s\"", command, current_socketpath);
+        LOG("Starting bar process: %s\n", full_command);
+        start_application(full_command, true);
+        free(full_command);
         free(command);
     }
+    free(bars);
+    free(group);
+    free(started);
 
     /* Make sure to destroy the event loop to invoke the cleeanup callbacks
      * when calling exit() */
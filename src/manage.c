@@ -39,6 +39,7 @@ void manage_existing_windows(xcb_window_t root) {
     /* Call manage_window with the attributes for every window */
     for (i = 0; i < len; ++i)
         manage_window(children[i], cookies[i], true);
+    manage_pending_windows();
 
     free(reply);
     free(cookies);
@@ -75,84 +76,106 @@ void restore_geometry(void) {
     xcb_aux_sync(conn);
 }
 
-/*
- * The following function sends a new window event, which consists
- * of fields "change" and "container", the latter containing a dump
- * of the window's container.
- *
- */
-static void ipc_send_window_new_event(Con *con) {
-    setlocale(LC_NUMERIC, "C");
-    yajl_gen gen = ygenalloc();
-
-    y(map_open);
-
-    ystr("change");
-    ystr("new");
-
-    ystr("container");
-    dump_node(gen, con, false);
+/* A window passed to manage_window() whose replies were not processed yet.
+ * The cookies are filled in as the requests are sent. */
+struct manage_request {
+    xcb_window_t window;
+    bool needs_to_be_mapped;
+    /* Whether the window passed the checks in manage_request_properties(). */
+    bool manage;
+
+    xcb_get_window_attributes_cookie_t attr_cookie;
+    xcb_get_window_attributes_reply_t *attr;
+    xcb_get_geometry_cookie_t geom_cookie;
+    xcb_void_cookie_t event_mask_cookie;
+    /* Set once manage_finish() reparented the window. */
+    bool reparented;
+    xcb_void_cookie_t reparent_cookie;
+    /* Set once manage_finish() put the window into the tree. The "new" window
+     * event is sent after rendering, so that it contains the geometry. */
+    bool managed;
 
-    y(map_close);
+    xcb_get_property_cookie_t wm_type_cookie, strut_cookie, state_cookie,
+                              utf8_title_cookie, title_cookie,
+                              class_cookie, leader_cookie, transient_cookie,
+                              role_cookie, startup_id_cookie, wm_hints_cookie,
+                              protocols_cookie, sync_counter_cookie;
 
-    const unsigned char *payload;
-    ylength length;
-    y(get_buf, &payload, &length);
+    TAILQ_ENTRY(manage_request) requests;
+};
 
-    ipc_send_event("window", I3_IPC_EVENT_WINDOW, (const char *)payload);
-    y(free);
-    setlocale(LC_NUMERIC, "");
-}
+static TAILQ_HEAD(manage_request_head, manage_request) pending_windows =
+    TAILQ_HEAD_INITIALIZER(pending_windows);
 
 /*
- * Do some sanity checks and then reparent the window.
+ * Queues the window to be managed by the next manage_pending_windows(). The
+ * geometry is requested right away, so that the requests for a burst of new
+ * windows all go out before waiting for any reply.
  *
  */
 void manage_window(xcb_window_t window, xcb_get_window_attributes_cookie_t cookie,
                    bool needs_to_be_mapped) {
-    xcb_drawable_t d = { window };
-    xcb_get_geometry_cookie_t geomc;
-    xcb_get_geometry_reply_t *geom;
-    xcb_get_window_attributes_reply_t *attr = NULL;
-
-    xcb_get_property_cookie_t wm_type_cookie, strut_cookie, state_cookie,
-                              utf8_title_cookie, title_cookie,
-                              class_cookie, leader_cookie, transient_cookie,
-                              role_cookie, startup_id_cookie, wm_hints_cookie;
+    struct manage_request *req = scalloc(sizeof(struct manage_request));
+    req->window = window;
+    req->needs_to_be_mapped = needs_to_be_mapped;
+    req->attr_cookie = cookie;
+    req->geom_cookie = xcb_get_geometry(conn, (xcb_drawable_t){ window });
+    TAILQ_INSERT_TAIL(&pending_windows, req, requests);
+}
 
+/*
+ * Discards the replies to all property requests sent by
+ * manage_request_properties().
+ *
+ */
+static void manage_discard_properties(struct manage_request *req) {
+    xcb_discard_reply(conn, req->wm_type_cookie.sequence);
+    xcb_discard_reply(conn, req->strut_cookie.sequence);
+    xcb_discard_reply(conn, req->state_cookie.sequence);
+    xcb_discard_reply(conn, req->utf8_title_cookie.sequence);
+    xcb_discard_reply(conn, req->leader_cookie.sequence);
+    xcb_discard_reply(conn, req->transient_cookie.sequence);
+    xcb_discard_reply(conn, req->title_cookie.sequence);
+    xcb_discard_reply(conn, req->class_cookie.sequence);
+    xcb_discard_reply(conn, req->role_cookie.sequence);
+    xcb_discard_reply(conn, req->startup_id_cookie.sequence);
+    xcb_discard_reply(conn, req->wm_hints_cookie.sequence);
+    xcb_discard_reply(conn, req->protocols_cookie.sequence);
+    xcb_discard_reply(conn, req->sync_counter_cookie.sequence);
+}
 
-    geomc = xcb_get_geometry(conn, d);
+/*
+ * Do some sanity checks and request all the window properties we need for
+ * managing the window. Returns false if the window should not be managed.
+ *
+ */
+static bool manage_request_properties(struct manage_request *req) {
+    xcb_window_t window = req->window;
 
     /* Check if the window is mapped (it could be not mapped when intializing and
        calling manage_window() for every window) */
-    if ((attr = xcb_get_window_attributes_reply(conn, cookie, 0)) == NULL) {
+    if ((req->attr = xcb_get_window_attributes_reply(conn, req->attr_cookie, 0)) == NULL) {
         DLOG("Could not get attributes\n");
-        xcb_discard_reply(conn, geomc.sequence);
-        return;
+        xcb_discard_reply(conn, req->geom_cookie.sequence);
+        return false;
     }
 
-    if (needs_to_be_mapped && attr->map_state != XCB_MAP_STATE_VIEWABLE) {
-        xcb_discard_reply(conn, geomc.sequence);
-        goto out;
+    if (req->needs_to_be_mapped && req->attr->map_state != XCB_MAP_STATE_VIEWABLE) {
+        xcb_discard_reply(conn, req->geom_cookie.sequence);
+        return false;
     }
 
     /* Don’t manage clients with the override_redirect flag */
-    if (attr->override_redirect) {
-        xcb_discard_reply(conn, geomc.sequence);
-        goto out;
+    if (req->attr->override_redirect) {
+        xcb_discard_reply(conn, req->geom_cookie.sequence);
+        return false;
     }
 
     /* Check if the window is already managed */
     if (con_by_window_id(window) != NULL) {
         DLOG("already managed (by con %p)\n", con_by_window_id(window));
-        xcb_discard_reply(conn, geomc.sequence);
-        goto out;
-    }
-
-    /* Get the initial geometry (position, size, …) */
-    if ((geom = xcb_get_geometry_reply(conn, geomc, 0)) == NULL) {
-        DLOG("could not get geometry\n");
-        goto out;
+        xcb_discard_reply(conn, req->geom_cookie.sequence);
+        return false;
     }
 
     uint32_t values[1];
@@ -165,36 +188,94 @@ void manage_window(xcb_window_t window, xcb_get_window_attributes_cookie_t cooki
      * We need StructureNotify because the client may unmap the window before
      * we get to re-parent it.
      * If this request fails, we assume the client has already unmapped the
-     * window between the MapRequest and our event mask change. */
+     * window between the MapRequest and our event mask change. The error is
+     * checked in manage_finish(), after the replies to the property requests
+     * below arrived, so checking it does not need an extra round trip. */
     values[0] = XCB_EVENT_MASK_PROPERTY_CHANGE |
                 XCB_EVENT_MASK_STRUCTURE_NOTIFY;
-    xcb_void_cookie_t event_mask_cookie =
+    req->event_mask_cookie =
         xcb_change_window_attributes_checked(conn, window, XCB_CW_EVENT_MASK, values);
-    if (xcb_request_check(conn, event_mask_cookie) != NULL) {
-        LOG("Could not change event mask, the window probably already disappeared.\n");
-        goto out;
-    }
 
 #define GET_PROPERTY(atom, len) xcb_get_property(conn, false, window, atom, XCB_GET_PROPERTY_TYPE_ANY, 0, len)
 
-    wm_type_cookie = GET_PROPERTY(A__NET_WM_WINDOW_TYPE, UINT32_MAX);
-    strut_cookie = GET_PROPERTY(A__NET_WM_STRUT_PARTIAL, UINT32_MAX);
-    state_cookie = GET_PROPERTY(A__NET_WM_STATE, UINT32_MAX);
-    utf8_title_cookie = GET_PROPERTY(A__NET_WM_NAME, 128);
-    leader_cookie = GET_PROPERTY(A_WM_CLIENT_LEADER, UINT32_MAX);
-    transient_cookie = GET_PROPERTY(XCB_ATOM_WM_TRANSIENT_FOR, UINT32_MAX);
-    title_cookie = GET_PROPERTY(XCB_ATOM_WM_NAME, 128);
-    class_cookie = GET_PROPERTY(XCB_ATOM_WM_CLASS, 128);
-    role_cookie = GET_PROPERTY(A_WM_WINDOW_ROLE, 128);
-    startup_id_cookie = GET_PROPERTY(A__NET_STARTUP_ID, 512);
-    wm_hints_cookie = xcb_icccm_get_wm_hints(conn, window);
+    req->wm_type_cookie = GET_PROPERTY(A__NET_WM_WINDOW_TYPE, UINT32_MAX);
+    req->strut_cookie = GET_PROPERTY(A__NET_WM_STRUT_PARTIAL, UINT32_MAX);
+    req->state_cookie = GET_PROPERTY(A__NET_WM_STATE, UINT32_MAX);
+    req->utf8_title_cookie = GET_PROPERTY(A__NET_WM_NAME, 128);
+    req->leader_cookie = GET_PROPERTY(A_WM_CLIENT_LEADER, UINT32_MAX);
+    req->transient_cookie = GET_PROPERTY(XCB_ATOM_WM_TRANSIENT_FOR, UINT32_MAX);
+    req->title_cookie = GET_PROPERTY(XCB_ATOM_WM_NAME, 128);
+    req->class_cookie = GET_PROPERTY(XCB_ATOM_WM_CLASS, 128);
+    req->role_cookie = GET_PROPERTY(A_WM_WINDOW_ROLE, 128);
+    req->startup_id_cookie = GET_PROPERTY(A__NET_STARTUP_ID, 512);
+    req->wm_hints_cookie = xcb_icccm_get_wm_hints(conn, window);
+    req->protocols_cookie = xcb_icccm_get_wm_protocols(conn, window, A_WM_PROTOCOLS);
+    req->sync_counter_cookie = GET_PROPERTY(A__NET_WM_SYNC_REQUEST_COUNTER, 1);
     /* TODO: also get wm_normal_hints here. implement after we got rid of xcb-event */
 
+#undef GET_PROPERTY
+
+    return true;
+}
+
+/*
+ * Checks whether the WM_PROTOCOLS reply for the given cookie contains
+ * WM_TAKE_FOCUS and _NET_WM_SYNC_REQUEST, like window_supports_protocol(), but
+ * without sending another request.
+ *
+ */
+static void reply_supported_protocols(xcb_get_property_cookie_t cookie, bool *take_focus, bool *sync_request) {
+    xcb_icccm_get_wm_protocols_reply_t protocols;
+
+    *take_focus = false;
+    *sync_request = false;
+    if (xcb_icccm_get_wm_protocols_reply(conn, cookie, &protocols, NULL) != 1)
+        return;
+
+    for (uint32_t i = 0; i < protocols.atoms_len; i++) {
+        if (protocols.atoms[i] == A_WM_TAKE_FOCUS)
+            *take_focus = true;
+        else if (protocols.atoms[i] == A__NET_WM_SYNC_REQUEST)
+            *sync_request = true;
+    }
+
+    xcb_icccm_get_wm_protocols_reply_wipe(&protocols);
+}
+
+/*
+ * Processes the replies for the given window and reparents it.
+ *
+ */
+static void manage_finish(struct manage_request *req) {
+    xcb_window_t window = req->window;
+    xcb_get_geometry_reply_t *geom;
+
+    /* Another request in this batch might have managed the window already */
+    if (con_by_window_id(window) != NULL) {
+        DLOG("already managed (by con %p)\n", con_by_window_id(window));
+        xcb_discard_reply(conn, req->geom_cookie.sequence);
+        manage_discard_properties(req);
+        return;
+    }
+
+    /* Get the initial geometry (position, size, …) */
+    if ((geom = xcb_get_geometry_reply(conn, req->geom_cookie, 0)) == NULL) {
+        DLOG("could not get geometry\n");
+        manage_discard_properties(req);
+        return;
+    }
+
+    if (xcb_request_check(conn, req->event_mask_cookie) != NULL) {
+        LOG("Could not change event mask, the window probably already disappeared.\n");
+        manage_discard_properties(req);
+        goto geom_out;
+    }
+
     DLOG("Managing window 0x%08x\n", window);
 
-    i3Window *cwindow = scalloc(sizeof(i3Window));
+    i3Window *cwindow = pool_alloc(&window_pool);
     cwindow->id = window;
-    cwindow->depth = get_visual_depth(attr->visual);
+    cwindow->depth = get_visual_depth(req->attr->visual);
 
     /* We need to grab the mouse buttons for click to focus */
     xcb_grab_button(conn, false, window, XCB_EVENT_MASK_BUTTON_PRESS,
@@ -213,28 +294,34 @@ void manage_window(xcb_window_t window, xcb_get_window_attributes_cookie_t cooki
                     XCB_BUTTON_MASK_ANY /* don’t filter for any modifiers */);
 
     /* update as much information as possible so far (some replies may be NULL) */
-    window_update_class(cwindow, xcb_get_property_reply(conn, class_cookie, NULL), true);
-    window_update_name_legacy(cwindow, xcb_get_property_reply(conn, title_cookie, NULL), true);
-    window_update_name(cwindow, xcb_get_property_reply(conn, utf8_title_cookie, NULL), true);
-    window_update_leader(cwindow, xcb_get_property_reply(conn, leader_cookie, NULL));
-    window_update_transient_for(cwindow, xcb_get_property_reply(conn, transient_cookie, NULL));
-    window_update_strut_partial(cwindow, xcb_get_property_reply(conn, strut_cookie, NULL));
-    window_update_role(cwindow, xcb_get_property_reply(conn, role_cookie, NULL), true);
+    window_update_class(cwindow, xcb_get_property_reply(conn, req->class_cookie, NULL), true);
+    window_update_name_legacy(cwindow, xcb_get_property_reply(conn, req->title_cookie, NULL), true);
+    window_update_name(cwindow, xcb_get_property_reply(conn, req->utf8_title_cookie, NULL), true);
+    window_update_leader(cwindow, xcb_get_property_reply(conn, req->leader_cookie, NULL));
+    window_update_transient_for(cwindow, xcb_get_property_reply(conn, req->transient_cookie, NULL));
+    window_update_strut_partial(cwindow, xcb_get_property_reply(conn, req->strut_cookie, NULL));
+    window_update_role(cwindow, xcb_get_property_reply(conn, req->role_cookie, NULL), true);
     bool urgency_hint;
-    window_update_hints(cwindow, xcb_get_property_reply(conn, wm_hints_cookie, NULL), &urgency_hint);
+    window_update_hints(cwindow, xcb_get_property_reply(conn, req->wm_hints_cookie, NULL), &urgency_hint);
 
     xcb_get_property_reply_t *startup_id_reply;
-    startup_id_reply = xcb_get_property_reply(conn, startup_id_cookie, NULL);
+    startup_id_reply = xcb_get_property_reply(conn, req->startup_id_cookie, NULL);
     char *startup_ws = startup_workspace_for_window(cwindow, startup_id_reply);
     DLOG("startup workspace = %s\n", startup_ws);
 
-    /* check if the window needs WM_TAKE_FOCUS */
-    cwindow->needs_take_focus = window_supports_protocol(cwindow->id, A_WM_TAKE_FOCUS);
+    /* check if the window needs WM_TAKE_FOCUS and whether it can be resized
+     * synchronously (_NET_WM_SYNC_REQUEST) */
+    bool sync_request;
+    reply_supported_protocols(req->protocols_cookie, &cwindow->needs_take_focus, &sync_request);
+    xcb_get_property_reply_t *sync_counter_reply = xcb_get_property_reply(conn, req->sync_counter_cookie, NULL);
+    if (sync_request)
+        window_update_sync_counter(cwindow, sync_counter_reply);
+    else FREE(sync_counter_reply);
 
     /* Where to start searching for a container that swallows the new one? */
     Con *search_at = croot;
 
-    xcb_get_property_reply_t *reply = xcb_get_property_reply(conn, wm_type_cookie, NULL);
+    xcb_get_property_reply_t *reply = xcb_get_property_reply(conn, req->wm_type_cookie, NULL);
     if (xcb_reply_contains_atom(reply, A__NET_WM_WINDOW_TYPE_DOCK)) {
         LOG("This window is of type dock\n");
         Output *output = get_output_containing(geom->x, geom->y);
@@ -318,7 +405,7 @@ void manage_window(xcb_window_t window, xcb_get_window_attributes_cookie_t cooki
     }
 
     DLOG("new container = %p\n", nc);
-    nc->window = cwindow;
+    con_set_window(nc, cwindow);
     x_reinit(nc);
 
     nc->border_width = geom->border_width;
@@ -334,7 +421,7 @@ void manage_window(xcb_window_t window, xcb_get_window_attributes_cookie_t cooki
     if (fs == NULL)
         fs = con_get_fullscreen_con(croot, CF_GLOBAL);
 
-    xcb_get_property_reply_t *state_reply = xcb_get_property_reply(conn, state_cookie, NULL);
+    xcb_get_property_reply_t *state_reply = xcb_get_property_reply(conn, req->state_cookie, NULL);
     if (xcb_reply_contains_atom(state_reply, A__NET_WM_STATE_FULLSCREEN)) {
         fs = NULL;
         con_toggle_fullscreen(nc, CF_OUTPUT);
@@ -424,6 +511,8 @@ void manage_window(xcb_window_t window, xcb_get_window_attributes_cookie_t cooki
      * which are not managed by the wm anyways). We store the original geometry
      * here because it’s used for dock clients. */
     nc->geometry = (Rect){ geom->x, geom->y, geom->width, geom->height };
+    if (nc->parent->type == CT_DOCKAREA)
+        nc->parent->dock_height_valid = false;
 
     if (want_floating) {
         DLOG("geometry = %d x %d\n", nc->geometry.width, nc->geometry.height);
@@ -432,14 +521,14 @@ void manage_window(xcb_window_t window, xcb_get_window_attributes_cookie_t cooki
 
     /* to avoid getting an UnmapNotify event due to reparenting, we temporarily
      * declare no interest in any state change event of this window */
+    uint32_t values[1];
     values[0] = XCB_NONE;
     xcb_change_window_attributes(conn, window, XCB_CW_EVENT_MASK, values);
 
-    xcb_void_cookie_t rcookie = xcb_reparent_window_checked(conn, window, nc->frame, 0, 0);
-    if (xcb_request_check(conn, rcookie) != NULL) {
-        LOG("Could not reparent the window, aborting\n");
-        goto geom_out;
-    }
+    /* Whether this worked is checked by manage_pending_windows() once the
+     * whole batch is managed, see manage_check_reparent(). */
+    req->reparent_cookie = xcb_reparent_window_checked(conn, window, nc->frame, 0, 0);
+    req->reparented = true;
 
     values[0] = CHILD_EVENT_MASK & ~XCB_EVENT_MASK_ENTER_WINDOW;
     xcb_change_window_attributes(conn, window, XCB_CW_EVENT_MASK, values);
@@ -474,10 +563,7 @@ void manage_window(xcb_window_t window, xcb_get_window_attributes_cookie_t cooki
         ws->rect = ws->parent->rect;
         render_con(ws, true);
     }
-    tree_render();
-
-    /* Send an event about window creation */
-    ipc_send_window_new_event(nc);
+    req->managed = true;
 
     /* Windows might get managed with the urgency hint already set (Pidgin is
      * known to do that), so check for that and handle the hint accordingly.
@@ -487,7 +573,80 @@ void manage_window(xcb_window_t window, xcb_get_window_attributes_cookie_t cooki
 
 geom_out:
     free(geom);
-out:
-    free(attr);
-    return;
+}
+
+/*
+ * Checks whether reparenting the window worked. If it did not (e.g. because
+ * the client destroyed the window in the meantime), the container is closed
+ * again.
+ *
+ */
+static void manage_check_reparent(struct manage_request *req) {
+    xcb_generic_error_t *error = xcb_request_check(conn, req->reparent_cookie);
+    if (error == NULL)
+        return;
+
+    free(error);
+    LOG("Could not reparent window 0x%08x, closing its container\n", req->window);
+    Con *con = con_by_window_id(req->window);
+    if (con != NULL) {
+        tree_close(con, DONT_KILL_WINDOW, false, false);
+        tree_render_later();
+    }
+}
+
+/*
+ * Finishes managing all windows passed to manage_window() so far. The replies
+ * for all of them are processed in passes, so that all requests of one pass
+ * are sent before waiting for the first reply. Managing hundreds of windows
+ * (e.g. on restart) therefore takes only a handful of round trips.
+ *
+ * The tree is then rendered once, and the "new" window events are sent
+ * afterwards, so that they contain the geometry of the windows.
+ *
+ */
+void manage_pending_windows(void) {
+    if (TAILQ_EMPTY(&pending_windows))
+        return;
+
+    /* Take the currently pending windows off the list, so that the list is
+     * in a consistent state while we manage them. */
+    struct manage_request_head batch;
+    TAILQ_INIT(&batch);
+    struct manage_request *req;
+    while (!TAILQ_EMPTY(&pending_windows)) {
+        req = TAILQ_FIRST(&pending_windows);
+        TAILQ_REMOVE(&pending_windows, req, requests);
+        TAILQ_INSERT_TAIL(&batch, req, requests);
+    }
+
+    TAILQ_FOREACH(req, &batch, requests)
+        req->manage = manage_request_properties(req);
+
+    TAILQ_FOREACH(req, &batch, requests)
+        if (req->manage)
+            manage_finish(req);
+
+    /* Checking the first reparent request waits for the X server to process
+     * all of them, the other checks are answered without a round trip. */
+    bool managed = false;
+    TAILQ_FOREACH(req, &batch, requests) {
+        if (req->reparented)
+            manage_check_reparent(req);
+        managed |= req->managed;
+    }
+
+    /* Render once for all windows of this batch, then send an event about
+     * the creation of each window which is still around. */
+    if (managed)
+        tree_render();
+    while (!TAILQ_EMPTY(&batch)) {
+        req = TAILQ_FIRST(&batch);
+        TAILQ_REMOVE(&batch, req, requests);
+        Con *con;
+        if (req->managed && (con = con_by_window_id(req->window)) != NULL)
+            ipc_send_window_event("new", con);
+        free(req->attr);
+        free(req);
+    }
 }
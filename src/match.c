@@ -15,12 +15,6 @@
  */
 #include "all.h"
 
-/* From sys/time.h, not sure if it’s available on all systems. */
-# define _i3_timercmp(a, b, CMP)                                                  \
-  (((a).tv_sec == (b).tv_sec) ?                                             \
-   ((a).tv_usec CMP (b).tv_usec) :                                          \
-   ((a).tv_sec CMP (b).tv_sec))
-
 /*
  * Initializes the Match data structure. This function is necessary because the
  * members representing boolean values (like dock) need to be initialized with
@@ -61,13 +55,14 @@ bool match_is_empty(Match *match) {
  */
 void match_copy(Match *dest, Match *src) {
     memcpy(dest, src, sizeof(Match));
+    /* The copy is not part of the swallow index. */
+    dest->swallow_con = NULL;
 
-/* The DUPLICATE_REGEX macro creates a new regular expression from the
- * ->pattern of the old one. It therefore does use a little more memory then
- *  with a refcounting system, but it’s easier this way. */
+/* The DUPLICATE_REGEX macro gets another reference to the regular
+ * expression of the old one (regexes are shared, see regex_new()). */
 #define DUPLICATE_REGEX(field) do { \
     if (src->field != NULL) \
-        dest->field = regex_new(src->field->pattern); \
+        dest->field = regex_ref(src->field); \
 } while (0)
 
     DUPLICATE_REGEX(title);
@@ -78,6 +73,31 @@ void match_copy(Match *dest, Match *src) {
     DUPLICATE_REGEX(role);
 }
 
+/*
+ * Like regex_matches(), but remembers the result for the given window
+ * property until the property changes.
+ *
+ */
+static bool window_regex_matches(i3Window *window, window_property_t property,
+                                 struct regex *regex, const char *input) {
+    /* The id is hashed (Knuth’s multiplicative method), so that the regexes
+     * for one property are spread over all slots and not just every
+     * WINDOW_NUM_PROPERTIES-th one. */
+    const uint32_t hash = (regex->id * UINT32_C(2654435761)) >> 16;
+    struct regex_memo *memo = &(window->regex_memo[(hash + property) % WINDOW_REGEX_MEMO_SIZE]);
+    const uint32_t generation = window->property_generation[property];
+    if (memo->regex_id == regex->id &&
+        memo->property == property &&
+        memo->generation == generation)
+        return memo->result;
+
+    memo->regex_id = regex->id;
+    memo->property = property;
+    memo->generation = generation;
+    memo->result = regex_matches(regex, input);
+    return memo->result;
+}
+
 /*
  * Check if a match data structure matches the given window.
  *
@@ -87,7 +107,7 @@ bool match_matches_window(Match *match, i3Window *window) {
 
     if (match->class != NULL) {
         if (window->class_class != NULL &&
-            regex_matches(match->class, window->class_class)) {
+            window_regex_matches(window, WP_CLASS, match->class, window->class_class)) {
             LOG("window class matches (%s)\n", window->class_class);
         } else {
             return false;
@@ -96,7 +116,7 @@ bool match_matches_window(Match *match, i3Window *window) {
 
     if (match->instance != NULL) {
         if (window->class_instance != NULL &&
-            regex_matches(match->instance, window->class_instance)) {
+            window_regex_matches(window, WP_INSTANCE, match->instance, window->class_instance)) {
             LOG("window instance matches (%s)\n", window->class_instance);
         } else {
             return false;
@@ -114,7 +134,7 @@ bool match_matches_window(Match *match, i3Window *window) {
 
     if (match->title != NULL) {
         if (window->name != NULL &&
-            regex_matches(match->title, i3string_as_utf8(window->name))) {
+            window_regex_matches(window, WP_TITLE, match->title, i3string_as_utf8(window->name))) {
             LOG("title matches (%s)\n", i3string_as_utf8(window->name));
         } else {
             return false;
@@ -123,7 +143,7 @@ bool match_matches_window(Match *match, i3Window *window) {
 
     if (match->role != NULL) {
         if (window->role != NULL &&
-            regex_matches(match->role, window->role)) {
+            window_regex_matches(window, WP_ROLE, match->role, window->role)) {
             LOG("window_role matches (%s)\n", window->role);
         } else {
             return false;
@@ -136,12 +156,10 @@ bool match_matches_window(Match *match, i3Window *window) {
         if (window->urgent.tv_sec == 0) {
             return false;
         }
-        /* if we find a window that is newer than this one, bail */
-        TAILQ_FOREACH(con, &all_cons, all_cons) {
-            if ((con->window != NULL) &&
-                _i3_timercmp(con->window->urgent, window->urgent, >)) {
-                return false;
-            }
+        /* if there is a window that is newer than this one, bail */
+        con = con_latest_urgent();
+        if (con != NULL && _i3_timercmp(con->window->urgent, window->urgent, >)) {
+            return false;
         }
         LOG("urgent matches latest\n");
     }
@@ -151,13 +169,10 @@ bool match_matches_window(Match *match, i3Window *window) {
         if (window->urgent.tv_sec == 0) {
             return false;
         }
-        /* if we find a window that is older than this one (and not 0), bail */
-        TAILQ_FOREACH(con, &all_cons, all_cons) {
-            if ((con->window != NULL) &&
-                (con->window->urgent.tv_sec != 0) &&
-                _i3_timercmp(con->window->urgent, window->urgent, <)) {
-                return false;
-            }
+        /* if there is a window that is older than this one, bail */
+        con = con_oldest_urgent();
+        if (con != NULL && _i3_timercmp(con->window->urgent, window->urgent, <)) {
+            return false;
         }
         LOG("urgent matches oldest\n");
     }
@@ -190,7 +205,8 @@ bool match_matches_window(Match *match, i3Window *window) {
  *
  */
 void match_free(Match *match) {
-    /* First step: free the regex fields / patterns */
+    /* Release the regexes, they are freed by regex_free() once they are not
+     * used by any other match anymore. */
     regex_free(match->title);
     regex_free(match->application);
     regex_free(match->class);
@@ -198,11 +214,10 @@ void match_free(Match *match) {
     regex_free(match->mark);
     regex_free(match->role);
 
-    /* Second step: free the regex helper struct itself */
-    FREE(match->title);
-    FREE(match->application);
-    FREE(match->class);
-    FREE(match->instance);
-    FREE(match->mark);
-    FREE(match->role);
+    match->title = NULL;
+    match->application = NULL;
+    match->class = NULL;
+    match->instance = NULL;
+    match->mark = NULL;
+    match->role = NULL;
 }
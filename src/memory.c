@@ -0,0 +1,115 @@
+#undef I3__FILE__
+#define I3__FILE__ "memory.c"
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009-2013 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * memory.c: Counts the objects i3 allocated and the memory they use, see
+ *           GET_MEMORY.
+ *
+ * Objects which come from a pool (see pool.c) are counted by their pool, the
+ * i3Strings by libi3 and the ignored sequences by handlers.c. The other types
+ * update a struct memory_stats where they are allocated and freed. The bytes
+ * count what i3 asked for, not what malloc() needed to provide it, which is
+ * what the heap section of the reply is for.
+ *
+ */
+#include "all.h"
+#include "yajl_utils.h"
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+struct all_memory_stats_head all_memory_stats = SLIST_HEAD_INITIALIZER(all_memory_stats);
+
+/*
+ * Records that an object of the given type using the given number of bytes
+ * was allocated.
+ *
+ */
+void memory_stats_alloc(struct memory_stats *stats, size_t bytes) {
+    if (!stats->registered) {
+        SLIST_INSERT_HEAD(&all_memory_stats, stats, all_memory_stats);
+        stats->registered = true;
+    }
+    stats->count++;
+    stats->bytes += bytes;
+}
+
+/*
+ * Records that an object of the given type using the given number of bytes
+ * was freed.
+ *
+ */
+void memory_stats_free(struct memory_stats *stats, size_t bytes) {
+    stats->count--;
+    stats->bytes -= bytes;
+}
+
+static void dump_object(yajl_gen gen, const char *type, uint64_t count, uint64_t bytes) {
+    y(map_open);
+    ystr("type");
+    ystr(type);
+    ystr("count");
+    y(integer, count);
+    ystr("bytes");
+    y(integer, bytes);
+    y(map_close);
+}
+
+/*
+ * Generates the GET_MEMORY reply: the number of objects and bytes of every
+ * object type (including the pools and the i3Strings of libi3) and, if the C
+ * library supports it, the size of the heap.
+ *
+ */
+void memory_stats_dump(yajl_gen gen) {
+    y(map_open);
+
+    ystr("objects");
+    y(array_open);
+
+    uint64_t pool_bytes = 0;
+    struct pool *pool;
+    SLIST_FOREACH(pool, &all_pools, pools) {
+        dump_object(gen, pool->name, pool->in_use, (uint64_t)pool->in_use * pool->object_size);
+        pool_bytes += (uint64_t)(pool->in_use + pool->available) * pool->object_size;
+    }
+
+    struct memory_stats *stats;
+    SLIST_FOREACH(stats, &all_memory_stats, all_memory_stats)
+        dump_object(gen, stats->name, stats->count, stats->bytes);
+
+    size_t count, bytes;
+    i3string_memory_usage(&count, &bytes);
+    dump_object(gen, "i3String", count, bytes);
+
+    count = ignore_events_num();
+    dump_object(gen, "Ignore_Event", count, count * sizeof(struct Ignore_Event));
+
+    y(array_close);
+
+    /* Pools never return their blocks, so this includes the unused objects. */
+    ystr("pool_bytes");
+    y(integer, pool_bytes);
+
+#if defined(__GLIBC__)
+    ystr("heap");
+    y(map_open);
+#if __GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33)
+    struct mallinfo2 info = mallinfo2();
+#else
+    struct mallinfo info = mallinfo();
+#endif
+    ystr("in_use");
+    y(integer, (uint64_t)info.uordblks + info.hblkhd);
+    ystr("free");
+    y(integer, (uint64_t)info.fordblks);
+    y(map_close);
+#endif
+
+    y(map_close);
+}
@@ -54,6 +54,7 @@ static void insert_con_into(Con *con, Con *target, position_t position) {
         TAILQ_INSERT_AFTER(&(parent->nodes_head), target, con, nodes);
         TAILQ_INSERT_HEAD(&(parent->focus_head), con, focused);
     }
+    con_children_changed(parent);
 
     /* Pretend the con was just opened with regards to size percent values.
      * Since the con is moved to a completely different con, the old value
@@ -85,6 +86,7 @@ static void attach_to_workspace(Con *con, Con *ws, direction_t direction) {
         TAILQ_INSERT_TAIL(&(ws->nodes_head), con, nodes);
         TAILQ_INSERT_TAIL(&(ws->focus_head), con, focused);
     }
+    con_children_changed(ws);
 
     /* Pretend the con was just opened with regards to size percent values.
      * Since the con is moved to a completely different con, the old value
@@ -119,25 +121,68 @@ static void move_to_output_directed(Con *con, direction_t direction) {
     attach_to_workspace(con, ws, direction);
 }
 
+/* What a single step of tree_move_steps() did. */
+typedef enum {
+    /* Nothing (more) to do, the tree does not need to be fixed up. */
+    MOVE_STOP,
+    /* The container was swapped with a sibling. */
+    MOVE_SWAPPED,
+    /* The container got a new parent, the tree needs to be fixed up. */
+    MOVE_REPARENTED,
+    /* Like MOVE_REPARENTED, but the container cannot move any further (it
+     * moved to another output or out of a floating container). */
+    MOVE_DONE
+} move_result_t;
+
 /*
- * Moves the current container in the given direction (D_LEFT, D_RIGHT,
- * D_UP, D_DOWN).
+ * Moves con by up to the given number of steps within its parent, as long as
+ * its siblings in that direction are leaves (which is what a single step would
+ * swap it with). The target is found first, so that con is only detached and
+ * inserted once. Returns the number of steps made.
  *
  */
-void tree_move(int direction) {
-    DLOG("Moving in direction %d\n", direction);
-    /* 1: get the first parent with the same orientation */
-    Con *con = focused;
-
-    if (con->type == CT_WORKSPACE) {
-        DLOG("Not moving workspace\n");
-        return;
+static int move_within_parent(Con *con, direction_t direction, int steps) {
+    orientation_t o = (direction == D_LEFT || direction == D_RIGHT ? HORIZ : VERT);
+    if (con_is_floating(con) || con_parent_with_orientation(con, o) != con->parent)
+        return 0;
+
+    bool backwards = (direction == D_LEFT || direction == D_UP);
+    Con *target = con;
+    int made = 0;
+    while (made < steps) {
+        Con *next = (backwards ? TAILQ_PREV(target, nodes_head, nodes) : TAILQ_NEXT(target, nodes));
+        if (next == NULL || !con_is_leaf(next))
+            break;
+        target = next;
+        made++;
     }
 
+    if (made == 0)
+        return 0;
+
+    Con *parent = con->parent;
+    TAILQ_REMOVE(&(parent->nodes_head), con, nodes);
+    if (backwards)
+        TAILQ_INSERT_BEFORE(target, con, nodes);
+    else TAILQ_INSERT_AFTER(&(parent->nodes_head), target, con, nodes);
+    con_children_changed(parent);
+
+    TAILQ_REMOVE(&(parent->focus_head), con, focused);
+    TAILQ_INSERT_HEAD(&(parent->focus_head), con, focused);
+
+    DLOG("Moved %d steps within the parent.\n", made);
+    return made;
+}
+
+/*
+ * Moves con one step in the given direction (D_LEFT, D_RIGHT, D_UP, D_DOWN).
+ *
+ */
+static move_result_t move_step(Con *con, direction_t direction) {
     if (con->parent->type == CT_WORKSPACE && con_num_children(con->parent) == 1) {
         /* This is the only con on this workspace */
         move_to_output_directed(con, direction);
-        goto end;
+        return MOVE_DONE;
     }
 
     orientation_t o = (direction == D_LEFT || direction == D_RIGHT ? HORIZ : VERT);
@@ -152,13 +197,13 @@ void tree_move(int direction) {
             if (con_is_floating(con)) {
                 /* this is a floating con, we just disable floating */
                 floating_disable(con, true);
-                return;
+                return MOVE_STOP;
             }
             if (con_inside_floating(con)) {
                 /* 'con' should be moved out of a floating container */
                 DLOG("Inside floating, moving to workspace\n");
                 attach_to_workspace(con, con_get_workspace(con), direction);
-                goto end;
+                return MOVE_DONE;
             }
             DLOG("Force-changing orientation\n");
             ws_force_orientation(con_get_workspace(con), o);
@@ -174,24 +219,25 @@ void tree_move(int direction) {
                           TAILQ_NEXT(con, nodes)))) {
                 if (!con_is_leaf(swap)) {
                     insert_con_into(con, con_descend_focused(swap), AFTER);
-                    goto end;
+                    return MOVE_REPARENTED;
                 }
                 if (direction == D_LEFT || direction == D_UP)
                     TAILQ_SWAP(swap, con, &(swap->parent->nodes_head), nodes);
                 else TAILQ_SWAP(con, swap, &(swap->parent->nodes_head), nodes);
+                con_children_changed(swap->parent);
 
                 TAILQ_REMOVE(&(con->parent->focus_head), con, focused);
                 TAILQ_INSERT_HEAD(&(swap->parent->focus_head), con, focused);
 
                 DLOG("Swapped.\n");
-                return;
+                return MOVE_SWAPPED;
             }
 
             if (con->parent == con_get_workspace(con)) {
                 /*  If we couldn't find a place to move it on this workspace,
                  *  try to move it to a workspace on a different output */
                 move_to_output_directed(con, direction);
-                goto end;
+                return MOVE_DONE;
             }
 
             /* If there was no con with which we could swap the current one,
@@ -210,7 +256,7 @@ void tree_move(int direction) {
     /* Enforce the fullscreen focus restrictions. */
     if (!con_fullscreen_permits_focusing(above->parent)) {
         LOG("Cannot move out of fullscreen container\n");
-        return;
+        return MOVE_STOP;
     }
 
     DLOG("above = %p\n", above);
@@ -231,14 +277,63 @@ void tree_move(int direction) {
     else
         insert_con_into(con, above, position);
 
-end:
-    /* We need to call con_focus() to fix the focus stack "above" the container
-     * we just inserted the focused container into (otherwise, the parent
-     * container(s) would still point to the old container(s)). */
-    con_focus(con);
+    return MOVE_REPARENTED;
+}
 
-    /* force re-painting the indicators */
-    FREE(con->deco_render_params);
+/*
+ * Moves the current container in the given direction (D_LEFT, D_RIGHT,
+ * D_UP, D_DOWN).
+ *
+ */
+void tree_move(int direction) {
+    tree_move_steps(direction, 1);
+}
+
+/*
+ * Moves the current container the given number of steps in the given
+ * direction, as if tree_move() was called that many times, but the caller
+ * only needs to render the tree once. Runs of swaps with sibling windows are
+ * done with a single detach/attach.
+ *
+ */
+void tree_move_steps(int direction, int steps) {
+    DLOG("Moving %d steps in direction %d\n", steps, direction);
+    Con *con = focused;
+
+    if (con->type == CT_WORKSPACE) {
+        DLOG("Not moving workspace\n");
+        return;
+    }
 
-    tree_flatten(croot);
+    while (steps > 0) {
+        int made = move_within_parent(con, direction, steps);
+        if (made > 0) {
+            steps -= made;
+            continue;
+        }
+
+        move_result_t result = move_step(con, direction);
+        if (result == MOVE_STOP)
+            return;
+        steps--;
+        if (result == MOVE_SWAPPED)
+            continue;
+
+        /* We need to call con_focus() to fix the focus stack "above" the
+         * container we just inserted the focused container into (otherwise,
+         * the parent container(s) would still point to the old
+         * container(s)). */
+        con_focus(con);
+
+        /* force re-painting the indicators */
+        FREE(con->deco_render_params);
+
+        /* The next step has to see the flattened tree, otherwise it could
+         * move the container out of a redundant split container, which does
+         * not look like a step at all. */
+        tree_flatten(croot);
+
+        if (result == MOVE_DONE)
+            return;
+    }
 }
@@ -0,0 +1,82 @@
+#undef I3__FILE__
+#define I3__FILE__ "pool.c"
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009-2013 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * pool.c: Fixed-size object pools for frequently allocated structures.
+ *
+ * Containers, windows, matches and X11 states are allocated and freed for
+ * every window which is mapped. Allocating them in blocks of
+ * POOL_BLOCK_OBJECTS and reusing freed objects avoids going through malloc()
+ * and keeps the heap from getting fragmented by short-lived windows.
+ *
+ */
+#include "all.h"
+
+#define POOL_BLOCK_OBJECTS 64
+
+/* Objects are aligned like the largest fundamental types. */
+#define POOL_ALIGNMENT (2 * sizeof(void *))
+
+struct pools_head all_pools = SLIST_HEAD_INITIALIZER(all_pools);
+
+struct pool con_pool = POOL_INITIALIZER("Con", Con);
+struct pool window_pool = POOL_INITIALIZER("i3Window", i3Window);
+struct pool match_pool = POOL_INITIALIZER("Match", Match);
+
+/*
+ * Allocates a new block for the given pool and puts all of its objects on
+ * the free list.
+ *
+ */
+static void pool_grow(struct pool *pool) {
+    char *block = smalloc(POOL_BLOCK_OBJECTS * pool->object_size);
+    for (int i = POOL_BLOCK_OBJECTS - 1; i >= 0; i--) {
+        void **object = (void **)(block + i * pool->object_size);
+        *object = pool->free_list;
+        pool->free_list = object;
+    }
+    pool->blocks++;
+    pool->available += POOL_BLOCK_OBJECTS;
+}
+
+/*
+ * Returns a zeroed object from the given pool (like scalloc() does). Exits
+ * i3 if no memory is available.
+ *
+ */
+void *pool_alloc(struct pool *pool) {
+    if (!pool->registered) {
+        pool->object_size = (pool->object_size + POOL_ALIGNMENT - 1) & ~(POOL_ALIGNMENT - 1);
+        SLIST_INSERT_HEAD(&all_pools, pool, pools);
+        pool->registered = true;
+    }
+
+    if (pool->free_list == NULL)
+        pool_grow(pool);
+
+    void **object = pool->free_list;
+    pool->free_list = *object;
+    pool->available--;
+    pool->in_use++;
+    memset(object, 0, pool->object_size);
+    return object;
+}
+
+/*
+ * Returns the given object (which must have been allocated from this pool)
+ * to the pool. NULL is ignored.
+ *
+ */
+void pool_free(struct pool *pool, void *object) {
+    if (object == NULL)
+        return;
+
+    *(void **)object = pool->free_list;
+    pool->free_list = object;
+    pool->in_use--;
+    pool->available++;
+}
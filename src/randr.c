@@ -29,6 +29,12 @@ struct outputs_head outputs = TAILQ_HEAD_INITIALIZER(outputs);
 
 static bool randr_disabled = false;
 
+/* Index of the RandR outputs by their X11 id. Outputs are never freed, so
+ * entries are only ever added. */
+#define OUTPUT_HASH_SIZE 16
+LIST_HEAD(output_bucket, xoutput);
+static struct output_bucket output_hash[OUTPUT_HASH_SIZE];
+
 /*
  * Get a specific output by its internal X11 id. Used by randr_query_outputs
  * to check if the output is new (only in the first scan) or if we are
@@ -37,13 +43,25 @@ static bool randr_disabled = false;
  */
 static Output *get_output_by_id(xcb_randr_output_t id) {
     Output *output;
-    TAILQ_FOREACH(output, &outputs, outputs)
+    LIST_FOREACH(output, &output_hash[id % OUTPUT_HASH_SIZE], by_id)
         if (output->id == id)
             return output;
 
     return NULL;
 }
 
+/*
+ * Adds a newly found RandR output to the list of outputs (the primary output
+ * first) and to the index.
+ *
+ */
+static void add_output(Output *new) {
+    if (new->primary)
+        TAILQ_INSERT_HEAD(&outputs, new, outputs);
+    else TAILQ_INSERT_TAIL(&outputs, new, outputs);
+    LIST_INSERT_HEAD(&output_hash[new->id % OUTPUT_HASH_SIZE], new, by_id);
+}
+
 /*
  * Returns the output with the given name if it is active (!) or NULL.
  *
@@ -72,24 +90,158 @@ Output *get_first_output(void) {
     die("No usable outputs available.\n");
 }
 
+/* Spatial index of the active outputs for get_output_containing(), which is
+ * called for every pointer movement between windows: The distinct x and y
+ * edges of all active outputs divide the screen into a grid of
+ * (num_xs - 1) × (num_ys - 1) cells, each of which belongs to at most one
+ * output. A lookup is a binary search on both axes. The index is rebuilt
+ * lazily after randr_invalidate_output_index(). */
+static struct {
+    bool valid;
+    /* Incremented on every invalidation, see get_output_next(). */
+    unsigned int generation;
+    int num_xs;
+    int num_ys;
+    int *xs;
+    int *ys;
+    Output **cells;
+    /* See randr_total_output_dimensions(). */
+    bool dimensions_valid;
+    Rect dimensions;
+} output_index;
+
 /*
- * Returns the active (!) output which contains the coordinates x, y or NULL
- * if there is no output which contains these coordinates.
+ * Marks the index for get_output_containing() as stale. Needs to be called
+ * whenever an output is added, (de)activated or changes its position or
+ * size.
  *
  */
-Output *get_output_containing(int x, int y) {
+void randr_invalidate_output_index(void) {
+    output_index.valid = false;
+    output_index.dimensions_valid = false;
+    output_index.generation++;
+    ipc_invalidate_cached_replies();
+}
+
+static int compare_ints(const void *a, const void *b) {
+    const int x = *(const int *)a, y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+/*
+ * Sorts the given edges and removes duplicates. Returns the new number of
+ * edges.
+ *
+ */
+static int unique_edges(int *edges, int num) {
+    qsort(edges, num, sizeof(int), compare_ints);
+    int unique = 0;
+    for (int i = 0; i < num; i++)
+        if (unique == 0 || edges[unique - 1] != edges[i])
+            edges[unique++] = edges[i];
+    return unique;
+}
+
+/*
+ * Returns the index of the cell (between edges[i] and edges[i + 1]) which
+ * contains the given value, or -1 if it is outside of all cells.
+ *
+ */
+static int find_cell(const int *edges, int num, int value) {
+    if (num < 2 || value < edges[0] || value >= edges[num - 1])
+        return -1;
+
+    int low = 0, high = num - 1;
+    while (high - low > 1) {
+        int mid = (low + high) / 2;
+        if (edges[mid] <= value)
+            low = mid;
+        else high = mid;
+    }
+    return low;
+}
+
+static void build_output_index(void) {
+    int num = 0;
     Output *output;
+    TAILQ_FOREACH(output, &outputs, outputs)
+        if (output->active)
+            num++;
+
+    output_index.xs = srealloc(output_index.xs, sizeof(int) * (2 * num + 1));
+    output_index.ys = srealloc(output_index.ys, sizeof(int) * (2 * num + 1));
+    int i = 0;
     TAILQ_FOREACH(output, &outputs, outputs) {
         if (!output->active)
             continue;
-        DLOG("comparing x=%d y=%d with x=%d and y=%d width %d height %d\n",
-                        x, y, output->rect.x, output->rect.y, output->rect.width, output->rect.height);
-        if (x >= output->rect.x && x < (output->rect.x + output->rect.width) &&
-            y >= output->rect.y && y < (output->rect.y + output->rect.height))
-            return output;
+        output_index.xs[i] = output->rect.x;
+        output_index.xs[i + 1] = output->rect.x + output->rect.width;
+        output_index.ys[i] = output->rect.y;
+        output_index.ys[i + 1] = output->rect.y + output->rect.height;
+        i += 2;
     }
+    output_index.num_xs = unique_edges(output_index.xs, i);
+    output_index.num_ys = unique_edges(output_index.ys, i);
 
-    return NULL;
+    const int columns = (output_index.num_xs > 1 ? output_index.num_xs - 1 : 0);
+    const int rows = (output_index.num_ys > 1 ? output_index.num_ys - 1 : 0);
+    FREE(output_index.cells);
+    output_index.cells = scalloc(sizeof(Output *) * (columns * rows + 1));
+
+    /* Like the linear search this replaces, the first output in the list
+     * wins if outputs overlap. */
+    TAILQ_FOREACH(output, &outputs, outputs) {
+        if (!output->active || output->rect.width == 0 || output->rect.height == 0)
+            continue;
+        int x1 = find_cell(output_index.xs, output_index.num_xs, output->rect.x);
+        int y1 = find_cell(output_index.ys, output_index.num_ys, output->rect.y);
+        int x2 = find_cell(output_index.xs, output_index.num_xs, output->rect.x + output->rect.width - 1);
+        int y2 = find_cell(output_index.ys, output_index.num_ys, output->rect.y + output->rect.height - 1);
+        for (int row = y1; row <= y2; row++) {
+            for (int column = x1; column <= x2; column++) {
+                Output **cell = &(output_index.cells[row * columns + column]);
+                if (*cell == NULL)
+                    *cell = output;
+            }
+        }
+    }
+
+    output_index.valid = true;
+}
+
+/*
+ * Returns the active (!) output which contains the coordinates x, y or NULL
+ * if there is no output which contains these coordinates.
+ *
+ */
+Output *get_output_containing(int x, int y) {
+    if (!output_index.valid)
+        build_output_index();
+
+    int column = find_cell(output_index.xs, output_index.num_xs, x);
+    int row = find_cell(output_index.ys, output_index.num_ys, y);
+    if (column == -1 || row == -1)
+        return NULL;
+
+    return output_index.cells[row * (output_index.num_xs - 1) + column];
+}
+
+/*
+ * Returns the sum of the widths and the sum of the heights of all outputs (x
+ * and y are 0). The result is cached until randr_invalidate_output_index().
+ *
+ */
+Rect randr_total_output_dimensions(void) {
+    if (!output_index.dimensions_valid) {
+        Output *output;
+        output_index.dimensions = (Rect){0, 0, 0, 0};
+        TAILQ_FOREACH(output, &outputs, outputs) {
+            output_index.dimensions.height += output->rect.height;
+            output_index.dimensions.width += output->rect.width;
+        }
+        output_index.dimensions_valid = true;
+    }
+    return output_index.dimensions;
 }
 
 /*
@@ -159,7 +311,7 @@ Output *get_output_next_wrap(direction_t direction, Output *current) {
  * specified (note that “current” counts as such an output).
  *
  */
-Output *get_output_next(direction_t direction, Output *current, output_close_far_t close_far) {
+static Output *find_output_next(direction_t direction, Output *current, output_close_far_t close_far) {
     Rect *cur = &(current->rect),
          *other;
     Output *output,
@@ -216,6 +368,35 @@ Output *get_output_next(direction_t direction, Output *current, output_close_far
         }
     }
 
+    return best;
+}
+
+/*
+ * Gets the output which is the next one in the given direction.
+ *
+ * If close_far == CLOSEST_OUTPUT, then the output next to the current one will
+ * selected. If close_far == FARTHEST_OUTPUT, the output which is the last one
+ * in the given direction will be selected.
+ *
+ * NULL will be returned when no active outputs are present in the direction
+ * specified (note that “current” counts as such an output).
+ *
+ * The neighbors of an output only change together with the output index, so
+ * they are looked up once and then taken from current->next.
+ *
+ */
+Output *get_output_next(direction_t direction, Output *current, output_close_far_t close_far) {
+    if (current->next_generation != output_index.generation) {
+        memset(current->next_valid, 0, sizeof(current->next_valid));
+        current->next_generation = output_index.generation;
+    }
+
+    if (!current->next_valid[direction][close_far]) {
+        current->next[direction][close_far] = find_output_next(direction, current, close_far);
+        current->next_valid[direction][close_far] = true;
+    }
+
+    Output *best = current->next[direction][close_far];
     DLOG("current = %s, best = %s\n", current->name, (best ? best->name : "NULL"));
     return best;
 }
@@ -240,6 +421,7 @@ void disable_randr(xcb_connection_t *conn) {
     init_ws_for_output(s, output_get_content(s->con));
 
     TAILQ_INSERT_TAIL(&outputs, s, outputs);
+    randr_invalidate_output_index();
 
     randr_disabled = true;
 }
@@ -293,11 +475,12 @@ void output_init_con(Output *output) {
     topdock->type = CT_DOCKAREA;
     topdock->layout = L_DOCKAREA;
     /* this container swallows dock clients */
-    Match *match = scalloc(sizeof(Match));
+    Match *match = pool_alloc(&match_pool);
     match_init(match);
     match->dock = M_DOCK_TOP;
     match->insert_where = M_BELOW;
     TAILQ_INSERT_TAIL(&(topdock->swallow_head), match, matches);
+    con_index_swallow(topdock, match);
 
     FREE(topdock->name);
     topdock->name = sstrdup("topdock");
@@ -327,11 +510,12 @@ void output_init_con(Output *output) {
     bottomdock->type = CT_DOCKAREA;
     bottomdock->layout = L_DOCKAREA;
     /* this container swallows dock clients */
-    match = scalloc(sizeof(Match));
+    match = pool_alloc(&match_pool);
     match_init(match);
     match->dock = M_DOCK_BOTTOM;
     match->insert_where = M_BELOW;
     TAILQ_INSERT_TAIL(&(bottomdock->swallow_head), match, matches);
+    con_index_swallow(bottomdock, match);
 
     FREE(bottomdock->name);
     bottomdock->name = sstrdup("bottomdock");
@@ -361,10 +545,7 @@ void init_ws_for_output(Output *output, Con *content) {
             continue;
 
         /* check if this workspace actually exists */
-        Con *workspace = NULL, *out;
-        TAILQ_FOREACH(out, &(croot->nodes_head), nodes)
-            GREP_FIRST(workspace, output_get_content(out),
-                       !strcasecmp(child->name, assignment->name));
+        Con *workspace = get_existing_workspace_by_name(assignment->name);
         if (workspace == NULL)
             continue;
 
@@ -496,10 +677,12 @@ static void output_change_mode(xcb_connection_t *conn, Output *output) {
                 continue;
 
             workspace->layout = (output->rect.height > output->rect.width) ? L_SPLITV : L_SPLITH;
+            con_mark_dirty(workspace);
             DLOG("Setting workspace [%d,%s]'s layout to %d.\n", workspace->num, workspace->name, workspace->layout);
             if ((child = TAILQ_FIRST(&(workspace->nodes_head)))) {
                 if (child->layout == L_SPLITV || child->layout == L_SPLITH)
                     child->layout = workspace->layout;
+                con_mark_dirty(child);
                 DLOG("Setting child [%d,%s]'s layout to %d.\n", child->num, child->name, child->layout);
             }
         }
@@ -513,13 +696,13 @@ static void output_change_mode(xcb_connection_t *conn, Output *output) {
  * either the "changed" or the "to_be_deleted" flag of the output, if
  * appropriate.
  *
+ * crtc is the (already requested) information about the CRTC of the output,
+ * NULL if the output has no CRTC or the request failed.
+ *
  */
-static void handle_output(xcb_connection_t *conn, xcb_randr_output_t id,
+static void handle_output(xcb_randr_output_t id,
                           xcb_randr_get_output_info_reply_t *output,
-                          xcb_timestamp_t cts, resources_reply *res) {
-    /* each CRT controller has a position in which we are interested in */
-    crtc_info *crtc;
-
+                          crtc_info *crtc) {
     Output *new = get_output_by_id(id);
     bool existing = (new != NULL);
     if (!existing)
@@ -537,21 +720,19 @@ static void handle_output(xcb_connection_t *conn, xcb_randr_output_t id,
      * we do not need to change the list ever again (we only update the
      * position/size) */
     if (output->crtc == XCB_NONE) {
-        if (!existing) {
-            if (new->primary)
-                TAILQ_INSERT_HEAD(&outputs, new, outputs);
-            else TAILQ_INSERT_TAIL(&outputs, new, outputs);
-        } else if (new->active)
+        if (!existing)
+            add_output(new);
+        else if (new->active)
             new->to_be_disabled = true;
         return;
     }
 
-    xcb_randr_get_crtc_info_cookie_t icookie;
-    icookie = xcb_randr_get_crtc_info(conn, output->crtc, cts);
-    if ((crtc = xcb_randr_get_crtc_info_reply(conn, icookie, NULL)) == NULL) {
-        DLOG("Skipping output %s: could not get CRTC (%p)\n",
-             new->name, crtc);
-        free(new);
+    if (crtc == NULL) {
+        DLOG("Skipping output %s: could not get CRTC\n", new->name);
+        if (!existing) {
+            FREE(new->name);
+            free(new);
+        }
         return;
     }
 
@@ -559,7 +740,6 @@ static void handle_output(xcb_connection_t *conn, xcb_randr_output_t id,
                    update_if_necessary(&(new->rect.y), crtc->y) |
                    update_if_necessary(&(new->rect.width), crtc->width) |
                    update_if_necessary(&(new->rect.height), crtc->height);
-    free(crtc);
     new->active = (new->rect.width != 0 && new->rect.height != 0);
     if (!new->active) {
         DLOG("width/height 0/0, disabling output\n");
@@ -573,11 +753,8 @@ static void handle_output(xcb_connection_t *conn, xcb_randr_output_t id,
      * does not exist in the first place, the case is simple: we either
      * need to insert the new output or we are done. */
     if (!updated || !existing) {
-        if (!existing) {
-            if (new->primary)
-                TAILQ_INSERT_HEAD(&outputs, new, outputs);
-            else TAILQ_INSERT_TAIL(&outputs, new, outputs);
-        }
+        if (!existing)
+            add_output(new);
         return;
     }
 
@@ -620,10 +797,21 @@ void randr_query_outputs(void) {
     int len = xcb_randr_get_screen_resources_current_outputs_length(res);
     randr_outputs = xcb_randr_get_screen_resources_current_outputs(res);
 
-    /* Request information for each output */
+    int crtcs_len = xcb_randr_get_screen_resources_current_crtcs_length(res);
+    xcb_randr_crtc_t *randr_crtcs = xcb_randr_get_screen_resources_current_crtcs(res);
+
+    /* Request information for each output and each CRTC at once, so that
+     * all replies arrive after a single round trip. */
     xcb_randr_get_output_info_cookie_t ocookie[len];
     for (int i = 0; i < len; i++)
         ocookie[i] = xcb_randr_get_output_info(conn, randr_outputs[i], cts);
+    xcb_randr_get_crtc_info_cookie_t ccookie[crtcs_len];
+    for (int i = 0; i < crtcs_len; i++)
+        ccookie[i] = xcb_randr_get_crtc_info(conn, randr_crtcs[i], cts);
+
+    crtc_info *crtcs[crtcs_len];
+    for (int i = 0; i < crtcs_len; i++)
+        crtcs[i] = xcb_randr_get_crtc_info_reply(conn, ccookie[i], NULL);
 
     /* Loop through all outputs available for this X11 screen */
     for (int i = 0; i < len; i++) {
@@ -632,9 +820,21 @@ void randr_query_outputs(void) {
         if ((output = xcb_randr_get_output_info_reply(conn, ocookie[i], NULL)) == NULL)
             continue;
 
-        handle_output(conn, randr_outputs[i], output, cts, res);
+        crtc_info *crtc = NULL;
+        for (int j = 0; j < crtcs_len; j++) {
+            if (randr_crtcs[j] == output->crtc) {
+                crtc = crtcs[j];
+                break;
+            }
+        }
+
+        handle_output(randr_outputs[i], output, crtc);
         free(output);
     }
+    randr_invalidate_output_index();
+
+    for (int i = 0; i < crtcs_len; i++)
+        free(crtcs[i]);
 
     /* Check for clones, disable the clones and reduce the mode to the
      * lowest common mode */
@@ -674,6 +874,7 @@ void randr_query_outputs(void) {
                             other->rect.width, other->rect.height);
         }
     }
+    randr_invalidate_output_index();
 
     /* Ensure that all outputs which are active also have a con. This is
      * necessary because in the next step, a clone might get disabled. Example:
@@ -692,6 +893,7 @@ void randr_query_outputs(void) {
     TAILQ_FOREACH(output, &outputs, outputs) {
         if (output->to_be_disabled) {
             output->active = false;
+            randr_invalidate_output_index();
             DLOG("Output %s disabled, re-assigning workspaces/docks\n", output->name);
 
             first = get_first_output();
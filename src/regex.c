@@ -11,21 +11,68 @@
  */
 #include "all.h"
 
+/* All compiled regular expressions, hashed by their pattern. */
+#define REGEX_BUCKETS 64
+static SLIST_HEAD(regex_head, regex) regex_buckets[REGEX_BUCKETS];
+
+/* The regexes which are not used anymore (refcount 0), least recently
+ * released first. They stay in regex_buckets until more than
+ * REGEX_UNUSED_MAX of them pile up. */
+#define REGEX_UNUSED_MAX 64
+static TAILQ_HEAD(regex_unused_head, regex) regex_unused = TAILQ_HEAD_INITIALIZER(regex_unused);
+static int regex_unused_num;
+
+static struct memory_stats regex_memory = MEMORY_STATS_INITIALIZER("regex");
+
+/*
+ * Returns the number of bytes used by the given regex, including the
+ * compiled and studied pattern.
+ *
+ */
+static size_t regex_bytes(struct regex *regex) {
+    size_t size = 0, study_size = 0;
+    pcre_fullinfo(regex->regex, NULL, PCRE_INFO_SIZE, &size);
+    if (regex->extra != NULL)
+        pcre_fullinfo(regex->regex, regex->extra, PCRE_INFO_STUDYSIZE, &study_size);
+    return sizeof(struct regex) + strlen(regex->pattern) + 1 + size + study_size;
+}
+
+static struct regex_head *regex_bucket(const char *pattern) {
+    unsigned int hash = 5381;
+    for (const char *c = pattern; *c != '\0'; c++)
+        hash = ((hash << 5) + hash) + (unsigned char)*c;
+    return &regex_buckets[hash % REGEX_BUCKETS];
+}
+
 /*
  * Creates a new 'regex' struct containing the given pattern and a PCRE
- * compiled regular expression. Also, calls pcre_study because this regex will
- * most likely be used often (like for every new window and on every relevant
- * property change of existing windows).
+ * compiled regular expression. Also, calls pcre_study (using the JIT compiler
+ * if available) because this regex will most likely be used often (like for
+ * every new window and on every relevant property change of existing
+ * windows).
+ *
+ * Regexes are interned: if the same pattern was already compiled, the
+ * existing regex is returned (and has to be passed to regex_free() as well).
  *
  * Returns NULL if the pattern could not be compiled into a regular expression
  * (and ELOGs an appropriate error message).
  *
  */
 struct regex *regex_new(const char *pattern) {
+    /* 0 is never used, so that empty memo entries don’t match any regex */
+    static uint32_t next_id = 1;
     const char *error;
     int errorcode, offset;
 
-    struct regex *re = scalloc(sizeof(struct regex));
+    struct regex_head *bucket = regex_bucket(pattern);
+    struct regex *re;
+    SLIST_FOREACH(re, bucket, regexes) {
+        if (strcmp(re->pattern, pattern) != 0)
+            continue;
+        return regex_ref(re);
+    }
+
+    re = scalloc(sizeof(struct regex));
     re->pattern = sstrdup(pattern);
     int options = PCRE_UTF8;
 #ifdef PCRE_HAS_UCP
@@ -42,28 +89,79 @@ struct regex *regex_new(const char *pattern) {
         }
         ELOG("PCRE regular expression compilation failed at %d: %s\n",
              offset, error);
+        free(re->pattern);
+        free(re);
         return NULL;
     }
-    re->extra = pcre_study(re->regex, 0, &error);
+    int study_options = 0;
+#ifdef PCRE_STUDY_JIT_COMPILE
+    /* PCRE >= 8.20 can compile the regex to machine code, which makes
+     * matching considerably faster. If JIT is not available at runtime,
+     * PCRE silently falls back to the interpreter. */
+    study_options |= PCRE_STUDY_JIT_COMPILE;
+#endif
+    re->extra = pcre_study(re->regex, study_options, &error);
     /* If an error happened, we print the error message, but continue.
      * Studying the regular expression leads to faster matching, but it’s not
      * absolutely necessary. */
     if (error) {
         ELOG("PCRE regular expression studying failed: %s\n", error);
     }
+    re->id = next_id++;
+    re->refcount = 1;
+    SLIST_INSERT_HEAD(bucket, re, regexes);
+    memory_stats_alloc(&regex_memory, regex_bytes(re));
     return re;
 }
 
 /*
- * Frees the given regular expression. It must not be used afterwards!
+ * Returns another reference to the given regular expression, which has to be
+ * passed to regex_free() as well. Cheaper than regex_new() with the same
+ * pattern.
  *
  */
-void regex_free(struct regex *regex) {
-    if (!regex)
-        return;
+struct regex *regex_ref(struct regex *regex) {
+    if (regex->refcount++ == 0) {
+        TAILQ_REMOVE(&regex_unused, regex, unused);
+        regex_unused_num--;
+    }
+    return regex;
+}
+
+static void regex_destroy(struct regex *regex) {
+    memory_stats_free(&regex_memory, regex_bytes(regex));
+    SLIST_REMOVE(regex_bucket(regex->pattern), regex, regex, regexes);
     FREE(regex->pattern);
     FREE(regex->regex);
+#ifdef PCRE_STUDY_JIT_COMPILE
+    pcre_free_study(regex->extra);
+#else
     FREE(regex->extra);
+#endif
+    free(regex);
+}
+
+/*
+ * Releases the given regular expression, which must not be used afterwards.
+ * Once the last user of this pattern released it, it is kept around unused
+ * (so that using the same pattern again does not need to compile it) until
+ * too many unused regexes accumulated.
+ *
+ */
+void regex_free(struct regex *regex) {
+    if (!regex)
+        return;
+    if (--(regex->refcount) > 0)
+        return;
+
+    TAILQ_INSERT_TAIL(&regex_unused, regex, unused);
+    if (++regex_unused_num <= REGEX_UNUSED_MAX)
+        return;
+
+    struct regex *oldest = TAILQ_FIRST(&regex_unused);
+    TAILQ_REMOVE(&regex_unused, oldest, unused);
+    regex_unused_num--;
+    regex_destroy(oldest);
 }
 
 /*
@@ -93,3 +191,28 @@ bool regex_matches(struct regex *regex, const char *input) {
          rc, regex->pattern, input);
     return false;
 }
+
+/*
+ * If the regular expression only matches one exact string (i.e. it has the
+ * form ^literal$ without any special characters), returns a copy of
+ * that string which has to be free()d. Otherwise returns NULL.
+ *
+ */
+char *regex_exact_literal(struct regex *regex) {
+    if (regex == NULL)
+        return NULL;
+
+    const char *pattern = regex->pattern;
+    size_t len = strlen(pattern);
+    if (len < 2 || pattern[0] != '^' || pattern[len - 1] != '$')
+        return NULL;
+
+    for (size_t i = 1; i < len - 1; i++)
+        if (strchr("\\^$.|?*+()[]{}", pattern[i]) != NULL)
+            return NULL;
+
+    char *literal = smalloc(len - 1);
+    memcpy(literal, pattern + 1, len - 2);
+    literal[len - 2] = '\0';
+    return literal;
+}
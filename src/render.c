@@ -76,14 +76,20 @@ static void render_l_output(Con *con) {
     }
 
     /* First pass: determine the height of all CT_DOCKAREAs (the sum of their
-     * children) and figure out how many pixels we have left for the rest */
+     * children) and figure out how many pixels we have left for the rest. The
+     * sum only changes when dock clients come, go or change their height, so
+     * it is cached. */
     TAILQ_FOREACH(child, &(con->nodes_head), nodes) {
         if (child->type != CT_DOCKAREA)
             continue;
 
-        child->rect.height = 0;
-        TAILQ_FOREACH(dockchild, &(child->nodes_head), nodes)
-            child->rect.height += dockchild->geometry.height;
+        if (!child->dock_height_valid) {
+            child->dock_height = 0;
+            TAILQ_FOREACH(dockchild, &(child->nodes_head), nodes)
+                child->dock_height += dockchild->geometry.height;
+            child->dock_height_valid = true;
+        }
+        child->rect.height = child->dock_height;
 
         height -= child->rect.height;
     }
@@ -115,6 +121,105 @@ static void render_l_output(Con *con) {
     }
 }
 
+/*
+ * Marks the given container and all of its descendants as dirty, so that
+ * their geometry is recomputed (see Con.layout_stale).
+ *
+ */
+static void mark_subtree_dirty(Con *con) {
+    Con *current;
+
+    con->dirty = true;
+    con->layout_stale = false;
+    TAILQ_FOREACH(current, &(con->nodes_head), nodes)
+        mark_subtree_dirty(current);
+    TAILQ_FOREACH(current, &(con->floating_head), floating_windows)
+        mark_subtree_dirty(current);
+}
+
+/*
+ * Resets the map state render_con() set for the given container and its
+ * children.
+ *
+ */
+static void mark_subtree_unmapped(Con *con) {
+    Con *current;
+
+    con->mapped = false;
+    TAILQ_FOREACH(current, &(con->nodes_head), nodes)
+        mark_subtree_unmapped(current);
+}
+
+/*
+ * Renders the given workspace although it is not visible, so that its windows
+ * already have the right geometry when it is shown. Nothing is mapped.
+ *
+ */
+void render_hidden_workspace(Con *ws) {
+    Con *content = output_get_content(con_get_output(ws));
+    if (content == NULL)
+        return;
+
+    ws->rect = content->rect;
+    render_con(ws, false);
+    mark_subtree_unmapped(ws);
+}
+
+/* The resolution of the fixed-point weights split_sizes() converts the
+ * percentages to. Fine enough that the weights of 2^12 children still sum up
+ * to less than 2^32, and coarse enough that tiny floating point errors in the
+ * percentages do not change the result. */
+#define SIZE_WEIGHT_ONE (1 << 20)
+
+/*
+ * Splits total pixels between the children of a split container according to
+ * their percentages and stores the sizes in sizes[]. The percentages are
+ * converted to fixed-point weights, so the result only depends on the ratios
+ * between them (their sum does not need to be exactly 1.0). Every child gets
+ * the integer part of its share, the remaining pixels (less than one per
+ * child) go to the first children.
+ *
+ * The sizes are cached in the children and only computed again when the
+ * total, the number, order or percentage of the children changed, or when
+ * children were attached, detached or replaced (see con_children_changed()).
+ *
+ */
+static void split_sizes(Con *con, Con **nodes, int children, int total, int *sizes) {
+    bool cached = (con->size_cache_total == total && con->size_cache_children == children);
+    for (int i = 0; cached && i < children; i++)
+        cached = (nodes[i]->size_cache_index == i &&
+                  nodes[i]->size_cache_percent == nodes[i]->percent);
+    if (cached) {
+        for (int i = 0; i < children; i++)
+            sizes[i] = nodes[i]->size_cache_pixels;
+        return;
+    }
+
+    uint32_t weights[children];
+    uint64_t weights_sum = 0;
+    for (int i = 0; i < children; i++) {
+        double percentage = nodes[i]->percent > 0.0 ? nodes[i]->percent : 1.0 / children;
+        weights[i] = lround(percentage * SIZE_WEIGHT_ONE);
+        if (weights[i] == 0)
+            weights[i] = 1;
+        weights_sum += weights[i];
+    }
+
+    int assigned = 0;
+    for (int i = 0; i < children; i++)
+        assigned += sizes[i] = ((uint64_t)total * weights[i]) / weights_sum;
+    for (int i = 0; assigned < total; i++, assigned++)
+        sizes[i]++;
+
+    con->size_cache_total = total;
+    con->size_cache_children = children;
+    for (int i = 0; i < children; i++) {
+        nodes[i]->size_cache_pixels = sizes[i];
+        nodes[i]->size_cache_percent = nodes[i]->percent;
+        nodes[i]->size_cache_index = i;
+    }
+}
+
 /*
  * "Renders" the given container (and its children), meaning that all rects are
  * updated correctly. Note that this function does not call any xcb_*
@@ -124,10 +229,36 @@ static void render_l_output(Con *con) {
  *
  */
 void render_con(Con *con, bool render_fullscreen) {
-    int children = con_num_children(con);
-    DLOG("Rendering %snode %p / %s / layout %d / children %d\n",
-         (render_fullscreen ? "fullscreen " : ""), con, con->name, con->layout,
-         children);
+    int children;
+    Con **nodes = con_children(con, &children);
+
+    /* Changes on invisible workspaces are only rendered once the workspace
+     * is shown. */
+    if (con->layout_stale)
+        mark_subtree_dirty(con);
+
+    /* If neither this container nor any of its descendants changed and it
+     * still got the same rect as in the last render pass, the geometry inside
+     * of it is still up to date. We still walk the tree to update the map
+     * state and the stacking order (see x_raise_con()), but skip all the
+     * calculations. */
+    const bool moved = (memcmp(&(con->render_rect), &(con->rect), sizeof(Rect)) != 0);
+    const bool clean = (!con->dirty &&
+                        con->render_fullscreen == render_fullscreen &&
+                        !moved);
+    con->render_rect = con->rect;
+    con->render_fullscreen = render_fullscreen;
+
+    if (!clean) {
+        DLOG("Rendering %snode %p / %s / layout %d / children %d\n",
+             (render_fullscreen ? "fullscreen " : ""), con, con->name, con->layout,
+             children);
+        con_mark_changed(con);
+    }
+
+    /* The rects of workspaces are part of the GET_WORKSPACES reply. */
+    if (moved && con->type == CT_WORKSPACE)
+        ipc_invalidate_cached_replies();
 
     /* Copy container rect, subtract container border */
     /* This is the actually usable space inside this container for clients */
@@ -148,9 +279,11 @@ void render_con(Con *con, bool render_fullscreen) {
     int i = 0;
 
     con->mapped = true;
+    for (Con *current = con; current != NULL && !current->rendered; current = current->parent)
+        current->rendered = true;
 
     /* if this container contains a window, set the coordinates */
-    if (con->window) {
+    if (con->window && !clean) {
         /* depending on the border style, the rect of the child window
          * needs to be smaller */
         Rect *inset = &(con->window_rect);
@@ -208,6 +341,7 @@ void render_con(Con *con, bool render_fullscreen) {
     }
     if (fullscreen) {
         fullscreen->rect = rect;
+        fullscreen->hidden = false;
         x_raise_con(fullscreen);
         render_con(fullscreen, true);
         return;
@@ -219,25 +353,10 @@ void render_con(Con *con, bool render_fullscreen) {
     /* precalculate the sizes to be able to correct rounding errors */
     int sizes[children];
     memset(sizes, 0, children*sizeof(int));
-    if ((con->layout == L_SPLITH || con->layout == L_SPLITV) && children > 0) {
+    if (!clean && (con->layout == L_SPLITH || con->layout == L_SPLITV) && children > 0) {
         assert(!TAILQ_EMPTY(&con->nodes_head));
-        Con *child;
-        int i = 0, assigned = 0;
         int total = con_orientation(con) == HORIZ ? rect.width : rect.height;
-        TAILQ_FOREACH(child, &(con->nodes_head), nodes) {
-            double percentage = child->percent > 0.0 ? child->percent : 1.0 / children;
-            assigned += sizes[i++] = percentage * total;
-        }
-        assert(assigned == total ||
-                (assigned > total && assigned - total <= children * 2) ||
-                (assigned < total && total - assigned <= children * 2));
-        int signal = assigned < total ? 1 : -1;
-        while (assigned != total) {
-            for (i = 0; i < children && assigned != total; ++i) {
-                sizes[i] += signal;
-                assigned += signal;
-            }
-        }
+        split_sizes(con, nodes, children, total, sizes);
     }
 
     if (con->layout == L_OUTPUT) {
@@ -248,6 +367,10 @@ void render_con(Con *con, bool render_fullscreen) {
     } else if (con->type == CT_ROOT) {
         Con *output;
         TAILQ_FOREACH(output, &(con->nodes_head), nodes) {
+            /* Unchanged outputs keep their geometry and stacking order (see
+             * tree_render()). */
+            if (output->render_skip)
+                continue;
             render_con(output, false);
         }
 
@@ -299,6 +422,7 @@ void render_con(Con *con, bool render_fullscreen) {
                 }
                 DLOG("floating child at (%d,%d) with %d x %d\n",
                      child->rect.x, child->rect.y, child->rect.width, child->rect.height);
+                child->hidden = false;
                 x_raise_con(child);
                 render_con(child, false);
             }
@@ -308,106 +432,123 @@ void render_con(Con *con, bool render_fullscreen) {
 
         /* FIXME: refactor this into separate functions: */
     Con *child;
-    TAILQ_FOREACH(child, &(con->nodes_head), nodes) {
-        assert(children > 0);
 
-        /* default layout */
-        if (con->layout == L_SPLITH || con->layout == L_SPLITV) {
-            if (con->layout == L_SPLITH) {
+    /* Only one child of a stacked/tabbed container is visible, the others
+     * (and everything inside of them) are marked hidden. */
+    Con *visible = NULL;
+    if (con->layout == L_STACKED || con->layout == L_TABBED) {
+        TAILQ_FOREACH(child, &(con->focus_head), focused) {
+            if (child->type != CT_FLOATING_CON) {
+                visible = child;
+                break;
+            }
+        }
+    }
+
+    for (int c = 0; c < children; c++) {
+        child = nodes[c];
+        child->hidden = con->hidden ||
+                        ((con->layout == L_STACKED || con->layout == L_TABBED) && child != visible);
+
+        if (!clean) {
+            /* default layout */
+            if (con->layout == L_SPLITH || con->layout == L_SPLITV) {
+                if (con->layout == L_SPLITH) {
+                    child->rect.x = x;
+                    child->rect.y = y;
+                    child->rect.width = sizes[i];
+                    child->rect.height = rect.height;
+                    x += child->rect.width;
+                } else {
+                    child->rect.x = x;
+                    child->rect.y = y;
+                    child->rect.width = rect.width;
+                    child->rect.height = sizes[i];
+                    y += child->rect.height;
+                }
+
+                /* first we have the decoration, if this is a leaf node */
+                if (con_is_leaf(child)) {
+                    if (child->border_style == BS_NORMAL) {
+                        /* TODO: make a function for relative coords? */
+                        child->deco_rect.x = child->rect.x - con->rect.x;
+                        child->deco_rect.y = child->rect.y - con->rect.y;
+
+                        child->rect.y += deco_height;
+                        child->rect.height -= deco_height;
+
+                        child->deco_rect.width = child->rect.width;
+                        child->deco_rect.height = deco_height;
+                    } else {
+                        child->deco_rect.x = 0;
+                        child->deco_rect.y = 0;
+                        child->deco_rect.width = 0;
+                        child->deco_rect.height = 0;
+                    }
+                }
+            }
+
+            /* stacked layout */
+            else if (con->layout == L_STACKED) {
                 child->rect.x = x;
                 child->rect.y = y;
-                child->rect.width = sizes[i];
+                child->rect.width = rect.width;
                 child->rect.height = rect.height;
-                x += child->rect.width;
-            } else {
+
+                child->deco_rect.x = x - con->rect.x;
+                child->deco_rect.y = y - con->rect.y + (i * deco_height);
+                child->deco_rect.width = child->rect.width;
+                child->deco_rect.height = deco_height;
+
+                if (children > 1 || (child->border_style != BS_PIXEL && child->border_style != BS_NONE)) {
+                    child->rect.y += (deco_height * children);
+                    child->rect.height -= (deco_height * children);
+                }
+            }
+
+            /* tabbed layout */
+            else if (con->layout == L_TABBED) {
                 child->rect.x = x;
                 child->rect.y = y;
                 child->rect.width = rect.width;
-                child->rect.height = sizes[i];
-                y += child->rect.height;
-            }
+                child->rect.height = rect.height;
 
-            /* first we have the decoration, if this is a leaf node */
-            if (con_is_leaf(child)) {
-                if (child->border_style == BS_NORMAL) {
-                    /* TODO: make a function for relative coords? */
-                    child->deco_rect.x = child->rect.x - con->rect.x;
-                    child->deco_rect.y = child->rect.y - con->rect.y;
+                child->deco_rect.width = floor((float)child->rect.width / children);
+                child->deco_rect.x = x - con->rect.x + i * child->deco_rect.width;
+                child->deco_rect.y = y - con->rect.y;
 
+                /* Since the tab width may be something like 31,6 px per tab, we
+                 * let the last tab have all the extra space (0,6 * children). */
+                if (i == (children-1)) {
+                    child->deco_rect.width += (child->rect.width - (child->deco_rect.x + child->deco_rect.width));
+                }
+
+                if (children > 1 || (child->border_style != BS_PIXEL && child->border_style != BS_NONE)) {
                     child->rect.y += deco_height;
                     child->rect.height -= deco_height;
-
-                    child->deco_rect.width = child->rect.width;
                     child->deco_rect.height = deco_height;
                 } else {
-                    child->deco_rect.x = 0;
-                    child->deco_rect.y = 0;
-                    child->deco_rect.width = 0;
-                    child->deco_rect.height = 0;
+                    child->deco_rect.height = (child->border_style == BS_PIXEL ? 1 : 0);
                 }
             }
-        }
-
-        /* stacked layout */
-        else if (con->layout == L_STACKED) {
-            child->rect.x = x;
-            child->rect.y = y;
-            child->rect.width = rect.width;
-            child->rect.height = rect.height;
-
-            child->deco_rect.x = x - con->rect.x;
-            child->deco_rect.y = y - con->rect.y + (i * deco_height);
-            child->deco_rect.width = child->rect.width;
-            child->deco_rect.height = deco_height;
-
-            if (children > 1 || (child->border_style != BS_PIXEL && child->border_style != BS_NONE)) {
-                child->rect.y += (deco_height * children);
-                child->rect.height -= (deco_height * children);
-            }
-        }
 
-        /* tabbed layout */
-        else if (con->layout == L_TABBED) {
-            child->rect.x = x;
-            child->rect.y = y;
-            child->rect.width = rect.width;
-            child->rect.height = rect.height;
-
-            child->deco_rect.width = floor((float)child->rect.width / children);
-            child->deco_rect.x = x - con->rect.x + i * child->deco_rect.width;
-            child->deco_rect.y = y - con->rect.y;
-
-            /* Since the tab width may be something like 31,6 px per tab, we
-             * let the last tab have all the extra space (0,6 * children). */
-            if (i == (children-1)) {
-                child->deco_rect.width += (child->rect.width - (child->deco_rect.x + child->deco_rect.width));
-            }
+            /* dockarea layout */
+            else if (con->layout == L_DOCKAREA) {
+                child->rect.x = x;
+                child->rect.y = y;
+                child->rect.width = rect.width;
+                child->rect.height = child->geometry.height;
 
-            if (children > 1 || (child->border_style != BS_PIXEL && child->border_style != BS_NONE)) {
-                child->rect.y += deco_height;
-                child->rect.height -= deco_height;
-                child->deco_rect.height = deco_height;
-            } else {
-                child->deco_rect.height = (child->border_style == BS_PIXEL ? 1 : 0);
+                child->deco_rect.x = 0;
+                child->deco_rect.y = 0;
+                child->deco_rect.width = 0;
+                child->deco_rect.height = 0;
+                y += child->rect.height;
             }
-        }
 
-        /* dockarea layout */
-        else if (con->layout == L_DOCKAREA) {
-            child->rect.x = x;
-            child->rect.y = y;
-            child->rect.width = rect.width;
-            child->rect.height = child->geometry.height;
-
-            child->deco_rect.x = 0;
-            child->deco_rect.y = 0;
-            child->deco_rect.width = 0;
-            child->deco_rect.height = 0;
-            y += child->rect.height;
+            DLOG("child at (%d, %d) with (%d x %d)\n",
+                 child->rect.x, child->rect.y, child->rect.width, child->rect.height);
         }
-
-        DLOG("child at (%d, %d) with (%d x %d)\n",
-                child->rect.x, child->rect.y, child->rect.width, child->rect.height);
         x_raise_con(child);
         render_con(child, false);
         i++;
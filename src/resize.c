@@ -23,10 +23,52 @@ extern xcb_connection_t *conn;
 struct callback_params {
     orientation_t orientation;
     Con *output;
+    /* The line which shows the new border position, XCB_NONE when resizing
+     * live (see the tiling_resize directive). */
     xcb_window_t helpwin;
     uint32_t *new_position;
+
+    Con *first;
+    Con *second;
+    /* The serials of both containers, see con_still_exists(). */
+    uint64_t first_serial;
+    uint64_t second_serial;
+    /* Position of the border, size of the first container and the
+     * percentages of both containers when the drag started. */
+    uint32_t start_position;
+    int original;
+    double first_percent;
+    double second_percent;
 };
 
+/*
+ * Moves the border between the two containers by the given number of pixels,
+ * starting from the percentages they had when the drag started.
+ *
+ */
+static void resize_set_percent(const struct callback_params *params, int pixels) {
+    Con *first = params->first;
+    Con *second = params->second;
+
+    // calculate the new percentage for the first container
+    double new_percent, difference;
+    double percent = params->first_percent;
+    DLOG("percent = %f\n", percent);
+    DLOG("original = %d\n", params->original);
+    new_percent = (params->original + pixels) * (percent / params->original);
+    difference = percent - new_percent;
+    DLOG("difference = %f\n", difference);
+    DLOG("new percent = %f\n", new_percent);
+    first->percent = new_percent;
+
+    // calculate the new percentage for the second container
+    second->percent = params->second_percent + difference;
+    DLOG("second->percent = %f\n", second->percent);
+
+    // now we must make sure that the sum of the percentages remain 1.0
+    con_fix_percent(first->parent);
+}
+
 DRAGGING_CB(resize_callback) {
     const struct callback_params *params = extra;
     Con *output = params->output;
@@ -38,17 +80,33 @@ DRAGGING_CB(resize_callback) {
             return;
 
         *(params->new_position) = new_x;
-        xcb_configure_window(conn, params->helpwin, XCB_CONFIG_WINDOW_X, params->new_position);
     } else {
         if (new_y > (output->rect.y + output->rect.height - 25) ||
             new_y < (output->rect.y + 25))
             return;
 
         *(params->new_position) = new_y;
-        xcb_configure_window(conn, params->helpwin, XCB_CONFIG_WINDOW_Y, params->new_position);
     }
 
-    xcb_flush(conn);
+    if (params->helpwin != XCB_NONE) {
+        xcb_configure_window(conn, params->helpwin,
+                             (params->orientation == HORIZ ? XCB_CONFIG_WINDOW_X : XCB_CONFIG_WINDOW_Y),
+                             params->new_position);
+        xcb_flush(conn);
+        return;
+    }
+
+    /* IPC commands are handled while dragging and might have closed one of
+     * the containers. */
+    if (!con_still_exists(params->first, params->first_serial) ||
+        !con_still_exists(params->second, params->second_serial))
+        return;
+
+    /* Only the parent of both containers is marked as dirty, so rendering
+     * recomputes the layout of the two containers and their contents while
+     * the rest of the tree stays untouched. */
+    resize_set_percent(params, *(params->new_position) - params->start_position);
+    tree_render();
 }
 
 bool resize_find_tiling_participants(Con **current, Con **other, direction_t direction) {
@@ -122,6 +180,8 @@ int resize_graphical_handler(Con *first, Con *second, orientation_t orientation,
     xcb_window_t grabwin = create_window(conn, output->rect, XCB_COPY_FROM_PARENT, XCB_COPY_FROM_PARENT,
             XCB_WINDOW_CLASS_INPUT_ONLY, XCURSOR_CURSOR_POINTER, true, mask, values);
 
+    const bool live = (config.tiling_resize == TR_LIVE);
+    xcb_window_t helpwin = XCB_NONE;
     Rect helprect;
     if (orientation == HORIZ) {
         helprect.x = event->root_x;
@@ -137,64 +197,70 @@ int resize_graphical_handler(Con *first, Con *second, orientation_t orientation,
         new_position = event->root_y;
     }
 
-    mask = XCB_CW_BACK_PIXEL;
-    values[0] = config.client.focused.border;
+    if (!live) {
+        mask = XCB_CW_BACK_PIXEL;
+        values[0] = config.client.focused.border;
 
-    mask |= XCB_CW_OVERRIDE_REDIRECT;
-    values[1] = 1;
+        mask |= XCB_CW_OVERRIDE_REDIRECT;
+        values[1] = 1;
 
-    xcb_window_t helpwin = create_window(conn, helprect, XCB_COPY_FROM_PARENT, XCB_COPY_FROM_PARENT,
-            XCB_WINDOW_CLASS_INPUT_OUTPUT, (orientation == HORIZ ?
-                                          XCURSOR_CURSOR_RESIZE_HORIZONTAL :
-                                          XCURSOR_CURSOR_RESIZE_VERTICAL), true, mask, values);
+        helpwin = create_window(conn, helprect, XCB_COPY_FROM_PARENT, XCB_COPY_FROM_PARENT,
+                XCB_WINDOW_CLASS_INPUT_OUTPUT, (orientation == HORIZ ?
+                                              XCURSOR_CURSOR_RESIZE_HORIZONTAL :
+                                              XCURSOR_CURSOR_RESIZE_VERTICAL), true, mask, values);
 
-    xcb_circulate_window(conn, XCB_CIRCULATE_RAISE_LOWEST, helpwin);
+        xcb_circulate_window(conn, XCB_CIRCULATE_RAISE_LOWEST, helpwin);
+    }
 
     xcb_flush(conn);
 
-    const struct callback_params params = { orientation, output, helpwin, &new_position };
+    // if we got thus far, the containers must have
+    // percentages associated with them
+    assert(first->percent > 0.0);
+    assert(second->percent > 0.0);
+
+    const struct callback_params params = {
+        .orientation = orientation,
+        .output = output,
+        .helpwin = helpwin,
+        .new_position = &new_position,
+        .first = first,
+        .second = second,
+        .first_serial = first->serial,
+        .second_serial = second->serial,
+        .start_position = new_position,
+        .original = (orientation == HORIZ ? first->rect.width : first->rect.height),
+        .first_percent = first->percent,
+        .second_percent = second->percent,
+    };
 
     drag_result_t drag_result = drag_pointer(NULL, event, grabwin, BORDER_TOP, 0, resize_callback, &params);
 
-    xcb_destroy_window(conn, helpwin);
+    if (helpwin != XCB_NONE)
+        xcb_destroy_window(conn, helpwin);
     xcb_destroy_window(conn, grabwin);
     xcb_flush(conn);
 
-    /* User cancelled the drag so no action should be taken. */
-    if (drag_result == DRAG_REVERT)
+    /* IPC commands are handled while dragging and might have closed one of
+     * the containers. */
+    if (!con_still_exists(first, params.first_serial) ||
+        !con_still_exists(second, params.second_serial)) {
+        DLOG("A resized container is gone, not resizing.\n");
         return 0;
+    }
 
-    int pixels;
-    if (orientation == HORIZ)
-        pixels = (new_position - event->root_x);
-    else pixels = (new_position - event->root_y);
+    /* User cancelled the drag so no action should be taken (or, when
+     * resizing live, the original sizes need to be restored). */
+    if (drag_result == DRAG_REVERT) {
+        if (live)
+            resize_set_percent(&params, 0);
+        return 0;
+    }
 
+    int pixels = new_position - params.start_position;
     DLOG("Done, pixels = %d\n", pixels);
 
-    // if we got thus far, the containers must have
-    // percentages associated with them
-    assert(first->percent > 0.0);
-    assert(second->percent > 0.0);
-
-    // calculate the new percentage for the first container
-    double new_percent, difference;
-    double percent = first->percent;
-    DLOG("percent = %f\n", percent);
-    int original = (orientation == HORIZ ? first->rect.width : first->rect.height);
-    DLOG("original = %d\n", original);
-    new_percent = (original + pixels) * (percent / original);
-    difference = percent - new_percent;
-    DLOG("difference = %f\n", difference);
-    DLOG("new percent = %f\n", new_percent);
-    first->percent = new_percent;
-
-    // calculate the new percentage for the second container
-    double s_percent = second->percent;
-    second->percent = s_percent + difference;
-    DLOG("second->percent = %f\n", second->percent);
-
-    // now we must make sure that the sum of the percentages remain 1.0
-    con_fix_percent(first->parent);
+    resize_set_percent(&params, pixels);
 
     return 0;
 }
@@ -0,0 +1,426 @@
+#undef I3__FILE__
+#define I3__FILE__ "restart_layout.c"
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009-2013 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * restart_layout.c: Compact binary format for storing the layout during an
+ *                   inplace restart.
+ *
+ * The file is only ever read by the i3 process which we exec() into, so it
+ * uses the native byte order and struct layout. It contains the same
+ * information as the JSON dump (see dump_node()) which load_layout.c
+ * restores, but can be read without any parsing or string comparisons.
+ * User-facing layouts (append_layout) still use JSON.
+ *
+ */
+#include "all.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+
+#define RESTART_LAYOUT_MAGIC "i3RL"
+#define RESTART_LAYOUT_VERSION 1
+
+struct restart_layout_header {
+    char magic[4];
+    uint32_t version;
+    /* sizeof(struct restart_layout_node) of the writer, so that we don’t
+     * misinterpret files written by a differently compiled i3. */
+    uint32_t node_size;
+};
+
+/* Each container is stored as this struct, followed by its name,
+ * sticky_group and mark (without NUL byte, a length of UINT32_MAX means
+ * NULL), num_docks pairs of int32_t (dock, insert_where) for the
+ * dock swallows, num_focus uint32_t indices into the list of its
+ * children (tiling first, then floating) and finally its children. */
+struct restart_layout_node {
+    int32_t type;
+    int32_t layout;
+    int32_t last_split_layout;
+    int32_t workspace_layout;
+    int32_t border_style;
+    int32_t current_border_width;
+    int32_t floating;
+    int32_t scratchpad_state;
+    int32_t fullscreen_mode;
+    int32_t num;
+    /* The X11 window of this container, XCB_NONE if there is none. */
+    uint32_t window;
+    uint32_t depth;
+    Rect rect;
+    Rect window_rect;
+    Rect geometry;
+    double percent;
+    uint32_t focused;
+
+    uint32_t name_len;
+    uint32_t sticky_group_len;
+    uint32_t mark_len;
+    uint32_t num_docks;
+    uint32_t num_focus;
+    uint32_t num_nodes;
+    uint32_t num_floating;
+};
+
+struct layout_buffer {
+    char *data;
+    size_t length;
+    size_t capacity;
+};
+
+static void buffer_append(struct layout_buffer *buf, const void *data, size_t length) {
+    if (buf->length + length > buf->capacity) {
+        while (buf->length + length > buf->capacity)
+            buf->capacity = (buf->capacity == 0 ? 4096 : buf->capacity * 2);
+        buf->data = srealloc(buf->data, buf->capacity);
+    }
+    memcpy(buf->data + buf->length, data, length);
+    buf->length += length;
+}
+
+static void buffer_append_string(struct layout_buffer *buf, const char *str) {
+    if (str != NULL)
+        buffer_append(buf, str, strlen(str));
+}
+
+static uint32_t string_length(const char *str) {
+    return (str == NULL ? UINT32_MAX : strlen(str));
+}
+
+static void serialize_con(struct layout_buffer *buf, Con *con) {
+    struct restart_layout_node node;
+    memset(&node, 0, sizeof(struct restart_layout_node));
+
+    const char *name = con->name;
+    if (con->window && con->window->name)
+        name = i3string_as_utf8(con->window->name);
+
+    /* Like dump_node(), we don’t store the dock clients, they will be
+     * managed again. */
+    const bool dump_nodes = (con->type != CT_DOCKAREA);
+
+    node.type = con->type;
+    node.layout = con->layout;
+    node.last_split_layout = con->last_split_layout;
+    node.workspace_layout = con->workspace_layout;
+    node.border_style = con->border_style;
+    node.current_border_width = con->current_border_width;
+    node.floating = con->floating;
+    node.scratchpad_state = con->scratchpad_state;
+    node.fullscreen_mode = con->fullscreen_mode;
+    node.num = con->num;
+    node.window = (con->window ? con->window->id : XCB_NONE);
+    node.depth = con->depth;
+    node.rect = con->rect;
+    node.window_rect = con->window_rect;
+    node.geometry = con->geometry;
+    node.percent = con->percent;
+    node.focused = (con == focused);
+    node.name_len = string_length(name);
+    node.sticky_group_len = string_length(con->sticky_group);
+    node.mark_len = string_length(con->mark);
+
+    Match *match;
+    TAILQ_FOREACH(match, &(con->swallow_head), matches)
+        if (match->dock != -1)
+            node.num_docks++;
+
+    Con *child;
+    if (dump_nodes) {
+        TAILQ_FOREACH(child, &(con->nodes_head), nodes)
+            node.num_nodes++;
+        TAILQ_FOREACH(child, &(con->focus_head), focused)
+            node.num_focus++;
+    }
+    TAILQ_FOREACH(child, &(con->floating_head), floating_windows)
+        node.num_floating++;
+    if (!dump_nodes) {
+        /* Only the floating children are stored, so the focus order refers
+         * to them alone. */
+        TAILQ_FOREACH(child, &(con->focus_head), focused)
+            if (child->type == CT_FLOATING_CON)
+                node.num_focus++;
+    }
+
+    buffer_append(buf, &node, sizeof(struct restart_layout_node));
+    buffer_append_string(buf, name);
+    buffer_append_string(buf, con->sticky_group);
+    buffer_append_string(buf, con->mark);
+
+    TAILQ_FOREACH(match, &(con->swallow_head), matches) {
+        if (match->dock == -1)
+            continue;
+        int32_t dock[2] = { match->dock, match->insert_where };
+        buffer_append(buf, dock, sizeof(dock));
+    }
+
+    TAILQ_FOREACH(child, &(con->focus_head), focused) {
+        const bool floating = (child->type == CT_FLOATING_CON);
+        if (!dump_nodes && !floating)
+            continue;
+
+        uint32_t index = 0;
+        Con *current;
+        if (dump_nodes) {
+            TAILQ_FOREACH(current, &(con->nodes_head), nodes) {
+                if (current == child)
+                    break;
+                index++;
+            }
+        }
+        if (floating) {
+            TAILQ_FOREACH(current, &(con->floating_head), floating_windows) {
+                if (current == child)
+                    break;
+                index++;
+            }
+        }
+        buffer_append(buf, &index, sizeof(index));
+    }
+
+    if (dump_nodes) {
+        TAILQ_FOREACH(child, &(con->nodes_head), nodes)
+            serialize_con(buf, child);
+    }
+    TAILQ_FOREACH(child, &(con->floating_head), floating_windows)
+        serialize_con(buf, child);
+}
+
+/*
+ * Serializes the given container and all of its children into the binary
+ * restart format. Returns a buffer which has to be free()d by the caller and
+ * stores its length in *length.
+ *
+ */
+char *restart_layout_serialize(Con *con, size_t *length) {
+    struct layout_buffer buf = { NULL, 0, 0 };
+
+    struct restart_layout_header header;
+    memcpy(header.magic, RESTART_LAYOUT_MAGIC, sizeof(header.magic));
+    header.version = RESTART_LAYOUT_VERSION;
+    header.node_size = sizeof(struct restart_layout_node);
+    buffer_append(&buf, &header, sizeof(struct restart_layout_header));
+
+    serialize_con(&buf, con);
+
+    *length = buf.length;
+    return buf.data;
+}
+
+struct layout_reader {
+    const char *pos;
+    const char *end;
+    /* The container to focus once the layout is restored. */
+    Con *to_focus;
+};
+
+static bool reader_read(struct layout_reader *reader, void *data, size_t length) {
+    if ((size_t)(reader->end - reader->pos) < length)
+        return false;
+    if (data != NULL)
+        memcpy(data, reader->pos, length);
+    reader->pos += length;
+    return true;
+}
+
+static bool reader_read_string(struct layout_reader *reader, uint32_t length, char **str) {
+    if (length == UINT32_MAX)
+        return true;
+    const char *start = reader->pos;
+    if (!reader_read(reader, NULL, length))
+        return false;
+    if (str != NULL) {
+        *str = smalloc(length + 1);
+        memcpy(*str, start, length);
+        (*str)[length] = '\0';
+    }
+    return true;
+}
+
+/*
+ * Reads one container (and its children). If parent is NULL, the input is
+ * only checked for consistency. Otherwise, the containers are created and
+ * attached like tree_append_json() does, and the new container is stored in
+ * *result.
+ *
+ */
+static bool read_con(struct layout_reader *reader, Con *parent, bool floating, Con **result) {
+    struct restart_layout_node node;
+    if (!reader_read(reader, &node, sizeof(struct restart_layout_node)))
+        return false;
+
+    Con *con = NULL;
+    if (parent != NULL) {
+        con = con_new_skeleton(NULL, NULL);
+        con->parent = (floating ? con_get_workspace(parent) : parent);
+        con->type = node.type;
+        con->layout = node.layout;
+        con->last_split_layout = node.last_split_layout;
+        con->workspace_layout = node.workspace_layout;
+        con->border_style = node.border_style;
+        con->current_border_width = node.current_border_width;
+        con->floating = node.floating;
+        con->scratchpad_state = node.scratchpad_state;
+        scratchpad_index(con);
+        con_set_fullscreen_mode(con, node.fullscreen_mode);
+        con->num = node.num;
+        con->rect = node.rect;
+        con->window_rect = node.window_rect;
+        con->geometry = node.geometry;
+        con->percent = node.percent;
+        if (node.focused)
+            reader->to_focus = con;
+    }
+
+    char *mark = NULL;
+    if (!reader_read_string(reader, node.name_len, (con ? &(con->name) : NULL)) ||
+        !reader_read_string(reader, node.sticky_group_len, (con ? &(con->sticky_group) : NULL)) ||
+        !reader_read_string(reader, node.mark_len, (con ? &mark : NULL)))
+        return false;
+    if (con != NULL && con->sticky_group != NULL)
+        workspace_index_sticky(con);
+    if (mark != NULL) {
+        con_set_mark(con, mark);
+        free(mark);
+    }
+
+    for (uint32_t i = 0; i < node.num_docks; i++) {
+        int32_t dock[2];
+        if (!reader_read(reader, dock, sizeof(dock)))
+            return false;
+        if (con == NULL)
+            continue;
+        Match *match = pool_alloc(&match_pool);
+        match_init(match);
+        match->dock = dock[0];
+        match->insert_where = dock[1];
+        TAILQ_INSERT_TAIL(&(con->swallow_head), match, matches);
+        con_index_swallow(con, match);
+    }
+
+    if (con != NULL && node.window != XCB_NONE) {
+        /* The window will be swallowed by this container once it gets
+         * managed again. */
+        Match *match = pool_alloc(&match_pool);
+        match_init(match);
+        match->id = node.window;
+        match->restart_mode = true;
+        TAILQ_INSERT_TAIL(&(con->swallow_head), match, matches);
+        con_index_swallow(con, match);
+        con->depth = node.depth;
+    }
+
+    const uint32_t num_children = node.num_nodes + node.num_floating;
+    if (num_children < node.num_nodes)
+        return false;
+    if ((size_t)(reader->end - reader->pos) / sizeof(uint32_t) < node.num_focus)
+        return false;
+    uint32_t *focus = NULL;
+    if (node.num_focus > 0) {
+        focus = smalloc(node.num_focus * sizeof(uint32_t));
+        reader_read(reader, focus, node.num_focus * sizeof(uint32_t));
+    }
+
+    /* Every child takes at least the size of a node, so this also limits the
+     * allocation for bogus input. */
+    if ((size_t)(reader->end - reader->pos) / sizeof(struct restart_layout_node) < num_children) {
+        free(focus);
+        return false;
+    }
+    Con **children = (num_children > 0 ? smalloc(num_children * sizeof(Con*)) : NULL);
+    bool valid = true;
+    for (uint32_t i = 0; i < num_children && valid; i++)
+        valid = read_con(reader, con, (i >= node.num_nodes), &children[i]);
+
+    for (uint32_t i = 0; valid && i < node.num_focus; i++)
+        if (focus[i] >= num_children)
+            valid = false;
+
+    if (con != NULL) {
+        /* Move the children to the top of the focus list in reverse order,
+         * so that the first one ends up being focused. */
+        for (uint32_t i = node.num_focus; i-- > 0;) {
+            Con *child = children[focus[i]];
+            TAILQ_REMOVE(&(child->parent->focus_head), child, focused);
+            TAILQ_INSERT_HEAD(&(child->parent->focus_head), child, focused);
+        }
+
+        con_attach(con, con->parent, true);
+        x_con_init(con, con->depth);
+        *result = con;
+    }
+
+    free(children);
+    free(focus);
+    return valid;
+}
+
+/*
+ * Restores a layout which was stored by restart_layout_serialize() and
+ * attaches it to the focused container, like tree_append_json() does.
+ *
+ * Returns false if the file is not in the binary restart format (e.g.
+ * because it was written by an older version of i3 as JSON), in which case
+ * nothing was changed.
+ *
+ */
+bool restart_layout_load(const char *filename) {
+    int fd = open(filename, O_RDONLY);
+    if (fd == -1) {
+        LOG("Cannot open file \"%s\"\n", filename);
+        return false;
+    }
+
+    struct stat stbuf;
+    if (fstat(fd, &stbuf) != 0 || stbuf.st_size < (off_t)sizeof(struct restart_layout_header)) {
+        close(fd);
+        return false;
+    }
+
+    char *data = mmap(NULL, stbuf.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        LOG("Cannot mmap() \"%s\"\n", filename);
+        return false;
+    }
+
+    bool result = false;
+    struct restart_layout_header header;
+    memcpy(&header, data, sizeof(struct restart_layout_header));
+    if (memcmp(header.magic, RESTART_LAYOUT_MAGIC, sizeof(header.magic)) != 0)
+        goto out;
+
+    if (header.version != RESTART_LAYOUT_VERSION ||
+        header.node_size != sizeof(struct restart_layout_node)) {
+        ELOG("Restart layout \"%s\" has an unsupported format (version %d), not restoring\n",
+             filename, header.version);
+        goto out;
+    }
+
+    struct layout_reader reader;
+    reader.pos = data + sizeof(struct restart_layout_header);
+    reader.end = data + stbuf.st_size;
+    reader.to_focus = NULL;
+
+    /* Verify the whole file first, so that we never attach a partial
+     * layout. */
+    if (!read_con(&reader, NULL, false, NULL) || reader.pos != reader.end) {
+        ELOG("Restart layout \"%s\" is corrupt, not restoring\n", filename);
+        goto out;
+    }
+
+    reader.pos = data + sizeof(struct restart_layout_header);
+    Con *con;
+    read_con(&reader, focused, false, &con);
+    if (reader.to_focus)
+        con_focus(reader.to_focus);
+    result = true;
+
+out:
+    munmap(data, stbuf.st_size);
+    return result;
+}
@@ -11,6 +11,41 @@
  */
 #include "all.h"
 
+/* The containers whose scratchpad_state is not SCRATCHPAD_NONE (i.e. the
+ * floating containers of scratchpad windows), wherever they currently are.
+ * This way, scratchpad_show() does not need to walk all containers to find a
+ * scratchpad window which is visible on another workspace. */
+static TAILQ_HEAD(scratchpad_cons_head, Con) scratchpad_cons =
+    TAILQ_HEAD_INITIALIZER(scratchpad_cons);
+
+/*
+ * Adds the given container to (or removes it from) the list of scratchpad
+ * containers, depending on its scratchpad_state. Has to be called whenever
+ * the scratchpad_state is changed from or to SCRATCHPAD_NONE.
+ *
+ */
+void scratchpad_index(Con *con) {
+    const bool scratchpad = (con->scratchpad_state != SCRATCHPAD_NONE);
+    if (scratchpad == con->scratchpad_indexed)
+        return;
+    if (scratchpad)
+        TAILQ_INSERT_TAIL(&scratchpad_cons, con, scratchpad_cons);
+    else TAILQ_REMOVE(&scratchpad_cons, con, scratchpad_cons);
+    con->scratchpad_indexed = scratchpad;
+}
+
+/*
+ * Removes the given container from the list of scratchpad containers. Called
+ * by tree_close() before the container is freed.
+ *
+ */
+void scratchpad_unindex(Con *con) {
+    if (!con->scratchpad_indexed)
+        return;
+    TAILQ_REMOVE(&scratchpad_cons, con, scratchpad_cons);
+    con->scratchpad_indexed = false;
+}
+
 /*
  * Moves the specified window to the __i3_scratch workspace, making it floating
  * and setting the appropriate scratchpad_state.
@@ -73,6 +108,7 @@ void scratchpad_move(Con *con) {
             DLOG("It was in tiling mode before, set scratchpad state to fresh.\n");
             con->scratchpad_state = SCRATCHPAD_FRESH;
         }
+        scratchpad_index(con);
     }
 }
 
@@ -133,15 +169,17 @@ void scratchpad_show(Con *con) {
      * visible scratchpad window on another workspace. In this case we move it
      * to the current workspace. */
     focused_ws = con_get_workspace(focused);
-    TAILQ_FOREACH(walk_con, &all_cons, all_cons) {
+    TAILQ_FOREACH(walk_con, &scratchpad_cons, scratchpad_cons) {
+        if (con)
+            break;
         Con *walk_ws = con_get_workspace(walk_con);
-        if (!con && walk_ws &&
+        Con *child = TAILQ_FIRST(&(walk_con->nodes_head));
+        if (walk_ws && child &&
             !con_is_internal(walk_ws) && focused_ws != walk_ws &&
-            (floating = con_inside_floating(walk_con)) &&
-            floating->scratchpad_state != SCRATCHPAD_NONE) {
+            con_inside_floating(walk_con)) {
             DLOG("Found a visible scratchpad window on another workspace,\n");
-            DLOG("moving it to this workspace: con = %p\n", walk_con);
-            con_move_to_workspace(walk_con, focused_ws, true, false);
+            DLOG("moving it to this workspace: con = %p\n", child);
+            con_move_to_workspace(child, focused_ws, true, false);
             return;
         }
     }
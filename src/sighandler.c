@@ -8,7 +8,8 @@
  * © 2009-2010 Jan-Erik Rediger
  *
  * sighandler.c: Interactive crash dialog upon SIGSEGV/SIGABRT/SIGFPE (offers
- *               to restart inplace).
+ *               to restart inplace), or (with --crash-restart) an immediate
+ *               inplace restart after saving a backtrace.
  *
  */
 #include "all.h"
@@ -16,6 +17,8 @@
 #include <ev.h>
 #include <iconv.h>
 #include <signal.h>
+#include <execinfo.h>
+#include <fcntl.h>
 #include <sys/wait.h>
 
 #include <xcb/xcb_event.h>
@@ -40,27 +43,109 @@ static int crash_text_longest = 5;
 static int backtrace_string_index = 3;
 static int backtrace_done = 0;
 
+/* If true, a crash does not open the crash dialog. Instead, the backtrace is
+ * written to stderr and to crash_backtrace_path and i3 restarts inplace right
+ * away. Set by --crash-restart. */
+bool crash_restart = false;
+
+/* Crashes within this many seconds after starting are not handled by
+ * restarting, to not end up in a restart loop. */
+#define CRASH_RESTART_MIN_UPTIME 10
+
+/* Maximum number of stack frames in the backtrace of crash_restart. */
+#define CRASH_BACKTRACE_FRAMES 64
+
+/* Determined when setting up the signal handler, since the signal handler
+ * cannot allocate memory. */
+static char *crash_backtrace_path;
+static time_t signal_handler_setup_time;
+
 /*
- * Attach gdb to pid_parent and dump a backtrace to i3-backtrace.$pid in the
- * tmpdir
+ * Returns a unique filename for a backtrace in the tmpdir (since the PID of
+ * i3 stays the same across restarts), so that we don’t overwrite earlier
+ * backtraces.
+ *
  */
-static int backtrace(void) {
+static char *backtrace_filename(void) {
     char *tmpdir = getenv("TMPDIR");
     if (tmpdir == NULL)
         tmpdir = "/tmp";
 
-    pid_t pid_parent = getpid();
-
     char *filename = NULL;
     int suffix = 0;
     struct stat bt;
-    /* Find a unique filename for the backtrace (since the PID of i3 stays the
-     * same), so that we don’t overwrite earlier backtraces. */
     do {
         FREE(filename);
-        sasprintf(&filename, "%s/i3-backtrace.%d.%d.txt", tmpdir, pid_parent, suffix);
+        sasprintf(&filename, "%s/i3-backtrace.%d.%d.txt", tmpdir, getpid(), suffix);
         suffix++;
     } while (stat(filename, &bt) == 0);
+    return filename;
+}
+
+/*
+ * Writes the string to fd (and ignores errors, there is nothing we could do
+ * about them while crashing).
+ *
+ */
+static void write_str(int fd, const char *str) {
+    size_t len = strlen(str);
+    while (len > 0) {
+        ssize_t n = write(fd, str, len);
+        if (n <= 0)
+            return;
+        str += n;
+        len -= n;
+    }
+}
+
+/*
+ * Writes the backtrace of the crash to stderr and to crash_backtrace_path.
+ * Called in the signal handler, so this only uses async-signal-safe functions
+ * (backtrace() and backtrace_symbols_fd() do not allocate memory once libgcc
+ * is loaded, see setup_signal_handler()). The addresses can be resolved
+ * later, e.g. with addr2line -e i3.
+ *
+ */
+static void write_crash_backtrace(int sig) {
+    void *frames[CRASH_BACKTRACE_FRAMES];
+    int frame_count = backtrace(frames, CRASH_BACKTRACE_FRAMES);
+
+    /* Format the signal number without snprintf(), which is not
+     * async-signal-safe. */
+    char signum[16];
+    char *p = signum + sizeof(signum) - 1;
+    *p = '\0';
+    do {
+        *--p = '0' + (sig % 10);
+        sig /= 10;
+    } while (sig > 0 && p > signum);
+
+    int fd = open(crash_backtrace_path, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+    int fds[] = { STDERR_FILENO, fd };
+    for (size_t i = 0; i < sizeof(fds) / sizeof(fds[0]); i++) {
+        if (fds[i] == -1)
+            continue;
+        write_str(fds[i], "i3 crashed with signal ");
+        write_str(fds[i], p);
+        write_str(fds[i], ", restarting inplace. Backtrace:\n");
+        backtrace_symbols_fd(frames, frame_count, fds[i]);
+    }
+    if (fd != -1) {
+        close(fd);
+        write_str(STDERR_FILENO, "The backtrace was saved to ");
+        write_str(STDERR_FILENO, crash_backtrace_path);
+        write_str(STDERR_FILENO, "\n");
+    }
+}
+
+/*
+ * Attach gdb to pid_parent and dump a backtrace to i3-backtrace.$pid in the
+ * tmpdir
+ */
+static int gdb_backtrace(void) {
+    pid_t pid_parent = getpid();
+    char *filename = backtrace_filename();
+    struct stat bt;
 
     pid_t pid_gdb = fork();
     if (pid_gdb < 0) {
@@ -184,7 +269,7 @@ static int sig_handle_key_press(void *ignored, xcb_connection_t *conn, xcb_key_p
 
         /* fork and exec/attach GDB to the parent to get a backtrace in the
          * tmpdir */
-        backtrace_done = backtrace();
+        backtrace_done = gdb_backtrace();
 
         /* re-open the windows to indicate that it's finished */
         open_popups();
@@ -292,6 +377,12 @@ void handle_signal(int sig, siginfo_t *info, void *data) {
     sigaction(sig, &action, NULL);
     raised_signal = sig;
 
+    if (crash_restart && time(NULL) - signal_handler_setup_time >= CRASH_RESTART_MIN_UPTIME) {
+        write_crash_backtrace(sig);
+        i3_restart(false);
+        /* Only reached if the restart failed. */
+    }
+
     open_popups();
 
     xcb_generic_event_t *event;
@@ -313,6 +404,15 @@ void handle_signal(int sig, siginfo_t *info, void *data) {
 void setup_signal_handler(void) {
     struct sigaction action;
 
+    if (crash_restart) {
+        crash_backtrace_path = backtrace_filename();
+        signal_handler_setup_time = time(NULL);
+        /* The first call loads libgcc (which allocates memory), so it must
+         * not happen in the signal handler. */
+        void *frame;
+        backtrace(&frame, 1);
+    }
+
     action.sa_sigaction = handle_signal;
     action.sa_flags = SA_NODEFER | SA_RESETHAND | SA_SIGINFO;
     sigemptyset(&action.sa_mask);
@@ -22,8 +22,46 @@
 #define SN_API_NOT_YET_FROZEN 1
 #include <libsn/sn-launcher.h>
 
-static TAILQ_HEAD(startup_sequence_head, Startup_Sequence) startup_sequences =
-    TAILQ_HEAD_INITIALIZER(startup_sequences);
+/* All startup sequences, hashed by their id. */
+#define SEQUENCE_BUCKETS 64
+static LIST_HEAD(sequence_head, Startup_Sequence) sequence_buckets[SEQUENCE_BUCKETS];
+
+/* The completed sequences, ordered by delete_at (which is always 30 seconds
+ * after completion). prune_timer fires when the first one is due. */
+static TAILQ_HEAD(completed_head, Startup_Sequence) completed_sequences =
+    TAILQ_HEAD_INITIALIZER(completed_sequences);
+static ev_timer prune_timer;
+
+/* The number of sequences which are not completed yet (delete_at == 0). This
+ * is used for changing the root window cursor. */
+static int active_sequences;
+
+static struct memory_stats sequence_memory = MEMORY_STATS_INITIALIZER("Startup_Sequence");
+
+static size_t sequence_bytes(struct Startup_Sequence *sequence) {
+    return sizeof(struct Startup_Sequence) + strlen(sequence->id) + 1 +
+           strlen(sequence->workspace) + 1;
+}
+
+static struct sequence_head *sequence_bucket(const char *id) {
+    unsigned int hash = 5381;
+    for (const char *c = id; *c != '\0'; c++)
+        hash = ((hash << 5) + hash) + (unsigned char)*c;
+    return &sequence_buckets[hash % SEQUENCE_BUCKETS];
+}
+
+/*
+ * Returns the startup sequence with the given id or NULL.
+ *
+ */
+static struct Startup_Sequence *startup_sequence_by_id(const char *id) {
+    struct Startup_Sequence *sequence;
+    LIST_FOREACH(sequence, sequence_bucket(id), by_id) {
+        if (strcmp(sequence->id, id) == 0)
+            return sequence;
+    }
+    return NULL;
+}
 
 /*
  * After 60 seconds, a timeout will be triggered for each startup sequence.
@@ -36,20 +74,14 @@ static void startup_timeout(EV_P_ ev_timer *w, int revents) {
     const char *id = sn_launcher_context_get_startup_id(w->data);
     DLOG("Timeout for startup sequence %s\n", id);
 
-    struct Startup_Sequence *current, *sequence = NULL;
-    TAILQ_FOREACH(current, &startup_sequences, sequences) {
-        if (strcmp(current->id, id) != 0)
-            continue;
-
-        sequence = current;
-        break;
-    }
+    struct Startup_Sequence *sequence = startup_sequence_by_id(id);
 
     /* Unref the context (for the timeout itself, see start_application) */
     sn_launcher_context_unref(w->data);
 
     if (!sequence) {
         DLOG("Sequence already deleted, nevermind.\n");
+        free(w);
         return;
     }
 
@@ -62,39 +94,44 @@ static void startup_timeout(EV_P_ ev_timer *w, int revents) {
  * Some applications (such as Firefox) mark a startup sequence as completed
  * *before* they even map a window. Therefore, we cannot entirely delete the
  * startup sequence once it’s marked as complete. Instead, we’ll mark it for
- * deletion in 30 seconds and use that chance to delete old sequences.
- *
- * This function returns the number of active (!) startup notifications, that
- * is, those which are not marked for deletion yet. This is used for changing
- * the root window cursor.
+ * deletion in 30 seconds: prune_timer deletes the completed sequences once
+ * they are due, looking only at the ones which are.
  *
  */
-static int _prune_startup_sequences(void) {
+static void prune_startup_sequences(EV_P_ ev_timer *w, int revents) {
     time_t current_time = time(NULL);
-    int active_sequences = 0;
-
-    /* Traverse the list and delete everything which was marked for deletion 30
-     * seconds ago or earlier. */
-    struct Startup_Sequence *current, *next;
-    for (next = TAILQ_FIRST(&startup_sequences);
-         next != TAILQ_END(&startup_sequences);
-         ) {
-        current = next;
-        next = TAILQ_NEXT(next, sequences);
-
-        if (current->delete_at == 0) {
-            active_sequences++;
-            continue;
-        }
 
-        if (current_time <= current->delete_at)
-            continue;
+    /* Delete everything which was marked for deletion 30 seconds ago or
+     * earlier. */
+    struct Startup_Sequence *first;
+    while ((first = TAILQ_FIRST(&completed_sequences)) != NULL &&
+           current_time > first->delete_at)
+        startup_sequence_delete(first);
 
-        startup_sequence_delete(current);
+    if (first != NULL) {
+        ev_timer_set(&prune_timer, first->delete_at + 1 - current_time, 0.);
+        ev_timer_start(main_loop, &prune_timer);
     }
+}
 
-    return active_sequences;
-
+/*
+ * Marks the given sequence as completed, to be deleted in 30 seconds.
+ *
+ */
+static void startup_sequence_complete(struct Startup_Sequence *sequence) {
+    if (sequence->delete_at == 0)
+        active_sequences--;
+    else TAILQ_REMOVE(&completed_sequences, sequence, completed);
+
+    sequence->delete_at = time(NULL) + 30;
+    TAILQ_INSERT_TAIL(&completed_sequences, sequence, completed);
+    DLOG("Will delete startup sequence %s at timestamp %ld\n",
+         sequence->id, sequence->delete_at);
+
+    if (!ev_is_active(&prune_timer)) {
+        ev_timer_init(&prune_timer, prune_startup_sequences, 31., 0.);
+        ev_timer_start(main_loop, &prune_timer);
+    }
 }
 
 /**
@@ -112,8 +149,12 @@ void startup_sequence_delete(struct Startup_Sequence *sequence) {
     sn_launcher_context_unref(sequence->context);
 
     /* Delete our internal sequence */
-    TAILQ_REMOVE(&startup_sequences, sequence, sequences);
+    LIST_REMOVE(sequence, by_id);
+    if (sequence->delete_at == 0)
+        active_sequences--;
+    else TAILQ_REMOVE(&completed_sequences, sequence, completed);
 
+    memory_stats_free(&sequence_memory, sequence_bytes(sequence));
     free(sequence->id);
     free(sequence->workspace);
     FREE(sequence);
@@ -165,7 +206,9 @@ void start_application(const char *command, bool no_startup_id) {
         sequence->id = sstrdup(sn_launcher_context_get_startup_id(context));
         sequence->workspace = sstrdup(ws->name);
         sequence->context = context;
-        TAILQ_INSERT_TAIL(&startup_sequences, sequence, sequences);
+        memory_stats_alloc(&sequence_memory, sequence_bytes(sequence));
+        LIST_INSERT_HEAD(sequence_bucket(sequence->id), sequence, by_id);
+        active_sequences++;
 
         /* Increase the refcount once (it starts with 1, so it will be 2 now) for
          * the timeout. Even if the sequence gets completed, the timeout still
@@ -218,14 +261,7 @@ void startup_monitor_event(SnMonitorEvent *event, void *userdata) {
 
     /* Get the corresponding internal startup sequence */
     const char *id = sn_startup_sequence_get_id(snsequence);
-    struct Startup_Sequence *current, *sequence = NULL;
-    TAILQ_FOREACH(current, &startup_sequences, sequences) {
-        if (strcmp(current->id, id) != 0)
-            continue;
-
-        sequence = current;
-        break;
-    }
+    struct Startup_Sequence *sequence = startup_sequence_by_id(id);
 
     if (!sequence) {
         DLOG("Got event for startup sequence that we did not initiate (ID = %s). Ignoring.\n", id);
@@ -237,12 +273,9 @@ void startup_monitor_event(SnMonitorEvent *event, void *userdata) {
             DLOG("startup sequence %s completed\n", sn_startup_sequence_get_id(snsequence));
 
             /* Mark the given sequence for deletion in 30 seconds. */
-            time_t current_time = time(NULL);
-            sequence->delete_at = current_time + 30;
-            DLOG("Will delete startup sequence %s at timestamp %ld\n",
-                 sequence->id, sequence->delete_at);
+            startup_sequence_complete(sequence);
 
-            if (_prune_startup_sequences() == 0) {
+            if (active_sequences == 0) {
                 DLOG("No more startup sequences running, changing root window cursor to default pointer.\n");
                 /* Change the pointer of the root window to indicate progress */
                 if (xcursor_supported)
@@ -307,14 +340,7 @@ struct Startup_Sequence *startup_sequence_get(i3Window *cwindow,
         return NULL;
     }
 
-    struct Startup_Sequence *current, *sequence = NULL;
-    TAILQ_FOREACH(current, &startup_sequences, sequences) {
-        if (strcmp(current->id, startup_id) != 0)
-            continue;
-
-        sequence = current;
-        break;
-    }
+    struct Startup_Sequence *sequence = startup_sequence_by_id(startup_id);
 
     if (!sequence) {
         DLOG("WARNING: This sequence (ID %s) was not found\n", startup_id);
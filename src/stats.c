@@ -0,0 +1,211 @@
+#undef I3__FILE__
+#define I3__FILE__ "stats.c"
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009-2013 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * stats.c: Latency histograms for event handlers, IPC messages, commands and
+ *          rendering.
+ *
+ * The histograms are cheap enough to be always enabled: recording a duration
+ * costs two clock_gettime() calls (which are handled in userspace via the
+ * vDSO on Linux) and a few additions. They are available via GET_STATS.
+ *
+ */
+#include "all.h"
+
+#include <time.h>
+
+struct all_stats_head all_stats = TAILQ_HEAD_INITIALIZER(all_stats);
+
+struct latency_stats stats_tree_render = { "render", "tree_render" };
+struct latency_stats stats_render_con = { "render", "render_con" };
+struct latency_stats stats_x_push_changes = { "render", "x_push_changes" };
+
+/* X11 event types are 7 bit, the most significant bit of response_type only
+ * indicates that the event was generated by SendEvent. */
+static struct latency_stats *event_stats[128];
+static struct latency_stats *ipc_stats[32];
+
+static const char command_category[] = "command";
+
+/* Names of the core events, see xproto.h. */
+static const char *event_names[] = {
+    [XCB_KEY_PRESS] = "KeyPress",
+    [XCB_KEY_RELEASE] = "KeyRelease",
+    [XCB_BUTTON_PRESS] = "ButtonPress",
+    [XCB_BUTTON_RELEASE] = "ButtonRelease",
+    [XCB_MOTION_NOTIFY] = "MotionNotify",
+    [XCB_ENTER_NOTIFY] = "EnterNotify",
+    [XCB_LEAVE_NOTIFY] = "LeaveNotify",
+    [XCB_FOCUS_IN] = "FocusIn",
+    [XCB_FOCUS_OUT] = "FocusOut",
+    [XCB_KEYMAP_NOTIFY] = "KeymapNotify",
+    [XCB_EXPOSE] = "Expose",
+    [XCB_GRAPHICS_EXPOSURE] = "GraphicsExposure",
+    [XCB_NO_EXPOSURE] = "NoExposure",
+    [XCB_VISIBILITY_NOTIFY] = "VisibilityNotify",
+    [XCB_CREATE_NOTIFY] = "CreateNotify",
+    [XCB_DESTROY_NOTIFY] = "DestroyNotify",
+    [XCB_UNMAP_NOTIFY] = "UnmapNotify",
+    [XCB_MAP_NOTIFY] = "MapNotify",
+    [XCB_MAP_REQUEST] = "MapRequest",
+    [XCB_REPARENT_NOTIFY] = "ReparentNotify",
+    [XCB_CONFIGURE_NOTIFY] = "ConfigureNotify",
+    [XCB_CONFIGURE_REQUEST] = "ConfigureRequest",
+    [XCB_GRAVITY_NOTIFY] = "GravityNotify",
+    [XCB_RESIZE_REQUEST] = "ResizeRequest",
+    [XCB_CIRCULATE_NOTIFY] = "CirculateNotify",
+    [XCB_CIRCULATE_REQUEST] = "CirculateRequest",
+    [XCB_PROPERTY_NOTIFY] = "PropertyNotify",
+    [XCB_SELECTION_CLEAR] = "SelectionClear",
+    [XCB_SELECTION_REQUEST] = "SelectionRequest",
+    [XCB_SELECTION_NOTIFY] = "SelectionNotify",
+    [XCB_COLORMAP_NOTIFY] = "ColormapNotify",
+    [XCB_CLIENT_MESSAGE] = "ClientMessage",
+    [XCB_MAPPING_NOTIFY] = "MappingNotify",
+};
+
+static const char *ipc_names[] = {
+    [I3_IPC_MESSAGE_TYPE_COMMAND] = "COMMAND",
+    [I3_IPC_MESSAGE_TYPE_GET_WORKSPACES] = "GET_WORKSPACES",
+    [I3_IPC_MESSAGE_TYPE_SUBSCRIBE] = "SUBSCRIBE",
+    [I3_IPC_MESSAGE_TYPE_GET_OUTPUTS] = "GET_OUTPUTS",
+    [I3_IPC_MESSAGE_TYPE_GET_TREE] = "GET_TREE",
+    [I3_IPC_MESSAGE_TYPE_GET_MARKS] = "GET_MARKS",
+    [I3_IPC_MESSAGE_TYPE_GET_BAR_CONFIG] = "GET_BAR_CONFIG",
+    [I3_IPC_MESSAGE_TYPE_GET_VERSION] = "GET_VERSION",
+    [I3_IPC_MESSAGE_TYPE_GET_TREE_DELTA] = "GET_TREE_DELTA",
+    [I3_IPC_MESSAGE_TYPE_GET_POOL_STATS] = "GET_POOL_STATS",
+    [I3_IPC_MESSAGE_TYPE_GET_STATS] = "GET_STATS",
+    [I3_IPC_MESSAGE_TYPE_SET_ENCODING] = "SET_ENCODING",
+    [I3_IPC_MESSAGE_TYPE_GET_MEMORY] = "GET_MEMORY",
+};
+
+/*
+ * Returns the current value of the monotonic clock in nanoseconds. Pass the
+ * value to stats_record() once the work is done.
+ *
+ */
+uint64_t stats_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/*
+ * Adds the time which passed since start (a stats_now() value) to the given
+ * statistics.
+ *
+ */
+void stats_record(struct latency_stats *stats, uint64_t start) {
+    uint64_t now = stats_now();
+    uint64_t duration = now - start;
+
+    if (tracing)
+        trace_add(stats->category, stats->name, start, now);
+
+    if (!stats->registered) {
+        TAILQ_INSERT_TAIL(&all_stats, stats, all_stats);
+        stats->registered = true;
+    }
+
+    stats->count++;
+    stats->total_ns += duration;
+    if (duration > stats->max_ns)
+        stats->max_ns = duration;
+
+    int bucket = 0;
+    for (uint64_t us = duration / 1000; us > 1 && bucket < STATS_BUCKETS - 1; us >>= 1)
+        bucket++;
+    stats->buckets[bucket]++;
+}
+
+static struct latency_stats *stats_new(const char *category, const char *name) {
+    struct latency_stats *stats = scalloc(sizeof(struct latency_stats));
+    stats->category = category;
+    stats->name = name;
+    return stats;
+}
+
+/*
+ * Returns the statistics for the X11 event of the given type.
+ *
+ */
+struct latency_stats *stats_for_event(int type) {
+    type &= 0x7F;
+    if (event_stats[type] != NULL)
+        return event_stats[type];
+
+    const char *name;
+    char *number = NULL;
+    if ((size_t)type < sizeof(event_names) / sizeof(event_names[0]) &&
+        event_names[type] != NULL)
+        name = event_names[type];
+    else {
+        /* Extension events (e.g. RandR) are identified by their number. */
+        sasprintf(&number, "%d", type);
+        name = number;
+    }
+
+    return (event_stats[type] = stats_new("event", name));
+}
+
+/*
+ * Returns the statistics for the IPC message of the given type.
+ *
+ */
+struct latency_stats *stats_for_ipc(uint32_t type) {
+    assert(type < sizeof(ipc_stats) / sizeof(ipc_stats[0]));
+    if (ipc_stats[type] != NULL)
+        return ipc_stats[type];
+
+    const char *name;
+    char *number = NULL;
+    if (type < sizeof(ipc_names) / sizeof(ipc_names[0]) &&
+        ipc_names[type] != NULL)
+        name = ipc_names[type];
+    else {
+        sasprintf(&number, "%d", type);
+        name = number;
+    }
+
+    return (ipc_stats[type] = stats_new("ipc", name));
+}
+
+/*
+ * Returns the statistics for the given command, identified by the name of
+ * the function implementing it.
+ *
+ */
+struct latency_stats *stats_for_command(const char *name) {
+    /* There are only a few dozen commands, so searching the list of all
+     * statistics is good enough. This is why command statistics are put on
+     * the list right away instead of when they are first recorded. */
+    struct latency_stats *stats;
+    TAILQ_FOREACH(stats, &all_stats, all_stats) {
+        if (stats->category == command_category && strcmp(stats->name, name) == 0)
+            return stats;
+    }
+
+    stats = stats_new(command_category, name);
+    stats->registered = true;
+    TAILQ_INSERT_TAIL(&all_stats, stats, all_stats);
+    return stats;
+}
+
+/*
+ * Clears all statistics.
+ *
+ */
+void stats_reset(void) {
+    struct latency_stats *stats;
+    TAILQ_FOREACH(stats, &all_stats, all_stats) {
+        stats->count = 0;
+        stats->total_ns = 0;
+        stats->max_ns = 0;
+        memset(stats->buckets, 0, sizeof(stats->buckets));
+    }
+}
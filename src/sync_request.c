@@ -0,0 +1,227 @@
+#undef I3__FILE__
+#define I3__FILE__ "sync_request.c"
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009-2013 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * sync_request.c: Implements _NET_WM_SYNC_REQUEST, which lets i3 wait until a
+ *                 client has redrawn itself in the size it was given before
+ *                 sending it the next one.
+ *
+ * Clients which support the protocol list _NET_WM_SYNC_REQUEST in their
+ * WM_PROTOCOLS and set _NET_WM_SYNC_REQUEST_COUNTER to an XSync counter.
+ * Before resizing such a window, i3 sends it a ClientMessage with the next
+ * value of a sequence. The client sets its counter to that value once it has
+ * handled the resize, which triggers an alarm i3 created on the counter.
+ * While waiting for the alarm, x_push_node() does not send new sizes to the
+ * client, so that during interactive resizing a slow client only gets to
+ * see (and draw) the most recent size.
+ *
+ */
+#include "all.h"
+
+#include <inttypes.h>
+
+/* How long to wait for a client to update its counter. Afterwards, the
+ * window is resized without waiting, so that hung clients do not keep their
+ * old size forever. */
+#define SYNC_REQUEST_TIMEOUT 250000000ULL /* ns */
+
+static bool sync_supported = false;
+
+/* Re-renders once a window whose new size was held back timed out. */
+static ev_timer sync_timer;
+
+static uint64_t sync_int64(xcb_sync_int64_t value) {
+    return ((uint64_t)(uint32_t)value.hi << 32) | value.lo;
+}
+
+/*
+ * Initializes the XSync extension. Sets event_base to the first event of the
+ * extension, or leaves it untouched if the X server does not support it (in
+ * which case windows are resized without synchronization).
+ *
+ */
+void sync_request_init(int *event_base) {
+    const xcb_query_extension_reply_t *extreply = xcb_get_extension_data(conn, &xcb_sync_id);
+    if (extreply == NULL || !extreply->present) {
+        DLOG("XSync is not present, windows will be resized without _NET_WM_SYNC_REQUEST\n");
+        return;
+    }
+
+    /* The extension has to be initialized before any other request. */
+    xcb_sync_initialize_reply_t *reply = xcb_sync_initialize_reply(conn, xcb_sync_initialize(conn, 3, 1), NULL);
+    if (reply == NULL) {
+        ELOG("Could not initialize XSync, windows will be resized without _NET_WM_SYNC_REQUEST\n");
+        return;
+    }
+    DLOG("XSync %d.%d\n", reply->major_version, reply->minor_version);
+    free(reply);
+
+    sync_supported = true;
+    if (event_base != NULL)
+        *event_base = extreply->first_event;
+}
+
+static void sync_timer_cb(EV_P_ ev_timer *w, int revents) {
+    uint64_t now = stats_now();
+    uint64_t next = 0;
+    bool render = false;
+
+    Con *con;
+    TAILQ_FOREACH(con, &all_cons, all_cons) {
+        i3Window *win = con->window;
+        if (win == NULL || win->sync_sent == 0)
+            continue;
+
+        if (now - win->sync_sent >= SYNC_REQUEST_TIMEOUT) {
+            render |= win->sync_deferred;
+            continue;
+        }
+
+        uint64_t remaining = SYNC_REQUEST_TIMEOUT - (now - win->sync_sent);
+        if (next == 0 || remaining < next)
+            next = remaining;
+    }
+
+    if (next > 0) {
+        ev_timer_set(&sync_timer, next / 1e9, 0.);
+        ev_timer_start(main_loop, &sync_timer);
+    }
+
+    /* sync_request_pending() notices the timeout and lets the new size
+     * through. */
+    if (render)
+        tree_render();
+}
+
+/*
+ * Returns true if the window was sent a _NET_WM_SYNC_REQUEST which it did not
+ * acknowledge yet. Its next size has to be held back until it does (or until
+ * it timed out). The window is rendered again once that happened.
+ *
+ */
+bool sync_request_pending(i3Window *win) {
+    if (win->sync_sent == 0)
+        return false;
+
+    if (stats_now() - win->sync_sent >= SYNC_REQUEST_TIMEOUT) {
+        DLOG("Window 0x%08x did not acknowledge _NET_WM_SYNC_REQUEST %" PRIu64 " in time\n",
+             win->id, win->sync_value);
+        win->sync_sent = 0;
+        win->sync_deferred = false;
+        return false;
+    }
+
+    win->sync_deferred = true;
+    return true;
+}
+
+/*
+ * Sends a _NET_WM_SYNC_REQUEST to the window if it supports the protocol. Has
+ * to be called right before resizing the window.
+ *
+ */
+void sync_request_send(i3Window *win) {
+    if (!sync_supported || win->sync_counter == XCB_NONE)
+        return;
+
+    win->sync_value++;
+    uint32_t hi = (uint32_t)(win->sync_value >> 32);
+    uint32_t lo = (uint32_t)win->sync_value;
+
+    /* The alarm is inactive after it triggered (its delta is 0), changing its
+     * value makes it wait for the new one. */
+    if (win->sync_alarm == XCB_NONE) {
+        win->sync_alarm = xcb_generate_id(conn);
+        uint32_t values[] = {
+            win->sync_counter,
+            XCB_SYNC_VALUETYPE_ABSOLUTE,
+            hi, lo,
+            XCB_SYNC_TESTTYPE_POSITIVE_COMPARISON,
+            0, 0, /* delta */
+            1     /* events */
+        };
+        xcb_sync_create_alarm(conn, win->sync_alarm,
+                              XCB_SYNC_CA_COUNTER | XCB_SYNC_CA_VALUE_TYPE | XCB_SYNC_CA_VALUE |
+                              XCB_SYNC_CA_TEST_TYPE | XCB_SYNC_CA_DELTA | XCB_SYNC_CA_EVENTS,
+                              values);
+    } else {
+        uint32_t values[] = { hi, lo };
+        xcb_sync_change_alarm(conn, win->sync_alarm, XCB_SYNC_CA_VALUE, values);
+    }
+
+    /* Every X11 event is 32 bytes long. Therefore, XCB will copy 32 bytes.
+     * In order to properly initialize these bytes, we allocate 32 bytes even
+     * though we only need less for an xcb_client_message_event_t */
+    void *event = scalloc(32);
+    xcb_client_message_event_t *ev = event;
+
+    ev->response_type = XCB_CLIENT_MESSAGE;
+    ev->window = win->id;
+    ev->type = A_WM_PROTOCOLS;
+    ev->format = 32;
+    ev->data.data32[0] = A__NET_WM_SYNC_REQUEST;
+    ev->data.data32[1] = last_timestamp;
+    ev->data.data32[2] = lo;
+    ev->data.data32[3] = hi;
+
+    DLOG("Sending _NET_WM_SYNC_REQUEST %" PRIu64 " to window 0x%08x\n", win->sync_value, win->id);
+    xcb_send_event(conn, false, win->id, XCB_EVENT_MASK_NO_EVENT, (char*)ev);
+    free(event);
+
+    win->sync_sent = stats_now();
+    win->sync_deferred = false;
+
+    if (!ev_is_active(&sync_timer)) {
+        ev_timer_init(&sync_timer, sync_timer_cb, SYNC_REQUEST_TIMEOUT / 1e9, 0.);
+        ev_timer_start(main_loop, &sync_timer);
+    }
+}
+
+/*
+ * Handles the AlarmNotify which is generated once a client updated its sync
+ * counter, i.e. after it has redrawn itself in the new size.
+ *
+ */
+void sync_request_handle_alarm(xcb_sync_alarm_notify_event_t *event) {
+    Con *con;
+    TAILQ_FOREACH(con, &all_cons, all_cons) {
+        if (con->window != NULL && con->window->sync_alarm == event->alarm)
+            break;
+    }
+    if (con == NULL) {
+        DLOG("AlarmNotify for unknown alarm 0x%08x\n", event->alarm);
+        return;
+    }
+
+    i3Window *win = con->window;
+    uint64_t value = sync_int64(event->counter_value);
+    DLOG("Window 0x%08x set its sync counter to %" PRIu64 "\n", win->id, value);
+
+    /* The counter might already be ahead of our sequence, e.g. after an
+     * inplace restart. The next request has to use a greater value. */
+    if (value > win->sync_value)
+        win->sync_value = value;
+    if (value < win->sync_value || win->sync_sent == 0)
+        return;
+
+    win->sync_sent = 0;
+    if (win->sync_deferred) {
+        win->sync_deferred = false;
+        tree_render();
+    }
+}
+
+/*
+ * Frees the resources used for synchronizing with the window. Called before
+ * the window is freed.
+ *
+ */
+void sync_request_free(i3Window *win) {
+    if (win->sync_alarm != XCB_NONE)
+        xcb_sync_destroy_alarm(conn, win->sync_alarm);
+    win->sync_alarm = XCB_NONE;
+}
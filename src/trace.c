@@ -0,0 +1,130 @@
+#undef I3__FILE__
+#define I3__FILE__ "trace.c"
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009-2013 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * trace.c: Records spans of the event loop into a ring buffer and writes
+ *          them in the Chrome trace event format.
+ *
+ * Every duration which is recorded for the statistics (see stats.c) is also
+ * recorded as a span while tracing is enabled, as are the event loop
+ * callbacks in main.c. Once the buffer is full, the oldest spans are
+ * overwritten, so a trace always covers the most recent TRACE_SPANS spans.
+ *
+ */
+#include "all.h"
+
+#include <inttypes.h>
+
+#define TRACE_SPANS 65536
+
+struct span {
+    const char *category;
+    const char *name;
+    uint64_t start;
+    uint64_t end;
+};
+
+bool tracing = false;
+
+static struct span *spans;
+/* Total number of spans recorded since tracing was enabled. The next span is
+ * stored at index (recorded % TRACE_SPANS). */
+static uint64_t recorded;
+
+/*
+ * Enables or disables recording spans. Enabling discards the previously
+ * recorded spans.
+ *
+ */
+void set_tracing(bool enabled) {
+    if (enabled && !tracing) {
+        /* The buffer is kept after disabling tracing so that the spans can
+         * still be dumped. */
+        if (spans == NULL)
+            spans = smalloc(TRACE_SPANS * sizeof(struct span));
+        recorded = 0;
+    }
+    tracing = enabled;
+}
+
+/*
+ * Records a span which started at start and ended at end (both stats_now()
+ * values). Does nothing unless tracing is enabled.
+ *
+ */
+void trace_add(const char *category, const char *name, uint64_t start, uint64_t end) {
+    if (!tracing)
+        return;
+
+    struct span *span = &spans[recorded++ % TRACE_SPANS];
+    span->category = category;
+    span->name = name;
+    span->start = start;
+    span->end = end;
+}
+
+/*
+ * Returns the start time for trace_end(), or 0 if tracing is disabled (so that
+ * the clock is not read needlessly).
+ *
+ */
+uint64_t trace_begin(void) {
+    return (tracing ? stats_now() : 0);
+}
+
+/*
+ * Records the span which started at the given trace_begin() value.
+ *
+ */
+void trace_end(const char *category, const char *name, uint64_t start) {
+    /* Tracing might have been enabled in the meantime. */
+    if (!tracing || start == 0)
+        return;
+
+    trace_add(category, name, start, stats_now());
+}
+
+/*
+ * Writes the recorded spans to the given file in the Chrome trace event
+ * format, which can be loaded into chrome://tracing or Perfetto. Returns false
+ * if the file could not be written.
+ *
+ */
+bool trace_dump(const char *filename) {
+    FILE *f = fopen(filename, "w");
+    if (f == NULL) {
+        ELOG("Could not open \"%s\" for writing the trace: %s\n", filename, strerror(errno));
+        return false;
+    }
+
+    uint64_t first = (recorded > TRACE_SPANS ? recorded - TRACE_SPANS : 0);
+    if (first > 0)
+        LOG("Trace buffer overflowed, the oldest %" PRIu64 " spans are lost\n", first);
+
+    /* All spans are complete events ("ph": "X") of a single thread. Names
+     * are identifiers (function or event names), so they need no escaping. */
+    fprintf(f, "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n");
+    for (uint64_t i = first; i < recorded; i++) {
+        const struct span *span = &spans[i % TRACE_SPANS];
+        fprintf(f, "%s{\"cat\": \"%s\", \"name\": \"%s\", \"ph\": \"X\", "
+                   "\"ts\": %" PRIu64 ".%03" PRIu64 ", \"dur\": %" PRIu64 ".%03" PRIu64 ", "
+                   "\"pid\": %d, \"tid\": 1}\n",
+                (i == first ? "" : ","), span->category, span->name,
+                span->start / 1000, span->start % 1000,
+                (span->end - span->start) / 1000, (span->end - span->start) % 1000,
+                getpid());
+    }
+    fprintf(f, "]}\n");
+
+    bool success = (fflush(f) == 0);
+    if (fclose(f) != 0)
+        success = false;
+    if (!success)
+        ELOG("Could not write the trace to \"%s\"\n", filename);
+    else LOG("Wrote %" PRIu64 " spans to \"%s\"\n", recorded - first, filename);
+    return success;
+}
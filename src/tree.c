@@ -15,6 +15,9 @@ struct Con *croot;
 struct Con *focused;
 
 struct all_cons_head all_cons = TAILQ_HEAD_INITIALIZER(all_cons);
+struct all_cons_head marked_cons = TAILQ_HEAD_INITIALIZER(marked_cons);
+
+uint64_t tree_generation = 1;
 
 /*
  * Create the pseudo-output __i3. Output-independent workspaces such as
@@ -56,7 +59,7 @@ static Con *_create___i3(void) {
     ws->layout = L_SPLITH;
     con_attach(ws, content, false);
     x_set_name(ws, "[i3 con] workspace __i3_scratch");
-    ws->fullscreen_mode = CF_OUTPUT;
+    con_set_fullscreen_mode(ws, CF_OUTPUT);
 
     return __i3;
 }
@@ -84,7 +87,9 @@ bool tree_restore(const char *path, xcb_get_geometry_reply_t *geometry) {
     };
     focused = croot;
 
-    tree_append_json(globbed);
+    /* Layouts stored by older versions of i3 (or written by hand) are JSON */
+    if (!restart_layout_load(globbed))
+        tree_append_json(globbed);
 
     printf("appended tree, using new root\n");
     croot = TAILQ_FIRST(&(croot->nodes_head));
@@ -103,6 +108,7 @@ bool tree_restore(const char *path, xcb_get_geometry_reply_t *geometry) {
          * that assumption. */
         TAILQ_REMOVE(&(croot->nodes_head), __i3, nodes);
         TAILQ_INSERT_HEAD(&(croot->nodes_head), __i3, nodes);
+        con_children_changed(croot);
     }
 
     return true;
@@ -257,10 +263,16 @@ bool tree_close(Con *con, kill_window_t kill_window, bool dont_kill_parent, bool
              * X11 Errors are returned when the window was already destroyed */
             add_ignore_event(cookie.sequence, 0);
         }
-        FREE(con->window->class_class);
-        FREE(con->window->class_instance);
-        i3string_free(con->window->name);
-        free(con->window);
+        i3Window *window = con->window;
+        /* A new window might get the same ID, see x_con_kill(). */
+        if (focused_id == window->id)
+            focused_id = XCB_NONE;
+        con_set_window(con, NULL);
+        FREE(window->class_class);
+        FREE(window->class_instance);
+        i3string_free(window->name);
+        sync_request_free(window);
+        pool_free(&window_pool, window);
     }
 
     Con *ws = con_get_workspace(con);
@@ -282,13 +294,14 @@ bool tree_close(Con *con, kill_window_t kill_window, bool dont_kill_parent, bool
     con_detach(con);
 
     /* disable urgency timer, if needed */
-    if (con->urgency_timer != NULL) {
+    if (con->urgency_timer_active) {
         DLOG("Removing urgency timer of con %p\n", con);
         workspace_update_urgent_flag(ws);
-        ev_timer_stop(main_loop, con->urgency_timer);
-        FREE(con->urgency_timer);
+        workspace_cancel_urgency_timer(con);
     }
 
+    floating_cancel_reposition(con);
+
     if (con->type != CT_FLOATING_CON) {
         /* If the container is *not* floating, we might need to re-distribute
          * percentage values for the resized containers. */
@@ -296,15 +309,17 @@ bool tree_close(Con *con, kill_window_t kill_window, bool dont_kill_parent, bool
     }
 
     /* Render the tree so that the surrounding containers take up the space
-     * which 'con' does no longer occupy. If we don’t render here, there will
-     * be a gap in our containers and that could trigger an EnterNotify for an
-     * underlying container, see ticket #660.
+     * which 'con' does no longer occupy. x_con_kill() keeps the frame around
+     * until then, so there will be no gap in our containers which could
+     * trigger an EnterNotify for an underlying container (see ticket #660).
+     * Deferring the render means that closing many containers at once (e.g.
+     * when an application exits) renders only once.
      *
      * Rendering has to be avoided when dont_kill_parent is set (when
      * tree_close calls itself recursively) because the tree is in a
      * non-renderable state during that time. */
     if (!dont_kill_parent)
-        tree_render();
+        tree_render_later();
 
     /* kill the X11 part of this container */
     x_con_kill(con);
@@ -317,8 +332,22 @@ bool tree_close(Con *con, kill_window_t kill_window, bool dont_kill_parent, bool
 
     free(con->name);
     FREE(con->deco_render_params);
+    FREE(con->children);
+    FREE(con->tree_repr);
+    con_set_mark(con, NULL);
+    workspace_index_remove(con);
+    workspace_unindex_sticky(con);
+    scratchpad_unindex(con);
+    con_set_fullscreen_mode(con, CF_NONE);
+    con_unindex_swallows(con);
+    while (!TAILQ_EMPTY(&(con->swallow_head))) {
+        Match *match = TAILQ_FIRST(&(con->swallow_head));
+        TAILQ_REMOVE(&(con->swallow_head), match, matches);
+        match_free(match);
+        pool_free(&match_pool, match);
+    }
     TAILQ_REMOVE(&all_cons, con, all_cons);
-    free(con);
+    pool_free(&con_pool, con);
 
     /* in the case of floating windows, we already focused another container
      * when closing the parent, so we can exit now. */
@@ -396,6 +425,7 @@ void tree_split(Con *con, orientation_t orientation) {
         if (con_num_children(con) < 2) {
             DLOG("Just changing orientation of workspace\n");
             con->layout = (orientation == HORIZ) ? L_SPLITH : L_SPLITV;
+            con_mark_dirty(con);
             return;
         } else {
             /* if there is more than one container on the workspace
@@ -417,6 +447,7 @@ void tree_split(Con *con, orientation_t orientation) {
         (parent->layout == L_SPLITH ||
          parent->layout == L_SPLITV)) {
         parent->layout = (orientation == HORIZ) ? L_SPLITH : L_SPLITV;
+        con_mark_dirty(parent);
         DLOG("Just changing orientation of existing container\n");
         return;
     }
@@ -427,6 +458,7 @@ void tree_split(Con *con, orientation_t orientation) {
     Con *new = con_new(NULL, NULL);
     TAILQ_REPLACE(&(parent->nodes_head), con, new, nodes);
     TAILQ_REPLACE(&(parent->focus_head), con, new, focused);
+    con_children_changed(parent);
     new->parent = parent;
     new->layout = (orientation == HORIZ) ? L_SPLITH : L_SPLITV;
 
@@ -491,7 +523,14 @@ bool level_down(void) {
 static void mark_unmapped(Con *con) {
     Con *current;
 
+    /* If this container was neither rendered nor mapped, neither are its
+     * descendants (think of invisible workspaces), so there is nothing to
+     * reset. */
+    if (!con->rendered && !con->mapped)
+        return;
+
     con->mapped = false;
+    con->rendered = false;
     TAILQ_FOREACH(current, &(con->nodes_head), nodes)
         mark_unmapped(current);
     if (con->type == CT_WORKSPACE) {
@@ -502,25 +541,170 @@ static void mark_unmapped(Con *con) {
     }
 }
 
+/*
+ * Clears the dirty flag of the given container and all its dirty descendants
+ * after their changes have been rendered and pushed to X11. Invisible
+ * containers get marked as stale instead (see Con.layout_stale).
+ *
+ */
+static void clear_dirty(Con *con) {
+    Con *current;
+
+    /* render_con() did not look at containers which are not visible, so
+     * their geometry has to be recomputed once they are shown. */
+    if (!con->rendered)
+        con->layout_stale = true;
+    con->dirty = false;
+    TAILQ_FOREACH(current, &(con->nodes_head), nodes)
+        if (current->dirty)
+            clear_dirty(current);
+
+    TAILQ_FOREACH(current, &(con->floating_head), floating_windows)
+        if (current->dirty)
+            clear_dirty(current);
+}
+
+/*
+ * Returns true if nothing on the given output changed since the last render
+ * pass, in which it was rendered with the same rect. Its geometry, map state
+ * and decorations are then still up to date.
+ *
+ */
+static bool output_unchanged(Con *output) {
+    return (!output->output_changed && !output->dirty && output->rendered &&
+            memcmp(&(output->render_rect), &(output->rect), sizeof(Rect)) == 0);
+}
+
+/* Number of active batches (see tree_batch_begin()) and whether rendering
+ * was requested but not done yet (see tree_render_later()). */
+static int batch_depth = 0;
+static bool render_pending = false;
+/* Set by tree_render_focus_later(), see there. */
+static bool focus_pending = false;
+
 /*
  * Renders the tree, that is rendering all outputs using render_con() and
  * pushing the changes to X11 using x_push_changes().
  *
+ * Only containers which are dirty (see con_mark_dirty()) or got a new rect
+ * get their geometry recomputed, unchanged invisible subtrees are not pushed
+ * to X11 at all. Invisible workspaces are not rendered until they are shown,
+ * except for the most recently hidden ones (see workspace_render_recent()).
+ *
+ * Outputs on which nothing changed (see output_unchanged()) are skipped
+ * entirely, so a change on one monitor only renders and pushes that output.
+ * Floating windows are always restacked on top of all outputs. When a
+ * container is fullscreen globally, all outputs are rendered.
+ *
+ * While a batch is active (see tree_batch_begin()), rendering is deferred
+ * until the batch ends.
+ *
  */
 void tree_render(void) {
     if (croot == NULL)
         return;
 
+    if (batch_depth > 0) {
+        DLOG("Deferring rendering until the batch ends\n");
+        render_pending = true;
+        return;
+    }
+    render_pending = false;
+    focus_pending = false;
+
+    uint64_t start = stats_now();
     DLOG("-- BEGIN RENDERING --\n");
-    /* Reset map state for all nodes in tree */
-    /* TODO: a nicer method to walk all nodes would be good, maybe? */
-    mark_unmapped(croot);
+    /* Reset map state for all nodes on the outputs which are rendered */
+    const bool scoped = (con_get_fullscreen_con(croot, CF_GLOBAL) == NULL);
+    Con *output;
+    TAILQ_FOREACH(output, &(croot->nodes_head), nodes) {
+        output->render_skip = (scoped && output_unchanged(output));
+        if (output->render_skip)
+            DLOG("Skipping unchanged output %s\n", output->name);
+        else mark_unmapped(output);
+    }
     croot->mapped = true;
 
+    uint64_t layout_start = stats_now();
+    workspace_render_recent();
     render_con(croot, false);
+    stats_record(&stats_render_con, layout_start);
 
     x_push_changes(croot);
+    clear_dirty(croot);
+    TAILQ_FOREACH(output, &(croot->nodes_head), nodes) {
+        output->render_skip = false;
+        output->output_changed = false;
+    }
+    tree_snapshot_update();
     DLOG("-- END RENDERING --\n");
+    stats_record(&stats_tree_render, start);
+}
+
+/*
+ * Requests that the tree is rendered before i3 waits for new events. Use this
+ * instead of tree_render() in event handlers so that a burst of events (e.g.
+ * many windows being mapped at once) is rendered only once.
+ *
+ */
+void tree_render_later(void) {
+    render_pending = true;
+}
+
+/*
+ * Renders the tree if rendering was requested using tree_render_later() (or
+ * deferred because of a batch) and not done yet.
+ *
+ */
+void tree_render_flush(void) {
+    if (render_pending)
+        tree_render();
+    else if (focus_pending && batch_depth == 0) {
+        focus_pending = false;
+        x_push_changes(croot);
+    }
+}
+
+/*
+ * Like tree_render_later(), but for changes which only affect the focus and
+ * therefore the decorations and the X11 input focus, not the geometry (see
+ * handle_enter_notify()). Unless a full render is requested as well, only
+ * x_push_changes() is called, skipping render_con().
+ *
+ */
+void tree_render_focus_later(void) {
+    focus_pending = true;
+}
+
+/*
+ * Starts a batch: until the matching tree_batch_end(), tree_render() only
+ * remembers that rendering is necessary. Batches can be nested.
+ *
+ */
+void tree_batch_begin(void) {
+    batch_depth++;
+}
+
+/*
+ * Ends a batch started with tree_batch_begin(). When the outermost batch
+ * ends, the tree is rendered once if tree_render() was called in between.
+ *
+ */
+void tree_batch_end(void) {
+    assert(batch_depth > 0);
+    if (--batch_depth == 0 && render_pending)
+        tree_render();
+}
+
+/*
+ * Like tree_batch_end(), but the tree is not rendered right away, only
+ * before i3 waits for new events (see tree_render_later()). For callers which
+ * must not render, e.g. because they may be reached while sending events.
+ *
+ */
+void tree_batch_end_later(void) {
+    assert(batch_depth > 0);
+    batch_depth--;
 }
 
 /*
@@ -689,21 +873,44 @@ void tree_next(char way, orientation_t orientation) {
  * split container then and if you move containers this way multiple times,
  * redundant chains of split-containers can be the result.
  *
+ * The tree is traversed once, so whole chains are removed in a single call.
+ *
  */
 void tree_flatten(Con *con) {
     Con *current, *child, *parent = con->parent;
+
+    /* Flatten the children first (post-order), so that a whole chain of
+     * redundant containers collapses in a single pass: once the lower pairs
+     * are gone, the upper ones can be flattened on the way back up. We cannot
+     * use normal foreach here because tree_flatten might close the current
+     * container. Its children are inserted before it, so they are not visited
+     * again. */
+    current = TAILQ_FIRST(&(con->nodes_head));
+    while (current != NULL) {
+        Con *next = TAILQ_NEXT(current, nodes);
+        tree_flatten(current);
+        current = next;
+    }
+
+    current = TAILQ_FIRST(&(con->floating_head));
+    while (current != NULL) {
+        Con *next = TAILQ_NEXT(current, floating_windows);
+        tree_flatten(current);
+        current = next;
+    }
+
     DLOG("Checking if I can flatten con = %p / %s\n", con, con->name);
 
     /* We only consider normal containers without windows */
     if (con->type != CT_CON ||
         parent->layout == L_OUTPUT || /* con == "content" */
         con->window != NULL)
-        goto recurse;
+        return;
 
     /* Ensure it got only one child */
     child = TAILQ_FIRST(&(con->nodes_head));
     if (child == NULL || TAILQ_NEXT(child, nodes) != NULL)
-        goto recurse;
+        return;
 
     DLOG("child = %p, con = %p, parent = %p\n", child, con, parent);
 
@@ -715,29 +922,25 @@ void tree_flatten(Con *con) {
         (child->layout != L_SPLITH && child->layout != L_SPLITV) ||
         con_orientation(con) == con_orientation(child) ||
         con_orientation(child) != con_orientation(parent))
-        goto recurse;
+        return;
 
     DLOG("Alright, I have to flatten this situation now. Stay calm.\n");
     /* 1: save focus */
     Con *focus_next = TAILQ_FIRST(&(child->focus_head));
 
-    DLOG("detaching...\n");
-    /* 2: re-attach the children to the parent before con */
-    while (!TAILQ_EMPTY(&(child->nodes_head))) {
-        current = TAILQ_FIRST(&(child->nodes_head));
-        DLOG("detaching current=%p / %s\n", current, current->name);
-        con_detach(current);
-        DLOG("re-attaching\n");
-        /* We don’t use con_attach() here because for a CT_CON, the special
-         * case handling of con_attach() does not trigger. So all it would do
-         * is calling TAILQ_INSERT_AFTER, but with the wrong container. So we
-         * directly use the TAILQ macros. */
+    /* 2: re-attach the children to the parent before con. We don’t use
+     * con_detach() and con_attach() here because for a CT_CON, the special
+     * case handling of con_attach() does not trigger. Instead, the whole
+     * lists are moved at once. */
+    TAILQ_FOREACH(current, &(child->nodes_head), nodes) {
         current->parent = parent;
-        TAILQ_INSERT_BEFORE(con, current, nodes);
-        DLOG("attaching to focus list\n");
-        TAILQ_INSERT_TAIL(&(parent->focus_head), current, focused);
         current->percent = con->percent;
     }
+    TAILQ_SPLICE_BEFORE(con, &(child->nodes_head), nodes);
+    TAILQ_CONCAT(&(parent->focus_head), &(child->focus_head), focused);
+    con_children_changed(child);
+    con_children_changed(parent);
+    con_mark_dirty(parent);
     DLOG("re-attached all\n");
 
     /* 3: restore focus, if con was focused */
@@ -752,28 +955,4 @@ void tree_flatten(Con *con) {
     /* 4: close the redundant cons */
     DLOG("closing redundant cons\n");
     tree_close(con, DONT_KILL_WINDOW, true, false);
-
-    /* Well, we got to abort the recursion here because we destroyed the
-     * container. However, if tree_flatten() is called sufficiently often,
-     * there can’t be the situation of having two pairs of redundant containers
-     * at once. Therefore, we can safely abort the recursion on this level
-     * after flattening. */
-    return;
-
-recurse:
-    /* We cannot use normal foreach here because tree_flatten might close the
-     * current container. */
-    current = TAILQ_FIRST(&(con->nodes_head));
-    while (current != NULL) {
-        Con *next = TAILQ_NEXT(current, nodes);
-        tree_flatten(current);
-        current = next;
-    }
-
-    current = TAILQ_FIRST(&(con->floating_head));
-    while (current != NULL) {
-        Con *next = TAILQ_NEXT(current, floating_windows);
-        tree_flatten(current);
-        current = next;
-    }
 }
@@ -0,0 +1,195 @@
+#undef I3__FILE__
+#define I3__FILE__ "tree_snapshot.c"
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009-2013 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * tree_snapshot.c: Keeps a snapshot of the tree in shared memory (see
+ *                  shmtree.h for the format).
+ *
+ * While the snapshot is enabled, it is rewritten after every render. Writing
+ * it is a plain walk over the tree without any allocations, so it is cheap
+ * compared to generating a GET_TREE reply, and readers do not need to talk
+ * to i3 at all (apart from finding the segment via the I3_SHMTREE_PATH
+ * atom).
+ *
+ */
+#include "all.h"
+#include "shmtree.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+
+char *shmtreename = "";
+
+static int snapshot_shm = -1;
+static uint8_t *snapshot;
+static size_t snapshot_size;
+
+/*
+ * Counts the containers in the given subtree and the bytes needed for their
+ * names.
+ *
+ */
+static void count_nodes(Con *con, uint32_t *nodes, size_t *strings) {
+    Con *current;
+
+    (*nodes)++;
+    if (con->name != NULL)
+        *strings += strlen(con->name) + 1;
+
+    TAILQ_FOREACH(current, &(con->nodes_head), nodes)
+        count_nodes(current, nodes, strings);
+    TAILQ_FOREACH(current, &(con->floating_head), floating_windows)
+        count_nodes(current, nodes, strings);
+}
+
+/*
+ * Writes the given subtree in pre-order, starting at node index *next_node
+ * and string offset *next_string.
+ *
+ */
+static void write_nodes(Con *con, int32_t parent, uint32_t *next_node, uint32_t *next_string) {
+    i3_shmtree_header *header = (i3_shmtree_header*)snapshot;
+    i3_shmtree_node *nodes = (i3_shmtree_node*)(snapshot + header->nodes_offset);
+    const uint32_t index = (*next_node)++;
+    i3_shmtree_node *node = &nodes[index];
+    Con *current;
+
+    node->id = (uintptr_t)con;
+    node->window = (con->window != NULL ? con->window->id : 0);
+    node->parent = parent;
+    node->x = con->rect.x;
+    node->y = con->rect.y;
+    node->width = con->rect.width;
+    node->height = con->rect.height;
+    node->num = (con->type == CT_WORKSPACE ? con->num : -1);
+    node->type = con->type;
+    node->layout = con->layout;
+    node->fullscreen_mode = con->fullscreen_mode;
+    node->flags = ((con == focused ? I3_SHMTREE_FOCUSED : 0) |
+                   (con->urgent ? I3_SHMTREE_URGENT : 0) |
+                   (con->mapped ? I3_SHMTREE_MAPPED : 0));
+    if (con == focused)
+        header->focused = index;
+
+    if (con->name != NULL) {
+        const size_t len = strlen(con->name) + 1;
+        memcpy(snapshot + header->strings_offset + *next_string, con->name, len);
+        node->name = *next_string;
+        *next_string += len;
+    } else node->name = UINT32_MAX;
+
+    TAILQ_FOREACH(current, &(con->nodes_head), nodes)
+        write_nodes(current, index, next_node, next_string);
+    TAILQ_FOREACH(current, &(con->floating_head), floating_windows)
+        write_nodes(current, index, next_node, next_string);
+
+    node->subtree_size = *next_node - index;
+}
+
+/*
+ * Grows the SHM segment to at least the given size. Returns false (and
+ * disables the snapshot) if that failed.
+ *
+ */
+static bool grow_snapshot(size_t size) {
+    size_t new_size = max(snapshot_size, 64 * 1024);
+    while (new_size < size)
+        new_size *= 2;
+
+    if (ftruncate(snapshot_shm, new_size) == -1) {
+        ELOG("Could not grow the SHM segment for the tree snapshot: %s\n", strerror(errno));
+        tree_snapshot_set_enabled(false);
+        return false;
+    }
+
+    uint8_t *grown = mmap(NULL, new_size, PROT_READ | PROT_WRITE, MAP_SHARED, snapshot_shm, 0);
+    if (grown == MAP_FAILED) {
+        ELOG("Could not mmap the SHM segment for the tree snapshot: %s\n", strerror(errno));
+        tree_snapshot_set_enabled(false);
+        return false;
+    }
+    if (snapshot != NULL)
+        munmap(snapshot, snapshot_size);
+    snapshot = grown;
+    snapshot_size = new_size;
+    return true;
+}
+
+/*
+ * Writes the current tree into the snapshot, if it is enabled. Called at the
+ * end of tree_render().
+ *
+ */
+void tree_snapshot_update(void) {
+    if (snapshot_shm == -1 || croot == NULL)
+        return;
+
+    uint32_t num_nodes = 0;
+    size_t strings = 0;
+    count_nodes(croot, &num_nodes, &strings);
+    const size_t size = sizeof(i3_shmtree_header) + num_nodes * sizeof(i3_shmtree_node) + strings;
+    if (size > snapshot_size && !grow_snapshot(size))
+        return;
+
+    i3_shmtree_header *header = (i3_shmtree_header*)snapshot;
+    header->sequence++;
+    __sync_synchronize();
+
+    header->magic = I3_SHMTREE_MAGIC;
+    header->version = I3_SHMTREE_VERSION;
+    header->size = snapshot_size;
+    header->num_nodes = num_nodes;
+    header->nodes_offset = sizeof(i3_shmtree_header);
+    header->strings_offset = header->nodes_offset + num_nodes * sizeof(i3_shmtree_node);
+    header->focused = 0;
+
+    uint32_t next_node = 0, next_string = 0;
+    write_nodes(croot, -1, &next_node, &next_string);
+
+    __sync_synchronize();
+    header->sequence++;
+}
+
+/*
+ * Enables or disables the snapshot. Enabling creates the SHM segment and
+ * writes the current tree into it, disabling removes the segment.
+ *
+ */
+void tree_snapshot_set_enabled(bool enabled) {
+    if (enabled == (snapshot_shm != -1))
+        return;
+
+    if (!enabled) {
+        if (snapshot != NULL)
+            munmap(snapshot, snapshot_size);
+        snapshot = NULL;
+        snapshot_size = 0;
+        close(snapshot_shm);
+        snapshot_shm = -1;
+        shm_unlink(shmtreename);
+        free(shmtreename);
+        shmtreename = "";
+        return;
+    }
+
+#if defined(__FreeBSD__)
+    sasprintf(&shmtreename, "/tmp/i3-tree-%d", getpid());
+#else
+    sasprintf(&shmtreename, "/i3-tree-%d", getpid());
+#endif
+    snapshot_shm = shm_open(shmtreename, O_RDWR | O_CREAT | O_TRUNC, S_IREAD | S_IWRITE);
+    if (snapshot_shm == -1) {
+        ELOG("Could not shm_open SHM segment for the tree snapshot: %s\n", strerror(errno));
+        free(shmtreename);
+        shmtreename = "";
+        return;
+    }
+
+    if (grow_snapshot(sizeof(i3_shmtree_header)))
+        tree_snapshot_update();
+}
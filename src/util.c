@@ -19,12 +19,22 @@
 #endif
 #include <fcntl.h>
 #include <pwd.h>
-#include <yajl/yajl_version.h>
 #include <libgen.h>
 
 #define SN_API_NOT_YET_FROZEN 1
 #include <libsn/sn-launcher.h>
 
+/* Once an i3-nagbar was displayed, another one is started with --preload, so
+ * that the next message (e.g. after reloading a broken config once more)
+ * appears without waiting for i3-nagbar to start up, connect to X and load
+ * its font. The spare nagbar reads its remaining arguments from
+ * spare_nagbar_fd. */
+static pid_t spare_nagbar_pid = -1;
+static int spare_nagbar_fd = -1;
+static char *spare_nagbar_font;
+static ev_child *spare_nagbar_child;
+static ev_cleanup *spare_nagbar_cleanup;
+
 int min(int a, int b) {
     return (a < b ? a : b);
 }
@@ -183,36 +193,24 @@ static char **append_argument(char **original, char *argument) {
     return result;
 }
 
-#define y(x, ...) yajl_gen_ ## x (gen, ##__VA_ARGS__)
-#define ystr(str) yajl_gen_string(gen, (unsigned char*)str, strlen(str))
-
+/*
+ * Stores the layout in the binary restart format (see restart_layout.c) and
+ * returns the filename it was stored in.
+ *
+ */
 char *store_restart_layout(void) {
-    setlocale(LC_NUMERIC, "C");
-#if YAJL_MAJOR >= 2
-    yajl_gen gen = yajl_gen_alloc(NULL);
-#else
-    yajl_gen gen = yajl_gen_alloc(NULL, NULL);
-#endif
-
-    dump_node(gen, croot, true);
-
-    setlocale(LC_NUMERIC, "");
-
-    const unsigned char *payload;
-#if YAJL_MAJOR >= 2
     size_t length;
-#else
-    unsigned int length;
-#endif
-    y(get_buf, &payload, &length);
+    char *payload = restart_layout_serialize(croot, &length);
 
     /* create a temporary file if one hasn't been specified, or just
      * resolve the tildes in the specified path */
     char *filename;
     if (config.restart_state_path == NULL) {
         filename = get_process_filename("restart-state");
-        if (!filename)
+        if (!filename) {
+            free(payload);
             return NULL;
+        }
     } else {
         filename = resolve_tilde(config.restart_state_path);
     }
@@ -221,39 +219,34 @@ char *store_restart_layout(void) {
     if (fd == -1) {
         perror("open()");
         free(filename);
+        free(payload);
         return NULL;
     }
 
-    int written = 0;
+    size_t written = 0;
     while (written < length) {
-        int n = write(fd, payload + written, length - written);
+        ssize_t n = write(fd, payload + written, length - written);
         /* TODO: correct error-handling */
         if (n == -1) {
             perror("write()");
             free(filename);
+            free(payload);
             close(fd);
             return NULL;
         }
         if (n == 0) {
             printf("write == 0?\n");
             free(filename);
+            free(payload);
             close(fd);
             return NULL;
         }
         written += n;
-#if YAJL_MAJOR >= 2
-        printf("written: %d of %zd\n", written, length);
-#else
-        printf("written: %d of %d\n", written, length);
-#endif
+        printf("written: %zu of %zu\n", written, length);
     }
     close(fd);
 
-    if (length > 0) {
-        printf("layout: %.*s\n", (int)length, payload);
-    }
-
-    y(free);
+    free(payload);
 
     return filename;
 }
@@ -268,12 +261,15 @@ void i3_restart(bool forget_layout) {
 
     kill_nagbar(&config_error_nagbar_pid, true);
     kill_nagbar(&command_error_nagbar_pid, true);
+    kill_nagbar(&spare_nagbar_pid, true);
 
     restore_geometry();
 
-    ipc_shutdown();
+    ipc_handoff();
 
     LOG("restarting \"%s\"...\n", start_argv[0]);
+    stop_async_logging();
+    event_record_stop();
     /* make sure -a is in the argument list or append it */
     start_argv = append_argument(start_argv, "-a");
 
@@ -380,6 +376,144 @@ static void nagbar_cleanup(EV_P_ ev_cleanup *watcher, int revent) {
     }
 }
 
+/*
+ * Installs the watchers for the i3-nagbar process *nagbar_pid.
+ *
+ */
+static void watch_nagbar(pid_t *nagbar_pid, ev_child **child_ptr, ev_cleanup **cleanup_ptr) {
+    /* install a child watcher */
+    ev_child *child = smalloc(sizeof(ev_child));
+    ev_child_init(child, &nagbar_exited, *nagbar_pid, 0);
+    child->data = nagbar_pid;
+    ev_child_start(main_loop, child);
+
+    /* install a cleanup watcher (will be called when i3 exits and i3-nagbar is
+     * still running) */
+    ev_cleanup *cleanup = smalloc(sizeof(ev_cleanup));
+    ev_cleanup_init(cleanup, nagbar_cleanup);
+    cleanup->data = nagbar_pid;
+    ev_cleanup_start(main_loop, cleanup);
+
+    if (child_ptr != NULL)
+        *child_ptr = child;
+    if (cleanup_ptr != NULL)
+        *cleanup_ptr = cleanup;
+}
+
+/*
+ * Returns the font given via -f in the given i3-nagbar arguments, if any.
+ *
+ */
+static const char *nagbar_font(char *argv[]) {
+    for (int i = 1; argv[i] != NULL; i++) {
+        if (strcmp(argv[i], "-f") == 0)
+            return argv[i + 1];
+    }
+    return NULL;
+}
+
+/*
+ * Starts a spare i3-nagbar with the given font, unless there already is one.
+ *
+ */
+static void start_spare_nagbar(const char *font) {
+    if (spare_nagbar_pid != -1)
+        return;
+
+    if (spare_nagbar_fd != -1) {
+        /* The previous spare nagbar exited. */
+        close(spare_nagbar_fd);
+        spare_nagbar_fd = -1;
+    }
+
+    int fds[2];
+    if (pipe(fds) == -1) {
+        warn("Could not create pipe for i3-nagbar");
+        return;
+    }
+
+    spare_nagbar_pid = fork();
+    if (spare_nagbar_pid == -1) {
+        warn("Could not fork()");
+        close(fds[0]);
+        close(fds[1]);
+        return;
+    }
+
+    /* child */
+    if (spare_nagbar_pid == 0) {
+        close(fds[1]);
+        dup2(fds[0], STDIN_FILENO);
+        close(fds[0]);
+        char *argv[] = {
+            NULL, /* will be replaced by the executable path */
+            "--preload",
+            "-f",
+            (char*)font,
+            NULL
+        };
+        exec_i3_utility("i3-nagbar", argv);
+    }
+
+    DLOG("Starting spare i3-nagbar with PID %d\n", spare_nagbar_pid);
+
+    /* parent */
+    close(fds[0]);
+    /* The write end must not be inherited: i3-nagbar exits as soon as it
+     * reads EOF, for example when i3 restarts. */
+    (void)fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+    spare_nagbar_fd = fds[1];
+    /* font might be spare_nagbar_font itself */
+    char *copy = sstrdup(font);
+    FREE(spare_nagbar_font);
+    spare_nagbar_font = copy;
+    watch_nagbar(&spare_nagbar_pid, &spare_nagbar_child, &spare_nagbar_cleanup);
+}
+
+/*
+ * Passes the given arguments to the spare i3-nagbar and makes it the one
+ * identified by *nagbar_pid. Returns false if the spare nagbar cannot be
+ * used.
+ *
+ */
+static bool use_spare_nagbar(pid_t *nagbar_pid, char *argv[]) {
+    const char *font = nagbar_font(argv);
+    if (spare_nagbar_pid == -1 || font == NULL || strcmp(font, spare_nagbar_font) != 0)
+        return false;
+
+    /* Arguments are separated by NUL bytes. */
+    size_t length = 0;
+    for (int i = 1; argv[i] != NULL; i++)
+        length += strlen(argv[i]) + 1;
+    char *buffer = smalloc(length);
+    char *walk = buffer;
+    for (int i = 1; argv[i] != NULL; i++) {
+        size_t len = strlen(argv[i]) + 1;
+        memcpy(walk, argv[i], len);
+        walk += len;
+    }
+
+    /* The arguments are much smaller than the pipe buffer, so the spare
+     * nagbar does not need to read them before write() returns. */
+    bool written = (write(spare_nagbar_fd, buffer, length) == (ssize_t)length);
+    free(buffer);
+    close(spare_nagbar_fd);
+    spare_nagbar_fd = -1;
+
+    if (!written) {
+        DLOG("Could not pass arguments to spare i3-nagbar: %s\n", strerror(errno));
+        kill_nagbar(&spare_nagbar_pid, false);
+        return false;
+    }
+
+    DLOG("Using spare i3-nagbar with PID %d\n", spare_nagbar_pid);
+    *nagbar_pid = spare_nagbar_pid;
+    spare_nagbar_child->data = nagbar_pid;
+    spare_nagbar_cleanup->data = nagbar_pid;
+    spare_nagbar_pid = -1;
+    return true;
+}
+
 /*
  * Starts an i3-nagbar instance with the given parameters. Takes care of
  * handling SIGCHLD and killing i3-nagbar when i3 exits.
@@ -394,6 +528,11 @@ void start_nagbar(pid_t *nagbar_pid, char *argv[]) {
         return;
     }
 
+    if (use_spare_nagbar(nagbar_pid, argv)) {
+        start_spare_nagbar(spare_nagbar_font);
+        return;
+    }
+
     *nagbar_pid = fork();
     if (*nagbar_pid == -1) {
         warn("Could not fork()");
@@ -407,18 +546,11 @@ void start_nagbar(pid_t *nagbar_pid, char *argv[]) {
     DLOG("Starting i3-nagbar with PID %d\n", *nagbar_pid);
 
     /* parent */
-    /* install a child watcher */
-    ev_child *child = smalloc(sizeof(ev_child));
-    ev_child_init(child, &nagbar_exited, *nagbar_pid, 0);
-    child->data = nagbar_pid;
-    ev_child_start(main_loop, child);
+    watch_nagbar(nagbar_pid, NULL, NULL);
 
-    /* install a cleanup watcher (will be called when i3 exits and i3-nagbar is
-     * still running) */
-    ev_cleanup *cleanup = smalloc(sizeof(ev_cleanup));
-    ev_cleanup_init(cleanup, nagbar_cleanup);
-    cleanup->data = nagbar_pid;
-    ev_cleanup_start(main_loop, cleanup);
+    const char *font = nagbar_font(argv);
+    if (font != NULL)
+        start_spare_nagbar(font);
 }
 
 /*
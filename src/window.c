@@ -11,96 +11,134 @@
  */
 #include "all.h"
 
+/*
+ * Returns true if the window’s name already is the string in the given
+ * property reply. Clients like terminals set their title whenever they show
+ * a prompt, so this avoids re-rendering the decoration for nothing.
+ *
+ */
+static bool name_equals(i3Window *win, xcb_get_property_reply_t *prop) {
+    if (win->name == NULL)
+        return false;
+
+    size_t length = xcb_get_property_value_length(prop);
+    return (i3string_get_num_bytes(win->name) == length &&
+            memcmp(i3string_as_utf8(win->name), xcb_get_property_value(prop), length) == 0);
+}
+
 /*
  * Updates the WM_CLASS (consisting of the class and instance) for the
- * given window.
+ * given window. Returns false if WM_CLASS did not change.
  *
  */
-void window_update_class(i3Window *win, xcb_get_property_reply_t *prop, bool before_mgmt) {
+bool window_update_class(i3Window *win, xcb_get_property_reply_t *prop, bool before_mgmt) {
     if (prop == NULL || xcb_get_property_value_length(prop) == 0) {
         DLOG("WM_CLASS not set.\n");
         FREE(prop);
-        return;
+        return false;
     }
 
     /* We cannot use asprintf here since this property contains two
      * null-terminated strings (for compatibility reasons). Instead, we
      * use strdup() on both strings */
-    char *new_class = xcb_get_property_value(prop);
+    char *new_instance = xcb_get_property_value(prop);
+    char *new_class = NULL;
+    if ((strlen(new_instance) + 1) < xcb_get_property_value_length(prop))
+        new_class = new_instance + strlen(new_instance) + 1;
+
+    if (win->class_instance != NULL && strcmp(win->class_instance, new_instance) == 0 &&
+        (win->class_class == NULL ? new_class == NULL
+                                  : (new_class != NULL && strcmp(win->class_class, new_class) == 0))) {
+        DLOG("WM_CLASS did not change.\n");
+        free(prop);
+        return false;
+    }
 
     FREE(win->class_instance);
     FREE(win->class_class);
 
-    win->class_instance = sstrdup(new_class);
-    if ((strlen(new_class) + 1) < xcb_get_property_value_length(prop))
-        win->class_class = sstrdup(new_class + strlen(new_class) + 1);
-    else win->class_class = NULL;
+    win->class_instance = sstrdup(new_instance);
+    win->class_class = (new_class != NULL ? sstrdup(new_class) : NULL);
+    win->property_generation[WP_CLASS]++;
+    win->property_generation[WP_INSTANCE]++;
+    con_tree_representations_changed();
     LOG("WM_CLASS changed to %s (instance), %s (class)\n",
         win->class_instance, win->class_class);
 
     if (before_mgmt) {
         free(prop);
-        return;
+        return true;
     }
 
     run_assignments(win);
 
     free(prop);
+    return true;
 }
 
 /*
  * Updates the name by using _NET_WM_NAME (encoded in UTF-8) for the given
  * window. Further updates using window_update_name_legacy will be ignored.
+ * Returns false if the name did not change.
  *
  */
-void window_update_name(i3Window *win, xcb_get_property_reply_t *prop, bool before_mgmt) {
+bool window_update_name(i3Window *win, xcb_get_property_reply_t *prop, bool before_mgmt) {
     if (prop == NULL || xcb_get_property_value_length(prop) == 0) {
         DLOG("_NET_WM_NAME not specified, not changing\n");
         FREE(prop);
-        return;
+        return false;
+    }
+
+    win->uses_net_wm_name = true;
+
+    if (name_equals(win, prop)) {
+        free(prop);
+        return false;
     }
 
+    /* Windows of the same application often share their title. */
     i3string_free(win->name);
-    win->name = i3string_from_utf8_with_length(xcb_get_property_value(prop),
-                                               xcb_get_property_value_length(prop));
+    win->name = i3string_intern(xcb_get_property_value(prop),
+                                xcb_get_property_value_length(prop));
     win->name_x_changed = true;
+    win->property_generation[WP_TITLE]++;
     LOG("_NET_WM_NAME changed to \"%s\"\n", i3string_as_utf8(win->name));
 
-    win->uses_net_wm_name = true;
-
     if (before_mgmt) {
         free(prop);
-        return;
+        return true;
     }
 
     run_assignments(win);
 
     free(prop);
+    return true;
 }
 
 /*
  * Updates the name by using WM_NAME (encoded in COMPOUND_TEXT). We do not
  * touch what the client sends us but pass it to xcb_image_text_8. To get
  * proper unicode rendering, the application has to use _NET_WM_NAME (see
- * window_update_name()).
+ * window_update_name()). Returns false if the name did not change.
  *
  */
-void window_update_name_legacy(i3Window *win, xcb_get_property_reply_t *prop, bool before_mgmt) {
+bool window_update_name_legacy(i3Window *win, xcb_get_property_reply_t *prop, bool before_mgmt) {
     if (prop == NULL || xcb_get_property_value_length(prop) == 0) {
         DLOG("WM_NAME not set (_NET_WM_NAME is what you want anyways).\n");
         FREE(prop);
-        return;
+        return false;
     }
 
     /* ignore update when the window is known to already have a UTF-8 name */
-    if (win->uses_net_wm_name) {
+    if (win->uses_net_wm_name || name_equals(win, prop)) {
         free(prop);
-        return;
+        return false;
     }
 
     i3string_free(win->name);
-    win->name = i3string_from_utf8_with_length(xcb_get_property_value(prop),
-                                               xcb_get_property_value_length(prop));
+    win->name = i3string_intern(xcb_get_property_value(prop),
+                                xcb_get_property_value_length(prop));
+    win->property_generation[WP_TITLE]++;
 
     LOG("WM_NAME changed to \"%s\"\n", i3string_as_utf8(win->name));
     LOG("Using legacy window title. Note that in order to get Unicode window "
@@ -110,12 +148,13 @@ void window_update_name_legacy(i3Window *win, xcb_get_property_reply_t *prop, bo
 
     if (before_mgmt) {
         free(prop);
-        return;
+        return true;
     }
 
     run_assignments(win);
 
     free(prop);
+    return true;
 }
 
 /*
@@ -142,6 +181,24 @@ void window_update_leader(i3Window *win, xcb_get_property_reply_t *prop) {
     free(prop);
 }
 
+/*
+ * Updates the _NET_WM_SYNC_REQUEST_COUNTER (the XSync counter the client
+ * updates after it handled a _NET_WM_SYNC_REQUEST).
+ *
+ */
+void window_update_sync_counter(i3Window *win, xcb_get_property_reply_t *prop) {
+    if (prop == NULL || xcb_get_property_value_length(prop) < (int)sizeof(xcb_sync_counter_t)) {
+        DLOG("_NET_WM_SYNC_REQUEST_COUNTER not set.\n");
+        FREE(prop);
+        return;
+    }
+
+    win->sync_counter = *((xcb_sync_counter_t*)xcb_get_property_value(prop));
+    DLOG("Sync counter of window 0x%08x is 0x%08x\n", win->id, win->sync_counter);
+
+    free(prop);
+}
+
 /*
  * Updates the TRANSIENT_FOR (logical parent window).
  *
@@ -192,14 +249,21 @@ void window_update_strut_partial(i3Window *win, xcb_get_property_reply_t *prop)
 }
 
 /*
- * Updates the WM_WINDOW_ROLE
+ * Updates the WM_WINDOW_ROLE. Returns false if the role did not change.
  *
  */
-void window_update_role(i3Window *win, xcb_get_property_reply_t *prop, bool before_mgmt) {
+bool window_update_role(i3Window *win, xcb_get_property_reply_t *prop, bool before_mgmt) {
     if (prop == NULL || xcb_get_property_value_length(prop) == 0) {
         DLOG("WM_WINDOW_ROLE not set.\n");
         FREE(prop);
-        return;
+        return false;
+    }
+
+    size_t length = xcb_get_property_value_length(prop);
+    if (win->role != NULL && strlen(win->role) == length &&
+        strncmp(win->role, xcb_get_property_value(prop), length) == 0) {
+        free(prop);
+        return false;
     }
 
     char *new_role;
@@ -208,20 +272,22 @@ void window_update_role(i3Window *win, xcb_get_property_reply_t *prop, bool befo
         perror("asprintf()");
         DLOG("Could not get WM_WINDOW_ROLE\n");
         free(prop);
-        return;
+        return false;
     }
     FREE(win->role);
     win->role = new_role;
+    win->property_generation[WP_ROLE]++;
     LOG("WM_WINDOW_ROLE changed to \"%s\"\n", win->role);
 
     if (before_mgmt) {
         free(prop);
-        return;
+        return true;
     }
 
     run_assignments(win);
 
     free(prop);
+    return true;
 }
 
 /*
@@ -14,11 +14,98 @@
 #include "yajl_utils.h"
 
 #include <yajl/yajl_gen.h>
+#include <ctype.h>
 
 /* Stores a copy of the name of the last used workspace for the workspace
  * back-and-forth switching. */
 static char *previous_workspace_name = NULL;
 
+/* The workspaces which were hidden most recently, most recent first. They are
+ * still rendered (see workspace_render_recent()), so that switching back to
+ * them only needs to map and unmap windows. Workspaces are removed by
+ * workspace_index_remove() before they are freed. */
+#define RECENT_WORKSPACES 2
+static Con *recent_workspaces[RECENT_WORKSPACES];
+
+static void recent_workspaces_remove(Con *ws) {
+    for (int i = 0; i < RECENT_WORKSPACES; i++) {
+        if (recent_workspaces[i] != ws)
+            continue;
+        memmove(recent_workspaces + i, recent_workspaces + i + 1,
+                (RECENT_WORKSPACES - i - 1) * sizeof(Con*));
+        recent_workspaces[RECENT_WORKSPACES - 1] = NULL;
+        return;
+    }
+}
+
+static void recent_workspaces_add(Con *ws) {
+    recent_workspaces_remove(ws);
+    memmove(recent_workspaces + 1, recent_workspaces,
+            (RECENT_WORKSPACES - 1) * sizeof(Con*));
+    recent_workspaces[0] = ws;
+}
+
+/* Workspaces, hashed by their lowercased name. Since workspaces get their
+ * names in a lot of places (e.g. when restoring the layout or renaming), the
+ * index is not updated whenever the name changes: Entries are verified on
+ * lookup and workspaces which are not found in their bucket are found by
+ * walking the tree, then moved to the right bucket. Only freeing a workspace
+ * has to remove it, see workspace_index_remove(). */
+#define WORKSPACE_BUCKETS 64
+static LIST_HEAD(workspace_head, Con) workspace_buckets[WORKSPACE_BUCKETS];
+
+static struct workspace_head *workspace_bucket(const char *name) {
+    unsigned int hash = 5381;
+    for (const char *c = name; *c != '\0'; c++)
+        hash = ((hash << 5) + hash) + (unsigned char)tolower((unsigned char)*c);
+    return &workspace_buckets[hash % WORKSPACE_BUCKETS];
+}
+
+/*
+ * Removes the given container from the index used by
+ * get_existing_workspace_by_name() (and from the recently shown workspaces).
+ * Called by tree_close() before the container is freed.
+ *
+ */
+void workspace_index_remove(Con *con) {
+    recent_workspaces_remove(con);
+    if (!con->workspace_indexed)
+        return;
+    LIST_REMOVE(con, workspace_bucket);
+    con->workspace_indexed = false;
+}
+
+static void workspace_index_insert(Con *ws) {
+    workspace_index_remove(ws);
+    LIST_INSERT_HEAD(workspace_bucket(ws->name), ws, workspace_bucket);
+    ws->workspace_indexed = true;
+}
+
+/*
+ * Returns the workspace with the given name (compared case-insensitively) or
+ * NULL if no such workspace exists. Workspaces are looked up in a hash table,
+ * so this is cheap even with many workspaces.
+ *
+ */
+Con *get_existing_workspace_by_name(const char *name) {
+    Con *workspace;
+    LIST_FOREACH(workspace, workspace_bucket(name), workspace_bucket) {
+        if (workspace->type == CT_WORKSPACE &&
+            workspace->parent != NULL &&
+            strcasecmp(workspace->name, name) == 0)
+            return workspace;
+    }
+
+    Con *output;
+    workspace = NULL;
+    TAILQ_FOREACH(output, &(croot->nodes_head), nodes)
+        GREP_FIRST(workspace, output_get_content(output), !strcasecmp(child->name, name));
+
+    if (workspace != NULL)
+        workspace_index_insert(workspace);
+    return workspace;
+}
+
 /*
  * Sets ws->layout to splith/splitv if default_orientation was specified in the
  * configfile. Otherwise, it uses splith/splitv depending on whether the output
@@ -45,10 +132,7 @@ static void _workspace_apply_default_orientation(Con *ws) {
  *
  */
 Con *workspace_get(const char *num, bool *created) {
-    Con *output, *workspace = NULL;
-
-    TAILQ_FOREACH(output, &(croot->nodes_head), nodes)
-        GREP_FIRST(workspace, output_get_content(output), !strcasecmp(child->name, num));
+    Con *output, *workspace = get_existing_workspace_by_name(num);
 
     if (workspace == NULL) {
         LOG("Creating new workspace \"%s\"\n", num);
@@ -93,6 +177,7 @@ Con *workspace_get(const char *num, bool *created) {
         _workspace_apply_default_orientation(workspace);
 
         con_attach(workspace, content, false);
+        workspace_index_insert(workspace);
 
         ipc_send_event("workspace", I3_IPC_EVENT_WORKSPACE, "{\"change\":\"init\"}");
         if (created != NULL)
@@ -168,11 +253,7 @@ Con *create_workspace_on_output(Output *output, Con *content) {
         if (assigned)
             continue;
 
-        current = NULL;
-        TAILQ_FOREACH(out, &(croot->nodes_head), nodes)
-            GREP_FIRST(current, output_get_content(out), !strcasecmp(child->name, ws->name));
-
-        exists = (current != NULL);
+        exists = (get_existing_workspace_by_name(ws->name) != NULL);
         if (!exists) {
             /* Set ->num to the number of the workspace, if the name actually
              * is a number or starts with a number */
@@ -214,11 +295,15 @@ Con *create_workspace_on_output(Output *output, Con *content) {
     x_set_name(ws, name);
     free(name);
 
-    ws->fullscreen_mode = CF_OUTPUT;
+    con_set_fullscreen_mode(ws, CF_OUTPUT);
 
     ws->workspace_layout = config.default_layout;
     _workspace_apply_default_orientation(ws);
 
+    /* No workspace event is sent for workspaces created along with their
+     * output. */
+    ipc_invalidate_cached_replies();
+
     return ws;
 }
 
@@ -238,38 +323,69 @@ bool workspace_is_visible(Con *ws) {
     return (fs == ws);
 }
 
+/* Containers which have a sticky_group, hashed by it, so that switching
+ * workspaces does not need to walk the tree to find them. Whether a container
+ * currently holds the window of its group is checked on lookup. */
+#define STICKY_BUCKETS 16
+static LIST_HEAD(sticky_head, Con) sticky_buckets[STICKY_BUCKETS];
+
+static struct sticky_head *sticky_bucket(const char *sticky_group) {
+    unsigned int hash = 5381;
+    for (const char *c = sticky_group; *c != '\0'; c++)
+        hash = ((hash << 5) + hash) + (unsigned char)*c;
+    return &sticky_buckets[hash % STICKY_BUCKETS];
+}
+
 /*
- * XXX: we need to clean up all this recursive walking code.
+ * Removes the given container from the index of sticky containers. Called by
+ * tree_close() before the container is freed.
  *
  */
-Con *_get_sticky(Con *con, const char *sticky_group, Con *exclude) {
-    Con *current;
+void workspace_unindex_sticky(Con *con) {
+    if (!con->sticky_indexed)
+        return;
+    LIST_REMOVE(con, sticky_bucket);
+    con->sticky_indexed = false;
+}
 
-    TAILQ_FOREACH(current, &(con->nodes_head), nodes) {
-        if (current != exclude &&
-            current->sticky_group != NULL &&
-            current->window != NULL &&
-            strcmp(current->sticky_group, sticky_group) == 0)
-            return current;
+/*
+ * Adds the given container to the index of sticky containers (or moves it to
+ * the right bucket). Has to be called whenever the sticky_group of a container
+ * is set.
+ *
+ */
+void workspace_index_sticky(Con *con) {
+    workspace_unindex_sticky(con);
+    if (con->sticky_group == NULL)
+        return;
+    LIST_INSERT_HEAD(sticky_bucket(con->sticky_group), con, sticky_bucket);
+    con->sticky_indexed = true;
+}
 
-        Con *recurse = _get_sticky(current, sticky_group, exclude);
-        if (recurse != NULL)
-            return recurse;
-    }
+/*
+ * Returns the container on the given output which belongs to the given sticky
+ * group and holds its window (the first one in the tree if there are several),
+ * or NULL.
+ *
+ */
+static Con *get_sticky(Con *output, const char *sticky_group, Con *exclude) {
+    Con *current, *result = NULL;
 
-    TAILQ_FOREACH(current, &(con->floating_head), floating_windows) {
-        if (current != exclude &&
-            current->sticky_group != NULL &&
-            current->window != NULL &&
-            strcmp(current->sticky_group, sticky_group) == 0)
-            return current;
+    LIST_FOREACH(current, sticky_bucket(sticky_group), sticky_bucket) {
+        if (current == exclude ||
+            current->window == NULL ||
+            strcmp(current->sticky_group, sticky_group) != 0)
+            continue;
 
-        Con *recurse = _get_sticky(current, sticky_group, exclude);
-        if (recurse != NULL)
-            return recurse;
+        Con *ws = con_get_workspace(current);
+        if (ws == NULL || con_get_output(ws) != output)
+            continue;
+
+        if (result == NULL || con_precedes(current, result))
+            result = current;
     }
 
-    return NULL;
+    return result;
 }
 
 /*
@@ -279,69 +395,132 @@ Con *_get_sticky(Con *con, const char *sticky_group, Con *exclude) {
  * XXX: what about sticky containers which contain containers?
  *
  */
-static void workspace_reassign_sticky(Con *con) {
+static void workspace_reassign_sticky(Con *ws) {
+    Con *output = con_get_output(ws);
     Con *current;
-    /* 1: go through all containers */
 
-    /* handle all children and floating windows of this node */
-    TAILQ_FOREACH(current, &(con->nodes_head), nodes) {
-        if (current->sticky_group == NULL) {
-            workspace_reassign_sticky(current);
-            continue;
-        }
+    for (int i = 0; i < STICKY_BUCKETS; i++) {
+        LIST_FOREACH(current, &sticky_buckets[i], sticky_bucket) {
+            if (current == ws || con_get_workspace(current) != ws)
+                continue;
 
-        LOG("Ah, this one is sticky: %s / %p\n", current->name, current);
-        /* 2: find a window which we can re-assign */
-        Con *output = con_get_output(current);
-        Con *src = _get_sticky(output, current->sticky_group, current);
+            LOG("Ah, this one is sticky: %s / %p\n", current->name, current);
+            /* find a window which we can re-assign */
+            Con *src = get_sticky(output, current->sticky_group, current);
 
-        if (src == NULL) {
-            LOG("No window found for this sticky group\n");
-            workspace_reassign_sticky(current);
-            continue;
-        }
+            if (src == NULL) {
+                LOG("No window found for this sticky group\n");
+                continue;
+            }
 
-        x_move_win(src, current);
-        current->window = src->window;
-        current->mapped = true;
-        src->window = NULL;
-        src->mapped = false;
+            x_move_win(src, current);
+            i3Window *window = src->window;
+            con_set_window(src, NULL);
+            con_set_window(current, window);
+            current->mapped = true;
+            src->mapped = false;
 
-        x_reparent_child(current, src);
+            x_reparent_child(current, src);
 
-        LOG("re-assigned window from src %p to dest %p\n", src, current);
+            LOG("re-assigned window from src %p to dest %p\n", src, current);
+        }
     }
+}
 
-    TAILQ_FOREACH(current, &(con->floating_head), floating_windows)
-        workspace_reassign_sticky(current);
+/* The containers whose urgency flag will be reset by the timer, ordered by
+ * urgency_reset_at. A single timer fires for the first one. Since the delay is
+ * the same for all containers, new (or restarted) ones almost always go to the
+ * end. */
+static TAILQ_HEAD(urgency_timers_head, Con) urgency_timers =
+    TAILQ_HEAD_INITIALIZER(urgency_timers);
+static ev_timer urgency_timer;
+
+static void workspace_defer_update_urgent_hint_cb(EV_P_ ev_timer *w, int revents);
+
+static void urgency_timer_rearm(void) {
+    ev_timer_stop(main_loop, &urgency_timer);
+    Con *first = TAILQ_FIRST(&urgency_timers);
+    if (first == NULL)
+        return;
+    ev_tstamp after = first->urgency_reset_at - ev_now(main_loop);
+    ev_timer_init(&urgency_timer, workspace_defer_update_urgent_hint_cb, (after > 0 ? after : 0), 0.);
+    ev_timer_start(main_loop, &urgency_timer);
 }
 
 /*
- * Callback to reset the urgent flag of the given con to false. May be started by
- * _workspace_show to avoid urgency hints being lost by switching to a workspace
- * focusing the con.
+ * Stops the urgency timer of the given container, if it is running. Called by
+ * tree_close() before the container is freed.
  *
  */
-static void workspace_defer_update_urgent_hint_cb(EV_P_ ev_timer *w, int revents) {
-    Con *con = w->data;
+void workspace_cancel_urgency_timer(Con *con) {
+    if (!con->urgency_timer_active)
+        return;
+    const bool was_first = (TAILQ_FIRST(&urgency_timers) == con);
+    TAILQ_REMOVE(&urgency_timers, con, urgency_timers);
+    con->urgency_timer_active = false;
+    if (was_first)
+        urgency_timer_rearm();
+}
 
-    DLOG("Resetting urgency flag of con %p by timer\n", con);
-    con->urgent = false;
-    con_update_parents_urgency(con);
-    workspace_update_urgent_flag(con_get_workspace(con));
+/*
+ * (Re-)starts the urgency timer of the given container, which resets its
+ * urgent flag after workspace_urgency_timer seconds.
+ *
+ */
+static void urgency_timer_start(Con *con) {
+    workspace_cancel_urgency_timer(con);
+    con->urgency_reset_at = ev_now(main_loop) + config.workspace_urgency_timer;
+    con->urgency_timer_active = true;
+
+    /* The delay only changes on reload, so this loop rarely iterates. */
+    Con *prev = TAILQ_LAST(&urgency_timers, urgency_timers_head);
+    while (prev != NULL && prev->urgency_reset_at > con->urgency_reset_at)
+        prev = TAILQ_PREV(prev, urgency_timers_head, urgency_timers);
+    if (prev == NULL) {
+        TAILQ_INSERT_HEAD(&urgency_timers, con, urgency_timers);
+        urgency_timer_rearm();
+    } else TAILQ_INSERT_AFTER(&urgency_timers, prev, con, urgency_timers);
+}
+
+/*
+ * Callback to reset the urgent flag of the due containers to false. Timers
+ * are started by _workspace_show to avoid urgency hints being lost by
+ * switching to a workspace focusing the con. All containers which are due
+ * are handled at once, so that the tree is only rendered once.
+ *
+ */
+static void workspace_defer_update_urgent_hint_cb(EV_P_ ev_timer *w, int revents) {
+    /* Timers which are due within a millisecond are handled right away
+     * instead of starting the timer again. */
+    const ev_tstamp now = ev_now(main_loop) + 0.001;
+    Con *con;
+    while ((con = TAILQ_FIRST(&urgency_timers)) != NULL &&
+           con->urgency_reset_at <= now) {
+        TAILQ_REMOVE(&urgency_timers, con, urgency_timers);
+        con->urgency_timer_active = false;
+
+        DLOG("Resetting urgency flag of con %p by timer\n", con);
+        con->urgent = false;
+        con_update_parents_urgency(con);
+        workspace_update_urgent_flag(con_get_workspace(con));
+    }
     tree_render();
 
-    ev_timer_stop(main_loop, con->urgency_timer);
-    FREE(con->urgency_timer);
+    urgency_timer_rearm();
 }
 
 /*
  * For the "focus" event we send, along the usual "change" field, also the
  * current and previous workspace, in "current" and "old" respectively.
  */
-static void ipc_send_workspace_focus_event(Con *current, Con *old) {
-    setlocale(LC_NUMERIC, "C");
-    yajl_gen gen = ygenalloc();
+struct workspace_focus_event {
+    Con *current;
+    Con *old;
+};
+
+static void serialize_workspace_focus_event(yajl_gen gen, void *data) {
+    Con *current = ((struct workspace_focus_event*)data)->current;
+    Con *old = ((struct workspace_focus_event*)data)->old;
 
     y(map_open);
 
@@ -358,14 +537,11 @@ static void ipc_send_workspace_focus_event(Con *current, Con *old) {
         dump_node(gen, old, false);
 
     y(map_close);
+}
 
-    const unsigned char *payload;
-    ylength length;
-    y(get_buf, &payload, &length);
-
-    ipc_send_event("workspace", I3_IPC_EVENT_WORKSPACE, (const char *)payload);
-    y(free);
-    setlocale(LC_NUMERIC, "");
+static void ipc_send_workspace_focus_event(Con *current, Con *old) {
+    struct workspace_focus_event event = { current, old };
+    ipc_send_event_lazy("workspace", I3_IPC_EVENT_WORKSPACE, serialize_workspace_focus_event, &event);
 }
 
 static void _workspace_show(Con *workspace) {
@@ -380,18 +556,23 @@ static void _workspace_show(Con *workspace) {
     TAILQ_FOREACH(current, &(workspace->parent->nodes_head), nodes) {
         if (current->fullscreen_mode == CF_OUTPUT)
             old = current;
-        current->fullscreen_mode = CF_NONE;
+        con_set_fullscreen_mode(current, CF_NONE);
     }
 
     /* enable fullscreen for the target workspace. If it happens to be the
      * same one we are currently on anyways, we can stop here. */
-    workspace->fullscreen_mode = CF_OUTPUT;
+    con_set_fullscreen_mode(workspace, CF_OUTPUT);
+    con_mark_dirty(workspace->parent);
     current = con_get_workspace(focused);
     if (workspace == current) {
         DLOG("Not switching, already there.\n");
         return;
     }
 
+    recent_workspaces_remove(workspace);
+    if (old != NULL && old != workspace && !con_is_internal(old))
+        recent_workspaces_add(old);
+
     /* Remember currently focused workspace for switching back to it later with
      * the 'workspace back_and_forth' command.
      * NOTE: We have to duplicate the name as the original will be freed when
@@ -425,21 +606,17 @@ static void _workspace_show(Con *workspace) {
          * its expiration */
         focused->urgent = true;
         workspace->urgent = true;
+        con_update_parents_urgency(focused);
+        con_mark_changed(workspace);
 
-        if (focused->urgency_timer == NULL) {
+        if (!focused->urgency_timer_active) {
             DLOG("Deferring reset of urgency flag of con %p on newly shown workspace %p\n",
                     focused, workspace);
-            focused->urgency_timer = scalloc(sizeof(struct ev_timer));
-            /* use a repeating timer to allow for easy resets */
-            ev_timer_init(focused->urgency_timer, workspace_defer_update_urgent_hint_cb,
-                    config.workspace_urgency_timer, config.workspace_urgency_timer);
-            focused->urgency_timer->data = focused;
-            ev_timer_start(main_loop, focused->urgency_timer);
         } else {
             DLOG("Resetting urgency timer of con %p on workspace %p\n",
                     focused, workspace);
-            ev_timer_again(main_loop, focused->urgency_timer);
         }
+        urgency_timer_start(focused);
     } else
         con_focus(next);
 
@@ -460,7 +637,7 @@ static void _workspace_show(Con *workspace) {
         }
     }
 
-    workspace->fullscreen_mode = CF_OUTPUT;
+    con_set_fullscreen_mode(workspace, CF_OUTPUT);
     LOG("focused now = %p / %s\n", focused, focused->name);
 
     /* Set mouse pointer */
@@ -473,6 +650,23 @@ static void _workspace_show(Con *workspace) {
     ewmh_update_current_desktop();
 }
 
+/*
+ * Renders the recently hidden workspaces (see render_hidden_workspace()),
+ * unless they are visible again or have a fullscreen container. Called by
+ * tree_render() before rendering the visible workspaces, so that the hidden
+ * windows stay at the bottom of the stack.
+ *
+ */
+void workspace_render_recent(void) {
+    for (int i = 0; i < RECENT_WORKSPACES; i++) {
+        Con *ws = recent_workspaces[i];
+        if (ws == NULL || workspace_is_visible(ws) ||
+            con_get_fullscreen_con(ws, CF_OUTPUT) != NULL)
+            continue;
+        render_hidden_workspace(ws);
+    }
+}
+
 /*
  * Switches to the given workspace
  *
@@ -774,19 +968,6 @@ Con *workspace_back_and_forth_get(void) {
     return workspace;
 }
 
-static bool get_urgency_flag(Con *con) {
-    Con *child;
-    TAILQ_FOREACH(child, &(con->nodes_head), nodes)
-        if (child->urgent || get_urgency_flag(child))
-            return true;
-
-    TAILQ_FOREACH(child, &(con->floating_head), floating_windows)
-        if (child->urgent || get_urgency_flag(child))
-            return true;
-
-    return false;
-}
-
 /*
  * Goes through all clients on the given workspace and updates the workspace’s
  * urgent flag accordingly.
@@ -794,11 +975,15 @@ static bool get_urgency_flag(Con *con) {
  */
 void workspace_update_urgent_flag(Con *ws) {
     bool old_flag = ws->urgent;
-    ws->urgent = get_urgency_flag(ws);
+    /* Tiling and floating children both count, and they are only urgent
+     * if one of their descendants is. */
+    ws->urgent = con_has_urgent_child(ws);
     DLOG("Workspace urgency flag changed from %d to %d\n", old_flag, ws->urgent);
 
-    if (old_flag != ws->urgent)
+    if (old_flag != ws->urgent) {
+        con_mark_changed(ws);
         ipc_send_event("workspace", I3_IPC_EVENT_WORKSPACE, "{\"change\":\"urgent\"}");
+    }
 }
 
 /*
@@ -826,6 +1011,7 @@ void ws_force_orientation(Con *ws, orientation_t orientation) {
 
     /* 4: switch workspace layout */
     ws->layout = (orientation == HORIZ) ? L_SPLITH : L_SPLITV;
+    con_mark_dirty(ws);
     DLOG("split->layout = %d, ws->layout = %d\n", split->layout, ws->layout);
 
     /* 5: attach the new split container to the workspace */
@@ -15,14 +15,27 @@
 /* Stores the X11 window ID of the currently focused window */
 xcb_window_t focused_id = XCB_NONE;
 
-/* The bottom-to-top window stack of all windows which are managed by i3.
- * Used for x_get_window_stack(). */
+/* The bottom-to-top window stack of all windows which are managed by i3, as
+ * last written to _NET_CLIENT_LIST_STACKING, and the stack which is being
+ * built in x_push_changes(). Both have room for btt_stack_capacity windows. */
 static xcb_window_t *btt_stack;
 static int btt_stack_num;
+static xcb_window_t *new_btt_stack;
+static int btt_stack_capacity;
 
 /* Stores coordinates to warp mouse pointer to if set */
 static Rect *warp_to;
 
+/* Frames of closed containers. They are destroyed at the end of the next
+ * x_push_changes(), see x_con_kill(). */
+static xcb_window_t *dead_frames;
+static int dead_frames_num;
+static int dead_frames_capacity;
+
+/* Set by x_mask_event_mask() when EnterNotify was disabled on all frames, so
+ * that the next x_push_changes() enables it again. */
+static bool frames_masked = false;
+
 /*
  * Describes the X11 state we may modify (map state, position, window stack).
  * There is one entry per container. The state represents the current situation
@@ -36,6 +49,9 @@ typedef struct con_state {
     bool mapped;
     bool unmap_now;
     bool child_mapped;
+    /* Set when the client window of a hidden container (see Con.hidden) was
+     * not resized or told about its new position yet. */
+    bool notify_pending;
 
     /** The con for which this state is. */
     Con *con;
@@ -49,20 +65,75 @@ typedef struct con_state {
     Rect rect;
     Rect window_rect;
 
+    /* The WM_STATE which was last set on the client window and the geometry
+     * the client was last told about with a fake ConfigureNotify. Both are
+     * only valid for the client window they were sent to (the container
+     * might get a different one), so that repeating them can be skipped. */
+    xcb_window_t wm_state_window;
+    long wm_state;
+    xcb_window_t notified_window;
+    xcb_rectangle_t notified_rect;
+    uint32_t notified_border;
+
     bool initial;
 
+    /* Position in the current X11 stack (counted from the bottom) and whether
+     * the window keeps its place during restack_windows(). */
+    int old_position;
+    bool keep_position;
+
+    /* Whether the container was rendered (see Con.rendered) during the
+     * previous x_push_node(). */
+    bool was_rendered;
+    /* Set by x_push_node() when it skipped this subtree because it neither is
+     * nor was rendered and did not change, x_push_node_unmaps() skips it,
+     * too. */
+    bool skipped;
+
     char *name;
 
     CIRCLEQ_ENTRY(con_state) state;
     CIRCLEQ_ENTRY(con_state) old_state;
+    LIST_ENTRY(con_state) hash;
 } con_state;
 
+static struct pool state_pool = POOL_INITIALIZER("con_state", con_state);
+
+/* Scratch space for restack_windows(), kept between calls */
+static con_state **stack_order;
+static int *lis_tails;
+static int *lis_prev;
+static int stack_capacity;
+
+/* The states which x_push_node() found to need an unmap, so that
+ * x_push_changes() does not have to look at every state to find them. */
+static con_state **unmap_states;
+static int unmap_states_num;
+static int unmap_states_capacity;
+
 CIRCLEQ_HEAD(state_head, con_state) state_head =
     CIRCLEQ_HEAD_INITIALIZER(state_head);
 
 CIRCLEQ_HEAD(old_state_head, con_state) old_state_head =
     CIRCLEQ_HEAD_INITIALIZER(old_state_head);
 
+/* Hash table of all container states, keyed by the frame window ID, so that
+ * state_for_frame() does not need to walk state_head. The number of buckets
+ * has to be a power of two. */
+#define STATE_HASH_SIZE 1024
+LIST_HEAD(state_bucket, con_state);
+static struct state_bucket state_hash[STATE_HASH_SIZE];
+
+/*
+ * Returns the hash bucket for the given frame. X11 IDs are allocated
+ * sequentially from the client’s resource base, so the lower bits are spread
+ * well enough; we fold in the higher bits anyway.
+ *
+ */
+static struct state_bucket *state_bucket_for_frame(xcb_window_t window) {
+    return &state_hash[(window ^ (window >> 16)) & (STATE_HASH_SIZE - 1)];
+}
+
 /*
  * Returns the container state for the given frame. This function always
  * returns a container state (otherwise, there is a bug in the code and the
@@ -72,7 +143,7 @@ CIRCLEQ_HEAD(old_state_head, con_state) old_state_head =
  */
 static con_state *state_for_frame(xcb_window_t window) {
     con_state *state;
-    CIRCLEQ_FOREACH(state, &state_head, state)
+    LIST_FOREACH(state, state_bucket_for_frame(window), hash)
         if (state->id == window)
             return state;
 
@@ -82,6 +153,123 @@ static con_state *state_for_frame(xcb_window_t window) {
     return NULL;
 }
 
+/*
+ * A pre-rendered window decoration (bar, lines and title). Redrawing the
+ * title is by far the most expensive part of x_draw_decoration() (especially
+ * with pango fonts), yet the same few variants (focused/unfocused with the
+ * same title and size) are drawn over and over again when switching focus.
+ * We therefore keep the most recently used decorations in server-side
+ * pixmaps and just copy them onto the parent’s pixmap.
+ *
+ */
+struct deco_cache_key {
+    uint32_t text;
+    uint32_t background;
+    uint32_t border;
+    uint32_t width;
+    uint32_t height;
+    uint16_t depth;
+    int deco_diff_l;
+    int deco_diff_r;
+    int indent_px;
+    bool ascii;
+};
+
+struct deco_cache_entry {
+    struct deco_cache_key key;
+    char *title;
+    xcb_pixmap_t pixmap;
+
+    TAILQ_ENTRY(deco_cache_entry) entries;
+};
+
+/* Upper bound for the number of cached decorations. Each entry holds a
+ * pixmap of the size of a decoration, so this must not be too large. */
+#define DECO_CACHE_SIZE 32
+
+/* Most recently used entries are at the head. */
+static TAILQ_HEAD(deco_cache_head, deco_cache_entry) deco_cache =
+    TAILQ_HEAD_INITIALIZER(deco_cache);
+static int deco_cache_num;
+
+/*
+ * Compares two keys field by field. memcmp() cannot be used because of the
+ * padding in the struct, which does not need to be equal.
+ *
+ */
+static bool deco_cache_key_equal(const struct deco_cache_key *a, const struct deco_cache_key *b) {
+    return (a->text == b->text &&
+            a->background == b->background &&
+            a->border == b->border &&
+            a->width == b->width &&
+            a->height == b->height &&
+            a->depth == b->depth &&
+            a->deco_diff_l == b->deco_diff_l &&
+            a->deco_diff_r == b->deco_diff_r &&
+            a->indent_px == b->indent_px &&
+            a->ascii == b->ascii);
+}
+
+/*
+ * Returns the cached decoration for the given key and title (and moves it to
+ * the front), or NULL if there is none.
+ *
+ */
+static struct deco_cache_entry *deco_cache_lookup(struct deco_cache_key *key, const char *title) {
+    struct deco_cache_entry *entry;
+    TAILQ_FOREACH(entry, &deco_cache, entries) {
+        if (!deco_cache_key_equal(&(entry->key), key) ||
+            strcmp(entry->title, title) != 0)
+            continue;
+
+        if (entry != TAILQ_FIRST(&deco_cache)) {
+            TAILQ_REMOVE(&deco_cache, entry, entries);
+            TAILQ_INSERT_HEAD(&deco_cache, entry, entries);
+        }
+        return entry;
+    }
+    return NULL;
+}
+
+static void deco_cache_free_entry(struct deco_cache_entry *entry) {
+    TAILQ_REMOVE(&deco_cache, entry, entries);
+    xcb_free_pixmap(conn, entry->pixmap);
+    free(entry->title);
+    free(entry);
+    deco_cache_num--;
+}
+
+/*
+ * Stores the decoration which was just drawn onto src at (x, y) in the cache,
+ * evicting the least recently used entry if the cache is full.
+ *
+ */
+static void deco_cache_store(struct deco_cache_key *key, const char *title,
+                             xcb_drawable_t src, xcb_gcontext_t gc, int16_t x, int16_t y) {
+    if (deco_cache_num == DECO_CACHE_SIZE)
+        deco_cache_free_entry(TAILQ_LAST(&deco_cache, deco_cache_head));
+
+    struct deco_cache_entry *entry = scalloc(sizeof(struct deco_cache_entry));
+    entry->key = *key;
+    entry->title = sstrdup(title);
+    entry->pixmap = xcb_generate_id(conn);
+    xcb_create_pixmap(conn, key->depth, entry->pixmap, src, key->width, key->height);
+    xcb_copy_area(conn, src, entry->pixmap, gc, x, y, 0, 0, key->width, key->height);
+
+    TAILQ_INSERT_HEAD(&deco_cache, entry, entries);
+    deco_cache_num++;
+}
+
+/*
+ * Frees all cached decorations. Needs to be called when the font changes
+ * (configuration reload).
+ *
+ */
+void x_deco_cache_flush(void) {
+    while (!TAILQ_EMPTY(&deco_cache))
+        deco_cache_free_entry(TAILQ_FIRST(&deco_cache));
+}
+
 /*
  * Initializes the X11 part for the given container. Called exactly once for
  * every container from con_new().
@@ -142,12 +330,15 @@ void x_con_init(Con *con, uint16_t depth) {
     if (win_colormap != XCB_NONE)
         xcb_free_colormap(conn, win_colormap);
 
-    struct con_state *state = scalloc(sizeof(struct con_state));
+    con_index_frame(con);
+
+    struct con_state *state = pool_alloc(&state_pool);
     state->id = con->frame;
     state->mapped = false;
     state->initial = true;
     CIRCLEQ_INSERT_HEAD(&state_head, state, state);
     CIRCLEQ_INSERT_HEAD(&old_state_head, state, old_state);
+    LIST_INSERT_HEAD(state_bucket_for_frame(state->id), state, hash);
     DLOG("adding new state for window id 0x%08x\n", state->id);
 }
 
@@ -166,6 +357,7 @@ void x_reinit(Con *con) {
     }
 
     DLOG("resetting state %p to initial\n", state);
+    con_mark_dirty(con);
     state->initial = true;
     state->child_mapped = false;
     state->con = con;
@@ -186,6 +378,7 @@ void x_reparent_child(Con *con, Con *old) {
 
     state->need_reparent = true;
     state->old_frame = old->frame;
+    con_mark_dirty(con);
 }
 
 /*
@@ -215,24 +408,85 @@ void x_move_win(Con *src, Con *dest) {
     }
 }
 
+/*
+ * Sets WM_STATE on the client window of the given container, unless it already
+ * has the given state.
+ *
+ */
+static void x_set_wm_state(Con *con, con_state *state, long wm_state) {
+    if (state->wm_state_window == con->window->id && state->wm_state == wm_state)
+        return;
+
+    long data[] = { wm_state, XCB_NONE };
+    xcb_change_property(conn, XCB_PROP_MODE_REPLACE, con->window->id,
+                        A_WM_STATE, A_WM_STATE, 32, 2, data);
+    state->wm_state_window = con->window->id;
+    state->wm_state = wm_state;
+}
+
+/*
+ * Sends a fake ConfigureNotify with the absolute geometry of the client window
+ * of the given container (see fake_absolute_configure_notify()), unless the
+ * client was already told about exactly this geometry. Every unnecessary
+ * ConfigureNotify makes some clients relayout.
+ *
+ */
+static void x_notify_client(Con *con, con_state *state) {
+    xcb_rectangle_t absolute = {
+        con->rect.x + con->window_rect.x,
+        con->rect.y + con->window_rect.y,
+        con->window_rect.width,
+        con->window_rect.height
+    };
+
+    if (state->notified_window == con->window->id &&
+        state->notified_border == con->border_width &&
+        memcmp(&(state->notified_rect), &absolute, sizeof(xcb_rectangle_t)) == 0) {
+        DLOG("Client 0x%08x already knows its geometry, not sending a fake configure notify\n",
+             con->window->id);
+        return;
+    }
+
+    DLOG("Sending fake configure notify\n");
+    fake_absolute_configure_notify(con);
+    state->notified_window = con->window->id;
+    state->notified_rect = absolute;
+    state->notified_border = con->border_width;
+}
+
 /*
  * Kills the window decoration associated with the given container.
  *
+ * The frame itself is only destroyed at the end of the next x_push_changes(),
+ * after the remaining containers have been configured to take up its space.
+ * Otherwise, there would be a gap which could trigger an EnterNotify for an
+ * underlying window (see ticket #660). This way, closing many containers at
+ * once needs only one render.
+ *
  */
 void x_con_kill(Con *con) {
     con_state *state;
 
-    xcb_destroy_window(conn, con->frame);
+    con_unindex_frame(con);
+    if (dead_frames_num == dead_frames_capacity) {
+        dead_frames_capacity = (dead_frames_capacity == 0 ? 16 : dead_frames_capacity * 2);
+        dead_frames = srealloc(dead_frames, dead_frames_capacity * sizeof(xcb_window_t));
+    }
+    dead_frames[dead_frames_num++] = con->frame;
     xcb_free_pixmap(conn, con->pixmap);
     xcb_free_gc(conn, con->pm_gc);
     state = state_for_frame(con->frame);
     CIRCLEQ_REMOVE(&state_head, state, state);
     CIRCLEQ_REMOVE(&old_state_head, state, old_state);
+    LIST_REMOVE(state, hash);
     FREE(state->name);
-    free(state);
+    pool_free(&state_pool, state);
 
-    /* Invalidate focused_id to correctly focus new windows with the same ID */
-    focused_id = XCB_NONE;
+    /* Invalidate focused_id to correctly focus new windows with the same ID.
+     * Killing any other container does not change the focus target, so
+     * focused_id stays valid and the focus is not set again needlessly. */
+    if (focused_id == con->frame)
+        focused_id = XCB_NONE;
 }
 
 /*
@@ -328,8 +582,12 @@ void x_draw_decoration(Con *con) {
     if (leaf && con->pixmap == XCB_NONE)
         return;
 
-    /* 1: build deco_params and compare with cache */
-    struct deco_render_params *p = scalloc(sizeof(struct deco_render_params));
+    /* 1: build deco_params and compare with cache. The parameters are built
+     * on the stack because most containers are unchanged, so allocating them
+     * would only be wasted work. memset() zeroes the padding for memcmp(). */
+    struct deco_render_params params;
+    struct deco_render_params *p = &params;
+    memset(p, 0, sizeof(struct deco_render_params));
 
     /* find out which colors to use */
     if (con->urgent)
@@ -349,25 +607,24 @@ void x_draw_decoration(Con *con) {
     p->con_window_rect = (struct width_height){ w->width, w->height };
     p->con_deco_rect = con->deco_rect;
     p->background = config.client.background;
-    p->con_is_leaf = con_is_leaf(con);
+    p->con_is_leaf = leaf;
     p->parent_layout = con->parent->layout;
 
     if (con->deco_render_params != NULL &&
         (con->window == NULL || !con->window->name_x_changed) &&
         !parent->pixmap_recreated &&
         !con->pixmap_recreated &&
-        memcmp(p, con->deco_render_params, sizeof(struct deco_render_params)) == 0) {
-        free(p);
+        memcmp(p, con->deco_render_params, sizeof(struct deco_render_params)) == 0)
         goto copy_pixmaps;
-    }
 
     Con *next = con;
     while ((next = TAILQ_NEXT(next, nodes))) {
         FREE(next->deco_render_params);
     }
 
-    FREE(con->deco_render_params);
-    con->deco_render_params = p;
+    if (con->deco_render_params == NULL)
+        con->deco_render_params = smalloc(sizeof(struct deco_render_params));
+    memcpy(con->deco_render_params, p, sizeof(struct deco_render_params));
 
     if (con->window != NULL && con->window->name_x_changed)
         con->window->name_x_changed = false;
@@ -460,13 +717,6 @@ void x_draw_decoration(Con *con) {
     if (p->border_style != BS_NORMAL)
         goto copy_pixmaps;
 
-    /* 4: paint the bar */
-    xcb_change_gc(conn, parent->pm_gc, XCB_GC_FOREGROUND, (uint32_t[]){ p->color->background });
-    xcb_rectangle_t drect = { con->deco_rect.x, con->deco_rect.y, con->deco_rect.width, con->deco_rect.height };
-    xcb_poly_fill_rectangle(conn, parent->pixmap, parent->pm_gc, 1, &drect);
-
-    /* 5: draw two unconnected horizontal lines in border color */
-    xcb_change_gc(conn, parent->pm_gc, XCB_GC_FOREGROUND, (uint32_t[]){ p->color->border });
     Rect *dr = &(con->deco_rect);
     int deco_diff_l = 2;
     int deco_diff_r = 2;
@@ -483,55 +733,94 @@ void x_draw_decoration(Con *con) {
         { dr->x + deco_diff_l,                 dr->y + dr->height - 1,
           dr->x - deco_diff_r + dr->width - 1, dr->y + dr->height - 1 }
     };
-    xcb_poly_segment(conn, parent->pixmap, parent->pm_gc, 2, segments);
-
-    /* 6: draw the title */
-    set_font_colors(parent->pm_gc, p->color->text, p->color->background);
-    int text_offset_y = (con->deco_rect.height - config.font.height) / 2;
 
     struct Window *win = con->window;
+    char *title = NULL;
+    int indent_px = 0;
     if (win == NULL) {
         /* we have a split container which gets a representation
          * of its children as title
          */
-        char *title;
-        char *tree = con_get_tree_representation(con);
-        sasprintf(&title, "i3: %s", tree);
-        free(tree);
+        sasprintf(&title, "i3: %s", con_get_tree_representation(con));
+    } else if (win->name != NULL) {
+        int indent_level = 0,
+            indent_mult = 0;
+        Con *il_parent = parent;
+        if (il_parent->layout != L_STACKED) {
+            while (1) {
+                //DLOG("il_parent = %p, layout = %d\n", il_parent, il_parent->layout);
+                if (il_parent->layout == L_STACKED)
+                    indent_level++;
+                if (il_parent->type == CT_WORKSPACE || il_parent->type == CT_DOCKAREA || il_parent->type == CT_OUTPUT)
+                    break;
+                il_parent = il_parent->parent;
+                indent_mult++;
+            }
+        }
+        //DLOG("indent_level = %d, indent_mult = %d\n", indent_level, indent_mult);
+        indent_px = (indent_level * 5) * indent_mult;
+    }
 
+    /* The bar and the title only depend on these parameters, so if we have
+     * drawn the very same decoration before, we just copy it. */
+    struct deco_cache_key key = {
+        .text = p->color->text,
+        .background = p->color->background,
+        .border = p->color->border,
+        .width = dr->width,
+        .height = dr->height,
+        .depth = (parent->window ? parent->window->depth : root_depth),
+        .deco_diff_l = deco_diff_l,
+        .deco_diff_r = deco_diff_r,
+        .indent_px = indent_px,
+        .ascii = (win == NULL),
+    };
+    const char *cache_title = NULL;
+    if (win == NULL)
+        cache_title = title;
+    else if (win->name != NULL)
+        cache_title = i3string_as_utf8(win->name);
+
+    if (cache_title != NULL && dr->width > 0 && dr->height > 0) {
+        struct deco_cache_entry *entry = deco_cache_lookup(&key, cache_title);
+        if (entry != NULL) {
+            xcb_copy_area(conn, entry->pixmap, parent->pixmap, parent->pm_gc,
+                          0, 0, dr->x, dr->y, dr->width, dr->height);
+            FREE(title);
+            goto after_title;
+        }
+    }
+
+    /* 4: paint the bar */
+    xcb_change_gc(conn, parent->pm_gc, XCB_GC_FOREGROUND, (uint32_t[]){ p->color->background });
+    xcb_rectangle_t drect = { con->deco_rect.x, con->deco_rect.y, con->deco_rect.width, con->deco_rect.height };
+    xcb_poly_fill_rectangle(conn, parent->pixmap, parent->pm_gc, 1, &drect);
+
+    /* 5: draw two unconnected horizontal lines in border color */
+    xcb_change_gc(conn, parent->pm_gc, XCB_GC_FOREGROUND, (uint32_t[]){ p->color->border });
+    xcb_poly_segment(conn, parent->pixmap, parent->pm_gc, 2, segments);
+
+    /* 6: draw the title */
+    set_font_colors(parent->pm_gc, p->color->text, p->color->background);
+    int text_offset_y = (con->deco_rect.height - config.font.height) / 2;
+
+    if (win == NULL) {
         draw_text_ascii(title,
                 parent->pixmap, parent->pm_gc,
                 con->deco_rect.x + 2, con->deco_rect.y + text_offset_y,
                 con->deco_rect.width - 2);
-        free(title);
-
-        goto after_title;
-    }
-
-    if (win->name == NULL)
+    } else if (win->name != NULL) {
+        draw_text(win->name,
+                parent->pixmap, parent->pm_gc,
+                con->deco_rect.x + 2 + indent_px, con->deco_rect.y + text_offset_y,
+                con->deco_rect.width - 2 - indent_px);
+    } else {
         goto copy_pixmaps;
-
-    int indent_level = 0,
-        indent_mult = 0;
-    Con *il_parent = parent;
-    if (il_parent->layout != L_STACKED) {
-        while (1) {
-            //DLOG("il_parent = %p, layout = %d\n", il_parent, il_parent->layout);
-            if (il_parent->layout == L_STACKED)
-                indent_level++;
-            if (il_parent->type == CT_WORKSPACE || il_parent->type == CT_DOCKAREA || il_parent->type == CT_OUTPUT)
-                break;
-            il_parent = il_parent->parent;
-            indent_mult++;
-        }
     }
-    //DLOG("indent_level = %d, indent_mult = %d\n", indent_level, indent_mult);
-    int indent_px = (indent_level * 5) * indent_mult;
 
-    draw_text(win->name,
-            parent->pixmap, parent->pm_gc,
-            con->deco_rect.x + 2 + indent_px, con->deco_rect.y + text_offset_y,
-            con->deco_rect.width - 2 - indent_px);
+    if (dr->width > 0 && dr->height > 0)
+        deco_cache_store(&key, cache_title, parent->pixmap, parent->pm_gc, dr->x, dr->y);
+    FREE(title);
 
 after_title:
     /* Since we don’t clip the text at all, it might in some cases be painted
@@ -575,6 +864,11 @@ void x_deco_recurse(Con *con) {
                 TAILQ_EMPTY(&(con->floating_head));
     con_state *state = state_for_frame(con->frame);
 
+    /* Subtrees which x_push_node() skipped are not visible, their
+     * decorations will be drawn once they are shown again. */
+    if (state->skipped)
+        return;
+
     if (!leaf) {
         TAILQ_FOREACH(current, &(con->nodes_head), nodes)
             x_deco_recurse(current);
@@ -605,6 +899,18 @@ void x_push_node(Con *con) {
     //DLOG("Pushing changes for node %p / %s\n", con, con->name);
     state = state_for_frame(con->frame);
 
+    /* A subtree which is not visible now, was not visible during the last
+     * push and did not change in between (think of all the workspaces which
+     * are not currently shown) has nothing to push. Neither has an output on
+     * which nothing changed (see tree_render()). */
+    state->skipped = (con->render_skip ||
+                      (!con->dirty && !con->rendered && !state->was_rendered &&
+                       !state->initial && !state->need_reparent &&
+                       !state->unmap_now && state->name == NULL));
+    if (state->skipped)
+        return;
+    state->was_rendered = con->rendered;
+
     if (state->name != NULL) {
         DLOG("pushing name %s for con %p\n", state->name, con);
 
@@ -657,6 +963,8 @@ void x_push_node(Con *con) {
     }
 
     bool fake_notify = false;
+    /* Whether the new size of the client was held back, see below. */
+    bool sync_deferred = false;
     /* Set new position if rect changed (and if height > 0) */
     if (memcmp(&(state->rect), &rect, sizeof(Rect)) != 0 &&
         rect.height > 0) {
@@ -720,14 +1028,32 @@ void x_push_node(Con *con) {
         fake_notify = true;
     }
 
-    /* dito, but for child windows */
+    /* dito, but for child windows. Clients in hidden stacked/tabbed
+     * containers are only resized (and told about their new position) once
+     * they become visible, which saves them from relayouting every tab
+     * whenever the container is resized. */
     if (con->window != NULL &&
         memcmp(&(state->window_rect), &(con->window_rect), sizeof(Rect)) != 0) {
-        DLOG("setting window rect (%d, %d, %d, %d)\n",
-            con->window_rect.x, con->window_rect.y, con->window_rect.width, con->window_rect.height);
-        xcb_set_window_rect(conn, con->window->id, con->window_rect);
-        memcpy(&(state->window_rect), &(con->window_rect), sizeof(Rect));
-        fake_notify = true;
+        if (con->hidden) {
+            state->notify_pending = true;
+        } else if (sync_request_pending(con->window)) {
+            /* The client did not redraw itself in the size it got last time
+             * yet. It gets the most recent size once it did, so that slow
+             * clients do not pile up work for outdated sizes during
+             * interactive resizing (see sync_request.c). The fake
+             * ConfigureNotify is sent along with that size. */
+            DLOG("holding back window rect until the client is in sync\n");
+            sync_deferred = true;
+        } else {
+            DLOG("setting window rect (%d, %d, %d, %d)\n",
+                con->window_rect.x, con->window_rect.y, con->window_rect.width, con->window_rect.height);
+            if (state->window_rect.width != con->window_rect.width ||
+                state->window_rect.height != con->window_rect.height)
+                sync_request_send(con->window);
+            xcb_set_window_rect(conn, con->window->id, con->window_rect);
+            memcpy(&(state->window_rect), &(con->window_rect), sizeof(Rect));
+            fake_notify = true;
+        }
     }
 
     /* Map if map state changed, also ensure that the child window
@@ -741,9 +1067,7 @@ void x_push_node(Con *con) {
         if (con->window != NULL) {
             /* Set WM_STATE_NORMAL because GTK applications don’t want to
              * drag & drop if we don’t. Also, xprop(1) needs it. */
-            long data[] = { XCB_ICCCM_WM_STATE_NORMAL, XCB_NONE };
-            xcb_change_property(conn, XCB_PROP_MODE_REPLACE, con->window->id,
-                                A_WM_STATE, A_WM_STATE, 32, 2, data);
+            x_set_wm_state(con, state, XCB_ICCCM_WM_STATE_NORMAL);
         }
 
         uint32_t values[1];
@@ -763,22 +1087,37 @@ void x_push_node(Con *con) {
         values[0] = FRAME_EVENT_MASK;
         xcb_change_window_attributes(conn, con->frame, XCB_CW_EVENT_MASK, values);
 
-        /* copy the pixmap contents to the frame window immediately after mapping */
+        /* copy the pixmap contents to the frame window immediately after
+         * mapping. Not flushing here sends the maps of all frames (think of
+         * switching workspaces) in one batch with x_push_changes(), before
+         * the frames of the old workspace are unmapped. */
         if (con->pixmap != XCB_NONE)
             xcb_copy_area(conn, con->pixmap, con->frame, con->pm_gc, 0, 0, 0, 0, con->rect.width, con->rect.height);
-        xcb_flush(conn);
 
         DLOG("mapping container %08x (serial %d)\n", con->frame, cookie.sequence);
         state->mapped = con->mapped;
     }
 
     state->unmap_now = (state->mapped != con->mapped) && !con->mapped;
+    if (state->unmap_now) {
+        if (unmap_states_num == unmap_states_capacity) {
+            unmap_states_capacity = (unmap_states_capacity == 0 ? 16 : unmap_states_capacity * 2);
+            unmap_states = srealloc(unmap_states, unmap_states_capacity * sizeof(con_state *));
+        }
+        unmap_states[unmap_states_num++] = state;
+    }
 
-    if (fake_notify) {
-        DLOG("Sending fake configure notify\n");
-        fake_absolute_configure_notify(con);
+    if (con->hidden) {
+        state->notify_pending |= fake_notify;
+        fake_notify = false;
+    } else if (state->notify_pending) {
+        fake_notify = true;
+        state->notify_pending = false;
     }
 
+    if (fake_notify && !sync_deferred && con->window != NULL)
+        x_notify_client(con, state);
+
     /* Handle all children and floating windows of this node. We recurse
      * in focus order to display the focused client in a stack first when
      * switching workspaces (reduces flickering). */
@@ -801,6 +1140,8 @@ static void x_push_node_unmaps(Con *con) {
 
     //DLOG("Pushing changes (with unmaps) for node %p / %s\n", con, con->name);
     state = state_for_frame(con->frame);
+    if (state->skipped)
+        return;
 
     /* map/unmap if map state changed, also ensure that the child window
      * is changed if we are mapped *and* in initial state (meaning the
@@ -809,9 +1150,7 @@ static void x_push_node_unmaps(Con *con) {
         xcb_void_cookie_t cookie;
         if (con->window != NULL) {
             /* Set WM_STATE_WITHDRAWN, it seems like Java apps need it */
-            long data[] = { XCB_ICCCM_WM_STATE_WITHDRAWN, XCB_NONE };
-            xcb_change_property(conn, XCB_PROP_MODE_REPLACE, con->window->id,
-                                A_WM_STATE, A_WM_STATE, 32, 2, data);
+            x_set_wm_state(con, state, XCB_ICCCM_WM_STATE_WITHDRAWN);
         }
 
         cookie = xcb_unmap_window(conn, con->frame);
@@ -834,6 +1173,113 @@ static void x_push_node_unmaps(Con *con) {
         x_push_node_unmaps(current);
 }
 
+/*
+ * Pushes the order of state_head to X11 with as few restacking requests as
+ * possible: the longest sequence of windows whose relative order did not
+ * change (compared to old_state_head) stays where it is, and only the other
+ * windows are put above their new lower neighbour. Raising one window thus
+ * costs one request instead of one for every window above it.
+ *
+ */
+static void restack_windows(void) {
+    con_state *state;
+    int n = 0;
+    CIRCLEQ_FOREACH_REVERSE(state, &old_state_head, old_state)
+        state->old_position = n++;
+
+    if (n > stack_capacity) {
+        stack_capacity = n;
+        stack_order = srealloc(stack_order, sizeof(con_state *) * n);
+        lis_tails = srealloc(lis_tails, sizeof(int) * n);
+        lis_prev = srealloc(lis_prev, sizeof(int) * n);
+    }
+
+    /* X11 correctly represents the stack if we push it from bottom to top */
+    int i = 0;
+    CIRCLEQ_FOREACH_REVERSE(state, &state_head, state) {
+        state->keep_position = false;
+        stack_order[i++] = state;
+    }
+
+    /* Longest increasing subsequence of the old positions, in O(n log n).
+     * lis_tails[l] is the index of the smallest possible last element of an
+     * increasing subsequence of length l + 1. New windows don’t have a
+     * position yet, so they are never kept. */
+    int length = 0;
+    for (i = 0; i < n; i++) {
+        if (stack_order[i]->initial)
+            continue;
+
+        int position = stack_order[i]->old_position;
+        int low = 0, high = length;
+        while (low < high) {
+            int mid = (low + high) / 2;
+            if (stack_order[lis_tails[mid]]->old_position < position)
+                low = mid + 1;
+            else high = mid;
+        }
+        lis_prev[i] = (low > 0 ? lis_tails[low - 1] : -1);
+        lis_tails[low] = i;
+        if (low == length)
+            length++;
+    }
+    for (i = (length > 0 ? lis_tails[length - 1] : -1); i != -1; i = lis_prev[i])
+        stack_order[i]->keep_position = true;
+
+    for (i = 0; i < n; i++) {
+        state = stack_order[i];
+        if (state->keep_position) {
+            state->initial = false;
+            continue;
+        }
+
+        uint32_t mask = XCB_CONFIG_WINDOW_SIBLING | XCB_CONFIG_WINDOW_STACK_MODE;
+        uint32_t values[2];
+        if (i > 0) {
+            values[0] = stack_order[i - 1]->id;
+            values[1] = XCB_STACK_MODE_ABOVE;
+        } else {
+            /* The lowest window goes below the lowest window which stays. */
+            int lowest = 1;
+            while (lowest < n && !stack_order[lowest]->keep_position)
+                lowest++;
+            if (lowest == n) {
+                state->initial = false;
+                continue;
+            }
+            values[0] = stack_order[lowest]->id;
+            values[1] = XCB_STACK_MODE_BELOW;
+        }
+
+        //DLOG("Restacking 0x%08x\n", state->id);
+        xcb_configure_window(conn, state->id, mask, values);
+        state->initial = false;
+    }
+}
+
+/*
+ * Returns true if the window stack (state_head) is still in the order which
+ * was pushed last time (old_state_head) and contains no new windows. This is
+ * the case for most renders (e.g. title or focus changes within a workspace),
+ * which can then skip restacking.
+ *
+ */
+static bool stack_unchanged(void) {
+    con_state *state = CIRCLEQ_FIRST(&state_head);
+    con_state *old = CIRCLEQ_FIRST(&old_state_head);
+
+    while (state != CIRCLEQ_END(&state_head) &&
+           old != CIRCLEQ_END(&old_state_head)) {
+        if (state != old || state->initial)
+            return false;
+        state = CIRCLEQ_NEXT(state, state);
+        old = CIRCLEQ_NEXT(old, old_state);
+    }
+
+    return (state == CIRCLEQ_END(&state_head) &&
+            old == CIRCLEQ_END(&old_state_head));
+}
+
 /*
  * Pushes all changes (state of each node, see x_push_node() and the window
  * stack) to X11.
@@ -848,6 +1294,7 @@ static void x_push_node_unmaps(Con *con) {
 void x_push_changes(Con *con) {
     con_state *state;
     xcb_query_pointer_cookie_t pointercookie;
+    uint64_t start = stats_now();
 
     /* If we need to warp later, we request the pointer position as soon as possible */
     if (warp_to) {
@@ -855,59 +1302,44 @@ void x_push_changes(Con *con) {
     }
 
     DLOG("-- PUSHING WINDOW STACK --\n");
-    //DLOG("Disabling EnterNotify\n");
-    uint32_t values[1] = { XCB_NONE };
-    CIRCLEQ_FOREACH_REVERSE(state, &state_head, state) {
-        if (state->mapped)
-            xcb_change_window_attributes(conn, state->id, XCB_CW_EVENT_MASK, values);
-    }
-    //DLOG("Done, EnterNotify disabled\n");
-    bool order_changed = false;
-    bool stacking_changed = false;
+    /* Restacking, moving or mapping windows and warping the pointer generates
+     * EnterNotify events which would mess up the focus. Instead of disabling
+     * them on every mapped frame (twice per frame and push, no matter how
+     * much changed), we ignore all EnterNotify events caused by the requests
+     * between these two NoOperation requests. */
+    xcb_void_cookie_t first_cookie = xcb_no_operation(conn);
+    uint32_t values[1];
+    const bool restack = !stack_unchanged();
+    if (restack)
+        restack_windows();
 
-    /* count first, necessary to (re)allocate memory for the bottom-to-top
-     * stack afterwards */
     int cnt = 0;
-    CIRCLEQ_FOREACH_REVERSE(state, &state_head, state)
-        if (state->con && state->con->window)
-            cnt++;
-
-    if (cnt != btt_stack_num) {
-        btt_stack = srealloc(btt_stack, sizeof(xcb_window_t) * cnt);
-        btt_stack_num = cnt;
-    }
-
-    xcb_window_t *walk = btt_stack;
-
-    /* X11 correctly represents the stack if we push it from bottom to top */
     CIRCLEQ_FOREACH_REVERSE(state, &state_head, state) {
-        if (state->con && state->con->window)
-            memcpy(walk++, &(state->con->window->id), sizeof(xcb_window_t));
-
-        //DLOG("stack: 0x%08x\n", state->id);
-        con_state *prev = CIRCLEQ_PREV(state, state);
-        con_state *old_prev = CIRCLEQ_PREV(state, old_state);
-        if (prev != old_prev)
-            order_changed = true;
-        if ((state->initial || order_changed) && prev != CIRCLEQ_END(&state_head)) {
-            stacking_changed = true;
-            //DLOG("Stacking 0x%08x above 0x%08x\n", prev->id, state->id);
-            uint32_t mask = 0;
-            mask |= XCB_CONFIG_WINDOW_SIBLING;
-            mask |= XCB_CONFIG_WINDOW_STACK_MODE;
-            uint32_t values[] = {state->id, XCB_STACK_MODE_ABOVE};
-
-            xcb_configure_window(conn, prev->id, mask, values);
+        if (!state->con || !state->con->window)
+            continue;
+        if (cnt == btt_stack_capacity) {
+            btt_stack_capacity = (btt_stack_capacity == 0 ? 32 : btt_stack_capacity * 2);
+            btt_stack = srealloc(btt_stack, sizeof(xcb_window_t) * btt_stack_capacity);
+            new_btt_stack = srealloc(new_btt_stack, sizeof(xcb_window_t) * btt_stack_capacity);
         }
-        state->initial = false;
+        new_btt_stack[cnt++] = state->con->window->id;
     }
 
-    /* If we re-stacked something (or a new window appeared), we need to update
-     * the _NET_CLIENT_LIST_STACKING hint */
-    if (stacking_changed)
+    /* Only update the _NET_CLIENT_LIST_STACKING hint when it changed, every
+     * write wakes up all pagers and taskbars. */
+    if (cnt != btt_stack_num ||
+        memcmp(new_btt_stack, btt_stack, sizeof(xcb_window_t) * cnt) != 0) {
+        xcb_window_t *tmp = btt_stack;
+        btt_stack = new_btt_stack;
+        new_btt_stack = tmp;
+        btt_stack_num = cnt;
         ewmh_update_client_list_stacking(btt_stack, btt_stack_num);
+    }
 
     DLOG("PUSHING CHANGES\n");
+    /* States collected by calls outside of x_push_changes() might have been
+     * freed since, they are collected again below if still necessary. */
+    unmap_states_num = 0;
     x_push_node(con);
 
     if (warp_to) {
@@ -930,13 +1362,17 @@ void x_push_changes(Con *con) {
         warp_to = NULL;
     }
 
-    //DLOG("Re-enabling EnterNotify\n");
-    values[0] = FRAME_EVENT_MASK;
-    CIRCLEQ_FOREACH_REVERSE(state, &state_head, state) {
-        if (state->mapped)
-            xcb_change_window_attributes(conn, state->id, XCB_CW_EVENT_MASK, values);
+    if (frames_masked) {
+        values[0] = FRAME_EVENT_MASK;
+        CIRCLEQ_FOREACH_REVERSE(state, &state_head, state) {
+            if (state->mapped)
+                xcb_change_window_attributes(conn, state->id, XCB_CW_EVENT_MASK, values);
+        }
+        frames_masked = false;
     }
-    //DLOG("Done, EnterNotify re-enabled\n");
+
+    xcb_void_cookie_t last_cookie = xcb_no_operation(conn);
+    add_ignore_event_range(first_cookie.sequence, last_cookie.sequence, XCB_ENTER_NOTIFY);
 
     x_deco_recurse(con);
 
@@ -947,8 +1383,11 @@ void x_push_changes(Con *con) {
     if (focused_id != to_focus) {
         if (!focused->mapped) {
             DLOG("Not updating focus (to %p / %s), focused window is not mapped.\n", focused, focused->name);
-            /* Invalidate focused_id to correctly focus new windows with the same ID */
-            focused_id = XCB_NONE;
+            /* Invalidate focused_id to correctly focus new windows with the
+             * same ID. If the root window already got the focus for this
+             * reason, there is no need to set it again below. */
+            if (focused_id != root)
+                focused_id = XCB_NONE;
         } else {
             bool set_focus = true;
             if (focused->window != NULL &&
@@ -999,25 +1438,32 @@ void x_push_changes(Con *con) {
      * unmapped, the second one appears under the cursor and therefore gets an
      * EnterNotify event. */
     values[0] = FRAME_EVENT_MASK & ~XCB_EVENT_MASK_ENTER_WINDOW;
-    CIRCLEQ_FOREACH_REVERSE(state, &state_head, state) {
-        if (!state->unmap_now)
-            continue;
-        xcb_change_window_attributes(conn, state->id, XCB_CW_EVENT_MASK, values);
-    }
+    for (int i = 0; i < unmap_states_num; i++)
+        xcb_change_window_attributes(conn, unmap_states[i]->id, XCB_CW_EVENT_MASK, values);
+    unmap_states_num = 0;
 
     /* Push all pending unmaps */
     x_push_node_unmaps(con);
 
     /* save the current stack as old stack */
-    CIRCLEQ_FOREACH(state, &state_head, state) {
-        CIRCLEQ_REMOVE(&old_state_head, state, old_state);
-        CIRCLEQ_INSERT_TAIL(&old_state_head, state, old_state);
+    if (restack) {
+        CIRCLEQ_FOREACH(state, &state_head, state) {
+            CIRCLEQ_REMOVE(&old_state_head, state, old_state);
+            CIRCLEQ_INSERT_TAIL(&old_state_head, state, old_state);
+        }
     }
     //CIRCLEQ_FOREACH(state, &old_state_head, old_state) {
     //    DLOG("old stack: 0x%08x\n", state->id);
     //}
 
+    /* Now that the remaining containers cover the space of the closed ones,
+     * their frames can go. */
+    for (int i = 0; i < dead_frames_num; i++)
+        xcb_destroy_window(conn, dead_frames[i]);
+    dead_frames_num = 0;
+
     xcb_flush(conn);
+    stats_record(&stats_x_push_changes, start);
 }
 
 /*
@@ -1050,6 +1496,7 @@ void x_set_name(Con *con, const char *name) {
 
     FREE(state->name);
     state->name = sstrdup(name);
+    con_mark_dirty(con);
 }
 
 /*
@@ -1062,6 +1509,16 @@ void update_shmlog_atom() {
             strlen(shmlogname), shmlogname);
 }
 
+/*
+ * Set up the I3_SHMTREE_PATH atom.
+ *
+ */
+void update_shmtree_atom(void) {
+    xcb_change_property(conn, XCB_PROP_MODE_REPLACE, root,
+            A_I3_SHMTREE_PATH, A_UTF8_STRING, 8,
+            strlen(shmtreename), shmtreename);
+}
+
 /*
  * Sets up i3 specific atoms (I3_SOCKET_PATH and I3_CONFIG_PATH)
  *
@@ -1075,6 +1532,7 @@ void x_set_i3_atoms(void) {
     xcb_change_property(conn, XCB_PROP_MODE_REPLACE, root, A_I3_CONFIG_PATH, A_UTF8_STRING, 8,
                         strlen(current_configpath), current_configpath);
     update_shmlog_atom();
+    update_shmtree_atom();
 }
 
 /*
@@ -1090,12 +1548,15 @@ void x_set_warp_to(Rect *rect)
 /*
  * Applies the given mask to the event mask of every i3 window decoration X11
  * window. This is useful to disable EnterNotify while resizing so that focus
- * is untouched.
+ * is untouched. The next x_push_changes() enables EnterNotify again.
  *
  */
 void x_mask_event_mask(uint32_t mask) {
     uint32_t values[] = { FRAME_EVENT_MASK & mask };
 
+    if ((mask & XCB_EVENT_MASK_ENTER_WINDOW) == 0)
+        frames_masked = true;
+
     con_state *state;
     CIRCLEQ_FOREACH_REVERSE(state, &state_head, state) {
         if (state->mapped)
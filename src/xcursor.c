@@ -26,26 +26,32 @@ static const int xcb_cursors[XCURSOR_CURSOR_MAX] = {
     XCB_CURSOR_WATCH
 };
 
+/* Names of the cursors in the cursor theme. */
+static const char *cursor_names[XCURSOR_CURSOR_MAX] = {
+    [XCURSOR_CURSOR_POINTER] = "left_ptr",
+    [XCURSOR_CURSOR_RESIZE_HORIZONTAL] = "sb_h_double_arrow",
+    [XCURSOR_CURSOR_RESIZE_VERTICAL] = "sb_v_double_arrow",
+    [XCURSOR_CURSOR_TOP_LEFT_CORNER] = "top_left_corner",
+    [XCURSOR_CURSOR_TOP_RIGHT_CORNER] = "top_right_corner",
+    [XCURSOR_CURSOR_BOTTOM_LEFT_CORNER] = "bottom_left_corner",
+    [XCURSOR_CURSOR_BOTTOM_RIGHT_CORNER] = "bottom_right_corner",
+    [XCURSOR_CURSOR_WATCH] = "watch",
+    [XCURSOR_CURSOR_MOVE] = "fleur"
+};
+
+/*
+ * Sets up the cursor context. The cursors themselves are only loaded when
+ * they are used for the first time (see xcursor_get_cursor()), because
+ * loading a cursor from the theme involves reading files and a round trip to
+ * the X server, and most of them are rarely needed.
+ *
+ */
 void xcursor_load_cursors(void) {
     if (xcb_cursor_context_new(conn, root_screen, &ctx) < 0) {
         ELOG("xcursor support unavailable\n");
         xcursor_supported = false;
         return;
     }
-#define LOAD_CURSOR(constant, name) \
-    do { \
-        cursors[constant] = xcb_cursor_load_cursor(ctx, name); \
-    } while (0)
-    LOAD_CURSOR(XCURSOR_CURSOR_POINTER, "left_ptr");
-    LOAD_CURSOR(XCURSOR_CURSOR_RESIZE_HORIZONTAL, "sb_h_double_arrow");
-    LOAD_CURSOR(XCURSOR_CURSOR_RESIZE_VERTICAL, "sb_v_double_arrow");
-    LOAD_CURSOR(XCURSOR_CURSOR_WATCH, "watch");
-    LOAD_CURSOR(XCURSOR_CURSOR_MOVE, "fleur");
-    LOAD_CURSOR(XCURSOR_CURSOR_TOP_LEFT_CORNER, "top_left_corner");
-    LOAD_CURSOR(XCURSOR_CURSOR_TOP_RIGHT_CORNER, "top_right_corner");
-    LOAD_CURSOR(XCURSOR_CURSOR_BOTTOM_LEFT_CORNER, "bottom_left_corner");
-    LOAD_CURSOR(XCURSOR_CURSOR_BOTTOM_RIGHT_CORNER, "bottom_right_corner");
-#undef LOAD_CURSOR
 }
 
 /*
@@ -62,6 +68,8 @@ void xcursor_set_root_cursor(int cursor_id) {
 
 xcb_cursor_t xcursor_get_cursor(enum xcursor_cursor_t c) {
     assert(c >= 0 && c < XCURSOR_CURSOR_MAX);
+    if (cursors[c] == XCB_NONE)
+        cursors[c] = xcb_cursor_load_cursor(ctx, cursor_names[c]);
     return cursors[c];
 }
 
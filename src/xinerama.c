@@ -73,6 +73,7 @@ static void query_screens(xcb_connection_t *conn) {
             init_ws_for_output(s, output_get_content(s->con));
             num_screens++;
         }
+        randr_invalidate_output_index();
 
         DLOG("found Xinerama screen: %d x %d at %d x %d\n",
                         screen_info[screen].width, screen_info[screen].height,
@@ -0,0 +1,98 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • http://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • http://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • http://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Benchmarks the tree operations on trees of 10, 100 and 1000 containers. This
+# file is not part of the regular testsuite; run it explicitly:
+#
+#   ./complete-run.pl bench/100-tree-operations.t
+#
+# The durations are measured by i3 itself (see GET_STATS in docs/ipc), so they
+# do not include the IPC round trips. See i3test::Bench for where the results
+# end up and how to compare them to a baseline.
+use i3test;
+use i3test::Bench;
+use File::Temp qw(tempfile);
+use JSON::XS;
+
+my $i3 = i3(get_socket_path());
+$i3->connect->recv;
+
+my $iterations = 20;
+
+sub record {
+    my ($size, $operation, $category, $name) = @_;
+    bench_result("$operation/$size", stats_average_us($category, $name));
+}
+
+# A tabbed container with one vertically split container per two placeholders,
+# so that rendering the tabs needs con_get_tree_representation().
+sub write_layout {
+    my ($size) = @_;
+    my @groups = map {
+        {
+            layout => 'splitv',
+            nodes => [ map { { swallows => [ { class => "^bench$_\$" } ] } } (1 .. 2) ],
+        }
+    } (1 .. $size / 2);
+    my ($fh, $filename) = tempfile('/tmp/i3-bench-XXXXXX', UNLINK => 1);
+    print $fh encode_json({ layout => 'tabbed', nodes => \@groups });
+    close($fh);
+    return $filename;
+}
+
+for my $size (10, 100, 1000) {
+    my $tmp = fresh_workspace;
+    my $filename = write_layout($size);
+
+    # tree_append_json(), including rendering the new containers.
+    reset_stats;
+    cmd "append_layout $filename";
+    record($size, 'append_layout', 'command', 'cmd_append_layout');
+
+    my $top = get_ws($tmp)->{nodes}->[0];
+    is(scalar @{$top->{nodes}}, $size / 2, 'layout appended');
+
+    # render_con() and x_push_changes() for every change of the layout.
+    reset_stats;
+    for (1 .. $iterations) {
+        cmd "[con_id=$top->{id}] layout stacking";
+        cmd "[con_id=$top->{id}] layout tabbed";
+    }
+    record($size, 'render_con', 'render', 'tree_render');
+    record($size, 'x_push_changes', 'render', 'x_push_changes');
+
+    # dump_node() for the whole tree.
+    reset_stats;
+    $i3->get_tree->recv for (1 .. $iterations);
+    record($size, 'dump_node', 'ipc', 'GET_TREE');
+
+    # con_detach() and con_attach() when moving a container, followed by
+    # tree_flatten().
+    my $leaf = $top->{nodes}->[0]->{nodes}->[0];
+    cmd "[con_id=$leaf->{id}] focus";
+    reset_stats;
+    for (1 .. $iterations) {
+        cmd 'move down';
+        cmd 'move up';
+    }
+    record($size, 'move', 'command', 'cmd_move_direction');
+
+    cmd "[con_id=$top->{id}] kill";
+}
+
+bench_done;
+
+done_testing;
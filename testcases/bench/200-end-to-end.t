@@ -0,0 +1,75 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • http://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • http://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • http://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Measures the wall-clock latency of realistic scenarios, as seen by a client:
+# opening many windows, switching workspaces, IPC round trips, GET_TREE on a
+# large tree and restarting. This file is not part of the regular testsuite;
+# run it explicitly:
+#
+#   ./complete-run.pl bench/200-end-to-end.t
+#
+# See i3test::Bench for where the results end up and how to compare them to a
+# baseline.
+use i3test;
+use i3test::Bench;
+
+my $i3 = i3(get_socket_path());
+$i3->connect->recv;
+
+my $num_windows = 200;
+my $iterations = 20;
+
+################################################################################
+# Opening windows, until they are mapped.
+################################################################################
+
+my $first_ws = fresh_workspace;
+my @windows;
+my $us = measure_us(sub { push @windows, open_window for (1 .. $num_windows / 2) });
+
+my $second_ws = fresh_workspace;
+$us += measure_us(sub { push @windows, open_window for (1 .. $num_windows / 2) });
+bench_result("open $num_windows windows", $us);
+
+################################################################################
+# Switching between two workspaces with 100 windows each.
+################################################################################
+
+bench_result('switch workspace', measure_us(sub {
+    cmd "workspace $first_ws";
+    cmd "workspace $second_ws";
+    sync_with_i3;
+}, $iterations) / 2);
+
+################################################################################
+# IPC round trips.
+################################################################################
+
+bench_result('command round trip', measure_us(sub { cmd 'nop' }, 100));
+bench_result('GET_TREE', measure_us(sub { $i3->get_tree->recv }, $iterations));
+
+################################################################################
+# Restarting, until i3 answers IPC requests again.
+################################################################################
+
+bench_result("restart with $num_windows windows", measure_us(sub {
+    cmd 'restart';
+    does_i3_live;
+}));
+
+bench_done;
+
+done_testing;
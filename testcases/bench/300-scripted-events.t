@@ -0,0 +1,144 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • http://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • http://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • http://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Runs a script of window events and IPC commands against i3 on fake outputs
+# and reports, per phase of the script, how much time i3 spent in its event
+# handlers, IPC handlers, commands and rendering (as measured by i3 itself, see
+# GET_STATS in docs/ipc). Like the regular testsuite, this runs on Xdummy, so
+# no real display is involved, and the X server latency is not part of the i3
+# timings. This file is not part of the regular testsuite; run it explicitly:
+#
+#   ./complete-run.pl bench/300-scripted-events.t
+#
+# The script defaults to bench/scripts/default.txt. Set I3_BENCH_SCRIPT to use
+# another one. Each line contains one of:
+#
+#   outputs <spec>           fake-outputs to start i3 with (before any phase)
+#   phase <name>             starts a new phase
+#   map <n>                  opens and maps n windows
+#   unmap <n>                unmaps the n most recently opened windows
+#   configure <n>            sends n ConfigureRequests for every window
+#   property <n>             changes the title (_NET_WM_NAME) of every window
+#                            n times
+#   cmd <n> <command>        runs the command n times
+#   get_tree <n>             requests the tree n times
+#   get_workspaces <n>       requests the workspaces n times
+#
+# See i3test::Bench for where the results end up and how to compare them to a
+# baseline.
+use i3test i3_autostart => 0;
+use i3test::Bench;
+
+my $script = $ENV{I3_BENCH_SCRIPT} // 'bench/scripts/default.txt';
+open(my $fh, '<', $script) or die "open($script): $!";
+my @lines = grep { !/^\s*(#|$)/ } map { chomp; $_ } <$fh>;
+close($fh);
+
+my $outputs = '1024x768+0+0';
+while (@lines && $lines[0] =~ /^outputs\s+(\S+)/) {
+    $outputs = $1;
+    shift @lines;
+}
+
+my $config = <<EOT;
+# i3 config file (v4)
+font -misc-fixed-medium-r-normal--13-120-75-75-C-70-iso10646-1
+fake-outputs $outputs
+EOT
+
+my $pid = launch_with_config($config);
+my $i3 = i3(get_socket_path());
+$i3->connect->recv;
+
+my @windows;
+my $serial = 0;
+
+my %actions = (
+    map => sub {
+        my ($n) = @_;
+        push @windows, open_window(name => 'bench ' . $serial++) for (1 .. $n);
+    },
+    unmap => sub {
+        my ($n) = @_;
+        $_->unmap for splice(@windows, -$n);
+        sync_with_i3;
+    },
+    configure => sub {
+        my ($n) = @_;
+        for my $i (1 .. $n) {
+            $_->rect(X11::XCB::Rect->new(x => 0, y => 0, width => 100 + $i, height => 100 + $i))
+                for @windows;
+        }
+        sync_with_i3;
+    },
+    property => sub {
+        my ($n) = @_;
+        for my $i (1 .. $n) {
+            $_->name('bench ' . $serial++) for @windows;
+        }
+        sync_with_i3;
+    },
+    cmd => sub {
+        my ($n, $command) = @_;
+        cmd $command for (1 .. $n);
+    },
+    get_tree => sub {
+        my ($n) = @_;
+        $i3->get_tree->recv for (1 .. $n);
+    },
+    get_workspaces => sub {
+        my ($n) = @_;
+        $i3->get_workspaces->recv for (1 .. $n);
+    },
+);
+
+my @phases;
+for my $line (@lines) {
+    if ($line =~ /^phase\s+(\S+)/) {
+        push @phases, { name => $1, steps => [] };
+        next;
+    }
+    my ($action, $n, $args) = ($line =~ /^(\S+)\s+(\d+)\s*(.*)$/);
+    die "$script: cannot parse \"$line\"" unless defined($action) && exists($actions{$action});
+    die "$script: \"$line\" is not part of a phase" unless @phases;
+    push @{$phases[-1]->{steps}}, [ $actions{$action}, $n, $args ];
+}
+
+cmd 'workspace bench-1';
+
+for my $phase (@phases) {
+    my $name = $phase->{name};
+    reset_stats;
+    my $us = measure_us(sub { $_->[0]->($_->[1], $_->[2]) for @{$phase->{steps}} });
+    sync_with_i3;
+
+    bench_result("$name/wall-clock", $us);
+    bench_result("$name/$_", stats_total_us($_)) for qw(event ipc command render);
+
+    # The details which add up to the totals above.
+    my $stats = $i3->message(10, '')->recv;
+    for my $entry (sort { $b->{total_us} <=> $a->{total_us} } @$stats) {
+        next unless $entry->{count} > 0;
+        diag(sprintf("    %-8s %-30s %8d × %10.1f µs", $entry->{category}, $entry->{name},
+                     $entry->{count}, $entry->{total_us} / $entry->{count}));
+    }
+}
+
+bench_done;
+
+exit_gracefully($pid);
+
+done_testing;
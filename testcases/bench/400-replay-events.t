@@ -0,0 +1,185 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • http://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • http://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • http://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Replays a recording made with i3 --record-events <file> as fast as possible
+# and reports how long the replay took and how much time i3 spent in its event
+# handlers, IPC handlers, commands and rendering (see GET_STATS in docs/ipc).
+# This file is not part of the regular testsuite; run it explicitly:
+#
+#   I3_REPLAY_EVENTS=/tmp/i3.events ./complete-run.pl bench/400-replay-events.t
+#
+# The recording does not contain the replies i3 got from the X server, so the
+# events cannot be fed to i3 directly. Instead, this script acts like the
+# clients did:
+#
+#   MapRequest        creates a window (once per recorded window) and maps it
+#   UnmapNotify       unmaps the window if the event was synthetic (ICCCM
+#                     withdrawal); the other UnmapNotify events are caused by
+#                     i3 itself and happen again on their own
+#   DestroyNotify     destroys the window
+#   ConfigureRequest  sets the recorded geometry
+#   PropertyNotify    changes the title if the property is WM_NAME or
+#                     _NET_WM_NAME
+#   ClientMessage     sends the message again (with the window and, for
+#                     _NET_WM_STATE, the atoms translated)
+#   commands          (key bindings and IPC) are sent via IPC
+#
+# Everything else (e.g. the window class or other properties) is not part of
+# the recording, so for_window rules and assignments which depend on it do not
+# match during the replay.
+use i3test;
+use i3test::Bench;
+
+plan skip_all => 'set I3_REPLAY_EVENTS to a recording made with --record-events'
+    unless defined($ENV{I3_REPLAY_EVENTS});
+
+my $file = $ENV{I3_REPLAY_EVENTS};
+open(my $fh, '<:raw', $file) or die "open($file): $!";
+my $data = do { local $/; <$fh> };
+close($fh);
+
+################################################################################
+# Parse the recording (see src/event_record.c for the format).
+################################################################################
+
+my @records;
+my %atom_names;
+my $pos = 0;
+while ($pos < length($data)) {
+    my $kind = substr($data, $pos, 1);
+    if ($kind eq 'i') {
+        my ($magic, $version) = unpack('a4 L', substr($data, $pos, 8));
+        die "$file: not an event recording" unless $magic eq 'i3ev';
+        die "$file: unsupported version $version" unless $version == 1;
+        $pos += 8;
+    } elsif ($kind eq 'E') {
+        push @records, [ 'event', substr($data, $pos + 9, 32) ];
+        $pos += 1 + 8 + 32;
+    } elsif ($kind eq 'A') {
+        my ($atom, $len) = unpack('L S', substr($data, $pos + 1, 6));
+        $atom_names{$atom} = substr($data, $pos + 7, $len);
+        $pos += 1 + 6 + $len;
+    } elsif ($kind eq 'C') {
+        my $len = unpack('L', substr($data, $pos + 9, 4));
+        push @records, [ 'command', substr($data, $pos + 13, $len) ];
+        $pos += 1 + 8 + 4 + $len;
+    } else {
+        die "$file: unknown record at offset $pos";
+    }
+}
+
+################################################################################
+# Replay it.
+################################################################################
+
+my $i3 = i3(get_socket_path());
+my %windows;
+my $replayed = 0;
+my $skipped = 0;
+
+sub translate_atom {
+    my ($atom) = @_;
+    my $name = $atom_names{$atom};
+    return 0 unless defined($name);
+    return $x->atom(name => $name)->id;
+}
+
+my %handlers = (
+    X11::XCB::MAP_REQUEST() => sub {
+        my $id = unpack('x8 L', $_[0]);
+        $windows{$id} //= open_window(name => "replay $id", dont_map => 1);
+        $windows{$id}->map;
+        return 1;
+    },
+    X11::XCB::UNMAP_NOTIFY() => sub {
+        my ($event) = @_;
+        my ($type, $id) = unpack('C x7 L', $event);
+        return 0 unless ($type & 0x80) && defined($windows{$id});
+        $windows{$id}->unmap;
+        return 1;
+    },
+    X11::XCB::DESTROY_NOTIFY() => sub {
+        my $id = unpack('x8 L', $_[0]);
+        my $window = delete $windows{$id};
+        return 0 unless defined($window);
+        $window->destroy;
+        return 1;
+    },
+    X11::XCB::CONFIGURE_REQUEST() => sub {
+        my ($id, $left, $top, $width, $height) = unpack('x8 L x4 s s S S', $_[0]);
+        return 0 unless defined($windows{$id});
+        $windows{$id}->rect(X11::XCB::Rect->new(x => $left, y => $top, width => $width, height => $height));
+        return 1;
+    },
+    X11::XCB::PROPERTY_NOTIFY() => sub {
+        my ($id, $atom) = unpack('x4 L L', $_[0]);
+        my $name = $atom_names{$atom} // '';
+        return 0 unless defined($windows{$id}) && ($name eq 'WM_NAME' || $name eq '_NET_WM_NAME');
+        $windows{$id}->name("replay $id " . $replayed);
+        return 1;
+    },
+    X11::XCB::CLIENT_MESSAGE() => sub {
+        my ($format, $id, $atom, @data) = unpack('x C x2 L L L5', $_[0]);
+        return 0 unless $format == 32 && defined($atom_names{$atom});
+        $id = (defined($windows{$id}) ? $windows{$id}->id : $id);
+        @data[1, 2] = map { translate_atom($_) } @data[1, 2]
+            if $atom_names{$atom} eq '_NET_WM_STATE';
+        my $msg = pack('CCSLLLLLLL', X11::XCB::CLIENT_MESSAGE, 32, 0, $id,
+                       translate_atom($atom), @data);
+        $x->send_event(0, $x->get_root_window(), X11::XCB::EVENT_MASK_SUBSTRUCTURE_REDIRECT, $msg);
+        return 1;
+    },
+);
+
+fresh_workspace;
+reset_stats;
+
+my $us = measure_us(sub {
+    for my $record (@records) {
+        my ($kind, $payload) = @$record;
+        if ($kind eq 'command') {
+            cmd $payload;
+            $replayed++;
+            next;
+        }
+
+        my $handler = $handlers{unpack('C', $payload) & 0x7F};
+        if (defined($handler) && $handler->($payload)) {
+            $replayed++;
+        } else {
+            $skipped++;
+        }
+    }
+    sync_with_i3;
+});
+
+diag(sprintf('Replayed %d of %d records (%.0f per second), skipped %d',
+             $replayed, scalar @records, $replayed / ($us / 1e6), $skipped));
+
+bench_result('replay/wall-clock', $us);
+bench_result("replay/$_", stats_total_us($_)) for qw(event ipc command render);
+
+# The details which add up to the totals above.
+my $stats = $i3->message(10, '')->recv;
+for my $entry (sort { $b->{total_us} <=> $a->{total_us} } @$stats) {
+    next unless $entry->{count} > 0;
+    diag(sprintf("    %-8s %-30s %8d × %10.1f µs", $entry->{category}, $entry->{name},
+                 $entry->{count}, $entry->{total_us} / $entry->{count}));
+}
+
+bench_done;
+
+done_testing;
@@ -0,0 +1,165 @@
+package i3test::Bench;
+# vim:ts=4:sw=4:expandtab
+
+use base 'Test::Builder::Module';
+use JSON::XS;
+use List::Util qw(first);
+use Time::HiRes qw(time);
+
+our @EXPORT = qw(
+    reset_stats
+    stats_average_us
+    stats_total_us
+    measure_us
+    bench_result
+    bench_done
+);
+
+my $CLASS = __PACKAGE__;
+my %results;
+
+=head1 NAME
+
+i3test::Bench - Helpers for the benchmarks in bench/
+
+=head1 SYNOPSIS
+
+  use i3test;
+  use i3test::Bench;
+
+  my $us = measure_us(sub { cmd 'nop' });
+  bench_result('nop round trip', $us);
+
+  bench_done;
+
+=head1 DESCRIPTION
+
+Benchmarks record named results (durations in microseconds). bench_done writes
+them to C<latest/bench-$testname.json>, together with the version of i3, so
+that results of different versions can be compared. When the environment
+variable C<BENCH_BASELINE> points to such a file, every result which is slower
+than C<BENCH_TOLERANCE> (default: 1.5) times its baseline fails.
+
+=head1 EXPORT
+
+=head2 reset_stats
+
+Clears the statistics i3 reports via GET_STATS.
+
+=cut
+sub reset_stats {
+    i3test::i3(i3test::get_socket_path())->message(10, 'reset')->recv;
+}
+
+=head2 stats_average_us($category, $name)
+
+Returns the average duration (in microseconds) which i3 measured for the given
+category and name (see GET_STATS in docs/ipc) since the last reset_stats, or
+undef if nothing was measured.
+
+  reset_stats;
+  $i3->get_tree->recv for (1 .. 10);
+  my $us = stats_average_us('ipc', 'GET_TREE');
+
+=cut
+sub stats_average_us {
+    my ($category, $name) = @_;
+    my $stats = i3test::i3(i3test::get_socket_path())->message(10, '')->recv;
+    my $entry = first { $_->{category} eq $category && $_->{name} eq $name } @$stats;
+    return undef unless defined($entry) && $entry->{count} > 0;
+    return $entry->{total_us} / $entry->{count};
+}
+
+=head2 stats_total_us($category, [ $name ])
+
+Returns the total duration (in microseconds) which i3 measured for the given
+category (and name, if given) since the last reset_stats. Without a name, the
+durations of all statistics of the category are added up.
+
+  reset_stats;
+  open_window for (1 .. 10);
+  my $us = stats_total_us('event');
+
+=cut
+sub stats_total_us {
+    my ($category, $name) = @_;
+    my $stats = i3test::i3(i3test::get_socket_path())->message(10, '')->recv;
+    my $total = 0;
+    for my $entry (@$stats) {
+        next unless $entry->{category} eq $category;
+        next if defined($name) && $entry->{name} ne $name;
+        $total += $entry->{total_us};
+    }
+    return $total;
+}
+
+=head2 measure_us($code, $iterations)
+
+Runs C<$code> C<$iterations> times (default: 1) and returns the average
+wall-clock duration of one run in microseconds.
+
+=cut
+sub measure_us {
+    my ($code, $iterations) = @_;
+    $iterations //= 1;
+    my $start = time;
+    $code->() for (1 .. $iterations);
+    return (time - $start) * 1e6 / $iterations;
+}
+
+=head2 bench_result($name, $us)
+
+Records a result (a duration in microseconds). Undefined durations fail.
+
+=cut
+sub bench_result {
+    my ($name, $us) = @_;
+    my $tb = $CLASS->builder;
+
+    $tb->ok(defined($us), "$name measured");
+    return unless defined($us);
+    $results{$name} = $us;
+    $tb->diag(sprintf("%-40s %12.1f µs", $name, $us));
+}
+
+=head2 bench_done
+
+Writes the results and compares them to the baseline, if any.
+
+=cut
+sub bench_done {
+    my $tb = $CLASS->builder;
+
+    if (defined($ENV{OUTDIR})) {
+        my $version = i3test::i3(i3test::get_socket_path())->message(7, '')->recv;
+        my $output = {
+            version => $version->{human_readable},
+            time => int(time),
+            results => \%results,
+        };
+        open(my $fh, '>', "$ENV{OUTDIR}/bench-$ENV{TESTNAME}.json") or die "open: $!";
+        print $fh JSON::XS->new->canonical->pretty->encode($output);
+        close($fh);
+    }
+
+    return unless defined($ENV{BENCH_BASELINE});
+
+    my $tolerance = $ENV{BENCH_TOLERANCE} // 1.5;
+    open(my $fh, '<', $ENV{BENCH_BASELINE}) or die "open: $!";
+    my $baseline = decode_json(do { local $/; <$fh> })->{results};
+    close($fh);
+
+    for my $name (sort keys %$baseline) {
+        next unless exists($results{$name});
+        $tb->cmp_ok($results{$name}, '<=', $baseline->{$name} * $tolerance,
+                    "$name not slower than the baseline");
+    }
+}
+
+=head1 AUTHOR
+
+Michael Stapelberg <michael@i3wm.org>
+
+=cut
+
+1
@@ -68,6 +68,22 @@ cmd 'border 1pixel';
 
 test_resize;
 
+################################################################################
+# Check that only the latest geometry of a burst of configure requests (with
+# other events in between) is applied.
+################################################################################
+
+for my $size (1..20) {
+    $window->rect(X11::XCB::Rect->new(x => 10, y => 10, width => 100 + $size, height => 200 + $size));
+    $window->name("resizing $size");
+}
+
+sync_with_i3;
+
+my ($absolute, $top) = $window->rect;
+is($absolute->width, 120, 'width of the last request applied');
+is($absolute->height, 220, 'height of the last request applied');
+
 ################################################################################
 # Check if we can position a floating window out of bounds. The XDummy screen
 # is 1280x1024, so x=2864, y=893 is out of bounds.
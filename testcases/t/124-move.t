@@ -235,4 +235,42 @@ my $center_y = int($x->root->rect->height/2) - int($floatcon[0]->{rect}->{height
 is($floatcon[0]->{rect}->{x}, $center_x, "moved to center at position $center_x x");
 is($floatcon[0]->{rect}->{y}, $center_y, "moved to center at position $center_y y");
 
+######################################################################
+# 7) move a container several steps at once, which has to end up in the
+#    same place as the same number of single moves
+######################################################################
+
+$tmp = fresh_workspace;
+my @windows = map { open_window } 1..4;
+my @ids = map { $_->id } @windows;
+
+sub window_order {
+    return [ map { $_->{window} } @{get_ws_content($tmp)} ];
+}
+
+cmd '[id="' . $ids[3] . '"] focus';
+cmd 'move left 2 steps';
+is_deeply(window_order(), [ @ids[0, 3, 1, 2] ], 'moved two steps to the left');
+
+cmd 'move left 5 steps';
+is_deeply(window_order(), [ @ids[3, 0, 1, 2] ], 'stopped at the first position');
+
+# Move into a split container which is in the way: the same as two single
+# moves.
+cmd '[id="' . $ids[2] . '"] focus';
+cmd 'split v';
+cmd '[id="' . $ids[0] . '"] focus';
+cmd 'move right 2 steps';
+$content = get_ws_content($tmp);
+is(@$content, 3, 'three containers left on the workspace');
+is($content->[1]->{window}, $ids[1], 'second window in place');
+my @nested = map { $_->{window} } @{$content->[2]->{nodes}};
+is_deeply(\@nested, [ @ids[2, 0] ], 'moved into the split container');
+
+# Workspaces are not moved, which the reply says.
+cmd 'focus parent' for 1..3;
+my $reply = cmd 'move left 2 steps';
+ok(!$reply->[0]->{success}, 'moving a workspace fails');
+ok(defined($reply->[0]->{error}), 'error message set');
+
 done_testing;
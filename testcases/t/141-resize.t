@@ -289,4 +289,27 @@ my $rightnew = get_floating_rect($right->id);
 is($rightnew->{height}, $rightold->{height}, 'height of right container unchanged');
 is($leftnew->{height}, $leftold->{height} - 10, 'height of left container changed');
 
+################################################################################
+# Check that the containers of a split container cover it exactly, even when
+# the percentages do not divide the width evenly
+################################################################################
+
+$tmp = fresh_workspace;
+
+cmd 'split h';
+open_window for 1..3;
+cmd 'resize grow width 7 px or 7 ppt';
+cmd 'focus left';
+cmd 'resize shrink width 3 px or 3 ppt';
+
+my $ws = get_ws($tmp);
+my @nodes = @{$ws->{nodes}};
+is(scalar @nodes, 3, 'three containers on the workspace');
+my $x = $ws->{rect}->{x};
+for my $node (@nodes) {
+    is($node->{rect}->{x}, $x, 'container starts where the previous one ends');
+    $x += $node->{rect}->{width};
+}
+is($x, $ws->{rect}->{x} + $ws->{rect}->{width}, 'containers cover the whole workspace');
+
 done_testing;
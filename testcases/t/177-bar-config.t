@@ -62,6 +62,9 @@ my $bar_id = shift @$bars;
 my $bar_config = $i3->get_bar_config($bar_id)->recv;
 is($bar_config->{status_command}, 'i3status --foo', 'status_command correct');
 ok(!$bar_config->{verbose}, 'verbose off by default');
+is($bar_config->{status_refresh_rate}, 0, 'status refresh rate unlimited by default');
+ok(!$bar_config->{client_side_rendering}, 'client-side rendering off by default');
+ok(!$bar_config->{glyph_cache}, 'glyph cache off by default');
 ok($bar_config->{workspace_buttons}, 'workspace buttons enabled per default');
 ok($bar_config->{binding_mode_indicator}, 'mode indicator enabled per default');
 is($bar_config->{mode}, 'dock', 'dock mode by default');
@@ -102,6 +105,9 @@ bar {
     workspace_buttons no
     binding_mode_indicator no
     verbose yes
+    status_refresh_rate 20
+    client_side_rendering yes
+    glyph_cache yes
     socket_path /tmp/foobar
 
     colors {
@@ -127,6 +133,9 @@ $bar_id = shift @$bars;
 $bar_config = $i3->get_bar_config($bar_id)->recv;
 is($bar_config->{status_command}, 'i3status --bar', 'status_command correct');
 ok($bar_config->{verbose}, 'verbose on');
+is($bar_config->{status_refresh_rate}, 20, 'status refresh rate ok');
+ok($bar_config->{client_side_rendering}, 'client-side rendering on');
+ok($bar_config->{glyph_cache}, 'glyph cache on');
 ok(!$bar_config->{workspace_buttons}, 'workspace buttons disabled');
 ok(!$bar_config->{binding_mode_indicator}, 'mode indicator disabled');
 is($bar_config->{mode}, 'dock', 'dock mode');
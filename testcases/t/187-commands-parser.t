@@ -47,6 +47,14 @@ is(parser_calls('move workspace 3'),
    'cmd_move_con_to_workspace_name(3)',
    'single number (move workspace 3) ok');
 
+is(parser_calls('focus back_and_forth'),
+   'cmd_focus_back_and_forth()',
+   'focus back_and_forth ok');
+
+is(parser_calls('move left 3 steps'),
+   'cmd_move_direction_steps(left, 3)',
+   'move with steps ok');
+
 is(parser_calls(
    'move to workspace 3; ' .
    'move window to workspace 3; ' .
@@ -144,7 +152,7 @@ is(parser_calls("\nworkspace test"),
 ################################################################################
 
 is(parser_calls('unknown_literal'),
-   "ERROR: Expected one of these tokens: <end>, '[', 'move', 'exec', 'exit', 'restart', 'reload', 'shmlog', 'debuglog', 'border', 'layout', 'append_layout', 'workspace', 'focus', 'kill', 'open', 'fullscreen', 'split', 'floating', 'mark', 'unmark', 'resize', 'rename', 'nop', 'scratchpad', 'mode', 'bar'\n" .
+   "ERROR: Expected one of these tokens: <end>, '[', 'move', 'exec', 'exit', 'restart', 'reload', 'shmlog', 'debuglog', 'trace', 'tree_snapshot', 'border', 'layout', 'append_layout', 'workspace', 'focus', 'kill', 'open', 'fullscreen', 'split', 'floating', 'mark', 'unmark', 'resize', 'rename', 'nop', 'scratchpad', 'mode', 'bar', 'batch'\n" .
    "ERROR: Your command: unknown_literal\n" .
    "ERROR:               ^^^^^^^^^^^^^^^",
    'error for unknown literal ok');
@@ -164,6 +164,152 @@ is(parser_calls($config),
    $expected,
    'popup_during_fullscreen ok');
 
+################################################################################
+# tiling_resize
+################################################################################
+
+$config = <<'EOT';
+tiling_resize live
+tiling_resize outline
+EOT
+
+$expected = <<'EOT';
+cfg_tiling_resize(live)
+cfg_tiling_resize(outline)
+EOT
+
+is(parser_calls($config),
+   $expected,
+   'tiling_resize ok');
+
+################################################################################
+# floating_move
+################################################################################
+
+$config = <<'EOT';
+floating_move outline
+floating_move opaque
+EOT
+
+$expected = <<'EOT';
+cfg_floating_move(outline)
+cfg_floating_move(opaque)
+EOT
+
+is(parser_calls($config),
+   $expected,
+   'floating_move ok');
+
+################################################################################
+# screen_change_delay
+################################################################################
+
+$config = <<'EOT';
+screen_change_delay 500 ms
+screen_change_delay 250ms
+screen_change_delay 0
+EOT
+
+$expected = <<'EOT';
+cfg_screen_change_delay(500)
+cfg_screen_change_delay(250)
+cfg_screen_change_delay(0)
+EOT
+
+is(parser_calls($config),
+   $expected,
+   'screen_change_delay ok');
+
+################################################################################
+# config_cache
+################################################################################
+
+$config = <<'EOT';
+config_cache yes
+config_cache no
+EOT
+
+$expected = <<'EOT';
+cfg_config_cache(yes)
+cfg_config_cache(no)
+EOT
+
+is(parser_calls($config),
+   $expected,
+   'config_cache ok');
+
+################################################################################
+# ipc_buffer_limit
+################################################################################
+
+$config = <<'EOT';
+ipc_buffer_limit 16384 kb
+ipc_buffer_limit 0
+EOT
+
+$expected = <<'EOT';
+cfg_ipc_buffer_limit(16384)
+cfg_ipc_buffer_limit(0)
+EOT
+
+is(parser_calls($config),
+   $expected,
+   'ipc_buffer_limit ok');
+
+################################################################################
+# ipc_thread
+################################################################################
+
+$config = <<'EOT';
+ipc_thread yes
+ipc_thread no
+EOT
+
+$expected = <<'EOT';
+cfg_ipc_thread(yes)
+cfg_ipc_thread(no)
+EOT
+
+is(parser_calls($config),
+   $expected,
+   'ipc_thread ok');
+
+################################################################################
+# glyph_cache
+################################################################################
+
+$config = <<'EOT';
+glyph_cache yes
+glyph_cache no
+EOT
+
+$expected = <<'EOT';
+cfg_glyph_cache(yes)
+cfg_glyph_cache(no)
+EOT
+
+is(parser_calls($config),
+   $expected,
+   'glyph_cache ok');
+
+################################################################################
+# shared_i3bar
+################################################################################
+
+$config = <<'EOT';
+shared_i3bar yes
+shared_i3bar no
+EOT
+
+$expected = <<'EOT';
+cfg_shared_i3bar(yes)
+cfg_shared_i3bar(no)
+EOT
+
+is(parser_calls($config),
+   $expected,
+   'shared_i3bar ok');
+
 
 ################################################################################
 # floating_modifier
@@ -413,7 +559,7 @@ client.focused          #4c7899 #285577 #ffffff #2e9ef4
 EOT
 
 my $expected_all_tokens = <<'EOT';
-ERROR: CONFIG: Expected one of these tokens: <end>, '#', 'set', 'bindsym', 'bindcode', 'bind', 'bar', 'font', 'mode', 'floating_minimum_size', 'floating_maximum_size', 'floating_modifier', 'default_orientation', 'workspace_layout', 'new_window', 'new_float', 'hide_edge_borders', 'for_window', 'assign', 'focus_follows_mouse', 'force_focus_wrapping', 'force_xinerama', 'force-xinerama', 'workspace_auto_back_and_forth', 'fake_outputs', 'fake-outputs', 'force_display_urgency_hint', 'workspace', 'ipc_socket', 'ipc-socket', 'restart_state', 'popup_during_fullscreen', 'exec_always', 'exec', 'client.background', 'client.focused_inactive', 'client.focused', 'client.unfocused', 'client.urgent'
+ERROR: CONFIG: Expected one of these tokens: <end>, '#', 'set', 'bindsym', 'bindcode', 'bind', 'bar', 'font', 'glyph_cache', 'shared_i3bar', 'mode', 'floating_minimum_size', 'floating_maximum_size', 'floating_modifier', 'default_orientation', 'workspace_layout', 'new_window', 'new_float', 'hide_edge_borders', 'for_window', 'assign', 'focus_follows_mouse', 'force_focus_wrapping', 'force_xinerama', 'force-xinerama', 'workspace_auto_back_and_forth', 'fake_outputs', 'fake-outputs', 'force_display_urgency_hint', 'screen_change_delay', 'config_cache', 'workspace', 'ipc_socket', 'ipc-socket', 'ipc_buffer_limit', 'ipc_thread', 'restart_state', 'popup_during_fullscreen', 'tiling_resize', 'floating_move', 'exec_always', 'exec', 'client.background', 'client.focused_inactive', 'client.focused', 'client.unfocused', 'client.urgent'
 EOT
 
 my $expected_end = <<'EOT';
@@ -627,7 +773,7 @@ EOT
 
 $expected = <<'EOT';
 cfg_bar_output(LVDS-1)
-ERROR: CONFIG: Expected one of these tokens: <end>, '#', 'set', 'i3bar_command', 'status_command', 'socket_path', 'mode', 'hidden_state', 'id', 'modifier', 'position', 'output', 'tray_output', 'font', 'binding_mode_indicator', 'workspace_buttons', 'verbose', 'colors', '}'
+ERROR: CONFIG: Expected one of these tokens: <end>, '#', 'set', 'i3bar_command', 'status_command', 'socket_path', 'mode', 'hidden_state', 'id', 'modifier', 'position', 'output', 'tray_output', 'font', 'binding_mode_indicator', 'workspace_buttons', 'verbose', 'status_refresh_rate', 'client_side_rendering', 'glyph_cache', 'colors', '}'
 ERROR: CONFIG: (in file <stdin>)
 ERROR: CONFIG: Line   1: bar {
 ERROR: CONFIG: Line   2:     output LVDS-1
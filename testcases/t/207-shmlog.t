@@ -17,6 +17,7 @@
 use i3test i3_autostart => 0;
 use IPC::Run qw(run);
 use File::Temp;
+use IO::Uncompress::Gunzip qw(gunzip);
 
 ################################################################################
 # 1: test that shared memory logging does not work yet
@@ -57,7 +58,7 @@ like($stdout, qr#$random_nop#, 'random nop found in shm log');
 like($stderr, qr#^$#, 'stderr empty');
 
 ################################################################################
-# 3: change size of the shared memory log buffer and verify old content is gone
+# 3: change size of the shared memory log buffer and verify old content is kept
 ################################################################################
 
 cmd 'shmlog ' . (23 * 1024 * 1024);
@@ -66,11 +67,44 @@ run [ '../i3-dump-log/i3-dump-log' ],
     '>', \$stdout,
     '2>', \$stderr;
 
-unlike($stdout, qr#$random_nop#, 'random nop not found in shm log');
+like($stdout, qr#$random_nop#, 'random nop still found in resized shm log');
 like($stderr, qr#^$#, 'stderr empty');
 
 ################################################################################
-# 4: disable logging and verify it no longer works
+# 4: verify the output can be filtered and compressed
+################################################################################
+
+run [ '../i3-dump-log/i3-dump-log', '--grep', $random_nop ],
+    '>', \$stdout,
+    '2>', \$stderr;
+
+my @lines = split(/\n/, $stdout);
+ok(@lines > 0, 'random nop found with --grep');
+is(scalar grep({ index($_, $random_nop) == -1 } @lines), 0, 'only matching lines printed');
+
+run [ '../i3-dump-log/i3-dump-log', '--category', 'x' ],
+    '>', \$stdout,
+    '2>', \$stderr;
+
+like($stdout, qr#$random_nop#, 'messages without category still printed');
+unlike($stdout, qr#^.* - (?!x\.c:)[a-z_]+\.c:\w+:\d+ - #m, 'only debug messages of x.c printed');
+
+run [ '../i3-dump-log/i3-dump-log', '--until', '1d' ],
+    '>', \$stdout,
+    '2>', \$stderr;
+
+is($stdout, '', 'nothing logged a day ago');
+
+my $compressed;
+run [ '../i3-dump-log/i3-dump-log', '--gzip', '--since', '1h' ],
+    '>', \$compressed,
+    '2>', \$stderr;
+
+gunzip(\$compressed => \$stdout);
+like($stdout, qr#$random_nop#, 'random nop found in compressed shm log');
+
+################################################################################
+# 5: disable logging and verify it no longer works
 ################################################################################
 
 cmd 'shmlog off';
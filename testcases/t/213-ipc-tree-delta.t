@@ -0,0 +1,76 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • http://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • http://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • http://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that GET_TREE_DELTA returns all containers initially and only the
+# changed ones afterwards.
+use i3test;
+use List::Util qw(first);
+
+my $i3 = i3(get_socket_path());
+$i3->connect->recv;
+
+sub get_delta {
+    my ($since) = @_;
+    return $i3->message(8, $since)->recv;
+}
+
+##############################################################
+# 1: without a generation, all containers are returned
+##############################################################
+
+my $tmp = fresh_workspace;
+my $first = open_window;
+sync_with_i3;
+
+my $delta = get_delta('');
+my $tree = $i3->get_tree->recv;
+
+cmp_ok($delta->{generation}, '>', 0, 'generation is positive');
+ok((first { $_->{id} == $tree->{id} } @{$delta->{nodes}}), 'root container returned');
+is($delta->{focused}, get_focused($tmp), 'focused container returned');
+
+my $root = first { $_->{id} == $tree->{id} } @{$delta->{nodes}};
+is_deeply($root->{nodes}, [ map { $_->{id} } @{$tree->{nodes}} ],
+          'children are returned as IDs');
+
+##############################################################
+# 2: nothing changed, so nothing is returned
+##############################################################
+
+my $generation = $delta->{generation};
+$delta = get_delta($generation);
+
+is_deeply($delta->{nodes}, [], 'no containers changed');
+cmp_ok($delta->{generation}, '>', $generation, 'generation increased');
+
+##############################################################
+# 3: after marking a window, only that window is included
+##############################################################
+
+$generation = $delta->{generation};
+cmd 'mark delta';
+$delta = get_delta($generation);
+
+my $focused = get_focused($tmp);
+my $marked = first { $_->{id} == $focused } @{$delta->{nodes}};
+ok(defined($marked), 'marked container returned');
+is($marked->{mark}, 'delta', 'mark is set');
+
+my $ws = get_ws($tmp);
+ok(!(first { $_->{id} == $ws->{id} } @{$delta->{nodes}}),
+   'unchanged workspace not returned');
+
+done_testing;
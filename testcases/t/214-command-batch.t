@@ -0,0 +1,97 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • http://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • http://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • http://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that 'batch begin' defers pushing changes to X11 until
+# 'batch commit', until the connection which started the batch is closed or
+# until the batch times out.
+use i3test;
+use Time::HiRes qw(sleep);
+
+my $tmp = fresh_workspace;
+my $left = open_window;
+my $right = open_window;
+
+my $width = $right->rect->width;
+
+##############################################################
+# 1: changes are only pushed when the batch is committed
+##############################################################
+
+my $i3 = i3(get_socket_path());
+$i3->connect->recv;
+
+my $reply = $i3->command('batch begin')->recv;
+ok($reply->[0]->{success}, 'batch begin succeeded');
+
+$i3->command('fullscreen')->recv;
+sync_with_i3;
+is($right->rect->width, $width, 'window not resized during the batch');
+
+$i3->command('batch commit')->recv;
+sync_with_i3;
+cmp_ok($right->rect->width, '>', $width, 'window resized after commit');
+
+cmd 'fullscreen';
+
+##############################################################
+# 2: closing the connection commits the batch
+##############################################################
+
+$i3 = i3(get_socket_path());
+$i3->connect->recv;
+
+$i3->command('batch begin')->recv;
+$i3->command('fullscreen')->recv;
+sync_with_i3;
+is($right->rect->width, $width, 'window not resized during the batch');
+
+undef $i3;
+sync_with_i3;
+cmp_ok($right->rect->width, '>', $width, 'window resized after disconnecting');
+
+##############################################################
+# 3: a batch which is not committed in time is committed anyway
+##############################################################
+
+cmd 'fullscreen';
+sync_with_i3;
+
+$i3 = i3(get_socket_path());
+$i3->connect->recv;
+
+$i3->command('batch begin')->recv;
+$i3->command('fullscreen')->recv;
+sync_with_i3;
+is($right->rect->width, $width, 'window not resized during the batch');
+
+sleep 1.5;
+sync_with_i3;
+cmp_ok($right->rect->width, '>', $width, 'window resized after the batch timed out');
+
+undef $i3;
+
+##############################################################
+# 4: an unmatched 'batch commit' does no harm
+##############################################################
+
+$reply = cmd 'batch commit';
+ok($reply->[0]->{success}, 'batch commit succeeded');
+
+cmd 'fullscreen';
+sync_with_i3;
+is($right->rect->width, $width, 'rendering not deferred after an unmatched commit');
+
+done_testing;
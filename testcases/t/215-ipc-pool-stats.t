@@ -0,0 +1,52 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • http://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • http://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • http://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that GET_POOL_STATS reports the occupancy of the object pools and
+# that closed windows are returned to their pools.
+use i3test;
+use List::Util qw(first);
+
+my $i3 = i3(get_socket_path());
+$i3->connect->recv;
+
+sub get_pool {
+    my ($name) = @_;
+    my $pools = $i3->message(9, '')->recv;
+    return first { $_->{name} eq $name } @$pools;
+}
+
+my $tmp = fresh_workspace;
+
+my $cons = get_pool('Con');
+ok(defined($cons), 'Con pool reported');
+cmp_ok($cons->{in_use}, '>', 0, 'containers in use');
+
+my $window = open_window;
+sync_with_i3;
+
+my $windows = get_pool('i3Window');
+ok(defined($windows), 'i3Window pool reported');
+my $in_use = $windows->{in_use};
+cmp_ok($in_use, '>', 0, 'windows in use');
+
+$window->unmap;
+wait_for_unmap $window;
+
+$windows = get_pool('i3Window');
+is($windows->{in_use}, $in_use - 1, 'closed window returned to the pool');
+cmp_ok($windows->{available}, '>', 0, 'object available for reuse');
+
+done_testing;
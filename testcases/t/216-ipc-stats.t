@@ -0,0 +1,68 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • http://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • http://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • http://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that GET_STATS reports latency statistics for commands, IPC
+# messages and rendering, and that they can be reset.
+use i3test;
+use List::Util qw(first sum);
+
+my $i3 = i3(get_socket_path());
+$i3->connect->recv;
+
+sub get_stats {
+    my ($payload) = @_;
+    return $i3->message(10, $payload // '')->recv;
+}
+
+sub find_stats {
+    my ($stats, $category, $name) = @_;
+    return first { $_->{category} eq $category && $_->{name} eq $name } @$stats;
+}
+
+my $tmp = fresh_workspace;
+open_window;
+cmd 'nop stats';
+
+my $stats = get_stats();
+
+my $nop = find_stats($stats, 'command', 'cmd_nop');
+ok(defined($nop), 'nop command reported');
+cmp_ok($nop->{count}, '>=', 1, 'nop command counted');
+is(sum(@{$nop->{histogram}}), $nop->{count}, 'histogram matches count');
+
+ok(defined(find_stats($stats, 'ipc', 'COMMAND')), 'COMMAND message reported');
+ok(defined(find_stats($stats, 'event', 'MapRequest')), 'MapRequest event reported');
+
+my $render = find_stats($stats, 'render', 'tree_render');
+ok(defined($render), 'tree_render reported');
+cmp_ok($render->{max_us}, '<=', $render->{total_us}, 'maximum below total');
+
+my $layout = find_stats($stats, 'render', 'render_con');
+ok(defined($layout), 'render_con reported');
+is($layout->{count}, $render->{count}, 'layout computed once per render');
+
+################################################################################
+# After a reset, only the statistics recorded since then are reported.
+################################################################################
+
+get_stats('reset');
+$stats = get_stats();
+
+ok(!defined(find_stats($stats, 'command', 'cmd_nop')), 'nop command reset');
+my $get_stats = find_stats($stats, 'ipc', 'GET_STATS');
+is($get_stats->{count}, 1, 'only the reset request counted');
+
+done_testing;
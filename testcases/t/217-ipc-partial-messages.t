@@ -0,0 +1,79 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • http://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • http://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • http://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that clients which send incomplete or oversized messages do not
+# block i3: other clients are still served, and the incomplete message is
+# handled once it is complete.
+use i3test;
+use IO::Socket::UNIX;
+
+sub raw_connect {
+    return IO::Socket::UNIX->new(Peer => get_socket_path(), Type => SOCK_STREAM)
+        or die "Could not connect to i3: $!";
+}
+
+sub header {
+    my ($length, $type) = @_;
+    return 'i3-ipc' . pack('LL', $length, $type);
+}
+
+my $tmp = fresh_workspace;
+
+################################################################################
+# 1: a client stalls after sending half a header, then half a payload
+################################################################################
+
+my $command = 'nop partial';
+my $stalled = raw_connect;
+my $message = header(length($command), 0) . $command;
+
+$stalled->syswrite(substr($message, 0, 7));
+does_i3_live;
+
+$stalled->syswrite(substr($message, 7, 10));
+does_i3_live;
+
+$stalled->syswrite(substr($message, 17));
+
+my $reply = '';
+$stalled->sysread($reply, 14) == 14 or die "Could not read reply header: $!";
+my ($magic, $length, $type) = unpack('a6LL', $reply);
+is($magic, 'i3-ipc', 'reply received once the message is complete');
+$stalled->sysread($reply, $length);
+is($reply, '[{"success":true}]', 'command succeeded');
+
+################################################################################
+# 2: several messages in one write are all handled
+################################################################################
+
+$stalled->syswrite(header(length($command), 0) . $command . header(0, 7));
+$stalled->sysread($reply, 14);
+($magic, $length, $type) = unpack('a6LL', $reply);
+$stalled->sysread($reply, $length);
+$stalled->sysread($reply, 14);
+($magic, $length, $type) = unpack('a6LL', $reply);
+is($type, 7, 'second message in the same write answered');
+
+################################################################################
+# 3: a message larger than the limit disconnects the client
+################################################################################
+
+my $huge = raw_connect;
+$huge->syswrite(header(0xFFFFFFFF, 0) . 'x');
+ok(!$huge->sysread($reply, 14), 'client with oversized message disconnected');
+does_i3_live;
+
+done_testing;
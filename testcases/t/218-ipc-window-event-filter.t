@@ -0,0 +1,123 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • http://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • http://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • http://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that window events are only sent to clients whose subscription
+# filter matches the window.
+use i3test;
+use IO::Socket::UNIX;
+use JSON::XS;
+
+sub raw_connect {
+    return IO::Socket::UNIX->new(Peer => get_socket_path(), Type => SOCK_STREAM)
+        or die "Could not connect to i3: $!";
+}
+
+sub send_message {
+    my ($sock, $type, $payload) = @_;
+    $sock->syswrite('i3-ipc' . pack('LL', length($payload), $type) . $payload);
+}
+
+sub recv_message {
+    my ($sock) = @_;
+    my $header;
+    $sock->sysread($header, 14) == 14 or die "Could not read header: $!";
+    my ($magic, $length, $type) = unpack('a6LL', $header);
+    my $payload = '';
+    while (length($payload) < $length) {
+        $sock->sysread($payload, $length - length($payload), length($payload)) or die "read: $!";
+    }
+    return ($type, decode_json($payload));
+}
+
+sub subscribe {
+    my ($sock, $subscription) = @_;
+    send_message($sock, 2, encode_json($subscription));
+    my ($type, $reply) = recv_message($sock);
+    return $reply->{success};
+}
+
+my $tmp = fresh_workspace;
+
+################################################################################
+# 1: class and change filters
+################################################################################
+
+my $filtered = raw_connect;
+ok(subscribe($filtered, [ { event => 'window', change => [ 'new' ], class => '^wanted$' } ]),
+   'subscription with filter succeeded');
+
+my $all = raw_connect;
+ok(subscribe($all, [ 'window' ]), 'subscription without filter succeeded');
+
+my $unwanted = open_window(wm_class => 'unwanted');
+my $wanted = open_window(wm_class => 'wanted');
+
+my ($type, $event) = recv_message($all);
+is($event->{container}->{window}, $unwanted->id,
+   'unfiltered client receives the first window');
+
+($type, $event) = recv_message($filtered);
+is($type, 0x80000003, 'window event received');
+is($event->{change}, 'new', 'change is new');
+is($event->{container}->{window}, $wanted->id,
+   'filtered client only receives the matching window');
+
+################################################################################
+# 2: workspace filter
+################################################################################
+
+my $ws_client = raw_connect;
+ok(subscribe($ws_client, [ { event => 'window', workspace => 'elsewhere' } ]),
+   'subscription with workspace filter succeeded');
+
+open_window;
+cmd 'workspace elsewhere';
+my $elsewhere = open_window;
+
+($type, $event) = recv_message($ws_client);
+is($event->{container}->{window}, $elsewhere->id,
+   'only the window on the given workspace reported');
+
+################################################################################
+# 3: invalid filters make the subscription fail
+################################################################################
+
+my $invalid = raw_connect;
+ok(!subscribe($invalid, [ { event => 'window', colour => 'red' } ]),
+   'unknown filter property rejected');
+ok(!subscribe($invalid, [ { event => 'workspace', workspace => '1' } ]),
+   'filter for non-window events rejected');
+ok(!subscribe($invalid, [ { event => 'window', class => '(' } ]),
+   'invalid regular expression rejected');
+
+################################################################################
+# 4: payloads which are not an array are rejected
+################################################################################
+
+my $bare = raw_connect;
+send_message($bare, 2, '"window"');
+my ($bare_type, $bare_reply) = recv_message($bare);
+ok(!$bare_reply->{success}, 'bare string rejected');
+
+send_message($bare, 2, '42');
+($bare_type, $bare_reply) = recv_message($bare);
+ok(!$bare_reply->{success}, 'bare number rejected');
+
+ok(!subscribe($bare, [ 'window', 42 ]), 'number in the payload array rejected');
+
+does_i3_live;
+
+done_testing;
@@ -0,0 +1,67 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • http://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • http://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • http://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that the placeholders of a layout swallow new windows in the order
+# they appear in the tree and that a placeholder which already swallowed its
+# window does not swallow another one.
+use i3test;
+use File::Temp qw(tempfile);
+
+my $tmp = fresh_workspace;
+
+my ($fh, $filename) = tempfile(UNLINK => 1);
+print $fh <<'EOT';
+{
+    "layout": "splith",
+    "percent": 1.0,
+    "nodes": [
+        { "percent": 0.25, "swallows": [ { "class": "^swallowed$" } ] },
+        { "percent": 0.25, "swallows": [ { "class": "^other\\.app$" } ] },
+        { "percent": 0.25, "swallows": [ { "class": "^swallowed$" } ] },
+        { "percent": 0.25, "swallows": [ { "class": "^sw.*ed$" } ] }
+    ]
+}
+EOT
+close($fh);
+
+cmd "append_layout $filename";
+
+sub placeholders {
+    my @nodes = @{get_ws($tmp)->{nodes}};
+    is(@nodes, 1, 'one container on the workspace');
+    return @{$nodes[0]->{nodes}};
+}
+
+my @placeholders = placeholders();
+is(@placeholders, 4, 'four placeholders');
+
+my $first = open_window(wm_class => 'swallowed');
+my $second = open_window(wm_class => 'swallowed');
+my $other = open_window(wm_class => 'other.app');
+my $third = open_window(wm_class => 'swallowed');
+
+@placeholders = placeholders();
+is($placeholders[0]->{window}, $first->id, 'first window swallowed by the first placeholder');
+is($placeholders[1]->{window}, $other->id, 'literal class with an escaped dot swallowed');
+is($placeholders[2]->{window}, $second->id, 'second window swallowed by the second match');
+is($placeholders[3]->{window}, $third->id, 'third window swallowed by the regular expression');
+
+my $fourth = open_window(wm_class => 'swallowed');
+@placeholders = placeholders();
+is($placeholders[0]->{window}, $first->id, 'first placeholder kept its window');
+is(@placeholders, 5, 'fourth window opened in a new container');
+
+done_testing;
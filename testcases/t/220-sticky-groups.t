@@ -0,0 +1,47 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • http://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • http://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • http://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that the window of a sticky group follows the user to the sticky
+# container of that group on the workspace they switch to.
+use i3test;
+use File::Temp qw(tempfile);
+
+sub append_sticky_layout {
+    my ($swallow) = @_;
+    my ($fh, $filename) = tempfile(UNLINK => 1);
+    my $swallows = ($swallow ? ', "swallows": [ { "class": "^sticky$" } ]' : '');
+    print $fh qq|{ "sticky_group": "group"$swallows }\n|;
+    close($fh);
+    cmd "append_layout $filename";
+}
+
+my $first = fresh_workspace;
+append_sticky_layout(1);
+my $window = open_window(wm_class => 'sticky');
+
+my $second = fresh_workspace;
+append_sticky_layout(0);
+cmd "workspace $first";
+is(get_ws($first)->{nodes}->[0]->{window}, $window->id, 'window still on the first workspace');
+
+cmd "workspace $second";
+is(get_ws($second)->{nodes}->[0]->{window}, $window->id, 'window moved to the sticky container');
+is(get_ws($first)->{nodes}->[0]->{window}, undef, 'old sticky container empty');
+
+cmd "workspace $first";
+is(get_ws($first)->{nodes}->[0]->{window}, $window->id, 'window moved back');
+
+done_testing;
@@ -0,0 +1,151 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • http://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • http://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • http://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that clients can switch to CBOR encoded replies and events using
+# SET_ENCODING, and that other clients still get JSON.
+use i3test;
+use IO::Socket::UNIX;
+use JSON::XS;
+
+sub raw_connect {
+    return IO::Socket::UNIX->new(Peer => get_socket_path(), Type => SOCK_STREAM)
+        or die "Could not connect to i3: $!";
+}
+
+sub send_message {
+    my ($sock, $type, $payload) = @_;
+    $sock->syswrite('i3-ipc' . pack('LL', length($payload), $type) . $payload);
+}
+
+sub recv_message {
+    my ($sock) = @_;
+    my $header;
+    $sock->sysread($header, 14) == 14 or die "Could not read header: $!";
+    my ($magic, $length, $type) = unpack('a6LL', $header);
+    my $payload = '';
+    while (length($payload) < $length) {
+        $sock->sysread($payload, $length - length($payload), length($payload)) or die "read: $!";
+    }
+    return ($type, $payload);
+}
+
+# Decodes the subset of CBOR which i3 generates: integers, doubles, strings,
+# booleans, null and indefinite length arrays and maps.
+sub decode_cbor {
+    my ($data, $pos) = @_;
+    my $initial = ord(substr($$data, $$pos++, 1));
+
+    if ($initial == 0x9f || $initial == 0xbf) {
+        my @items;
+        while (ord(substr($$data, $$pos, 1)) != 0xff) {
+            push @items, decode_cbor($data, $pos);
+        }
+        $$pos++;
+        return ($initial == 0x9f ? \@items : { @items });
+    }
+    return 0 if $initial == 0xf4;
+    return 1 if $initial == 0xf5;
+    return undef if $initial == 0xf6;
+    if ($initial == 0xfb) {
+        my $value = unpack('d>', substr($$data, $$pos, 8));
+        $$pos += 8;
+        return $value;
+    }
+
+    my ($major, $info) = ($initial >> 5, $initial & 0x1f);
+    my $arg = $info;
+    if ($info >= 24) {
+        my ($size, $format) = @{ { 24 => [ 1, 'C' ], 25 => [ 2, 'n' ], 26 => [ 4, 'N' ], 27 => [ 8, 'Q>' ] }->{$info} };
+        $arg = unpack($format, substr($$data, $$pos, $size));
+        $$pos += $size;
+    }
+    return $arg if $major == 0;
+    return -1 - $arg if $major == 1;
+    die "unexpected CBOR major type $major" unless $major == 3;
+    my $string = substr($$data, $$pos, $arg);
+    $$pos += $arg;
+    return $string;
+}
+
+sub cbor {
+    my ($payload) = @_;
+    my $pos = 0;
+    my $value = decode_cbor(\$payload, \$pos);
+    is($pos, length($payload), 'whole payload decoded');
+    return $value;
+}
+
+my $tmp = fresh_workspace;
+
+################################################################################
+# 1: unknown encodings are rejected, the reply to SET_ENCODING is still JSON
+################################################################################
+
+my $sock = raw_connect;
+send_message($sock, 11, 'xml');
+my ($type, $reply) = recv_message($sock);
+is($type, 11, 'SET_ENCODING reply type');
+ok(!decode_json($reply)->{success}, 'unknown encoding rejected');
+
+send_message($sock, 11, 'cbor');
+($type, $reply) = recv_message($sock);
+ok(decode_json($reply)->{success}, 'switched to CBOR');
+
+################################################################################
+# 2: replies are CBOR now, including streamed ones
+################################################################################
+
+send_message($sock, 7, '');
+($type, $reply) = recv_message($sock);
+my $version = cbor($reply);
+is($version->{human_readable}, i3(get_socket_path())->message(7, '')->recv->{human_readable}, 'GET_VERSION reply decoded');
+
+send_message($sock, 1, '');
+($type, $reply) = recv_message($sock);
+my @names = map { $_->{name} } @{cbor($reply)};
+ok((grep { $_ eq $tmp } @names), 'workspace found in GET_WORKSPACES reply');
+
+send_message($sock, 4, '');
+($type, $reply) = recv_message($sock);
+my $tree = cbor($reply);
+is($tree->{type}, 'root', 'GET_TREE reply decoded');
+
+################################################################################
+# 3: events are CBOR as well, JSON clients are not affected
+################################################################################
+
+my $json_sock = raw_connect;
+send_message($_, 2, '["workspace"]') for ($sock, $json_sock);
+recv_message($_) for ($sock, $json_sock);
+
+my $other = get_unused_workspace;
+cmd "workspace $other";
+
+($type, $reply) = recv_message($sock);
+my $event = cbor($reply);
+is($event->{change}, 'focus', 'workspace event decoded');
+is($event->{current}->{name}, $other, 'event refers to the new workspace');
+
+($type, $reply) = recv_message($json_sock);
+is(decode_json($reply)->{change}, 'focus', 'JSON client still gets JSON');
+
+send_message($sock, 11, 'json');
+recv_message($sock);
+send_message($sock, 7, '');
+($type, $reply) = recv_message($sock);
+is(decode_json($reply)->{human_readable}, $version->{human_readable}, 'switched back to JSON');
+
+done_testing;
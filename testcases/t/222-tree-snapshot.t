@@ -0,0 +1,91 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • http://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • http://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • http://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that the tree snapshot in shared memory (see include/shmtree.h)
+# reflects the tree and is removed once it is disabled.
+use i3test i3_autostart => 0;
+
+my $config = <<EOT;
+# i3 config file (v4)
+font -misc-fixed-medium-r-normal--13-120-75-75-C-70-iso10646-1
+EOT
+
+my $pid = launch_with_config($config);
+my $path = "/dev/shm/i3-tree-$pid";
+
+# Reads the snapshot and returns the header and the nodes (with their names
+# resolved).
+sub read_snapshot {
+    open(my $fh, '<:raw', $path) or return undef;
+    my $data = do { local $/; <$fh> };
+    close($fh);
+
+    my %header;
+    @header{qw(magic version sequence size num_nodes nodes_offset strings_offset focused)} =
+        unpack('L8', $data);
+
+    my @nodes;
+    for my $i (0 .. $header{num_nodes} - 1) {
+        my %node;
+        @node{qw(id window parent subtree_size name x y width height num type layout fullscreen_mode flags)} =
+            unpack('Q L l L L l l L L l C C C C', substr($data, $header{nodes_offset} + $i * 48, 48));
+        $node{name} = ($node{name} == 0xFFFFFFFF ? undef :
+                       unpack('Z*', substr($data, $header{strings_offset} + $node{name})));
+        push @nodes, \%node;
+    }
+    return (\%header, \@nodes);
+}
+
+################################################################################
+# 1: the snapshot is disabled by default
+################################################################################
+
+ok(!-e $path, 'no snapshot by default');
+
+################################################################################
+# 2: the snapshot contains the tree and follows changes
+################################################################################
+
+cmd 'tree_snapshot on';
+ok(-e $path, 'snapshot created');
+
+my $ws = fresh_workspace;
+my ($header, $nodes) = read_snapshot;
+is($header->{magic}, 0x72743369, 'magic ok');
+is($header->{sequence} % 2, 0, 'no update in progress');
+is($nodes->[0]->{type}, 0, 'first node is the root');
+is($nodes->[0]->{subtree_size}, scalar @$nodes, 'root subtree covers all nodes');
+
+my ($ws_node) = grep { $_->{type} == 4 && $_->{name} eq $ws } @$nodes;
+ok(defined($ws_node), 'workspace found in the snapshot');
+
+my $window = open_window;
+my $old_sequence = $header->{sequence};
+($header, $nodes) = read_snapshot;
+cmp_ok($header->{sequence}, '>', $old_sequence, 'snapshot updated');
+is($nodes->[$header->{focused}]->{window}, $window->id, 'focused window in the snapshot');
+ok($nodes->[$header->{focused}]->{flags} & 1, 'focused flag set');
+
+################################################################################
+# 3: disabling removes the snapshot
+################################################################################
+
+cmd 'tree_snapshot off';
+ok(!-e $path, 'snapshot removed');
+
+exit_gracefully($pid);
+
+done_testing;
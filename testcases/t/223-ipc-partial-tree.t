@@ -0,0 +1,75 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • http://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • http://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • http://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that GET_TREE can be limited to a subtree and a set of properties.
+use i3test;
+use JSON::XS;
+
+my $i3 = i3(get_socket_path());
+
+sub get_partial_tree {
+    my ($request) = @_;
+    return $i3->message(4, encode_json($request))->recv;
+}
+
+my $tmp = fresh_workspace;
+my $window = open_window;
+my $con_id = get_focused($tmp);
+
+################################################################################
+# An empty payload still returns the whole tree.
+################################################################################
+
+my $tree = $i3->get_tree->recv;
+is($tree->{type}, 0, 'root container returned');
+ok(exists($tree->{rect}), 'all properties included');
+
+################################################################################
+# Selecting a workspace returns only that workspace.
+################################################################################
+
+my $ws = get_partial_tree({ workspace => $tmp });
+is($ws->{name}, $tmp, 'workspace returned as root');
+is(scalar @{$ws->{nodes}}, 1, 'workspace has one child');
+is($ws->{nodes}->[0]->{window}, $window->id, 'child is our window');
+
+################################################################################
+# Selecting a container by id and projecting fields.
+################################################################################
+
+my $con = get_partial_tree({ id => $con_id, fields => [ 'id', 'window' ] });
+is($con->{id}, $con_id, 'container returned as root');
+is($con->{window}, $window->id, 'window included');
+ok(!exists($con->{name}), 'name not included');
+ok(!exists($con->{rect}), 'rect not included');
+ok(exists($con->{nodes}), 'nodes always included');
+
+my $output = get_partial_tree({ output => 'fake-0', fields => [ 'name' ] });
+is($output->{name}, 'fake-0', 'output returned as root');
+ok(!exists($output->{id}), 'id not included');
+
+################################################################################
+# Errors
+################################################################################
+
+my $reply = get_partial_tree({ workspace => 'does-not-exist' });
+ok(!$reply->{success}, 'unknown workspace is an error');
+
+$reply = get_partial_tree({ fields => [ 'bogus' ] });
+ok(!$reply->{success}, 'unknown field is an error');
+is($reply->{error}, 'Unknown field', 'error message');
+
+done_testing;
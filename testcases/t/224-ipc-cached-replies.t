@@ -0,0 +1,51 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • http://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • http://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • http://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that the cached GET_WORKSPACES and GET_OUTPUTS replies are
+# invalidated when workspaces change.
+use i3test;
+use List::Util qw(first);
+
+my $i3 = i3(get_socket_path());
+
+sub get_ws {
+    my ($name) = @_;
+    return first { $_->{name} eq $name } @{$i3->get_workspaces->recv};
+}
+
+my $first = fresh_workspace;
+ok(get_ws($first)->{focused}, 'new workspace focused');
+
+# Request the reply twice, so that the second one comes from the cache.
+is_deeply($i3->get_workspaces->recv, $i3->get_workspaces->recv, 'replies identical');
+
+my $second = fresh_workspace;
+open_window;
+ok(get_ws($second)->{focused}, 'second workspace focused');
+ok(!defined(get_ws($first)), 'empty workspace closed');
+
+cmd "rename workspace to renamed-$second";
+ok(defined(get_ws("renamed-$second")), 'renamed workspace reported');
+ok(!defined(get_ws($second)), 'old name not reported anymore');
+
+my $output = first { $_->{name} eq 'fake-0' } @{$i3->get_outputs->recv};
+is($output->{current_workspace}, "renamed-$second", 'current workspace of the output updated');
+
+cmd "workspace $first";
+$output = first { $_->{name} eq 'fake-0' } @{$i3->get_outputs->recv};
+is($output->{current_workspace}, $first, 'workspace switch reported');
+
+done_testing;
@@ -0,0 +1,101 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • http://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • http://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • http://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that replies to messages with a request id (bit 30 of the message
+# type) are tagged with the same id, and that events are not.
+use i3test;
+use IO::Socket::UNIX;
+use JSON::XS;
+
+my $flag = (1 << 30);
+
+sub raw_connect {
+    return IO::Socket::UNIX->new(Peer => get_socket_path(), Type => SOCK_STREAM)
+        or die "Could not connect to i3: $!";
+}
+
+sub send_message {
+    my ($sock, $type, $payload) = @_;
+    $sock->syswrite('i3-ipc' . pack('LL', length($payload), $type) . $payload);
+}
+
+sub recv_message {
+    my ($sock) = @_;
+    my $header;
+    $sock->sysread($header, 14) == 14 or die "Could not read header: $!";
+    my ($magic, $length, $type) = unpack('a6LL', $header);
+    my $payload = '';
+    while (length($payload) < $length) {
+        $sock->sysread($payload, $length - length($payload), length($payload)) or die "read: $!";
+    }
+    return ($type, $payload);
+}
+
+my $tmp = fresh_workspace;
+
+################################################################################
+# 1: several tagged requests in flight at once
+################################################################################
+
+my $sock = raw_connect;
+send_message($sock, 7 | $flag, pack('L', 42));
+send_message($sock, 1 | $flag, pack('L', 43));
+send_message($sock, 7, '');
+
+my ($type, $reply) = recv_message($sock);
+is($type, 7 | $flag, 'GET_VERSION reply is tagged');
+my ($id, $json) = unpack('La*', $reply);
+is($id, 42, 'GET_VERSION reply has the request id');
+ok(exists(decode_json($json)->{major}), 'GET_VERSION reply follows the id');
+
+($type, $reply) = recv_message($sock);
+is($type, 1 | $flag, 'GET_WORKSPACES reply is tagged');
+($id, $json) = unpack('La*', $reply);
+is($id, 43, 'GET_WORKSPACES reply has the request id');
+is(ref(decode_json($json)), 'ARRAY', 'GET_WORKSPACES reply follows the id');
+
+($type, $reply) = recv_message($sock);
+is($type, 7, 'untagged request gets an untagged reply');
+ok(exists(decode_json($reply)->{major}), 'untagged reply is plain JSON');
+
+################################################################################
+# 2: events are not tagged
+################################################################################
+
+send_message($sock, 2 | $flag, pack('L', 7) . '["workspace"]');
+($type, $reply) = recv_message($sock);
+is($type, 2 | $flag, 'SUBSCRIBE reply is tagged');
+($id, $json) = unpack('La*', $reply);
+is($id, 7, 'SUBSCRIBE reply has the request id');
+ok(decode_json($json)->{success}, 'subscribed');
+
+send_message($sock, 0 | $flag, pack('L', 8) . "workspace $tmp-other");
+# Switching workspaces generates several events (“init”, “focus”), which are
+# sent before the reply.
+my $events = 0;
+while (1) {
+    ($type, $reply) = recv_message($sock);
+    last unless $type & (1 << 31);
+    is($type, (1 << 31) | 0, 'workspace event is not tagged');
+    ok(defined(decode_json($reply)->{change}), 'event payload is plain JSON');
+    $events++;
+}
+ok($events > 0, 'workspace events received');
+is($type, 0 | $flag, 'COMMAND reply is tagged');
+($id, $json) = unpack('La*', $reply);
+is($id, 8, 'COMMAND reply has the request id');
+
+done_testing;
@@ -0,0 +1,134 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • http://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • http://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • http://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that IPC connections survive an inplace restart: subscribed clients
+# get the shutdown event and keep their subscriptions. Bars are not handed
+# off, so that restarting does not add another set of them.
+use i3test i3_autostart => 0;
+use IO::Socket::UNIX;
+use JSON::XS;
+use File::Temp qw(tempdir);
+use Time::HiRes qw(sleep);
+
+# A stand-in for i3bar: it requests its bar configuration and then stays
+# around (with a file named after its pid in the given directory) until i3
+# closes the connection, like i3bar does.
+my $bar_dir = tempdir(CLEANUP => 1);
+my $bar_script = "$bar_dir/bar.pl";
+open(my $bar_fh, '>', $bar_script) or die "Could not create $bar_script: $!";
+print $bar_fh <<'EOT';
+use IO::Socket::UNIX;
+my $dir = shift;
+my ($bar_id) = map { /^--bar_id=(.*)$/ ? $1 : () } @ARGV;
+my ($path) = map { /^--socket=(.*)$/ ? $1 : () } @ARGV;
+my $sock = IO::Socket::UNIX->new(Peer => $path, Type => SOCK_STREAM) or exit 1;
+$sock->syswrite('i3-ipc' . pack('LL', length($bar_id), 6) . $bar_id);
+open(my $fh, '>', "$dir/$$") and close($fh);
+1 while $sock->sysread(my $buf, 4096);
+unlink("$dir/$$");
+EOT
+close($bar_fh);
+
+sub bar_pids {
+    opendir(my $dh, $bar_dir) or die "Could not open $bar_dir: $!";
+    my @pids = grep { /^\d+$/ } readdir($dh);
+    closedir($dh);
+    return @pids;
+}
+
+# Waits (for up to 5 seconds) until the given condition holds.
+sub wait_for {
+    my ($cond) = @_;
+    for (1 .. 50) {
+        return 1 if $cond->();
+        sleep 0.1;
+    }
+    return $cond->();
+}
+
+my $config = <<EOT;
+# i3 config file (v4)
+font -misc-fixed-medium-r-normal--13-120-75-75-C-70-iso10646-1
+
+bar {
+    i3bar_command perl $bar_script $bar_dir
+}
+EOT
+my $pid = launch_with_config($config);
+
+ok(wait_for(sub { bar_pids() == 1 }), 'one bar started');
+my ($old_bar) = bar_pids();
+
+sub raw_connect {
+    return IO::Socket::UNIX->new(Peer => get_socket_path(), Type => SOCK_STREAM)
+        or die "Could not connect to i3: $!";
+}
+
+sub send_message {
+    my ($sock, $type, $payload) = @_;
+    $sock->syswrite('i3-ipc' . pack('LL', length($payload), $type) . $payload);
+}
+
+sub recv_message {
+    my ($sock) = @_;
+    my $header;
+    $sock->sysread($header, 14) == 14 or die "Could not read header: $!";
+    my ($magic, $length, $type) = unpack('a6LL', $header);
+    my $payload = '';
+    while (length($payload) < $length) {
+        $sock->sysread($payload, $length - length($payload), length($payload)) or die "read: $!";
+    }
+    return ($type, $payload);
+}
+
+my $tmp = fresh_workspace;
+
+my $sock = raw_connect;
+send_message($sock, 2, '["shutdown", "workspace"]');
+my ($type, $reply) = recv_message($sock);
+ok(decode_json($reply)->{success}, 'subscribed');
+
+cmd 'restart';
+
+($type, $reply) = recv_message($sock);
+is($type, (1 << 31) | 5, 'shutdown event received');
+is(decode_json($reply)->{change}, 'restart', 'change is restart');
+
+# Wait for the new process, then use the same connection again.
+does_i3_live;
+
+send_message($sock, 7, '');
+($type, $reply) = recv_message($sock);
+is($type, 7, 'GET_VERSION reply on the old connection');
+ok(exists(decode_json($reply)->{major}), 'reply is valid');
+
+cmd "workspace $tmp-other";
+($type, $reply) = recv_message($sock);
+is($type, (1 << 31) | 0, 'still subscribed to workspace events');
+
+################################################################################
+# The bar of the previous process exited and the new process started one, so
+# there still is exactly one.
+################################################################################
+
+ok(wait_for(sub { !grep { $_ eq $old_bar } bar_pids() }), 'old bar exited');
+ok(wait_for(sub { bar_pids() == 1 }), 'new bar started');
+sleep 0.5;
+is(scalar bar_pids(), 1, 'still exactly one bar after the restart');
+
+exit_gracefully($pid);
+
+done_testing;
@@ -0,0 +1,96 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • http://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • http://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • http://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that replies and events are delivered correctly when the output of
+# IPC clients is written by the I/O thread (ipc_thread yes).
+use i3test i3_autostart => 0;
+use IO::Socket::UNIX;
+use JSON::XS;
+
+my $config = <<EOT;
+# i3 config file (v4)
+font -misc-fixed-medium-r-normal--13-120-75-75-C-70-iso10646-1
+ipc_thread yes
+EOT
+
+my $pid = launch_with_config($config);
+
+sub raw_connect {
+    return IO::Socket::UNIX->new(Peer => get_socket_path(), Type => SOCK_STREAM)
+        or die "Could not connect to i3: $!";
+}
+
+sub send_message {
+    my ($sock, $type, $payload) = @_;
+    $sock->syswrite('i3-ipc' . pack('LL', length($payload), $type) . $payload);
+}
+
+sub recv_message {
+    my ($sock) = @_;
+    my $header;
+    $sock->sysread($header, 14) == 14 or die "Could not read header: $!";
+    my ($magic, $length, $type) = unpack('a6LL', $header);
+    my $payload = '';
+    while (length($payload) < $length) {
+        $sock->sysread($payload, $length - length($payload), length($payload)) or die "read: $!";
+    }
+    return ($type, $payload);
+}
+
+my $tmp = fresh_workspace;
+open_window for (1 .. 5);
+
+################################################################################
+# 1: many requests in flight, replies arrive complete and in order
+################################################################################
+
+my $sock = raw_connect;
+send_message($sock, ($_ % 2 ? 4 : 7), '') for (1 .. 50);
+
+my $in_order = 1;
+for my $i (1 .. 50) {
+    my ($type, $reply) = recv_message($sock);
+    my $expected = ($i % 2 ? 4 : 7);
+    $in_order = 0 unless $type == $expected && defined(decode_json($reply));
+}
+ok($in_order, 'all replies received in order');
+
+################################################################################
+# 2: events are delivered to subscribers
+################################################################################
+
+my $subscriber = raw_connect;
+send_message($subscriber, 2, '["workspace"]');
+my ($type, $reply) = recv_message($subscriber);
+ok(decode_json($reply)->{success}, 'subscribed');
+
+cmd "workspace $tmp-other";
+($type, $reply) = recv_message($subscriber);
+is($type, (1 << 31) | 0, 'workspace event received');
+
+################################################################################
+# 3: clients which disconnect do not affect i3
+################################################################################
+
+my $gone = raw_connect;
+send_message($gone, 4, '') for (1 .. 20);
+close($gone);
+
+does_i3_live;
+
+exit_gracefully($pid);
+
+done_testing;
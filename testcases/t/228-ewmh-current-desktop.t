@@ -0,0 +1,79 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • http://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • http://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • http://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that _NET_CURRENT_DESKTOP follows the focused workspace, also when
+# workspaces are created or closed in between (i3 only writes the property
+# when its value changes and caches the workspace indexes).
+use i3test i3_autostart => 0;
+
+my $config = <<EOT;
+# i3 config file (v4)
+font -misc-fixed-medium-r-normal--13-120-75-75-C-70-iso10646-1
+fake-outputs 1024x768+0+0
+EOT
+
+my $pid = launch_with_config($config);
+
+sub current_desktop {
+    sync_with_i3;
+    my $cookie = $x->get_property(
+        0,
+        $x->get_root_window(),
+        $x->atom(name => '_NET_CURRENT_DESKTOP')->id,
+        $x->atom(name => 'CARDINAL')->id,
+        0,
+        1,
+    );
+    my $reply = $x->get_property_reply($cookie->{sequence});
+    return undef if $reply->{value_len} != 1;
+    return unpack('L', $reply->{value});
+}
+
+cmd 'workspace 1';
+open_window;
+cmd 'workspace 3';
+open_window;
+
+my $first = current_desktop;
+ok(defined($first), '_NET_CURRENT_DESKTOP is set');
+
+cmd 'workspace 1';
+my $ws1 = current_desktop;
+is($ws1, $first - 1, 'workspace 1 is before workspace 3');
+
+# Creating workspace 2 shifts workspace 3 to the right.
+cmd 'workspace 2';
+is(current_desktop, $ws1 + 1, 'workspace 2 is after workspace 1');
+open_window;
+
+cmd 'workspace 3';
+is(current_desktop, $ws1 + 2, 'workspace 3 moved to the right');
+
+cmd 'workspace 3';
+is(current_desktop, $ws1 + 2, 'index unchanged when staying on workspace 3');
+
+# Closing workspace 1 shifts the others to the left.
+cmd 'workspace 1';
+cmd 'kill';
+cmd 'workspace 3';
+is(current_desktop, $ws1 + 1, 'workspace 3 moved to the left');
+
+cmd 'workspace 2';
+is(current_desktop, $ws1, 'workspace 2 is first now');
+
+exit_gracefully($pid);
+
+done_testing;
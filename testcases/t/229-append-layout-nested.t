@@ -0,0 +1,109 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • http://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • http://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • http://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that append_layout builds nested layouts with floating containers
+# correctly, now that the new containers are only attached (and get their
+# frames) once the whole file was parsed. Also verifies that gzip-compressed
+# layouts and layouts larger than one read chunk are loaded.
+use i3test;
+use File::Temp qw(tempfile);
+use IO::Compress::Gzip qw(gzip $GzipError);
+
+my $tmp = fresh_workspace;
+
+my ($fh, $filename) = tempfile(UNLINK => 1);
+print $fh <<'EOT';
+{
+    "layout": "splith",
+    "percent": 1.0,
+    "nodes": [
+        {
+            "layout": "splitv",
+            "percent": 0.5,
+            "nodes": [
+                { "percent": 0.5, "swallows": [ { "class": "^top$" } ] },
+                { "percent": 0.5, "swallows": [ { "class": "^bottom$" } ] }
+            ]
+        },
+        {
+            "layout": "tabbed",
+            "percent": 0.5,
+            "nodes": [
+                { "swallows": [ { "class": "^tab1$" } ] },
+                { "swallows": [ { "class": "^tab2$" } ] },
+                { "swallows": [ { "class": "^tab3$" } ] }
+            ]
+        }
+    ],
+    "floating_nodes": [
+        {
+            "type": 5,
+            "rect": { "x": 10, "y": 10, "width": 300, "height": 200 },
+            "nodes": [
+                { "swallows": [ { "class": "^floating$" } ] }
+            ]
+        }
+    ]
+}
+EOT
+close($fh);
+
+cmd "append_layout $filename";
+
+my $ws = get_ws($tmp);
+is(@{$ws->{nodes}}, 1, 'one tiling container on the workspace');
+is(@{$ws->{floating_nodes}}, 1, 'one floating container on the workspace');
+
+my $split = $ws->{nodes}->[0];
+is($split->{layout}, 'splith', 'top container is splith');
+is(@{$split->{nodes}}, 2, 'two children');
+is($split->{nodes}->[0]->{layout}, 'splitv', 'first child is splitv');
+is(@{$split->{nodes}->[0]->{nodes}}, 2, 'splitv has two placeholders');
+is($split->{nodes}->[1]->{layout}, 'tabbed', 'second child is tabbed');
+is(@{$split->{nodes}->[1]->{nodes}}, 3, 'tabbed has three placeholders');
+is(@{$ws->{floating_nodes}->[0]->{nodes}}, 1, 'floating container has a placeholder');
+
+# Appending a second time adds a second subtree next to the first one.
+cmd "append_layout $filename";
+$ws = get_ws($tmp);
+is(@{$ws->{nodes}}, 2, 'two tiling containers after the second append');
+is(@{$ws->{floating_nodes}}, 2, 'two floating containers after the second append');
+
+# The placeholders have frames, so windows can be swallowed and displayed.
+my $window = open_window(wm_class => 'tab2');
+$split = get_ws($tmp)->{nodes}->[0];
+is($split->{nodes}->[1]->{nodes}->[1]->{window}, $window->id, 'window swallowed by its placeholder');
+
+################################################################################
+# A gzip-compressed layout which is larger than one chunk (64 KiB).
+################################################################################
+
+$tmp = fresh_workspace;
+
+my $placeholder = '{ "swallows": [ { "class": "^nothing' . ('x' x 200) . '$" } ] }';
+my $json = '{ "layout": "splitv", "nodes": [ ' . join(', ', ($placeholder) x 500) . ' ] }';
+cmp_ok(length($json), '>', 65536, 'layout is larger than one chunk');
+
+my (undef, $gzfilename) = tempfile(UNLINK => 1, SUFFIX => '.json.gz');
+gzip(\$json => $gzfilename) or die "gzip failed: $GzipError";
+
+cmd "append_layout $gzfilename";
+
+$ws = get_ws($tmp);
+is(@{$ws->{nodes}}, 1, 'one container on the workspace');
+is(@{$ws->{nodes}->[0]->{nodes}}, 500, 'all placeholders of the compressed layout loaded');
+
+done_testing;
@@ -0,0 +1,61 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • http://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • http://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • http://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that the two most recently hidden workspaces are still rendered, so
+# that their containers already have the right geometry when switching back,
+# while older hidden workspaces are only rendered when they are shown.
+use i3test;
+
+sub first_width {
+    my ($ws) = @_;
+    my $nodes = get_ws($ws)->{nodes};
+    return $nodes->[0]->{rect}->{width};
+}
+
+my $old = fresh_workspace;
+my $old_first = open_window;
+my $old_second = open_window;
+
+# Empty workspaces are closed when switching away, so these need a window to
+# push $old out of the recently hidden workspaces.
+for (1..2) {
+    fresh_workspace;
+    open_window;
+}
+
+my $recent = fresh_workspace;
+my $recent_first = open_window;
+my $recent_second = open_window;
+
+my $ws_width = get_ws($recent)->{rect}->{width};
+is(first_width($recent), int($ws_width / 2) + ($ws_width % 2), 'two containers next to each other');
+
+my $current = fresh_workspace;
+
+$recent_second->destroy;
+$old_second->destroy;
+sync_with_i3;
+
+is(first_width($recent), $ws_width, 'recently hidden workspace rendered');
+isnt(first_width($old), $ws_width, 'older hidden workspace not rendered');
+
+cmd "workspace $old";
+is(first_width($old), $ws_width, 'workspace rendered when shown');
+
+cmd "workspace $recent";
+is(first_width($recent), $ws_width, 'geometry unchanged after switching back');
+
+done_testing;
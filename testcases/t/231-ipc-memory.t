@@ -0,0 +1,60 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • http://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • http://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • http://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that GET_MEMORY reports the objects i3 has allocated and that the
+# counts go down again once a window is closed.
+use i3test;
+use List::Util qw(first);
+
+my $i3 = i3(get_socket_path());
+$i3->connect->recv;
+
+sub get_objects {
+    my ($type) = @_;
+    my $memory = $i3->message(12, '')->recv;
+    return first { $_->{type} eq $type } @{$memory->{objects}};
+}
+
+my $tmp = fresh_workspace;
+
+my $memory = $i3->message(12, '')->recv;
+ok(exists($memory->{heap}), 'heap usage reported');
+cmp_ok($memory->{pool_bytes}, '>', 0, 'pools use memory');
+
+my $cons = get_objects('Con');
+ok(defined($cons), 'containers reported');
+cmp_ok($cons->{count}, '>', 0, 'containers allocated');
+cmp_ok($cons->{bytes}, '>', 0, 'containers use memory');
+
+my $strings = get_objects('i3String');
+ok(defined($strings), 'strings reported');
+my $strings_before = $strings->{count};
+
+my $window = open_window(name => 'memory test');
+sync_with_i3;
+
+my $windows = get_objects('i3Window');
+my $windows_open = $windows->{count};
+cmp_ok($windows_open, '>', 0, 'windows allocated');
+cmp_ok(get_objects('i3String')->{count}, '>', $strings_before, 'window title counted');
+
+$window->unmap;
+wait_for_unmap $window;
+
+is(get_objects('i3Window')->{count}, $windows_open - 1, 'closed window not counted anymore');
+is(get_objects('i3String')->{count}, $strings_before, 'window title freed');
+
+done_testing;
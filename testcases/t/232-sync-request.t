@@ -0,0 +1,75 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • http://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • http://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • http://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that _NET_WM_SYNC_REQUEST is supported and that a client which
+# never updates its sync counter still gets resized (after a timeout).
+use i3test;
+use X11::XCB qw(PROP_MODE_REPLACE);
+use Time::HiRes qw(sleep);
+
+my $cookie = $x->get_property(
+    0,
+    $x->get_root_window(),
+    $x->atom(name => '_NET_SUPPORTED')->id,
+    $x->atom(name => 'ATOM')->id,
+    0,
+    4096,
+);
+my $reply = $x->get_property_reply($cookie->{sequence});
+my %supported = map { $_ => 1 } unpack('L*', $reply->{value});
+ok($supported{$x->atom(name => '_NET_WM_SYNC_REQUEST')->id}, '_NET_WM_SYNC_REQUEST is supported');
+
+my $tmp = fresh_workspace;
+
+# The counter does not exist, so the client never acknowledges a resize.
+my $window = open_window(
+    before_map => sub {
+        my ($window) = @_;
+        $x->change_property(
+            PROP_MODE_REPLACE,
+            $window->id,
+            $x->atom(name => 'WM_PROTOCOLS')->id,
+            $x->atom(name => 'ATOM')->id,
+            32,
+            1,
+            pack('L', $x->atom(name => '_NET_WM_SYNC_REQUEST')->id),
+        );
+        $x->change_property(
+            PROP_MODE_REPLACE,
+            $window->id,
+            $x->atom(name => '_NET_WM_SYNC_REQUEST_COUNTER')->id,
+            $x->atom(name => 'CARDINAL')->id,
+            32,
+            1,
+            pack('L', 0x00c0ffee),
+        );
+    },
+);
+
+my $width = $window->rect->width;
+
+# The first resize is not held back.
+open_window;
+cmp_ok($window->rect->width, '<', $width, 'window resized');
+$width = $window->rect->width;
+
+# The second one waits for the counter, then it times out.
+open_window;
+sleep(0.5);
+sync_with_i3;
+cmp_ok($window->rect->width, '<', $width, 'window resized after the timeout');
+
+done_testing;
@@ -0,0 +1,55 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • http://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • http://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • http://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Tests 'focus back_and_forth', which focuses the previously focused window
+# (across workspaces, too).
+use i3test;
+
+my $ws1 = fresh_workspace;
+my $first = open_window;
+my $second = open_window;
+is($x->input_focus, $second->id, 'second window focused');
+
+cmd 'focus back_and_forth';
+is($x->input_focus, $first->id, 'first window focused');
+
+cmd 'focus back_and_forth';
+is($x->input_focus, $second->id, 'second window focused again');
+
+# Another workspace
+my $ws2 = fresh_workspace;
+my $third = open_window;
+
+cmd 'focus back_and_forth';
+is($x->input_focus, $second->id, 'second window focused');
+is(focused_ws, $ws1, 'switched back to the first workspace');
+
+cmd 'focus back_and_forth';
+is($x->input_focus, $third->id, 'third window focused');
+is(focused_ws, $ws2, 'switched to the second workspace');
+
+# A closed window is not focused again.
+$third->unmap;
+wait_for_unmap $third;
+
+cmd 'focus back_and_forth';
+is($x->input_focus, $second->id, 'second window focused after closing the third one');
+is(focused_ws, $ws1, 'switched back to the first workspace');
+
+cmd 'focus back_and_forth';
+is($x->input_focus, $first->id, 'closed window skipped');
+
+done_testing;
@@ -0,0 +1,95 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • http://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • http://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • http://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Tests that outputs on which nothing changed are left alone when rendering
+# changes on another output, and that they are rendered again when they need
+# to be (e.g. after a global fullscreen container is gone).
+#
+use i3test i3_autostart => 0;
+
+# Ensure the pointer is at (0, 0) so that we really start on the first
+# (the left) workspace.
+$x->root->warp_pointer(0, 0);
+
+my $config = <<EOT;
+# i3 config file (v4)
+font -misc-fixed-medium-r-normal--13-120-75-75-C-70-iso10646-1
+
+fake-outputs 1024x768+0+0,1024x768+1024+0
+EOT
+my $pid = launch_with_config($config);
+
+my $left_ws = fresh_workspace;
+my $left = open_window;
+
+$x->root->warp_pointer(1025, 0);
+sync_with_i3;
+my $right_ws = fresh_workspace;
+my $right = open_window;
+my $right_rect = get_ws($right_ws)->{nodes}->[0]->{rect};
+
+################################################################################
+# Opening windows on the left output does not affect the right one.
+################################################################################
+
+cmd 'focus output fake-0';
+my $second = open_window;
+my $third = open_window;
+
+is(@{get_ws($left_ws)->{nodes}}, 3, 'three windows on the left output');
+ok($third->mapped, 'new window mapped');
+is_deeply(get_ws($right_ws)->{nodes}->[0]->{rect}, $right_rect,
+          'right window still has the same rect');
+ok($right->mapped, 'right window still mapped');
+
+################################################################################
+# Changes on the other output are rendered as usual.
+################################################################################
+
+cmd '[id="' . $right->id . '"] border 1pixel';
+is(get_ws($right_ws)->{nodes}->[0]->{border}, '1pixel', 'border changed');
+ok($left->mapped, 'left window still mapped');
+
+cmd 'focus output fake-1';
+cmd 'workspace ' . get_unused_workspace;
+sync_with_i3;
+ok(!$right->mapped, 'right window unmapped after switching workspaces');
+ok($left->mapped, 'left window still mapped');
+
+cmd "workspace $right_ws";
+sync_with_i3;
+ok($right->mapped, 'right window mapped again');
+ok($left->mapped, 'left window still mapped');
+
+################################################################################
+# After a global fullscreen container is gone, the other output is shown
+# again although nothing on it changed.
+################################################################################
+
+cmd '[id="' . $third->id . '"] focus';
+cmd 'fullscreen global';
+sync_with_i3;
+ok(!$right->mapped, 'right window unmapped while fullscreen global');
+
+cmd 'fullscreen';
+sync_with_i3;
+ok($right->mapped, 'right window mapped after fullscreen global ended');
+is_deeply(get_ws($right_ws)->{nodes}->[0]->{rect}, $right_rect,
+          'right window has the same rect after fullscreen global ended');
+
+exit_gracefully($pid);
+
+done_testing;